@@ -108,4 +108,17 @@ if(UNIX)
 
     set(CMAKE_C_FLAGS_RELWITHDEBINFO "${CMAKE_C_FLAGS_RELWITHDEBINFO} -DNDEBUG")
     set(CMAKE_CXX_FLAGS_RELWITHDEBINFO "${CMAKE_CXX_FLAGS_RELWITHDEBINFO} -DNDEBUG")
+
+    if (FB_SANITIZE)
+        set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -fsanitize=${FB_SANITIZE} -fno-omit-frame-pointer")
+        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fsanitize=${FB_SANITIZE} -fno-omit-frame-pointer")
+        set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} -fsanitize=${FB_SANITIZE}")
+        set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} -fsanitize=${FB_SANITIZE}")
+        set(CMAKE_MODULE_LINKER_FLAGS "${CMAKE_MODULE_LINKER_FLAGS} -fsanitize=${FB_SANITIZE}")
+    endif()
+endif()
+
+if (WITH_RACE_TESTING)
+    set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -DFB_RACE_TESTING=1")
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -DFB_RACE_TESTING=1")
 endif()
@@ -10,3 +10,6 @@ endif()
 option(BUILD_EXAMPLES "Build example projects" OFF)
 option(WITH_DYNAMIC_MSVC_RUNTIME "Build with dynamic MSVC runtime (/MD)" OFF)
 option(WITH_SYSTEM_BOOST "Build with system Boost" OFF)
+option(WITH_RACE_TESTING "Build with hooks for injecting delays at thread synchronization points (used by the stress tests)" OFF)
+option(WITH_BENCHMARKS "Build and run the benchmarks in tests/Benchmarks (slow, and they use gigabytes of temp space)" OFF)
+set(FB_SANITIZE "" CACHE STRING "Sanitizers to build with on gcc/clang, e.g. address,undefined or thread")
@@ -37,6 +37,12 @@ set (FB_SCRIPTINGCORE_BUILD_DIR "${FB_BUILD_DIR}/ScriptingCore")
 set (FB_SCRIPTINGCORETEST_SOURCE_DIR "${FB_TEST_DIR}/ScriptingCoreTest")
 set (FB_SCRIPTINGCORETEST_BUILD_DIR "${FB_BUILD_DIR}/ScriptingCoreTest")
 
+set (FB_HTTPSERVICETEST_SOURCE_DIR "${FB_TEST_DIR}/HttpServiceTest")
+set (FB_HTTPSERVICETEST_BUILD_DIR "${FB_BUILD_DIR}/HttpServiceTest")
+
+set (FB_BENCHMARKS_SOURCE_DIR "${FB_TEST_DIR}/Benchmarks")
+set (FB_BENCHMARKS_BUILD_DIR "${FB_BUILD_DIR}/Benchmarks")
+
 set (FB_PLUGINCORE_SOURCE_DIR "${FB_SOURCE_DIR}/PluginCore")
 set (FB_PLUGINCORE_BUILD_DIR "${FB_BUILD_DIR}/PluginCore")
 
@@ -23,6 +23,11 @@ Copyright 2009 PacketPass Inc, Georg Fritzsche,
 #include "SimpleStreams.h"
 #include "SystemHelpers.h"
 #include <boost/make_shared.hpp>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "HTTPService.h"
+#include "HTTPService/JsonRpcGateway.h"
 
 #include "FBTestPluginAPI.h"
 
@@ -56,6 +61,7 @@ FBTestPluginAPI::FBTestPluginAPI(const FBTestPluginPtr& plugin, const FB::Browse
     registerMethod(L"скажи",  make_method(this, &FBTestPluginAPI::say));
 
     registerMethod("ping", make_method(this, &FBTestPluginAPI::ping));
+    registerMethod("testJsonRpc", make_method(this, &FBTestPluginAPI::testJsonRpc));
 
     registerMethod("addWithSimpleMath", make_method(this, &FBTestPluginAPI::addWithSimpleMath));
     registerMethod("createSimpleMath", make_method(this, &FBTestPluginAPI::createSimpleMath));
@@ -381,7 +387,8 @@ void FBTestPluginAPI::getURLCallback(const FB::JSObjectPtr& callback, bool succe
 void FBTestPluginAPI::SetTimeout(const FB::JSObjectPtr& callback, long timeout)
 {
     bool recursive = false;
-    FB::TimerPtr timer = FB::Timer::getTimer(timeout, recursive, boost::bind(&FBTestPluginAPI::timerCallback, this, callback));
+    // Counts against the page's timer quota, and stops when the page goes away
+    FB::TimerPtr timer = FB::Timer::getTimer(m_host, timeout, recursive, boost::bind(&FBTestPluginAPI::timerCallback, this, callback));
     timer->start();
     timers.push_back(timer);
 }
@@ -443,3 +450,82 @@ void FBTestPluginAPI::ping( const int seq, const FB::JSObjectPtr& callback )
 {
     callback->InvokeAsync("", FB::variant_list_of(shared_from_this())(seq));
 }
+
+namespace {
+    // POSTs body to the gateway and returns "<status> <response body>"
+    std::string postJsonRpc(const FB::URI& base, const std::string& body)
+    {
+        using boost::asio::ip::tcp;
+        boost::asio::io_service io;
+        tcp::socket sock(io);
+        sock.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), base.port));
+
+        std::string req = "POST /rpc HTTP/1.1\r\nHost: " + base.domain
+            + "\r\nContent-Type: application/json\r\nContent-Length: "
+            + boost::lexical_cast<std::string>(body.size()) + "\r\n\r\n" + body;
+        boost::asio::write(sock, boost::asio::buffer(req));
+
+        boost::asio::streambuf buf;
+        size_t len = boost::asio::read_until(sock, buf, "\r\n\r\n");
+        std::string head(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + len);
+        buf.consume(len);
+
+        size_t bodyLen = 0;
+        std::string::size_type cl = head.find("Content-Length: ");
+        if (cl != std::string::npos)
+            bodyLen = boost::lexical_cast<size_t>(head.substr(cl + 16, head.find("\r\n", cl) - cl - 16));
+        if (buf.size() < bodyLen)
+            boost::asio::read(sock, buf, boost::asio::transfer_exactly(bodyLen - buf.size()));
+        std::string resp(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + bodyLen);
+        return head.substr(9, 3) + " " + resp;
+    }
+
+    // Runs on its own thread, since the gateway makes its calls on the main thread
+    void runJsonRpcTest(const FB::JSAPIPtr& api, const FB::BrowserHostPtr& host, const FB::JSObjectPtr& callback)
+    {
+        const char* cases[][2] = {
+            { "{\"jsonrpc\":\"2.0\",\"method\":\"plugin.add\",\"params\":[2,3],\"id\":1}",
+              "200 {\"jsonrpc\":\"2.0\",\"result\":5,\"id\":1}" },
+            { "{\"jsonrpc\":\"2.0\",\"method\":\"plugin.echo\",\"params\":[\"hi\\n\"],\"id\":\"e\"}",
+              "200 {\"jsonrpc\":\"2.0\",\"result\":\"hi\\n\",\"id\":\"e\"}" },
+            { "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.set\",\"params\":[\"plugin\",\"testString\",\"abc\"],\"id\":2}",
+              "200 {\"jsonrpc\":\"2.0\",\"result\":null,\"id\":2}" },
+            { "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.get\",\"params\":[\"plugin\",\"testString\"],\"id\":3}",
+              "200 {\"jsonrpc\":\"2.0\",\"result\":\"abc\",\"id\":3}" },
+            { "[{\"jsonrpc\":\"2.0\",\"method\":\"plugin.add\",\"params\":[1,1],\"id\":4},"
+              "{\"jsonrpc\":\"2.0\",\"method\":\"plugin.echo\",\"params\":[1]},"
+              "{\"jsonrpc\":\"2.0\",\"method\":\"plugin.nosuchmethod\",\"id\":5}]",
+              "200 [{\"jsonrpc\":\"2.0\",\"result\":2,\"id\":4},"
+              "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32601,\"message\":\"Method not found\"},\"id\":5}]" },
+            { "{\"jsonrpc\":\"2.0\",\"method\":\"plugin.echo\",\"params\":[1]}", "204 " },
+            { "{\"jsonrpc\":\"2.0\",\"method\":\"other.echo\",\"params\":[1],\"id\":6}",
+              "200 {\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32601,\"message\":\"Method not found\"},\"id\":6}" },
+            { "{\"jsonrpc\":", "200 {\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32700,\"message\":\"Parse error\"},\"id\":null}" },
+        };
+
+        FB::VariantMap failures;
+        boost::shared_ptr<HTTP::HTTPService> svc;
+        try {
+            svc = HTTP::HTTPService::create("127.0.0.1", 0);
+            HTTP::JsonRpcGatewayPtr gateway(HTTP::JsonRpcGateway::create(svc));
+            gateway->require_signature = false;
+            gateway->publish("plugin", api, host);
+
+            for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+                std::string resp(postJsonRpc(svc->getBaseUri(), cases[i][0]));
+                if (resp != cases[i][1])
+                    failures[cases[i][0]] = resp;
+            }
+        } catch (const std::exception& e) {
+            failures["exception"] = std::string(e.what());
+        }
+        if (svc)
+            svc->terminate();
+        callback->InvokeAsync("", FB::variant_list_of(failures.empty())(failures));
+    }
+}
+
+void FBTestPluginAPI::testJsonRpc(const FB::JSObjectPtr& callback)
+{
+    boost::thread(boost::bind(&runJsonRpcTest, shared_from_this(), m_host, callback));
+}
@@ -98,6 +98,10 @@ public:
 
 	void ping(const int seq, const FB::JSObjectPtr& callback);
 
+    // Drives this object through an HTTP::JsonRpcGateway on a loopback HTTPService; calls
+    // callback(passed, failures) when done
+    void testJsonRpc(const FB::JSObjectPtr& callback);
+
 private:
     FB::BrowserHostPtr m_host;
     SimpleMathAPIPtr m_simpleMath;
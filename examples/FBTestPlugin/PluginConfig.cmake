@@ -79,3 +79,5 @@ set (FBMAC_USE_COREANIMATION             0)
 set (FBMAC_USE_INVALIDATINGCOREANIMATION 0)
 
 add_firebreath_library(log4cplus)
+add_firebreath_library(jsoncpp)
+add_firebreath_library(HttpService)
@@ -31,7 +31,9 @@ ThreadRunnerAPI::ThreadRunnerAPI(const FB::BrowserHostPtr& host, const FBTestPlu
 
 void ThreadRunnerAPI::threadRun()
 {
-    while (!boost::this_thread::interruption_requested())
+    // Canceled as soon as the plugin starts shutting down
+    FB::CancellationTokenPtr token(m_host->getCancellationToken());
+    while (!boost::this_thread::interruption_requested() && !token->isCanceled())
     {
         m_host->htmlLog("Thread Dialog iteration start");
 
@@ -72,6 +74,11 @@ void ThreadRunnerAPI::threadRun()
             FBLOG_WARN("ThreadRunner", "Beginning request of " << val.first);
             FB::HttpStreamResponsePtr ret = FB::SimpleStreamHelper::SynchronousPost(m_host,
                 FB::URI::fromString(val.first), "");
+            if (!ret) {
+                // Failed, or the plugin is shutting down
+                FBLOG_WARN("ThreadRunner", "Request of " << val.first << " failed");
+                continue;
+            }
             FBLOG_WARN("ThreadRunner", "Finished request of " << val.first << " and got " << ret->success);
             FB::VariantMap outHeaders;
             for (FB::HeaderMap::const_iterator it = ret->headers.begin(); it != ret->headers.end(); ++it) {
@@ -91,7 +98,7 @@ void ThreadRunnerAPI::threadRun()
             }
         }
 
-        boost::this_thread::sleep(boost::posix_time::seconds(1));
+        token->waitFor(1000);
     }
 }
 
@@ -270,6 +270,20 @@ void ActiveXBrowserHost::getComVariant(VARIANT *dest, const FB::variant &var)
     outVar.Detach(dest);
 }
 
+FB::variant ActiveXBrowserHost::getHostValue(const FB::variant &var)
+{
+    if (!var.is_of_type<FB::VariantList>() && !var.is_of_type<FB::VariantMap>())
+        return var;
+
+    CComVariant comVar;
+    getComVariant(&comVar, var);
+    FB::variant retVal(getVariant(&comVar));
+    // Every read would share the object, so only hand it out if the page can't change it
+    if (!retVal.is_of_type<FB::JSObjectPtr>() || !freezeJSObject(retVal.cast<FB::JSObjectPtr>(), var))
+        return var;
+    return retVal;
+}
+
 FB::BrowserStreamPtr FB::ActiveX::ActiveXBrowserHost::_createStream( const BrowserStreamRequest& req ) const
 {
     assertMainThread();
@@ -280,6 +294,9 @@ FB::BrowserStreamPtr FB::ActiveX::ActiveXBrowserHost::_createStream( const Brows
     } else {
         stream = boost::make_shared<ActiveXStream>(url, req.cache, req.seekable, req.internalBufferSize);
     }
+    for (std::vector<PluginEventSinkPtr>::const_iterator it = req.getObservers().begin(); it != req.getObservers().end(); ++it) {
+        stream->AttachObserver( *it );
+    }
     if (req.getEventSink()) {
         stream->AttachObserver( req.getEventSink() );
     }
@@ -98,6 +98,11 @@ namespace FB {
         public:
             FB::variant getVariant(const VARIANT *cVar);
             void getComVariant(VARIANT *dest, const FB::variant &var);
+            // Converts lists and maps into the JS objects getComVariant would make for them, frozen, so
+            // a cached property value can be handed out again without building a new object each time;
+            // anything else, or anything the page can't freeze, is returned as it is (see
+            // FB::JSAPI::GetPropertyForHost)
+            FB::variant getHostValue(const FB::variant &var);
             void deferred_release( const IDispatchWRef& obj ) const;
             void DoDeferredRelease() const;
             void ReleaseAllHeldObjects();
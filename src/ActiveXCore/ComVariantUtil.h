@@ -86,6 +86,7 @@ namespace FB { namespace ActiveX
         
         tdm.insert(makeBuilderEntry<std::string>());
         tdm.insert(makeBuilderEntry<std::wstring>());
+        tdm.insert(makeBuilderEntry<FB::SharedString>());
         
         tdm.insert(makeBuilderEntry<FB::VariantList>());
         tdm.insert(makeBuilderEntry<FB::VariantMap>());
@@ -164,6 +165,14 @@ namespace FB { namespace ActiveX
         return bStr;
     }
     
+    template<> inline
+    CComVariant makeComVariant<FB::SharedString>(const ActiveXBrowserHostPtr& host, const FB::variant& var)
+    {
+        std::wstring wstr = var.convert_cast<std::wstring>();
+        CComBSTR bStr(wstr.c_str());
+        return bStr;
+    }
+
     template<> inline
     CComVariant makeComVariant<FB::VariantList>(const ActiveXBrowserHostPtr& host, const FB::variant& var)
     {
@@ -474,6 +474,7 @@ namespace FB {
         void CFBControl<pFbCLSID, pMT,ICurObjInterface,piid,plibid>::clientSiteSet()
         {
             m_host = ActiveXBrowserHostPtr(new ActiveXBrowserHost(m_webBrowser, m_spClientSite));
+            m_host->capturePageOrigin();
             pluginMain->SetHost(FB::ptr_cast<FB::BrowserHost>(m_host));
         }
 
@@ -27,6 +27,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "IDispatchAPI.h"
 #include "dispex.h"
 #include <map>
+#include <boost/bind.hpp>
 #include "logging.h"
 #include <mshtmdid.h>
 
@@ -526,7 +527,8 @@ namespace FB { namespace ActiveX {
                 if(!pvarRes)
                     return E_INVALIDARG;
 
-                FB::variant rVal = api->GetProperty(wsName);
+                FB::variant rVal = api->GetPropertyForHost(FB::wstring_to_utf8(wsName), host,
+                    boost::bind(&ActiveXBrowserHost::getHostValue, host.get(), _1));
 
                 host->getComVariant(pvarRes, rVal);
 
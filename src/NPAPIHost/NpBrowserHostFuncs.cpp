@@ -44,7 +44,10 @@ NPError NP_LOADDS NPN_GetURLNotify(NPP instance, const char* url, const char* wi
 /* NPN_PostUrlNotify */
 NPError NP_LOADDS NpapiHost::NH_PostURLNotify(NPP instance, const char* url, const char* window, uint32_t len, const char* buf, NPBool file, void* notifyData)
 {
-    return NPERR_INVALID_PARAM;
+    if (!instance || !instance->ndata || !url)
+        return NPERR_INVALID_PARAM;
+    static_cast<NpapiHost*>(instance->ndata)->m_urlRequests.push_back(URLRequest(url, "POST", notifyData));
+    return NPERR_NO_ERROR;
 }
 
 /* NPN_GetUrl */
@@ -55,7 +58,10 @@ NPError NP_LOADDS NpapiHost::NH_GetURL(NPP instance, const char* url, const char
 
 NPError NP_LOADDS NpapiHost::NH_GetURLNotify(NPP instance, const char* url, const char* window, void* notifyData)
 {
-    return NPERR_INVALID_PARAM;
+    if (!instance || !instance->ndata || !url)
+        return NPERR_INVALID_PARAM;
+    static_cast<NpapiHost*>(instance->ndata)->m_urlRequests.push_back(URLRequest(url, "GET", notifyData));
+    return NPERR_NO_ERROR;
 }
 
 /* NPN_PostUrl */
@@ -134,6 +140,14 @@ void NP_LOADDS NpapiHost::NH_PopPopupsEnabledState(NPP npp)
 /* NPN_PluginThreadAsyncCall */
 void NP_LOADDS NpapiHost::NH_PluginThreadAsyncCall(NPP instance, void (*func)(void *), void *userData)
 {
+    NpapiHost* host = instance ? static_cast<NpapiHost*>(instance->ndata) : NULL;
+    if (host) {
+        boost::mutex::scoped_lock _l(host->m_asyncMutex);
+        if (host->m_queueAsyncCalls) {
+            host->m_asyncCalls.push_back(std::make_pair(func, userData));
+            return;
+        }
+    }
     func(userData);
 }
 
@@ -173,3 +187,50 @@ NPError	NP_LOADDS NpapiHost::NH_FinalizeAsyncSurface(NPP instance, NPAsyncSurfac
 /* NPN_SetCurrentAsyncSurface */
 void NP_LOADDS NpapiHost::NH_SetCurrentAsyncSurface(NPP instance, NPAsyncSurface *surface, NPRect *changed) {
 }
+
+namespace {
+    // Copies str into memory from NPN_MemAlloc, as the plugin will free it with NPN_MemFree
+    char* copyForPlugin(const std::string& str, uint32_t* len)
+    {
+        char* res = static_cast<char*>(NpapiHost::NH_MemAlloc(static_cast<uint32_t>(str.size() + 1)));
+        memcpy(res, str.c_str(), str.size() + 1);
+        *len = static_cast<uint32_t>(str.size());
+        return res;
+    }
+}
+
+/* NPN_GetValueForURL */
+NPError NP_LOADDS NpapiHost::NH_GetValueForURL(NPP instance, NPNURLVariable variable, const char *url,
+                                               char **value, uint32_t *len)
+{
+    if (!instance || !instance->ndata || !url || !value || !len)
+        return NPERR_INVALID_PARAM;
+    NpapiHost* host = static_cast<NpapiHost*>(instance->ndata);
+    boost::mutex::scoped_lock _l(host->m_urlValuesMutex);
+    ++host->m_valueForURLCount;
+    std::map<std::pair<int, std::string>, std::string>::const_iterator it =
+        host->m_urlValues.find(std::make_pair(static_cast<int>(variable), std::string(url)));
+    if (it == host->m_urlValues.end())
+        return NPERR_GENERIC_ERROR;
+    *value = copyForPlugin(it->second, len);
+    return NPERR_NO_ERROR;
+}
+
+/* NPN_GetAuthenticationInfo */
+NPError NP_LOADDS NpapiHost::NH_GetAuthenticationInfo(NPP instance, const char *protocol, const char *host,
+                                                      int32_t port, const char *scheme, const char *realm,
+                                                      char **username, uint32_t *ulen, char **password,
+                                                      uint32_t *plen)
+{
+    if (!instance || !instance->ndata || !protocol || !host || !scheme || !realm)
+        return NPERR_INVALID_PARAM;
+    NpapiHost* self = static_cast<NpapiHost*>(instance->ndata);
+    boost::mutex::scoped_lock _l(self->m_urlValuesMutex);
+    std::map<std::string, std::pair<std::string, std::string> >::const_iterator it =
+        self->m_authInfo.find(authInfoKey(protocol, host, port, scheme, realm));
+    if (it == self->m_authInfo.end())
+        return NPERR_GENERIC_ERROR;
+    *username = copyForPlugin(it->second.first, ulen);
+    *password = copyForPlugin(it->second.second, plen);
+    return NPERR_NO_ERROR;
+}
@@ -13,6 +13,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 \**********************************************************/
 
 
+#include <boost/lexical_cast.hpp>
 #include "NpapiHost.h"
 
 using namespace FB::Npapi;
@@ -20,13 +21,13 @@ using namespace FB::Npapi;
 FB::TypeIDMap<NPIdentifier> NpapiHost::m_idMapper((NPIdentifier)100);
 
 NpapiHost::NpapiHost(NPInitFuncPtr initPtr, NPShutdownFuncPtr shutdownPtr, NPGetEntryPointsFuncPtr getepPtr)
-    : init(initPtr), shutdown(shutdownPtr), getEntryPoints(getepPtr)
+    : m_queueAsyncCalls(false), m_valueForURLCount(0), init(initPtr), shutdown(shutdownPtr), getEntryPoints(getepPtr)
 {
     memset(&m_funcs, 0, sizeof(NPNetscapeFuncs));
     memset(&m_instance, 0, sizeof(NPP_t));
 
     m_funcs.size = sizeof(NPNetscapeFuncs);
-    m_funcs.version = 1;    // TODO: Set this to the firefox 3 version value
+    m_funcs.version = NP_VERSION_MINOR;
     m_funcs.geturl = &NpapiHost::NH_GetURL;
     m_funcs.posturl = &NpapiHost::NH_PostURL;
     m_funcs.requestread = &NpapiHost::NH_RequestRead;
@@ -75,6 +76,8 @@ NpapiHost::NpapiHost(NPInitFuncPtr initPtr, NPShutdownFuncPtr shutdownPtr, NPGet
     m_funcs.initasyncsurface = &NpapiHost::NH_InitAsyncSurface;
     m_funcs.finalizeasyncsurface = &NpapiHost::NH_FinalizeAsyncSurface;
     m_funcs.setcurrentasyncsurface = &NpapiHost::NH_SetCurrentAsyncSurface;
+    m_funcs.getvalueforurl = &NpapiHost::NH_GetValueForURL;
+    m_funcs.getauthenticationinfo = &NpapiHost::NH_GetAuthenticationInfo;
 
     m_instance.ndata = this;
 }
@@ -93,3 +96,51 @@ NPP NpapiHost::getPluginInstance()
     return &m_instance;
 }
 
+void NpapiHost::setQueueAsyncCalls(bool queue)
+{
+    boost::mutex::scoped_lock _l(m_asyncMutex);
+    m_queueAsyncCalls = queue;
+}
+
+size_t NpapiHost::runAsyncCalls()
+{
+    std::vector<std::pair<void (*)(void *), void *> > calls;
+    {
+        boost::mutex::scoped_lock _l(m_asyncMutex);
+        calls.swap(m_asyncCalls);
+    }
+    for (size_t i = 0; i < calls.size(); ++i)
+        calls[i].first(calls[i].second);
+    return calls.size();
+}
+
+size_t NpapiHost::getQueuedAsyncCallCount() const
+{
+    boost::mutex::scoped_lock _l(m_asyncMutex);
+    return m_asyncCalls.size();
+}
+
+void NpapiHost::setValueForURL(NPNURLVariable variable, const std::string& url, const std::string& value)
+{
+    boost::mutex::scoped_lock _l(m_urlValuesMutex);
+    m_urlValues[std::make_pair(static_cast<int>(variable), url)] = value;
+}
+
+void NpapiHost::setAuthenticationInfo(const std::string& protocol, const std::string& host, int32_t port,
+    const std::string& scheme, const std::string& realm, const std::string& username, const std::string& password)
+{
+    boost::mutex::scoped_lock _l(m_urlValuesMutex);
+    m_authInfo[authInfoKey(protocol, host, port, scheme, realm)] = std::make_pair(username, password);
+}
+
+std::string NpapiHost::authInfoKey(const std::string& protocol, const std::string& host, int32_t port,
+    const std::string& scheme, const std::string& realm)
+{
+    return protocol + "://" + host + ":" + boost::lexical_cast<std::string>(port) + " " + scheme + " " + realm;
+}
+
+size_t NpapiHost::getValueForURLCount() const
+{
+    boost::mutex::scoped_lock _l(m_urlValuesMutex);
+    return m_valueForURLCount;
+}
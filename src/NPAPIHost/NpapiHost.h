@@ -26,6 +26,10 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #ifndef H_NPAPIHOST
 #define H_NPAPIHOST
 
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
 #include "NpapiTypes.h"
 #include "npruntime.h"
 #include "NpapiTypes.h"
@@ -43,8 +47,50 @@ namespace FB { namespace Npapi {
         NPNetscapeFuncs *getBrowserFuncs();
         NPP getPluginInstance();
 
+        // A URL request made by the plugin through NPN_GetURLNotify or NPN_PostURLNotify
+        struct URLRequest
+        {
+            URLRequest(const std::string& url, const std::string& method, void* notifyData)
+                : url(url), method(method), notifyData(notifyData) { }
+            std::string url;
+            std::string method;
+            void* notifyData;
+        };
+        // The URL requests made so far, oldest first; the host never completes them on its own
+        const std::vector<URLRequest>& getURLRequests() const { return m_urlRequests; }
+        void clearURLRequests() { m_urlRequests.clear(); }
+
+        // By default NPN_PluginThreadAsyncCall makes the call at once, on the calling thread; when
+        // queued the calls wait until runAsyncCalls() is called, like a browser whose main thread is busy
+        void setQueueAsyncCalls(bool queue);
+        // Makes the queued calls, oldest first; returns how many there were
+        size_t runAsyncCalls();
+        size_t getQueuedAsyncCallCount() const;
+
+        // The value NPN_GetValueForURL gives for url (a cookie string, or a proxy like
+        // "PROXY host:port"); urls with nothing set get an error.  Can be changed at any time, like
+        // the browser's cookie jar
+        void setValueForURL(NPNURLVariable variable, const std::string& url, const std::string& value);
+        // The credentials NPN_GetAuthenticationInfo gives for the server, scheme and realm
+        void setAuthenticationInfo(const std::string& protocol, const std::string& host, int32_t port,
+            const std::string& scheme, const std::string& realm, const std::string& username,
+            const std::string& password);
+        // How many times NPN_GetValueForURL has been called
+        size_t getValueForURLCount() const;
+
     protected:
+        static std::string authInfoKey(const std::string& protocol, const std::string& host, int32_t port,
+            const std::string& scheme, const std::string& realm);
+
         NPP_t m_instance;
+        std::vector<URLRequest> m_urlRequests;
+        bool m_queueAsyncCalls;
+        std::vector<std::pair<void (*)(void *), void *> > m_asyncCalls;
+        mutable boost::mutex m_asyncMutex;
+        std::map<std::pair<int, std::string>, std::string> m_urlValues;
+        std::map<std::string, std::pair<std::string, std::string> > m_authInfo;
+        size_t m_valueForURLCount;
+        mutable boost::mutex m_urlValuesMutex;
         NPNetscapeFuncs m_funcs;
         static FB::TypeIDMap<NPIdentifier> m_idMapper;
 
@@ -95,6 +141,12 @@ namespace FB { namespace Npapi {
         static NPError  NP_LOADDS NH_InitAsyncSurface(NPP instance, NPSize *size, NPImageFormat format, void *initData, NPAsyncSurface *surface);
         static NPError  NP_LOADDS NH_FinalizeAsyncSurface(NPP instance, NPAsyncSurface *surface);
         static void     NP_LOADDS NH_SetCurrentAsyncSurface(NPP instance, NPAsyncSurface *surface, NPRect *changed);
+        static NPError  NP_LOADDS NH_GetValueForURL(NPP instance, NPNURLVariable variable, const char *url,
+                                                    char **value, uint32_t *len);
+        static NPError  NP_LOADDS NH_GetAuthenticationInfo(NPP instance, const char *protocol, const char *host,
+                                                           int32_t port, const char *scheme, const char *realm,
+                                                           char **username, uint32_t *ulen, char **password,
+                                                           uint32_t *plen);
 
     public:
         // NpResourceHostFuncs
@@ -0,0 +1,625 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstring>
+#include <boost/lexical_cast.hpp>
+#include "NpapiSessionRecorder.h"
+#include "SessionReplayer.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    std::string describe(const CaptureRecord& record)
+    {
+        std::string str("#" + boost::lexical_cast<std::string>(record.sequence) + " " + record.getSite());
+        if (record.target && !isBrowserCall(record.kind) && record.kind >= Capture_HasMethod)
+            str += " on plugin object #" + boost::lexical_cast<std::string>(record.target);
+        return str;
+    }
+
+    boost::int32_t getIntArg(const CaptureRecord& record, size_t index)
+    {
+        return index < record.args.size() ? record.args[index].intValue : 0;
+    }
+}
+
+NPClass SessionReplayer::ReplayObjectClass = {
+    NP_CLASS_STRUCT_VERSION_CTOR,
+    SessionReplayer::RO_Allocate,
+    SessionReplayer::RO_Deallocate,
+    SessionReplayer::RO_Invalidate,
+    SessionReplayer::RO_HasMethod,
+    SessionReplayer::RO_Invoke,
+    SessionReplayer::RO_InvokeDefault,
+    SessionReplayer::RO_HasProperty,
+    SessionReplayer::RO_GetProperty,
+    SessionReplayer::RO_SetProperty,
+    SessionReplayer::RO_RemoveProperty,
+    SessionReplayer::RO_Enumerate,
+    SessionReplayer::RO_Construct
+};
+
+SessionReplayer::SessionReplayer(const SessionCapture& capture)
+    : NpapiHost(NULL, NULL, NULL), m_capture(capture)
+{
+    memset(&m_plugin, 0, sizeof(NPPluginFuncs));
+    m_funcs.getvalue = &SessionReplayer::RH_GetValue;
+    m_funcs.geturlnotify = &SessionReplayer::RH_GetURLNotify;
+    m_funcs.posturlnotify = &SessionReplayer::RH_PostURLNotify;
+    m_funcs.evaluate = &SessionReplayer::RH_Evaluate;
+
+    // Works out what each call was made inside of.  Calls the browser made on the plugin are
+    // replayed at the top level, or while answering the browser call they were made inside of;
+    // those made inside of another call on the plugin were the plugin's doing, and will happen again
+    const std::vector<CaptureRecord>& records(m_capture.records);
+    std::vector<size_t> stack;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const CaptureRecord& record(records[i]);
+        while (stack.size() > record.depth)
+            stack.pop_back();
+        if (isBrowserCall(record.kind)) {
+            m_answers[makeKey(record.kind, record.kind == Capture_BrowserGetURL ? 0 : record.target, record.member)].push_back(i);
+        } else if (isReplayedCall(record.kind)) {
+            if (record.depth == 0)
+                m_topLevel.push_back(i);
+            else if (stack.size() == record.depth && isBrowserCall(records[stack.back()].kind))
+                m_nested[stack.back()].push_back(i);
+        }
+        // A call whose parent was cut off the end of the capture has nothing to be nested in
+        if (stack.size() == record.depth)
+            stack.push_back(i);
+    }
+}
+
+SessionReplayer::~SessionReplayer()
+{
+    releaseObjects();
+}
+
+SessionReport SessionReplayer::replay(const NPPluginFuncs& pluginFuncs)
+{
+    m_plugin = pluginFuncs;
+    SessionRecorder::start();
+    SessionCapture replayed;
+    try {
+        for (std::vector<size_t>::const_iterator it = m_topLevel.begin(); it != m_topLevel.end(); ++it)
+            play(*it);
+        // The capture may have been stopped before the page went away
+        if (m_instance.pdata && m_plugin.destroy)
+            m_plugin.destroy(&m_instance, NULL);
+    } catch (...) {
+        SessionRecorder::stop();
+        releaseObjects();
+        throw;
+    }
+    replayed = SessionRecorder::stop();
+    releaseObjects();
+
+    SessionReport report(SessionReport::compare(m_capture, replayed));
+    report.mismatches = m_mismatches;
+    return report;
+}
+
+SessionReplayer::AnswerKey SessionReplayer::makeKey(CaptureKind kind, boost::uint32_t target, const CapturedValue& member)
+{
+    return std::make_pair(static_cast<int>(kind), std::make_pair(target, member.toString()));
+}
+
+void SessionReplayer::play(size_t index)
+{
+    const CaptureRecord& record(m_capture.records[index]);
+    switch (record.kind) {
+    case Capture_New: {
+        std::string mimetype(record.member.stringValue);
+        std::vector<char*> argn, argv;
+        for (size_t i = 0; i + 1 < record.args.size(); i += 2) {
+            argn.push_back(const_cast<char*>(record.args[i].stringValue.c_str()));
+            argv.push_back(record.args[i + 1].type == CapturedValue::String
+                ? const_cast<char*>(record.args[i + 1].stringValue.c_str()) : NULL);
+        }
+        NPError err = m_plugin.newp(const_cast<char*>(mimetype.c_str()), &m_instance, NP_EMBED, static_cast<int16_t>(argn.size()),
+            argn.empty() ? NULL : &argn[0], argv.empty() ? NULL : &argv[0], NULL);
+        check(record, err);
+        break; }
+    case Capture_Destroy:
+        check(record, m_plugin.destroy(&m_instance, NULL));
+        break;
+    case Capture_SetWindow: {
+        // Replayed without a native window
+        NPWindow window;
+        memset(&window, 0, sizeof(NPWindow));
+        window.x = getIntArg(record, 0);
+        window.y = getIntArg(record, 1);
+        window.width = getIntArg(record, 2);
+        window.height = getIntArg(record, 3);
+        window.type = static_cast<NPWindowType>(getIntArg(record, 4));
+        check(record, m_plugin.setwindow(&m_instance, &window));
+        break; }
+    case Capture_NewStream: {
+        ReplayStreamPtr stream(new ReplayStream());
+        memset(&stream->stream, 0, sizeof(NPStream));
+        stream->url = record.member.stringValue;
+        stream->stream.ndata = this;
+        stream->stream.url = stream->url.c_str();
+        stream->stream.end = getIntArg(record, 0);
+        stream->stream.lastmodified = getIntArg(record, 1);
+        if (record.args.size() > 2 && record.args[2].type == CapturedValue::String) {
+            stream->headers = record.args[2].stringValue;
+            stream->stream.headers = stream->headers.c_str();
+        }
+        if (boost::uint32_t request = getIntArg(record, 3)) {
+            std::map<boost::uint32_t, void*>::const_iterator it = m_requests.find(request);
+            if (it != m_requests.end())
+                stream->stream.notifyData = it->second;
+            else
+                m_mismatches.push_back(describe(record) + ": the plugin never asked for " + stream->url);
+        }
+        m_streams[record.target] = stream;
+
+        std::string mimetype(record.data);
+        uint16_t stype = NP_NORMAL;
+        NPError err = m_plugin.newstream(&m_instance, const_cast<char*>(mimetype.c_str()), &stream->stream,
+            getIntArg(record, 4) != 0, &stype);
+        check(record, err, CapturedValue(static_cast<boost::int32_t>(stype)));
+        break; }
+    case Capture_WriteReady:
+    case Capture_Write:
+    case Capture_StreamAsFile:
+    case Capture_DestroyStream: {
+        std::map<boost::uint32_t, ReplayStreamPtr>::iterator it = m_streams.find(record.target);
+        if (it == m_streams.end()) {
+            m_mismatches.push_back(describe(record) + ": the stream was never opened");
+            break;
+        }
+        NPStream* stream = &it->second->stream;
+        if (record.kind == Capture_WriteReady) {
+            check(record, m_plugin.writeready(&m_instance, stream));
+        } else if (record.kind == Capture_Write) {
+            std::vector<char> buffer(record.data.begin(), record.data.end());
+            check(record, m_plugin.write(&m_instance, stream, getIntArg(record, 0),
+                static_cast<int32_t>(buffer.size()), buffer.empty() ? NULL : &buffer[0]));
+        } else if (record.kind == Capture_StreamAsFile) {
+            m_plugin.asfile(&m_instance, stream, record.data.c_str());
+        } else {
+            check(record, m_plugin.destroystream(&m_instance, stream, static_cast<NPReason>(getIntArg(record, 0))));
+            m_streams.erase(it);
+        }
+        break; }
+    case Capture_URLNotify: {
+        void* notifyData = NULL;
+        std::map<boost::uint32_t, void*>::iterator it = m_requests.find(record.target);
+        if (it != m_requests.end()) {
+            notifyData = it->second;
+            m_requests.erase(it);
+        } else if (record.target) {
+            m_mismatches.push_back(describe(record) + ": the plugin never asked for " + record.member.stringValue);
+        }
+        m_plugin.urlnotify(&m_instance, record.member.stringValue.c_str(),
+            static_cast<NPReason>(getIntArg(record, 0)), notifyData);
+        break; }
+    case Capture_GetScriptableObject: {
+        NPObject* obj = NULL;
+        NPError err = m_plugin.getvalue(&m_instance, NPPVpluginScriptableNPObject, &obj);
+        CapturedValue result;
+        if (err == NPERR_NO_ERROR && obj) {
+            adoptPluginObject(record.result, obj);
+            NPVariant var;
+            OBJECT_TO_NPVARIANT(obj, var);
+            result = fromVariant(var);
+            NH_ReleaseObject(obj);
+        }
+        check(record, err, result);
+        break; }
+    default:
+        playObjectCall(record);
+        break;
+    }
+}
+
+void SessionReplayer::playObjectCall(const CaptureRecord& record)
+{
+    NPObject* target = getPluginObject(record.target);
+    if (!target) {
+        m_mismatches.push_back(describe(record) + ": there is no such object");
+        return;
+    }
+
+    std::vector<NPVariant> args(record.args.size());
+    if (record.kind != Capture_Enumerate) {
+        for (size_t i = 0; i < record.args.size(); ++i)
+            toVariant(record.args[i], args[i]);
+    }
+    const NPVariant* argp = args.empty() ? NULL : &args[0];
+    uint32_t argCount = static_cast<uint32_t>(args.size());
+    NPIdentifier name = toIdentifier(record.member);
+    NPVariant result;
+    VOID_TO_NPVARIANT(result);
+
+    bool ret = false;
+    switch (record.kind) {
+    case Capture_HasMethod:
+        ret = NH_HasMethod(&m_instance, target, name);
+        break;
+    case Capture_Invoke:
+        ret = NH_Invoke(&m_instance, target, name, argp, argCount, &result);
+        break;
+    case Capture_InvokeDefault:
+        ret = NH_InvokeDefault(&m_instance, target, argp, argCount, &result);
+        break;
+    case Capture_HasProperty:
+        ret = NH_HasProperty(&m_instance, target, name);
+        break;
+    case Capture_GetProperty:
+        ret = NH_GetProperty(&m_instance, target, name, &result);
+        break;
+    case Capture_SetProperty: {
+        NPVariant value;
+        VOID_TO_NPVARIANT(value);
+        ret = NH_SetProperty(&m_instance, target, name, argp ? argp : &value);
+        break; }
+    case Capture_RemoveProperty:
+        ret = NH_RemoveProperty(&m_instance, target, name);
+        break;
+    case Capture_Construct:
+        ret = NH_Construct(&m_instance, target, argp, argCount, &result);
+        break;
+    case Capture_Enumerate: {
+        NPIdentifier* names = NULL;
+        uint32_t count = 0;
+        ret = NH_Enumerate(&m_instance, target, &names, &count);
+        std::vector<CapturedValue> found;
+        for (uint32_t i = 0; ret && i < count; ++i)
+            found.push_back(fromIdentifier(names[i]));
+        if (names)
+            NH_MemFree(names);
+        if (ret && record.status && found != record.args)
+            m_mismatches.push_back(describe(record) + ": returned different names than recorded");
+        break; }
+    default:
+        break;
+    }
+
+    if (record.kind != Capture_Enumerate) {
+        for (size_t i = 0; i < args.size(); ++i)
+            NH_ReleaseVariantValue(&args[i]);
+    }
+    if (ret && result.type == NPVariantType_Object)
+        adoptPluginObject(record.result, result.value.objectValue);
+    check(record, ret ? 1 : 0, ret ? fromVariant(result) : CapturedValue());
+    if (ret)
+        NH_ReleaseVariantValue(&result);
+}
+
+void SessionReplayer::playNested(size_t index)
+{
+    std::map<size_t, std::vector<size_t> >::const_iterator it = m_nested.find(index);
+    if (it == m_nested.end())
+        return;
+    for (std::vector<size_t>::const_iterator call = it->second.begin(); call != it->second.end(); ++call)
+        play(*call);
+}
+
+const CaptureRecord* SessionReplayer::nextAnswer(CaptureKind kind, boost::uint32_t target, const CapturedValue& member)
+{
+    std::map<AnswerKey, std::deque<size_t> >::iterator it = m_answers.find(makeKey(kind, target, member));
+    if (it == m_answers.end() || it->second.empty()) {
+        std::string call(getCaptureKindName(kind));
+        if (member.type != CapturedValue::Void)
+            call += " " + member.toString();
+        if (target)
+            call += " on browser object #" + boost::lexical_cast<std::string>(target);
+        m_mismatches.push_back(call + ": the plugin made this call more times than were recorded");
+        return NULL;
+    }
+    size_t index = it->second.front();
+    it->second.pop_front();
+    return &m_capture.records[index];
+}
+
+bool SessionReplayer::answer(CaptureKind kind, ReplayObject* obj, const CapturedValue& member, NPVariant* result)
+{
+    if (result)
+        VOID_TO_NPVARIANT(*result);
+    const CaptureRecord* record = nextAnswer(kind, obj ? obj->id : 0, member);
+    if (!record)
+        return false;
+    playNested(record - &m_capture.records[0]);
+    if (result && record->status)
+        toVariant(record->result, *result);
+    return record->status != 0;
+}
+
+NPObject* SessionReplayer::getPluginObject(boost::uint32_t id)
+{
+    std::map<boost::uint32_t, NPObject*>::const_iterator it = m_pluginObjects.find(id);
+    return it != m_pluginObjects.end() ? it->second : NULL;
+}
+
+NPObject* SessionReplayer::getBrowserObject(boost::uint32_t id)
+{
+    std::map<boost::uint32_t, ReplayObject*>::const_iterator it = m_browserObjects.find(id);
+    if (it != m_browserObjects.end())
+        return it->second;
+    ReplayObject* obj = static_cast<ReplayObject*>(NH_CreateObject(&m_instance, &ReplayObjectClass));
+    obj->replayer = this;
+    obj->id = id;
+    m_browserObjects[id] = obj;
+    return obj;
+}
+
+void SessionReplayer::adoptPluginObject(const CapturedValue& recorded, NPObject* obj)
+{
+    // The plugin's objects get the ids they had when recorded as they are returned
+    if (recorded.type != CapturedValue::PluginObject || !obj || obj->_class == &ReplayObjectClass)
+        return;
+    if (m_pluginObjects.count(recorded.objectId) || m_pluginObjectIds.count(obj))
+        return;
+    m_pluginObjects[recorded.objectId] = NH_RetainObject(obj);
+    m_pluginObjectIds[obj] = recorded.objectId;
+}
+
+void SessionReplayer::toVariant(const CapturedValue& value, NPVariant& variant)
+{
+    switch (value.type) {
+    case CapturedValue::Null:
+        NULL_TO_NPVARIANT(variant);
+        break;
+    case CapturedValue::Bool:
+        BOOLEAN_TO_NPVARIANT(value.intValue != 0, variant);
+        break;
+    case CapturedValue::Int32:
+        INT32_TO_NPVARIANT(value.intValue, variant);
+        break;
+    case CapturedValue::Double:
+        DOUBLE_TO_NPVARIANT(value.doubleValue, variant);
+        break;
+    case CapturedValue::String: {
+        NPUTF8* str = static_cast<NPUTF8*>(NH_MemAlloc(static_cast<uint32_t>(value.stringValue.size() + 1)));
+        memcpy(str, value.stringValue.c_str(), value.stringValue.size() + 1);
+        variant.type = NPVariantType_String;
+        variant.value.stringValue.UTF8Characters = str;
+        variant.value.stringValue.UTF8Length = static_cast<uint32_t>(value.stringValue.size());
+        break; }
+    case CapturedValue::PluginObject:
+        if (NPObject* obj = getPluginObject(value.objectId)) {
+            OBJECT_TO_NPVARIANT(NH_RetainObject(obj), variant);
+        } else {
+            m_mismatches.push_back(value.toString() + " was used before the plugin returned it");
+            NULL_TO_NPVARIANT(variant);
+        }
+        break;
+    case CapturedValue::BrowserObject:
+        OBJECT_TO_NPVARIANT(NH_RetainObject(getBrowserObject(value.objectId)), variant);
+        break;
+    default:
+        VOID_TO_NPVARIANT(variant);
+        break;
+    }
+}
+
+CapturedValue SessionReplayer::fromVariant(const NPVariant& variant)
+{
+    switch (variant.type) {
+    case NPVariantType_Null:
+        return CapturedValue::null();
+    case NPVariantType_Bool:
+        return CapturedValue::boolean(variant.value.boolValue);
+    case NPVariantType_Int32:
+        return CapturedValue(variant.value.intValue);
+    case NPVariantType_Double:
+        return CapturedValue::number(variant.value.doubleValue);
+    case NPVariantType_String:
+        return CapturedValue(std::string(variant.value.stringValue.UTF8Characters, variant.value.stringValue.UTF8Length));
+    case NPVariantType_Object: {
+        NPObject* obj = variant.value.objectValue;
+        if (obj->_class == &ReplayObjectClass)
+            return CapturedValue::object(CapturedValue::BrowserObject, static_cast<ReplayObject*>(obj)->id);
+        std::map<NPObject*, boost::uint32_t>::const_iterator it = m_pluginObjectIds.find(obj);
+        return CapturedValue::object(CapturedValue::PluginObject, it != m_pluginObjectIds.end() ? it->second : 0); }
+    default:
+        return CapturedValue();
+    }
+}
+
+CapturedValue SessionReplayer::fromIdentifier(NPIdentifier name)
+{
+    if (!NH_IdentifierIsString(name))
+        return CapturedValue(NH_IntFromIdentifier(name));
+    try {
+        return CapturedValue(m_idMapper.getValueForId<std::string>(name));
+    } catch (...) {
+        return CapturedValue();
+    }
+}
+
+NPIdentifier SessionReplayer::toIdentifier(const CapturedValue& member)
+{
+    if (member.type == CapturedValue::String)
+        return NH_GetStringIdentifier(member.stringValue.c_str());
+    if (member.type == CapturedValue::Int32)
+        return NH_GetIntIdentifier(member.intValue);
+    return NULL;
+}
+
+void SessionReplayer::check(const CaptureRecord& record, boost::int32_t status, const CapturedValue& result)
+{
+    if (status != record.status) {
+        m_mismatches.push_back(describe(record) + ": returned " + boost::lexical_cast<std::string>(status)
+            + ", recorded " + boost::lexical_cast<std::string>(record.status));
+    } else if (result != record.result) {
+        m_mismatches.push_back(describe(record) + ": returned " + result.toString()
+            + ", recorded " + record.result.toString());
+    }
+}
+
+void SessionReplayer::releaseObjects()
+{
+    std::map<boost::uint32_t, NPObject*> pluginObjects;
+    std::map<boost::uint32_t, ReplayObject*> browserObjects;
+    pluginObjects.swap(m_pluginObjects);
+    browserObjects.swap(m_browserObjects);
+    m_pluginObjectIds.clear();
+
+    for (std::map<boost::uint32_t, NPObject*>::iterator it = pluginObjects.begin(); it != pluginObjects.end(); ++it)
+        NH_ReleaseObject(it->second);
+    for (std::map<boost::uint32_t, ReplayObject*>::iterator it = browserObjects.begin(); it != browserObjects.end(); ++it) {
+        // Anything the plugin still holds can't call back into a replayer that's gone
+        it->second->replayer = NULL;
+        NH_ReleaseObject(it->second);
+    }
+}
+
+/****************************************************************************\
+  The stand-ins for the browser's objects, and the browser functions that are
+  answered from the capture
+\****************************************************************************/
+
+NPObject* SessionReplayer::RO_Allocate(NPP npp, NPClass *aClass)
+{
+    ReplayObject* obj = new ReplayObject();
+    obj->replayer = NULL;
+    obj->id = 0;
+    return obj;
+}
+
+void SessionReplayer::RO_Deallocate(NPObject *obj)
+{
+    delete static_cast<ReplayObject*>(obj);
+}
+
+void SessionReplayer::RO_Invalidate(NPObject *obj)
+{
+}
+
+bool SessionReplayer::RO_HasMethod(NPObject *obj, NPIdentifier name)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserHasMethod, ro, fromIdentifier(name), NULL);
+}
+
+bool SessionReplayer::RO_Invoke(NPObject *obj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserInvoke, ro, fromIdentifier(name), result);
+}
+
+bool SessionReplayer::RO_InvokeDefault(NPObject *obj, const NPVariant *args, uint32_t argCount, NPVariant *result)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserInvokeDefault, ro, CapturedValue(), result);
+}
+
+bool SessionReplayer::RO_HasProperty(NPObject *obj, NPIdentifier name)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserHasProperty, ro, fromIdentifier(name), NULL);
+}
+
+bool SessionReplayer::RO_GetProperty(NPObject *obj, NPIdentifier name, NPVariant *result)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserGetProperty, ro, fromIdentifier(name), result);
+}
+
+bool SessionReplayer::RO_SetProperty(NPObject *obj, NPIdentifier name, const NPVariant *value)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserSetProperty, ro, fromIdentifier(name), NULL);
+}
+
+bool SessionReplayer::RO_RemoveProperty(NPObject *obj, NPIdentifier name)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserRemoveProperty, ro, fromIdentifier(name), NULL);
+}
+
+bool SessionReplayer::RO_Enumerate(NPObject *obj, NPIdentifier **value, uint32_t *count)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    if (!ro->replayer)
+        return false;
+    const CaptureRecord* record = ro->replayer->nextAnswer(Capture_BrowserEnumerate, ro->id, CapturedValue());
+    if (!record)
+        return false;
+    ro->replayer->playNested(record - &ro->replayer->m_capture.records[0]);
+    if (!record->status)
+        return false;
+    *count = static_cast<uint32_t>(record->args.size());
+    *value = static_cast<NPIdentifier*>(NH_MemAlloc(static_cast<uint32_t>(sizeof(NPIdentifier) * (*count ? *count : 1))));
+    for (uint32_t i = 0; i < *count; ++i)
+        (*value)[i] = toIdentifier(record->args[i]);
+    return true;
+}
+
+bool SessionReplayer::RO_Construct(NPObject *obj, const NPVariant *args, uint32_t argCount, NPVariant *result)
+{
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserConstruct, ro, CapturedValue(), result);
+}
+
+NPError SessionReplayer::RH_GetValue(NPP instance, NPNVariable variable, void *value)
+{
+    if (!instance || !instance->ndata || (variable != NPNVWindowNPObject && variable != NPNVPluginElementNPObject))
+        return NH_GetValue(instance, variable, value);
+
+    SessionReplayer* self = static_cast<SessionReplayer*>(static_cast<NpapiHost*>(instance->ndata));
+    const CaptureRecord* record = self->nextAnswer(Capture_BrowserGetValue, 0,
+        CapturedValue(static_cast<boost::int32_t>(variable)));
+    if (!record)
+        return NPERR_GENERIC_ERROR;
+    self->playNested(record - &self->m_capture.records[0]);
+    if (record->status != NPERR_NO_ERROR || record->result.type != CapturedValue::BrowserObject)
+        return record->status != NPERR_NO_ERROR ? static_cast<NPError>(record->status) : NPERR_GENERIC_ERROR;
+    *static_cast<NPObject**>(value) = NH_RetainObject(self->getBrowserObject(record->result.objectId));
+    return NPERR_NO_ERROR;
+}
+
+NPError SessionReplayer::RH_GetURLNotify(NPP instance, const char* url, const char* window, void* notifyData)
+{
+    NPError err = NH_GetURLNotify(instance, url, window, notifyData);
+    if (err != NPERR_NO_ERROR)
+        return err;
+    SessionReplayer* self = static_cast<SessionReplayer*>(static_cast<NpapiHost*>(instance->ndata));
+    const CaptureRecord* record = self->nextAnswer(Capture_BrowserGetURL, 0, CapturedValue(std::string(url)));
+    if (!record)
+        return err;
+    // Streams and notifications for the recorded request now go to this one
+    self->m_requests[record->target] = notifyData;
+    self->playNested(record - &self->m_capture.records[0]);
+    return static_cast<NPError>(record->status);
+}
+
+NPError SessionReplayer::RH_PostURLNotify(NPP instance, const char* url, const char* window, uint32_t len,
+    const char* buf, NPBool file, void* notifyData)
+{
+    NPError err = NH_PostURLNotify(instance, url, window, len, buf, file, notifyData);
+    if (err != NPERR_NO_ERROR)
+        return err;
+    SessionReplayer* self = static_cast<SessionReplayer*>(static_cast<NpapiHost*>(instance->ndata));
+    const CaptureRecord* record = self->nextAnswer(Capture_BrowserGetURL, 0, CapturedValue(std::string(url)));
+    if (!record)
+        return err;
+    self->m_requests[record->target] = notifyData;
+    self->playNested(record - &self->m_capture.records[0]);
+    return static_cast<NPError>(record->status);
+}
+
+bool SessionReplayer::RH_Evaluate(NPP npp, NPObject *obj, NPString *script, NPVariant *result)
+{
+    if (!obj || obj->_class != &ReplayObjectClass || !script)
+        return NH_Evaluate(npp, obj, script, result);
+    ReplayObject* ro = static_cast<ReplayObject*>(obj);
+    return ro->replayer && ro->replayer->answer(Capture_BrowserEvaluate, ro,
+        CapturedValue(std::string(script->UTF8Characters, script->UTF8Length)), result);
+}
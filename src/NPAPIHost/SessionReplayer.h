@@ -0,0 +1,148 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_NPAPI_SESSIONREPLAYER
+#define H_FB_NPAPI_SESSIONREPLAYER
+
+#include <map>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "NpapiHost.h"
+#include "NpapiSessionCapture.h"
+
+namespace FB { namespace Npapi {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  SessionReplayer
+    ///
+    /// @brief  A headless NpapiHost that plays a SessionCapture back against a plugin, and reports
+    ///         how long each call site took compared to when it was recorded.
+    ///
+    /// The calls the browser made on the plugin are made again, in the same order and with the same
+    /// arguments and stream data.  The browser's objects are stood in for by stubs that give the
+    /// plugin the results that were recorded for each call it makes on them; any call it makes that
+    /// wasn't recorded, and any result the plugin gives that differs from the recorded one, is
+    /// listed in SessionReport::mismatches.  Native events (NPP_HandleEvent) are not replayed.
+    ///
+    /// The replay is timed with SessionRecorder, so the plugin has to be linked into the same
+    /// process, as it is in the unit tests, and the capture must start before NPP_New.
+    ///
+    /// @code
+    ///      FB::Npapi::SessionReplayer replayer(FB::Npapi::SessionCapture::load("slow-page.fbcap"));
+    ///      NpapiPluginModule* module = NpapiPluginModule::GetModule(0);
+    ///      module->setNetscapeFuncs(replayer.getBrowserFuncs());
+    ///      NPPluginFuncs funcs;
+    ///      module->getPluginFuncs(&funcs);
+    ///      FB::Npapi::SessionReport report(replayer.replay(funcs));
+    ///      NpapiPluginModule::ReleaseModule(0);
+    /// @endcode
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class SessionReplayer : public NpapiHost
+    {
+    public:
+        SessionReplayer(const SessionCapture& capture);
+        ~SessionReplayer();
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn SessionReport SessionReplayer::replay(const NPPluginFuncs& pluginFuncs)
+        ///
+        /// @brief  Plays the capture back through pluginFuncs; the plugin must already have been
+        ///         given getBrowserFuncs().  A replayer can only be used once.
+        ///
+        /// @throws std::logic_error if SessionRecorder is already recording
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        SessionReport replay(const NPPluginFuncs& pluginFuncs);
+
+    protected:
+        // Stands in for a browser object that was recorded
+        struct ReplayObject : NPObject
+        {
+            SessionReplayer* replayer;
+            boost::uint32_t id;
+        };
+
+        struct ReplayStream
+        {
+            NPStream stream;
+            std::string url;
+            std::string headers;
+        };
+        typedef boost::shared_ptr<ReplayStream> ReplayStreamPtr;
+
+        // The kind of call, the object it was made on and the member, as a string
+        typedef std::pair<int, std::pair<boost::uint32_t, std::string> > AnswerKey;
+        static AnswerKey makeKey(CaptureKind kind, boost::uint32_t target, const CapturedValue& member);
+
+        void play(size_t index);
+        void playObjectCall(const CaptureRecord& record);
+        void playNested(size_t index);
+        const CaptureRecord* nextAnswer(CaptureKind kind, boost::uint32_t target, const CapturedValue& member);
+        bool answer(CaptureKind kind, ReplayObject* obj, const CapturedValue& member, NPVariant* result);
+
+        NPObject* getPluginObject(boost::uint32_t id);
+        NPObject* getBrowserObject(boost::uint32_t id);
+        void adoptPluginObject(const CapturedValue& recorded, NPObject* obj);
+        void toVariant(const CapturedValue& value, NPVariant& variant);
+        CapturedValue fromVariant(const NPVariant& variant);
+        static CapturedValue fromIdentifier(NPIdentifier name);
+        static NPIdentifier toIdentifier(const CapturedValue& member);
+        void check(const CaptureRecord& record, boost::int32_t status, const CapturedValue& result = CapturedValue());
+        void releaseObjects();
+
+        SessionCapture m_capture;
+        NPPluginFuncs m_plugin;
+        // Browser calls in the order they were made, for each object and member
+        std::map<AnswerKey, std::deque<size_t> > m_answers;
+        // The calls the browser made into the plugin while answering each browser call
+        std::map<size_t, std::vector<size_t> > m_nested;
+        std::vector<size_t> m_topLevel;
+        // A reference to each is held until the replay is over
+        std::map<boost::uint32_t, NPObject*> m_pluginObjects;
+        std::map<NPObject*, boost::uint32_t> m_pluginObjectIds;
+        std::map<boost::uint32_t, ReplayObject*> m_browserObjects;
+        std::map<boost::uint32_t, ReplayStreamPtr> m_streams;
+        std::map<boost::uint32_t, void*> m_requests;
+        std::vector<std::string> m_mismatches;
+
+    public:
+        static NPClass ReplayObjectClass;
+        static NPObject* NP_LOADDS RO_Allocate(NPP npp, NPClass *aClass);
+        static void NP_LOADDS RO_Deallocate(NPObject *obj);
+        static void NP_LOADDS RO_Invalidate(NPObject *obj);
+        static bool NP_LOADDS RO_HasMethod(NPObject *obj, NPIdentifier name);
+        static bool NP_LOADDS RO_Invoke(NPObject *obj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result);
+        static bool NP_LOADDS RO_InvokeDefault(NPObject *obj, const NPVariant *args, uint32_t argCount, NPVariant *result);
+        static bool NP_LOADDS RO_HasProperty(NPObject *obj, NPIdentifier name);
+        static bool NP_LOADDS RO_GetProperty(NPObject *obj, NPIdentifier name, NPVariant *result);
+        static bool NP_LOADDS RO_SetProperty(NPObject *obj, NPIdentifier name, const NPVariant *value);
+        static bool NP_LOADDS RO_RemoveProperty(NPObject *obj, NPIdentifier name);
+        static bool NP_LOADDS RO_Enumerate(NPObject *obj, NPIdentifier **value, uint32_t *count);
+        static bool NP_LOADDS RO_Construct(NPObject *obj, const NPVariant *args, uint32_t argCount, NPVariant *result);
+
+        // The browser functions answered from the capture
+        static NPError NP_LOADDS RH_GetValue(NPP instance, NPNVariable variable, void *value);
+        static NPError NP_LOADDS RH_GetURLNotify(NPP instance, const char* url, const char* window, void* notifyData);
+        static NPError NP_LOADDS RH_PostURLNotify(NPP instance, const char* url, const char* window, uint32_t len,
+            const char* buf, NPBool file, void* notifyData);
+        static bool NP_LOADDS RH_Evaluate(NPP npp, NPObject *obj, NPString *script, NPVariant *result);
+    };
+
+}; };
+
+#endif // H_FB_NPAPI_SESSIONREPLAYER
@@ -13,10 +13,12 @@ Copyright 2009 Richard Bateman, Firebreath development team
 \**********************************************************/
 
 #include <typeinfo>
+#include <boost/bind.hpp>
 #include "JSObject.h"
 
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 #include "NPJavascriptObject.h"
+#include "NpapiSessionRecorder.h"
 
 using namespace FB::Npapi;
 
@@ -209,7 +211,8 @@ bool NPJavascriptObject::GetProperty(NPIdentifier name, NPVariant *result)
             } else if (getAPI()->HasMethodObject(sName)) {
                 res = getAPI()->GetMethodObject(sName);
             } else {
-                res = getAPI()->GetProperty(sName);
+                res = getAPI()->GetPropertyForHost(sName, browser,
+                    boost::bind(&NpapiBrowserHost::getHostValue, browser.get(), _1));
             }
         } else {
             res = getAPI()->GetProperty(browser->IntFromIdentifier(name));
@@ -347,6 +350,7 @@ NPObject *NPJavascriptObject::_Allocate(NPP npp, NPClass *aClass)
 
 void NPJavascriptObject::_Deallocate(NPObject *npobj)
 {
+    SessionRecorder::forgetObject(npobj);
     delete static_cast<NPJavascriptObject *>(npobj);
 }
 
@@ -359,55 +363,86 @@ void NPJavascriptObject::_Invalidate(NPObject *npobj)
 bool NPJavascriptObject::_HasMethod(NPObject *npobj, NPIdentifier name)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->HasMethod(name);
+    SessionRecorder::Call call(Capture_HasMethod);
+    call.setTarget(npobj);
+    call.setMember(obj->m_browser, name);
+    return call.finish(obj->HasMethod(name));
 }
 
 bool NPJavascriptObject::_Invoke(NPObject *npobj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->Invoke(name, args, argCount, result);
+    SessionRecorder::Call call(Capture_Invoke);
+    call.setTarget(npobj);
+    call.setMember(obj->m_browser, name);
+    call.setArgs(args, argCount);
+    return call.finish(obj->Invoke(name, args, argCount, result), result);
 }
 
 bool NPJavascriptObject::_InvokeDefault(NPObject *npobj, const NPVariant *args, uint32_t argCount, NPVariant *result)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->InvokeDefault(args, argCount, result);
+    SessionRecorder::Call call(Capture_InvokeDefault);
+    call.setTarget(npobj);
+    call.setArgs(args, argCount);
+    return call.finish(obj->InvokeDefault(args, argCount, result), result);
 }
 
 bool NPJavascriptObject::_HasProperty(NPObject *npobj, NPIdentifier name)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->HasProperty(name);
+    SessionRecorder::Call call(Capture_HasProperty);
+    call.setTarget(npobj);
+    call.setMember(obj->m_browser, name);
+    return call.finish(obj->HasProperty(name));
 }
 
 bool NPJavascriptObject::_GetProperty(NPObject *npobj, NPIdentifier name, NPVariant *result)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->GetProperty(name, result);
+    SessionRecorder::Call call(Capture_GetProperty);
+    call.setTarget(npobj);
+    call.setMember(obj->m_browser, name);
+    return call.finish(obj->GetProperty(name, result), result);
 }
 
 bool NPJavascriptObject::_SetProperty(NPObject *npobj, NPIdentifier name, const NPVariant *value)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->SetProperty(name, value);
+    SessionRecorder::Call call(Capture_SetProperty);
+    call.setTarget(npobj);
+    call.setMember(obj->m_browser, name);
+    call.setArgs(value, 1);
+    return call.finish(obj->SetProperty(name, value));
 }
 
 bool NPJavascriptObject::_RemoveProperty(NPObject *npobj, NPIdentifier name)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->RemoveProperty(name);
+    SessionRecorder::Call call(Capture_RemoveProperty);
+    call.setTarget(npobj);
+    call.setMember(obj->m_browser, name);
+    return call.finish(obj->RemoveProperty(name));
 }
 
 bool NPJavascriptObject::_Enumeration(NPObject *npobj, NPIdentifier **value, uint32_t *count)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->Enumeration(value, count);
+    SessionRecorder::Call call(Capture_Enumerate);
+    call.setTarget(npobj);
+    bool ret = obj->Enumeration(value, count);
+    if (ret && call.isActive())
+        call.addIdentifiers(obj->m_browser.lock().get(), *value, *count);
+    return call.finish(ret);
 }
 
 bool NPJavascriptObject::_Construct(NPObject *npobj, const NPVariant *args, uint32_t argCount, NPVariant *result)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(npobj);
-    return obj->Construct(args, argCount, result);
+    SessionRecorder::Call call(Capture_Construct);
+    call.setTarget(npobj);
+    call.setArgs(args, argCount);
+    return call.finish(obj->Construct(args, argCount, result), result);
 }
 
 // This defines the "entry points"; it's how the browser knows how to create the object
@@ -19,6 +19,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "NPJavascriptObject.h"
 #include "NpapiBrowserHost.h"
 #include "logging.h"
+#include "RacePoint.h"
 #include <cassert>
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
@@ -43,9 +44,12 @@ NPObjectAPI::NPObjectAPI(NPObject *o, const NpapiBrowserHostPtr& h)
 
 NPObjectAPI::~NPObjectAPI(void)
 {
-    // Schedule the NPObject for release on the main thread
-    if (!m_browser.expired())
-        getHost()->deferred_release(obj);
+    // Schedule the NPObject for release on the main thread; the host can go away on another thread
+    // at any point, so take hold of it rather than checking first
+    NpapiBrowserHostPtr host(m_browser.lock());
+    FB_RACE_POINT("NPObjectAPI::~NPObjectAPI");
+    if (host)
+        host->deferred_release(obj);
     obj = NULL;
 }
 
@@ -101,6 +101,22 @@ namespace FB { namespace Npapi
         return npv;
     }
 
+    template<> inline
+    NPVariant makeNPVariant<FB::SharedString>(const NpapiBrowserHostPtr& host, const FB::variant& var)
+    {
+        NPVariant npv;
+
+        // The browser owns what it's given, so this is the one copy the characters get
+        FB::SharedString str = var.cast<FB::SharedString>();
+        char *outStr = (char*)host->MemAlloc(str.size() + 1);
+        memcpy(outStr, str.c_str(), str.size() + 1);
+        npv.type = NPVariantType_String;
+        npv.value.stringValue.UTF8Characters = outStr;
+        npv.value.stringValue.UTF8Length = str.size();
+
+        return npv;
+    }
+
     template<> inline
     NPVariant makeNPVariant<std::wstring>(const NpapiBrowserHostPtr& host, const FB::variant& var)
     {
@@ -31,6 +31,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
 #include "NPVariantUtil.h"
+#include "NpapiSessionRecorder.h"
 #include "URI.h"
 
 using namespace FB::Npapi;
@@ -78,6 +79,7 @@ namespace
 
         tdm.insert(makeBuilderEntry<std::string>());
         tdm.insert(makeBuilderEntry<std::wstring>());
+        tdm.insert(makeBuilderEntry<FB::SharedString>());
 
         tdm.insert(makeBuilderEntry<FB::FBNull>());
         tdm.insert(makeBuilderEntry<FB::FBVoid>());
@@ -111,6 +113,8 @@ NpapiBrowserHost::~NpapiBrowserHost(void)
 }
 
 void NpapiBrowserHost::shutdown() {
+    // Let workers know before the browser functions go away under them
+    getCancellationToken()->cancel();
     memset(&NPNFuncs, 0, sizeof(NPNetscapeFuncs));
     FB::BrowserHost::shutdown();
 
@@ -138,10 +142,15 @@ void NpapiBrowserHost::setBrowserFuncs(NPNetscapeFuncs *pFuncs)
         GetValue(NPNVWindowNPObject, (void**)&window);
         GetValue(NPNVPluginElementNPObject, (void**)&element);
 
-        m_htmlWin = NPObjectAPIPtr(new FB::Npapi::NPObjectAPI(window, ptr_cast<NpapiBrowserHost>(shared_from_this())));
-        m_htmlElement = NPObjectAPIPtr(new FB::Npapi::NPObjectAPI(element, ptr_cast<NpapiBrowserHost>(shared_from_this())));
-        ReleaseObject(window);
-        ReleaseObject(element);
+        // A headless host may not have a page to give us
+        if (window) {
+            m_htmlWin = NPObjectAPIPtr(new FB::Npapi::NPObjectAPI(window, ptr_cast<NpapiBrowserHost>(shared_from_this())));
+            ReleaseObject(window);
+        }
+        if (element) {
+            m_htmlElement = NPObjectAPIPtr(new FB::Npapi::NPObjectAPI(element, ptr_cast<NpapiBrowserHost>(shared_from_this())));
+            ReleaseObject(element);
+        }
     } catch (...) {
         if (window && !m_htmlWin)
             ReleaseObject(window);
@@ -150,6 +159,7 @@ void NpapiBrowserHost::setBrowserFuncs(NPNetscapeFuncs *pFuncs)
     }
     if (m_htmlWin) {
         m_htmlDoc = ptr_cast<NPObjectAPI>(m_htmlWin->GetProperty("document").cast<FB::JSObjectPtr>());
+        capturePageOrigin();
     }
 }
 
@@ -289,6 +299,24 @@ bool NpapiBrowserHost::isChrome() const
     return boost::algorithm::contains(agent, "Chrome");
 }
 
+FB::variant NpapiBrowserHost::getHostValue(const FB::variant &var)
+{
+    assertMainThread();
+
+    if (!var.is_of_type<FB::VariantList>() && !var.is_of_type<FB::VariantMap>())
+        return var;
+
+    NPVariant npv;
+    VOID_TO_NPVARIANT(npv);
+    getNPVariant(&npv, var);
+    FB::variant retVal(getVariant(&npv));
+    ReleaseVariantValue(&npv);
+    // Every read would share the object, so only hand it out if the page can't change it
+    if (!retVal.is_of_type<FB::JSObjectPtr>() || !freezeJSObject(retVal.cast<FB::JSObjectPtr>(), var))
+        return var;
+    return retVal;
+}
+
 void NpapiBrowserHost::getNPVariant(NPVariant *dst, const FB::variant &var)
 {
     assertMainThread();
@@ -309,7 +337,14 @@ NPError NpapiBrowserHost::GetURLNotify(const char* url, const char* target, void
 {
     assertMainThread();
     if (NPNFuncs.geturlnotify != NULL) {
-        return NPNFuncs.geturlnotify(m_npp, url, target, notifyData);
+        SessionRecorder::Call call(Capture_BrowserGetURL);
+        if (call.isActive()) {
+            call.setRequest(notifyData);
+            call.setMember(CapturedValue(std::string(url ? url : "")));
+            call.addArg(target ? CapturedValue(std::string(target)) : CapturedValue::null());
+            call.addArg(CapturedValue(std::string("GET")));
+        }
+        return call.finish(NPNFuncs.geturlnotify(m_npp, url, target, notifyData));
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -330,7 +365,15 @@ NPError NpapiBrowserHost::PostURLNotify(const char* url, const char* target, uin
 {
     assertMainThread();
     if (NPNFuncs.posturlnotify != NULL) {
-        return NPNFuncs.posturlnotify(m_npp, url, target, len, buf, file, notifyData);
+        SessionRecorder::Call call(Capture_BrowserGetURL);
+        if (call.isActive()) {
+            call.setRequest(notifyData);
+            call.setMember(CapturedValue(std::string(url ? url : "")));
+            call.addArg(target ? CapturedValue(std::string(target)) : CapturedValue::null());
+            call.addArg(CapturedValue(std::string("POST")));
+            call.setData(buf, len);
+        }
+        return call.finish(NPNFuncs.posturlnotify(m_npp, url, target, len, buf, file, notifyData));
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -446,6 +489,11 @@ std::string NpapiBrowserHost::StringFromIdentifier(NPIdentifier identifier) cons
     assertMainThread();
     return module->StringFromIdentifier(identifier);
 }
+FB::SharedString NpapiBrowserHost::SharedStringFromIdentifier(NPIdentifier identifier) const
+{
+    assertMainThread();
+    return module->SharedStringFromIdentifier(identifier);
+}
 int32_t NpapiBrowserHost::IntFromIdentifier(NPIdentifier identifier) const
 {
     assertMainThread();
@@ -475,7 +523,19 @@ NPError NpapiBrowserHost::GetValue(NPNVariable variable, void *value) const
 {
     assertMainThread();
     if (NPNFuncs.getvalue != NULL) {
-        return NPNFuncs.getvalue(m_npp, variable, value);
+        if (variable != NPNVWindowNPObject && variable != NPNVPluginElementNPObject)
+            return NPNFuncs.getvalue(m_npp, variable, value);
+
+        // Only the page's objects are recorded; the rest depend on the machine
+        SessionRecorder::Call call(Capture_BrowserGetValue);
+        call.setMember(CapturedValue(static_cast<int32_t>(variable)));
+        NPError err = NPNFuncs.getvalue(m_npp, variable, value);
+        if (err == NPERR_NO_ERROR && call.isActive() && *static_cast<NPObject**>(value)) {
+            NPVariant obj;
+            OBJECT_TO_NPVARIANT(*static_cast<NPObject**>(value), obj);
+            call.setResult(&obj);
+        }
+        return call.finish(err);
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -539,8 +599,10 @@ void NpapiBrowserHost::PopPopupsEnabledState() const
 
 void NpapiBrowserHost::PluginThreadAsyncCall(void (*func) (void *), void *userData) const
 {
-    if (NPNFuncs.pluginthreadasynccall != NULL) {
-        NPNFuncs.pluginthreadasynccall(m_npp, func, userData);
+    // Called from any thread, and shutdown() clears NPNFuncs on the main thread; read it once
+    NPN_PluginThreadAsyncCallProcPtr asyncCall(NPNFuncs.pluginthreadasynccall);
+    if (asyncCall != NULL) {
+        asyncCall(m_npp, func, userData);
     }
 }
 
@@ -560,7 +622,11 @@ bool NpapiBrowserHost::Invoke(NPObject *npobj, NPIdentifier methodName, const NP
 {
     assertMainThread();
     if (NPNFuncs.invoke != NULL) {
-        return NPNFuncs.invoke(m_npp, npobj, methodName, args, argCount, result);
+        SessionRecorder::Call call(Capture_BrowserInvoke);
+        call.setTarget(npobj);
+        call.setMember(this, methodName);
+        call.setArgs(args, argCount);
+        return call.finish(NPNFuncs.invoke(m_npp, npobj, methodName, args, argCount, result), result);
     } else {
         return false;
     }
@@ -571,7 +637,10 @@ bool NpapiBrowserHost::InvokeDefault(NPObject *npobj, const NPVariant *args,
 {
     assertMainThread();
     if (NPNFuncs.invokeDefault != NULL) {
-        return NPNFuncs.invokeDefault(m_npp, npobj, args, argCount, result);
+        SessionRecorder::Call call(Capture_BrowserInvokeDefault);
+        call.setTarget(npobj);
+        call.setArgs(args, argCount);
+        return call.finish(NPNFuncs.invokeDefault(m_npp, npobj, args, argCount, result), result);
     } else {
         return false;
     }
@@ -582,7 +651,11 @@ bool NpapiBrowserHost::Evaluate(NPObject *npobj, NPString *script,
 {
     assertMainThread();
     if (NPNFuncs.evaluate != NULL) {
-        return NPNFuncs.evaluate(m_npp, npobj, script, result);
+        SessionRecorder::Call call(Capture_BrowserEvaluate);
+        call.setTarget(npobj);
+        if (call.isActive() && script)
+            call.setMember(CapturedValue(std::string(script->UTF8Characters, script->UTF8Length)));
+        return call.finish(NPNFuncs.evaluate(m_npp, npobj, script, result), result);
     } else {
         return false;
     }
@@ -593,7 +666,10 @@ bool NpapiBrowserHost::GetProperty(NPObject *npobj, NPIdentifier propertyName,
 {
     assertMainThread();
     if (NPNFuncs.getproperty != NULL) {
-        return NPNFuncs.getproperty(m_npp, npobj, propertyName, result);
+        SessionRecorder::Call call(Capture_BrowserGetProperty);
+        call.setTarget(npobj);
+        call.setMember(this, propertyName);
+        return call.finish(NPNFuncs.getproperty(m_npp, npobj, propertyName, result), result);
     } else {
         return false;
     }
@@ -604,7 +680,11 @@ bool NpapiBrowserHost::SetProperty(NPObject *npobj, NPIdentifier propertyName,
 {
     assertMainThread();
     if (NPNFuncs.setproperty != NULL) {
-        return NPNFuncs.setproperty(m_npp, npobj, propertyName, value);
+        SessionRecorder::Call call(Capture_BrowserSetProperty);
+        call.setTarget(npobj);
+        call.setMember(this, propertyName);
+        call.setArgs(value, 1);
+        return call.finish(NPNFuncs.setproperty(m_npp, npobj, propertyName, value));
     } else {
         return false;
     }
@@ -614,7 +694,10 @@ bool NpapiBrowserHost::RemoveProperty(NPObject *npobj, NPIdentifier propertyName
 {
     assertMainThread();
     if (NPNFuncs.removeproperty != NULL) {
-        return NPNFuncs.removeproperty(m_npp, npobj, propertyName);
+        SessionRecorder::Call call(Capture_BrowserRemoveProperty);
+        call.setTarget(npobj);
+        call.setMember(this, propertyName);
+        return call.finish(NPNFuncs.removeproperty(m_npp, npobj, propertyName));
     } else {
         return false;
     }
@@ -624,7 +707,10 @@ bool NpapiBrowserHost::HasProperty(NPObject *npobj, NPIdentifier propertyName) c
 {
     assertMainThread();
     if (NPNFuncs.hasproperty != NULL) {
-        return NPNFuncs.hasproperty(m_npp, npobj, propertyName);
+        SessionRecorder::Call call(Capture_BrowserHasProperty);
+        call.setTarget(npobj);
+        call.setMember(this, propertyName);
+        return call.finish(NPNFuncs.hasproperty(m_npp, npobj, propertyName));
     } else {
         return false;
     }
@@ -634,7 +720,10 @@ bool NpapiBrowserHost::HasMethod(NPObject *npobj, NPIdentifier methodName) const
 {
     assertMainThread();
     if (NPNFuncs.hasmethod != NULL) {
-        return NPNFuncs.hasmethod(m_npp, npobj, methodName);
+        SessionRecorder::Call call(Capture_BrowserHasMethod);
+        call.setTarget(npobj);
+        call.setMember(this, methodName);
+        return call.finish(NPNFuncs.hasmethod(m_npp, npobj, methodName));
     } else {
         return false;
     }
@@ -645,7 +734,12 @@ bool NpapiBrowserHost::Enumerate(NPObject *npobj, NPIdentifier **identifier,
 {
     assertMainThread();
     if (NPNFuncs.enumerate != NULL) {
-        return NPNFuncs.enumerate(m_npp, npobj, identifier, count);
+        SessionRecorder::Call call(Capture_BrowserEnumerate);
+        call.setTarget(npobj);
+        bool ret = NPNFuncs.enumerate(m_npp, npobj, identifier, count);
+        if (ret)
+            call.addIdentifiers(this, *identifier, *count);
+        return call.finish(ret);
     } else {
         return false;
     }
@@ -656,7 +750,10 @@ bool NpapiBrowserHost::Construct(NPObject *npobj, const NPVariant *args,
 {
     assertMainThread();
     if (NPNFuncs.construct != NULL) {
-        return NPNFuncs.construct(m_npp, npobj, args, argCount, result);
+        SessionRecorder::Call call(Capture_BrowserConstruct);
+        call.setTarget(npobj);
+        call.setArgs(args, argCount);
+        return call.finish(NPNFuncs.construct(m_npp, npobj, args, argCount, result), result);
     } else {
         return false;
     }
@@ -723,6 +820,9 @@ FB::BrowserStreamPtr FB::Npapi::NpapiBrowserHost::_createStream( const BrowserSt
     assertMainThread();
     std::string url(req.uri.toString());
     NpapiStreamPtr stream( boost::make_shared<NpapiStream>( url, req.cache, req.seekable, req.internalBufferSize, FB::ptr_cast<const NpapiBrowserHost>(shared_from_this()) ) );
+    for (std::vector<PluginEventSinkPtr>::const_iterator it = req.getObservers().begin(); it != req.getObservers().end(); ++it) {
+        stream->AttachObserver( *it );
+    }
     if (req.getEventSink()) {
         stream->AttachObserver( req.getEventSink() );
     }
@@ -842,6 +942,42 @@ bool FB::Npapi::NpapiBrowserHost::DetectProxySettings( std::map<std::string, std
     }
 }
 
+bool FB::Npapi::NpapiBrowserHost::GetCookiesForURL( const std::string& url, std::string& cookies )
+{
+    char* retVal = NULL;
+    uint32_t len = 0;
+    if (GetValueForURL(NPNURLVCookie, url.c_str(), &retVal, &len) != NPERR_NO_ERROR)
+        return false;
+    cookies.assign(retVal ? retVal : "", retVal ? len : 0);
+    if (retVal)
+        MemFree(retVal);
+    return true;
+}
+
+bool FB::Npapi::NpapiBrowserHost::GetCredentialsForURL( const std::string& url, const std::string& scheme,
+    const std::string& realm, std::string& username, std::string& password )
+{
+    FB::URI uri(FB::URI::fromString(url));
+    int32_t port = uri.port;
+    if (!port)
+        port = (uri.protocol == "https") ? 443 : 80;
+
+    char* user = NULL;
+    char* pass = NULL;
+    uint32_t ulen = 0, plen = 0;
+    NPError err = GetAuthenticationInfo(uri.protocol.c_str(), uri.domain.c_str(), port, scheme.c_str(),
+        realm.c_str(), &user, &ulen, &pass, &plen);
+    if (err == NPERR_NO_ERROR) {
+        username.assign(user ? user : "", user ? ulen : 0);
+        password.assign(pass ? pass : "", pass ? plen : 0);
+    }
+    if (user)
+        MemFree(user);
+    if (pass)
+        MemFree(pass);
+    return err == NPERR_NO_ERROR && !username.empty();
+}
+
 void FB::Npapi::NpapiBrowserHost::Navigate( const std::string& url, const std::string& target )
 {
     PushPopupsEnabledState(true);
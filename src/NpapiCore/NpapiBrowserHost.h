@@ -70,6 +70,9 @@ namespace FB {
         bool isChrome() const;
 
         virtual bool DetectProxySettings(std::map<std::string, std::string>& settingsMap, const std::string& url = "");
+        virtual bool GetCookiesForURL(const std::string& url, std::string& cookies);
+        virtual bool GetCredentialsForURL(const std::string& url, const std::string& scheme,
+            const std::string& realm, std::string& username, std::string& password);
 
     public:
         void shutdown();
@@ -77,6 +80,11 @@ namespace FB {
     public:
         FB::variant getVariant(const NPVariant *npVar);
         void getNPVariant(NPVariant *dst, const FB::variant &var);
+        // Converts lists and maps into the JS objects getNPVariant would make for them, frozen, so a
+        // cached property value can be handed out again without building a new object each time;
+        // anything else, or anything the page can't freeze, is returned as it is (see
+        // FB::JSAPI::GetPropertyForHost)
+        FB::variant getHostValue(const FB::variant &var);
 
     // NPN_ functions -- for scope reasons, we no longer access these using the global functions
     protected:
@@ -105,6 +113,7 @@ namespace FB {
         bool IdentifierIsString(NPIdentifier identifier) const;
         NPUTF8 *UTF8FromIdentifier(NPIdentifier identifier) const;
         std::string StringFromIdentifier(NPIdentifier identifier) const;
+        FB::SharedString SharedStringFromIdentifier(NPIdentifier identifier) const;
         int32_t IntFromIdentifier(NPIdentifier identifier) const;
 
         /* npapi.h definitions */
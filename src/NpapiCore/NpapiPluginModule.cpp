@@ -13,24 +13,42 @@ Copyright 2009 Richard Bateman, Firebreath development team
 \**********************************************************/
 
 #include <stdexcept>
+#include <cstdlib>
 
 #include <cassert>
 #include <boost/thread.hpp>
 #include "logging.h"
 #include "BrowserHost.h"
 #include "PluginCore.h"
+#include "Reactor.h"
 #include <assert.h>
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
 #include "NpapiPluginModule.h"
+#include "NpapiSessionRecorder.h"
 using namespace FB::Npapi;
 
 volatile uint32_t NpapiPluginModule::PluginModuleInitialized(0);
 NpapiPluginModule::Modules NpapiPluginModule::m_modules;
 
+namespace {
+    // Set when FB_NPAPI_CAPTURE started the recorder, so it is stopped with the last module
+    bool capturingFromEnvironment(false);
+}
+
 NpapiPluginModule* NpapiPluginModule::GetModule(const void* key) {
     if (!NpapiPluginModule::PluginModuleInitialized) {
         FB::Log::initLogging();
+        if (const char* capturePath = getenv("FB_NPAPI_CAPTURE")) {
+            try {
+                if (*capturePath && !SessionRecorder::isRecording()) {
+                    SessionRecorder::start(capturePath);
+                    capturingFromEnvironment = true;
+                }
+            } catch (const std::exception& e) {
+                FBLOG_WARN("NpapiPluginModule", "Not recording the NPAPI session: " << e.what());
+            }
+        }
         getFactoryInstance()->globalPluginInitialize();
     }
     NpapiPluginModule* rval = NULL;
@@ -54,6 +72,8 @@ void NpapiPluginModule::ReleaseModule(const void* key) {
     if (!NpapiPluginModule::PluginModuleInitialized) {
 
         getFactoryInstance()->globalPluginDeinitialize();
+        // Stops the timers, HTTP services and requests still running on it
+        FB::Reactor::shutdownInstance();
 
         // NOTE: If this assertion fails you have some sort of memory leak; BrowserHost objects
         // are reference counted, so you have a shared_ptr to your browserhost sometime. This
@@ -61,6 +81,10 @@ void NpapiPluginModule::ReleaseModule(const void* key) {
         // a new one for each instances on each page (including page reloads).
         assert(BrowserHost::getInstanceCount() == 0);
         assert(PluginCore::getActivePluginCount() == 0);
+        if (capturingFromEnvironment) {
+            SessionRecorder::stop();
+            capturingFromEnvironment = false;
+        }
         FB::Log::stopLogging();
     }
 }
@@ -208,13 +232,22 @@ NPUTF8 *NpapiPluginModule::UTF8FromIdentifier(NPIdentifier identifier)
 // This is the preferred method to get strings from NPIdentifiers, since you
 // don't have to worry about cleaning it up =]
 std::string NpapiPluginModule::StringFromIdentifier(NPIdentifier identifier)
+{
+    return SharedStringFromIdentifier(identifier).str();
+}
+
+// Only the first call for each identifier goes to the browser
+FB::SharedString NpapiPluginModule::SharedStringFromIdentifier(NPIdentifier identifier)
 {
     assertMainThread();
+    std::map<NPIdentifier, FB::SharedString>::const_iterator it = m_identifierNames.find(identifier);
+    if (it != m_identifierNames.end())
+        return it->second;
+
     NPUTF8* idStr = UTF8FromIdentifier(identifier);
-    std::string str;
-    if (idStr != NULL)
-        str = idStr;
+    FB::SharedString str(idStr);
     MemFree(idStr);
+    m_identifierNames.insert(std::make_pair(identifier, str));
     return str;
 }
 
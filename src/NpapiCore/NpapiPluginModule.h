@@ -20,6 +20,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "APITypes.h"
 #include "NpapiTypes.h"
 #include "FactoryBase.h"
+#include "SharedString.h"
 #include <boost/thread.hpp>
 #include <boost/noncopyable.hpp>
 
@@ -47,6 +48,9 @@ namespace FB {
 
         protected:
             boost::thread::id m_threadId;
+            // Names of the identifiers we've been asked about; identifiers live as long as the
+            // browser does, so they never need to be removed
+            std::map<NPIdentifier, FB::SharedString> m_identifierNames;
             static volatile uint32_t PluginModuleInitialized;
             static Modules m_modules;
 
@@ -70,6 +74,7 @@ namespace FB {
             bool IdentifierIsString(NPIdentifier identifier);
             NPUTF8 *UTF8FromIdentifier(NPIdentifier identifier);
             std::string StringFromIdentifier(NPIdentifier identifier);
+            FB::SharedString SharedStringFromIdentifier(NPIdentifier identifier);
             int32_t IntFromIdentifier(NPIdentifier identifier);
             NPObject *RetainObject(NPObject *npobj);
             void ReleaseObject(NPObject *npobj);
@@ -17,6 +17,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include <dlfcn.h>
 #endif
 #include <cstdio>
+#include <cstring>
 #include "NpapiPlugin.h"
 #include "FactoryBase.h"
 #include "NpapiBrowserHost.h"
@@ -26,6 +27,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "PluginInfo.h"
 #include "SafeQueue.h"
 #include "NpapiPluginModule.h"
+#include "NpapiSessionRecorder.h"
 
 #if FB_WIN
 #  include "Win/NpapiBrowserHostAsyncWin.h"
@@ -152,6 +154,15 @@ NPError NpapiPluginModule::NPP_New(NPMIMEType pluginType, NPP instance, uint16_t
         return NPERR_INVALID_INSTANCE_ERROR;
     }
 
+    SessionRecorder::Call call(Capture_New);
+    if (call.isActive()) {
+        call.setMember(CapturedValue(std::string(pluginType ? pluginType : "")));
+        for (int16_t i = 0; i < argc; i++) {
+            call.addArg(CapturedValue(std::string(argn[i] ? argn[i] : "")));
+            call.addArg(argv[i] ? CapturedValue(std::string(argv[i])) : CapturedValue::null());
+        }
+    }
+
     try
     {
 #ifdef FB_MACOSX
@@ -176,7 +187,7 @@ NPError NpapiPluginModule::NPP_New(NPMIMEType pluginType, NPP instance, uint16_t
         // on the specific mimetype
         NpapiPluginPtr plugin(getFactoryInstance()->createNpapiPlugin(host, pluginType));
         if (!plugin) {
-            return NPERR_OUT_OF_MEMORY_ERROR;
+            return call.finish(NPERR_OUT_OF_MEMORY_ERROR);
         }
 
         NpapiPDataHolder* holder = new NpapiPDataHolder(host, plugin);
@@ -187,20 +198,20 @@ NPError NpapiPluginModule::NPP_New(NPMIMEType pluginType, NPP instance, uint16_t
     catch (const PluginCreateError &e)
     {
         printf("%s\n", e.what());
-        return NPERR_INCOMPATIBLE_VERSION_ERROR;
+        return call.finish(NPERR_INCOMPATIBLE_VERSION_ERROR);
     }
     catch (const std::bad_alloc& e)
     {
         printf("%s\n", e.what());
-        return NPERR_OUT_OF_MEMORY_ERROR;
+        return call.finish(NPERR_OUT_OF_MEMORY_ERROR);
     }
     catch (const std::exception& e)
     {
         printf("%s\n", e.what());
-        return NPERR_GENERIC_ERROR;
+        return call.finish(NPERR_GENERIC_ERROR);
     }
 
-    return NPERR_NO_ERROR;
+    return call.finish(NPERR_NO_ERROR);
 }
 
 NPError NpapiPluginModule::NPP_Destroy(NPP instance, NPSavedData** save)
@@ -210,6 +221,7 @@ NPError NpapiPluginModule::NPP_Destroy(NPP instance, NPSavedData** save)
         return NPERR_INVALID_INSTANCE_ERROR;
     }
     NpapiBrowserHostWeakPtr weakHost;
+    SessionRecorder::Call call(Capture_Destroy);
 
     if (NpapiPDataHolder* holder = getHolder(instance)) {
         NpapiBrowserHostPtr host(holder->getHost());
@@ -224,14 +236,14 @@ NPError NpapiPluginModule::NPP_Destroy(NPP instance, NPSavedData** save)
         delete holder; // Destroy plugin
         // host should be destroyed when it goes out of scope here
     } else {
-        return NPERR_GENERIC_ERROR;
+        return call.finish(NPERR_GENERIC_ERROR);
     }
     // If this assertion fails, you probably have a circular reference
     // to your BrowserHost object somewhere -- the host should be gone
     // by this point. This assertion is warning you of a bug.
     assert(weakHost.expired());
 
-    return NPERR_NO_ERROR;
+    return call.finish(NPERR_NO_ERROR);
 }
 
 NPError NpapiPluginModule::NPP_SetWindow(NPP instance, NPWindow* window)
@@ -241,9 +253,18 @@ NPError NpapiPluginModule::NPP_SetWindow(NPP instance, NPWindow* window)
         return NPERR_INVALID_INSTANCE_ERROR;
     }
 
+    SessionRecorder::Call call(Capture_SetWindow);
+    if (call.isActive() && window) {
+        call.addArg(static_cast<int32_t>(window->x));
+        call.addArg(static_cast<int32_t>(window->y));
+        call.addArg(static_cast<int32_t>(window->width));
+        call.addArg(static_cast<int32_t>(window->height));
+        call.addArg(static_cast<int32_t>(window->type));
+    }
+
     if (pluginGuiEnabled())
         if (NpapiPluginPtr plugin = getPlugin(instance)) {
-            return plugin->SetWindow(window);
+            return call.finish(plugin->SetWindow(window));
         }
 
     return NPERR_NO_ERROR;
@@ -257,8 +278,23 @@ NPError NpapiPluginModule::NPP_NewStream(NPP instance, NPMIMEType type, NPStream
         return NPERR_INVALID_INSTANCE_ERROR;
     }
 
+    SessionRecorder::Call call(Capture_NewStream);
+    if (call.isActive()) {
+        call.setStream(stream);
+        call.setMember(CapturedValue(std::string(stream->url ? stream->url : "")));
+        call.setData(type, type ? strlen(type) : 0);
+        call.addArg(static_cast<int32_t>(stream->end));
+        call.addArg(static_cast<int32_t>(stream->lastmodified));
+        call.addArg(stream->headers ? CapturedValue(std::string(stream->headers)) : CapturedValue::null());
+        // Tells a replay which of the plugin's URL requests this stream answers
+        call.addArg(static_cast<int32_t>(SessionRecorder::getRequestId(stream->notifyData)));
+        call.addArg(CapturedValue::boolean(seekable != 0));
+    }
+
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
-        return plugin->NewStream(type, stream, seekable, stype);
+        NPError err = plugin->NewStream(type, stream, seekable, stype);
+        call.setResult(CapturedValue(static_cast<int32_t>(*stype)));
+        return call.finish(err);
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -271,8 +307,12 @@ NPError NpapiPluginModule::NPP_DestroyStream(NPP instance, NPStream* stream, NPR
         return NPERR_INVALID_INSTANCE_ERROR;
     }
 
+    SessionRecorder::Call call(Capture_DestroyStream);
+    call.setStream(stream);
+    call.addArg(static_cast<int32_t>(reason));
+
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
-        return plugin->DestroyStream(stream, reason);
+        return call.finish(plugin->DestroyStream(stream, reason));
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -285,8 +325,11 @@ int32_t NpapiPluginModule::NPP_WriteReady(NPP instance, NPStream* stream)
         return NPERR_INVALID_INSTANCE_ERROR;
     }
 
+    SessionRecorder::Call call(Capture_WriteReady);
+    call.setStream(stream);
+
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
-        return plugin->WriteReady(stream);
+        return call.finish(plugin->WriteReady(stream));
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -300,8 +343,15 @@ int32_t NpapiPluginModule::NPP_Write(NPP instance, NPStream* stream, int32_t off
         return NPERR_INVALID_INSTANCE_ERROR;
     }
 
+    SessionRecorder::Call call(Capture_Write);
+    if (call.isActive()) {
+        call.setStream(stream);
+        call.addArg(offset);
+        call.setData(buffer, len > 0 ? len : 0);
+    }
+
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
-        return plugin->Write(stream, offset, len, buffer);
+        return call.finish(plugin->Write(stream, offset, len, buffer));
     } else {
         return NPERR_GENERIC_ERROR;
     }
@@ -314,6 +364,12 @@ void NpapiPluginModule::NPP_StreamAsFile(NPP instance, NPStream* stream, const c
         return;
     }
 
+    SessionRecorder::Call call(Capture_StreamAsFile);
+    if (call.isActive()) {
+        call.setStream(stream);
+        call.setData(fname, fname ? strlen(fname) : 0);
+    }
+
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
         plugin->StreamAsFile(stream, fname);
     }
@@ -339,7 +395,8 @@ int16_t NpapiPluginModule::NPP_HandleEvent(NPP instance, void* event)
     }
 
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
-        return plugin->HandleEvent(event);
+        SessionRecorder::Call call(Capture_HandleEvent);
+        return call.finish(plugin->HandleEvent(event));
     } else {
         return 0;
     }
@@ -353,6 +410,13 @@ void NpapiPluginModule::NPP_URLNotify(NPP instance, const char* url, NPReason re
         return;
     }
 
+    SessionRecorder::Call call(Capture_URLNotify);
+    if (call.isActive()) {
+        call.setRequest(notifyData);
+        call.setMember(CapturedValue(std::string(url ? url : "")));
+        call.addArg(static_cast<int32_t>(reason));
+    }
+
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
         plugin->URLNotify(url, reason, notifyData);
     }
@@ -380,7 +444,17 @@ NPError NpapiPluginModule::NPP_GetValue(NPP instance, NPPVariable variable, void
     }
 
     if (NpapiPluginPtr plugin = getPlugin(instance)) {
-        return plugin->GetValue(variable, value);
+        if (variable != NPPVpluginScriptableNPObject)
+            return plugin->GetValue(variable, value);
+
+        SessionRecorder::Call call(Capture_GetScriptableObject);
+        NPError err = plugin->GetValue(variable, value);
+        if (err == NPERR_NO_ERROR && call.isActive() && *static_cast<NPObject**>(value)) {
+            NPVariant obj;
+            OBJECT_TO_NPVARIANT(*static_cast<NPObject**>(value), obj);
+            call.setResult(&obj);
+        }
+        return call.finish(err);
     }
 
     return NPERR_NO_ERROR;
@@ -0,0 +1,483 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include "NpapiSessionCapture.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    const char captureMagic[] = "FBNPCAP";
+    const size_t headerSize = sizeof(captureMagic);
+
+    // Thrown when the data runs out part way through a record
+    struct truncated_capture { };
+
+    void writeVarint(std::ostream& out, boost::uint64_t value)
+    {
+        char buf[10];
+        size_t len = 0;
+        do {
+            char byte = static_cast<char>(value & 0x7f);
+            value >>= 7;
+            buf[len++] = value ? (byte | 0x80) : byte;
+        } while (value);
+        out.write(buf, len);
+    }
+
+    void writeSigned(std::ostream& out, boost::int64_t value)
+    {
+        writeVarint(out, (static_cast<boost::uint64_t>(value) << 1) ^ static_cast<boost::uint64_t>(value >> 63));
+    }
+
+    void writeString(std::ostream& out, const std::string& str)
+    {
+        writeVarint(out, str.size());
+        out.write(str.data(), str.size());
+    }
+
+    void writeValue(std::ostream& out, const CapturedValue& value)
+    {
+        out.put(static_cast<char>(value.type));
+        switch (value.type) {
+        case CapturedValue::Bool:
+            out.put(value.intValue ? 1 : 0);
+            break;
+        case CapturedValue::Int32:
+            writeSigned(out, value.intValue);
+            break;
+        case CapturedValue::Double: {
+            boost::uint64_t bits;
+            memcpy(&bits, &value.doubleValue, sizeof(bits));
+            for (int i = 0; i < 8; ++i)
+                out.put(static_cast<char>((bits >> (i * 8)) & 0xff));
+            break; }
+        case CapturedValue::String:
+            writeString(out, value.stringValue);
+            break;
+        case CapturedValue::PluginObject:
+        case CapturedValue::BrowserObject:
+            writeVarint(out, value.objectId);
+            break;
+        default:
+            break;
+        }
+    }
+
+    class CaptureReader
+    {
+    public:
+        CaptureReader(const std::string& data) : m_pos(data.data()), m_end(data.data() + data.size()) { }
+
+        bool atEnd() const { return m_pos == m_end; }
+
+        unsigned char readByte()
+        {
+            if (m_pos == m_end)
+                throw truncated_capture();
+            return static_cast<unsigned char>(*m_pos++);
+        }
+
+        boost::uint64_t readVarint()
+        {
+            boost::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                unsigned char byte = readByte();
+                value |= static_cast<boost::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            throw std::runtime_error("Invalid NPAPI capture: bad integer");
+        }
+
+        boost::int64_t readSigned()
+        {
+            boost::uint64_t value = readVarint();
+            return static_cast<boost::int64_t>(value >> 1) ^ -static_cast<boost::int64_t>(value & 1);
+        }
+
+        std::string readString()
+        {
+            boost::uint64_t len = readVarint();
+            if (len > static_cast<boost::uint64_t>(m_end - m_pos))
+                throw truncated_capture();
+            std::string str(m_pos, static_cast<size_t>(len));
+            m_pos += len;
+            return str;
+        }
+
+        CapturedValue readValue()
+        {
+            CapturedValue value;
+            unsigned char type = readByte();
+            if (type > CapturedValue::BrowserObject)
+                throw std::runtime_error("Invalid NPAPI capture: unknown value type");
+            value.type = static_cast<CapturedValue::Type>(type);
+            switch (value.type) {
+            case CapturedValue::Bool:
+                value.intValue = readByte() ? 1 : 0;
+                break;
+            case CapturedValue::Int32:
+                value.intValue = static_cast<boost::int32_t>(readSigned());
+                break;
+            case CapturedValue::Double: {
+                boost::uint64_t bits = 0;
+                for (int i = 0; i < 8; ++i)
+                    bits |= static_cast<boost::uint64_t>(readByte()) << (i * 8);
+                memcpy(&value.doubleValue, &bits, sizeof(bits));
+                break; }
+            case CapturedValue::String:
+                value.stringValue = readString();
+                break;
+            case CapturedValue::PluginObject:
+            case CapturedValue::BrowserObject:
+                value.objectId = static_cast<boost::uint32_t>(readVarint());
+                break;
+            default:
+                break;
+            }
+            return value;
+        }
+
+        CaptureRecord readRecord()
+        {
+            CaptureRecord record;
+            record.kind = static_cast<CaptureKind>(readByte());
+            record.depth = static_cast<boost::uint32_t>(readVarint());
+            record.sequence = readVarint();
+            record.time = readVarint();
+            record.duration = readVarint();
+            record.target = static_cast<boost::uint32_t>(readVarint());
+            record.member = readValue();
+            boost::uint64_t argCount = readVarint();
+            for (boost::uint64_t i = 0; i < argCount; ++i)
+                record.args.push_back(readValue());
+            record.status = static_cast<boost::int32_t>(readSigned());
+            record.result = readValue();
+            record.data = readString();
+            return record;
+        }
+
+    private:
+        const char* m_pos;
+        const char* m_end;
+    };
+
+    bool bySequence(const CaptureRecord& lhs, const CaptureRecord& rhs)
+    {
+        return lhs.sequence < rhs.sequence;
+    }
+
+    bool slowestFirst(const SiteTiming& lhs, const SiteTiming& rhs)
+    {
+        return lhs.getChange() > rhs.getChange();
+    }
+}
+
+const char* FB::Npapi::getCaptureKindName(CaptureKind kind)
+{
+    switch (kind) {
+    case Capture_New: return "NPP_New";
+    case Capture_Destroy: return "NPP_Destroy";
+    case Capture_SetWindow: return "NPP_SetWindow";
+    case Capture_NewStream: return "NPP_NewStream";
+    case Capture_WriteReady: return "NPP_WriteReady";
+    case Capture_Write: return "NPP_Write";
+    case Capture_StreamAsFile: return "NPP_StreamAsFile";
+    case Capture_DestroyStream: return "NPP_DestroyStream";
+    case Capture_URLNotify: return "NPP_URLNotify";
+    case Capture_GetScriptableObject: return "NPP_GetValue";
+    case Capture_HasMethod: return "HasMethod";
+    case Capture_Invoke: return "Invoke";
+    case Capture_InvokeDefault: return "InvokeDefault";
+    case Capture_HasProperty: return "HasProperty";
+    case Capture_GetProperty: return "GetProperty";
+    case Capture_SetProperty: return "SetProperty";
+    case Capture_RemoveProperty: return "RemoveProperty";
+    case Capture_Enumerate: return "Enumerate";
+    case Capture_Construct: return "Construct";
+    case Capture_HandleEvent: return "NPP_HandleEvent";
+    case Capture_BrowserGetValue: return "NPN_GetValue";
+    case Capture_BrowserGetURL: return "NPN_GetURLNotify";
+    case Capture_BrowserHasMethod: return "NPN_HasMethod";
+    case Capture_BrowserInvoke: return "NPN_Invoke";
+    case Capture_BrowserInvokeDefault: return "NPN_InvokeDefault";
+    case Capture_BrowserEvaluate: return "NPN_Evaluate";
+    case Capture_BrowserHasProperty: return "NPN_HasProperty";
+    case Capture_BrowserGetProperty: return "NPN_GetProperty";
+    case Capture_BrowserSetProperty: return "NPN_SetProperty";
+    case Capture_BrowserRemoveProperty: return "NPN_RemoveProperty";
+    case Capture_BrowserEnumerate: return "NPN_Enumerate";
+    case Capture_BrowserConstruct: return "NPN_Construct";
+    case Capture_StreamOpened: return "Stream.Opened";
+    case Capture_StreamFailedOpen: return "Stream.FailedOpen";
+    case Capture_StreamDataArrived: return "Stream.DataArrived";
+    case Capture_StreamCompleted: return "Stream.Completed";
+    }
+    return "Unknown";
+}
+
+CapturedValue CapturedValue::null()
+{
+    CapturedValue value;
+    value.type = Null;
+    return value;
+}
+
+CapturedValue CapturedValue::boolean(bool b)
+{
+    CapturedValue value;
+    value.type = Bool;
+    value.intValue = b ? 1 : 0;
+    return value;
+}
+
+CapturedValue CapturedValue::number(double d)
+{
+    CapturedValue value;
+    value.type = Double;
+    value.doubleValue = d;
+    return value;
+}
+
+CapturedValue CapturedValue::object(Type type, boost::uint32_t id)
+{
+    CapturedValue value;
+    value.type = type;
+    value.objectId = id;
+    return value;
+}
+
+bool CapturedValue::operator==(const CapturedValue& rhs) const
+{
+    if (type != rhs.type)
+        return false;
+    switch (type) {
+    case Bool:
+    case Int32:
+        return intValue == rhs.intValue;
+    case Double:
+        return doubleValue == rhs.doubleValue;
+    case String:
+        return stringValue == rhs.stringValue;
+    case PluginObject:
+    case BrowserObject:
+        return objectId == rhs.objectId;
+    default:
+        return true;
+    }
+}
+
+std::string CapturedValue::toString() const
+{
+    switch (type) {
+    case Null:
+        return "null";
+    case Bool:
+        return intValue ? "true" : "false";
+    case Int32:
+        return boost::lexical_cast<std::string>(intValue);
+    case Double:
+        return boost::lexical_cast<std::string>(doubleValue);
+    case String:
+        return "\"" + (stringValue.size() > 40 ? stringValue.substr(0, 40) + "..." : stringValue) + "\"";
+    case PluginObject:
+        return "plugin object #" + boost::lexical_cast<std::string>(objectId);
+    case BrowserObject:
+        return "browser object #" + boost::lexical_cast<std::string>(objectId);
+    default:
+        return "undefined";
+    }
+}
+
+std::string CaptureRecord::getSite() const
+{
+    std::string site(getCaptureKindName(kind));
+    switch (kind) {
+    case Capture_HasMethod:
+    case Capture_Invoke:
+    case Capture_HasProperty:
+    case Capture_GetProperty:
+    case Capture_SetProperty:
+    case Capture_RemoveProperty:
+    case Capture_BrowserGetValue:
+    case Capture_BrowserHasMethod:
+    case Capture_BrowserInvoke:
+    case Capture_BrowserHasProperty:
+    case Capture_BrowserGetProperty:
+    case Capture_BrowserSetProperty:
+    case Capture_BrowserRemoveProperty:
+        // Array indexes all count as one site
+        site += member.type == CapturedValue::String ? " " + member.stringValue : " []";
+        break;
+    default:
+        break;
+    }
+    return site;
+}
+
+void SessionCapture::writeHeader(std::ostream& out)
+{
+    out.write(captureMagic, headerSize - 1);
+    out.put(static_cast<char>(Version));
+}
+
+void SessionCapture::writeRecord(std::ostream& out, const CaptureRecord& record)
+{
+    out.put(static_cast<char>(record.kind));
+    writeVarint(out, record.depth);
+    writeVarint(out, record.sequence);
+    writeVarint(out, record.time);
+    writeVarint(out, record.duration);
+    writeVarint(out, record.target);
+    writeValue(out, record.member);
+    writeVarint(out, record.args.size());
+    for (std::vector<CapturedValue>::const_iterator it = record.args.begin(); it != record.args.end(); ++it)
+        writeValue(out, *it);
+    writeSigned(out, record.status);
+    writeValue(out, record.result);
+    writeString(out, record.data);
+}
+
+SessionCapture SessionCapture::parse(const std::string& data)
+{
+    if (data.size() < headerSize || data.compare(0, headerSize - 1, captureMagic) != 0)
+        throw std::runtime_error("Not an NPAPI capture");
+    if (static_cast<unsigned char>(data[headerSize - 1]) > Version)
+        throw std::runtime_error("NPAPI capture is from a newer version");
+
+    SessionCapture capture;
+    const std::string body(data.substr(headerSize));
+    CaptureReader reader(body);
+    try {
+        while (!reader.atEnd())
+            capture.records.push_back(reader.readRecord());
+    } catch (const truncated_capture&) {
+        // The recording was cut short; keep what was complete
+    }
+    std::stable_sort(capture.records.begin(), capture.records.end(), &bySequence);
+    return capture;
+}
+
+SessionCapture SessionCapture::load(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Could not open NPAPI capture " + path);
+    std::ostringstream data;
+    data << in.rdbuf();
+    return parse(data.str());
+}
+
+std::string SessionCapture::serialize() const
+{
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    writeHeader(out);
+    for (std::vector<CaptureRecord>::const_iterator it = records.begin(); it != records.end(); ++it)
+        writeRecord(out, *it);
+    return out.str();
+}
+
+void SessionCapture::save(const std::string& path) const
+{
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    std::string data(serialize());
+    out.write(data.data(), data.size());
+    if (!out)
+        throw std::runtime_error("Could not write NPAPI capture " + path);
+}
+
+double SiteTiming::getRecordedMean() const
+{
+    return recordedCalls ? static_cast<double>(recordedTime) / recordedCalls : 0;
+}
+
+double SiteTiming::getReplayedMean() const
+{
+    return replayedCalls ? static_cast<double>(replayedTime) / replayedCalls : 0;
+}
+
+double SiteTiming::getChange() const
+{
+    double before = getRecordedMean();
+    if (!recordedCalls || !replayedCalls)
+        return 0;
+    if (before == 0)
+        return getReplayedMean() == 0 ? 0 : 100;
+    return (getReplayedMean() - before) / before * 100;
+}
+
+SessionReport SessionReport::compare(const SessionCapture& recorded, const SessionCapture& replayed)
+{
+    std::map<std::string, SiteTiming> sites;
+    for (std::vector<CaptureRecord>::const_iterator it = recorded.records.begin(); it != recorded.records.end(); ++it) {
+        SiteTiming& timing(sites[it->getSite()]);
+        ++timing.recordedCalls;
+        timing.recordedTime += it->duration;
+    }
+    for (std::vector<CaptureRecord>::const_iterator it = replayed.records.begin(); it != replayed.records.end(); ++it) {
+        SiteTiming& timing(sites[it->getSite()]);
+        ++timing.replayedCalls;
+        timing.replayedTime += it->duration;
+    }
+
+    SessionReport report;
+    for (std::map<std::string, SiteTiming>::iterator it = sites.begin(); it != sites.end(); ++it) {
+        it->second.site = it->first;
+        report.sites.push_back(it->second);
+    }
+    return report;
+}
+
+std::vector<SiteTiming> SessionReport::getSlowerSites(double percent, double minTime) const
+{
+    std::vector<SiteTiming> slower;
+    for (std::vector<SiteTiming>::const_iterator it = sites.begin(); it != sites.end(); ++it) {
+        if (it->getChange() > percent && it->getRecordedMean() >= minTime)
+            slower.push_back(*it);
+    }
+    std::sort(slower.begin(), slower.end(), &slowestFirst);
+    return slower;
+}
+
+std::string SessionReport::toString() const
+{
+    std::vector<SiteTiming> sorted(sites);
+    std::stable_sort(sorted.begin(), sorted.end(), &slowestFirst);
+
+    std::ostringstream out;
+    out << std::left << std::setw(32) << "site" << std::right << std::setw(8) << "calls"
+        << std::setw(14) << "recorded us" << std::setw(14) << "replayed us" << std::setw(10) << "change" << "\n";
+    for (std::vector<SiteTiming>::const_iterator it = sorted.begin(); it != sorted.end(); ++it) {
+        std::string calls(boost::lexical_cast<std::string>(it->recordedCalls));
+        if (it->replayedCalls != it->recordedCalls)
+            calls += "/" + boost::lexical_cast<std::string>(it->replayedCalls);
+        out << std::left << std::setw(32) << it->site << std::right << std::setw(8) << calls
+            << std::fixed << std::setprecision(1)
+            << std::setw(14) << it->getRecordedMean() << std::setw(14) << it->getReplayedMean()
+            << std::showpos << std::setw(9) << it->getChange() << "%" << std::noshowpos << "\n";
+    }
+    for (std::vector<std::string>::const_iterator it = mismatches.begin(); it != mismatches.end(); ++it)
+        out << "mismatch: " << *it << "\n";
+    return out.str();
+}
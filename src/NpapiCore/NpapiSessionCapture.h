@@ -0,0 +1,238 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_NPAPI_NPAPISESSIONCAPTURE
+#define H_FB_NPAPI_NPAPISESSIONCAPTURE
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace FB { namespace Npapi {
+
+    // What a CaptureRecord is a record of
+    enum CaptureKind
+    {
+        // The browser calling the plugin; these are the calls a replay makes again
+        Capture_New = 1,
+        Capture_Destroy,
+        Capture_SetWindow,
+        Capture_NewStream,
+        Capture_WriteReady,
+        Capture_Write,
+        Capture_StreamAsFile,
+        Capture_DestroyStream,
+        Capture_URLNotify,
+        Capture_GetScriptableObject,
+        Capture_HasMethod,
+        Capture_Invoke,
+        Capture_InvokeDefault,
+        Capture_HasProperty,
+        Capture_GetProperty,
+        Capture_SetProperty,
+        Capture_RemoveProperty,
+        Capture_Enumerate,
+        Capture_Construct,
+        // Only timed; native events can't be replayed without a real window
+        Capture_HandleEvent,
+
+        // The plugin calling the browser; a replay answers these with the recorded results
+        Capture_BrowserGetValue = 32,
+        Capture_BrowserGetURL,
+        Capture_BrowserHasMethod,
+        Capture_BrowserInvoke,
+        Capture_BrowserInvokeDefault,
+        Capture_BrowserEvaluate,
+        Capture_BrowserHasProperty,
+        Capture_BrowserGetProperty,
+        Capture_BrowserSetProperty,
+        Capture_BrowserRemoveProperty,
+        Capture_BrowserEnumerate,
+        Capture_BrowserConstruct,
+
+        // NpapiStream handing what arrived on to the plugin; only timed
+        Capture_StreamOpened = 64,
+        Capture_StreamFailedOpen,
+        Capture_StreamDataArrived,
+        Capture_StreamCompleted
+    };
+
+    const char* getCaptureKindName(CaptureKind kind);
+    // Whether a replay makes this call itself
+    inline bool isReplayedCall(CaptureKind kind) { return kind < Capture_HandleEvent; }
+    // Whether this is the plugin calling the browser
+    inline bool isBrowserCall(CaptureKind kind) { return kind >= Capture_BrowserGetValue && kind < Capture_StreamOpened; }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @struct CapturedValue
+    ///
+    /// @brief  An NPVariant as it was recorded.  Objects are kept as ids that stay the same for the
+    ///         whole capture, so a replay can tell which object a call was made on.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct CapturedValue
+    {
+        enum Type { Void, Null, Bool, Int32, Double, String, PluginObject, BrowserObject };
+
+        CapturedValue() : type(Void), intValue(0), doubleValue(0), objectId(0) { }
+        CapturedValue(boost::int32_t value) : type(Int32), intValue(value), doubleValue(0), objectId(0) { }
+        CapturedValue(const std::string& value)
+            : type(String), intValue(0), doubleValue(0), stringValue(value), objectId(0) { }
+
+        static CapturedValue null();
+        static CapturedValue boolean(bool value);
+        static CapturedValue number(double value);
+        static CapturedValue object(Type type, boost::uint32_t id);
+
+        bool operator==(const CapturedValue& rhs) const;
+        bool operator!=(const CapturedValue& rhs) const { return !(*this == rhs); }
+        // Something short to show in a report, e.g. "12", "\"text\"" or "browser object #3"
+        std::string toString() const;
+
+        Type type;
+        // Bool and Int32
+        boost::int32_t intValue;
+        double doubleValue;
+        std::string stringValue;
+        boost::uint32_t objectId;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @struct CaptureRecord
+    ///
+    /// @brief  One call across the NPAPI boundary: what was called, with what, what came back and how
+    ///         long it took.
+    ///
+    /// How the fields are used depends on the kind:
+    ///  - New: member is the MIME type, args the embed parameters as name, value pairs;
+    ///  - SetWindow: args are x, y, width, height and the window type;
+    ///  - NewStream: target is the stream, member the URL, data the MIME type, args are the
+    ///    stream's end, lastmodified, headers, the URL request it answers (or 0) and whether it is
+    ///    seekable; result is the stream type the plugin asked for;
+    ///  - Write: target is the stream, args the offset, data the bytes;
+    ///  - DestroyStream and URLNotify: args are the reason; URLNotify's target is the URL request;
+    ///  - BrowserGetURL: target is the URL request, member the URL, args the window, method and post
+    ///    data;
+    ///  - BrowserGetValue: member is the NPNVariable;
+    ///  - Enumerate and BrowserEnumerate: args are the names returned;
+    ///  - the rest: target is the object, member the method or property name, args the arguments
+    ///    (or the value set) and result the value returned.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct CaptureRecord
+    {
+        CaptureRecord()
+            : kind(Capture_New), depth(0), sequence(0), time(0), duration(0), target(0), status(0) { }
+
+        // The kind and member, e.g. "Invoke getValue"; timings are compared by site
+        std::string getSite() const;
+
+        CaptureKind kind;
+        // How many recorded calls this one was made inside of
+        boost::uint32_t depth;
+        // The order the calls were made in
+        boost::uint64_t sequence;
+        // When the call was made, in microseconds since recording started, and how long it took
+        boost::uint64_t time;
+        boost::uint64_t duration;
+        // The object, stream or URL request the call was about; ids are only unique within a capture
+        boost::uint32_t target;
+        CapturedValue member;
+        std::vector<CapturedValue> args;
+        // What the function returned: a bool, NPError or byte count
+        boost::int32_t status;
+        CapturedValue result;
+        std::string data;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  SessionCapture
+    ///
+    /// @brief  A recorded NPAPI session, as written by SessionRecorder and played back by
+    ///         SessionReplayer.
+    ///
+    /// The file format is an 8 byte header ("FBNPCAP" and a version byte) followed by one record per
+    /// call, with integers written as varints; records are written as each call returns, so a
+    /// capture cut short by a crash can still be read up to the last complete record.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class SessionCapture
+    {
+    public:
+        static const int Version = 1;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static SessionCapture SessionCapture::parse(const std::string& data)
+        ///
+        /// @brief  Reads a capture; a record cut off at the end is ignored.
+        ///
+        /// @throws std::runtime_error if data isn't a capture, or is from a newer version
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static SessionCapture parse(const std::string& data);
+        static SessionCapture load(const std::string& path);
+        std::string serialize() const;
+        void save(const std::string& path) const;
+
+        static void writeHeader(std::ostream& out);
+        static void writeRecord(std::ostream& out, const CaptureRecord& record);
+
+        // In the order the calls were made
+        std::vector<CaptureRecord> records;
+    };
+
+    // How long the calls at one site took when recorded and when replayed, in microseconds
+    struct SiteTiming
+    {
+        SiteTiming() : recordedCalls(0), replayedCalls(0), recordedTime(0), replayedTime(0) { }
+
+        double getRecordedMean() const;
+        double getReplayedMean() const;
+        // How much longer each replayed call took on average, in percent; negative when faster
+        double getChange() const;
+
+        std::string site;
+        size_t recordedCalls;
+        size_t replayedCalls;
+        boost::uint64_t recordedTime;
+        boost::uint64_t replayedTime;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  SessionReport
+    ///
+    /// @brief  How the timing of two captures of the same session compares, call site by call site,
+    ///         and (for a replay) where the plugin answered differently than it did when recorded.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class SessionReport
+    {
+    public:
+        static SessionReport compare(const SessionCapture& recorded, const SessionCapture& replayed);
+
+        // The sites whose replayed calls took more than percent longer on average; sites whose
+        // recorded calls took less than minTime microseconds on average are left out, as noise
+        std::vector<SiteTiming> getSlowerSites(double percent, double minTime = 0) const;
+        // A table of the sites, slowest first, then the mismatches
+        std::string toString() const;
+
+        // Sorted by site
+        std::vector<SiteTiming> sites;
+        std::vector<std::string> mismatches;
+    };
+
+}; };
+
+#endif // H_FB_NPAPI_NPAPISESSIONCAPTURE
@@ -0,0 +1,313 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "NpapiBrowserHost.h"
+#include "NPJavascriptObject.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include "NpapiSessionRecorder.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    typedef std::map<const void*, boost::uint32_t> IdMap;
+
+    struct RecorderState
+    {
+        RecorderState()
+            : inMemory(false), nextSequence(1), nextObject(1), nextStream(1), nextRequest(1), depth(0) { }
+
+        boost::uint64_t elapsed() const
+        {
+            return (boost::posix_time::microsec_clock::universal_time() - started).total_microseconds();
+        }
+
+        // Objects, streams and URL requests are given ids as they are first seen
+        static boost::uint32_t getId(IdMap& ids, boost::uint32_t& next, const void* ptr)
+        {
+            IdMap::iterator it = ids.find(ptr);
+            if (it != ids.end())
+                return it->second;
+            return ids[ptr] = next++;
+        }
+
+        boost::scoped_ptr<std::ostream> out;
+        bool inMemory;
+        boost::posix_time::ptime started;
+        boost::uint64_t nextSequence;
+        boost::uint32_t nextObject;
+        boost::uint32_t nextStream;
+        boost::uint32_t nextRequest;
+        boost::uint32_t depth;
+        IdMap objects;
+        IdMap streams;
+        IdMap requests;
+    };
+
+    boost::mutex recorderMutex;
+    boost::scoped_ptr<RecorderState> recorderState;
+    // Calls made while an earlier recording was going aren't written to a later one
+    boost::uint32_t recorderGeneration(0);
+}
+
+boost::atomic<bool> SessionRecorder::s_recording(false);
+
+void SessionRecorder::start(const std::string& path)
+{
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (recorderState)
+        throw std::logic_error("Already recording an NPAPI session");
+
+    boost::scoped_ptr<RecorderState> state(new RecorderState());
+    state->inMemory = path.empty();
+    if (state->inMemory) {
+        state->out.reset(new std::ostringstream(std::ios::out | std::ios::binary));
+    } else {
+        state->out.reset(new std::ofstream(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc));
+        if (!*state->out)
+            throw std::runtime_error("Could not open " + path + " to record the NPAPI session");
+    }
+    SessionCapture::writeHeader(*state->out);
+    state->out->flush();
+    state->started = boost::posix_time::microsec_clock::universal_time();
+
+    recorderState.swap(state);
+    ++recorderGeneration;
+    s_recording.store(true, boost::memory_order_release);
+}
+
+SessionCapture SessionRecorder::stop()
+{
+    boost::scoped_ptr<RecorderState> state;
+    {
+        boost::mutex::scoped_lock _l(recorderMutex);
+        s_recording.store(false, boost::memory_order_release);
+        state.swap(recorderState);
+    }
+    if (!state || !state->inMemory)
+        return SessionCapture();
+    return SessionCapture::parse(static_cast<std::ostringstream&>(*state->out).str());
+}
+
+void SessionRecorder::forgetObject(const NPObject* obj)
+{
+    if (!isRecording())
+        return;
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (recorderState)
+        recorderState->objects.erase(obj);
+}
+
+boost::uint32_t SessionRecorder::getRequestId(void* notifyData)
+{
+    if (!isRecording() || !notifyData)
+        return 0;
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState)
+        return 0;
+    IdMap::const_iterator it = recorderState->requests.find(notifyData);
+    return it != recorderState->requests.end() ? it->second : 0;
+}
+
+SessionRecorder::Call::Call(CaptureKind kind)
+    : m_active(false), m_ended(false), m_generation(0), m_handle(NULL)
+{
+    if (!isRecording())
+        return;
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState)
+        return;
+    m_active = true;
+    m_generation = recorderGeneration;
+    m_record = CaptureRecord();
+    m_record->kind = kind;
+    m_record->sequence = recorderState->nextSequence++;
+    m_record->depth = recorderState->depth++;
+    m_record->time = recorderState->elapsed();
+}
+
+SessionRecorder::Call::~Call()
+{
+    if (!m_active)
+        return;
+    if (!m_ended)
+        end(0);
+
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState || m_generation != recorderGeneration)
+        return;
+    --recorderState->depth;
+    // The browser can reuse the NPStream, and the plugin its notifyData, once they're done with
+    if (m_record->kind == Capture_DestroyStream)
+        recorderState->streams.erase(m_handle);
+    else if (m_record->kind == Capture_URLNotify)
+        recorderState->requests.erase(m_handle);
+    SessionCapture::writeRecord(*recorderState->out, *m_record);
+    // Written out a whole top level call at a time, so little is lost if the browser crashes
+    if (!recorderState->depth)
+        recorderState->out->flush();
+}
+
+void SessionRecorder::Call::end(boost::int32_t status)
+{
+    m_record->status = status;
+    m_ended = true;
+
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState || m_generation != recorderGeneration) {
+        m_active = false;
+        return;
+    }
+    m_record->duration = recorderState->elapsed() - m_record->time;
+}
+
+void SessionRecorder::Call::setTarget(const NPObject* obj)
+{
+    if (!m_active || !obj)
+        return;
+    bool pluginObject = NPJavascriptObject::isNPJavaScriptObject(obj);
+
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState || m_generation != recorderGeneration) {
+        m_active = false;
+    } else if (isBrowserCall(m_record->kind) && pluginObject) {
+        // Nothing has been called inside of this yet, so it can just be dropped
+        --recorderState->depth;
+        m_active = false;
+    } else {
+        m_record->target = RecorderState::getId(recorderState->objects, recorderState->nextObject, obj);
+    }
+}
+
+void SessionRecorder::Call::setStream(const NPStream* stream)
+{
+    if (!m_active || !stream)
+        return;
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState)
+        return;
+    m_record->target = RecorderState::getId(recorderState->streams, recorderState->nextStream, stream);
+    m_handle = stream;
+}
+
+void SessionRecorder::Call::setRequest(void* notifyData)
+{
+    if (!m_active || !notifyData)
+        return;
+    boost::mutex::scoped_lock _l(recorderMutex);
+    if (!recorderState)
+        return;
+    m_record->target = RecorderState::getId(recorderState->requests, recorderState->nextRequest, notifyData);
+    m_handle = notifyData;
+}
+
+void SessionRecorder::Call::setMember(const CapturedValue& member)
+{
+    if (m_active)
+        m_record->member = member;
+}
+
+void SessionRecorder::Call::setMember(const NpapiBrowserHost* host, NPIdentifier name)
+{
+    if (!m_active || !host || !name)
+        return;
+    if (host->IdentifierIsString(name))
+        m_record->member = CapturedValue(host->StringFromIdentifier(name));
+    else
+        m_record->member = CapturedValue(host->IntFromIdentifier(name));
+}
+
+void SessionRecorder::Call::setMember(const NpapiBrowserHostWeakPtr& host, NPIdentifier name)
+{
+    if (!m_active)
+        return;
+    NpapiBrowserHostPtr ptr(host.lock());
+    setMember(ptr.get(), name);
+}
+
+void SessionRecorder::Call::setArgs(const NPVariant* args, boost::uint32_t argCount)
+{
+    if (!m_active)
+        return;
+    for (boost::uint32_t i = 0; args && i < argCount; ++i)
+        m_record->args.push_back(capture(args[i]));
+}
+
+void SessionRecorder::Call::addArg(const CapturedValue& arg)
+{
+    if (m_active)
+        m_record->args.push_back(arg);
+}
+
+void SessionRecorder::Call::addIdentifiers(const NpapiBrowserHost* host, const NPIdentifier* names, boost::uint32_t count)
+{
+    if (!m_active || !host)
+        return;
+    for (boost::uint32_t i = 0; names && i < count; ++i) {
+        if (host->IdentifierIsString(names[i]))
+            m_record->args.push_back(CapturedValue(host->StringFromIdentifier(names[i])));
+        else
+            m_record->args.push_back(CapturedValue(host->IntFromIdentifier(names[i])));
+    }
+}
+
+void SessionRecorder::Call::setData(const void* data, size_t len)
+{
+    if (m_active && data)
+        m_record->data.assign(static_cast<const char*>(data), len);
+}
+
+void SessionRecorder::Call::setResult(const CapturedValue& result)
+{
+    if (m_active)
+        m_record->result = result;
+}
+
+void SessionRecorder::Call::setResult(const NPVariant* result)
+{
+    if (m_active && result)
+        m_record->result = capture(*result);
+}
+
+CapturedValue SessionRecorder::Call::capture(const NPVariant& value)
+{
+    switch (value.type) {
+    case NPVariantType_Null:
+        return CapturedValue::null();
+    case NPVariantType_Bool:
+        return CapturedValue::boolean(value.value.boolValue);
+    case NPVariantType_Int32:
+        return CapturedValue(value.value.intValue);
+    case NPVariantType_Double:
+        return CapturedValue::number(value.value.doubleValue);
+    case NPVariantType_String:
+        return CapturedValue(std::string(value.value.stringValue.UTF8Characters, value.value.stringValue.UTF8Length));
+    case NPVariantType_Object: {
+        NPObject* obj = value.value.objectValue;
+        CapturedValue::Type type = NPJavascriptObject::isNPJavaScriptObject(obj)
+            ? CapturedValue::PluginObject : CapturedValue::BrowserObject;
+        boost::mutex::scoped_lock _l(recorderMutex);
+        if (!recorderState)
+            return CapturedValue();
+        return CapturedValue::object(type, RecorderState::getId(recorderState->objects, recorderState->nextObject, obj)); }
+    default:
+        return CapturedValue();
+    }
+}
@@ -0,0 +1,134 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_NPAPI_NPAPISESSIONRECORDER
+#define H_FB_NPAPI_NPAPISESSIONRECORDER
+
+#include <string>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include "NpapiTypes.h"
+#include "FBPointers.h"
+#include "NpapiSessionCapture.h"
+
+namespace FB { namespace Npapi {
+
+    FB_FORWARD_PTR(NpapiBrowserHost);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  SessionRecorder
+    ///
+    /// @brief  Records the calls made across the NPAPI boundary -- the NPP_ functions, calls on the
+    ///         plugin's scriptable objects, the plugin's calls on browser objects and the NpapiStream
+    ///         callbacks -- so that SessionReplayer can play the session back later.
+    ///
+    /// Recording is off unless start() is called, or the FB_NPAPI_CAPTURE environment variable names
+    /// a file when the plugin module is loaded; while it is off each entry point only checks a
+    /// flag.  Every plugin instance in the process is recorded into the same capture.
+    ///
+    /// @code
+    ///      FB::Npapi::SessionRecorder::start("/tmp/slow-page.fbcap");
+    ///      // ... load the page ...
+    ///      FB::Npapi::SessionRecorder::stop();
+    /// @endcode
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class SessionRecorder : boost::noncopyable
+    {
+    public:
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static void SessionRecorder::start(const std::string& path = std::string())
+        ///
+        /// @brief  Starts recording, into the file at path, or into memory if path is empty.
+        ///
+        /// @throws std::runtime_error if the file can't be written
+        /// @throws std::logic_error if already recording
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static void start(const std::string& path = std::string());
+        // Stops recording; returns the capture if it was recorded into memory
+        static SessionCapture stop();
+        static bool isRecording() { return s_recording.load(boost::memory_order_acquire); }
+        // Called as a plugin object is deleted, so a new object at the same address gets a new id
+        static void forgetObject(const NPObject* obj);
+        // The id of a URL request the plugin made, from its notifyData; 0 if it wasn't recorded
+        static boost::uint32_t getRequestId(void* notifyData);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @class  SessionRecorder::Call
+        ///
+        /// @brief  Records one call, from when it is made until the Call goes out of scope.  Does
+        ///         nothing if the recorder wasn't recording when it was made.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        class Call : boost::noncopyable
+        {
+        public:
+            explicit Call(CaptureKind kind);
+            ~Call();
+
+            bool isActive() const { return m_active; }
+
+            // Calls the plugin makes on its own objects through the browser aren't recorded
+            void setTarget(const NPObject* obj);
+            void setStream(const NPStream* stream);
+            void setRequest(void* notifyData);
+            void setMember(const CapturedValue& member);
+            void setMember(const NpapiBrowserHost* host, NPIdentifier name);
+            void setMember(const NpapiBrowserHostWeakPtr& host, NPIdentifier name);
+            void setArgs(const NPVariant* args, boost::uint32_t argCount);
+            void addArg(const CapturedValue& arg);
+            void addIdentifiers(const NpapiBrowserHost* host, const NPIdentifier* names, boost::uint32_t count);
+            void setData(const void* data, size_t len);
+            void setResult(const CapturedValue& result);
+            void setResult(const NPVariant* result);
+
+            // Marks the call as returned, and passes status back
+            template <class T>
+            T finish(T status)
+            {
+                if (m_active)
+                    end(static_cast<boost::int32_t>(status));
+                return status;
+            }
+            template <class T>
+            T finish(T status, const NPVariant* result)
+            {
+                if (m_active && status)
+                    setResult(result);
+                return finish(status);
+            }
+
+        private:
+            void end(boost::int32_t status);
+            CapturedValue capture(const NPVariant& value);
+
+            bool m_active;
+            bool m_ended;
+            boost::uint32_t m_generation;
+            // The stream or notifyData the call was about
+            const void* m_handle;
+            // Only made while recording, so an entry point pays for no more than the flag otherwise
+            boost::optional<CaptureRecord> m_record;
+        };
+
+    private:
+        friend class Call;
+        static boost::atomic<bool> s_recording;
+    };
+
+}; };
+
+#endif // H_FB_NPAPI_NPAPISESSIONRECORDER
@@ -14,6 +14,7 @@ Copyright 2010 Richard Bateman, Firebreath development team
 
 #include "NpapiPlugin.h"
 #include "NpapiStream.h"
+#include "NpapiSessionRecorder.h"
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 #undef min
 
@@ -83,6 +84,8 @@ int32_t NpapiStream::signalDataArrived(void* buffer, int32_t len, int32_t offset
         }
         if ( isOpen() ) 
         {
+            SessionRecorder::Call call(Capture_StreamDataArrived);
+            call.setStream(getStream());
             StreamDataArrivedEvent ev(this, buffer, effectiveLen, offset, progress);
             SendEvent( &ev );
         }
@@ -93,12 +96,16 @@ int32_t NpapiStream::signalDataArrived(void* buffer, int32_t len, int32_t offset
 void NpapiStream::signalOpened()
 {
     setOpen( true );
+    SessionRecorder::Call call(Capture_StreamOpened);
+    call.setStream(getStream());
     StreamOpenedEvent ev(this);
     SendEvent( &ev );
 }
 
 void NpapiStream::signalFailedOpen()
 {
+    SessionRecorder::Call call(Capture_StreamFailedOpen);
+    call.setStream(getStream());
     StreamFailedOpenEvent ev(this);
     SendEvent( &ev );
 }
@@ -111,6 +118,8 @@ void NpapiStream::signalCompleted(bool success)
     if ( isCompleted() ) return;                // If already completed, don't send event again
 
     setCompleted( true );
+    SessionRecorder::Call call(Capture_StreamCompleted);
+    call.setStream(getStream());
 
     /*if ( !isOpen() && !success )
     {
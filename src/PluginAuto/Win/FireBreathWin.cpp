@@ -22,6 +22,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "FBControl.h"
 #include "axutil.h"
 #include "PluginCore.h"
+#include "Reactor.h"
 #include <boost/algorithm/string.hpp>
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
@@ -40,6 +41,7 @@ STDAPI DllCanUnloadNow(void)
         // would like to unload the DLL) and there are no active plugins it will call Deinitialize
         // because some systems it never returned S_OK :-( Would love to know why and fix it correctly...
         getFactoryInstance()->globalPluginDeinitialize();
+        FB::Reactor::shutdownInstance();
         FB::Log::stopLogging();
         flagStaticInitialized(false);
     }
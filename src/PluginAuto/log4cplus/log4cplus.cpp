@@ -17,6 +17,7 @@ Copyright 2010 Facebook, Inc
 
 #include "FactoryBase.h"
 #include "logging.h"
+#include "LogFilter.h"
 #include "utf8_tools.h"
 
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
@@ -34,9 +35,12 @@ Copyright 2010 Facebook, Inc
 namespace 
 {
     bool logging_started = false;
+    // Created once and kept, since other threads may be logging through it at any time
+    boost::scoped_ptr<FB::Log::LogFilter> log_filter;
 }
 
 static log4cplus::LogLevel translate_logLevel(FB::Log::LogLevel ll);
+static void write_log(FB::Log::LogLevel ll, const std::string& src, const std::string& msg, const char *file, int line, const char *fn);
 
 void FB::Log::initLogging()
 {
@@ -88,11 +92,19 @@ void FB::Log::initLogging()
         logger.addAppender(nullAppender);
     }
     
+    if (!log_filter) {
+        FB::Log::LogFilter::Options options;
+        getFactoryInstance()->getLogFilterOptions(options);
+        log_filter.reset(new FB::Log::LogFilter(&write_log, options));
+    }
+
     logging_started = true;
 }
 
 void FB::Log::stopLogging()
 {
+    if (log_filter)
+        log_filter->flush();
     log4cplus::Logger logger = log4cplus::Logger::getInstance(L"FireBreath");
     logger.shutdown();
     logging_started = false;
@@ -116,34 +128,44 @@ static log4cplus::LogLevel translate_logLevel(FB::Log::LogLevel ll){
     }
 }
 
+static void write_log(FB::Log::LogLevel ll, const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log4cplus::tostringstream os;
+    os << file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg);
+    log4cplus::Logger::getInstance(L"FireBreath").forcedLog(translate_logLevel(ll), os.str(), file, line);
+}
+
+static void filter_log(FB::Log::LogLevel ll, const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
+{
+    if (!log4cplus::Logger::getInstance(L"FireBreath").isEnabledFor(translate_logLevel(ll)))
+        return;
+    if (log_filter)
+        log_filter->log(ll, src, msg, file, line, fn);
+    else
+        write_log(ll, src, msg, file, line, fn);
+}
+
 void FB::Log::trace(const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
 {
-    LOG4CPLUS_TRACE(log4cplus::Logger::getInstance(L"FireBreath"), 
-                    file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg));
+    filter_log(FB::Log::LogLevel_Trace, src, msg, file, line, fn);
 }
 void FB::Log::debug(const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
 {
-    LOG4CPLUS_DEBUG(log4cplus::Logger::getInstance(L"FireBreath"), 
-                    file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg));
+    filter_log(FB::Log::LogLevel_Debug, src, msg, file, line, fn);
 }
 void FB::Log::info(const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
 {
-    LOG4CPLUS_INFO(log4cplus::Logger::getInstance(L"FireBreath"), 
-                   file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg));
+    filter_log(FB::Log::LogLevel_Info, src, msg, file, line, fn);
 }
 void FB::Log::warn(const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
 {
-    LOG4CPLUS_WARN(log4cplus::Logger::getInstance(L"FireBreath"), 
-                   file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg));
+    filter_log(FB::Log::LogLevel_Warn, src, msg, file, line, fn);
 }
 void FB::Log::error(const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
 {
-    LOG4CPLUS_ERROR(log4cplus::Logger::getInstance(L"FireBreath"), 
-                    file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg));
+    filter_log(FB::Log::LogLevel_Error, src, msg, file, line, fn);
 }
 void FB::Log::fatal(const std::string& src, const std::string& msg, const char *file, int line, const char *fn)
 {
-    LOG4CPLUS_ERROR(log4cplus::Logger::getInstance(L"FireBreath"), 
-                    file << ":" << line << " - " << fn << " - " << FB::utf8_to_wstring(msg));
+    filter_log(FB::Log::LogLevel_Error, src, msg, file, line, fn);
 }
-
@@ -0,0 +1,227 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <algorithm>
+#include <cstring>
+#include <boost/bind.hpp>
+#include "JSExceptions.h"
+#include "variant_list.h"
+#include "AsyncFileAPI.h"
+
+using namespace FB;
+
+namespace {
+    const size_t default_chunk_size = 256 * 1024;
+    const size_t default_read_ahead = 4;
+    const size_t max_read_ahead = 64;
+
+    const char b64chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string base64_encode(const uint8_t* data, size_t size)
+    {
+        std::string out;
+        out.reserve((size + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 2 < size; i += 3) {
+            uint32_t n = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            out += b64chars[n >> 18];
+            out += b64chars[(n >> 12) & 63];
+            out += b64chars[(n >> 6) & 63];
+            out += b64chars[n & 63];
+        }
+        if (i < size) {
+            uint32_t n = data[i] << 16;
+            if (i + 1 < size)
+                n |= data[i + 1] << 8;
+            out += b64chars[n >> 18];
+            out += b64chars[(n >> 12) & 63];
+            out += (i + 1 < size) ? b64chars[(n >> 6) & 63] : '=';
+            out += '=';
+        }
+        return out;
+    }
+
+    // Whitespace is skipped; anything else that isn't base64 is an error
+    size_t base64_decode(const std::string& in, const boost::shared_array<uint8_t>& out)
+    {
+        size_t len = 0;
+        uint32_t n = 0;
+        int bits = 0;
+        for (std::string::const_iterator it = in.begin(); it != in.end(); ++it) {
+            char c = *it;
+            if (c == '=')
+                break;
+            if (c == ' ' || c == '\r' || c == '\n' || c == '\t')
+                continue;
+            const char* p = strchr(b64chars, c);
+            if (!c || !p)
+                throw FB::invalid_arguments("Data is not valid base64");
+            n = (n << 6) | static_cast<uint32_t>(p - b64chars);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out[len++] = static_cast<uint8_t>(n >> bits);
+            }
+        }
+        return len;
+    }
+
+    void invoke_callback(const FB::JSObjectPtr& callback, const FB::VariantList& args)
+    {
+        try {
+            callback->InvokeAsync("", args);
+        } catch (const std::exception&) {
+            // The page or the browser is going away
+        }
+    }
+
+    void read_done(const FB::JSObjectPtr& callback, bool success, const boost::shared_array<uint8_t>& data, size_t size,
+        const std::string& error)
+    {
+        if (success)
+            invoke_callback(callback, FB::variant_list_of(FB::FBNull())(base64_encode(data.get(), size)));
+        else
+            invoke_callback(callback, FB::variant_list_of(error));
+    }
+
+    void write_done(const FB::JSObjectPtr& callback, bool success, size_t written, const std::string& error)
+    {
+        if (success)
+            invoke_callback(callback, FB::variant_list_of(FB::FBNull())(written));
+        else
+            invoke_callback(callback, FB::variant_list_of(error)(written));
+    }
+}
+
+const size_t AsyncFileAPI::maxReadSize;
+
+AsyncFileAPI::AsyncFileAPI(const AsyncFilePtr& file)
+    : m_file(file)
+{
+    registerMethod("read", make_method(this, &AsyncFileAPI::read));
+    registerMethod("write", make_method(this, &AsyncFileAPI::write));
+    registerMethod("openStream", make_method(this, &AsyncFileAPI::openStream));
+    registerProperty("size", make_property(this, &AsyncFileAPI::get_size));
+}
+
+AsyncFileAPI::~AsyncFileAPI()
+{
+}
+
+void AsyncFileAPI::read(boost::uint64_t offset, size_t length, const FB::JSObjectPtr& callback)
+{
+    if (!callback)
+        throw FB::invalid_arguments("A callback is required");
+    m_file->read(offset, std::min(length, maxReadSize), boost::bind(&read_done, callback, _1, _2, _3, _4));
+}
+
+void AsyncFileAPI::write(boost::uint64_t offset, const std::string& data, const FB::JSObjectPtr& callback)
+{
+    boost::shared_array<uint8_t> buf(new uint8_t[data.size() / 4 * 3 + 3]);
+    size_t size = base64_decode(data, buf);
+    if (callback)
+        m_file->write(offset, buf, size, boost::bind(&write_done, callback, _1, _2, _3));
+    else
+        m_file->write(offset, buf, size, AsyncWriteCallback());
+}
+
+FB::JSAPIPtr AsyncFileAPI::openStream(boost::uint64_t offset, const boost::optional<double>& length,
+    const boost::optional<size_t>& chunkSize, const boost::optional<size_t>& readAhead)
+{
+    boost::uint64_t len = length && *length >= 0 ? static_cast<boost::uint64_t>(*length) : ~boost::uint64_t(0);
+    return AsyncFileStreamAPI::create(m_file, offset, len,
+        std::min(chunkSize.get_value_or(default_chunk_size), maxReadSize),
+        std::min(readAhead.get_value_or(default_read_ahead), max_read_ahead));
+}
+
+double AsyncFileAPI::get_size() const
+{
+    return static_cast<double>(m_file->size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileStreamAPI
+///////////////////////////////////////////////////////////////////////////////
+
+AsyncFileStreamAPIPtr AsyncFileStreamAPI::create(const AsyncFilePtr& file, boost::uint64_t offset, boost::uint64_t length,
+    size_t chunkSize, size_t readAhead)
+{
+    AsyncFileStreamAPIPtr stream(new AsyncFileStreamAPI());
+    AsyncFileStreamAPIWeakPtr weak(stream);
+    stream->m_reader = AsyncFileReader::create(file, offset, length, chunkSize, readAhead,
+        boost::bind(&AsyncFileStreamAPI::onChunk, weak, _1, _2, _3),
+        boost::bind(&AsyncFileStreamAPI::onDone, weak, _1, _2));
+    return stream;
+}
+
+AsyncFileStreamAPI::AsyncFileStreamAPI()
+{
+    registerMethod("grant", make_method(this, &AsyncFileStreamAPI::grant));
+    registerMethod("cancel", make_method(this, &AsyncFileStreamAPI::cancel));
+    registerProperty("credits", make_property(this, &AsyncFileStreamAPI::get_credits));
+    registerProperty("position", make_property(this, &AsyncFileStreamAPI::get_position));
+    registerProperty("finished", make_property(this, &AsyncFileStreamAPI::get_finished));
+}
+
+AsyncFileStreamAPI::~AsyncFileStreamAPI()
+{
+    // The page let go of the stream; stop reading for it
+    if (m_reader)
+        m_reader->cancel();
+}
+
+void AsyncFileStreamAPI::onChunk(const AsyncFileStreamAPIWeakPtr& weak, boost::uint64_t offset,
+    const boost::shared_array<uint8_t>& data, size_t size)
+{
+    AsyncFileStreamAPIPtr self(weak.lock());
+    if (self)
+        self->FireEvent("onchunk", FB::variant_list_of(static_cast<double>(offset))(base64_encode(data.get(), size)));
+}
+
+void AsyncFileStreamAPI::onDone(const AsyncFileStreamAPIWeakPtr& weak, bool success, const std::string& error)
+{
+    AsyncFileStreamAPIPtr self(weak.lock());
+    if (!self)
+        return;
+    if (success)
+        self->FireEvent("onend", FB::VariantList());
+    else
+        self->FireEvent("onerror", FB::variant_list_of(error));
+}
+
+void AsyncFileStreamAPI::grant(size_t count)
+{
+    m_reader->grant(count);
+}
+
+void AsyncFileStreamAPI::cancel()
+{
+    m_reader->cancel();
+}
+
+size_t AsyncFileStreamAPI::get_credits() const
+{
+    return m_reader->getCredits();
+}
+
+double AsyncFileStreamAPI::get_position() const
+{
+    return static_cast<double>(m_reader->getPosition());
+}
+
+bool AsyncFileStreamAPI::get_finished() const
+{
+    return m_reader->isFinished();
+}
@@ -0,0 +1,120 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_ASYNCFILEAPI
+#define H_FB_ASYNCFILEAPI
+
+#include <boost/optional.hpp>
+#include "JSAPIAuto.h"
+#include "JSObject.h"
+#include "AsyncFileService.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(AsyncFileAPI);
+    FB_FORWARD_PTR(AsyncFileStreamAPI);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  AsyncFileAPI
+    ///
+    /// @brief  Exposes an AsyncFile to javascript.
+    ///
+    /// The plugin decides which file the page gets to see and how it is opened; the page can then
+    /// only read and write that one file:
+    /// @code
+    ///      FB::JSAPIPtr MyPluginAPI::openLog() {
+    ///          return boost::make_shared<FB::AsyncFileAPI>(
+    ///              FB::AsyncFile::open(m_logPath, FB::AsyncFile::OPEN_READ));
+    ///      }
+    ///
+    ///      // in the page
+    ///      var stream = file.openStream(0);
+    ///      stream.addEventListener("chunk", function(offset, data) { ...; stream.grant(1); });
+    ///      stream.grant(4);
+    /// @endcode
+    ///
+    /// Data crosses to the page base64 encoded. Callbacks are called as callback(error, result),
+    /// with error null on success.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class AsyncFileAPI : public FB::JSAPIAuto
+    {
+    public:
+        explicit AsyncFileAPI(const AsyncFilePtr& file);
+        virtual ~AsyncFileAPI();
+
+        // callback(error, data); length is capped at maxReadSize
+        void read(boost::uint64_t offset, size_t length, const FB::JSObjectPtr& callback);
+        // callback(error, bytesWritten)
+        void write(boost::uint64_t offset, const std::string& data, const FB::JSObjectPtr& callback);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn FB::JSAPIPtr AsyncFileAPI::openStream(boost::uint64_t offset,
+        ///     const boost::optional<double>& length, const boost::optional<size_t>& chunkSize,
+        ///     const boost::optional<size_t>& readAhead)
+        ///
+        /// @brief  Returns an AsyncFileStreamAPI that reads length bytes from offset (by default to the
+        ///         end of the file) in chunks of chunkSize (default 256KiB, at most maxReadSize), reading
+        ///         up to readAhead (default 4, at most 64) chunks ahead.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        FB::JSAPIPtr openStream(boost::uint64_t offset, const boost::optional<double>& length,
+            const boost::optional<size_t>& chunkSize, const boost::optional<size_t>& readAhead);
+
+        double get_size() const;
+
+        static const size_t maxReadSize = 16 * 1024 * 1024;
+
+    protected:
+        AsyncFilePtr m_file;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  AsyncFileStreamAPI
+    ///
+    /// @brief  An AsyncFileReader driven from javascript.
+    ///
+    /// Fires "chunk" (offset, data) once per credit granted with grant(), then "end", or "error"
+    /// (message) if a read fails. The page grants a credit back for each chunk it has finished with,
+    /// so how far the plugin reads ahead of the page is bounded by the credits outstanding.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class AsyncFileStreamAPI : public FB::JSAPIAuto
+    {
+    public:
+        static AsyncFileStreamAPIPtr create(const AsyncFilePtr& file, boost::uint64_t offset, boost::uint64_t length,
+            size_t chunkSize, size_t readAhead);
+        virtual ~AsyncFileStreamAPI();
+
+        void grant(size_t count);
+        void cancel();
+
+        size_t get_credits() const;
+        double get_position() const;
+        bool get_finished() const;
+
+    protected:
+        AsyncFileStreamAPI();
+        static void onChunk(const AsyncFileStreamAPIWeakPtr& weak, boost::uint64_t offset,
+            const boost::shared_array<uint8_t>& data, size_t size);
+        static void onDone(const AsyncFileStreamAPIWeakPtr& weak, bool success, const std::string& error);
+
+        AsyncFileReaderPtr m_reader;
+    };
+};
+
+#endif // H_FB_ASYNCFILEAPI
+
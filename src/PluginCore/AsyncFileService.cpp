@@ -0,0 +1,421 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "win_targetver.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#ifdef FB_WIN
+#include <windows.h>
+#include "utf8_tools.h"
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+#include "logging.h"
+#include "AsyncFileService.h"
+
+using namespace FB;
+
+namespace {
+    const size_t default_workers = 4;
+
+    void run_worker(boost::shared_ptr<boost::asio::io_service> io)
+    {
+        io->run();
+    }
+
+    void safe_call(const boost::function<void ()>& func)
+    {
+        // An exception escaping run() would take the worker down with it
+        try {
+            func();
+        } catch (const std::exception& e) {
+            FBLOG_ERROR("AsyncFileService", "Unhandled exception in file operation: " << e.what());
+        } catch (...) {
+            FBLOG_ERROR("AsyncFileService", "Unhandled exception in file operation");
+        }
+    }
+
+    std::string last_error()
+    {
+#ifdef FB_WIN
+        return "error " + boost::lexical_cast<std::string>(::GetLastError());
+#else
+        return strerror(errno);
+#endif
+    }
+}
+
+namespace FB {
+    class AsyncFileServicePimpl {
+    public:
+        AsyncFileServicePimpl() :
+            io_service(new boost::asio::io_service()),
+            io_idlework(new boost::asio::io_service::work(*io_service)) {}
+
+        ~AsyncFileServicePimpl() {
+            // Let the queue drain, then wait for the workers; the last AsyncFile can be released on
+            // a worker, in which case that one finishes on its own
+            io_idlework.reset();
+            for (std::vector<boost::shared_ptr<boost::thread> >::iterator it = threads.begin(); it != threads.end(); ++it) {
+                if ((*it)->get_id() == boost::this_thread::get_id())
+                    (*it)->detach();
+                else
+                    (*it)->join();
+            }
+        }
+
+        // Shared with the workers, so a worker that outlives the service still has it
+        boost::shared_ptr<boost::asio::io_service> io_service;
+        boost::scoped_ptr<boost::asio::io_service::work> io_idlework;
+        std::vector<boost::shared_ptr<boost::thread> > threads;
+    };
+};
+
+AsyncFileServiceWeakPtr AsyncFileService::inst;
+boost::mutex AsyncFileService::instance_mutex;
+
+AsyncFileServicePtr AsyncFileService::instance()
+{
+    boost::mutex::scoped_lock lock(instance_mutex);
+    AsyncFileServicePtr service(inst.lock());
+    if (!service) {
+        service = create(default_workers);
+        inst = service;
+    }
+    return service;
+}
+
+AsyncFileServicePtr AsyncFileService::create(size_t workers)
+{
+    return AsyncFileServicePtr(new AsyncFileService(workers));
+}
+
+AsyncFileService::AsyncFileService(size_t workers) : m_workers(std::max(workers, size_t(1))), pimpl(new AsyncFileServicePimpl)
+{
+    for (size_t i = 0; i < m_workers; ++i) {
+        pimpl->threads.push_back(boost::shared_ptr<boost::thread>(
+            new boost::thread(boost::bind(&run_worker, pimpl->io_service))));
+    }
+}
+
+AsyncFileService::~AsyncFileService()
+{
+}
+
+void AsyncFileService::post(const boost::function<void ()>& func)
+{
+    pimpl->io_service->post(boost::bind(&safe_call, func));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFile
+///////////////////////////////////////////////////////////////////////////////
+
+AsyncFile::AsyncFile(const std::string& path, const AsyncFileServicePtr& service)
+    : m_path(path), m_service(service)
+{
+}
+
+AsyncFilePtr AsyncFile::open(const std::string& path, int flags, const AsyncFileServicePtr& service)
+{
+    AsyncFilePtr file(new AsyncFile(path, service ? service : AsyncFileService::instance()));
+    bool writing = (flags & OPEN_WRITE) != 0;
+#ifdef FB_WIN
+    DWORD access = ((flags & OPEN_READ) ? GENERIC_READ : 0) | (writing ? GENERIC_WRITE : 0);
+    DWORD disposition = OPEN_EXISTING;
+    if (writing && (flags & OPEN_CREATE))
+        disposition = (flags & OPEN_TRUNCATE) ? CREATE_ALWAYS : OPEN_ALWAYS;
+    else if (writing && (flags & OPEN_TRUNCATE))
+        disposition = TRUNCATE_EXISTING;
+    HANDLE h = ::CreateFileW(FB::utf8_to_wstring(path).c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, disposition, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Could not open " + path + ": " + last_error());
+    file->m_handle = h;
+#else
+    int oflags = writing ? ((flags & OPEN_READ) ? O_RDWR : O_WRONLY) : O_RDONLY;
+    if (writing && (flags & OPEN_CREATE))
+        oflags |= O_CREAT;
+    if (writing && (flags & OPEN_TRUNCATE))
+        oflags |= O_TRUNC;
+#ifdef O_CLOEXEC
+    oflags |= O_CLOEXEC;
+#endif
+    int fd;
+    do {
+        fd = ::open(path.c_str(), oflags, 0666);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+        throw std::runtime_error("Could not open " + path + ": " + last_error());
+    file->m_fd = fd;
+#endif
+    return file;
+}
+
+AsyncFile::~AsyncFile()
+{
+#ifdef FB_WIN
+    ::CloseHandle(m_handle);
+#else
+    ::close(m_fd);
+#endif
+}
+
+void AsyncFile::read(boost::uint64_t offset, size_t length, const AsyncReadCallback& callback)
+{
+    m_service->post(boost::bind(&AsyncFile::do_read, shared_from_this(), offset, length, callback));
+}
+
+void AsyncFile::write(boost::uint64_t offset, const boost::shared_array<uint8_t>& data, size_t size, const AsyncWriteCallback& callback)
+{
+    m_service->post(boost::bind(&AsyncFile::do_write, shared_from_this(), offset, data, size, callback));
+}
+
+void AsyncFile::do_read(boost::uint64_t offset, size_t length, const AsyncReadCallback& callback)
+{
+    boost::shared_array<uint8_t> buf(new uint8_t[std::max(length, size_t(1))]);
+    size_t done = 0;
+    while (done < length) {
+#ifdef FB_WIN
+        OVERLAPPED ov = {};
+        ov.Offset = static_cast<DWORD>(offset + done);
+        ov.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+        DWORD got = 0;
+        if (!::ReadFile(m_handle, buf.get() + done, static_cast<DWORD>(length - done), &got, &ov)) {
+            if (::GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            callback(false, boost::shared_array<uint8_t>(), 0, last_error());
+            return;
+        }
+#else
+        ssize_t got = ::pread(m_fd, buf.get() + done, length - done, static_cast<off_t>(offset + done));
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            callback(false, boost::shared_array<uint8_t>(), 0, last_error());
+            return;
+        }
+#endif
+        if (got == 0)
+            break; // end of file
+        done += got;
+    }
+    callback(true, buf, done, std::string());
+}
+
+void AsyncFile::do_write(boost::uint64_t offset, const boost::shared_array<uint8_t>& data, size_t size, const AsyncWriteCallback& callback)
+{
+    size_t done = 0;
+    while (done < size) {
+#ifdef FB_WIN
+        OVERLAPPED ov = {};
+        ov.Offset = static_cast<DWORD>(offset + done);
+        ov.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+        DWORD put = 0;
+        if (!::WriteFile(m_handle, data.get() + done, static_cast<DWORD>(size - done), &put, &ov)) {
+            callback(false, done, last_error());
+            return;
+        }
+#else
+        ssize_t put = ::pwrite(m_fd, data.get() + done, size - done, static_cast<off_t>(offset + done));
+        if (put < 0) {
+            if (errno == EINTR)
+                continue;
+            callback(false, done, last_error());
+            return;
+        }
+#endif
+        done += put;
+    }
+    callback(true, done, std::string());
+}
+
+namespace {
+#if !defined(FB_WIN) && defined(POSIX_FADV_WILLNEED)
+    void advise_willneed(const AsyncFilePtr& file, int fd, boost::uint64_t offset, boost::uint64_t length)
+    {
+        ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+void AsyncFile::willNeed(boost::uint64_t offset, boost::uint64_t length)
+{
+    // The advice itself can block while the kernel queues the reads, so it goes to a worker too
+#if !defined(FB_WIN) && defined(POSIX_FADV_WILLNEED)
+    m_service->post(boost::bind(&advise_willneed, shared_from_this(), m_fd, offset, length));
+#endif
+}
+
+boost::uint64_t AsyncFile::size() const
+{
+#ifdef FB_WIN
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(m_handle, &size))
+        return 0;
+    return static_cast<boost::uint64_t>(size.QuadPart);
+#else
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0)
+        return 0;
+    return static_cast<boost::uint64_t>(st.st_size);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileReader
+///////////////////////////////////////////////////////////////////////////////
+
+AsyncFileReaderPtr AsyncFileReader::create(const AsyncFilePtr& file, boost::uint64_t offset, boost::uint64_t length,
+    size_t chunkSize, size_t readAhead, const ChunkCallback& onChunk, const DoneCallback& onDone)
+{
+    boost::uint64_t fileSize(file->size());
+    offset = std::min(offset, fileSize);
+    boost::uint64_t end = offset + std::min(length, fileSize - offset);
+    AsyncFileReaderPtr reader(new AsyncFileReader(file, offset, end, std::max(chunkSize, size_t(1)),
+        std::max(readAhead, size_t(1)), onChunk, onDone));
+    boost::mutex::scoped_lock lock(reader->m_mutex);
+    reader->fill();
+    reader->pump(lock); // an empty range is done right away
+    return reader;
+}
+
+AsyncFileReader::AsyncFileReader(const AsyncFilePtr& file, boost::uint64_t offset, boost::uint64_t end, size_t chunkSize,
+    size_t readAhead, const ChunkCallback& onChunk, const DoneCallback& onDone)
+    : m_file(file), m_end(end), m_chunkSize(chunkSize), m_readAhead(readAhead), m_onChunk(onChunk), m_onDone(onDone),
+      m_nextRead(offset), m_nextDeliver(offset), m_inFlight(0), m_credits(0), m_delivering(false),
+      m_finished(false), m_failed(false)
+{
+}
+
+void AsyncFileReader::grant(size_t count)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_credits += count;
+    pump(lock);
+}
+
+void AsyncFileReader::cancel()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_finished = true;
+    m_ready.clear();
+}
+
+size_t AsyncFileReader::getCredits() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_credits;
+}
+
+boost::uint64_t AsyncFileReader::getPosition() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_nextDeliver;
+}
+
+bool AsyncFileReader::isFinished() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_finished;
+}
+
+void AsyncFileReader::fill()
+{
+    if (m_finished || m_failed)
+        return;
+    boost::uint64_t hintFrom(m_nextRead);
+    while (m_inFlight + m_ready.size() < m_readAhead && m_nextRead < m_end) {
+        size_t len = static_cast<size_t>(std::min(boost::uint64_t(m_chunkSize), m_end - m_nextRead));
+        m_file->read(m_nextRead, len, boost::bind(&AsyncFileReader::onRead, shared_from_this(), m_nextRead, _1, _2, _3, _4));
+        m_nextRead += len;
+        ++m_inFlight;
+    }
+    // Have the next window on its way into the OS cache by the time it's asked for
+    if (m_nextRead > hintFrom && m_nextRead < m_end)
+        m_file->willNeed(m_nextRead, std::min(boost::uint64_t(m_chunkSize) * m_readAhead, m_end - m_nextRead));
+}
+
+void AsyncFileReader::onRead(boost::uint64_t offset, bool success, const boost::shared_array<uint8_t>& data, size_t size,
+    const std::string& error)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    --m_inFlight;
+    if (m_finished || m_failed)
+        return;
+    if (!success) {
+        m_failed = true;
+        m_error = error;
+        m_ready.clear();
+    } else {
+        boost::uint64_t expected(std::min(boost::uint64_t(m_chunkSize), m_end - offset));
+        if (size < expected) {
+            // The file got shorter since we started; it now ends here
+            m_end = offset + size;
+            m_ready.erase(m_ready.lower_bound(m_end), m_ready.end());
+        }
+        if (size > 0) {
+            Chunk& chunk = m_ready[offset];
+            chunk.data = data;
+            chunk.size = size;
+        }
+    }
+    pump(lock);
+}
+
+void AsyncFileReader::pump(boost::mutex::scoped_lock& lock)
+{
+    // Whoever is already delivering will pick up whatever became deliverable meanwhile
+    if (m_delivering)
+        return;
+    m_delivering = true;
+    while (!m_finished) {
+        if (m_failed || m_nextDeliver >= m_end) {
+            // Done; everything before this point has been delivered
+            m_finished = true;
+            std::string error(m_error);
+            bool success = !m_failed;
+            lock.unlock();
+            if (m_onDone)
+                m_onDone(success, error);
+            lock.lock();
+            break;
+        }
+        std::map<boost::uint64_t, Chunk>::iterator it(m_ready.find(m_nextDeliver));
+        if (!m_credits || it == m_ready.end())
+            break;
+        boost::uint64_t offset(it->first);
+        Chunk chunk(it->second);
+        m_ready.erase(it);
+        --m_credits;
+        m_nextDeliver += chunk.size;
+        fill();
+        lock.unlock();
+        if (m_onChunk)
+            m_onChunk(offset, chunk.data, chunk.size);
+        lock.lock();
+    }
+    m_delivering = false;
+}
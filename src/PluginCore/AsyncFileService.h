@@ -0,0 +1,222 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_ASYNCFILESERVICE
+#define H_FB_ASYNCFILESERVICE
+
+#include <map>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "FBPointers.h"
+
+namespace FB {
+
+    class AsyncFileServicePimpl;
+    FB_FORWARD_PTR(AsyncFileService);
+    FB_FORWARD_PTR(AsyncFile);
+    FB_FORWARD_PTR(AsyncFileReader);
+
+    // success, data, size of data, error message if !success
+    typedef boost::function<void (bool, const boost::shared_array<uint8_t>&, size_t, const std::string&)> AsyncReadCallback;
+    // success, bytes written, error message if !success
+    typedef boost::function<void (bool, size_t, const std::string&)> AsyncWriteCallback;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  AsyncFileService
+    ///
+    /// @brief  A fixed pool of threads that AsyncFile reads and writes run on.
+    ///
+    /// The pool size bounds how many blocking file operations are in progress at once, however many
+    /// files or readers are active; everything else waits in the queue. Most plugins should just
+    /// use instance(), which is shared like TimerService.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class AsyncFileService : boost::noncopyable
+    {
+    public:
+        static AsyncFileServicePtr instance();
+        static AsyncFileServicePtr create(size_t workers);
+        ~AsyncFileService();
+
+        // Runs func on one of the workers
+        void post(const boost::function<void ()>& func);
+        size_t getWorkerCount() const { return m_workers; }
+
+    protected:
+        explicit AsyncFileService(size_t workers);
+
+        static AsyncFileServiceWeakPtr inst;
+        static boost::mutex instance_mutex;
+        size_t m_workers;
+
+    private:
+        boost::scoped_ptr<AsyncFileServicePimpl> pimpl;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  AsyncFile
+    ///
+    /// @brief  An open file that is read and written at explicit offsets on an AsyncFileService.
+    ///
+    /// Operations don't share a file position, so any number can be outstanding at once; callbacks
+    /// are made on the worker thread that did the operation, in whatever order they complete.
+    ///
+    /// @code
+    ///      FB::AsyncFilePtr file(FB::AsyncFile::open(path, FB::AsyncFile::OPEN_READ));
+    ///      file->read(0, 4096, boost::bind(&MyPluginAPI::onHeader, this, _1, _2, _3, _4));
+    /// @endcode
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class AsyncFile : public boost::enable_shared_from_this<AsyncFile>, boost::noncopyable
+    {
+    public:
+        enum OpenFlags {
+            OPEN_READ = 1,
+            OPEN_WRITE = 2,
+            OPEN_CREATE = 4,    // with OPEN_WRITE, create the file if it doesn't exist
+            OPEN_TRUNCATE = 8   // with OPEN_WRITE, empty the file first
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static AsyncFilePtr AsyncFile::open(const std::string& path, int flags,
+        ///     const AsyncFileServicePtr& service = AsyncFileServicePtr())
+        ///
+        /// @brief  Opens path (UTF-8) with a combination of OpenFlags; operations run on service, or on
+        ///         AsyncFileService::instance() if none is given.
+        ///
+        /// @throws std::runtime_error if the file can't be opened
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static AsyncFilePtr open(const std::string& path, int flags, const AsyncFileServicePtr& service = AsyncFileServicePtr());
+        // Closes the file; pending operations keep it open until they finish
+        ~AsyncFile();
+
+        void read(boost::uint64_t offset, size_t length, const AsyncReadCallback& callback);
+        void write(boost::uint64_t offset, const boost::shared_array<uint8_t>& data, size_t size, const AsyncWriteCallback& callback);
+
+        // Lets the OS start reading the range into its cache ahead of reads; may do nothing
+        void willNeed(boost::uint64_t offset, boost::uint64_t length);
+        // Current size of the file, or 0 if it can't be determined
+        boost::uint64_t size() const;
+        const std::string& getPath() const { return m_path; }
+        const AsyncFileServicePtr& getService() const { return m_service; }
+
+    protected:
+        AsyncFile(const std::string& path, const AsyncFileServicePtr& service);
+        void do_read(boost::uint64_t offset, size_t length, const AsyncReadCallback& callback);
+        void do_write(boost::uint64_t offset, const boost::shared_array<uint8_t>& data, size_t size, const AsyncWriteCallback& callback);
+
+        std::string m_path;
+        AsyncFileServicePtr m_service;
+#ifdef FB_WIN
+        void* m_handle;
+#else
+        int m_fd;
+#endif
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  AsyncFileReader
+    ///
+    /// @brief  Reads a range of an AsyncFile sequentially in chunks, with read-ahead and credit-based
+    ///         flow control.
+    ///
+    /// The consumer is handed one chunk per credit, in file order; it grants more credits as it
+    /// finishes with them, so a slow consumer stalls the reader instead of piling up data. Up to
+    /// readAhead chunks are read in parallel ahead of the one that's due next, which keeps the worker
+    /// pool and the disk busy while the consumer works. Memory held by the reader is therefore bounded
+    /// by readAhead * chunkSize, plus whatever the consumer keeps of the chunks it was given.
+    ///
+    /// Callbacks are made one at a time, on a worker thread or from within grant() or create(). After
+    /// the last chunk the done callback is called with true, or with false and a message as soon as a
+    /// read fails. Once cancel() returns nothing more is called, except for a chunk that another
+    /// thread was already handing over.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class AsyncFileReader : public boost::enable_shared_from_this<AsyncFileReader>, boost::noncopyable
+    {
+    public:
+        // offset in the file, data, size of data
+        typedef boost::function<void (boost::uint64_t, const boost::shared_array<uint8_t>&, size_t)> ChunkCallback;
+        // success, error message if !success
+        typedef boost::function<void (bool, const std::string&)> DoneCallback;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static AsyncFileReaderPtr AsyncFileReader::create(const AsyncFilePtr& file,
+        ///     boost::uint64_t offset, boost::uint64_t length, size_t chunkSize, size_t readAhead,
+        ///     const ChunkCallback& onChunk, const DoneCallback& onDone)
+        ///
+        /// @brief  Creates a reader for length bytes from offset (clamped to the end of the file). It
+        ///         starts with no credits, so nothing is delivered until the first grant().
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static AsyncFileReaderPtr create(const AsyncFilePtr& file, boost::uint64_t offset, boost::uint64_t length,
+            size_t chunkSize, size_t readAhead, const ChunkCallback& onChunk, const DoneCallback& onDone);
+
+        // Allows count more chunks to be delivered
+        void grant(size_t count);
+        void cancel();
+
+        size_t getCredits() const;
+        // Offset of the next chunk to be delivered
+        boost::uint64_t getPosition() const;
+        // Everything was delivered, a read failed, or the reader was canceled
+        bool isFinished() const;
+
+    protected:
+        AsyncFileReader(const AsyncFilePtr& file, boost::uint64_t offset, boost::uint64_t end, size_t chunkSize,
+            size_t readAhead, const ChunkCallback& onChunk, const DoneCallback& onDone);
+        // Both called with m_mutex held; pump releases it while making callbacks
+        void fill();
+        void pump(boost::mutex::scoped_lock& lock);
+        void onRead(boost::uint64_t offset, bool success, const boost::shared_array<uint8_t>& data, size_t size,
+            const std::string& error);
+
+        struct Chunk {
+            Chunk() : size(0) {}
+            boost::shared_array<uint8_t> data;
+            size_t size;
+        };
+
+        AsyncFilePtr m_file;
+        boost::uint64_t m_end; // pulled in if the file turns out shorter
+        const size_t m_chunkSize;
+        const size_t m_readAhead;
+        ChunkCallback m_onChunk;
+        DoneCallback m_onDone;
+
+        mutable boost::mutex m_mutex;
+        boost::uint64_t m_nextRead;
+        boost::uint64_t m_nextDeliver;
+        size_t m_inFlight;
+        std::map<boost::uint64_t, Chunk> m_ready; // read, not yet delivered; keyed by offset
+        size_t m_credits;
+        bool m_delivering;
+        bool m_finished;
+        bool m_failed;
+        std::string m_error;
+    };
+};
+
+#endif // H_FB_ASYNCFILESERVICE
+
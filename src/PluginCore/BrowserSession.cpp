@@ -0,0 +1,257 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "BrowserHost.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include "logging.h"
+#include "BrowserStreamScheduler.h"
+
+#include "BrowserSession.h"
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::milliseconds;
+
+// How long a snapshot is used before the browser is asked again; can be changed with setMaxAge
+#define k_DEFAULT_SESSION_MAX_AGE_MS 30000
+
+namespace {
+    bool sameValues(const FB::SessionSnapshot& lh, const FB::SessionSnapshot& rh)
+    {
+        return lh.cookies == rh.cookies && lh.proxy == rh.proxy && lh.credentials == rh.credentials;
+    }
+}
+
+bool FB::SessionSnapshot::getCredentials( const std::string& scheme, const std::string& realm,
+    std::string& username, std::string& password ) const
+{
+    CredentialsMap::const_iterator it = credentials.find(credentialsKey(scheme, realm));
+    if (it == credentials.end() || it->second.username.empty())
+        return false;
+    username = it->second.username;
+    password = it->second.password;
+    return true;
+}
+
+bool FB::SessionSnapshot::isExpired() const
+{
+    return microsec_clock::universal_time() >= expires;
+}
+
+std::string FB::SessionSnapshot::credentialsKey( const std::string& scheme, const std::string& realm )
+{
+    // Schemes are case insensitive, realms aren't
+    return boost::algorithm::to_lower_copy(scheme) + " " + realm;
+}
+
+FB::BrowserSession::BrowserSession( const BrowserHostPtr& host )
+    : m_host(host), m_snapshots(boost::make_shared<SnapshotMap>()), m_maxAgeMs(k_DEFAULT_SESSION_MAX_AGE_MS),
+      m_refreshCount(0), m_isShutDown(false)
+{
+}
+
+FB::BrowserSession::~BrowserSession()
+{
+}
+
+FB::SessionSnapshotPtr FB::BrowserSession::find( const std::string& origin ) const
+{
+    SnapshotMapPtr snapshots(boost::atomic_load(&m_snapshots));
+    SnapshotMap::const_iterator it = snapshots->find(origin);
+    return it != snapshots->end() ? it->second : SessionSnapshotPtr();
+}
+
+FB::SessionSnapshotPtr FB::BrowserSession::getSnapshot( const FB::URI& uri )
+{
+    const std::string origin(FB::BrowserStreamScheduler::getOrigin(uri));
+    SessionSnapshotPtr snap(find(origin));
+    if (!snap || snap->isExpired())
+        scheduleRefresh(origin);
+    return snap;
+}
+
+FB::SessionSnapshotPtr FB::BrowserSession::waitForSnapshot( const FB::URI& uri, long timeoutMs )
+{
+    SessionSnapshotPtr snap(getSnapshot(uri));
+    if (snap)
+        return snap;
+    return waitFor(FB::BrowserStreamScheduler::getOrigin(uri), std::string(), timeoutMs);
+}
+
+bool FB::BrowserSession::getCredentials( const FB::URI& uri, const std::string& scheme, const std::string& realm,
+    std::string& username, std::string& password, long timeoutMs )
+{
+    const std::string origin(FB::BrowserStreamScheduler::getOrigin(uri));
+    const std::string key(SessionSnapshot::credentialsKey(scheme, realm));
+    SessionSnapshotPtr snap(getSnapshot(uri));
+    if (!snap || !snap->credentials.count(key)) {
+        {
+            boost::mutex::scoped_lock _l(m_mutex);
+            m_realms[origin].insert(std::make_pair(boost::algorithm::to_lower_copy(scheme), realm));
+        }
+        // A refresh that is already pending reads the realms when it runs, so it will pick this up
+        scheduleRefresh(origin);
+        snap = waitFor(origin, key, timeoutMs);
+        if (snap && !snap->credentials.count(key)) {
+            // The refresh had already read the realms before we added ours; ask once more
+            scheduleRefresh(origin);
+            snap = waitFor(origin, key, timeoutMs);
+        }
+    }
+    return snap && snap->getCredentials(scheme, realm, username, password);
+}
+
+void FB::BrowserSession::refresh( const FB::URI& uri )
+{
+    scheduleRefresh(FB::BrowserStreamScheduler::getOrigin(uri));
+}
+
+void FB::BrowserSession::setMaxAge( long ms )
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_maxAgeMs = ms;
+}
+
+long FB::BrowserSession::getMaxAge() const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_maxAgeMs;
+}
+
+void FB::BrowserSession::setChangeHandler( const ChangeHandler& handler )
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_changeHandler = handler;
+}
+
+size_t FB::BrowserSession::getRefreshCount() const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_refreshCount;
+}
+
+void FB::BrowserSession::shutdown()
+{
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_isShutDown = true;
+        m_pending.clear();
+        m_changeHandler.clear();
+        boost::atomic_store(&m_snapshots, SnapshotMapPtr(boost::make_shared<SnapshotMap>()));
+    }
+    m_published.notify_all();
+}
+
+void FB::BrowserSession::scheduleRefresh( const std::string& origin )
+{
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        if (m_isShutDown || !m_pending.insert(origin).second)
+            return;
+    }
+    BrowserHostPtr host(m_host.lock());
+    try {
+        if (host) {
+            host->ScheduleOnMainThread(shared_from_this(), boost::bind(&BrowserSession::doRefresh, this, origin));
+            return;
+        }
+    } catch (const FB::script_error& e) {
+        FBLOG_INFO("BrowserSession", "Could not schedule a refresh for " << origin << ": " << e.what());
+    }
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_pending.erase(origin);
+    }
+    m_published.notify_all();
+}
+
+void FB::BrowserSession::doRefresh( const std::string& origin )
+{
+    BrowserHostPtr host(m_host.lock());
+    std::set<std::pair<std::string, std::string> > realms;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        if (!host || m_isShutDown) {
+            m_pending.erase(origin);
+            return;
+        }
+        realms = m_realms[origin];
+    }
+
+    boost::shared_ptr<SessionSnapshot> snap(boost::make_shared<SessionSnapshot>());
+    snap->origin = origin;
+    // Cookies are asked for at the root of the origin, so ones restricted to a deeper path are left out
+    const std::string url(origin + "/");
+    if (!host->GetCookiesForURL(url, snap->cookies))
+        snap->cookies.clear();
+    if (!host->DetectProxySettings(snap->proxy, url))
+        snap->proxy.clear();
+    for (std::set<std::pair<std::string, std::string> >::const_iterator it = realms.begin(); it != realms.end(); ++it) {
+        SessionSnapshot::Credentials& creds(snap->credentials[SessionSnapshot::credentialsKey(it->first, it->second)]);
+        if (!host->GetCredentialsForURL(url, it->first, it->second, creds.username, creds.password))
+            creds = SessionSnapshot::Credentials();
+    }
+    publish(snap);
+}
+
+void FB::BrowserSession::publish( const boost::shared_ptr<SessionSnapshot>& snap )
+{
+    ChangeHandler handler;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_pending.erase(snap->origin);
+        ++m_refreshCount;
+        if (m_isShutDown)
+            return;
+
+        SessionSnapshotPtr old(find(snap->origin));
+        snap->version = old ? old->version : 0;
+        if (!old || !sameValues(*old, *snap)) {
+            ++snap->version;
+            handler = m_changeHandler;
+        }
+        snap->expires = microsec_clock::universal_time() + milliseconds(m_maxAgeMs);
+
+        // Copied rather than changed in place, since readers may be holding on to the current map
+        boost::shared_ptr<SnapshotMap> snapshots(boost::make_shared<SnapshotMap>(*boost::atomic_load(&m_snapshots)));
+        (*snapshots)[snap->origin] = snap;
+        boost::atomic_store(&m_snapshots, SnapshotMapPtr(snapshots));
+    }
+    m_published.notify_all();
+    if (handler)
+        handler(snap);
+}
+
+FB::SessionSnapshotPtr FB::BrowserSession::waitFor( const std::string& origin, const std::string& credentialsKey, long timeoutMs )
+{
+    BrowserHostPtr host(m_host.lock());
+    if (host && host->isMainThread()) {
+        // Nothing will run the scheduled refresh while we wait, so do it here
+        doRefresh(origin);
+        return find(origin);
+    }
+
+    const boost::system_time until(boost::get_system_time() + milliseconds(timeoutMs));
+    boost::mutex::scoped_lock _l(m_mutex);
+    while (true) {
+        SessionSnapshotPtr snap(find(origin));
+        if (snap && (credentialsKey.empty() || snap->credentials.count(credentialsKey)))
+            return snap;
+        // Nothing is coming if the refresh couldn't be scheduled
+        if (m_isShutDown || !m_pending.count(origin) || !m_published.timed_wait(_l, until))
+            return snap;
+    }
+}
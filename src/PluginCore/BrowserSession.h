@@ -0,0 +1,207 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_BROWSERSESSION
+#define H_FB_BROWSERSESSION
+
+#include <map>
+#include <set>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "FBPointers.h"
+#include "URI.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(BrowserHost);
+    FB_FORWARD_PTR(BrowserSession);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @struct SessionSnapshot
+    ///
+    /// @brief  What the browser told a BrowserSession about one origin: the cookies it would send, the
+    ///         proxy it would use and the credentials it has saved.  Never changed once published;
+    ///         a refresh replaces it with a new one.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct SessionSnapshot
+    {
+        struct Credentials
+        {
+            std::string username;
+            std::string password;
+            bool operator==(const Credentials& rh) const {
+                return username == rh.username && password == rh.password;
+            }
+        };
+        typedef std::map<std::string, Credentials> CredentialsMap;
+
+        SessionSnapshot() : version(0) { }
+
+        // Looks up the credentials for an authentication scheme ("basic", "digest") and realm;
+        // false if nobody has asked for them yet or the browser has none
+        bool getCredentials(const std::string& scheme, const std::string& realm,
+            std::string& username, std::string& password) const;
+        bool hasProxy() const { return !proxy.empty(); }
+        // Whether the browser should be asked again
+        bool isExpired() const;
+
+        // Keys credentials by scheme and realm
+        static std::string credentialsKey(const std::string& scheme, const std::string& realm);
+
+        // Scheme, host and port, as from BrowserStreamScheduler::getOrigin
+        std::string origin;
+        // The value of the Cookie header the browser would send to the origin, as the browser gave
+        // it; empty if there are no cookies or the browser can't say
+        std::string cookies;
+        // As from BrowserHost::DetectProxySettings; empty for a direct connection
+        std::map<std::string, std::string> proxy;
+        // Every realm asked for with BrowserSession::getCredentials; the username is empty if the
+        // browser has nothing saved for it
+        CredentialsMap credentials;
+        // Goes up each time the values above change, so callers can tell when theirs is out of date
+        unsigned long version;
+        boost::posix_time::ptime expires;
+    };
+    typedef boost::shared_ptr<const SessionSnapshot> SessionSnapshotPtr;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  BrowserSession
+    ///
+    /// @brief  Gives code running on other threads the user's browser session: cookies, proxy and
+    ///         saved credentials for each origin, so that the plugin's own HTTP requests (see
+    ///         HTTP::HTTPRequest::setBrowserSession) look like they came from the page.
+    ///
+    /// The browser only answers these questions on the main thread.  Rather than make each request
+    /// wait for the main thread, the session keeps a SessionSnapshot per origin and hands it out from
+    /// any thread without taking a lock.  A snapshot that is missing or older than the maximum age
+    /// (see setMaxAge) is refreshed with a call scheduled on the main thread; in the meantime the old
+    /// one is still handed out.  Only the first request to an origin has to wait (waitForSnapshot).
+    ///
+    /// Each BrowserHost has one of these; get it with BrowserHost::getBrowserSession().
+    /// @code
+    ///      FB::SessionSnapshotPtr snap(host->getBrowserSession()->getSnapshot(uri));
+    ///      if (snap && !snap->cookies.empty())
+    ///          headers.insert(std::make_pair("Cookie", snap->cookies));
+    /// @endcode
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class BrowserSession : public boost::enable_shared_from_this<BrowserSession>, boost::noncopyable
+    {
+    public:
+        BrowserSession(const BrowserHostPtr& host);
+        ~BrowserSession();
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn SessionSnapshotPtr BrowserSession::getSnapshot(const FB::URI& uri)
+        ///
+        /// @brief  Returns the snapshot for the origin of uri without waiting; empty if there isn't one
+        ///         yet.  If there is none, or it has expired, a refresh is scheduled.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        SessionSnapshotPtr getSnapshot(const FB::URI& uri);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn SessionSnapshotPtr BrowserSession::waitForSnapshot(const FB::URI& uri, long timeoutMs)
+        ///
+        /// @brief  Like getSnapshot, but if there is no snapshot yet waits up to timeoutMs for the
+        ///         main thread to make one.  On the main thread the browser is asked right away.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        SessionSnapshotPtr waitForSnapshot(const FB::URI& uri, long timeoutMs);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool BrowserSession::getCredentials(const FB::URI& uri, const std::string& scheme,
+        ///     const std::string& realm, std::string& username, std::string& password, long timeoutMs)
+        ///
+        /// @brief  Gets the credentials the browser has saved for the origin of uri and the
+        ///         authentication scheme and realm a server asked for (e.g. in a 401 response).
+        ///
+        /// The first time a realm is asked for the browser has to be asked too, so this waits up to
+        /// timeoutMs; after that the realm is kept up to date with the rest of the snapshot.
+        ///
+        /// @return false if the browser has nothing saved, or didn't answer in time
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool getCredentials(const FB::URI& uri, const std::string& scheme, const std::string& realm,
+            std::string& username, std::string& password, long timeoutMs);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void BrowserSession::refresh(const FB::URI& uri)
+        ///
+        /// @brief  Schedules the snapshot for the origin of uri to be taken again now rather than when
+        ///         it expires, e.g. once the page has logged the user in.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void refresh(const FB::URI& uri);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void BrowserSession::setMaxAge(long ms)
+        ///
+        /// @brief  Sets how long a snapshot is used before the browser is asked again; snapshots that
+        ///         were already taken keep the age they were given.  The default is 30 seconds.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setMaxAge(long ms);
+        long getMaxAge() const;
+
+        typedef boost::function<void (const SessionSnapshotPtr&)> ChangeHandler;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void BrowserSession::setChangeHandler(const ChangeHandler& handler)
+        ///
+        /// @brief  Sets a function to call, on the main thread, when a refresh finds that the cookies,
+        ///         proxy or credentials for an origin have changed (or were taken for the first time)
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setChangeHandler(const ChangeHandler& handler);
+
+        // How many times the browser has been asked about an origin; mostly for tests
+        size_t getRefreshCount() const;
+
+        // Forgets every snapshot and wakes anyone waiting; called by BrowserHost::shutdown
+        void shutdown();
+
+    private:
+        typedef std::map<std::string, SessionSnapshotPtr> SnapshotMap;
+        typedef boost::shared_ptr<const SnapshotMap> SnapshotMapPtr;
+
+        SessionSnapshotPtr find(const std::string& origin) const;
+        void scheduleRefresh(const std::string& origin);
+        void doRefresh(const std::string& origin);
+        void publish(const boost::shared_ptr<SessionSnapshot>& snap);
+        SessionSnapshotPtr waitFor(const std::string& origin, const std::string& credentialsKey, long timeoutMs);
+
+    private:
+        BrowserHostWeakPtr m_host;
+        // Replaced as a whole, with boost::atomic_store, each time a snapshot is published, so that
+        // readers never need m_mutex
+        SnapshotMapPtr m_snapshots;
+
+        mutable boost::mutex m_mutex;
+        boost::condition_variable m_published;
+        // Origins with a refresh scheduled on the main thread
+        std::set<std::string> m_pending;
+        // The realms to ask for credentials for, by origin
+        std::map<std::string, std::set<std::pair<std::string, std::string> > > m_realms;
+        long m_maxAgeMs;
+        size_t m_refreshCount;
+        ChangeHandler m_changeHandler;
+        bool m_isShutDown;
+    };
+};
+
+#endif // H_FB_BROWSERSESSION
@@ -16,8 +16,6 @@ Copyright 2011 Richard Bateman,
 #include "BrowserStream.h"
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
-#include <boost/lambda/lambda.hpp>
-#include <boost/lambda/bind.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <algorithm>
 
@@ -31,20 +29,26 @@ FB::BrowserStreamManager::BrowserStreamManager()
 FB::BrowserStreamManager::~BrowserStreamManager()
 {
     boost::recursive_mutex::scoped_lock _l(m_xtmutex);
-    using namespace boost::lambda;
 
     // Force close all of the streams so that they get a callback
-    std::for_each(m_retainedStreams.begin(), m_retainedStreams.end(), 
-        boost::lambda::bind(&BrowserStream::close, 
-            boost::lambda::bind(&BrowserStreamPtr::get, boost::lambda::_1)));
-    m_retainedStreams.clear();
+    std::map<BrowserStreamPtr, LeaseList> streams;
+    streams.swap(m_retainedStreams);
+    for (std::map<BrowserStreamPtr, LeaseList>::const_iterator it = streams.begin(); it != streams.end(); ++it) {
+        it->first->close();
+    }
 }
 
 void FB::BrowserStreamManager::retainStream( const BrowserStreamPtr& stream )
+{
+    retainStream(stream, LeaseList());
+}
+
+void FB::BrowserStreamManager::retainStream( const BrowserStreamPtr& stream, const LeaseList& leases )
 {
     boost::recursive_mutex::scoped_lock _l(m_xtmutex);
     stream->AttachObserver(shared_from_this());
-    m_retainedStreams.insert(stream);
+    LeaseList& held(m_retainedStreams[stream]);
+    held.insert(held.end(), leases.begin(), leases.end());
 }
 
 void FB::BrowserStreamManager::releaseStream( const BrowserStreamPtr& stream )
@@ -17,13 +17,15 @@ Copyright 2011 Richard Bateman,
                Firebreath development team
 \**********************************************************/
 
-#include <set>
+#include <map>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include "PluginEventSink.h"
 #include "PluginEvents/StreamEvents.h"
 #include "BrowserStream.h"
 #include "FBPointers.h"
+#include "ResourceQuota.h"
 
 namespace FB {
 
@@ -33,7 +35,11 @@ namespace FB {
         BrowserStreamManager();
         ~BrowserStreamManager();
 
+        typedef std::vector<ResourceLeasePtr> LeaseList;
+
         void retainStream(const BrowserStreamPtr& stream);
+        // The leases are given back along with the stream, when it completes
+        void retainStream(const BrowserStreamPtr& stream, const LeaseList& leases);
         void releaseStream(const BrowserStreamPtr& stream);
 
         BEGIN_PLUGIN_EVENT_MAP()
@@ -41,7 +47,7 @@ namespace FB {
         END_PLUGIN_EVENT_MAP()
         virtual bool onStreamCompleted(FB::StreamCompletedEvent *evt, FB::BrowserStream *stream);
     private:
-        std::set<BrowserStreamPtr> m_retainedStreams;
+        std::map<BrowserStreamPtr, LeaseList> m_retainedStreams;
         mutable boost::recursive_mutex m_xtmutex;
     };
 
@@ -17,6 +17,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 
 #include "SimpleStreamHelper.h"
 #include <string>
+#include <vector>
 
 #define k_DEFAULT_REQUEST_BUFFER 128 * 1024
 
@@ -24,6 +25,18 @@ namespace FB {
 
     FB_FORWARD_PTR(PluginEventSink);
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @enum   StreamPriority
+    ///
+    /// @brief  Priority classes for requests queued with BrowserHost::scheduleStream; lower values
+    ///         are started first.  Ignored by BrowserHost::createStream, which always starts at once.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    enum StreamPriority {
+        STREAM_PRIORITY_INTERACTIVE = 0,    // Something the user is waiting on right now
+        STREAM_PRIORITY_NORMAL,
+        STREAM_PRIORITY_BACKGROUND          // Prefetching, content that is out of view, etc
+    };
+
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @class  BrowserStreamRequest
     ///
@@ -52,7 +65,8 @@ namespace FB {
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         BrowserStreamRequest(const std::string& uri, const std::string method = "GET", const bool accept = true)
             : uri(uri), method(method), lastModified(0), seekable(false),
-            internalBufferSize(k_DEFAULT_REQUEST_BUFFER), cache(false), accepted(accept)
+            internalBufferSize(k_DEFAULT_REQUEST_BUFFER), cache(false), priority(STREAM_PRIORITY_NORMAL),
+            accepted(accept)
         {
 
         }
@@ -71,7 +85,8 @@ namespace FB {
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         BrowserStreamRequest(const FB::URI& uri, const std::string method = "GET", const bool accept = true)
             : uri(uri), method(method), lastModified(0), seekable(false),
-            internalBufferSize(k_DEFAULT_REQUEST_BUFFER), cache(false), accepted(accept)
+            internalBufferSize(k_DEFAULT_REQUEST_BUFFER), cache(false), priority(STREAM_PRIORITY_NORMAL),
+            accepted(accept)
         {
 
         }
@@ -83,9 +98,11 @@ namespace FB {
         bool seekable;
         size_t internalBufferSize;
         bool cache;
+        StreamPriority priority;
 
     private:
         PluginEventSinkPtr sinkPtr;
+        std::vector<PluginEventSinkPtr> observers;
         HttpCallback callback;
         bool accepted;
         std::string postdata;
@@ -114,6 +131,15 @@ namespace FB {
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         void setCacheable(bool c) { cache = c; }
         ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn   void FB::BrowserStreamRequest::setPriority(StreamPriority p);
+        ///
+        /// @brief  Sets the priority used when the request is queued with BrowserHost::scheduleStream;
+        ///         default is STREAM_PRIORITY_NORMAL
+        ///
+        /// @param p  StreamPriority for the request
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setPriority(StreamPriority p) { priority = p; }
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn   bool FB::BrowserStreamRequest::wasAccepted();
         ///
         /// @brief  Returns true if the request was accepted; used internally. User-created
@@ -195,6 +221,16 @@ namespace FB {
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         PluginEventSinkPtr getEventSink() const { return sinkPtr; }
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn   void FB::BrowserStreamRequest::addObserver(const PluginEventSinkPtr& ptr);
+        ///
+        /// @brief  Adds an observer that is attached to the stream along with the event sink, before
+        ///         the browser is asked to open it.  Unlike setEventSink this doesn't accept the
+        ///         request; it is for bookkeeping such as BrowserStreamScheduler's.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void addObserver(const PluginEventSinkPtr& ptr) { observers.push_back(ptr); }
+        const std::vector<PluginEventSinkPtr>& getObservers() const { return observers; }
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn   void FB::BrowserStreamRequest::setCallback(const HttpCallback& cb);
         ///
@@ -0,0 +1,284 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "BrowserStream.h"
+#include "BrowserHost.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include "logging.h"
+
+#include "BrowserStreamScheduler.h"
+
+// Roughly what browsers allow themselves per host; can be changed with setLimits
+#define k_DEFAULT_MAX_ACTIVE_STREAMS 8
+#define k_DEFAULT_MAX_STREAMS_PER_ORIGIN 4
+
+void FB::ScheduledStreamRequest::setPriority( StreamPriority priority )
+{
+    BrowserStreamSchedulerPtr scheduler(m_scheduler.lock());
+    if (scheduler) {
+        scheduler->reprioritize(shared_from_this(), priority);
+    } else {
+        m_priority = m_req.priority = priority;
+    }
+}
+
+bool FB::ScheduledStreamRequest::cancel()
+{
+    BrowserStreamSchedulerPtr scheduler(m_scheduler.lock());
+    if (scheduler) {
+        return scheduler->cancel(shared_from_this());
+    }
+    return false;
+}
+
+FB::BrowserStreamScheduler::BrowserStreamScheduler( const BrowserHostConstPtr& host )
+    : m_host(host), m_activeCount(0), m_maxActive(k_DEFAULT_MAX_ACTIVE_STREAMS),
+      m_maxPerOrigin(k_DEFAULT_MAX_STREAMS_PER_ORIGIN), m_nextSeq(0), m_pumpScheduled(false),
+      m_isShutDown(false)
+{
+}
+
+FB::BrowserStreamScheduler::~BrowserStreamScheduler()
+{
+}
+
+std::string FB::BrowserStreamScheduler::getOrigin( const FB::URI& uri )
+{
+    std::string origin(uri.protocol + "://" + uri.domain);
+    if (uri.port) {
+        origin += ":" + boost::lexical_cast<std::string>(uri.port);
+    }
+    return origin;
+}
+
+FB::ScheduledStreamRequestPtr FB::BrowserStreamScheduler::schedule( const BrowserStreamRequest& req )
+{
+    ScheduledStreamRequestPtr sreq;
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        sreq = boost::make_shared<ScheduledStreamRequest>(
+            FB::ptr_cast<BrowserStreamScheduler>(shared_from_this()), req, getOrigin(req.uri), m_nextSeq++);
+        if (m_isShutDown) {
+            sreq->m_state = ScheduledStreamRequest::CANCELED;
+            return sreq;
+        }
+        m_queue.insert(sreq);
+    }
+    pumpSoon(true);
+    return sreq;
+}
+
+void FB::BrowserStreamScheduler::setLimits( size_t maxActive, size_t maxPerOrigin )
+{
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        m_maxActive = maxActive;
+        m_maxPerOrigin = maxPerOrigin;
+    }
+    pumpSoon(true);
+}
+
+size_t FB::BrowserStreamScheduler::getQueuedCount() const
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    return m_queue.size();
+}
+
+size_t FB::BrowserStreamScheduler::getActiveCount() const
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    return m_activeCount;
+}
+
+size_t FB::BrowserStreamScheduler::getActiveCount( const std::string& origin ) const
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    OriginCountMap::const_iterator it = m_originCount.find(origin);
+    return it == m_originCount.end() ? 0 : it->second;
+}
+
+void FB::BrowserStreamScheduler::shutdown()
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    m_isShutDown = true;
+    for (RequestQueue::iterator it = m_queue.begin(); it != m_queue.end(); ++it) {
+        (*it)->m_state = ScheduledStreamRequest::CANCELED;
+    }
+    m_queue.clear();
+    // Streams that are already running belong to the BrowserStreamManager, which closes them
+    // without necessarily sending an event; their slots are given back here
+    while (!m_active.empty()) {
+        ScheduledStreamRequestPtr req(m_active.begin()->second);
+        release(req, ScheduledStreamRequest::COMPLETED);
+    }
+}
+
+void FB::BrowserStreamScheduler::reprioritize( const ScheduledStreamRequestPtr& req, StreamPriority priority )
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    // The queue is ordered by priority, so the entry has to be taken out while it changes
+    m_queue.erase(req);
+    req->m_priority = req->m_req.priority = priority;
+    if (req->m_state == ScheduledStreamRequest::QUEUED)
+        m_queue.insert(req);
+}
+
+bool FB::BrowserStreamScheduler::cancel( const ScheduledStreamRequestPtr& req )
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    if (req->m_state != ScheduledStreamRequest::QUEUED)
+        return false;
+    m_queue.erase(req);
+    req->m_state = ScheduledStreamRequest::CANCELED;
+    return true;
+}
+
+void FB::BrowserStreamScheduler::pumpSoon( bool allowImmediate )
+{
+    BrowserHostConstPtr host(m_host.lock());
+    if (!host)
+        return;
+    if (allowImmediate && host->isMainThread()) {
+        pump();
+        return;
+    }
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        if (m_pumpScheduled || m_isShutDown)
+            return;
+        m_pumpScheduled = true;
+    }
+    try {
+        host->ScheduleOnMainThread(shared_from_this(), boost::bind(&BrowserStreamScheduler::pump, this));
+    } catch (const std::exception&) {
+        // This fails during shutdown, at which point nothing more will be started anyway
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        m_pumpScheduled = false;
+    }
+}
+
+void FB::BrowserStreamScheduler::pump()
+{
+    std::vector<ScheduledStreamRequestPtr> toStart;
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        m_pumpScheduled = false;
+        if (m_isShutDown)
+            return;
+
+        RequestQueue::iterator it = m_queue.begin();
+        while (it != m_queue.end() && m_activeCount < m_maxActive) {
+            size_t& originCount(m_originCount[(*it)->getOrigin()]);
+            if (originCount >= m_maxPerOrigin) {
+                // Leave it queued, but don't let it hold up requests to other origins
+                ++it;
+                continue;
+            }
+            ++originCount;
+            ++m_activeCount;
+            (*it)->m_state = ScheduledStreamRequest::STARTED;
+            toStart.push_back(*it);
+            m_queue.erase(it++);
+        }
+    }
+
+    // Streams are created without holding the lock since the browser may call back into us
+    bool freedSlot(false);
+    for (std::vector<ScheduledStreamRequestPtr>::iterator it = toStart.begin(); it != toStart.end(); ++it) {
+        start(*it);
+        freedSlot = freedSlot || (*it)->m_state == ScheduledStreamRequest::FAILED;
+    }
+    if (freedSlot)
+        pump();
+}
+
+void FB::BrowserStreamScheduler::start( const ScheduledStreamRequestPtr& req )
+{
+    BrowserHostConstPtr host(m_host.lock());
+    // Watch the stream from before the browser is asked for it, so that an event sent while it is
+    // being opened (or its destruction, if it never opens) still frees the slot
+    BrowserStreamRequest streamReq(req->m_req);
+    streamReq.addObserver(shared_from_this());
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        m_starting = req;
+    }
+    BrowserStreamPtr stream;
+    try {
+        if (host)
+            stream = host->createStream(streamReq);
+    } catch (const std::exception& e) {
+        FBLOG_WARN("BrowserStreamScheduler", "Could not start stream for " << req->m_req.uri.toString() << ": " << e.what());
+    }
+
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    m_starting.reset();
+    if (req->m_state != ScheduledStreamRequest::STARTED) {
+        // Already finished (or destroyed) while it was being created
+        return;
+    }
+    if (!stream) {
+        release(req, ScheduledStreamRequest::FAILED);
+        return;
+    }
+    if (req->m_stream.expired()) {
+        // A host that doesn't attach request observers; watch it from now on instead
+        req->m_stream = stream;
+        m_active[stream.get()] = req;
+        stream->AttachObserver(shared_from_this());
+    }
+}
+
+void FB::BrowserStreamScheduler::release( const ScheduledStreamRequestPtr& req, ScheduledStreamRequest::State state )
+{
+    req->m_state = state;
+    --m_originCount[req->getOrigin()];
+    --m_activeCount;
+    for (ActiveMap::iterator it = m_active.begin(); it != m_active.end(); ++it) {
+        if (it->second == req) {
+            m_active.erase(it);
+            break;
+        }
+    }
+}
+
+bool FB::BrowserStreamScheduler::onStreamAttached( FB::AttachedEvent *evt, FB::BrowserStream *stream )
+{
+    boost::recursive_mutex::scoped_lock _l(m_mutex);
+    if (m_starting && m_active.find(stream) == m_active.end()) {
+        m_starting->m_stream = FB::ptr_cast<FB::BrowserStream>(stream->shared_from_this());
+        m_active[stream] = m_starting;
+    }
+    return false;
+}
+
+bool FB::BrowserStreamScheduler::onStreamFinished( FB::StreamEvent *evt, FB::BrowserStream *stream )
+{
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        ActiveMap::iterator it = m_active.find(stream);
+        if (it == m_active.end())
+            return false;
+        ScheduledStreamRequestPtr req(it->second);
+        // A stream destroyed before createStream returned is one the browser wouldn't open
+        const bool refused = req == m_starting && dynamic_cast<FB::StreamDestroyedEvent*>(evt);
+        release(req, refused ? ScheduledStreamRequest::FAILED : ScheduledStreamRequest::COMPLETED);
+    }
+    // Don't start the next request from inside the browser's stream callback
+    pumpSoon(false);
+    return false; // Let the stream's own handlers see the event too
+}
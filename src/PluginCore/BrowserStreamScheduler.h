@@ -0,0 +1,205 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef BrowserStreamScheduler_h__
+#define BrowserStreamScheduler_h__
+
+#include <set>
+#include <map>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include "PluginEventSink.h"
+#include "PluginEvents/StreamEvents.h"
+#include "PluginEvents/AttachedEvent.h"
+#include "BrowserStream.h"
+#include "BrowserStreamRequest.h"
+#include "FBPointers.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(BrowserHost);
+    FB_FORWARD_PTR(BrowserStreamScheduler);
+    FB_FORWARD_PTR(ScheduledStreamRequest);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  ScheduledStreamRequest
+    ///
+    /// @brief  Handle to a request queued with BrowserStreamScheduler
+    ///
+    /// Returned by BrowserHost::scheduleStream; use it to change the priority of the request or to
+    /// cancel it before it starts.  Once the request has been started getStream() returns the
+    /// BrowserStream that was created for it.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ScheduledStreamRequest : public boost::enable_shared_from_this<ScheduledStreamRequest>, boost::noncopyable
+    {
+    public:
+        enum State {
+            QUEUED,     // Waiting for a free slot
+            STARTED,    // The stream has been created and is in progress
+            COMPLETED,  // The stream has finished (successfully or not)
+            FAILED,     // The browser refused to create the stream
+            CANCELED    // cancel() was called before the request started
+        };
+
+        ScheduledStreamRequest(const BrowserStreamSchedulerPtr& scheduler, const BrowserStreamRequest& req,
+            const std::string& origin, unsigned long seq)
+            : m_scheduler(scheduler), m_req(req), m_priority(req.priority), m_origin(origin), m_seq(seq),
+            m_state(QUEUED) { }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void ScheduledStreamRequest::setPriority(StreamPriority priority)
+        ///
+        /// @brief  Changes the priority of the request.  Has no effect once the request has started.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setPriority(StreamPriority priority);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool ScheduledStreamRequest::cancel()
+        ///
+        /// @brief  Removes the request from the queue if it has not started yet
+        ///
+        /// @return true if the request was canceled, false if it had already started (use
+        ///         BrowserStream::close to stop a running stream)
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool cancel();
+
+        StreamPriority getPriority() const { return m_priority; }
+        State getState() const { return m_state; }
+        const std::string& getOrigin() const { return m_origin; }
+        const BrowserStreamRequest& getRequest() const { return m_req; }
+        BrowserStreamPtr getStream() const { return m_stream.lock(); }
+        unsigned long getSequence() const { return m_seq; }
+
+    private:
+        friend class BrowserStreamScheduler;
+
+        BrowserStreamSchedulerWeakPtr m_scheduler;
+        BrowserStreamRequest m_req;
+        StreamPriority m_priority;
+        const std::string m_origin;
+        const unsigned long m_seq;
+        State m_state;
+        // Weak, so a stream that is dropped before it finishes can still be destroyed and free its slot
+        BrowserStreamWeakPtr m_stream;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  BrowserStreamScheduler
+    ///
+    /// @brief  Queues BrowserStreamRequests and starts them subject to a global and a per-origin limit
+    ///         on the number of streams in progress, highest priority first.
+    ///
+    /// Each BrowserHost owns one of these; get it with BrowserHost::getStreamScheduler() and queue
+    /// requests with BrowserHost::scheduleStream().  Requests of the same priority start in the order
+    /// they were queued; an origin that is at its limit does not hold up requests for other origins.
+    /// Streams are always started on the main thread.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class BrowserStreamScheduler : public FB::PluginEventSink
+    {
+    public:
+        BrowserStreamScheduler(const BrowserHostConstPtr& host);
+        ~BrowserStreamScheduler();
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn ScheduledStreamRequestPtr BrowserStreamScheduler::schedule(const BrowserStreamRequest& req)
+        ///
+        /// @brief  Queues a request at the priority given by BrowserStreamRequest::setPriority.  It may
+        ///         be started before this returns if there is a free slot and the call is made on the
+        ///         main thread.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        ScheduledStreamRequestPtr schedule(const BrowserStreamRequest& req);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void BrowserStreamScheduler::setLimits(size_t maxActive, size_t maxPerOrigin)
+        ///
+        /// @brief  Sets the maximum number of streams in progress overall and per origin (scheme, host
+        ///         and port).  Raising a limit starts queued requests right away.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setLimits(size_t maxActive, size_t maxPerOrigin);
+        size_t getMaxActive() const { return m_maxActive; }
+        size_t getMaxPerOrigin() const { return m_maxPerOrigin; }
+
+        size_t getQueuedCount() const;
+        size_t getActiveCount() const;
+        size_t getActiveCount(const std::string& origin) const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void BrowserStreamScheduler::shutdown()
+        ///
+        /// @brief  Cancels everything still queued; called by BrowserHost::shutdown
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void shutdown();
+
+        static std::string getOrigin(const FB::URI& uri);
+
+        BEGIN_PLUGIN_EVENT_MAP()
+            EVENTTYPE_CASE(FB::AttachedEvent, onStreamAttached, FB::BrowserStream)
+            EVENTTYPE_CASE(FB::StreamCompletedEvent, onStreamFinished, FB::BrowserStream)
+            EVENTTYPE_CASE(FB::StreamFailedOpenEvent, onStreamFinished, FB::BrowserStream)
+            EVENTTYPE_CASE(FB::StreamDestroyedEvent, onStreamFinished, FB::BrowserStream)
+        END_PLUGIN_EVENT_MAP()
+
+        virtual bool onStreamAttached(FB::AttachedEvent *evt, FB::BrowserStream *stream);
+        virtual bool onStreamFinished(FB::StreamEvent *evt, FB::BrowserStream *stream);
+
+    protected:
+        friend class ScheduledStreamRequest;
+        void reprioritize(const ScheduledStreamRequestPtr& req, StreamPriority priority);
+        bool cancel(const ScheduledStreamRequestPtr& req);
+
+        // Starts as many queued requests as the limits allow; must be called on the main thread
+        void pump();
+        // Calls pump on the main thread; right away if we are on it and allowImmediate is set
+        void pumpSoon(bool allowImmediate);
+        void start(const ScheduledStreamRequestPtr& req);
+        // Gives back the slots held by a started request; call with the lock held
+        void release(const ScheduledStreamRequestPtr& req, ScheduledStreamRequest::State state);
+
+    private:
+        struct QueueOrder {
+            bool operator()(const ScheduledStreamRequestPtr& lh, const ScheduledStreamRequestPtr& rh) const {
+                if (lh->getPriority() != rh->getPriority())
+                    return lh->getPriority() < rh->getPriority();
+                return lh->getSequence() < rh->getSequence();
+            }
+        };
+        typedef std::set<ScheduledStreamRequestPtr, QueueOrder> RequestQueue;
+        typedef std::map<FB::BrowserStream*, ScheduledStreamRequestPtr> ActiveMap;
+        typedef std::map<std::string, size_t> OriginCountMap;
+
+        boost::weak_ptr<const BrowserHost> m_host;
+        RequestQueue m_queue;
+        ActiveMap m_active;
+        // The request whose stream is being created, so the stream can be matched to it on attach
+        ScheduledStreamRequestPtr m_starting;
+        OriginCountMap m_originCount;
+        size_t m_activeCount;
+        size_t m_maxActive;
+        size_t m_maxPerOrigin;
+        unsigned long m_nextSeq;
+        bool m_pumpScheduled;
+        bool m_isShutDown;
+        mutable boost::recursive_mutex m_mutex;
+    };
+};
+
+#endif // BrowserStreamScheduler_h__
+
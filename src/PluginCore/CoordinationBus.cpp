@@ -0,0 +1,132 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <stdexcept>
+#include "CoordinationBus.h"
+
+using namespace FB;
+
+std::map<std::string, CoordinationBusWeakPtr> CoordinationBus::s_buses;
+boost::mutex CoordinationBus::s_busesMutex;
+
+const std::string& CoordinationBus::getPluginId() const
+{
+    return m_pluginId;
+}
+
+#ifndef FB_X11
+// No native backend on this platform yet
+namespace FB {
+    class CoordinationBusPimpl { };
+};
+
+SharedSegment::SharedSegment(const std::string& name, const char* data, size_t size)
+    : m_name(name), m_data(data), m_size(size)
+{
+}
+
+SharedSegment::~SharedSegment()
+{
+}
+
+CoordinationBus::CoordinationBus(const std::string& pluginId, const Options& options)
+    : m_pluginId(pluginId)
+{
+}
+
+CoordinationBusPtr CoordinationBus::open(const std::string& pluginId, const Options& options)
+{
+    throw std::runtime_error("CoordinationBus is not supported on this platform");
+}
+
+bool CoordinationBus::isSupported()
+{
+    return false;
+}
+
+CoordinationBus::~CoordinationBus()
+{
+}
+
+int CoordinationBus::getProcessId() const
+{
+    return 0;
+}
+
+std::vector<int> CoordinationBus::getPeers() const
+{
+    return std::vector<int>();
+}
+
+bool CoordinationBus::tryLead(const std::string& role)
+{
+    return false;
+}
+
+void CoordinationBus::campaign(const std::string& role, const LeadershipCallback& onElected)
+{
+}
+
+void CoordinationBus::resign(const std::string& role)
+{
+}
+
+bool CoordinationBus::isLeader(const std::string& role) const
+{
+    return false;
+}
+
+int CoordinationBus::getLeader(const std::string& role) const
+{
+    return 0;
+}
+
+void CoordinationBus::publish(const std::string& topic, const std::string& data)
+{
+}
+
+int CoordinationBus::subscribe(const std::string& topic, const MessageCallback& callback)
+{
+    return 0;
+}
+
+void CoordinationBus::unsubscribe(int id)
+{
+}
+
+boost::uint64_t CoordinationBus::getDroppedCount() const
+{
+    return 0;
+}
+
+SharedSegmentConstPtr CoordinationBus::getOrCreateSegment(const std::string& name, const SegmentBuilder& build)
+{
+    return SharedSegmentConstPtr();
+}
+
+SharedSegmentConstPtr CoordinationBus::getSegment(const std::string& name)
+{
+    return SharedSegmentConstPtr();
+}
+
+bool CoordinationBus::removeSegment(const std::string& name)
+{
+    return false;
+}
+
+void CoordinationBus::close()
+{
+}
+#endif
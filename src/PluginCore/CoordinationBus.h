@@ -0,0 +1,223 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_COORDINATIONBUS
+#define H_FB_COORDINATIONBUS
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "FBPointers.h"
+
+namespace FB {
+
+    class CoordinationBusPimpl;
+    FB_FORWARD_PTR(CoordinationBus);
+    FB_FORWARD_PTR(SharedSegment);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  SharedSegment
+    ///
+    /// @brief  A read-only view of a block of data that CoordinationBus shares between processes.
+    ///
+    /// The data never changes once the segment has been made, and stays mapped for as long as this
+    /// object exists, even if the segment is removed from the bus meanwhile.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class SharedSegment : boost::noncopyable
+    {
+    public:
+        ~SharedSegment();
+
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        std::string str() const { return std::string(m_data, m_size); }
+        const std::string& getName() const { return m_name; }
+
+    protected:
+        friend class CoordinationBusPimpl;
+        SharedSegment(const std::string& name, const char* data, size_t size);
+
+        std::string m_name;
+        const char* m_data;
+        size_t m_size;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  CoordinationBus
+    ///
+    /// @brief  Lets the processes a browser runs the plugin in (one per tab or profile, say) find each
+    ///         other and share work, through shared memory named after the plugin id.
+    ///
+    /// It offers three things:
+    ///  - leader election: of the processes that ask to lead a role ("updater"), one at a time does,
+    ///    so work such as polling a server or downloading an update happens once;
+    ///  - small messages, published to every other process with the bus open through a ring buffer;
+    ///  - shared segments: large immutable data, such as a parsed cache, built by one process and
+    ///    mapped read-only by the rest instead of each keeping a copy.
+    ///
+    /// Membership and leadership are held as locks that the system drops when a process exits, so
+    /// a process that crashes or is killed loses its roles straight away and another candidate is
+    /// elected within Options::pollInterval. When the last process closes the bus, or the next one
+    /// to open it finds that everyone before it died, the shared memory and segments are removed.
+    ///
+    /// @code
+    ///      FB::CoordinationBusPtr bus(FB::CoordinationBus::open("com.example.myplugin"));
+    ///      bus->subscribe("prefs", boost::bind(&MyPlugin::onPrefsChanged, this, _1));
+    ///      bus->campaign("updater", boost::bind(&MyPlugin::startUpdateChecks, this));
+    ///
+    ///      FB::SharedSegmentConstPtr dict(bus->getOrCreateSegment("dictionary-v3",
+    ///          boost::bind(&MyPlugin::loadDictionary, this)));
+    /// @endcode
+    ///
+    /// Message and leadership callbacks are made on the bus's own thread; use
+    /// BrowserHost::ScheduleOnMainThread to get back to the main thread. Process ids are as this
+    /// process sees them.
+    ///
+    /// Only implemented on Linux so far (POSIX shared memory, with futexes to wake subscribers);
+    /// elsewhere isSupported() is false and open() throws.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class CoordinationBus : public boost::enable_shared_from_this<CoordinationBus>, boost::noncopyable
+    {
+    public:
+        // Whichever process creates the bus sets these; the others use the same
+        struct Options
+        {
+            Options() : ringSlots(256), maxMessageSize(1024), pollInterval(250) { }
+
+            // Messages the ring holds before a subscriber that falls behind starts losing them
+            size_t ringSlots;
+            // Largest topic plus data publish() takes, in bytes
+            size_t maxMessageSize;
+            // How often, in ms, candidates check whether the leader has died
+            long pollInterval;
+        };
+
+        struct Message
+        {
+            std::string topic;
+            std::string data;
+            // The process that published it
+            int sender;
+            boost::uint64_t sequence;
+        };
+
+        typedef boost::function<void (const Message&)> MessageCallback;
+        typedef boost::function<void ()> LeadershipCallback;
+        // Returns the contents of a segment that doesn't exist yet
+        typedef boost::function<std::string ()> SegmentBuilder;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static CoordinationBusPtr CoordinationBus::open(const std::string& pluginId,
+        ///     const Options& options = Options())
+        ///
+        /// @brief  Joins the bus for pluginId, creating it if this is the first process.
+        ///
+        /// Opening the same id again in the same process returns the same bus while it is still open; once
+        /// it has been closed, a new one is opened.
+        ///
+        /// @throws std::runtime_error if the shared memory can't be used, or there are already as many
+        ///         processes on the bus as it has room for
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static CoordinationBusPtr open(const std::string& pluginId, const Options& options = Options());
+        static bool isSupported();
+        ~CoordinationBus();
+
+        const std::string& getPluginId() const;
+        // This process and the others that have the bus open
+        int getProcessId() const;
+        std::vector<int> getPeers() const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool CoordinationBus::tryLead(const std::string& role)
+        ///
+        /// @brief  Makes this process the leader for role unless another one already is.
+        ///
+        /// @return whether this process is now the leader
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool tryLead(const std::string& role);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void CoordinationBus::campaign(const std::string& role, const LeadershipCallback& onElected)
+        ///
+        /// @brief  Keeps trying to lead role, and calls onElected once this process does; straight
+        ///         away if no one leads it now, otherwise when the leader resigns or dies.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void campaign(const std::string& role, const LeadershipCallback& onElected);
+        // Gives up role, or stops campaigning for it, so another candidate can take over
+        void resign(const std::string& role);
+        bool isLeader(const std::string& role) const;
+        // The leader's process id, or 0 if no one leads role
+        int getLeader(const std::string& role) const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void CoordinationBus::publish(const std::string& topic, const std::string& data)
+        ///
+        /// @brief  Sends data to the subscribers to topic in every other process.
+        ///
+        /// Delivery is best effort: a subscriber that falls more than Options::ringSlots messages
+        /// behind loses the oldest ones (see getDroppedCount).
+        ///
+        /// @throws std::invalid_argument if topic and data together are larger than
+        ///         Options::maxMessageSize
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void publish(const std::string& topic, const std::string& data);
+        // An empty topic subscribes to every message; returns an id for unsubscribe
+        int subscribe(const std::string& topic, const MessageCallback& callback);
+        void unsubscribe(int id);
+        // Messages this process missed because it fell too far behind
+        boost::uint64_t getDroppedCount() const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn SharedSegmentConstPtr CoordinationBus::getOrCreateSegment(const std::string& name,
+        ///     const SegmentBuilder& build)
+        ///
+        /// @brief  Returns the segment called name, first calling build to make it if no process has.
+        ///
+        /// Other processes asking for the same segment meanwhile wait for build rather than making
+        /// their own copy. If build throws nothing is stored and the exception is passed on.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        SharedSegmentConstPtr getOrCreateSegment(const std::string& name, const SegmentBuilder& build);
+        // The segment called name, or an empty pointer if there isn't one
+        SharedSegmentConstPtr getSegment(const std::string& name);
+        // Processes that already have the segment keep it until they let it go
+        bool removeSegment(const std::string& name);
+
+        // Resigns every role and leaves the bus; called by the destructor
+        void close();
+
+    protected:
+        CoordinationBus(const std::string& pluginId, const Options& options);
+
+        static std::map<std::string, CoordinationBusWeakPtr> s_buses;
+        static boost::mutex s_busesMutex;
+
+    private:
+        boost::scoped_ptr<CoordinationBusPimpl> pimpl;
+        std::string m_pluginId;
+    };
+};
+
+#endif // H_FB_COORDINATIONBUS
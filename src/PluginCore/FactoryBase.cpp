@@ -83,6 +83,10 @@ FB::Log::LogLevel FB::FactoryBase::getLogLevel()
     return FB::Log::LogLevel_Info;
 }
 
+void FB::FactoryBase::getLogFilterOptions( FB::Log::LogFilter::Options& outOptions )
+{
+}
+
 
 #ifdef FB_WIN
 FB::PluginWindowWin* FB::FactoryBase::createPluginWindowWin(const WindowContextWin& ctx)
@@ -22,6 +22,7 @@
 #include "APITypes.h"
 #include "FBPointers.h"
 #include "logging.h"
+#include "LogFilter.h"
 
 #include "PluginWindowForwardDecl.h"
 
@@ -215,6 +216,17 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         virtual FB::Log::LogLevel getLogLevel();
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual void getLogFilterOptions(FB::Log::LogFilter::Options& outOptions)
+        ///
+        /// @brief  Called by the logger to discover how repeated messages and busy sources are limited
+        ///
+        /// @param  outOptions    holds the defaults; change what should be different
+        /// @see FB::Log::LogFilter
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual void getLogFilterOptions(FB::Log::LogFilter::Options& outOptions);
+
 #ifdef FB_WIN
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn virtual PluginWindowWin* FactoryBase::createPluginWindowWin(const WindowContextWin& ctx)
@@ -0,0 +1,118 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "BrowserHost.h"
+#include "FileWatcher.h"
+
+using namespace FB;
+
+namespace {
+    void release_watcher(FileWatcherPtr) { }
+}
+
+void FileWatcher::deliver(const ChangeSet& changes)
+{
+    FileWatcherPtr self(m_self.lock());
+    if (!self)
+        return; // being destroyed
+    BrowserHostPtr host(m_host.lock());
+    if (!host) {
+        invoke_callback(changes);
+    } else {
+        try {
+            host->ScheduleOnMainThread(self, boost::bind(&FileWatcher::invoke_callback, self.get(), changes));
+        } catch (const FB::script_error&) {
+            // The browser is shutting down
+        }
+    }
+    if (self.unique()) {
+        // Everyone else let go meanwhile; the destructor joins the watcher thread, so it can't
+        // run on it
+        boost::thread releaser(boost::bind(&release_watcher, self));
+        releaser.detach();
+    }
+}
+
+void FileWatcher::invoke_callback(const ChangeSet& changes)
+{
+    if (m_callback)
+        m_callback(changes);
+}
+
+FB::VariantMap FileWatcher::toVariant(const ChangeSet& changes)
+{
+    static const char* names[] = { "created", "modified", "removed", "attributes", "rescan" };
+    FB::VariantMap res;
+    for (ChangeSet::const_iterator it = changes.begin(); it != changes.end(); ++it) {
+        FB::VariantList kinds;
+        for (int i = 0; i < 5; ++i) {
+            if (it->second & (1 << i))
+                kinds.push_back(std::string(names[i]));
+        }
+        res[it->first] = kinds;
+    }
+    return res;
+}
+
+#ifndef FB_X11
+// No native backend on this platform yet
+namespace FB {
+    class FileWatcherPimpl { };
+};
+
+FileWatcher::FileWatcher(const ChangeCallback& callback, const BrowserHostPtr& host)
+    : m_callback(callback), m_host(host)
+{
+}
+
+FileWatcherPtr FileWatcher::create(const ChangeCallback& callback, const BrowserHostPtr& host, long debounceMs)
+{
+    FileWatcherPtr res(new FileWatcher(callback, host));
+    res->m_self = res;
+    return res;
+}
+
+bool FileWatcher::isSupported()
+{
+    return false;
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+void FileWatcher::watch(const std::string& path, bool recursive)
+{
+    throw std::runtime_error("FileWatcher is not supported on this platform");
+}
+
+bool FileWatcher::unwatch(const std::string& path)
+{
+    return false;
+}
+
+void FileWatcher::stop()
+{
+}
+
+size_t FileWatcher::getWatchCount() const
+{
+    return 0;
+}
+#endif
+
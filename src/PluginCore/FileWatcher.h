@@ -0,0 +1,115 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_FILEWATCHER
+#define H_FB_FILEWATCHER
+
+#include <map>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include "FBPointers.h"
+#include "APITypes.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(FileWatcher);
+    class FileWatcherPimpl;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  FileWatcher
+    ///
+    /// @brief  Watches files and directory trees for changes from a dedicated thread.
+    ///
+    /// Changes are collected per path and delivered in batches once the tree has been quiet for the
+    /// debounce interval (or, during continuous churn, at least every ten intervals), so a burst of
+    /// writes to one file arrives as a single change. If the kernel's event queue overflows the
+    /// watches are rebuilt and each watched root is reported with CHANGE_RESCAN; the listener should
+    /// then rescan that root itself.
+    ///
+    /// When created with a BrowserHost the callback runs on the main thread, otherwise on the
+    /// watcher thread.
+    ///
+    /// @code
+    ///      // in the JSAPI object; stop() the watcher before the object goes away
+    ///      m_watcher = FB::FileWatcher::create(boost::bind(&MyPluginAPI::onFilesChanged, this, _1), m_host);
+    ///      m_watcher->watch(folder);
+    ///
+    ///      void MyPluginAPI::onFilesChanged(const FB::FileWatcher::ChangeSet& changes) {
+    ///          FireEvent("onfileschanged", FB::variant_list_of(FB::FileWatcher::toVariant(changes)));
+    ///      }
+    /// @endcode
+    ///
+    /// Only implemented with inotify on Linux so far; elsewhere isSupported() is false and watch()
+    /// throws.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class FileWatcher : public boost::enable_shared_from_this<FileWatcher>, boost::noncopyable
+    {
+    public:
+        enum ChangeKind {
+            CHANGE_CREATED = 1,
+            CHANGE_MODIFIED = 2,
+            CHANGE_REMOVED = 4,
+            CHANGE_ATTRIBUTES = 8,
+            CHANGE_RESCAN = 16
+        };
+        // Absolute path -> ChangeKind flags of everything that happened to it in the batch
+        typedef std::map<std::string, int> ChangeSet;
+        typedef boost::function<void (const ChangeSet&)> ChangeCallback;
+
+        static FileWatcherPtr create(const ChangeCallback& callback, const BrowserHostPtr& host = BrowserHostPtr(),
+            long debounceMs = 100);
+        static bool isSupported();
+        ~FileWatcher();
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void FileWatcher::watch(const std::string& path, bool recursive = true)
+        ///
+        /// @brief  Starts watching a file or directory; with recursive, every directory below it too,
+        ///         including ones created later.
+        ///
+        /// @throws std::runtime_error if path can't be watched (missing, or out of inotify watches)
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void watch(const std::string& path, bool recursive = true);
+        bool unwatch(const std::string& path);
+        // Stops the watcher thread; no callbacks are made after this returns
+        void stop();
+        // Number of files and directories with a kernel watch
+        size_t getWatchCount() const;
+
+        // path -> list of "created", "modified", "removed", "attributes", "rescan"
+        static FB::VariantMap toVariant(const ChangeSet& changes);
+
+    protected:
+        FileWatcher(const ChangeCallback& callback, const BrowserHostPtr& host);
+        friend class FileWatcherPimpl;
+        // Called by the watcher thread with each batch
+        void deliver(const ChangeSet& changes);
+        void invoke_callback(const ChangeSet& changes);
+
+        ChangeCallback m_callback;
+        BrowserHostWeakPtr m_host;
+        FileWatcherWeakPtr m_self;
+        boost::scoped_ptr<FileWatcherPimpl> pimpl;
+    };
+};
+
+#endif // H_FB_FILEWATCHER
+
@@ -0,0 +1,788 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "win_targetver.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#ifdef FB_WIN
+#include <windows.h>
+#include "utf8_tools.h"
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+#include "logging.h"
+#include "AsyncFileService.h"
+#include "KeyValueStore.h"
+
+using namespace FB;
+
+// On disk a store is a directory holding:
+//   snapshot   "FBKVSNP1", generation (u64), count (u32), count * (key, value), crc32 of the rest
+//   log        "FBKVLOG1", generation (u64), then one record per commit:
+//              payload length (u32), crc32 of payload (u32), payload
+//              payload: count (u32), count * (op (u8), key[, value])
+//   lock       locked shared to read and exclusive to write
+// with strings stored as a u32 length and the bytes, and all integers little-endian.
+//
+// The log applies on top of the snapshot with the same generation. Compaction writes a snapshot
+// with the next generation, renames it into place and then resets the log to that generation; a
+// log older than the snapshot was left behind by a compaction that didn't finish, and is already
+// part of it.
+
+namespace {
+    const char snapshot_magic[] = "FBKVSNP1";
+    const char log_magic[] = "FBKVLOG1";
+    const size_t magic_size = 8;
+    const size_t log_header_size = 16;
+    const size_t snapshot_header_size = 20;
+    const size_t record_header_size = 8;
+    enum { OP_PUT = 1, OP_ERASE = 2 };
+
+    std::string last_error()
+    {
+#ifdef FB_WIN
+        return "error " + boost::lexical_cast<std::string>(::GetLastError());
+#else
+        return strerror(errno);
+#endif
+    }
+
+    void put_u32(std::string& out, boost::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+
+    void put_u64(std::string& out, boost::uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i)
+            out += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+
+    void put_string(std::string& out, const std::string& str)
+    {
+        put_u32(out, static_cast<boost::uint32_t>(str.size()));
+        out += str;
+    }
+
+    boost::uint32_t get_u32(const char* p)
+    {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<boost::uint32_t>(u[3]) << 24);
+    }
+
+    boost::uint64_t get_u64(const char* p)
+    {
+        return get_u32(p) | (static_cast<boost::uint64_t>(get_u32(p + 4)) << 32);
+    }
+
+    boost::uint32_t checksum(const char* data, size_t size)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, size);
+        return crc.checksum();
+    }
+
+    // Reads a string at pos, bounded by end; false if it runs past end
+    bool get_string(const char* data, size_t& pos, size_t end, size_t& offset, size_t& length)
+    {
+        if (end - pos < 4)
+            return false;
+        length = get_u32(data + pos);
+        pos += 4;
+        if (end - pos < length)
+            return false;
+        offset = pos;
+        pos += length;
+        return true;
+    }
+
+    // A file read and written at explicit offsets
+    class RawFile : boost::noncopyable
+    {
+    public:
+        RawFile(const std::string& path, bool create) : m_path(path)
+        {
+#ifdef FB_WIN
+            m_handle = ::CreateFileW(FB::utf8_to_wstring(path).c_str(), GENERIC_READ | (create ? GENERIC_WRITE : 0),
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, create ? OPEN_ALWAYS : OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, NULL);
+            if (m_handle == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("Could not open " + path + ": " + last_error());
+#else
+            m_fd = ::open(path.c_str(), create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+            if (m_fd < 0)
+                throw std::runtime_error("Could not open " + path + ": " + last_error());
+#endif
+        }
+
+        ~RawFile()
+        {
+#ifdef FB_WIN
+            ::CloseHandle(m_handle);
+#else
+            ::close(m_fd);
+#endif
+        }
+
+        // Returns how much was read, which is short at the end of the file
+        size_t read(boost::uint64_t offset, char* buf, size_t length)
+        {
+            size_t done = 0;
+            while (done < length) {
+#ifdef FB_WIN
+                OVERLAPPED ov = {};
+                ov.Offset = static_cast<DWORD>(offset + done);
+                ov.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+                DWORD got = 0;
+                if (!::ReadFile(m_handle, buf + done, static_cast<DWORD>(length - done), &got, &ov)) {
+                    if (::GetLastError() == ERROR_HANDLE_EOF)
+                        break;
+                    throw std::runtime_error("Could not read " + m_path + ": " + last_error());
+                }
+#else
+                ssize_t got = ::pread(m_fd, buf + done, length - done, static_cast<off_t>(offset + done));
+                if (got < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("Could not read " + m_path + ": " + last_error());
+                }
+#endif
+                if (got == 0)
+                    break;
+                done += got;
+            }
+            return done;
+        }
+
+        void write(boost::uint64_t offset, const char* buf, size_t length)
+        {
+            size_t done = 0;
+            while (done < length) {
+#ifdef FB_WIN
+                OVERLAPPED ov = {};
+                ov.Offset = static_cast<DWORD>(offset + done);
+                ov.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+                DWORD put = 0;
+                if (!::WriteFile(m_handle, buf + done, static_cast<DWORD>(length - done), &put, &ov))
+                    throw std::runtime_error("Could not write " + m_path + ": " + last_error());
+#else
+                ssize_t put = ::pwrite(m_fd, buf + done, length - done, static_cast<off_t>(offset + done));
+                if (put < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error("Could not write " + m_path + ": " + last_error());
+                }
+#endif
+                done += put;
+            }
+        }
+
+        boost::uint64_t size() const
+        {
+#ifdef FB_WIN
+            LARGE_INTEGER size;
+            if (!::GetFileSizeEx(m_handle, &size))
+                throw std::runtime_error("Could not get the size of " + m_path + ": " + last_error());
+            return static_cast<boost::uint64_t>(size.QuadPart);
+#else
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0)
+                throw std::runtime_error("Could not get the size of " + m_path + ": " + last_error());
+            return static_cast<boost::uint64_t>(st.st_size);
+#endif
+        }
+
+        void truncate(boost::uint64_t size)
+        {
+#ifdef FB_WIN
+            LARGE_INTEGER pos;
+            pos.QuadPart = static_cast<LONGLONG>(size);
+            if (!::SetFilePointerEx(m_handle, pos, NULL, FILE_BEGIN) || !::SetEndOfFile(m_handle))
+                throw std::runtime_error("Could not truncate " + m_path + ": " + last_error());
+#else
+            if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+                throw std::runtime_error("Could not truncate " + m_path + ": " + last_error());
+#endif
+        }
+
+        void sync()
+        {
+#ifdef FB_WIN
+            if (!::FlushFileBuffers(m_handle))
+#else
+            if (::fsync(m_fd) != 0)
+#endif
+                throw std::runtime_error("Could not flush " + m_path + ": " + last_error());
+        }
+
+    private:
+        std::string m_path;
+#ifdef FB_WIN
+        HANDLE m_handle;
+#else
+        int m_fd;
+#endif
+    };
+
+    bool file_exists(const std::string& path)
+    {
+#ifdef FB_WIN
+        return ::GetFileAttributesW(FB::utf8_to_wstring(path).c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+#endif
+    }
+
+    void make_dirs(const std::string& path)
+    {
+        if (path.empty() || file_exists(path))
+            return;
+        std::string::size_type slash = path.find_last_of("/\\");
+        if (slash != std::string::npos && slash > 0)
+            make_dirs(path.substr(0, slash));
+#ifdef FB_WIN
+        if (!::CreateDirectoryW(FB::utf8_to_wstring(path).c_str(), NULL) && ::GetLastError() != ERROR_ALREADY_EXISTS)
+#else
+        if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+#endif
+            throw std::runtime_error("Could not create " + path + ": " + last_error());
+    }
+
+    // Replaces to with from in one step
+    void replace_file(const std::string& from, const std::string& to)
+    {
+#ifdef FB_WIN
+        // Fails while another process has the old file mapped; the caller tries again later
+        if (!::MoveFileExW(FB::utf8_to_wstring(from).c_str(), FB::utf8_to_wstring(to).c_str(),
+                MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+        if (::rename(from.c_str(), to.c_str()) != 0)
+#endif
+            throw std::runtime_error("Could not replace " + to + ": " + last_error());
+    }
+
+    // The lock file has to exist before the lock can be made
+    std::string touch(const std::string& path)
+    {
+        RawFile file(path, true);
+        return path;
+    }
+}
+
+namespace FB {
+    class KeyValueStorePimpl
+    {
+    public:
+        struct Snapshot
+        {
+            explicit Snapshot(const std::string& path)
+                : file(path.c_str(), boost::interprocess::read_only), region(file, boost::interprocess::read_only) { }
+            const char* data() const { return static_cast<const char*>(region.get_address()); }
+            size_t size() const { return region.get_size(); }
+
+            boost::interprocess::file_mapping file;
+            boost::interprocess::mapped_region region;
+        };
+
+        // A value in the snapshot, or one that has been written since
+        struct Entry
+        {
+            Entry() : offset(0), length(0) { }
+            size_t offset;
+            size_t length;
+            boost::shared_ptr<const std::string> value;
+        };
+        typedef std::map<std::string, Entry> Index;
+
+        // Holds the store, and the directory unless this thread already does
+        class Lock : boost::noncopyable
+        {
+        public:
+            Lock(KeyValueStorePimpl& store, bool exclusive) : m_store(store), m_lock(store.mutex)
+            {
+                if (!m_store.lockDepth) {
+                    if (exclusive)
+                        m_store.dirLock.lock();
+                    else
+                        m_store.dirLock.lock_sharable();
+                    m_store.lockExclusive = exclusive;
+                } else if (exclusive && !m_store.lockExclusive) {
+                    throw std::logic_error("Cannot write to a KeyValueStore while reading it");
+                }
+                ++m_store.lockDepth;
+            }
+            ~Lock()
+            {
+                if (!--m_store.lockDepth) {
+                    if (m_store.lockExclusive)
+                        m_store.dirLock.unlock();
+                    else
+                        m_store.dirLock.unlock_sharable();
+                }
+            }
+
+        private:
+            KeyValueStorePimpl& m_store;
+            boost::recursive_mutex::scoped_lock m_lock;
+        };
+
+        KeyValueStorePimpl(const std::string& dir, const KeyValueStore::Options& options)
+            : dir(dir), snapshotPath(dir + "/snapshot"), logPath(dir + "/log"), lockPath(dir + "/lock"),
+              options(options), lockDepth(0), lockExclusive(false), dirLock((make_dirs(dir), touch(lockPath)).c_str()),
+              log(new RawFile(logPath, true)), snapshotGeneration(0), logGeneration(0), logOffset(0),
+              compactionScheduled(false), service(AsyncFileService::instance())
+        {
+            Lock _l(*this, true);
+            refresh(true);
+        }
+
+        // Catches up with whatever other processes have committed or compacted
+        void refresh(bool writer)
+        {
+            boost::uint64_t generation = readSnapshotGeneration();
+            if (generation != snapshotGeneration || (generation && !snapshot)) {
+                loadSnapshot();
+                logOffset = 0;
+            }
+
+            char header[log_header_size];
+            bool valid = log->read(0, header, log_header_size) == log_header_size
+                && memcmp(header, log_magic, magic_size) == 0;
+            boost::uint64_t generationOfLog = valid ? get_u64(header + magic_size) : 0;
+            if (!valid || generationOfLog < snapshotGeneration) {
+                // New, or already folded into the snapshot by a compaction that was cut short
+                if (writer)
+                    resetLog(snapshotGeneration);
+                if (logOffset > log_header_size)
+                    loadSnapshot();
+                logGeneration = snapshotGeneration;
+                logOffset = log_header_size;
+                return;
+            }
+            if ((generationOfLog != logGeneration && logOffset > log_header_size) || log->size() < logOffset) {
+                // Not the log the index was built from
+                loadSnapshot();
+                logOffset = 0;
+            }
+            logGeneration = generationOfLog;
+            if (logOffset < log_header_size)
+                logOffset = log_header_size;
+            replayLog(writer);
+        }
+
+        boost::uint64_t readSnapshotGeneration() const
+        {
+            if (!file_exists(snapshotPath))
+                return 0;
+            char header[log_header_size];
+            RawFile file(snapshotPath, false);
+            if (file.read(0, header, log_header_size) != log_header_size || memcmp(header, snapshot_magic, magic_size) != 0)
+                throw std::runtime_error("Corrupt key-value store snapshot " + snapshotPath);
+            return get_u64(header + magic_size);
+        }
+
+        void loadSnapshot()
+        {
+            index.clear();
+            snapshot.reset();
+            snapshotGeneration = 0;
+            if (!file_exists(snapshotPath))
+                return;
+
+            boost::shared_ptr<Snapshot> snap(boost::make_shared<Snapshot>(snapshotPath));
+            const char* data = snap->data();
+            size_t size = snap->size();
+            if (size < snapshot_header_size + 4 || memcmp(data, snapshot_magic, magic_size) != 0
+                    || checksum(data, size - 4) != get_u32(data + size - 4))
+                throw std::runtime_error("Corrupt key-value store snapshot " + snapshotPath);
+
+            boost::uint32_t count = get_u32(data + log_header_size);
+            size_t pos = snapshot_header_size;
+            size_t end = size - 4;
+            for (boost::uint32_t i = 0; i < count; ++i) {
+                size_t keyOffset, keyLength;
+                Entry entry;
+                if (!get_string(data, pos, end, keyOffset, keyLength) || !get_string(data, pos, end, entry.offset, entry.length))
+                    throw std::runtime_error("Corrupt key-value store snapshot " + snapshotPath);
+                index.insert(index.end(), std::make_pair(std::string(data + keyOffset, keyLength), entry));
+            }
+            snapshot = snap;
+            snapshotGeneration = get_u64(data + magic_size);
+        }
+
+        void resetLog(boost::uint64_t generation)
+        {
+            std::string header(log_magic, magic_size);
+            put_u64(header, generation);
+            log->truncate(0);
+            log->write(0, header.data(), header.size());
+            log->sync();
+        }
+
+        void replayLog(bool writer)
+        {
+            boost::uint64_t end = log->size();
+            if (end <= logOffset)
+                return;
+            std::vector<char> buf(static_cast<size_t>(end - logOffset));
+            size_t got = log->read(logOffset, &buf[0], buf.size());
+            size_t pos = 0;
+            while (got - pos >= record_header_size) {
+                size_t length = get_u32(&buf[pos]);
+                if (got - pos - record_header_size < length)
+                    break;
+                const char* payload = &buf[pos + record_header_size];
+                if (checksum(payload, length) != get_u32(&buf[pos + 4]) || !applyRecord(payload, length))
+                    break;
+                pos += record_header_size + length;
+            }
+            logOffset += pos;
+            if (pos < got && writer) {
+                // What's left of a commit that was interrupted; it never happened
+                FBLOG_WARN("KeyValueStore", "Discarding " << (got - pos) << " bytes of an incomplete transaction in " << logPath);
+                log->truncate(logOffset);
+            }
+        }
+
+        // Applies a whole record, or nothing if it doesn't parse
+        bool applyRecord(const char* payload, size_t length)
+        {
+            if (length < 4)
+                return false;
+            boost::uint32_t count = get_u32(payload);
+            size_t pos = 4;
+            KeyValueTransaction::WriteMap writes;
+            for (boost::uint32_t i = 0; i < count; ++i) {
+                if (pos >= length)
+                    return false;
+                char op = payload[pos++];
+                size_t keyOffset, keyLength, valueOffset, valueLength;
+                if (!get_string(payload, pos, length, keyOffset, keyLength))
+                    return false;
+                std::string key(payload + keyOffset, keyLength);
+                if (op == OP_PUT) {
+                    if (!get_string(payload, pos, length, valueOffset, valueLength))
+                        return false;
+                    writes[key] = std::string(payload + valueOffset, valueLength);
+                } else if (op == OP_ERASE) {
+                    writes[key] = boost::none;
+                } else {
+                    return false;
+                }
+            }
+            apply(writes);
+            return true;
+        }
+
+        void apply(const KeyValueTransaction::WriteMap& writes)
+        {
+            for (KeyValueTransaction::WriteMap::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+                if (it->second) {
+                    Entry& entry(index[it->first]);
+                    entry.value = boost::make_shared<const std::string>(*it->second);
+                } else {
+                    index.erase(it->first);
+                }
+            }
+        }
+
+        void append(const KeyValueTransaction::WriteMap& writes)
+        {
+            std::string payload;
+            put_u32(payload, static_cast<boost::uint32_t>(writes.size()));
+            for (KeyValueTransaction::WriteMap::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+                payload += static_cast<char>(it->second ? OP_PUT : OP_ERASE);
+                put_string(payload, it->first);
+                if (it->second)
+                    put_string(payload, *it->second);
+            }
+            std::string record;
+            record.reserve(record_header_size + payload.size());
+            put_u32(record, static_cast<boost::uint32_t>(payload.size()));
+            put_u32(record, checksum(payload.data(), payload.size()));
+            record += payload;
+
+            try {
+                log->write(logOffset, record.data(), record.size());
+                if (options.syncCommits)
+                    log->sync();
+            } catch (const std::exception&) {
+                try {
+                    log->truncate(logOffset);
+                } catch (const std::exception&) {
+                    // The next writer discards it anyway
+                }
+                throw;
+            }
+            logOffset += record.size();
+            apply(writes);
+        }
+
+        void compact()
+        {
+            refresh(true);
+            boost::uint64_t generation = std::max(snapshotGeneration, logGeneration) + 1;
+
+            std::string out(snapshot_magic, magic_size);
+            put_u64(out, generation);
+            put_u32(out, static_cast<boost::uint32_t>(index.size()));
+            for (Index::const_iterator it = index.begin(); it != index.end(); ++it) {
+                put_string(out, it->first);
+                if (it->second.value) {
+                    put_string(out, *it->second.value);
+                } else {
+                    put_u32(out, static_cast<boost::uint32_t>(it->second.length));
+                    out.append(snapshot->data() + it->second.offset, it->second.length);
+                }
+            }
+            put_u32(out, checksum(out.data(), out.size()));
+
+            std::string tmpPath(snapshotPath + ".tmp");
+            {
+                RawFile tmp(tmpPath, true);
+                tmp.truncate(0);
+                tmp.write(0, out.data(), out.size());
+                tmp.sync();
+            }
+            // Let go of the old mapping first; Windows won't replace a mapped file
+            index.clear();
+            snapshot.reset();
+            snapshotGeneration = ~boost::uint64_t(0);
+            logOffset = 0;
+            try {
+                replace_file(tmpPath, snapshotPath);
+            } catch (const std::exception&) {
+                refresh(true);
+                throw;
+            }
+            resetLog(generation);
+            refresh(true);
+        }
+
+        bool needsCompaction() const
+        {
+            boost::uint64_t logged = logOffset - log_header_size;
+            return logged > options.compactThreshold && logged > (snapshot ? snapshot->size() : 0);
+        }
+
+        boost::optional<std::string> lookup(const std::string& key) const
+        {
+            Index::const_iterator it = index.find(key);
+            if (it == index.end())
+                return boost::none;
+            if (it->second.value)
+                return *it->second.value;
+            return std::string(snapshot->data() + it->second.offset, it->second.length);
+        }
+
+        std::string dir;
+        std::string snapshotPath;
+        std::string logPath;
+        std::string lockPath;
+        KeyValueStore::Options options;
+
+        boost::recursive_mutex mutex;
+        int lockDepth;
+        bool lockExclusive;
+        boost::interprocess::file_lock dirLock;
+
+        boost::scoped_ptr<RawFile> log;
+        boost::shared_ptr<Snapshot> snapshot;
+        Index index;
+        boost::uint64_t snapshotGeneration;
+        boost::uint64_t logGeneration;
+        boost::uint64_t logOffset;     // end of the records applied so far
+
+        bool compactionScheduled;
+        AsyncFileServicePtr service;
+    };
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// KeyValueTransaction
+///////////////////////////////////////////////////////////////////////////////
+
+boost::optional<std::string> KeyValueTransaction::get(const std::string& key) const
+{
+    WriteMap::const_iterator it = m_writes.find(key);
+    if (it != m_writes.end())
+        return it->second;
+    if (m_store)
+        return m_store->lookup(key);
+    return boost::none;
+}
+
+void KeyValueTransaction::put(const std::string& key, const std::string& value)
+{
+    m_writes[key] = value;
+}
+
+void KeyValueTransaction::erase(const std::string& key)
+{
+    m_writes[key] = boost::none;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// KeyValueStore
+///////////////////////////////////////////////////////////////////////////////
+
+std::map<std::string, KeyValueStoreWeakPtr> KeyValueStore::s_stores;
+boost::mutex KeyValueStore::s_storesMutex;
+
+KeyValueStorePtr KeyValueStore::open(const std::string& dir, const Options& options)
+{
+    std::string path(dir);
+    while (path.size() > 1 && (path[path.size() - 1] == '/' || path[path.size() - 1] == '\\'))
+        path.erase(path.size() - 1);
+
+    boost::mutex::scoped_lock _l(s_storesMutex);
+    // The directory lock belongs to the process, so each directory gets a single store
+    KeyValueStorePtr store(s_stores[path].lock());
+    if (!store) {
+        store = KeyValueStorePtr(new KeyValueStore(path, options));
+        s_stores[path] = store;
+    }
+    for (std::map<std::string, KeyValueStoreWeakPtr>::iterator it = s_stores.begin(); it != s_stores.end(); ) {
+        if (it->second.expired())
+            s_stores.erase(it++);
+        else
+            ++it;
+    }
+    return store;
+}
+
+KeyValueStore::KeyValueStore(const std::string& dir, const Options& options)
+    : pimpl(new KeyValueStorePimpl(dir, options))
+{
+}
+
+KeyValueStore::~KeyValueStore()
+{
+}
+
+boost::optional<std::string> KeyValueStore::get(const std::string& key)
+{
+    KeyValueStorePimpl::Lock _l(*pimpl, false);
+    pimpl->refresh(false);
+    return pimpl->lookup(key);
+}
+
+std::vector<std::string> KeyValueStore::getKeys(const std::string& prefix)
+{
+    KeyValueStorePimpl::Lock _l(*pimpl, false);
+    pimpl->refresh(false);
+    std::vector<std::string> keys;
+    for (KeyValueStorePimpl::Index::const_iterator it = pimpl->index.lower_bound(prefix);
+            it != pimpl->index.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        keys.push_back(it->first);
+    }
+    return keys;
+}
+
+size_t KeyValueStore::size()
+{
+    KeyValueStorePimpl::Lock _l(*pimpl, false);
+    pimpl->refresh(false);
+    return pimpl->index.size();
+}
+
+void KeyValueStore::put(const std::string& key, const std::string& value)
+{
+    KeyValueTransaction txn;
+    txn.put(key, value);
+    commit(txn);
+}
+
+void KeyValueStore::erase(const std::string& key)
+{
+    KeyValueTransaction txn;
+    txn.erase(key);
+    commit(txn);
+}
+
+void KeyValueStore::commit(const KeyValueTransaction& txn)
+{
+    if (txn.empty())
+        return;
+    KeyValueStorePimpl::Lock _l(*pimpl, true);
+    pimpl->refresh(true);
+    pimpl->append(txn.m_writes);
+    scheduleCompaction();
+}
+
+bool KeyValueStore::transact(const TransactionFunc& func)
+{
+    KeyValueStorePimpl::Lock _l(*pimpl, true);
+    pimpl->refresh(true);
+    KeyValueTransaction txn;
+    txn.m_store = pimpl.get();
+    if (!func(txn))
+        return false;
+    if (!txn.empty()) {
+        pimpl->append(txn.m_writes);
+        scheduleCompaction();
+    }
+    return true;
+}
+
+void KeyValueStore::compact()
+{
+    KeyValueStorePimpl::Lock _l(*pimpl, true);
+    pimpl->compactionScheduled = false;
+    pimpl->compact();
+}
+
+const std::string& KeyValueStore::getPath() const
+{
+    return pimpl->dir;
+}
+
+void KeyValueStore::scheduleCompaction()
+{
+    if (pimpl->compactionScheduled || !pimpl->needsCompaction())
+        return;
+    pimpl->compactionScheduled = true;
+    pimpl->service->post(boost::bind(&KeyValueStore::compactLater, KeyValueStoreWeakPtr(shared_from_this())));
+}
+
+void KeyValueStore::compactLater(const KeyValueStoreWeakPtr& weak)
+{
+    KeyValueStorePtr store(weak.lock());
+    if (!store)
+        return;
+    try {
+        store->compact();
+    } catch (const std::exception& e) {
+        FBLOG_WARN("KeyValueStore", "Compacting " << store->getPath() << " failed: " << e.what());
+    }
+}
@@ -0,0 +1,170 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_KEYVALUESTORE
+#define H_FB_KEYVALUESTORE
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "FBPointers.h"
+
+namespace FB {
+
+    class KeyValueStorePimpl;
+    class KeyValueStore;
+    FB_FORWARD_PTR(KeyValueStore);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  KeyValueTransaction
+    ///
+    /// @brief  A set of writes that KeyValueStore applies all together or not at all.
+    ///
+    /// Either build one up and hand it to KeyValueStore::commit(), or use the one passed to the
+    /// function given to KeyValueStore::transact(), which can also read the store.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class KeyValueTransaction
+    {
+    public:
+        typedef std::map<std::string, boost::optional<std::string> > WriteMap;
+
+        KeyValueTransaction() : m_store(NULL) { }
+
+        // The value key will have once this commits (or none if it won't exist); inside
+        // KeyValueStore::transact() that takes the store's current contents into account
+        boost::optional<std::string> get(const std::string& key) const;
+        void put(const std::string& key, const std::string& value);
+        void erase(const std::string& key);
+
+        bool empty() const { return m_writes.empty(); }
+        void clear() { m_writes.clear(); }
+
+    protected:
+        friend class KeyValueStore;
+
+        WriteMap m_writes;
+        KeyValueStorePimpl* m_store;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  KeyValueStore
+    ///
+    /// @brief  A small persistent string to string map kept in a directory, that any number of plugin
+    ///         instances and processes can share.
+    ///
+    /// Commits are appended to a log, each as a single checksummed record, so a crash (or a kill)
+    /// partway through leaves the store as it was before that transaction. The log is folded into
+    /// a new snapshot in the background once it grows past Options::compactThreshold; the snapshot
+    /// is memory-mapped, so values that haven't changed since are read straight from it.
+    ///
+    /// Every operation takes a lock on the directory, so processes see each other's commits at the
+    /// next operation and read-modify-write with transact() is atomic across them:
+    /// @code
+    ///      FB::KeyValueStorePtr store(FB::KeyValueStore::open(
+    ///          FB::System::getAppDataPath("MyPlugin") + "/settings"));
+    ///      store->transact(boost::bind(&bumpLaunchCount, _1));
+    ///
+    ///      bool bumpLaunchCount(FB::KeyValueTransaction& txn) {
+    ///          int count = boost::lexical_cast<int>(txn.get("launches").get_value_or("0"));
+    ///          txn.put("launches", boost::lexical_cast<std::string>(count + 1));
+    ///          txn.put("lastLaunch", now());
+    ///          return true;
+    ///      }
+    /// @endcode
+    ///
+    /// Errors reading or writing the files are thrown as std::runtime_error.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class KeyValueStore : public boost::enable_shared_from_this<KeyValueStore>, boost::noncopyable
+    {
+    public:
+        struct Options
+        {
+            Options() : syncCommits(true), compactThreshold(1024 * 1024) { }
+
+            // Flush each commit to disk before commit() returns; without this a power failure can
+            // lose the last few commits (but still never applies part of one)
+            bool syncCommits;
+            // Compact once the log is bigger than this many bytes and than the snapshot
+            size_t compactThreshold;
+        };
+        // Make the writes on the transaction and return true to commit it, or false to roll back
+        typedef boost::function<bool (KeyValueTransaction&)> TransactionFunc;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static KeyValueStorePtr KeyValueStore::open(const std::string& dir,
+        ///     const Options& options = Options())
+        ///
+        /// @brief  Opens the store in dir (UTF-8), creating it if needed.
+        ///
+        /// Opening the same dir again in the same process returns the same store (and options)
+        /// while it is still open.
+        ///
+        /// @throws std::runtime_error if the directory can't be used or the snapshot is corrupt
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static KeyValueStorePtr open(const std::string& dir, const Options& options = Options());
+        ~KeyValueStore();
+
+        boost::optional<std::string> get(const std::string& key);
+        // The keys that start with prefix, in order
+        std::vector<std::string> getKeys(const std::string& prefix = std::string());
+        size_t size();
+
+        void put(const std::string& key, const std::string& value);
+        void erase(const std::string& key);
+        void commit(const KeyValueTransaction& txn);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool KeyValueStore::transact(const TransactionFunc& func)
+        ///
+        /// @brief  Calls func with the store locked against every other thread and process, and
+        ///         commits the writes it made if it returns true.
+        ///
+        /// func should only use the transaction it is given, not the store. If it throws nothing is
+        /// written and the exception is passed on.
+        ///
+        /// @return whether the transaction was committed
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool transact(const TransactionFunc& func);
+
+        // Folds the log into a new snapshot now, rather than waiting for it to grow
+        void compact();
+        const std::string& getPath() const;
+
+    protected:
+        KeyValueStore(const std::string& dir, const Options& options);
+        void scheduleCompaction();
+        static void compactLater(const KeyValueStoreWeakPtr& weak);
+
+        static std::map<std::string, KeyValueStoreWeakPtr> s_stores;
+        static boost::mutex s_storesMutex;
+
+    private:
+        boost::scoped_ptr<KeyValueStorePimpl> pimpl;
+    };
+};
+
+#endif // H_FB_KEYVALUESTORE
+
@@ -0,0 +1,105 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include "JSExceptions.h"
+#include "URI.h"
+#include "DOM/Window.h"
+#include "BrowserStreamScheduler.h"
+#include "KeyValueStoreAPI.h"
+
+using namespace FB;
+
+KeyValueStoreAPI::KeyValueStoreAPI(const FB::BrowserHostPtr& host, const KeyValueStorePtr& store)
+    : m_store(store), m_namespace(getPageOrigin(host))
+{
+    init();
+}
+
+KeyValueStoreAPI::KeyValueStoreAPI(const KeyValueStorePtr& store, const std::string& ns)
+    : m_store(store), m_namespace(ns)
+{
+    init();
+}
+
+KeyValueStoreAPI::~KeyValueStoreAPI()
+{
+}
+
+void KeyValueStoreAPI::init()
+{
+    // Kept apart from the keys the plugin itself uses
+    m_prefix = "page:" + m_namespace + "\n";
+
+    registerMethod("get", make_method(this, &KeyValueStoreAPI::get));
+    registerMethod("set", make_method(this, &KeyValueStoreAPI::set));
+    registerMethod("remove", make_method(this, &KeyValueStoreAPI::remove));
+    registerMethod("keys", make_method(this, &KeyValueStoreAPI::keys));
+    registerMethod("commit", make_method(this, &KeyValueStoreAPI::commit));
+    registerProperty("namespace", make_property(this, &KeyValueStoreAPI::get_namespace));
+}
+
+std::string KeyValueStoreAPI::getPageOrigin(const FB::BrowserHostPtr& host)
+{
+    try {
+        return BrowserStreamScheduler::getOrigin(FB::URI::fromString(host->getDOMWindow()->getLocation()));
+    } catch (const std::exception&) {
+        throw FB::script_error("Could not determine the origin of the page");
+    }
+}
+
+FB::variant KeyValueStoreAPI::get(const std::string& key)
+{
+    boost::optional<std::string> value(m_store->get(m_prefix + key));
+    if (value)
+        return *value;
+    return FB::FBNull();
+}
+
+void KeyValueStoreAPI::set(const std::string& key, const std::string& value)
+{
+    m_store->put(m_prefix + key, value);
+}
+
+void KeyValueStoreAPI::remove(const std::string& key)
+{
+    m_store->erase(m_prefix + key);
+}
+
+FB::VariantList KeyValueStoreAPI::keys()
+{
+    std::vector<std::string> keys(m_store->getKeys(m_prefix));
+    FB::VariantList out;
+    out.reserve(keys.size());
+    for (std::vector<std::string>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+        out.push_back(it->substr(m_prefix.size()));
+    return out;
+}
+
+void KeyValueStoreAPI::commit(const FB::VariantMap& changes)
+{
+    KeyValueTransaction txn;
+    for (FB::VariantMap::const_iterator it = changes.begin(); it != changes.end(); ++it) {
+        if (it->second.is_null() || it->second.empty()) {
+            txn.erase(m_prefix + it->first);
+        } else {
+            try {
+                txn.put(m_prefix + it->first, it->second.convert_cast<std::string>());
+            } catch (const FB::bad_variant_cast&) {
+                throw FB::invalid_arguments("The value of " + it->first + " is not a string");
+            }
+        }
+    }
+    m_store->commit(txn);
+}
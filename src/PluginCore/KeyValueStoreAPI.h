@@ -0,0 +1,81 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_KEYVALUESTOREAPI
+#define H_FB_KEYVALUESTOREAPI
+
+#include "JSAPIAuto.h"
+#include "BrowserHost.h"
+#include "KeyValueStore.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(KeyValueStoreAPI);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  KeyValueStoreAPI
+    ///
+    /// @brief  Gives javascript its own corner of a KeyValueStore.
+    ///
+    /// Each page origin (scheme, host and port) gets a separate namespace, so pages from different
+    /// sites using the same plugin can't see each other's data:
+    /// @code
+    ///      FB::JSAPIPtr MyPluginAPI::get_storage() {
+    ///          return boost::make_shared<FB::KeyValueStoreAPI>(m_host, m_plugin->getStore());
+    ///      }
+    ///
+    ///      // in the page
+    ///      plugin.storage.set("theme", "dark");
+    ///      plugin.storage.commit({ "draft": JSON.stringify(draft), "oldDraft": null });
+    /// @endcode
+    ///
+    /// Values are strings; use JSON for anything else.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class KeyValueStoreAPI : public FB::JSAPIAuto
+    {
+    public:
+        // The namespace of the page host is showing
+        KeyValueStoreAPI(const FB::BrowserHostPtr& host, const KeyValueStorePtr& store);
+        // A namespace of the plugin's choosing
+        KeyValueStoreAPI(const KeyValueStorePtr& store, const std::string& ns);
+        virtual ~KeyValueStoreAPI();
+
+        // The value, or null
+        FB::variant get(const std::string& key);
+        void set(const std::string& key, const std::string& value);
+        void remove(const std::string& key);
+        FB::VariantList keys();
+        // Sets each key in changes to its value, or removes it if the value is null; all of the
+        // changes are made or none are
+        void commit(const FB::VariantMap& changes);
+
+        const std::string& get_namespace() const { return m_namespace; }
+
+        // scheme://host[:port] of the page host is showing
+        static std::string getPageOrigin(const FB::BrowserHostPtr& host);
+
+    protected:
+        void init();
+
+        KeyValueStorePtr m_store;
+        std::string m_namespace;
+        std::string m_prefix;
+    };
+};
+
+#endif // H_FB_KEYVALUESTOREAPI
+
@@ -0,0 +1,64 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "PluginEvent.h"
+#include "PluginEventSource.h"
+#include "PluginEventMap.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+
+using namespace FB;
+
+namespace {
+    // Stands in for the dynamic type of a NULL event source
+    struct NullEventSource { };
+}
+
+PluginEventTypeKey::PluginEventTypeKey( PluginEvent* evt, PluginEventSource* src )
+    : evtType(&typeid(*evt)), srcType(src ? &typeid(*src) : &typeid(NullEventSource))
+{
+}
+
+PluginEventMap::PluginEventMap() : m_count(0)
+{
+    for (size_t i = 0; i < SlotCount; ++i)
+        m_slots[i].store(NULL, boost::memory_order_relaxed);
+}
+
+PluginEventMap::~PluginEventMap()
+{
+    for (size_t i = 0; i < SlotCount; ++i)
+        delete m_slots[i].load(boost::memory_order_relaxed);
+}
+
+void PluginEventMap::store( const PluginEventTypeKey& key, const Resolution& res )
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    for (size_t i = slotFor(key), probes = 0; probes < SlotCount; i = (i + 1) % SlotCount, ++probes) {
+        const Entry* entry(m_slots[i].load(boost::memory_order_relaxed));
+        if (entry && entry->key == key)
+            return; // another thread resolved it first, to the same answer
+        if (!entry) {
+            m_slots[i].store(new Entry(key, res), boost::memory_order_release);
+            ++m_count;
+            return;
+        }
+    }
+}
+
+size_t PluginEventMap::size() const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_count;
+}
+
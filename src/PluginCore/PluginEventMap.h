@@ -0,0 +1,202 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_PLUGINEVENTMAP
+#define H_FB_PLUGINEVENTMAP
+
+#include <typeinfo>
+#include <cstddef>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace FB {
+
+    class PluginEvent;
+    class PluginEventSource;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  PluginEventTypeKey
+    ///
+    /// @brief  Identifies the dynamic types of an (event, source) pair.
+    ///
+    /// The key is read straight from the vtables of the two objects (typeid on a polymorphic lvalue),
+    /// so building it never performs a cast.  A NULL source is given a key of its own.  Keys compare
+    /// by the addresses of the type_info objects; a type with more than one, as can happen across
+    /// shared libraries, just takes one entry in the table for each.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct PluginEventTypeKey
+    {
+        PluginEventTypeKey(PluginEvent* evt, PluginEventSource* src);
+
+        const std::type_info* evtType;
+        const std::type_info* srcType;
+
+        bool operator==(const PluginEventTypeKey& rh) const
+        {
+            return evtType == rh.evtType && srcType == rh.srcType;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  PluginEventMap
+    ///
+    /// @brief  Per-class dispatch table used by BEGIN_PLUGIN_EVENT_MAP / EVENTTYPE_CASE.
+    ///
+    /// Each event map owns one (function-local static) PluginEventMap.  The first time a given
+    /// combination of event type and source type is dispatched the map is walked with dynamic_cast
+    /// as before; the index of the case that matched (or the fact that none did) and the pointer
+    /// adjustments needed to reach the event and source types are then remembered.  Every later
+    /// dispatch of that combination resolves with a single table lookup and integer compares.
+    ///
+    /// The table is a fixed number of slots, hashed on the key, each pointing to an entry that never
+    /// changes once it is published.  Lookups only load the slots, so dispatch takes no lock; adding
+    /// an entry takes one.  Should the slots ever fill up, the combinations left over are resolved
+    /// with dynamic_cast each time, as they were before there was a table.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class PluginEventMap : boost::noncopyable
+    {
+    public:
+        struct Resolution
+        {
+            Resolution() : caseIdx(0), evtOffset(0), srcOffset(0) { }
+            int caseIdx;                // 1-based index of the matching case; 0 means no case matched
+            std::ptrdiff_t evtOffset;   // byte offset from the PluginEvent* to the case's event type
+            std::ptrdiff_t srcOffset;   // byte offset from the PluginEventSource* to the source type
+        };
+
+        PluginEventMap();
+        ~PluginEventMap();
+
+        bool find(const PluginEventTypeKey& key, Resolution& out) const
+        {
+            for (size_t i = slotFor(key), probes = 0; probes < SlotCount; i = (i + 1) % SlotCount, ++probes) {
+                const Entry* entry(m_slots[i].load(boost::memory_order_acquire));
+                if (!entry)
+                    return false;
+                if (entry->key == key) {
+                    out = entry->res;
+                    return true;
+                }
+            }
+            return false;
+        }
+        void store(const PluginEventTypeKey& key, const Resolution& res);
+        size_t size() const;
+
+    private:
+        struct Entry
+        {
+            Entry(const PluginEventTypeKey& key, const Resolution& res) : key(key), res(res) { }
+            const PluginEventTypeKey key;
+            const Resolution res;
+        };
+        enum { SlotCount = 64 };
+
+        static size_t slotFor(const PluginEventTypeKey& key)
+        {
+            // type_info objects are at least pointer aligned, so the low bits carry nothing
+            const size_t evt(reinterpret_cast<size_t>(key.evtType) >> 3);
+            const size_t src(reinterpret_cast<size_t>(key.srcType) >> 3);
+            return (evt * 31 + src) % SlotCount;
+        }
+
+        boost::atomic<const Entry*> m_slots[SlotCount];
+        size_t m_count;
+        // Only held to add an entry
+        mutable boost::mutex m_mutex;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  PluginEventDispatcher
+    ///
+    /// @brief  Dispatch state for a single call to an event map's HandleEvent.  You should never need
+    ///         to use this directly; the event map macros create it for you.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class PluginEventDispatcher : boost::noncopyable
+    {
+    public:
+        PluginEventDispatcher(PluginEventMap& map, PluginEvent* evt, PluginEventSource* src)
+            : m_map(map), m_key(evt, src), m_evt(evt), m_src(src), m_caseIdx(0)
+        {
+            m_resolved = m_map.find(m_key, m_res);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn template <class EvtType, class SrcType> bool PluginEventDispatcher::matches()
+        ///
+        /// @brief  Tests the next case in the map.  Must be evaluated once per case, in map order.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        template <class EvtType, class SrcType>
+        bool matches()
+        {
+            ++m_caseIdx;
+            if (m_resolved)
+                return m_res.caseIdx == m_caseIdx;
+
+            EvtType* evt(dynamic_cast<EvtType*>(m_evt));
+            SrcType* src(dynamic_cast<SrcType*>(m_src));
+            if (!evt || !src)
+                return false;
+
+            m_res.caseIdx = m_caseIdx;
+            m_res.evtOffset = reinterpret_cast<char*>(evt) - reinterpret_cast<char*>(m_evt);
+            m_res.srcOffset = reinterpret_cast<char*>(src) - reinterpret_cast<char*>(m_src);
+            m_resolved = true;
+            m_map.store(m_key, m_res);
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool PluginEventDispatcher::exhausted()
+        ///
+        /// @brief  Called when every case in the map has been tested without a match; remembers that so
+        ///         the next event of the same type skips the casts entirely.  Always returns false.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool exhausted()
+        {
+            if (!m_resolved) {
+                m_res = PluginEventMap::Resolution();
+                m_resolved = true;
+                m_map.store(m_key, m_res);
+            }
+            return false;
+        }
+
+        template <class EvtType>
+        EvtType* event() const
+        {
+            return reinterpret_cast<EvtType*>(reinterpret_cast<char*>(m_evt) + m_res.evtOffset);
+        }
+
+        template <class SrcType>
+        SrcType* source() const
+        {
+            return reinterpret_cast<SrcType*>(reinterpret_cast<char*>(m_src) + m_res.srcOffset);
+        }
+
+    private:
+        PluginEventMap& m_map;
+        PluginEventTypeKey m_key;
+        PluginEvent* m_evt;
+        PluginEventSource* m_src;
+        PluginEventMap::Resolution m_res;
+        bool m_resolved;
+        int m_caseIdx;
+    };
+};
+
+#endif
+
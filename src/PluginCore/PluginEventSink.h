@@ -17,6 +17,7 @@ Copyright 2009 PacketPass, Inc and the Firebreath development team
 #define H_FB_PLUGINEVENTSINK
 
 #include "PluginEventSource.h"
+#include "PluginEventMap.h"
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
@@ -91,10 +92,17 @@ namespace FB {
 /// This will create an implementation of the HandleEvent function.  It must be matched with
 /// a END_PLUGIN_EVENT_MAP() call
 ///
+/// Each event map keeps a static FB::PluginEventMap; the casts needed to pick a case are only done
+/// the first time a given event type arrives from a given source type, after which that combination
+/// is dispatched straight from the table.
+///
 /// @remarks    Richard Bateman, 10/15/2010. 
 /// @see EVENTTYPE_CASE
+/// @see FB::PluginEventMap
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #define BEGIN_PLUGIN_EVENT_MAP() virtual bool HandleEvent(FB::PluginEvent *evt, FB::PluginEventSource *src) { \
+                                          static FB::PluginEventMap _fbEventMap; \
+                                          FB::PluginEventDispatcher _fbDispatch(_fbEventMap, evt, src); \
                                           if (0) { }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -115,10 +123,16 @@ namespace FB {
 /// @see BEGIN_PLUGIN_EVENT_MAP
 /// @see END_PLUGIN_EVENT_MAP
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-#define EVENTTYPE_CASE(eventType, methodName, srcType) else if (evt->validType<eventType>() && src->validType<srcType>()) { \
-                                                return methodName(evt->get<eventType>(), src->get_as<srcType>()); }
+#define EVENTTYPE_CASE(eventType, methodName, srcType) else if (_fbDispatch.matches<eventType, srcType>()) { \
+                                                return methodName(_fbDispatch.event<eventType>(), _fbDispatch.source<srcType>()); }
 
-#define PLUGIN_EVENT_MAP_CASCADE(super) else return super::HandleEvent(evt, src);
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @def    PLUGIN_EVENT_MAP_CASCADE(super)
+///
+/// @brief  Passes any event not handled by the map on to super::HandleEvent.  Must be the last
+///         entry before END_PLUGIN_EVENT_MAP
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#define PLUGIN_EVENT_MAP_CASCADE(super) else if (!_fbDispatch.exhausted()) return super::HandleEvent(evt, src);
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @def    END_PLUGIN_EVENT_MAP()
@@ -128,7 +142,7 @@ namespace FB {
 /// @remarks    Richard Bateman, 10/15/2010. 
 /// @see EVENTTYPE_CASE
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-#define END_PLUGIN_EVENT_MAP() return false; }
+#define END_PLUGIN_EVENT_MAP() else _fbDispatch.exhausted(); return false; }
 
 #endif
 
@@ -0,0 +1,314 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "win_targetver.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include "logging.h"
+#include "BrowserHost.h"
+
+#include "Reactor.h"
+
+using namespace FB;
+
+namespace FB {
+    // An io_service and the threads running it. The threads share it, so one that is left
+    // running after shutdown still has everything it touches.
+    class ReactorPool : boost::noncopyable {
+    public:
+        explicit ReactorPool(const char* _name) : name(_name), io_idlework(new boost::asio::io_service::work(io_service)),
+            target(0) {}
+
+        const char* name;
+        boost::asio::io_service io_service;
+        // Keeps the threads running while there is nothing to do
+        boost::scoped_ptr<boost::asio::io_service::work> io_idlework;
+        mutable boost::mutex mutex;
+        std::vector<boost::shared_ptr<boost::thread> > threads;
+        // Threads there will be once the retirements already posted have happened
+        size_t target;
+    };
+};
+
+namespace {
+    // Thrown on a thread to make it leave its pool
+    struct worker_retired { };
+
+    void retire_worker()
+    {
+        throw worker_retired();
+    }
+
+    void run_worker(const boost::shared_ptr<ReactorPool>& pool)
+    {
+        while (true) {
+            try {
+                pool->io_service.run();
+                return;
+            } catch (const worker_retired&) {
+                boost::mutex::scoped_lock _l(pool->mutex);
+                for (size_t i = 0; i < pool->threads.size(); ++i) {
+                    if (pool->threads[i]->get_id() == boost::this_thread::get_id()) {
+                        pool->threads.erase(pool->threads.begin() + i);
+                        break;
+                    }
+                }
+                return;
+            } catch (const std::exception& e) {
+                // The io_service can be run again after a handler throws; the thread is still needed
+                FBLOG_ERROR("Reactor", "Unhandled exception in a " << pool->name << " handler: " << e.what());
+            } catch (...) {
+                FBLOG_ERROR("Reactor", "Unhandled exception in a " << pool->name << " handler");
+            }
+        }
+    }
+
+    void resize_pool(const boost::shared_ptr<ReactorPool>& pool, size_t count)
+    {
+        if (count == 0)
+            throw std::invalid_argument("The reactor needs at least one thread in each pool");
+        boost::mutex::scoped_lock _l(pool->mutex);
+        // Whichever threads pick up the retirements leave once they've finished what they are doing
+        for (; pool->target > count; --pool->target)
+            pool->io_service.post(&retire_worker);
+        for (; pool->target < count; ++pool->target)
+            pool->threads.push_back(boost::make_shared<boost::thread>(boost::bind(&run_worker, pool)));
+    }
+
+    size_t pool_size(const boost::shared_ptr<ReactorPool>& pool)
+    {
+        boost::mutex::scoped_lock _l(pool->mutex);
+        return pool->target;
+    }
+
+    bool in_pool(const boost::shared_ptr<ReactorPool>& pool)
+    {
+        boost::mutex::scoped_lock _l(pool->mutex);
+        for (size_t i = 0; i < pool->threads.size(); ++i) {
+            if (pool->threads[i]->get_id() == boost::this_thread::get_id())
+                return true;
+        }
+        return false;
+    }
+
+    void stop_pool(const boost::shared_ptr<ReactorPool>& pool, const boost::posix_time::ptime& deadline)
+    {
+        std::vector<boost::shared_ptr<boost::thread> > threads;
+        {
+            boost::mutex::scoped_lock _l(pool->mutex);
+            pool->io_idlework.reset();
+            threads.swap(pool->threads);
+            pool->target = 0;
+        }
+        pool->io_service.stop();
+        for (size_t i = 0; i < threads.size(); ++i) {
+            // The last reference can be released by a handler, in which case that thread finishes
+            // on its own; so does one running a handler that doesn't return in time
+            if (threads[i]->get_id() == boost::this_thread::get_id()) {
+                threads[i]->detach();
+            } else if (!threads[i]->timed_join(deadline)) {
+                FBLOG_WARN("Reactor", "A " << pool->name << " thread did not stop within the teardown budget; detaching it");
+                threads[i]->detach();
+            }
+        }
+    }
+}
+
+ReactorWeakPtr Reactor::inst;
+boost::mutex Reactor::instance_mutex;
+size_t Reactor::default_threads = 2;
+size_t Reactor::default_blocking_threads = 4;
+
+ReactorPtr Reactor::instance()
+{
+    boost::mutex::scoped_lock lock(instance_mutex);
+    ReactorPtr reactor(inst.lock());
+    if (!reactor) {
+        reactor = create(default_threads, default_blocking_threads);
+        inst = reactor;
+    }
+    return reactor;
+}
+
+ReactorPtr Reactor::create(size_t threads, size_t blockingThreads)
+{
+    return ReactorPtr(new Reactor(threads, blockingThreads));
+}
+
+void Reactor::shutdownInstance()
+{
+    ReactorPtr reactor;
+    {
+        boost::mutex::scoped_lock lock(instance_mutex);
+        reactor = inst.lock();
+    }
+    if (reactor)
+        reactor->shutdown();
+}
+
+void Reactor::setDefaultThreadCounts(size_t threads, size_t blockingThreads)
+{
+    if (threads == 0 || blockingThreads == 0)
+        throw std::invalid_argument("The reactor needs at least one thread in each pool");
+    boost::mutex::scoped_lock lock(instance_mutex);
+    default_threads = threads;
+    default_blocking_threads = blockingThreads;
+}
+
+Reactor::Reactor(size_t threads, size_t blockingThreads)
+    : m_pool(boost::make_shared<ReactorPool>("reactor")), m_blockingPool(boost::make_shared<ReactorPool>("blocking")),
+      m_nextHookId(0), m_runningHook(0), m_isShutDown(false)
+{
+    resize_pool(m_pool, threads);
+    resize_pool(m_blockingPool, blockingThreads);
+}
+
+Reactor::~Reactor()
+{
+    shutdown();
+}
+
+boost::asio::io_service& Reactor::getIOService()
+{
+    return m_pool->io_service;
+}
+
+Reactor::StrandPtr Reactor::getStrand(const std::string& subsystem)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    StrandPtr& strand(m_strands[subsystem]);
+    if (!strand)
+        strand.reset(new boost::asio::io_service::strand(m_pool->io_service));
+    return strand;
+}
+
+void Reactor::setThreadCount(size_t count)
+{
+    if (isShutDown())
+        return;
+    resize_pool(m_pool, count);
+}
+
+size_t Reactor::getThreadCount() const
+{
+    return pool_size(m_pool);
+}
+
+void Reactor::setBlockingThreadCount(size_t count)
+{
+    if (isShutDown())
+        return;
+    resize_pool(m_blockingPool, count);
+}
+
+size_t Reactor::getBlockingThreadCount() const
+{
+    return pool_size(m_blockingPool);
+}
+
+bool Reactor::isReactorThread() const
+{
+    return in_pool(m_pool) || in_pool(m_blockingPool);
+}
+
+bool Reactor::postBlocking(const boost::function<void ()>& func)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    if (m_isShutDown)
+        return false;
+    m_blockingPool->io_service.post(func);
+    return true;
+}
+
+int Reactor::addShutdownHook(const std::string& subsystem, const ShutdownHook& hook)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    if (m_isShutDown)
+        return 0;
+    Hook& entry(m_hooks[++m_nextHookId]);
+    entry.subsystem = subsystem;
+    entry.hook = hook;
+    return m_nextHookId;
+}
+
+void Reactor::removeShutdownHook(int id)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_hooks.erase(id);
+    // The hook may be using whatever its owner is about to destroy
+    while (id && m_runningHook == id && m_hookThread != boost::this_thread::get_id())
+        m_hookDone.wait(_l);
+}
+
+void Reactor::shutdown()
+{
+    std::map<int, Hook> hooks;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        if (m_isShutDown)
+            return;
+        m_isShutDown = true;
+        hooks = m_hooks;
+    }
+    // One budget for the hooks and the pools together, however many hooks there are
+    const boost::posix_time::ptime deadline(boost::get_system_time()
+        + boost::posix_time::milliseconds(BrowserHost::getTeardownBudget()));
+
+    for (std::map<int, Hook>::reverse_iterator it = hooks.rbegin(); it != hooks.rend(); ++it) {
+        {
+            boost::mutex::scoped_lock _l(m_mutex);
+            // Its owner may have gone away since
+            if (!m_hooks.count(it->first))
+                continue;
+            m_runningHook = it->first;
+            m_hookThread = boost::this_thread::get_id();
+        }
+        try {
+            it->second.hook(deadline);
+        } catch (const std::exception& e) {
+            FBLOG_ERROR("Reactor", "Shutdown hook for " << it->second.subsystem << " threw: " << e.what());
+        } catch (...) {
+            FBLOG_ERROR("Reactor", "Shutdown hook for " << it->second.subsystem << " threw");
+        }
+        {
+            boost::mutex::scoped_lock _l(m_mutex);
+            m_runningHook = 0;
+            m_hookThread = boost::thread::id();
+        }
+        m_hookDone.notify_all();
+    }
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_hooks.clear();
+        m_strands.clear();
+    }
+
+    stop_pool(m_pool, deadline);
+    stop_pool(m_blockingPool, deadline);
+
+    // Whoever asks for the instance from now on gets a new one
+    boost::mutex::scoped_lock lock(instance_mutex);
+    ReactorPtr current(inst.lock());
+    if (current.get() == this)
+        inst.reset();
+}
+
+bool Reactor::isShutDown() const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_isShutDown;
+}
@@ -0,0 +1,169 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_REACTOR
+#define H_FB_REACTOR
+
+#include "win_targetver.h"
+#include <map>
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "FBPointers.h"
+
+namespace FB {
+
+    class ReactorPool;
+    FB_FORWARD_PTR(Reactor);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  Reactor
+    ///
+    /// @brief  The io_service, and the threads running it, that the plugin's asynchronous I/O shares:
+    ///         Timer, the HTTP::HTTPService listeners and sessions, and HTTP::HTTPRequest.
+    ///
+    /// Rather than each of those starting threads of its own, they all register with the one
+    /// Reactor, so the number of threads a plugin uses is what setThreadCount says however many
+    /// timers, servers and requests are active. Handlers that must not run concurrently are wrapped
+    /// in a strand; each subsystem gets one by name from getStrand.
+    ///
+    /// Work that has to block, such as a libcurl transfer, must not tie up the I/O threads, so it is
+    /// given to postBlocking instead, which runs it on a second, bounded pool.
+    ///
+    /// Subsystems add a shutdown hook to stop what they have in flight. shutdown() calls the hooks,
+    /// newest first, then stops both pools; it is called when the module is unloaded, or when the
+    /// last reference to the Reactor goes away.
+    ///
+    /// @code
+    ///      FB::ReactorPtr reactor(FB::Reactor::instance());
+    ///      boost::asio::deadline_timer timer(reactor->getIOService());
+    ///      timer.async_wait(reactor->getStrand("myplugin")->wrap(boost::bind(&MyPluginAPI::onTick, this, _1)));
+    /// @endcode
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class Reactor : boost::noncopyable
+    {
+    public:
+        typedef boost::shared_ptr<boost::asio::io_service::strand> StrandPtr;
+        // Given the time by which the whole shutdown is meant to be over
+        typedef boost::function<void (const boost::posix_time::ptime& deadline)> ShutdownHook;
+
+        static ReactorPtr instance();
+        static ReactorPtr create(size_t threads, size_t blockingThreads);
+        // Shuts down the shared instance, if there is one; called when the plugin module is unloaded
+        static void shutdownInstance();
+        // The pool sizes instance() uses the next time it has to create the Reactor
+        static void setDefaultThreadCounts(size_t threads, size_t blockingThreads);
+        ~Reactor();
+
+        boost::asio::io_service& getIOService();
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn StrandPtr Reactor::getStrand(const std::string& subsystem)
+        ///
+        /// @brief  Returns the strand for subsystem (e.g. "timers"), creating it the first time; every
+        ///         caller asking for the same name gets the same strand.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        StrandPtr getStrand(const std::string& subsystem);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void Reactor::setThreadCount(size_t count)
+        ///
+        /// @brief  Grows or shrinks the pool running the io_service. A thread being retired finishes
+        ///         the handler it is running first.
+        ///
+        /// @throws std::invalid_argument if count is 0
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setThreadCount(size_t count);
+        size_t getThreadCount() const;
+
+        // Like setThreadCount, for the pool that postBlocking uses
+        void setBlockingThreadCount(size_t count);
+        size_t getBlockingThreadCount() const;
+
+        // Whether the calling thread is in either pool
+        bool isReactorThread() const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool Reactor::postBlocking(const boost::function<void ()>& func)
+        ///
+        /// @brief  Runs func on the blocking pool; once every thread there is busy, work waits its turn.
+        ///
+        /// @return false, without running func, if the Reactor has been shut down
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool postBlocking(const boost::function<void ()>& func);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn int Reactor::addShutdownHook(const std::string& subsystem, const ShutdownHook& hook)
+        ///
+        /// @brief  Has shutdown() call hook before it stops the pools, so the subsystem can cancel
+        ///         what it has in flight. Every hook is given the same deadline, so a hook waiting
+        ///         for its work to stop should wait no later than that.
+        ///
+        /// @return an id for removeShutdownHook; 0 if the Reactor has already been shut down
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        int addShutdownHook(const std::string& subsystem, const ShutdownHook& hook);
+        // Once this returns the hook isn't running and won't be called, unless it's the caller
+        void removeShutdownHook(int id);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void Reactor::shutdown()
+        ///
+        /// @brief  Calls the shutdown hooks, newest first, then stops both pools, dropping whatever
+        ///         handlers are still queued. The hooks and the pools share one teardown budget (see
+        ///         BrowserHost::getTeardownBudget), counted from when shutdown starts; threads that
+        ///         haven't stopped by the end of it are left to finish on their own.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void shutdown();
+        bool isShutDown() const;
+
+    protected:
+        Reactor(size_t threads, size_t blockingThreads);
+
+        static ReactorWeakPtr inst;
+        static boost::mutex instance_mutex;
+        static size_t default_threads;
+        static size_t default_blocking_threads;
+
+        struct Hook {
+            std::string subsystem;
+            ShutdownHook hook;
+        };
+
+    private:
+        boost::shared_ptr<ReactorPool> m_pool;
+        boost::shared_ptr<ReactorPool> m_blockingPool;
+
+        mutable boost::mutex m_mutex;
+        std::map<std::string, StrandPtr> m_strands;
+        // Keyed by id, so newest last
+        std::map<int, Hook> m_hooks;
+        int m_nextHookId;
+        // The hook shutdown() is calling, and the thread calling it
+        int m_runningHook;
+        boost::thread::id m_hookThread;
+        boost::condition_variable m_hookDone;
+        bool m_isShutDown;
+    };
+};
+
+#endif // H_FB_REACTOR
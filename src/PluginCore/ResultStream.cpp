@@ -0,0 +1,233 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <algorithm>
+#include <boost/bind.hpp>
+#include "logging.h"
+#include "ResultStream.h"
+
+using namespace FB;
+
+ResultStreamPtr ResultStream::create(size_t capacity, OverflowPolicy policy, const BatchCallback& onBatch,
+    const DoneCallback& onDone, const Dispatcher& dispatcher)
+{
+    return ResultStreamPtr(new ResultStream(std::max(capacity, size_t(1)), policy, onBatch, onDone, dispatcher));
+}
+
+ResultStream::ResultStream(size_t capacity, OverflowPolicy policy, const BatchCallback& onBatch,
+    const DoneCallback& onDone, const Dispatcher& dispatcher)
+    : m_capacity(capacity), m_policy(policy), m_onBatch(onBatch), m_onDone(onDone), m_dispatcher(dispatcher),
+    m_credits(0), m_highWater(0), m_dropped(0), m_scheduled(false), m_delivering(false), m_closed(false),
+    m_finished(false), m_canceled(false), m_tokenId(0)
+{
+}
+
+ResultStream::~ResultStream()
+{
+    if (m_token)
+        m_token->unregister(m_tokenId);
+}
+
+bool ResultStream::write(const FB::variant& item)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_canceled || m_closed)
+        return false;
+    if (m_items.size() >= m_capacity) {
+        switch (m_policy) {
+        case OVERFLOW_BLOCK:
+            while (m_items.size() >= m_capacity && !m_canceled && !m_closed)
+                m_spaceCond.wait(lock);
+            if (m_canceled || m_closed)
+                return false;
+            break;
+        case OVERFLOW_DROP_NEWEST:
+            ++m_dropped;
+            return false;
+        case OVERFLOW_DROP_OLDEST:
+            m_items.pop_front();
+            ++m_dropped;
+            break;
+        }
+    }
+    m_items.push_back(item);
+    m_highWater = std::max(m_highWater, m_items.size());
+    schedule(lock);
+    return true;
+}
+
+void ResultStream::close()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_canceled || m_closed)
+        return;
+    m_closed = true;
+    m_spaceCond.notify_all();
+    schedule(lock);
+}
+
+void ResultStream::fail(const std::string& error)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_canceled || m_closed)
+        return;
+    m_closed = true;
+    m_error = error.empty() ? "Stream failed" : error;
+    m_spaceCond.notify_all();
+    schedule(lock);
+}
+
+bool ResultStream::isCanceled() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_canceled;
+}
+
+void ResultStream::grant(size_t count)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_finished)
+        return;
+    m_credits += count;
+    schedule(lock);
+}
+
+void ResultStream::cancel()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if (m_canceled)
+            return;
+        m_canceled = true;
+        m_finished = true;
+        m_items.clear();
+        m_spaceCond.notify_all();
+    }
+    FBLOG_TRACE("ResultStream", "Stream canceled");
+}
+
+void ResultStream::setCancellationToken(const CancellationTokenPtr& token)
+{
+    if (m_token)
+        m_token->unregister(m_tokenId);
+    m_token = token;
+    m_tokenId = 0;
+    if (m_token)
+        m_tokenId = m_token->onCancel(boost::bind(&ResultStream::onCancel, ResultStreamWeakPtr(shared_from_this())));
+}
+
+void ResultStream::onCancel(const ResultStreamWeakPtr& weak)
+{
+    ResultStreamPtr self(weak.lock());
+    if (self)
+        self->cancel();
+}
+
+size_t ResultStream::getCredits() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_credits;
+}
+
+size_t ResultStream::getBuffered() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_items.size();
+}
+
+size_t ResultStream::getHighWater() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_highWater;
+}
+
+size_t ResultStream::getDropped() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_dropped;
+}
+
+bool ResultStream::isFinished() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_finished;
+}
+
+bool ResultStream::isReady() const
+{
+    if (m_finished)
+        return false;
+    return m_items.empty() ? m_closed : m_credits > 0;
+}
+
+void ResultStream::schedule(boost::mutex::scoped_lock& lock)
+{
+    if (m_scheduled || !isReady())
+        return;
+    m_scheduled = true;
+    if (!m_dispatcher) {
+        lock.unlock();
+        pump();
+        return;
+    }
+    Dispatcher dispatcher(m_dispatcher);
+    ResultStreamWeakPtr weak(shared_from_this());
+    lock.unlock();
+    try {
+        dispatcher(boost::bind(&ResultStream::pumpLater, weak));
+    } catch (const std::exception& e) {
+        // Nowhere left to deliver to (the plugin is probably shutting down)
+        FBLOG_INFO("ResultStream", "Could not schedule a delivery, canceling: " << e.what());
+        cancel();
+    }
+}
+
+void ResultStream::pumpLater(const ResultStreamWeakPtr& weak)
+{
+    ResultStreamPtr self(weak.lock());
+    if (self)
+        self->pump();
+}
+
+void ResultStream::pump()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_scheduled = false;
+    // Whoever is delivering picks up anything that became ready meanwhile
+    if (m_delivering)
+        return;
+    m_delivering = true;
+    while (isReady()) {
+        if (!m_items.empty()) {
+            size_t count = std::min(m_credits, m_items.size());
+            FB::VariantList batch(m_items.begin(), m_items.begin() + count);
+            m_items.erase(m_items.begin(), m_items.begin() + count);
+            m_credits -= count;
+            m_spaceCond.notify_all();
+            lock.unlock();
+            if (m_onBatch)
+                m_onBatch(batch);
+            lock.lock();
+        } else {
+            m_finished = true;
+            std::string error(m_error);
+            lock.unlock();
+            if (m_onDone)
+                m_onDone(error.empty(), error);
+            lock.lock();
+        }
+    }
+    m_delivering = false;
+}
@@ -0,0 +1,142 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_RESULTSTREAM
+#define H_FB_RESULTSTREAM
+
+#include <deque>
+#include <string>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "APITypes.h"
+#include "CancellationToken.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(ResultStream);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  ResultStream
+    ///
+    /// @brief  A bounded queue of results that a producer writes into from any thread, and that hands
+    ///         them on to the consumer in batches as the consumer grants credits.
+    ///
+    /// The consumer is given at most one item per credit. Items it hasn't got credit for yet wait in
+    /// the stream, up to capacity of them; past that the OverflowPolicy decides whether write()
+    /// blocks the producer or something is dropped. Either way what the stream holds is bounded by
+    /// capacity, however slow the consumer is.
+    ///
+    /// Deliveries are made through the dispatcher, which should run the function it is given later
+    /// on the consumer's thread (ResultStreamAPI uses BrowserHost::ScheduleOnMainThread). Only one is
+    /// outstanding at a time, and it delivers everything that has become ready meanwhile in one
+    /// batch, so a producer writing many small items costs the consumer's thread one call per batch
+    /// rather than one per item. Without a dispatcher deliveries are made on whichever thread wrote
+    /// or granted.
+    ///
+    /// After close() or fail() the items still in the stream are delivered as usual, then the done
+    /// callback is called. Once cancel() is called nothing more is delivered, write() returns false
+    /// and producers blocked in it return; producers should stop when they see isCanceled().
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ResultStream : public boost::enable_shared_from_this<ResultStream>, boost::noncopyable
+    {
+    public:
+        enum OverflowPolicy {
+            // write() waits for room
+            OVERFLOW_BLOCK,
+            // The item being written is dropped
+            OVERFLOW_DROP_NEWEST,
+            // The oldest item not yet delivered is dropped to make room
+            OVERFLOW_DROP_OLDEST
+        };
+        typedef boost::function<void (const FB::VariantList&)> BatchCallback;
+        // success, error message if !success
+        typedef boost::function<void (bool, const std::string&)> DoneCallback;
+        typedef boost::function<void (const boost::function<void ()>&)> Dispatcher;
+
+        static ResultStreamPtr create(size_t capacity, OverflowPolicy policy, const BatchCallback& onBatch,
+            const DoneCallback& onDone, const Dispatcher& dispatcher = Dispatcher());
+        ~ResultStream();
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool ResultStream::write(const FB::variant& item)
+        ///
+        /// @brief  Adds an item to the stream.
+        ///
+        /// @return false if the item was dropped, or the stream was canceled or already finished
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool write(const FB::variant& item);
+        // Ends the stream successfully once what it holds has been delivered
+        void close();
+        // Ends the stream with an error once what it holds has been delivered
+        void fail(const std::string& error);
+        bool isCanceled() const;
+
+        // Allows count more items to be delivered
+        void grant(size_t count);
+        void cancel();
+        // The stream is canceled when token is (typically the BrowserHost's, so that producers stop
+        // when the plugin shuts down)
+        void setCancellationToken(const CancellationTokenPtr& token);
+
+        size_t getCredits() const;
+        // Items written but not yet delivered
+        size_t getBuffered() const;
+        // The most items the stream has held at once
+        size_t getHighWater() const;
+        size_t getDropped() const;
+        // Done was called, or the stream was canceled
+        bool isFinished() const;
+
+    protected:
+        ResultStream(size_t capacity, OverflowPolicy policy, const BatchCallback& onBatch,
+            const DoneCallback& onDone, const Dispatcher& dispatcher);
+        // Called with m_mutex held
+        bool isReady() const;
+        void schedule(boost::mutex::scoped_lock& lock);
+        static void pumpLater(const ResultStreamWeakPtr& weak);
+        static void onCancel(const ResultStreamWeakPtr& weak);
+        void pump();
+
+        const size_t m_capacity;
+        const OverflowPolicy m_policy;
+        BatchCallback m_onBatch;
+        DoneCallback m_onDone;
+        Dispatcher m_dispatcher;
+
+        mutable boost::mutex m_mutex;
+        boost::condition_variable m_spaceCond;
+        std::deque<FB::variant> m_items;
+        size_t m_credits;
+        size_t m_highWater;
+        size_t m_dropped;
+        bool m_scheduled;
+        bool m_delivering;
+        bool m_closed;
+        bool m_finished;
+        bool m_canceled;
+        std::string m_error;
+
+        CancellationTokenPtr m_token;
+        int m_tokenId;
+    };
+};
+
+#endif // H_FB_RESULTSTREAM
@@ -0,0 +1,109 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <boost/bind.hpp>
+#include "JSExceptions.h"
+#include "variant_list.h"
+#include "ResultStreamAPI.h"
+
+using namespace FB;
+
+ResultStreamAPIPtr ResultStreamAPI::create(const BrowserHostPtr& host, size_t capacity,
+    ResultStream::OverflowPolicy policy)
+{
+    ResultStreamAPIPtr api(new ResultStreamAPI());
+    ResultStreamAPIWeakPtr weak(api);
+    api->m_stream = ResultStream::create(capacity, policy,
+        boost::bind(&ResultStreamAPI::onBatch, weak, _1),
+        boost::bind(&ResultStreamAPI::onDone, weak, _1, _2),
+        boost::bind(&ResultStreamAPI::dispatch, BrowserHostWeakPtr(host), weak, _1));
+    api->m_stream->setCancellationToken(host->getCancellationToken());
+    return api;
+}
+
+ResultStreamAPI::ResultStreamAPI()
+{
+    registerMethod("grant", make_method(this, &ResultStreamAPI::grant));
+    registerMethod("cancel", make_method(this, &ResultStreamAPI::cancel));
+    registerProperty("credits", make_property(this, &ResultStreamAPI::get_credits));
+    registerProperty("buffered", make_property(this, &ResultStreamAPI::get_buffered));
+    registerProperty("dropped", make_property(this, &ResultStreamAPI::get_dropped));
+    registerProperty("finished", make_property(this, &ResultStreamAPI::get_finished));
+}
+
+ResultStreamAPI::~ResultStreamAPI()
+{
+    // The page let go of the stream; tell the producer to stop
+    if (m_stream)
+        m_stream->cancel();
+}
+
+void ResultStreamAPI::dispatch(const BrowserHostWeakPtr& host, const ResultStreamAPIWeakPtr& weak,
+    const boost::function<void ()>& func)
+{
+    BrowserHostPtr browser(host.lock());
+    ResultStreamAPIPtr self(weak.lock());
+    if (!browser || !self)
+        throw FB::script_error("ResultStream is no longer attached to a page");
+    browser->ScheduleOnMainThread(self, func);
+}
+
+void ResultStreamAPI::onBatch(const ResultStreamAPIWeakPtr& weak, const FB::VariantList& items)
+{
+    ResultStreamAPIPtr self(weak.lock());
+    if (self)
+        self->FireEvent("onbatch", FB::variant_list_of(items));
+}
+
+void ResultStreamAPI::onDone(const ResultStreamAPIWeakPtr& weak, bool success, const std::string& error)
+{
+    ResultStreamAPIPtr self(weak.lock());
+    if (!self)
+        return;
+    if (success)
+        self->FireEvent("onend", FB::VariantList());
+    else
+        self->FireEvent("onerror", FB::variant_list_of(error));
+}
+
+void ResultStreamAPI::grant(size_t count)
+{
+    m_stream->grant(count);
+}
+
+void ResultStreamAPI::cancel()
+{
+    m_stream->cancel();
+}
+
+size_t ResultStreamAPI::get_credits() const
+{
+    return m_stream->getCredits();
+}
+
+size_t ResultStreamAPI::get_buffered() const
+{
+    return m_stream->getBuffered();
+}
+
+size_t ResultStreamAPI::get_dropped() const
+{
+    return m_stream->getDropped();
+}
+
+bool ResultStreamAPI::get_finished() const
+{
+    return m_stream->isFinished();
+}
@@ -0,0 +1,84 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_RESULTSTREAMAPI
+#define H_FB_RESULTSTREAMAPI
+
+#include "JSAPIAuto.h"
+#include "BrowserHost.h"
+#include "ResultStream.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(ResultStreamAPI);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  ResultStreamAPI
+    ///
+    /// @brief  Hands the page a ResultStream, to return from a method that produces results over time
+    ///         instead of all at once.
+    ///
+    /// The plugin keeps getStream() and writes results into it from whatever thread produces them:
+    /// @code
+    ///      FB::JSAPIPtr MyPluginAPI::search(const std::string& query) {
+    ///          FB::ResultStreamAPIPtr api(FB::ResultStreamAPI::create(m_host, 256));
+    ///          boost::thread(boost::bind(&MyPluginAPI::runSearch, query, api->getStream()));
+    ///          return api;
+    ///      }
+    ///
+    ///      // in the page
+    ///      var hits = plugin.search("foo");
+    ///      hits.addEventListener("batch", function(items) { ...; hits.grant(items.length); });
+    ///      hits.addEventListener("end", function() { ... });
+    ///      hits.grant(100);
+    /// @endcode
+    ///
+    /// Fires "batch" (an array of items) on the main thread as credits allow, then "end" or "error"
+    /// (message). However fast the producer is, there is at most one delivery waiting on the main
+    /// thread per stream. The stream is canceled when the page lets go of this object or the plugin
+    /// shuts down.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ResultStreamAPI : public FB::JSAPIAuto
+    {
+    public:
+        static ResultStreamAPIPtr create(const BrowserHostPtr& host, size_t capacity = 64,
+            ResultStream::OverflowPolicy policy = ResultStream::OVERFLOW_BLOCK);
+        virtual ~ResultStreamAPI();
+
+        // The end the plugin writes into
+        ResultStreamPtr getStream() const { return m_stream; }
+
+        void grant(size_t count);
+        void cancel();
+
+        size_t get_credits() const;
+        size_t get_buffered() const;
+        size_t get_dropped() const;
+        bool get_finished() const;
+
+    protected:
+        ResultStreamAPI();
+        static void dispatch(const BrowserHostWeakPtr& host, const ResultStreamAPIWeakPtr& weak,
+            const boost::function<void ()>& func);
+        static void onBatch(const ResultStreamAPIWeakPtr& weak, const FB::VariantList& items);
+        static void onDone(const ResultStreamAPIWeakPtr& weak, bool success, const std::string& error);
+
+        ResultStreamPtr m_stream;
+    };
+};
+
+#endif // H_FB_RESULTSTREAMAPI
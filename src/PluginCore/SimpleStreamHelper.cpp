@@ -87,10 +87,18 @@ public:
         const boost::shared_array<uint8_t>& data, const size_t size)
     {
         boost::lock_guard<boost::mutex> lock(m_mutex);
+        if (done)
+            return; // canceled
         m_response = boost::make_shared<FB::HttpStreamResponse>(success, headers, data, size);
         done = true;
         m_cond.notify_all();
     }
+    // The plugin is shutting down; give up waiting with no response
+    void cancel() {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        done = true;
+        m_cond.notify_all();
+    }
     void waitForDone() {
         boost::unique_lock<boost::mutex> lock(m_mutex);
         while (!done) {
@@ -112,19 +120,25 @@ FB::HttpStreamResponsePtr FB::SimpleStreamHelper::SynchronousRequest( const FB::
     // Also, if you could block the main thread, that still wouldn't work because the request
     // is processed on the main thread!
     assert(!host->isMainThread());
-    SyncHTTPHelper helper;
+    // Shared with the callback, which may still come after this gives up on shutdown
+    boost::shared_ptr<SyncHTTPHelper> helper(boost::make_shared<SyncHTTPHelper>());
+    FB::CancellationTokenPtr token(host->getCancellationToken());
+    int cancelId = token->onCancel(boost::bind(&SyncHTTPHelper::cancel, helper));
     try {
-        FB::HttpCallback cb(boost::bind(&SyncHTTPHelper::getURLCallback, &helper, _1, _2, _3, _4));
+        FB::HttpCallback cb(boost::bind(&SyncHTTPHelper::getURLCallback, helper, _1, _2, _3, _4));
 	FB::BrowserStreamRequest req2(req);
 	req2.setCallback(cb);
         FB::SimpleStreamHelperPtr ptr = AsyncRequest(host, req2);
-        helper.setPtr(ptr);
-        helper.waitForDone();
+        helper->setPtr(ptr);
+        helper->waitForDone();
     } catch (const std::exception&) {
         // If anything weird happens, just return NULL (to indicate failure)
+        token->unregister(cancelId);
         return FB::HttpStreamResponsePtr();
     }
-    return helper.m_response;
+    token->unregister(cancelId);
+    boost::lock_guard<boost::mutex> lock(helper->m_mutex);
+    return helper->m_response;
 }
 
 FB::HttpStreamResponsePtr FB::SimpleStreamHelper::SynchronousGet( const FB::BrowserHostPtr& host,
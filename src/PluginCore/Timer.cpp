@@ -15,16 +15,22 @@ License:    Dual license model; choose one of two:
 #include <boost/asio.hpp>
 #include "Timer.h"
 #include "TimerService.h"
+#include "RacePoint.h"
+#include "BrowserHost.h"
+#include "ResourceQuota.h"
 
 using namespace FB;
 
 namespace FB {
     class TimerPimpl {
     public:
-        TimerPimpl() : timerService(TimerService::instance()), timer(*timerService->getIOService()) {
+        TimerPimpl() : timerService(TimerService::instance()), strand(timerService->getStrand()),
+            timer(*timerService->getIOService()) {
         }
 
         TimerServicePtr timerService;
+		// Callbacks are run one at a time, as they were when timers had a thread of their own
+		Reactor::StrandPtr strand;
 		boost::asio::deadline_timer timer;
     };
 };
@@ -34,18 +40,64 @@ TimerPtr Timer::getTimer(long _duration, bool _recursive, TimerCallbackFunc _cal
 	return boost::shared_ptr<FB::Timer>(new Timer(_duration, _recursive, _callback));
 }
 
+TimerPtr Timer::getTimer(const BrowserHostPtr& host, long _duration, bool _recursive, TimerCallbackFunc _callback)
+{
+	ResourceLeasePtr lease(ResourceQuota::instance()->acquire(host->getPageOrigin(), ResourceQuota::Timers));
+	TimerPtr timer(getTimer(_duration, _recursive, _callback));
+	timer->lease = lease;
+	timer->setCancellationToken(host->getCancellationToken());
+	return timer;
+}
+
 Timer::Timer(long _duration, bool _recursive, TimerCallbackFunc _callback)
 	: duration(_duration),
 	recursive(_recursive),
-	cb(_callback), pimpl(new TimerPimpl)
+	cb(_callback), pimpl(new TimerPimpl), tokenId(0)
 {
 }
 
 Timer::~Timer()
 {
+	if (token)
+	{
+		token->unregister(tokenId);
+	}
 	this->stop();
 }
 
+void Timer::setCancellationToken(const CancellationTokenPtr& _token)
+{
+	if (token)
+	{
+		token->unregister(tokenId);
+	}
+	token = _token;
+	tokenId = 0;
+	if (token)
+	{
+		tokenId = token->onCancel(boost::bind(&Timer::onCancel, TimerWeakPtr(shared_from_this())));
+	}
+}
+
+void Timer::onCancel(const TimerWeakPtr& weak)
+{
+	TimerPtr timer(weak.lock());
+	if (timer)
+	{
+		timer->stop();
+	}
+}
+
+void Timer::onTimeout(const TimerWeakPtr& weak, const boost::system::error_code& error)
+{
+	// The timer may have been released while this was queued, or be released while it runs
+	TimerPtr timer(weak.lock());
+	FB_RACE_POINT("Timer::onTimeout");
+	if (timer)
+	{
+		timer->callback(error);
+	}
+}
 
 void Timer::callback(const boost::system::error_code& error)
 {
@@ -59,6 +111,10 @@ void Timer::callback(const boost::system::error_code& error)
 		return;
 	}
 
+	if (token && token->isCanceled())
+	{
+		return;
+	}
 	if (this->recursive)
 	{
 		this->start();
@@ -68,8 +124,13 @@ void Timer::callback(const boost::system::error_code& error)
 
 void Timer::start()
 {
+	if (token && token->isCanceled())
+	{
+		return;
+	}
 	pimpl->timer.expires_from_now(boost::posix_time::milliseconds(duration));
-	pimpl->timer.async_wait(boost::bind(&Timer::callback, this, boost::asio::placeholders::error));
+	pimpl->timer.async_wait(pimpl->strand->wrap(boost::bind(&Timer::onTimeout, TimerWeakPtr(shared_from_this()),
+		boost::asio::placeholders::error)));
 }
 bool Timer::stop()
 {
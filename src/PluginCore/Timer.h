@@ -21,10 +21,13 @@ License:    Dual license model; choose one of two:
 #include <boost/system/error_code.hpp>
 
 #include "FBPointers.h"
+#include "CancellationToken.h"
 
 namespace FB {
 
 	FB_FORWARD_PTR(Timer);
+    FB_FORWARD_PTR(BrowserHost);
+    FB_FORWARD_PTR(ResourceLease);
     class TimerPimpl;
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -45,9 +48,15 @@ namespace FB {
 		const bool recursive;
 		TimerCallbackFunc cb;
         boost::scoped_ptr<TimerPimpl> pimpl;
+        CancellationTokenPtr token;
+        int tokenId;
+        // Held for as long as the timer exists when it was made for a host
+        ResourceLeasePtr lease;
 
 		Timer(long _duration, bool _recursive, TimerCallbackFunc _callback);
 		void callback(const boost::system::error_code& error);
+        static void onTimeout(const TimerWeakPtr& weak, const boost::system::error_code& error);
+        static void onCancel(const TimerWeakPtr& weak);
 
 	public:
         ~Timer();
@@ -55,7 +64,26 @@ namespace FB {
 		void start();
 		bool stop();
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void Timer::setCancellationToken(const CancellationTokenPtr& token)
+        ///
+        /// @brief  Stops the timer for good when token is canceled, e.g. with
+        ///         BrowserHost::getCancellationToken() so that it doesn't fire during or after teardown.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setCancellationToken(const CancellationTokenPtr& token);
+
 		static TimerPtr getTimer(long _duration, bool _recursive, TimerCallbackFunc _callback);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static TimerPtr Timer::getTimer(const BrowserHostPtr& host, long _duration, bool _recursive, TimerCallbackFunc _callback)
+        ///
+        /// @brief  Makes a timer on behalf of host's page: it counts against the page's
+        ///         ResourceQuota::Timers for as long as it exists, and stops for good when host shuts
+        ///         down.
+        ///
+        /// @exception FB::quota_exceeded if the page already has as many timers as it may
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static TimerPtr getTimer(const BrowserHostPtr& host, long _duration, bool _recursive, TimerCallbackFunc _callback);
     };
 };
 
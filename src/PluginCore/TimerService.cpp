@@ -21,22 +21,13 @@ using namespace FB;
 namespace FB {
     class TimerServicePimpl {
     public:
+        // Timers run on the shared Reactor rather than on a thread of their own
         TimerServicePimpl() :
-            io_service(new boost::asio::io_service()),
-            io_idlework(new boost::asio::io_service::work(*io_service)),
-            io_thread(NULL) {}
+            reactor(Reactor::instance()),
+            strand(reactor->getStrand("timers")) {}
 
-        ~TimerServicePimpl() {
-            io_service->stop();
-            io_thread->join();
-            io_idlework.reset();
-            io_thread.reset();
-            io_service.reset();
-        }
-
-        boost::scoped_ptr<boost::asio::io_service> io_service;
-        boost::scoped_ptr<boost::asio::io_service::work> io_idlework;
-        boost::scoped_ptr<boost::thread> io_thread;
+        ReactorPtr reactor;
+        Reactor::StrandPtr strand;
     };
 };
 
@@ -57,8 +48,6 @@ TimerServicePtr TimerService::instance()
 
 TimerService::TimerService() : pimpl(new TimerServicePimpl)
 {
-	pimpl->io_thread.reset(new boost::thread(
-		boost::bind(&boost::asio::io_service::run, pimpl->io_service.get())));
 }
 
 TimerService::~TimerService()
@@ -67,5 +56,10 @@ TimerService::~TimerService()
 
 boost::asio::io_service* TimerService::getIOService()
 {
-	return pimpl->io_service.get();
+	return &pimpl->reactor->getIOService();
+}
+
+Reactor::StrandPtr TimerService::getStrand()
+{
+	return pimpl->strand;
 }
@@ -19,8 +19,7 @@ License:    Dual license model; choose one of two:
 #include <boost/scoped_ptr.hpp>
 
 #include "FBPointers.h"
-
-namespace boost { namespace asio { class io_service; } }
+#include "Reactor.h"
 
 namespace FB {
 
@@ -31,8 +30,8 @@ namespace FB {
     ///
     /// @brief  TimerService Utility.
     ///
-    /// Timer Utility handles io_service and separate thread for Timer.
-    ///
+    /// Timer Utility gives Timer the shared Reactor's io_service, and the "timers" strand that
+    /// serializes timer callbacks.
     ///
     ////////////////////////////////////////////////////////////////////////////////////////////////////
 	class TimerService
@@ -42,6 +41,7 @@ namespace FB {
 		~TimerService();
 
 		boost::asio::io_service* getIOService();
+		Reactor::StrandPtr getStrand();
 	protected:
 		static TimerServiceWeakPtr inst;
 		static boost::mutex instance_mutex;
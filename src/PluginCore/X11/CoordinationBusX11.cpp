@@ -0,0 +1,1031 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/crc.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "logging.h"
+#include "../CoordinationBus.h"
+
+using namespace FB;
+
+// The bus for a plugin id is the POSIX shared memory object /fb-<id>: a BusHeader, then the ring,
+// ringSlots slots each holding a RingSlot followed by up to maxMessageSize bytes of topic and data.
+// Each shared segment is an object of its own, /fb-<id>.<serial>, written in full before it is
+// entered in the header's segment table.
+//
+// What each process holds is kept as open file description locks (F_OFD_SETLK) on single bytes
+// of the bus object, which the system drops when the bus's descriptor is closed, as it is when the
+// process exits, however it exits:
+//   lock_join           exclusive while a process joins or leaves
+//   lock_publish        exclusive while a message is written to the ring
+//   lock_tables         exclusive while the role or segment table is read or changed
+//   lock_peers + n      held by the process in peer slot n for as long as it has the bus open
+//   lock_roles + n      held by the leader of the role in entry n
+//   lock_builds + hash  held while the segment with that name hash is being built
+// The locks belong to the descriptor, which all of a process's threads share, so each of them is
+// paired with a mutex for its threads. They don't say who holds them either, so the header keeps the
+// pid of each peer and leader, written once the lock is taken.
+//
+// A ring slot holds message n once its seq is 2n + 2; it is odd while a message is being
+// written, so a reader that sees a different seq afterwards knows it read a torn copy.
+
+namespace {
+    const char bus_magic[] = "FBBUS002";
+    const size_t max_peers = 256;
+    const size_t max_roles = 64;
+    const size_t max_segments = 64;
+    const size_t max_name = 63;
+    const size_t build_locks = 1024;
+
+    const off_t lock_join = 0;
+    const off_t lock_publish = 1;
+    const off_t lock_tables = 2;
+    const off_t lock_peers = 1024;
+    const off_t lock_roles = lock_peers + max_peers;
+    const off_t lock_builds = lock_roles + max_roles;
+
+    struct RoleEntry {
+        boost::uint32_t used;
+        // The pid of the process leading it, if anyone holds its lock
+        boost::uint32_t leader;
+        char name[max_name + 1];
+    };
+
+    struct SegmentEntry {
+        // 0 while the entry is free
+        boost::uint64_t serial;
+        boost::uint64_t size;
+        char name[max_name + 1];
+    };
+
+    struct BusHeader {
+        char magic[8];
+        // Set by the last process out, just before it removes the object
+        boost::uint32_t retired;
+        boost::uint32_t ringSlots;
+        boost::uint32_t slotSize;
+        boost::uint32_t pollInterval;
+        // Futex word, bumped after each publish and each resignation
+        boost::uint32_t events;
+        boost::uint32_t reserved;
+        // The sequence number the next message gets
+        boost::uint64_t head;
+        boost::uint64_t segmentSerial;
+        // The pid of the process in each peer slot, if anyone holds its lock
+        boost::uint32_t peers[max_peers];
+        RoleEntry roles[max_roles];
+        SegmentEntry segments[max_segments];
+    };
+
+    struct RingSlot {
+        boost::uint64_t seq;
+        boost::uint32_t sender;
+        boost::uint32_t topicLength;
+        boost::uint32_t dataLength;
+        boost::uint32_t reserved;
+    };
+
+    template <typename T>
+    T load_acquire(const T& value)
+    {
+        return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+    }
+
+    template <typename T>
+    void store_release(T& value, T newValue)
+    {
+        __atomic_store_n(&value, newValue, __ATOMIC_RELEASE);
+    }
+
+    void futex_wait(boost::uint32_t* word, boost::uint32_t expected, long ms)
+    {
+        struct timespec ts;
+        ts.tv_sec = ms / 1000;
+        ts.tv_nsec = (ms % 1000) * 1000000;
+        // Not FUTEX_PRIVATE_FLAG: the word is shared with other processes
+        syscall(SYS_futex, word, FUTEX_WAIT, expected, &ts, NULL, 0);
+    }
+
+    void futex_wake(boost::uint32_t* word)
+    {
+        syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+
+    bool lock_byte(int fd, off_t byte, bool wait)
+    {
+        struct flock fl;
+        memset(&fl, 0, sizeof(fl));
+        fl.l_type = F_WRLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = byte;
+        fl.l_len = 1;
+        while (::fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl) != 0) {
+            if (errno == EINTR)
+                continue;
+            if (!wait && (errno == EACCES || errno == EAGAIN))
+                return false;
+            throw std::runtime_error(std::string("Could not lock the coordination bus: ") + strerror(errno));
+        }
+        return true;
+    }
+
+    void unlock_byte(int fd, off_t byte)
+    {
+        struct flock fl;
+        memset(&fl, 0, sizeof(fl));
+        fl.l_type = F_UNLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = byte;
+        fl.l_len = 1;
+        ::fcntl(fd, F_OFD_SETLK, &fl);
+    }
+
+    // Whether byte is held through a descriptor other than fd
+    bool locked_elsewhere(int fd, off_t byte)
+    {
+        struct flock fl;
+        memset(&fl, 0, sizeof(fl));
+        fl.l_type = F_WRLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = byte;
+        fl.l_len = 1;
+        return ::fcntl(fd, F_OFD_GETLK, &fl) == 0 && fl.l_type != F_UNLCK;
+    }
+
+    // Holds a lock byte, and the mutex that keeps this process's other threads out of it
+    class ByteLock : boost::noncopyable
+    {
+    public:
+        ByteLock(int fd, off_t byte, boost::mutex& mutex) : m_lock(mutex), m_fd(fd), m_byte(byte)
+        {
+            lock_byte(fd, byte, true);
+        }
+        ~ByteLock()
+        {
+            unlock_byte(m_fd, m_byte);
+        }
+
+    private:
+        boost::mutex::scoped_lock m_lock;
+        int m_fd;
+        off_t m_byte;
+    };
+
+    boost::uint32_t name_hash(const std::string& str)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(str.data(), str.size());
+        return crc.checksum();
+    }
+
+    // Readable where it can be, and short enough for any system's limit on shm names
+    std::string object_name(const std::string& pluginId)
+    {
+        std::string name("/fb-");
+        for (size_t i = 0; i < pluginId.size() && i < 32; ++i) {
+            char c = pluginId[i];
+            bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+            name += plain ? c : '_';
+        }
+        char hash[16];
+        snprintf(hash, sizeof(hash), "-%08x", name_hash(pluginId));
+        return name + hash;
+    }
+
+    std::string segment_name(const std::string& base, boost::uint64_t serial)
+    {
+        return base + "." + boost::lexical_cast<std::string>(serial);
+    }
+
+    void check_name(const std::string& name)
+    {
+        if (name.empty() || name.size() > max_name || name.find('\0') != std::string::npos)
+            throw std::invalid_argument("Coordination bus names must be 1 to 63 characters: " + name);
+    }
+
+    bool name_is(const char* entry, const std::string& name)
+    {
+        return strncmp(entry, name.c_str(), max_name + 1) == 0;
+    }
+
+    void release_bus(CoordinationBusPtr) { }
+}
+
+namespace FB {
+    class CoordinationBusPimpl : boost::noncopyable {
+    public:
+        CoordinationBusPimpl(const std::string& pluginId, const CoordinationBus::Options& options)
+            : name(object_name(pluginId)), pid(::getpid()), fd(-1), header(NULL), mapSize(0), peerSlot(0),
+              cursor(0), dropped(0), nextSubscription(0), stopping(false), closed(false)
+        {
+            if (options.ringSlots == 0 || options.maxMessageSize == 0 || options.pollInterval <= 0)
+                throw std::invalid_argument("The coordination bus needs a ring, room for messages and a poll interval");
+            join(options);
+            static boost::once_flag forkHandlers = BOOST_ONCE_INIT;
+            boost::call_once(forkHandlers, &register_fork_handlers);
+            boost::mutex::scoped_lock _l(s_openMutex);
+            s_open.insert(this);
+        }
+
+        ~CoordinationBusPimpl()
+        {
+            close();
+        }
+
+        void setOwner(const CoordinationBusPtr& bus)
+        {
+            owner = bus;
+        }
+
+        int getProcessId() const
+        {
+            return pid;
+        }
+
+        std::vector<int> getPeers() const
+        {
+            std::vector<int> peers;
+            boost::mutex::scoped_lock _l(mutex);
+            if (closed)
+                return peers;
+            for (size_t i = 0; i < max_peers; ++i) {
+                if (!locked_elsewhere(fd, lock_peers + i))
+                    continue;
+                // 0 until a process that has just joined writes it
+                const int holder = static_cast<int>(load_acquire(header->peers[i]));
+                if (holder)
+                    peers.push_back(holder);
+            }
+            return peers;
+        }
+
+        bool tryLead(const std::string& role)
+        {
+            if (isClosed())
+                return false;
+            size_t index = role_index(role, true);
+            boost::mutex::scoped_lock _l(mutex);
+            if (leading.count(role))
+                return true;
+            if (!lock_byte(fd, lock_roles + index, false))
+                return false;
+            store_release(header->roles[index].leader, static_cast<boost::uint32_t>(pid));
+            leading.insert(role);
+            return true;
+        }
+
+        void campaign(const std::string& role, const CoordinationBus::LeadershipCallback& onElected)
+        {
+            if (isClosed())
+                return;
+            role_index(role, true);
+            boost::mutex::scoped_lock _l(mutex);
+            candidates[role] = onElected;
+            kick();
+        }
+
+        void resign(const std::string& role)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            candidates.erase(role);
+            if (closed || !leading.erase(role))
+                return;
+            const int index = role_index(role, false);
+            store_release(header->roles[index].leader, boost::uint32_t(0));
+            unlock_byte(fd, lock_roles + index);
+            // Wakes the candidates in the other processes
+            __atomic_add_fetch(&header->events, 1, __ATOMIC_RELEASE);
+            futex_wake(&header->events);
+        }
+
+        bool isLeader(const std::string& role) const
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return leading.count(role) != 0;
+        }
+
+        int getLeader(const std::string& role) const
+        {
+            if (isLeader(role))
+                return pid;
+            boost::mutex::scoped_lock _l(mutex);
+            if (closed)
+                return 0;
+            _l.unlock();
+            int index = role_index(role, false);
+            if (index < 0 || !locked_elsewhere(fd, lock_roles + index))
+                return 0;
+            return static_cast<int>(load_acquire(header->roles[index].leader));
+        }
+
+        void publish(const std::string& topic, const std::string& data)
+        {
+            const size_t capacity = header->slotSize - sizeof(RingSlot);
+            if (topic.size() + data.size() > capacity)
+                throw std::invalid_argument("Message too large for the coordination bus");
+            if (isClosed())
+                throw std::runtime_error("The coordination bus has been closed");
+
+            ByteLock lock(fd, lock_publish, publishMutex);
+            const boost::uint64_t seq = header->head;
+            RingSlot* slot = slot_at(seq);
+            store_release(slot->seq, 2 * seq + 1);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            slot->sender = static_cast<boost::uint32_t>(pid);
+            slot->topicLength = static_cast<boost::uint32_t>(topic.size());
+            slot->dataLength = static_cast<boost::uint32_t>(data.size());
+            char* bytes = reinterpret_cast<char*>(slot + 1);
+            memcpy(bytes, topic.data(), topic.size());
+            memcpy(bytes + topic.size(), data.data(), data.size());
+            store_release(slot->seq, 2 * seq + 2);
+            // A publisher that dies before this leaves the message unsent, and the next one reuses
+            // the slot
+            store_release(header->head, seq + 1);
+            __atomic_add_fetch(&header->events, 1, __ATOMIC_RELEASE);
+            futex_wake(&header->events);
+        }
+
+        int subscribe(const std::string& topic, const CoordinationBus::MessageCallback& callback)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            if (closed)
+                return 0;
+            subscriptions[++nextSubscription] = std::make_pair(topic, callback);
+            if (!thread.joinable())
+                thread = boost::thread(boost::bind(&CoordinationBusPimpl::run, this));
+            return nextSubscription;
+        }
+
+        void unsubscribe(int id)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            subscriptions.erase(id);
+        }
+
+        boost::uint64_t getDroppedCount() const
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return dropped;
+        }
+
+        SharedSegmentConstPtr getSegment(const std::string& name)
+        {
+            check_name(name);
+            if (isClosed())
+                return SharedSegmentConstPtr();
+            ByteLock lock(fd, lock_tables, tableMutex);
+            for (size_t i = 0; i < max_segments; ++i) {
+                SegmentEntry& entry(header->segments[i]);
+                if (load_acquire(entry.serial) && name_is(entry.name, name))
+                    return map_segment(name, entry.serial, entry.size);
+            }
+            return SharedSegmentConstPtr();
+        }
+
+        SharedSegmentConstPtr getOrCreateSegment(const std::string& name, const CoordinationBus::SegmentBuilder& build)
+        {
+            check_name(name);
+            if (isClosed())
+                throw std::runtime_error("The coordination bus has been closed");
+            // Whoever gets here second waits for the first to finish building
+            ByteLock building(fd, lock_builds + name_hash(name) % build_locks, buildMutex);
+            SharedSegmentConstPtr existing(getSegment(name));
+            if (existing)
+                return existing;
+
+            const std::string data(build());
+            boost::uint64_t serial;
+            {
+                ByteLock lock(fd, lock_tables, tableMutex);
+                serial = ++header->segmentSerial;
+            }
+            write_segment(segment_name(this->name, serial), data);
+
+            ByteLock lock(fd, lock_tables, tableMutex);
+            for (size_t i = 0; i < max_segments; ++i) {
+                SegmentEntry& entry(header->segments[i]);
+                if (!entry.serial) {
+                    memset(entry.name, 0, sizeof(entry.name));
+                    memcpy(entry.name, name.data(), name.size());
+                    entry.size = data.size();
+                    store_release(entry.serial, serial);
+                    return map_segment(name, serial, data.size());
+                }
+            }
+            ::shm_unlink(segment_name(this->name, serial).c_str());
+            throw std::runtime_error("The coordination bus has no room for more segments");
+        }
+
+        bool removeSegment(const std::string& name)
+        {
+            check_name(name);
+            if (isClosed())
+                return false;
+            ByteLock lock(fd, lock_tables, tableMutex);
+            for (size_t i = 0; i < max_segments; ++i) {
+                SegmentEntry& entry(header->segments[i]);
+                if (entry.serial && name_is(entry.name, name)) {
+                    ::shm_unlink(segment_name(this->name, entry.serial).c_str());
+                    store_release(entry.serial, boost::uint64_t(0));
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void close()
+        {
+            {
+                boost::mutex::scoped_lock _l(mutex);
+                if (closed)
+                    return;
+                closed = true;
+                stopping = true;
+                candidates.clear();
+                subscriptions.clear();
+                kick();
+            }
+            if (::getpid() != pid) {
+                // A forked child's copy of its parent's bus, which it let go of at the fork
+                thread.detach();
+                return;
+            }
+            if (thread.joinable()) {
+                if (thread.get_id() == boost::this_thread::get_id())
+                    thread.detach(); // it finishes once the callback returns
+                else
+                    thread.join();
+            }
+
+            bool resigned;
+            {
+                boost::mutex::scoped_lock _l(mutex);
+                resigned = !leading.empty();
+                leading.clear();
+            }
+            try {
+                boost::mutex::scoped_lock _l(joinMutex);
+                lock_byte(fd, lock_join, true);
+                store_release(header->peers[peerSlot], boost::uint32_t(0));
+                unlock_byte(fd, lock_peers + peerSlot);
+                if (!other_peers()) {
+                    // Last one out; anyone who opened the object meanwhile sees it's retired and
+                    // makes a new one
+                    remove_segments();
+                    store_release(header->retired, boost::uint32_t(1));
+                    ::shm_unlink(name.c_str());
+                } else if (resigned) {
+                    __atomic_add_fetch(&header->events, 1, __ATOMIC_RELEASE);
+                    futex_wake(&header->events);
+                }
+            } catch (const std::exception& e) {
+                FBLOG_WARN("CoordinationBus", "Could not leave the bus cleanly: " << e.what());
+            }
+            ::munmap(header, mapSize);
+            {
+                boost::mutex::scoped_lock _l(s_openMutex);
+                s_open.erase(this);
+            }
+            // Drops every lock this process held on the bus
+            ::close(fd);
+        }
+
+        // A forked child shares the open file descriptions of its parent's buses, and so their locks,
+        // which would then outlive the parent; the child lets go of its copies straight after the fork
+        static void register_fork_handlers()
+        {
+            ::pthread_atfork(&before_fork, &after_fork_in_parent, &after_fork_in_child);
+        }
+
+        bool isClosed() const
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return closed;
+        }
+
+    protected:
+
+        void join(const CoordinationBus::Options& options)
+        {
+            boost::mutex::scoped_lock _l(joinMutex);
+            while (true) {
+                fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+                if (fd < 0)
+                    throw std::runtime_error("Could not open " + name + ": " + strerror(errno));
+                try {
+                    lock_byte(fd, lock_join, true);
+                    if (attach(options))
+                        break;
+                } catch (...) {
+                    ::close(fd);
+                    throw;
+                }
+                // The last process left and removed it while we were waiting; start over
+                ::close(fd);
+            }
+            unlock_byte(fd, lock_join);
+            cursor = load_acquire(header->head);
+        }
+
+        static void before_fork()
+        {
+            s_openMutex.lock();
+        }
+
+        static void after_fork_in_parent()
+        {
+            s_openMutex.unlock();
+        }
+
+        static void after_fork_in_child()
+        {
+            for (std::set<CoordinationBusPimpl*>::const_iterator it = s_open.begin(); it != s_open.end(); ++it) {
+                // The mapping holds on to the open file description as well; memory of its own
+                // takes its place, so the child's copy of the bus stays harmless to touch
+                ::mmap((*it)->header, (*it)->mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+                ::close((*it)->fd);
+                (*it)->fd = -1;
+            }
+            s_open.clear();
+            s_openMutex.unlock();
+        }
+
+        // With lock_join held: maps the object, setting it up first if no one else is using it, and
+        // takes a peer slot
+        bool attach(const CoordinationBus::Options& options)
+        {
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+                throw std::runtime_error("Could not open " + name + ": " + strerror(errno));
+            const size_t slotSize = (sizeof(RingSlot) + options.maxMessageSize + 7) & ~size_t(7);
+            const size_t wanted = sizeof(BusHeader) + options.ringSlots * slotSize;
+
+            if (static_cast<size_t>(st.st_size) >= sizeof(BusHeader)) {
+                mapSize = sizeof(BusHeader);
+                map(PROT_READ | PROT_WRITE);
+                if (load_acquire(header->retired)) {
+                    ::munmap(header, mapSize);
+                    return false;
+                }
+            }
+            if (!other_peers()) {
+                // Everyone else has gone, perhaps without cleaning up: start afresh
+                if (header) {
+                    if (memcmp(header->magic, bus_magic, sizeof(header->magic)) == 0)
+                        remove_segments();
+                    ::munmap(header, mapSize);
+                    header = NULL;
+                }
+                if (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, wanted) != 0)
+                    throw std::runtime_error("Could not size " + name + ": " + strerror(errno));
+                mapSize = wanted;
+                map(PROT_READ | PROT_WRITE);
+                header->ringSlots = static_cast<boost::uint32_t>(options.ringSlots);
+                header->slotSize = static_cast<boost::uint32_t>(slotSize);
+                header->pollInterval = static_cast<boost::uint32_t>(options.pollInterval);
+                memcpy(header->magic, bus_magic, sizeof(header->magic));
+            } else {
+                if (!header || memcmp(header->magic, bus_magic, sizeof(header->magic)) != 0)
+                    throw std::runtime_error(name + " is in use by an incompatible version of the plugin");
+                const size_t size = sizeof(BusHeader) + size_t(header->ringSlots) * header->slotSize;
+                ::munmap(header, mapSize);
+                header = NULL;
+                mapSize = size;
+                map(PROT_READ | PROT_WRITE);
+            }
+
+            for (peerSlot = 0; peerSlot < max_peers; ++peerSlot) {
+                if (lock_byte(fd, lock_peers + peerSlot, false)) {
+                    store_release(header->peers[peerSlot], static_cast<boost::uint32_t>(pid));
+                    return true;
+                }
+            }
+            ::munmap(header, mapSize);
+            header = NULL;
+            throw std::runtime_error("Too many processes have " + name + " open");
+        }
+
+        void map(int prot)
+        {
+            void* addr = ::mmap(NULL, mapSize, prot, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED)
+                throw std::runtime_error("Could not map " + name + ": " + strerror(errno));
+            header = static_cast<BusHeader*>(addr);
+        }
+
+        bool other_peers() const
+        {
+            for (size_t i = 0; i < max_peers; ++i) {
+                if (locked_elsewhere(fd, lock_peers + i))
+                    return true;
+            }
+            return false;
+        }
+
+        // Only with lock_join held by the last process on the bus; also removes any that a process
+        // died building, which never made it into the table
+        void remove_segments()
+        {
+            for (size_t i = 0; i < max_segments; ++i) {
+                if (header->segments[i].serial)
+                    ::shm_unlink(segment_name(name, header->segments[i].serial).c_str());
+            }
+            const std::string prefix(name.substr(1) + ".");
+            if (DIR* dir = ::opendir("/dev/shm")) {
+                while (struct dirent* ent = ::readdir(dir)) {
+                    if (strncmp(ent->d_name, prefix.c_str(), prefix.size()) == 0)
+                        ::shm_unlink(("/" + std::string(ent->d_name)).c_str());
+                }
+                ::closedir(dir);
+            }
+        }
+
+        // The index of role in the role table, added if create; -1 if it isn't there
+        int role_index(const std::string& role, bool create) const
+        {
+            check_name(role);
+            ByteLock lock(fd, lock_tables, tableMutex);
+            int free = -1;
+            for (size_t i = 0; i < max_roles; ++i) {
+                if (!header->roles[i].used) {
+                    if (free < 0)
+                        free = static_cast<int>(i);
+                } else if (name_is(header->roles[i].name, role)) {
+                    return static_cast<int>(i);
+                }
+            }
+            if (!create)
+                return -1;
+            if (free < 0)
+                throw std::runtime_error("The coordination bus has no room for more roles");
+            RoleEntry& entry(header->roles[free]);
+            memset(entry.name, 0, sizeof(entry.name));
+            memcpy(entry.name, role.data(), role.size());
+            store_release(entry.used, boost::uint32_t(1));
+            return free;
+        }
+
+        RingSlot* slot_at(boost::uint64_t seq) const
+        {
+            char* ring = reinterpret_cast<char*>(header + 1);
+            return reinterpret_cast<RingSlot*>(ring + (seq % header->ringSlots) * header->slotSize);
+        }
+
+        void write_segment(const std::string& object, const std::string& data)
+        {
+            // O_TRUNC: a process that died partway through building may have left one behind
+            int sfd = ::shm_open(object.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+            if (sfd < 0)
+                throw std::runtime_error("Could not create " + object + ": " + strerror(errno));
+            if (!data.empty()) {
+                void* addr = MAP_FAILED;
+                if (::ftruncate(sfd, data.size()) == 0)
+                    addr = ::mmap(NULL, data.size(), PROT_READ | PROT_WRITE, MAP_SHARED, sfd, 0);
+                if (addr == MAP_FAILED) {
+                    std::string error(strerror(errno));
+                    ::close(sfd);
+                    ::shm_unlink(object.c_str());
+                    throw std::runtime_error("Could not write " + object + ": " + error);
+                }
+                memcpy(addr, data.data(), data.size());
+                ::munmap(addr, data.size());
+            }
+            ::close(sfd);
+        }
+
+        // With lock_tables held, so the segment can't be removed meanwhile
+        SharedSegmentConstPtr map_segment(const std::string& segment, boost::uint64_t serial, size_t size)
+        {
+            if (!size)
+                return SharedSegmentConstPtr(new SharedSegment(segment, "", 0));
+            const std::string object(segment_name(name, serial));
+            int sfd = ::shm_open(object.c_str(), O_RDONLY, 0);
+            if (sfd < 0)
+                throw std::runtime_error("Could not open " + object + ": " + strerror(errno));
+            void* addr = ::mmap(NULL, size, PROT_READ, MAP_SHARED, sfd, 0);
+            ::close(sfd);
+            if (addr == MAP_FAILED)
+                throw std::runtime_error("Could not map " + object + ": " + strerror(errno));
+            return SharedSegmentConstPtr(new SharedSegment(segment, static_cast<const char*>(addr), size));
+        }
+
+        // With mutex held: gets the bus thread going, or has it look again
+        void kick()
+        {
+            if (!thread.joinable() && !stopping)
+                thread = boost::thread(boost::bind(&CoordinationBusPimpl::run, this));
+            // Wakes the other processes' threads as well; they find nothing new and wait again
+            __atomic_add_fetch(&header->events, 1, __ATOMIC_RELEASE);
+            futex_wake(&header->events);
+        }
+
+        bool isStopping() const
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return stopping;
+        }
+
+        // A callback that closes the bus leaves it unmapped, so this thread checks isStopping()
+        // after each one before it looks at the bus again
+        void run()
+        {
+            while (true) {
+                const boost::uint32_t seen = load_acquire(header->events);
+                if (isStopping())
+                    return;
+                CoordinationBusPtr self(owner.lock());
+                if (!self)
+                    return; // being destroyed
+                deliver();
+                elect();
+                if (isStopping())
+                    return;
+                if (self.unique()) {
+                    // Everyone else let go meanwhile; the destructor joins this thread, so it can't run
+                    // on it
+                    boost::thread releaser(boost::bind(&release_bus, self));
+                    releaser.detach();
+                }
+                self.reset();
+                futex_wait(&header->events, seen, header->pollInterval);
+            }
+        }
+
+        void deliver()
+        {
+            const boost::uint64_t head = load_acquire(header->head);
+            const size_t capacity = header->slotSize - sizeof(RingSlot);
+            for (; cursor < head; ++cursor) {
+                if (head - cursor > header->ringSlots) {
+                    // Already overwritten
+                    boost::mutex::scoped_lock _l(mutex);
+                    dropped += head - cursor - header->ringSlots;
+                    cursor = head - header->ringSlots;
+                }
+                RingSlot* slot = slot_at(cursor);
+                const boost::uint64_t seq = load_acquire(slot->seq);
+                CoordinationBus::Message msg;
+                bool torn = seq != 2 * cursor + 2;
+                if (!torn) {
+                    const boost::uint32_t topicLength = slot->topicLength, dataLength = slot->dataLength;
+                    if (topicLength + dataLength <= capacity) {
+                        const char* bytes = reinterpret_cast<const char*>(slot + 1);
+                        msg.topic.assign(bytes, topicLength);
+                        msg.data.assign(bytes + topicLength, dataLength);
+                    }
+                    msg.sender = static_cast<int>(slot->sender);
+                    msg.sequence = cursor;
+                    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                    torn = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq || topicLength + dataLength > capacity;
+                }
+                if (torn) {
+                    // Overwritten while we read it
+                    boost::mutex::scoped_lock _l(mutex);
+                    ++dropped;
+                    continue;
+                }
+                if (msg.sender == pid)
+                    continue;
+
+                std::vector<CoordinationBus::MessageCallback> callbacks;
+                {
+                    boost::mutex::scoped_lock _l(mutex);
+                    for (SubscriptionMap::const_iterator it = subscriptions.begin(); it != subscriptions.end(); ++it) {
+                        if (it->second.first.empty() || it->second.first == msg.topic)
+                            callbacks.push_back(it->second.second);
+                    }
+                }
+                for (size_t i = 0; i < callbacks.size(); ++i) {
+                    try {
+                        callbacks[i](msg);
+                    } catch (const std::exception& e) {
+                        FBLOG_ERROR("CoordinationBus", "Subscriber to " << msg.topic << " threw: " << e.what());
+                    } catch (...) {
+                        FBLOG_ERROR("CoordinationBus", "Subscriber to " << msg.topic << " threw");
+                    }
+                }
+                if (!callbacks.empty() && isStopping())
+                    return;
+            }
+        }
+
+        void elect()
+        {
+            std::map<std::string, CoordinationBus::LeadershipCallback> waiting;
+            {
+                boost::mutex::scoped_lock _l(mutex);
+                waiting = candidates;
+            }
+            for (std::map<std::string, CoordinationBus::LeadershipCallback>::iterator it = waiting.begin(); it != waiting.end(); ++it) {
+                {
+                    boost::mutex::scoped_lock _l(mutex);
+                    // Resigned meanwhile
+                    if (!candidates.count(it->first))
+                        continue;
+                }
+                if (!tryLead(it->first))
+                    continue;
+                {
+                    boost::mutex::scoped_lock _l(mutex);
+                    candidates.erase(it->first);
+                }
+                try {
+                    if (it->second)
+                        it->second();
+                } catch (const std::exception& e) {
+                    FBLOG_ERROR("CoordinationBus", "Leadership callback for " << it->first << " threw: " << e.what());
+                } catch (...) {
+                    FBLOG_ERROR("CoordinationBus", "Leadership callback for " << it->first << " threw");
+                }
+                if (isStopping())
+                    return;
+            }
+        }
+
+    private:
+        typedef std::map<int, std::pair<std::string, CoordinationBus::MessageCallback> > SubscriptionMap;
+
+        const std::string name;
+        const int pid;
+        int fd;
+        BusHeader* header;
+        size_t mapSize;
+        size_t peerSlot;
+        CoordinationBusWeakPtr owner;
+
+        mutable boost::mutex mutex;
+        // Paired with lock_join, lock_publish, lock_tables and lock_builds
+        boost::mutex joinMutex;
+        boost::mutex publishMutex;
+        mutable boost::mutex tableMutex;
+        boost::mutex buildMutex;
+
+        boost::uint64_t cursor;
+        boost::uint64_t dropped;
+        std::set<std::string> leading;
+        std::map<std::string, CoordinationBus::LeadershipCallback> candidates;
+        SubscriptionMap subscriptions;
+        int nextSubscription;
+        boost::thread thread;
+        bool stopping;
+        bool closed;
+
+        // The buses this process has open, for after_fork_in_child
+        static boost::mutex s_openMutex;
+        static std::set<CoordinationBusPimpl*> s_open;
+    };
+};
+
+boost::mutex CoordinationBusPimpl::s_openMutex;
+std::set<CoordinationBusPimpl*> CoordinationBusPimpl::s_open;
+
+SharedSegment::SharedSegment(const std::string& name, const char* data, size_t size)
+    : m_name(name), m_data(data), m_size(size)
+{
+}
+
+SharedSegment::~SharedSegment()
+{
+    if (m_size)
+        ::munmap(const_cast<char*>(m_data), m_size);
+}
+
+CoordinationBus::CoordinationBus(const std::string& pluginId, const Options& options)
+    : pimpl(new CoordinationBusPimpl(pluginId, options)), m_pluginId(pluginId)
+{
+}
+
+CoordinationBusPtr CoordinationBus::open(const std::string& pluginId, const Options& options)
+{
+    boost::mutex::scoped_lock _l(s_busesMutex);
+    CoordinationBusPtr bus(s_buses[pluginId].lock());
+    // A forked child inherits its parent's bus but not its place on it, nor a mutex another thread
+    // may have held at the fork, so that is checked first; a bus someone closed is left for whoever
+    // still holds it
+    if (!bus || bus->getProcessId() != ::getpid() || bus->pimpl->isClosed()) {
+        bus = CoordinationBusPtr(new CoordinationBus(pluginId, options));
+        bus->pimpl->setOwner(bus);
+        s_buses[pluginId] = bus;
+    }
+    for (std::map<std::string, CoordinationBusWeakPtr>::iterator it = s_buses.begin(); it != s_buses.end(); ) {
+        if (it->second.expired())
+            s_buses.erase(it++);
+        else
+            ++it;
+    }
+    return bus;
+}
+
+bool CoordinationBus::isSupported()
+{
+    return true;
+}
+
+CoordinationBus::~CoordinationBus()
+{
+    pimpl->close();
+}
+
+int CoordinationBus::getProcessId() const
+{
+    return pimpl->getProcessId();
+}
+
+std::vector<int> CoordinationBus::getPeers() const
+{
+    return pimpl->getPeers();
+}
+
+bool CoordinationBus::tryLead(const std::string& role)
+{
+    return pimpl->tryLead(role);
+}
+
+void CoordinationBus::campaign(const std::string& role, const LeadershipCallback& onElected)
+{
+    pimpl->campaign(role, onElected);
+}
+
+void CoordinationBus::resign(const std::string& role)
+{
+    pimpl->resign(role);
+}
+
+bool CoordinationBus::isLeader(const std::string& role) const
+{
+    return pimpl->isLeader(role);
+}
+
+int CoordinationBus::getLeader(const std::string& role) const
+{
+    return pimpl->getLeader(role);
+}
+
+void CoordinationBus::publish(const std::string& topic, const std::string& data)
+{
+    pimpl->publish(topic, data);
+}
+
+int CoordinationBus::subscribe(const std::string& topic, const MessageCallback& callback)
+{
+    return pimpl->subscribe(topic, callback);
+}
+
+void CoordinationBus::unsubscribe(int id)
+{
+    pimpl->unsubscribe(id);
+}
+
+boost::uint64_t CoordinationBus::getDroppedCount() const
+{
+    return pimpl->getDroppedCount();
+}
+
+SharedSegmentConstPtr CoordinationBus::getOrCreateSegment(const std::string& name, const SegmentBuilder& build)
+{
+    return pimpl->getOrCreateSegment(name, build);
+}
+
+SharedSegmentConstPtr CoordinationBus::getSegment(const std::string& name)
+{
+    return pimpl->getSegment(name);
+}
+
+bool CoordinationBus::removeSegment(const std::string& name)
+{
+    return pimpl->removeSegment(name);
+}
+
+void CoordinationBus::close()
+{
+    pimpl->close();
+}
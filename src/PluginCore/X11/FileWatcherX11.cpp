@@ -0,0 +1,364 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "logging.h"
+#include "../FileWatcher.h"
+
+using namespace FB;
+using boost::posix_time::ptime;
+using boost::posix_time::microsec_clock;
+using boost::posix_time::milliseconds;
+
+namespace {
+    const uint32_t watch_mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB
+        | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_DONT_FOLLOW;
+
+    bool is_under(const std::string& path, const std::string& root)
+    {
+        return path == root || (path.size() > root.size() && path.compare(0, root.size(), root) == 0
+            && path[root.size()] == '/');
+    }
+
+    bool is_directory(const std::string& path)
+    {
+        struct stat st;
+        return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+}
+
+namespace FB {
+    class FileWatcherPimpl {
+    public:
+        FileWatcherPimpl(FileWatcher* owner, long debounceMs)
+            : owner(owner), debounce(debounceMs), max_delay(debounceMs * 10), stopping(false)
+        {
+            fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd < 0)
+                throw std::runtime_error(std::string("inotify_init1 failed: ") + strerror(errno));
+            if (pipe(wake) != 0) {
+                close(fd);
+                throw std::runtime_error(std::string("pipe failed: ") + strerror(errno));
+            }
+            fcntl(wake[0], F_SETFL, O_NONBLOCK);
+            thread = boost::thread(boost::bind(&FileWatcherPimpl::run, this));
+        }
+
+        ~FileWatcherPimpl()
+        {
+            stop();
+            close(fd);
+            close(wake[0]);
+            close(wake[1]);
+        }
+
+        void stop()
+        {
+            {
+                boost::mutex::scoped_lock _l(mutex);
+                if (!stopping) {
+                    stopping = true;
+                    char c = 0;
+                    if (write(wake[1], &c, 1) < 0) { }
+                }
+            }
+            // From the callback the thread just finishes once it returns
+            if (thread.joinable() && boost::this_thread::get_id() != thread.get_id())
+                thread.join();
+        }
+
+        void watch(const std::string& path, bool recursive)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            if (add_watch(path) < 0)
+                throw std::runtime_error("Could not watch " + path + ": " + strerror(errno));
+            roots[path] = recursive;
+            if (recursive && is_directory(path))
+                add_tree(path, false);
+        }
+
+        bool unwatch(const std::string& path)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            if (!roots.erase(path))
+                return false;
+            remove_watches(path);
+            return true;
+        }
+
+        size_t watchCount() const
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return wd_paths.size();
+        }
+
+    protected:
+        int add_watch(const std::string& path)
+        {
+            int wd = inotify_add_watch(fd, path.c_str(), watch_mask);
+            if (wd >= 0) {
+                std::map<int, std::string>::iterator old = wd_paths.find(wd);
+                if (old != wd_paths.end())
+                    path_wds.erase(old->second); // same inode seen under a new path
+                wd_paths[wd] = path;
+                path_wds[path] = wd;
+            }
+            return wd;
+        }
+
+        // Watches every directory below dir; with report, everything found is reported as created,
+        // since it may have appeared before the watch was in place
+        void add_tree(const std::string& dir, bool report)
+        {
+            DIR* d = opendir(dir.c_str());
+            if (!d)
+                return;
+            std::vector<std::string> subdirs;
+            while (struct dirent* ent = readdir(d)) {
+                if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+                    continue;
+                std::string child(dir + "/" + ent->d_name);
+                if (report)
+                    pending[child] |= FileWatcher::CHANGE_CREATED;
+                if (is_directory(child))
+                    subdirs.push_back(child);
+            }
+            closedir(d);
+            for (std::vector<std::string>::const_iterator it = subdirs.begin(); it != subdirs.end(); ++it) {
+                if (add_watch(*it) < 0) {
+                    FBLOG_WARN("FileWatcher", "Could not watch " << *it << ": " << strerror(errno));
+                    continue;
+                }
+                add_tree(*it, report);
+            }
+        }
+
+        void remove_watches(const std::string& path)
+        {
+            for (std::map<std::string, int>::iterator it = path_wds.lower_bound(path); it != path_wds.end() && is_under(it->first, path); ) {
+                bool keep = false;
+                for (std::map<std::string, bool>::const_iterator r = roots.begin(); r != roots.end(); ++r) {
+                    if (is_under(it->first, r->first) && (r->second || it->first == r->first))
+                        keep = true;
+                }
+                if (keep) {
+                    ++it;
+                    continue;
+                }
+                inotify_rm_watch(fd, it->second);
+                wd_paths.erase(it->second);
+                path_wds.erase(it++);
+            }
+        }
+
+        bool in_recursive_root(const std::string& path) const
+        {
+            for (std::map<std::string, bool>::const_iterator r = roots.begin(); r != roots.end(); ++r) {
+                if (r->second && is_under(path, r->first))
+                    return true;
+            }
+            return false;
+        }
+
+        void rescan()
+        {
+            FBLOG_INFO("FileWatcher", "inotify queue overflowed; rebuilding watches");
+            for (std::map<int, std::string>::const_iterator it = wd_paths.begin(); it != wd_paths.end(); ++it)
+                inotify_rm_watch(fd, it->first);
+            wd_paths.clear();
+            path_wds.clear();
+            for (std::map<std::string, bool>::const_iterator r = roots.begin(); r != roots.end(); ++r) {
+                pending[r->first] |= FileWatcher::CHANGE_RESCAN;
+                if (add_watch(r->first) >= 0 && r->second && is_directory(r->first))
+                    add_tree(r->first, false);
+            }
+        }
+
+        void handle_event(const struct inotify_event* ev)
+        {
+            if (ev->mask & IN_Q_OVERFLOW) {
+                rescan();
+                return;
+            }
+            std::map<int, std::string>::iterator it = wd_paths.find(ev->wd);
+            if (it == wd_paths.end())
+                return;
+            if (ev->mask & IN_IGNORED) {
+                path_wds.erase(it->second);
+                wd_paths.erase(it);
+                return;
+            }
+            std::string path(it->second);
+            if (ev->len)
+                path += std::string("/") + ev->name;
+
+            int& kinds = pending[path];
+            if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                kinds |= FileWatcher::CHANGE_CREATED;
+                if ((ev->mask & IN_ISDIR) && in_recursive_root(path) && add_watch(path) >= 0)
+                    add_tree(path, true);
+            }
+            if (ev->mask & (IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                kinds |= FileWatcher::CHANGE_REMOVED;
+                // A directory moved away keeps its watches, now under a path we don't know
+                if ((ev->mask & IN_MOVED_FROM) && (ev->mask & IN_ISDIR))
+                    remove_watches(path);
+            }
+            if (ev->mask & (IN_MODIFY | IN_CLOSE_WRITE))
+                kinds |= FileWatcher::CHANGE_MODIFIED;
+            if (ev->mask & IN_ATTRIB)
+                kinds |= FileWatcher::CHANGE_ATTRIBUTES;
+            if (!kinds)
+                pending.erase(path);
+        }
+
+        void read_events()
+        {
+            // Aligned for struct inotify_event
+            long buf[4096 / sizeof(long)];
+            while (true) {
+                ssize_t len = read(fd, buf, sizeof(buf));
+                if (len <= 0)
+                    return;
+                boost::mutex::scoped_lock _l(mutex);
+                bool had_pending = !pending.empty();
+                const char* p = reinterpret_cast<const char*>(buf);
+                while (p < reinterpret_cast<const char*>(buf) + len) {
+                    const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+                    handle_event(ev);
+                    p += sizeof(struct inotify_event) + ev->len;
+                }
+                ptime now(microsec_clock::universal_time());
+                if (!had_pending)
+                    first_change = now;
+                last_change = now;
+            }
+        }
+
+        void run()
+        {
+            while (true) {
+                int timeout = -1;
+                {
+                    boost::mutex::scoped_lock _l(mutex);
+                    if (stopping)
+                        return;
+                    if (!pending.empty()) {
+                        ptime deadline = std::min(last_change + milliseconds(debounce), first_change + milliseconds(max_delay));
+                        timeout = std::max(0L, static_cast<long>((deadline - microsec_clock::universal_time()).total_milliseconds()));
+                    }
+                }
+
+                struct pollfd fds[2] = { { fd, POLLIN, 0 }, { wake[0], POLLIN, 0 } };
+                if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+                    FBLOG_ERROR("FileWatcher", "poll failed: " << strerror(errno));
+                    return;
+                }
+                if (fds[0].revents & POLLIN)
+                    read_events();
+
+                FileWatcher::ChangeSet batch;
+                {
+                    boost::mutex::scoped_lock _l(mutex);
+                    if (stopping)
+                        return;
+                    ptime now(microsec_clock::universal_time());
+                    if (!pending.empty() && (now - last_change >= milliseconds(debounce)
+                            || now - first_change >= milliseconds(max_delay))) {
+                        batch.swap(pending);
+                    }
+                }
+                if (!batch.empty())
+                    owner->deliver(batch);
+            }
+        }
+
+        FileWatcher* owner;
+        const long debounce;
+        const long max_delay;
+        int fd;
+        int wake[2];
+
+        mutable boost::mutex mutex;
+        bool stopping;
+        std::map<int, std::string> wd_paths;
+        std::map<std::string, int> path_wds;
+        std::map<std::string, bool> roots; // watched path -> recursive
+        FileWatcher::ChangeSet pending;
+        ptime first_change;
+        ptime last_change;
+        boost::thread thread;
+    };
+};
+
+FileWatcher::FileWatcher(const ChangeCallback& callback, const BrowserHostPtr& host)
+    : m_callback(callback), m_host(host)
+{
+}
+
+FileWatcherPtr FileWatcher::create(const ChangeCallback& callback, const BrowserHostPtr& host, long debounceMs)
+{
+    FileWatcherPtr res(new FileWatcher(callback, host));
+    res->m_self = res;
+    res->pimpl.reset(new FileWatcherPimpl(res.get(), debounceMs));
+    return res;
+}
+
+bool FileWatcher::isSupported()
+{
+    return true;
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+void FileWatcher::watch(const std::string& path, bool recursive)
+{
+    std::string clean(path);
+    while (clean.size() > 1 && clean[clean.size() - 1] == '/')
+        clean.resize(clean.size() - 1);
+    pimpl->watch(clean, recursive);
+}
+
+bool FileWatcher::unwatch(const std::string& path)
+{
+    std::string clean(path);
+    while (clean.size() > 1 && clean[clean.size() - 1] == '/')
+        clean.resize(clean.size() - 1);
+    return pimpl->unwatch(clean);
+}
+
+void FileWatcher::stop()
+{
+    pimpl->stop();
+}
+
+size_t FileWatcher::getWatchCount() const
+{
+    return pimpl->watchCount();
+}
+
@@ -325,6 +325,9 @@ namespace FB
     };
     /// @brief  Defines an alias representing a map of property functors used by FB::JSAPIAuto
     typedef std::map<std::string, PropertyFunctors> PropertyFunctorsMap;
+    /// @brief  Converts a property value to a form of it the page can't change, used by
+    ///         FB::JSAPI::GetPropertyForHost
+    typedef boost::function<FB::variant (const FB::variant&)> HostValueConverter;
 
     // JSAPI event handlers
 
@@ -0,0 +1,61 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstring>
+#include <algorithm>
+#include <boost/make_shared.hpp>
+#include "Blob.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+
+FB::Blob::Blob()
+    : m_data(""), m_size(0), m_borrowed(false)
+{
+}
+
+FB::Blob::Blob(const void* data, size_t size)
+    : m_data(""), m_size(0), m_borrowed(false)
+{
+    if (!data || !size)
+        return;
+    boost::shared_ptr<std::string> bytes(boost::make_shared<std::string>(static_cast<const char*>(data), size));
+    m_data = bytes->data();
+    m_size = size;
+    m_owner = bytes;
+}
+
+FB::Blob::Blob(const std::string& bytes)
+    : m_data(""), m_size(0), m_borrowed(false)
+{
+    if (bytes.empty())
+        return;
+    boost::shared_ptr<std::string> copy(boost::make_shared<std::string>(bytes));
+    m_data = copy->data();
+    m_size = copy->size();
+    m_owner = copy;
+}
+
+FB::Blob::Blob(const char* data, size_t size, const boost::shared_ptr<const void>& owner)
+    : m_owner(owner), m_data(data ? data : ""), m_size(data ? size : 0), m_borrowed(true)
+{
+}
+
+int FB::Blob::compare(const Blob& rh) const
+{
+    if (m_data == rh.m_data && m_size == rh.m_size)
+        return 0;
+    int res = std::memcmp(m_data, rh.m_data, std::min(m_size, rh.m_size));
+    if (res)
+        return res;
+    return m_size < rh.m_size ? -1 : (m_size > rh.m_size ? 1 : 0);
+}
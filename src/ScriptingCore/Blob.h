@@ -0,0 +1,75 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_BLOB
+#define H_FB_BLOB
+
+#include <cstddef>
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+namespace FB {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  Blob
+    ///
+    /// @brief  An immutable block of binary data that is cheap to copy; copies share the bytes.
+    ///
+    /// FB::variant stores Blobs as they are, which keeps binary data apart from strings when a
+    /// variant is encoded (see variant_encoding.h).  A Blob can either own a copy of its bytes or
+    /// point into storage that something else owns -- a decoded buffer or a SharedSegment, say --
+    /// and keep that alive:
+    /// @code
+    ///      FB::SharedSegmentConstPtr seg(bus->getSegment("thumbnails"));
+    ///      FB::Blob thumb(seg->data() + offset, length, seg);
+    /// @endcode
+    ///
+    /// Blobs have no script form; the browser converters skip them as they do any unknown type.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class Blob
+    {
+    public:
+        Blob();
+        // Copies the bytes
+        Blob(const void* data, size_t size);
+        explicit Blob(const std::string& bytes);
+        // Points at bytes that owner keeps alive, without copying them
+        Blob(const char* data, size_t size, const boost::shared_ptr<const void>& owner);
+
+        const char* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        std::string str() const { return std::string(m_data, m_size); }
+
+        // Whether the bytes belong to something other than Blob; mostly for tests
+        bool isBorrowed() const { return m_borrowed; }
+
+        int compare(const Blob& rh) const;
+
+    private:
+        boost::shared_ptr<const void> m_owner;
+        const char* m_data;
+        size_t m_size;
+        bool m_borrowed;
+    };
+
+    inline bool operator==(const Blob& lh, const Blob& rh) { return lh.compare(rh) == 0; }
+    inline bool operator!=(const Blob& lh, const Blob& rh) { return lh.compare(rh) != 0; }
+    inline bool operator<(const Blob& lh, const Blob& rh) { return lh.compare(rh) < 0; }
+};
+
+#endif // H_FB_BLOB
@@ -16,17 +16,24 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include <cstdio>
 #include <cassert>
 #include <algorithm>
+#include <typeinfo>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/construct.hpp>
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 #include <boost/smart_ptr/enable_shared_from_this.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include "JSObject.h"
 #include "DOM/Window.h"
 #include "variant_list.h"
 #include "logging.h"
+#include "RacePoint.h"
+#include "ResourceQuota.h"
+#include "URI.h"
 #include "../PluginCore/BrowserStreamManager.h"
+#include "../PluginCore/BrowserStreamScheduler.h"
+#include "../PluginCore/BrowserSession.h"
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
 #include "BrowserHost.h"
@@ -41,40 +48,67 @@ Copyright 2009 Richard Bateman, Firebreath development team
 
 namespace FB {
     struct _asyncCallData : boost::noncopyable {
-        _asyncCallData(void (*func)(void*), void* userData, int id, AsyncCallManagerPtr mgr)
-            : func(func), userData(userData), uniqId(id), called(false), mgr(mgr)
+        _asyncCallData(void (*func)(void*), void* userData, void (*discard)(void*), size_t id,
+            const ResourceLeasePtr& lease)
+            : func(func), userData(userData), discard(discard), uniqId(id), called(false), lease(lease)
         {}
         void call();
+        void cancel();
         void (*func)(void *);
         void *userData;
-        int uniqId;
+        void (*discard)(void *);
+        size_t uniqId;
         bool called;
-        AsyncCallManagerWeakPtr mgr;
+        // Held until the call is made or discarded
+        ResourceLeasePtr lease;
     };
 
     class AsyncCallManager : public boost::enable_shared_from_this<AsyncCallManager>, boost::noncopyable {
     public:
-        int lastId;
-        AsyncCallManager() : lastId(1) {}
+        AsyncCallManager() : isShutDown(false) {}
         ~AsyncCallManager();
 
         boost::recursive_mutex m_mutex;
-        void shutdown();
-
-        _asyncCallData* makeCallback(void (*func)(void *), void * userData );
-        void call( _asyncCallData* data );
-        void remove( _asyncCallData* data );
-
-        std::set<_asyncCallData*> DataList;
+        // Discards the pending calls that can be discarded and makes the rest; returns how many of
+        // each there were
+        std::pair<size_t, size_t> shutdown();
+
+        _asyncCallData* makeCallback(void (*func)(void *), void * userData, void (*discard)(void *),
+            const ResourceLeasePtr& lease);
+        void call( size_t id );
+        // Takes back a call the browser couldn't be given; false if shutdown() already dealt with it
+        bool remove( _asyncCallData* data );
+
+        // Keyed by uniqId, so in the order they were scheduled
+        std::map<size_t, _asyncCallData*> DataList;
         std::set<_asyncCallData*> canceledDataList;
+        // Set by shutdown(); no more calls can be made after that
+        bool isShutDown;
     };
 }
 
+namespace {
+    // The browser is handed a call's id rather than the call itself, so that a call it makes after
+    // the host (and the call's data) are gone finds nothing here instead of freed memory
+    boost::mutex asyncCallsMutex;
+    std::map<size_t, FB::AsyncCallManagerWeakPtr> asyncCalls;
+    size_t lastAsyncCallId(0);
+
+    long elapsed_ms(const boost::posix_time::ptime& since)
+    {
+        return static_cast<long>((boost::posix_time::microsec_clock::universal_time() - since).total_milliseconds());
+    }
+}
+
 volatile int FB::BrowserHost::InstanceCount(0);
+long FB::BrowserHost::s_teardownBudget(500);
+FB::TeardownObserver FB::BrowserHost::s_teardownObserver;
+boost::mutex FB::BrowserHost::s_teardownMutex;
 
 FB::BrowserHost::BrowserHost()
     : _asyncManager(boost::make_shared<AsyncCallManager>()), m_threadId(boost::this_thread::get_id()),
-      m_isShutDown(false), m_streamMgr(boost::make_shared<FB::BrowserStreamManager>()), m_htmlLogEnabled(true)
+      m_isShutDown(false), m_streamMgr(boost::make_shared<FB::BrowserStreamManager>()), m_htmlLogEnabled(true),
+      m_cancelToken(boost::make_shared<FB::CancellationToken>()), m_originKnown(false)
 {
     ++InstanceCount;
 }
@@ -86,26 +120,126 @@ FB::BrowserHost::~BrowserHost()
 
 void FB::BrowserHost::shutdown()
 {
+    using boost::posix_time::ptime;
+    using boost::posix_time::microsec_clock;
+
+    TeardownReport report;
+    report.budgetMs = getTeardownBudget();
+    const ptime start(microsec_clock::universal_time());
+    const ptime deadline(start + boost::posix_time::milliseconds(report.budgetMs));
+    ptime stepStart(start);
+
+    // Tell workers, timers and requests to stop first so that they wind down while the rest of
+    // this runs
+    m_cancelToken->cancel();
+    FB_RACE_POINT("BrowserHost::shutdown");
+    finishTeardownStep(report, "cancellation token", stepStart, deadline);
+
     BOOST_FOREACH(FB::JSAPIPtr ptr, m_retainedObjects) {
         // Notify each JSAPI object that we're shutting down
         ptr->shutdown();
+        finishTeardownStep(report, typeid(*ptr).name(), stepStart, deadline);
     }
     freeRetainedObjects();
+
+    std::vector<std::pair<std::string, TeardownTask> > tasks;
+    {
+        boost::recursive_mutex::scoped_lock _sl(m_jsapimutex);
+        tasks.swap(m_teardownTasks);
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        try {
+            tasks[i].second(deadline);
+        } catch (const std::exception& e) {
+            FBLOG_WARN("BrowserHost", "Teardown task " << tasks[i].first << " threw: " << e.what());
+        }
+        finishTeardownStep(report, tasks[i].first, stepStart, deadline);
+    }
+
     boost::upgrade_lock<boost::shared_mutex> _l(m_xtmutex);
     m_isShutDown = true;
-    _asyncManager->shutdown();
+    {
+        boost::recursive_mutex::scoped_lock _sl(m_jsapimutex);
+        if (m_streamScheduler) {
+            m_streamScheduler->shutdown();
+            m_streamScheduler.reset();
+        }
+        if (m_browserSession) {
+            m_browserSession->shutdown();
+            m_browserSession.reset();
+        }
+    }
+    finishTeardownStep(report, "stream scheduler", stepStart, deadline);
+    std::pair<size_t, size_t> calls(_asyncManager->shutdown());
+    report.discardedCalls = calls.first;
+    report.mustRunCalls = calls.second;
+    finishTeardownStep(report, "async calls", stepStart, deadline);
     m_streamMgr.reset();
+
+    report.elapsedMs = elapsed_ms(start);
+    if (!report.overruns.empty()) {
+        FBLOG_WARN("BrowserHost", "Teardown took " << report.elapsedMs << "ms, over the budget of "
+            << report.budgetMs << "ms");
+    }
+    m_teardownReport = report;
+    TeardownObserver observer;
+    {
+        boost::mutex::scoped_lock _tl(s_teardownMutex);
+        observer = s_teardownObserver;
+    }
+    if (observer)
+        observer(report);
+}
+
+void FB::BrowserHost::finishTeardownStep(TeardownReport& report, const std::string& name,
+    boost::posix_time::ptime& stepStart, const boost::posix_time::ptime& deadline)
+{
+    boost::posix_time::ptime now(boost::posix_time::microsec_clock::universal_time());
+    report.components.push_back(std::make_pair(name, static_cast<long>((now - stepStart).total_milliseconds())));
+    if (now > deadline) {
+        report.overruns.push_back(name);
+        FBLOG_WARN("BrowserHost", "Teardown step " << name << " took " << report.components.back().second
+            << "ms and ran past the teardown budget");
+    }
+    stepStart = now;
+}
+
+void FB::BrowserHost::addTeardownTask(const std::string& name, const TeardownTask& task) const
+{
+    boost::recursive_mutex::scoped_lock _l(m_jsapimutex);
+    m_teardownTasks.push_back(std::make_pair(name, task));
+}
+
+void FB::BrowserHost::setTeardownBudget(long ms)
+{
+    boost::mutex::scoped_lock _l(s_teardownMutex);
+    s_teardownBudget = ms;
+}
+
+long FB::BrowserHost::getTeardownBudget()
+{
+    boost::mutex::scoped_lock _l(s_teardownMutex);
+    return s_teardownBudget;
+}
+
+void FB::BrowserHost::setTeardownObserver(const TeardownObserver& observer)
+{
+    boost::mutex::scoped_lock _l(s_teardownMutex);
+    s_teardownObserver = observer;
 }
 
 void FB::BrowserHost::htmlLog(const std::string& str)
 {
     FBLOG_INFO("BrowserHost", "Logging to HTML: " << str);
     if (m_htmlLogEnabled) {
+        FB::AsyncLogRequest* req(NULL);
         try {
-            this->ScheduleAsyncCall(&FB::BrowserHost::AsyncHtmlLog,
-                new FB::AsyncLogRequest(shared_from_this(), str));
+            req = new FB::AsyncLogRequest(shared_from_this(), str);
+            if (!this->ScheduleAsyncCall(&FB::BrowserHost::AsyncHtmlLog, req, &FB::BrowserHost::DiscardHtmlLog))
+                delete req;
         } catch (const std::exception&) {
-            // This fails during shutdown; ignore it
+            // This fails during shutdown, or when the page has too many calls waiting; ignore it
+            delete req;
         }
     }
 }
@@ -131,6 +265,11 @@ void FB::BrowserHost::AsyncHtmlLog(void *logReq)
     delete req;
 }
 
+void FB::BrowserHost::DiscardHtmlLog(void *logReq)
+{
+    delete static_cast<FB::AsyncLogRequest*>(logReq);
+}
+
 void FB::BrowserHost::evaluateJavaScript(const std::wstring &script)
 {
     evaluateJavaScript(FB::wstring_to_utf8(script));
@@ -198,6 +337,41 @@ FB::JSObjectPtr FB::BrowserHost::getDelayedInvokeDelegate() {
     return FB::JSObjectPtr();
 }
 
+bool FB::BrowserHost::freezeJSObject(const FB::JSObjectPtr& obj, const FB::variant& value)
+{
+    assertMainThread();
+    FB::DOM::WindowPtr win(getDOMWindow());
+    if (!obj || !win)
+        return false;
+
+    try {
+        // Inside out, so nothing is frozen before the objects it holds are
+        if (value.is_of_type<FB::VariantList>()) {
+            const FB::VariantList& list(value.cast<FB::VariantList>());
+            for (size_t i = 0; i < list.size(); ++i) {
+                if ((list[i].is_of_type<FB::VariantList>() || list[i].is_of_type<FB::VariantMap>())
+                    && !freezeJSObject(obj->GetProperty(static_cast<int>(i)).cast<FB::JSObjectPtr>(), list[i]))
+                    return false;
+            }
+        } else if (value.is_of_type<FB::VariantMap>()) {
+            const FB::VariantMap& map(value.cast<FB::VariantMap>());
+            for (FB::VariantMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+                if ((it->second.is_of_type<FB::VariantList>() || it->second.is_of_type<FB::VariantMap>())
+                    && !freezeJSObject(obj->GetProperty(it->first).cast<FB::JSObjectPtr>(), it->second))
+                    return false;
+            }
+        }
+        FB::JSObjectPtr objectClass(win->getProperty<FB::JSObjectPtr>("Object"));
+        if (!objectClass)
+            return false;
+        objectClass->Invoke("freeze", FB::variant_list_of(obj));
+        return true;
+    } catch (const std::exception&) {
+        // e.g. a script_error for a missing Object.freeze, or a member that didn't come back as an object
+        return false;
+    }
+}
+
 FB::DOM::WindowPtr FB::BrowserHost::_createWindow(const FB::JSObjectPtr& obj) const
 {
     return FB::DOM::WindowPtr(new FB::DOM::Window(obj));
@@ -268,78 +442,159 @@ void FB::_asyncCallData::call()
         void (*f)(void *) = func;
         func = NULL;
         called = true;
+        lease.reset();
         f(userData); 
     }
 }
 
+void FB::_asyncCallData::cancel()
+{
+    if (func) {
+        func = NULL;
+        lease.reset();
+        discard(userData);
+    }
+}
+
 
-void FB::AsyncCallManager::call( _asyncCallData* data )
+void FB::AsyncCallManager::call( size_t id )
 {
+    _asyncCallData* data(NULL);
     {
-        // Verify _asyncCallData is still in DataList. If not, the _asyncCallData has already been dealt with. 
+        // If the call isn't in DataList any more it has already been dealt with
         boost::recursive_mutex::scoped_lock _l(m_mutex);
-        std::set<_asyncCallData*>::iterator fnd = DataList.find(data);
-        if (DataList.end() != fnd)
+        std::map<size_t, _asyncCallData*>::iterator fnd = DataList.find(id);
+        if (DataList.end() != fnd) {
+            data = fnd->second;
             DataList.erase(fnd);
-        else
-            data = NULL;
+        }
     }
+    FB_RACE_POINT("AsyncCallManager::call");
     if (data) {
         data->call();
         delete data;
     }
 }
 
-FB::_asyncCallData* FB::AsyncCallManager::makeCallback(void (*func)(void *), void * userData)
+FB::_asyncCallData* FB::AsyncCallManager::makeCallback(void (*func)(void *), void * userData, void (*discard)(void *),
+    const ResourceLeasePtr& lease)
 {
     boost::recursive_mutex::scoped_lock _l(m_mutex);
-    _asyncCallData *data = new _asyncCallData(func, userData, ++lastId, shared_from_this());
-    DataList.insert(data);
+    // Another thread got in between the host's check and here
+    if (isShutDown)
+        return NULL;
+    size_t id;
+    {
+        boost::mutex::scoped_lock _cl(asyncCallsMutex);
+        id = ++lastAsyncCallId;
+        asyncCalls[id] = shared_from_this();
+    }
+    _asyncCallData *data = new _asyncCallData(func, userData, discard, id, lease);
+    DataList[id] = data;
     return data;
 }
 
-void FB::AsyncCallManager::remove(_asyncCallData* data)
+bool FB::AsyncCallManager::remove(_asyncCallData* data)
 {
     boost::recursive_mutex::scoped_lock _l(m_mutex);
-    DataList.erase(data);
+    if (!DataList.erase(data->uniqId))
+        return false;
+    {
+        boost::mutex::scoped_lock _cl(asyncCallsMutex);
+        asyncCalls.erase(data->uniqId);
+    }
+    delete data;
+    return true;
 }
 
-void FB::AsyncCallManager::shutdown()
+std::pair<size_t, size_t> FB::AsyncCallManager::shutdown()
 {
-    boost::recursive_mutex::scoped_lock _l(m_mutex);
-    // Store these so that they can be freed when the browserhost object is destroyed -- at that
-    // point it's no longer possible for the browser to finish the async calls
-    canceledDataList.insert(DataList.begin(), DataList.end());
-
-    std::for_each(DataList.begin(), DataList.end(), boost::lambda::bind(&_asyncCallData::call, boost::lambda::_1));
-    DataList.clear();
+    std::vector<_asyncCallData*> pending;
+    {
+        boost::recursive_mutex::scoped_lock _l(m_mutex);
+        // Store these so that they can be freed when the browserhost object is destroyed -- at that
+        // point it's no longer possible for the browser to finish the async calls
+        // In the order they were scheduled; the calls that have to run may depend on that
+        for (std::map<size_t, _asyncCallData*>::const_iterator it = DataList.begin(); it != DataList.end(); ++it)
+            pending.push_back(it->second);
+        canceledDataList.insert(pending.begin(), pending.end());
+        DataList.clear();
+        isShutDown = true;
+    }
+    FB_RACE_POINT("AsyncCallManager::shutdown");
+
+    std::pair<size_t, size_t> count(0, 0);
+    for (std::vector<_asyncCallData*>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        if ((*it)->discard) {
+            (*it)->cancel();
+            ++count.first;
+        } else {
+            (*it)->call();
+            ++count.second;
+        }
+    }
+    return count;
 }
 
 FB::AsyncCallManager::~AsyncCallManager()
 {
+    {
+        // The browser may still make these calls; make sure they find nothing
+        boost::mutex::scoped_lock _l(asyncCallsMutex);
+        for (std::set<_asyncCallData*>::const_iterator it = canceledDataList.begin(); it != canceledDataList.end(); ++it)
+            asyncCalls.erase((*it)->uniqId);
+        for (std::map<size_t, _asyncCallData*>::const_iterator it = DataList.begin(); it != DataList.end(); ++it)
+            asyncCalls.erase(it->first);
+    }
     std::for_each(canceledDataList.begin(), canceledDataList.end(), boost::lambda::bind(boost::lambda::delete_ptr(), boost::lambda::_1));
 }
 
 
 void asyncCallWrapper(void *userData)
 {
+    FB_RACE_POINT("asyncCallWrapper");
     // Verify AsyncCallManager still exists. If not, the _asyncCallData has already been dealt with.
-    FB::_asyncCallData* data(static_cast<FB::_asyncCallData*>(userData));
-    FB::AsyncCallManagerPtr ptr(data->mgr.lock());
+    size_t id(reinterpret_cast<size_t>(userData));
+    FB::AsyncCallManagerWeakPtr mgr;
+    {
+        boost::mutex::scoped_lock _l(asyncCallsMutex);
+        std::map<size_t, FB::AsyncCallManagerWeakPtr>::iterator fnd(asyncCalls.find(id));
+        if (fnd == asyncCalls.end())
+            return;
+        mgr = fnd->second;
+        asyncCalls.erase(fnd);
+    }
+    FB::AsyncCallManagerPtr ptr(mgr.lock());
     if (ptr) {
-        ptr->call(data);
+        ptr->call(id);
     }
 }
 
 bool FB::BrowserHost::ScheduleAsyncCall( void (*func)(void *), void *userData ) const
+{
+    return ScheduleAsyncCall(func, userData, NULL);
+}
+
+bool FB::BrowserHost::ScheduleAsyncCall( void (*func)(void *), void *userData, void (*discard)(void *) ) const
 {
     if (isShutDown()) {
         return false;
     } else {
-        _asyncCallData* data = _asyncManager->makeCallback(func, userData);
-        bool result = _scheduleAsyncCall(&asyncCallWrapper, data);
-        if (!result) {
-            _asyncManager->remove(data);
+        // A call that can't be dropped still counts, so that the ones after it are turned down
+        FB::ResourceQuotaPtr quota(FB::ResourceQuota::instance());
+        FB::ResourceLeasePtr lease(discard
+            ? quota->tryAcquire(getPageOrigin(), FB::ResourceQuota::AsyncCalls)
+            : quota->charge(getPageOrigin(), FB::ResourceQuota::AsyncCalls));
+        if (!lease)
+            return false;
+        _asyncCallData* data = _asyncManager->makeCallback(func, userData, discard, lease);
+        if (!data)
+            return false;
+        FB_RACE_POINT("BrowserHost::ScheduleAsyncCall");
+        bool result = _scheduleAsyncCall(&asyncCallWrapper, reinterpret_cast<void*>(data->uniqId));
+        if (!result && !_asyncManager->remove(data)) {
+            // Shutdown got to it first and already made or discarded it
+            result = true;
         }
         return result;
     }
@@ -367,9 +622,15 @@ FB::BrowserStreamPtr FB::BrowserHost::createStream( const BrowserStreamRequest&
         FB::SimpleStreamHelperPtr asyncPtr(SimpleStreamHelper::AsyncRequest(shared_from_this(), req));
         return asyncPtr->getStream();
     } else { // Create the stream with the EventSink
+        // Turned down before the browser is asked for anything
+        const std::string origin(getPageOrigin());
+        FB::ResourceQuotaPtr quota(FB::ResourceQuota::instance());
+        FB::BrowserStreamManager::LeaseList leases;
+        leases.push_back(quota->acquire(origin, FB::ResourceQuota::Streams));
+        leases.push_back(quota->acquire(origin, FB::ResourceQuota::BufferBytes, req.internalBufferSize));
         FB::BrowserStreamPtr ptr(_createStream(req));
         if (ptr) {
-            m_streamMgr->retainStream(ptr);
+            m_streamMgr->retainStream(ptr, leases);
         }
         return ptr;
     }
@@ -393,11 +654,82 @@ FB::BrowserStreamPtr FB::BrowserHost::createUnsolicitedStream( const BrowserStre
     assertMainThread();
     FB::BrowserStreamPtr ptr(_createUnsolicitedStream(req));
     if (ptr) {
-        m_streamMgr->retainStream(ptr);
+        // The browser has already started these, so they are counted but never turned down
+        const std::string origin(getPageOrigin());
+        FB::ResourceQuotaPtr quota(FB::ResourceQuota::instance());
+        FB::BrowserStreamManager::LeaseList leases;
+        leases.push_back(quota->charge(origin, FB::ResourceQuota::Streams));
+        leases.push_back(quota->charge(origin, FB::ResourceQuota::BufferBytes, req.internalBufferSize));
+        m_streamMgr->retainStream(ptr, leases);
     }
     return ptr;
 }
 
+std::string FB::BrowserHost::getPageOrigin() const
+{
+    boost::mutex::scoped_lock _l(m_originMutex);
+    return m_origin;
+}
+
+void FB::BrowserHost::capturePageOrigin()
+{
+    assertMainThread();
+    {
+        boost::mutex::scoped_lock _l(m_originMutex);
+        if (m_originKnown)
+            return;
+    }
+    std::string origin;
+    try {
+        FB::DOM::WindowPtr window(getDOMWindow());
+        if (window)
+            origin = FB::BrowserStreamScheduler::getOrigin(FB::URI::fromString(window->getLocation()));
+    } catch (const std::exception&) {
+        // No page to read it from; it stays unknown
+    }
+    if (origin.empty())
+        return;
+    boost::mutex::scoped_lock _l(m_originMutex);
+    if (!m_originKnown) {
+        m_origin = origin;
+        m_originKnown = true;
+    }
+}
+
+void FB::BrowserHost::setPageOrigin(const std::string& origin)
+{
+    boost::mutex::scoped_lock _l(m_originMutex);
+    m_origin = origin;
+    m_originKnown = true;
+}
+
+FB::BrowserStreamSchedulerPtr FB::BrowserHost::getStreamScheduler() const
+{
+    boost::recursive_mutex::scoped_lock _l(m_jsapimutex);
+    if (!m_streamScheduler && !isShutDown()) {
+        m_streamScheduler = boost::make_shared<FB::BrowserStreamScheduler>(shared_from_this());
+    }
+    return m_streamScheduler;
+}
+
+FB::BrowserSessionPtr FB::BrowserHost::getBrowserSession()
+{
+    boost::recursive_mutex::scoped_lock _l(m_jsapimutex);
+    if (!m_browserSession && !isShutDown()) {
+        m_browserSession = boost::make_shared<FB::BrowserSession>(shared_from_this());
+    }
+    return m_browserSession;
+}
+
+FB::ScheduledStreamRequestPtr FB::BrowserHost::scheduleStream( const BrowserStreamRequest& req ) const
+{
+    FB::BrowserStreamSchedulerPtr scheduler(getStreamScheduler());
+    if (!scheduler) {
+        throw FB::script_error("Cannot schedule a stream after shutdown");
+    }
+    return scheduler->schedule(req);
+}
+
 bool FB::BrowserHost::DetectProxySettings( std::map<std::string, std::string>& settingsMap, const std::string& url )
 {
     return FB::SystemProxyDetector::get()->detectProxy(settingsMap, url);
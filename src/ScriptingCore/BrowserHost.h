@@ -17,11 +17,13 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #define H_FB_BROWSERHOSTWRAPPER
 
 #include "APITypes.h"
+#include "CancellationToken.h"
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 namespace FB
 {
@@ -51,8 +53,35 @@ namespace FB
         std::string m_msg;
     };
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @struct TeardownReport
+    ///
+    /// @brief  How long each step of BrowserHost::shutdown took, and which ones ran past the teardown
+    ///         budget
+    ///
+    /// @see BrowserHost::setTeardownBudget
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct TeardownReport
+    {
+        TeardownReport() : budgetMs(0), elapsedMs(0), discardedCalls(0), mustRunCalls(0) { }
+
+        long budgetMs;
+        long elapsedMs;
+        // Each step in the order it ran, with the milliseconds it took
+        std::vector<std::pair<std::string, long> > components;
+        // The steps that were still running when the budget ran out
+        std::vector<std::string> overruns;
+        // Pending async calls that were dropped, and ones that had to be run anyway
+        size_t discardedCalls;
+        size_t mustRunCalls;
+    };
+    typedef boost::function<void (const TeardownReport&)> TeardownObserver;
+
     FB_FORWARD_PTR(AsyncCallManager);
     FB_FORWARD_PTR(BrowserStreamManager);
+    FB_FORWARD_PTR(BrowserStreamScheduler);
+    FB_FORWARD_PTR(ScheduledStreamRequest);
+    FB_FORWARD_PTR(BrowserSession);
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     /// @class  BrowserHost
@@ -99,6 +128,10 @@ namespace FB
         /// The provided function will be called with the userData on the main thread. If the
         /// plugin instance is shutting down this may fail and return false
         ///
+        /// Each call waiting to run counts against the page's ResourceQuota::AsyncCalls; calls that
+        /// can be discarded (see the other overload) are turned down once the page has too many, or
+        /// if its origin isn't known.
+        ///
         /// NOTE: This is a low level call; it is almost always better to use ScheduleOnMainThread
         ///
         /// @param  func     The function to call.
@@ -111,6 +144,20 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         bool ScheduleAsyncCall(void (*func)(void *), void *userData) const;
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool ScheduleAsyncCall(void (*func)(void *), void *userData, void (*discard)(void *)) const
+        ///
+        /// @brief  Like ScheduleAsyncCall(func, userData), but if the plugin shuts down before the call is
+        ///         made discard is called with userData instead (to free it) and func never runs.
+        ///
+        /// Calls scheduled without a discard function can't be dropped, so they are run during shutdown.
+        ///
+        /// @returns bool false if the call could not be scheduled, as when the page already has as
+        ///          many calls waiting as its quota allows; neither func nor discard is called then
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool ScheduleAsyncCall(void (*func)(void *), void *userData, void (*discard)(void *)) const;
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn template<class Functor> typename Functor::result_type CallOnMainThread(Functor func) const
         ///
@@ -122,7 +169,7 @@ namespace FB
         ///     int result = host->CallOnMainThread(boost::bind(&ObjectType::method, obj, arg1, arg2));
         /// } catch (const FB::script_error&) {
         ///     // The call will throw this exception if the browser is shutting down and it cannot
-        ///     // be completed.
+        ///     // be completed, or if the page already has as many calls waiting as it may.
         /// }
         /// @endcode
         ///
@@ -159,15 +206,22 @@ namespace FB
         /// is then used to create a weak_ptr so that if the object goes away before the call is made
         /// the call can fail silently instead of crashing the browser.
         ///
+        /// If the plugin shuts down before the call is made it is dropped, unless mustRun is true in
+        /// which case it runs during shutdown; only ask for that if skipping the call would leak or
+        /// leave something inconsistent, since it holds up the browser closing the page. Other calls are
+        /// also dropped if the page already has as many waiting as its quota allows (see
+        /// ScheduleAsyncCall).
+        ///
         /// @param  obj     A boost::shared_ptr to the object that must exist when the call is made
         /// @param  func    The functor to execute on the main thread created with boost::bind
+        /// @param  mustRun Run the call even if the plugin shuts down first
         /// @throws FB::script_error
         /// @see CallOnMainThread
         /// @see ScheduleAsyncCall
         /// @since 1.3.0
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         template<class C, class Functor>
-        void ScheduleOnMainThread(const boost::shared_ptr<C>& obj, Functor func) const;
+        void ScheduleOnMainThread(const boost::shared_ptr<C>& obj, Functor func, bool mustRun = false) const;
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn static void AsyncHtmlLog(void *)
@@ -179,6 +233,8 @@ namespace FB
         /// @param data an AsyncLogRequest object in a void*
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         static void AsyncHtmlLog(void *data);
+        // Frees an AsyncLogRequest that won't be logged because the plugin shut down first
+        static void DiscardHtmlLog(void *data);
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn virtual void *getContextID() const = 0
@@ -271,6 +327,45 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         virtual BrowserStreamPtr createUnsolicitedStream( const BrowserStreamRequest& req ) const;
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn ScheduledStreamRequestPtr scheduleStream( const BrowserStreamRequest& req ) const
+        ///
+        /// @brief  Queues a BrowserStreamRequest to be started by the BrowserStreamScheduler
+        ///
+        /// Unlike createStream, which asks the browser for the stream immediately, this queues the
+        /// request and starts it once the number of streams in progress (overall and to the same
+        /// origin) is below the scheduler's limits, highest BrowserStreamRequest::setPriority first.
+        /// May be called from any thread; streams are always started on the main thread.
+        ///
+        /// @param  req     BrowserStreamRequest object for the request
+        ///
+        /// @return handle that can be used to reprioritize or cancel the request while it is queued
+        /// @since 1.7
+        /// @see FB::BrowserStreamScheduler
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        ScheduledStreamRequestPtr scheduleStream( const BrowserStreamRequest& req ) const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn BrowserStreamSchedulerPtr getStreamScheduler() const
+        ///
+        /// @brief  Returns the BrowserStreamScheduler used by scheduleStream, e.g. to change its limits
+        ///
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        BrowserStreamSchedulerPtr getStreamScheduler() const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn BrowserSessionPtr getBrowserSession()
+        ///
+        /// @brief  Returns the BrowserSession that keeps the cookies, proxy and saved credentials the
+        ///         browser has for each origin, for use by HTTP requests made from other threads
+        ///
+        /// @return the session, or an empty pointer after shutdown
+        /// @since 1.7
+        /// @see FB::BrowserSession
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        BrowserSessionPtr getBrowserSession();
+
         // Methods for accessing the DOM
     public:
 
@@ -371,6 +466,23 @@ namespace FB
         FB::JSObjectPtr getDelayedInvokeDelegate();
         virtual void initJS(const void* inst);
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool freezeJSObject(const FB::JSObjectPtr& obj, const FB::variant& value)
+        ///
+        /// @brief  Freezes a JS object made from a VariantList or VariantMap, and the ones made from
+        ///         any lists or maps inside it, with Object.freeze so the page can't change them
+        ///
+        /// Must be called on the main thread.
+        ///
+        /// @param  obj     The object value was converted into
+        /// @param  value   The value obj was made from
+        /// @return false if the page can't freeze objects (Object.freeze is missing before IE9), in
+        ///         which case obj may be partly frozen and shouldn't be handed out again
+        ///
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool freezeJSObject(const FB::JSObjectPtr& obj, const FB::variant& value);
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn virtual void htmlLog(const std::string& str)
         ///
@@ -416,6 +528,84 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         inline bool isShutDown() const { return m_isShutDown; }
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn const CancellationTokenPtr& getCancellationToken() const
+        ///
+        /// @brief  Returns a token that is canceled as soon as shutdown() starts.
+        ///
+        /// Worker threads, timers and requests started on behalf of this plugin instance should watch
+        /// it so that they stop promptly when the page goes away instead of holding up the browser.
+        ///
+        /// @see CancellationToken
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        const CancellationTokenPtr& getCancellationToken() const { return m_cancelToken; }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn std::string getPageOrigin() const
+        ///
+        /// @brief  Returns the origin ("scheme://host[:port]") of the page this instance is on, which
+        ///         its timers, streams and main thread calls are counted against (see ResourceQuota).
+        ///
+        /// The browser host reads it from the window's location when it is set up (see
+        /// capturePageOrigin); hosts with no page (e.g. in tests) should call setPageOrigin. Until
+        /// one of those happens it is empty, and ResourceQuota turns down whatever asks for it.
+        ///
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        std::string getPageOrigin() const;
+        void setPageOrigin(const std::string& origin);
+        // Reads the page origin from the window's location, unless it is already known; browser
+        // hosts call this on the main thread once they have the page
+        void capturePageOrigin();
+
+        typedef boost::function<void (const boost::posix_time::ptime& deadline)> TeardownTask;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void addTeardownTask(const std::string& name, const TeardownTask& task) const
+        ///
+        /// @brief  Registers task to be run by shutdown(), after the cancellation token has been
+        ///         canceled.
+        ///
+        /// The task is given the (UTC) time by which the teardown budget runs out, and should give up
+        /// waiting at that point, e.g.:
+        /// @code
+        ///      void MyPluginAPI::stopWorker(const boost::posix_time::ptime& deadline) {
+        ///          if (!m_thread.timed_join(deadline))
+        ///              m_thread.detach(); // it will notice the canceled token eventually
+        ///      }
+        ///      m_host->addTeardownTask("worker", boost::bind(&MyPluginAPI::stopWorker, this, _1));
+        /// @endcode
+        /// Tasks that finish late are reported in the TeardownReport by name.
+        ///
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void addTeardownTask(const std::string& name, const TeardownTask& task) const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn static void setTeardownBudget(long ms)
+        ///
+        /// @brief  Sets how long shutdown() of any instance should take at most (500ms by default).
+        ///
+        /// The budget isn't enforced by force, since nothing can be interrupted safely; steps that run
+        /// past it are logged and reported in the TeardownReport so the culprit can be found.
+        ///
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        static void setTeardownBudget(long ms);
+        static long getTeardownBudget();
+        // Called with the report at the end of every shutdown()
+        static void setTeardownObserver(const TeardownObserver& observer);
+        // The report of the last shutdown() of this instance
+        const TeardownReport& getTeardownReport() const { return m_teardownReport; }
+
+    private:
+        // Records how long the step that started at stepStart took, and moves stepStart to now
+        static void finishTeardownStep(TeardownReport& report, const std::string& name,
+            boost::posix_time::ptime& stepStart, const boost::posix_time::ptime& deadline);
+
+    public:
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn virtual void freeRetainedObjects() const
         ///
@@ -471,6 +661,38 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         virtual bool DetectProxySettings(std::map<std::string, std::string>& settingsMap, const std::string& url = "");
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual bool GetCookiesForURL(const std::string& url, std::string& cookies)
+        ///
+        /// @brief  Gets the cookies the browser would send with a request for url, as the value of a
+        ///         Cookie header ("name=value; name2=value2")
+        ///
+        /// Must be called on the main thread; other threads should use getBrowserSession(), which
+        /// keeps a copy.  The default implementation knows of no cookies.
+        ///
+        /// @param url the url of the request
+        /// @param cookies (out) the cookies; empty if there are none
+        /// @return false if the browser can't say
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual bool GetCookiesForURL(const std::string& url, std::string& cookies) { return false; }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual bool GetCredentialsForURL(const std::string& url, const std::string& scheme,
+        ///     const std::string& realm, std::string& username, std::string& password)
+        ///
+        /// @brief  Gets the username and password the browser has saved for the server of url and the
+        ///         authentication scheme ("basic", "digest") and realm it asked for
+        ///
+        /// Must be called on the main thread; other threads should use getBrowserSession().  The
+        /// default implementation knows of no credentials.
+        ///
+        /// @return false if the browser has nothing saved or can't say
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual bool GetCredentialsForURL(const std::string& url, const std::string& scheme,
+            const std::string& realm, std::string& username, std::string& password) { return false; }
+
     public:
         virtual FB::DOM::WindowPtr _createWindow(const FB::JSObjectPtr& obj) const;
         virtual FB::DOM::DocumentPtr _createDocument(const FB::JSObjectPtr& obj) const;
@@ -508,10 +730,25 @@ namespace FB
         mutable std::list<FB::JSAPIPtr> m_retainedObjects;
         static volatile int InstanceCount;
         BrowserStreamManagerPtr m_streamMgr;
+        mutable BrowserStreamSchedulerPtr m_streamScheduler;
+        BrowserSessionPtr m_browserSession;
 
         // Indicates if html logging should be enabled (default true)
         bool m_htmlLogEnabled;
 
+        // Canceled when shutdown() starts
+        CancellationTokenPtr m_cancelToken;
+        // Set once capturePageOrigin or setPageOrigin has found it
+        mutable boost::mutex m_originMutex;
+        std::string m_origin;
+        bool m_originKnown;
+        // Run by shutdown(), with how long the last one took
+        mutable std::vector<std::pair<std::string, TeardownTask> > m_teardownTasks;
+        TeardownReport m_teardownReport;
+        static long s_teardownBudget;
+        static TeardownObserver s_teardownObserver;
+        static boost::mutex s_teardownMutex;
+
         std::string unique_key;
         std::string call_delegate;
     };
@@ -0,0 +1,97 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <boost/thread/thread.hpp>
+#include <boost/thread/thread_time.hpp>
+#include "JSExceptions.h"
+#include "logging.h"
+#include "CancellationToken.h"
+
+using namespace FB;
+
+CancellationToken::CancellationToken() : m_canceled(false), m_lastId(0), m_running(0)
+{
+}
+
+void CancellationToken::cancel()
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    if (m_canceled)
+        return;
+    m_canceled = true;
+    m_cancelThread = boost::this_thread::get_id();
+    m_cond.notify_all();
+    // One at a time, so that unregister() can tell whether its callback is running
+    while (!m_callbacks.empty()) {
+        std::map<int, CancelCallback>::iterator it(m_callbacks.begin());
+        CancelCallback callback(it->second);
+        m_running = it->first;
+        m_callbacks.erase(it);
+        _l.unlock();
+        try {
+            callback();
+        } catch (const std::exception& e) {
+            FBLOG_WARN("CancellationToken", "Cancel callback threw: " << e.what());
+        }
+        _l.lock();
+        m_running = 0;
+        m_cond.notify_all();
+    }
+}
+
+bool CancellationToken::isCanceled() const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_canceled;
+}
+
+int CancellationToken::onCancel(const CancelCallback& callback)
+{
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        if (!m_canceled) {
+            m_callbacks[++m_lastId] = callback;
+            return m_lastId;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void CancellationToken::unregister(int id)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_callbacks.erase(id);
+    // Wait out the callback if cancel() is calling it on another thread
+    while (id && m_running == id && m_cancelThread != boost::this_thread::get_id())
+        m_cond.wait(_l);
+}
+
+bool CancellationToken::waitFor(long ms) const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    boost::system_time until = boost::get_system_time() + boost::posix_time::milliseconds(ms);
+    while (!m_canceled) {
+        if (!m_cond.timed_wait(_l, until))
+            break;
+    }
+    return m_canceled;
+}
+
+void CancellationToken::throwIfCanceled() const
+{
+    if (isCanceled())
+        throw FB::script_error("Operation canceled");
+}
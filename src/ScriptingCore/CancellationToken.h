@@ -0,0 +1,93 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_CANCELLATIONTOKEN
+#define H_FB_CANCELLATIONTOKEN
+
+#include <map>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+#include "FBPointers.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(CancellationToken);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  CancellationToken
+    ///
+    /// @brief  A flag that long-running work checks, waits on or subscribes to, so that it can be
+    ///         told to stop.
+    ///
+    /// Every BrowserHost has one, which is canceled as soon as the plugin starts shutting down (see
+    /// BrowserHost::getCancellationToken). A worker thread should sleep with waitFor() rather than
+    /// boost::this_thread::sleep so that it wakes up at once:
+    /// @code
+    ///      FB::CancellationTokenPtr token(m_host->getCancellationToken());
+    ///      while (!token->isCanceled()) {
+    ///          doSomeWork();
+    ///          token->waitFor(1000);
+    ///      }
+    /// @endcode
+    /// Things that block elsewhere (a request, a timer) can instead be stopped from onCancel().
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class CancellationToken : boost::noncopyable
+    {
+    public:
+        typedef boost::function<void ()> CancelCallback;
+
+        CancellationToken();
+
+        // Cancels the token and calls the registered callbacks on this thread; only the first
+        // call does anything
+        void cancel();
+        bool isCanceled() const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn int CancellationToken::onCancel(const CancelCallback& callback)
+        ///
+        /// @brief  Registers callback to be called when the token is canceled, or calls it right away if
+        ///         it already is.
+        ///
+        /// @return An id for unregister(), or 0 if the callback was already called
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        int onCancel(const CancelCallback& callback);
+        // Once this returns the callback isn't running and won't be called (unless this is called
+        // from the callback itself)
+        void unregister(int id);
+
+        // Waits up to ms milliseconds for the token to be canceled; returns isCanceled()
+        bool waitFor(long ms) const;
+        // Throws FB::script_error if the token is canceled
+        void throwIfCanceled() const;
+
+    protected:
+        mutable boost::mutex m_mutex;
+        mutable boost::condition_variable m_cond;
+        bool m_canceled;
+        int m_lastId;
+        std::map<int, CancelCallback> m_callbacks;
+        int m_running; // id of the callback cancel() is calling
+        boost::thread::id m_cancelThread;
+    };
+};
+
+#endif // H_FB_CANCELLATIONTOKEN
+
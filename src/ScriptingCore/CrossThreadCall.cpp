@@ -21,6 +21,14 @@ void CrossThreadCall::syncCallbackFunctor(void *userData)
 {
     std::auto_ptr<CrossThreadCallWeakPtr> callWeak(static_cast<CrossThreadCallWeakPtr*>(userData));
     if (CrossThreadCallPtr call = callWeak->lock()) {
+        {
+            boost::lock_guard<boost::mutex> lock(call->m_mutex);
+            // The caller stopped waiting at shutdown, so what funct refers to may be gone
+            if (call->m_abandoned)
+                return;
+            call->m_started = true;
+        }
+        FB_RACE_POINT("CrossThreadCall::syncCallbackFunctor");
         try 
         {
             call->funct->call();
@@ -32,7 +40,7 @@ void CrossThreadCall::syncCallbackFunctor(void *userData)
         // Make sure the lock goes out of scope before we finish
         boost::lock_guard<boost::mutex> lock(call->m_mutex);
         call->m_returned = true;
-        call->m_cond.notify_one();
+        call->m_cond.notify_all();
     }
 }
 
@@ -51,3 +59,13 @@ void CrossThreadCall::asyncCallbackFunctor(void *userData)
     }
 }
 
+void CrossThreadCall::asyncDiscardFunctor(void *userData)
+{
+    delete static_cast<CrossThreadCall *>(userData);
+}
+
+void CrossThreadCall::syncDiscardFunctor(void *userData)
+{
+    // The caller gives up on its own once the host is shut down
+    delete static_cast<CrossThreadCallWeakPtr*>(userData);
+}
@@ -26,6 +26,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include <boost/make_shared.hpp>
 #include <boost/scoped_ptr.hpp>
 #include "logging.h"
+#include "RacePoint.h"
 
 namespace FB {
 
@@ -92,29 +93,38 @@ namespace FB {
         static typename Functor::result_type syncCallHelper(const FB::BrowserHostConstPtr &host, Functor func, boost::false_type /* is void */);
 
         template<class C, class Functor>
-        static void asyncCall(const FB::BrowserHostConstPtr &host, const boost::shared_ptr<C>& obj, Functor func);
+        static void asyncCall(const FB::BrowserHostConstPtr &host, const boost::shared_ptr<C>& obj, Functor func, bool mustRun = false);
 
     protected:
-        CrossThreadCall(const boost::shared_ptr<FunctorCall>& funct) : funct(funct), m_returned(false) { }
+        CrossThreadCall(const boost::shared_ptr<FunctorCall>& funct)
+            : funct(funct), m_returned(false), m_started(false), m_abandoned(false) { }
 
         static void asyncCallbackFunctor(void *userData);
         static void syncCallbackFunctor(void *userData);
+        // Free the call if the plugin shuts down before it is made
+        static void asyncDiscardFunctor(void *userData);
+        static void syncDiscardFunctor(void *userData);
 
         boost::shared_ptr<FunctorCall> funct;
         variant m_result;
         bool m_returned;
+        // Sync calls: the main thread has begun the call, or the caller has given up on it
+        bool m_started;
+        bool m_abandoned;
 
         boost::condition_variable m_cond;
         boost::mutex m_mutex;
     };
 
     template<class C, class Functor>
-    void CrossThreadCall::asyncCall(const FB::BrowserHostConstPtr &host, const boost::shared_ptr<C>& obj, Functor func)
+    void CrossThreadCall::asyncCall(const FB::BrowserHostConstPtr &host, const boost::shared_ptr<C>& obj, Functor func, bool mustRun)
     {
         boost::shared_ptr<FunctorCall> funct = boost::make_shared<FunctorCallImpl<Functor, C> >(obj, func);
         CrossThreadCall *call = new CrossThreadCall(funct);
-        if (!host->ScheduleAsyncCall(&CrossThreadCall::asyncCallbackFunctor, call)) {
-            // Host is likely shut down; at any rate, this didn't work. Since it's asynchronous, fail silently
+        if (!host->ScheduleAsyncCall(&CrossThreadCall::asyncCallbackFunctor, call,
+                mustRun ? NULL : &CrossThreadCall::asyncDiscardFunctor)) {
+            // Host is likely shut down, or the page has too many calls waiting; at any rate, this didn't
+            // work. Since it's asynchronous, fail silently
             delete call;
             return;
         }
@@ -142,18 +152,26 @@ namespace FB {
             CrossThreadCallWeakPtr *callWeak = new CrossThreadCallWeakPtr(call);
             {
                 boost::unique_lock<boost::mutex> lock(call->m_mutex);
-                if (!host->ScheduleAsyncCall(&CrossThreadCall::syncCallbackFunctor, callWeak)) {
-                    // Browser probably shutting down, but cross thread call failed.
+                if (!host->ScheduleAsyncCall(&CrossThreadCall::syncCallbackFunctor, callWeak, &CrossThreadCall::syncDiscardFunctor)) {
+                    // Browser probably shutting down, or the page has too many calls waiting
                     delete callWeak;
                     throw FB::script_error("Could not marshal to main thread");
                 }
+                FB_RACE_POINT("CrossThreadCall::syncCall");
 
-                while (!call->m_returned && !host->isShutDown()) {
+                // Give up as soon as shutdown starts; the main thread may be waiting for this one
+                const FB::CancellationTokenPtr& token(host->getCancellationToken());
+                while (!call->m_returned && !host->isShutDown() && !token->isCanceled()) {
                     boost::posix_time::time_duration wait_duration = boost::posix_time::milliseconds(10);
                     call->m_cond.timed_wait(lock, wait_duration);
                 }
-                if (host->isShutDown())
+                // Unless the call has already begun, since func may refer to things on this stack
+                while (!call->m_returned && call->m_started)
+                    call->m_cond.wait(lock);
+                if (!call->m_returned) {
+                    call->m_abandoned = true;
                     throw FB::script_error("Shutting down");
+                }
                 varResult = call->m_result;
             }
         } else {
@@ -164,7 +182,7 @@ namespace FB {
             FB::script_error* tmp(varResult.cast<FB::script_error*>());
             std::string msg = tmp->what();
             delete tmp;
-            throw FB::script_error(varResult.cast<const FB::script_error>().what());
+            throw FB::script_error(msg);
         }
     }
 
@@ -184,18 +202,26 @@ namespace FB {
             CrossThreadCallWeakPtr *callWeak = new CrossThreadCallWeakPtr(call);
             {
                 boost::unique_lock<boost::mutex> lock(call->m_mutex);
-                if (!host->ScheduleAsyncCall(&CrossThreadCall::syncCallbackFunctor, callWeak)) {
-                    // Browser probably shutting down, but cross thread call failed.
+                if (!host->ScheduleAsyncCall(&CrossThreadCall::syncCallbackFunctor, callWeak, &CrossThreadCall::syncDiscardFunctor)) {
+                    // Browser probably shutting down, or the page has too many calls waiting
                     delete callWeak;
                     throw FB::script_error("Could not marshal to main thread");
                 }
+                FB_RACE_POINT("CrossThreadCall::syncCall");
 
-                while (!call->m_returned && !host->isShutDown()) {
+                // Give up as soon as shutdown starts; the main thread may be waiting for this one
+                const FB::CancellationTokenPtr& token(host->getCancellationToken());
+                while (!call->m_returned && !host->isShutDown() && !token->isCanceled()) {
                     boost::posix_time::time_duration wait_duration = boost::posix_time::milliseconds(10);
                     call->m_cond.timed_wait(lock, wait_duration);
                 }
-                if (host->isShutDown())
+                // Unless the call has already begun, since func may refer to things on this stack
+                while (!call->m_returned && call->m_started)
+                    call->m_cond.wait(lock);
+                if (!call->m_returned) {
+                    call->m_abandoned = true;
                     throw FB::script_error("Shutting down");
+                }
                 result = funct->getResult();
                 varResult = call->m_result;
             }
@@ -221,10 +247,10 @@ namespace FB {
     }
     
     template <class C, class Functor>
-    void BrowserHost::ScheduleOnMainThread(const boost::shared_ptr<C>& obj, Functor func) const
+    void BrowserHost::ScheduleOnMainThread(const boost::shared_ptr<C>& obj, Functor func, bool mustRun) const
     {
         boost::shared_lock<boost::shared_mutex> _l(m_xtmutex);
-        CrossThreadCall::asyncCall(shared_from_this(), obj, func);
+        CrossThreadCall::asyncCall(shared_from_this(), obj, func, mustRun);
     }    
 };
 
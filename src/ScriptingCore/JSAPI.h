@@ -399,6 +399,33 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         virtual variant GetProperty(const std::string& propertyName) = 0;
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual variant GetPropertyForHost(const std::string& propertyName,
+        ///     const FB::BrowserHostPtr& host, const FB::HostValueConverter& convert)
+        ///
+        /// @brief  Gets a property value for a browser host to hand to the page
+        ///
+        /// The result is either the property value or what convert returned for it, so the host
+        /// converts it as it would any other value. Objects that cache property values (see
+        /// FB::JSAPIAuto::registerCachedProperty) can keep the converted form alongside and skip both
+        /// the getter and the conversion next time; by default this is just GetProperty. Every read
+        /// then hands the page the same converted value, so convert must only return values the
+        /// page can't change, and return anything else as it was given.
+        ///
+        /// @param  propertyName    Name of the property.
+        /// @param  host            The host the value is for; converted values are only reused for it
+        /// @param  convert         Returns the host's form of a value, e.g. a frozen JSObject for a
+        ///                         VariantMap; must be called on the host's main thread
+        ///
+        /// @return The property value, possibly converted
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual variant GetPropertyForHost(const std::string& propertyName, const FB::BrowserHostPtr& host,
+            const FB::HostValueConverter& convert)
+        {
+            return GetProperty(propertyName);
+        }
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @overload virtual void SetProperty(const std::wstring& propertyName, const variant& value)
         ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -17,7 +17,10 @@ Copyright 2009 Georg Fritzsche, Firebreath development team
 #include "boost/make_shared.hpp"
 #include "JSFunction.h"
 #include "JSEvent.h"
+#include "variant_list.h"
 #include <cassert>
+#include <iterator>
+#include "variant_encoding.h"
 #include "precompiled_headers.h" // On windows, everything above this line in PCH
 
 #include "JSAPIAuto.h"
@@ -28,6 +31,7 @@ bool FB::JSAPIAuto::s_allowMethodObjects = true;
 
 FB::JSAPIAuto::JSAPIAuto(const std::string& description)
   : FB::JSAPIImpl(SecurityScope_Public),
+    m_cacheGeneration(0),
     m_description(description),
     m_allowDynamicAttributes(FB::JSAPIAuto::s_allowDynamicAttributes),
     m_allowRemoveProperties(FB::JSAPIAuto::s_allowRemoveProperties),
@@ -38,6 +42,7 @@ FB::JSAPIAuto::JSAPIAuto(const std::string& description)
 
 FB::JSAPIAuto::JSAPIAuto( const SecurityZone& securityLevel, const std::string& description /*= "<JSAPI-Auto Secure Javascript Object>"*/ )
   : FB::JSAPIImpl(securityLevel),
+    m_cacheGeneration(0),
     m_description(description),
     m_allowDynamicAttributes(FB::JSAPIAuto::s_allowDynamicAttributes),
     m_allowRemoveProperties(FB::JSAPIAuto::s_allowRemoveProperties),
@@ -53,6 +58,7 @@ void FB::JSAPIAuto::init( )
         registerMethod("toString",  make_method(this, &JSAPIAuto::ToString));
         registerMethod("getAttribute",  make_method(this, &JSAPIAuto::getAttribute));
         registerMethod("setAttribute",  make_method(this, &JSAPIAuto::setAttribute));
+        registerMethod("invokeBatch",  make_method(this, &JSAPIAuto::invokeBatch));
 
         registerProperty("value", make_property(this, &JSAPIAuto::ToString));
         registerProperty("valid", make_property(this, &JSAPIAuto::get_valid));
@@ -105,6 +111,102 @@ void FB::JSAPIAuto::registerProperty(const std::string& name, const PropertyFunc
     boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
     m_propertyFunctorsMap[name] = propFuncs;
     m_zoneMap[name] = getZone();
+    m_cachedProperties.erase(name);
+}
+
+void FB::JSAPIAuto::registerCachedProperty(const std::string& name, const PropertyFunctors& propFuncs, long ttlMs)
+{
+    boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+    registerProperty(name, propFuncs);
+    CachedProperty entry;
+    if (ttlMs > 0)
+        entry.ttl = boost::posix_time::milliseconds(ttlMs);
+    entry.generation = ++m_cacheGeneration;
+    m_cachedProperties[name] = entry;
+}
+
+void FB::JSAPIAuto::invalidateProperty(const std::string& name)
+{
+    {
+        boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+        CachedPropertyMap::iterator fnd = m_cachedProperties.find(name);
+        if (fnd == m_cachedProperties.end())
+            return;
+        CachedProperty& entry(fnd->second);
+        entry.valid = false;
+        entry.value = FB::variant();
+        entry.host.reset();
+        entry.hostValue = FB::variant();
+        entry.generation = ++m_cacheGeneration;
+    }
+    FireEvent("onpropertychange", FB::variant_list_of(name));
+}
+
+bool FB::JSAPIAuto::readCachedProperty(const std::string& name, const FB::BrowserHostPtr& host,
+    const FB::HostValueConverter* convert, FB::variant& result)
+{
+    // The getter and the converter run without the lock, since either may call back into this
+    // object or into the page; the generation tells whether the entry changed in the meantime
+    FB::PropertyFunctors propFuncs;
+    FB::variant value;
+    bool haveValue = false;
+    unsigned long generation;
+    boost::posix_time::ptime now;
+    {
+        boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+        CachedPropertyMap::const_iterator cached = m_cachedProperties.find(name);
+        PropertyFunctorsMap::const_iterator it = m_propertyFunctorsMap.find(name);
+        if (!m_valid || cached == m_cachedProperties.end() || it == m_propertyFunctorsMap.end()
+            || !memberAccessible(m_zoneMap.find(name)))
+            return false;
+
+        const CachedProperty& entry(cached->second);
+        if (!entry.ttl.is_not_a_date_time())
+            now = boost::posix_time::microsec_clock::universal_time();
+        if (entry.valid && (now.is_not_a_date_time() || now < entry.expires)) {
+            if (!convert) {
+                result = entry.value;
+                return true;
+            }
+            if (!entry.hostValue.empty() && entry.host.lock() == host) {
+                result = entry.hostValue;
+                return true;
+            }
+            value = entry.value;
+            haveValue = true;
+        }
+        propFuncs = it->second;
+        generation = entry.generation;
+    }
+
+    if (!haveValue)
+        value = propFuncs.get();
+    FB::variant hostValue;
+    if (convert)
+        hostValue = (*convert)(value);
+
+    {
+        boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+        CachedPropertyMap::iterator cached = m_cachedProperties.find(name);
+        if (cached != m_cachedProperties.end() && cached->second.generation == generation) {
+            CachedProperty& entry(cached->second);
+            if (!haveValue) {
+                entry.value = value;
+                entry.valid = true;
+                if (!now.is_not_a_date_time())
+                    entry.expires = now + entry.ttl;
+            }
+            if (convert) {
+                entry.hostValue = hostValue;
+                entry.host = host;
+            } else if (!haveValue) {
+                entry.host.reset();
+                entry.hostValue = FB::variant();
+            }
+        }
+    }
+    result = convert ? hostValue : value;
+    return true;
 }
 
 void FB::JSAPIAuto::unregisterProperty( const std::wstring& name )
@@ -118,6 +220,7 @@ void FB::JSAPIAuto::unregisterProperty( const std::string& name )
     if (fnd != m_propertyFunctorsMap.end()) {
         m_propertyFunctorsMap.erase(name);
         m_zoneMap.erase(name);
+        m_cachedProperties.erase(name);
     }
 }
 
@@ -189,6 +292,10 @@ bool FB::JSAPIAuto::HasProperty(int idx) const
 
 FB::variant FB::JSAPIAuto::GetProperty(const std::string& propertyName)
 {
+    FB::variant cachedValue;
+    if (readCachedProperty(propertyName, FB::BrowserHostPtr(), NULL, cachedValue))
+        return cachedValue;
+
     boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
     if(!m_valid)
         throw object_invalidated();
@@ -220,6 +327,15 @@ FB::variant FB::JSAPIAuto::GetProperty(const std::string& propertyName)
     }
 }
 
+FB::variant FB::JSAPIAuto::GetPropertyForHost(const std::string& propertyName, const FB::BrowserHostPtr& host,
+    const FB::HostValueConverter& convert)
+{
+    FB::variant hostValue;
+    if (readCachedProperty(propertyName, host, &convert, hostValue))
+        return hostValue;
+    return GetProperty(propertyName);
+}
+
 void FB::JSAPIAuto::SetProperty(const std::string& propertyName, const variant& value)
 {
     boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
@@ -233,6 +349,7 @@ void FB::JSAPIAuto::SetProperty(const std::string& propertyName, const variant&
         if (memberAccessible(m_zoneMap.find(propertyName))) {
             try {
                 it->second.set(value);
+                invalidateProperty(propertyName);
             } catch (const FB::bad_variant_cast& ex) {
                 std::string errorMsg("Could not convert from ");
                 errorMsg += ex.from;
@@ -350,6 +467,70 @@ FB::variant FB::JSAPIAuto::Invoke(const std::string& methodName, const std::vect
     }
 }
 
+std::string FB::JSAPIAuto::invokeBatch( const std::string& ops, const boost::optional<bool>& stopOnError )
+{
+    FB::VariantList list;
+    try {
+        list = FB::decodeJSON(ops).convert_cast<FB::VariantList>();
+    } catch (const FB::variant_encoding_error& ex) {
+        throw FB::invalid_arguments(ex.what());
+    } catch (const FB::bad_variant_cast&) {
+        throw FB::invalid_arguments("Batch operations must be a JSON array");
+    }
+
+    // Held for the whole batch; the calls below only re-enter it
+    boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+    if(!m_valid)
+        throw object_invalidated();
+
+    std::string results("[");
+    FB::VariantList::const_iterator it = list.begin();
+    const FB::VariantList::const_iterator end = list.end();
+    while (it != end) {
+        std::string result;
+        bool failed = false;
+        // Until the argument count has been read there is no telling where the next operation starts
+        bool framed = false;
+        try {
+            std::string member(it->convert_cast<std::string>());
+            if (++it == end)
+                throw FB::invalid_arguments("Batch operation " + member + " has no argument count");
+            long argc = it->convert_cast<long>();
+            ++it;
+            if (argc < 0 || argc > std::distance(it, end))
+                throw FB::invalid_arguments("Batch operation " + member + " has a bad argument count");
+            FB::VariantList args(it, it + argc);
+            it += argc;
+            framed = true;
+
+            if (HasMethod(member)) {
+                result = FB::encodeJSON(Invoke(member, args));
+            } else if (args.empty()) {
+                result = FB::encodeJSON(GetProperty(member));
+            } else if (args.size() == 1) {
+                SetProperty(member, args[0]);
+                result = "null";
+            } else {
+                throw FB::invalid_arguments("Too many arguments to set property " + member);
+            }
+        } catch (const FB::bad_variant_cast& ex) {
+            failed = true;
+            result = FB::encodeJSON(std::string("Could not convert from ") + ex.from + " to " + ex.to);
+        } catch (const std::exception& ex) {
+            failed = true;
+            result = FB::encodeJSON(std::string(ex.what()));
+        }
+        if (results.size() > 1)
+            results += ',';
+        results += failed ? "false," : "true,";
+        results += result;
+        if (failed && (!framed || (stopOnError && *stopOnError)))
+            break;
+    }
+    results += ']';
+    return results;
+}
+
 FB::variant FB::JSAPIAuto::Construct(const std::vector<variant> &args)
 {
     boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
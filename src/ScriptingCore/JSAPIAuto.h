@@ -22,6 +22,7 @@ Copyright 2009 Georg Fritzsche, Firebreath development team
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp> 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "JSAPIImpl.h"
 #include "MethodConverter.h"
 #include "PropertyConverter.h"
@@ -270,8 +271,56 @@ namespace FB {
         /// @since 1.4b4
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         virtual void unregisterProperty(const std::string& name);
-        
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual void JSAPIAuto::registerCachedProperty(const std::string& name,
+        /// const PropertyFunctors& propFuncs, long ttlMs = 0)
+        ///
+        /// @brief  Registers a property like registerProperty, but only calls the getter when the value
+        ///         isn't cached
+        ///
+        /// Use this for properties pages read often (e.g. on every animation frame) whose getter is
+        /// expensive or builds a new VariantMap each time. The value is kept until invalidateProperty
+        /// is called, the property is set, or ttlMs milliseconds have passed if ttlMs is positive.
+        /// Browser hosts may keep their own form of the value too, but only one the page can't change
+        /// (e.g. a frozen JS object made from a VariantMap), so a cached read also skips that
+        /// conversion. Where the browser can't freeze objects, every read gets a new one as usual.
+        /// The getter isn't called with the object locked, so it may call back into it.
+        /// @code
+        ///      registerCachedProperty("capabilities", make_property(this, &MyPluginAPI::get_capabilities));
+        ///      ...
+        ///      invalidateProperty("capabilities"); // when they change
+        /// @endcode
+        ///
+        /// @param  name        The name.
+        /// @param  propFuncs   The property funcs.
+        /// @param  ttlMs       How long a value stays cached, in milliseconds; 0 for no limit
+        /// @see invalidateProperty
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual void registerCachedProperty(const std::string& name, const PropertyFunctors& propFuncs, long ttlMs = 0);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual void JSAPIAuto::invalidateProperty(const std::string& name)
+        ///
+        /// @brief  Drops the cached value of a property registered with registerCachedProperty, so the
+        ///         next read calls the getter again
+        ///
+        /// Fires the "onpropertychange" event with the property name, so pages can watch for changes
+        /// instead of polling:
+        /// @code
+        ///      plugin.addEventListener("propertychange", function(name) { ... }, false);
+        /// @endcode
+        /// May be called on any thread.
+        ///
+        /// @param  name    The name of the property
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual void invalidateProperty(const std::string& name);
+
         virtual variant GetProperty(const std::string& propertyName);
+        virtual variant GetPropertyForHost(const std::string& propertyName, const FB::BrowserHostPtr& host,
+            const FB::HostValueConverter& convert);
         virtual void SetProperty(const std::string& propertyName, const variant& value);
         virtual void RemoveProperty(const std::string& propertyName);
         virtual variant GetProperty(int idx);
@@ -308,6 +357,39 @@ namespace FB {
             return true;
         }
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn public virtual std::string JSAPIAuto::invokeBatch(const std::string& ops,
+        ///     const boost::optional<bool>& stopOnError)
+        ///
+        /// @brief  Exposed to javascript by default as "invokeBatch"; runs several calls on this object
+        ///         for the cost of one call from the page.
+        ///
+        /// ops is a JSON array, flat: each operation is a member name, the number of arguments, and
+        /// then the arguments themselves:
+        /// @code
+        ///      var res = JSON.parse(plugin.invokeBatch(JSON.stringify(["setX", 1, 10, "setY", 1, 20, "commit", 0])));
+        /// @endcode
+        /// A method is invoked with the arguments; a property is read if there are none and set if
+        /// there is one. The operations run in order under a single lock of the object.
+        ///
+        /// The result is a flat JSON array too: for each operation that ran, true and its result, or
+        /// false and the message of whatever was thrown. A result that can't be written as JSON (a
+        /// JSAPI, say) counts as an error. If stopOnError is true no operations run after the first
+        /// error; nor do any after an operation whose argument count is missing or wrong, since
+        /// there is no finding where the next one starts.
+        ///
+        /// Going through strings is what keeps a batch to one browser call: an array or object passed
+        /// or returned directly is read or built an element at a time, each a call of its own.
+        ///
+        /// @param  ops         The operations to run, as JSON
+        /// @param  stopOnError Whether to stop at the first error; defaults to false
+        ///
+        /// @return Two entries for each operation that ran, as JSON
+        /// @exception invalid_arguments if ops isn't a JSON array
+        /// @since 1.7
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual std::string invokeBatch(const std::string& ops, const boost::optional<bool>& stopOnError);
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn public virtual FB::variant getAttribute(const std::string& name)
         ///
@@ -357,6 +439,25 @@ namespace FB {
             return (it != m_zoneMap.end()) && getZone() >= it->second;
         }
 
+        struct CachedProperty {
+            CachedProperty() : ttl(boost::posix_time::not_a_date_time), valid(false), generation(0) {}
+            boost::posix_time::time_duration ttl; // not_a_date_time if the value doesn't expire
+            boost::posix_time::ptime expires;
+            bool valid;
+            FB::variant value;
+            // The host hostValue was converted for, and what it converted value into
+            FB::BrowserHostWeakPtr host;
+            FB::variant hostValue;
+            // Changes whenever the entry is made or invalidated
+            unsigned long generation;
+        };
+        typedef std::map<std::string, CachedProperty> CachedPropertyMap;
+
+        // Reads a property registered with registerCachedProperty, calling the getter (and convert, if
+        // given) only when nothing current is cached; false if name isn't one the current zone can read
+        bool readCachedProperty(const std::string& name, const FB::BrowserHostPtr& host,
+            const FB::HostValueConverter* convert, FB::variant& result);
+
     protected:
         // Stores Method Objects -- JSAPI proxy objects for calling a method on this object
         MethodObjectMap m_methodObjectMap;
@@ -366,6 +467,9 @@ namespace FB {
         PropertyFunctorsMap m_propertyFunctorsMap;
         // Keeps track of the security zone of each member
         ZoneMap m_zoneMap;
+        // Values of the properties registered with registerCachedProperty
+        CachedPropertyMap m_cachedProperties;
+        unsigned long m_cacheGeneration;
         
         const std::string m_description;
 
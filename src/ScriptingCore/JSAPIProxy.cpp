@@ -196,6 +196,15 @@ FB::variant FB::JSAPIProxy::GetProperty( const std::string& propertyName )
     return getAPI()->GetProperty(propertyName);
 }
 
+FB::variant FB::JSAPIProxy::GetPropertyForHost( const std::string& propertyName, const FB::BrowserHostPtr& host,
+    const FB::HostValueConverter& convert )
+{
+    if (propertyName == "expired")
+        return isExpired();
+    FB::scoped_zonelock _l(getAPI(), getZone());
+    return getAPI()->GetPropertyForHost(propertyName, host, convert);
+}
+
 FB::variant FB::JSAPIProxy::GetProperty( int idx )
 {
     FB::scoped_zonelock _l(getAPI(), getZone());
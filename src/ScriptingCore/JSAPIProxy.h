@@ -143,6 +143,8 @@ namespace FB
 
         virtual variant GetProperty(const std::wstring& propertyName);
         virtual variant GetProperty(const std::string& propertyName);
+        virtual variant GetPropertyForHost(const std::string& propertyName, const FB::BrowserHostPtr& host,
+            const FB::HostValueConverter& convert);
 
         virtual void SetProperty(const std::wstring& propertyName, const variant& value);
         virtual void SetProperty(const std::string& propertyName, const variant& value);
@@ -87,6 +87,22 @@ namespace FB {
         { }
         ~invalid_member() throw() { }
     };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @exception quota_exceeded
+    ///
+    /// @brief  Thrown when a page asks for a timer, stream, main thread call etc and its origin
+    ///         already holds as many as it may (see ResourceQuota).
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct quota_exceeded : script_error
+    {
+        quota_exceeded(const std::string& error, const std::string& origin)
+            : script_error(error), origin(origin)
+        { }
+        ~quota_exceeded() throw() { }
+
+        std::string origin;
+    };
 }
 
 #endif // JSExceptions_h__
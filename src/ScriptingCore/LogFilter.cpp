@@ -0,0 +1,329 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/smart_ptr/detail/spinlock_pool.hpp>
+#include "LogFilter.h"
+#include "RacePoint.h"
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+using namespace FB::Log;
+
+namespace {
+    const size_t site_slots = 1024;
+    const size_t source_slots = 256;
+    // How many slots a source looks through for its own before sharing one
+    const size_t source_probes = 4;
+
+    typedef boost::detail::spinlock_pool<3>::scoped_lock SlotLock;
+
+    // Milliseconds, wrapping every 49 days; only differences are used, and only a tick or so of
+    // accuracy is needed. These are the cheapest clocks each platform has: no system call, just a
+    // read of a value the kernel keeps up to date.
+    typedef boost::uint32_t Ticks;
+    Ticks now_ms()
+    {
+#ifdef _WIN32
+        return static_cast<Ticks>(::GetTickCount());
+#elif defined(__APPLE__)
+        static mach_timebase_info_data_t timebase;
+        if (!timebase.denom)
+            mach_timebase_info(&timebase);
+        return static_cast<Ticks>(mach_absolute_time() * timebase.numer / timebase.denom / 1000000);
+#elif defined(CLOCK_MONOTONIC_COARSE)
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<Ticks>(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#else
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<Ticks>(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#endif
+    }
+
+    // Signed, since another thread may have stored a time read just after this one's
+    boost::int32_t ms_between(Ticks since, Ticks now)
+    {
+        return static_cast<boost::int32_t>(now - since);
+    }
+
+    // FNV-1a
+    boost::uint32_t hash_string(const std::string& str)
+    {
+        boost::uint32_t hash = 2166136261u;
+        for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+            hash = (hash ^ static_cast<unsigned char>(*it)) * 16777619u;
+        return hash;
+    }
+
+    struct Summary
+    {
+        FB::Log::LogLevel level;
+        std::string src;
+        std::string msg;
+        const char* file;
+        int line;
+        const char* fn;
+    };
+}
+
+namespace FB { namespace Log {
+    // A call site, how much it has logged this window and, once that is enough for repeats to be
+    // held back, the message it is holding back
+    struct SiteSlot
+    {
+        SiteSlot() : file(NULL), line(0), windowStart(0), count(0), suppressed(0), hasText(false),
+            level(LogLevel_Info), fn(NULL), source(0) { }
+
+        const char* file;
+        int line;
+        Ticks windowStart;
+        size_t count;
+        size_t suppressed;
+        bool hasText;
+        LogLevel level;
+        std::string src;
+        std::string msg;
+        const char* fn;
+        // 1 + the source slot this site's messages were counted against, or 0
+        size_t source;
+
+        // Called with the slot locked
+        Summary summarize()
+        {
+            Summary summary = { level, src, msg + " [repeated " + boost::lexical_cast<std::string>(suppressed)
+                + " more times]", file, line, fn };
+            suppressed = 0;
+            return summary;
+        }
+    };
+
+    struct SourceSlot
+    {
+        SourceSlot() : hash(0), tokens(0), last(0), dropped(0), level(LogLevel_Trace) { }
+
+        boost::uint32_t hash; // 0 while the slot is unused; never changes once set
+        double tokens;
+        Ticks last;
+        size_t dropped;
+        LogLevel level; // the most severe of the dropped messages
+        std::string src;
+
+        // Called with the slot locked; whether a message at level may go through
+        bool take(Ticks now, const LogFilter::Options& options, LogLevel msgLevel, const char* file, int line,
+            const char* fn, boost::optional<Summary>& summary)
+        {
+            boost::int32_t elapsed = ms_between(last, now);
+            if (elapsed > 0) {
+                tokens = std::min(static_cast<double>(options.sourceBurst),
+                    tokens + elapsed * options.sourceRate / 1000.0);
+                last = now;
+            }
+            if (tokens < 1) {
+                ++dropped;
+                level = std::max(level, msgLevel);
+                return false;
+            }
+            tokens -= 1;
+            if (dropped)
+                summary = summarize(file, line, fn);
+            return true;
+        }
+
+        // Called with the slot locked
+        Summary summarize(const char* file, int line, const char* fn)
+        {
+            Summary summary = { level, src, "Dropped " + boost::lexical_cast<std::string>(dropped)
+                + " messages from " + src + " over its rate limit", file, line, fn };
+            dropped = 0;
+            level = LogLevel_Trace;
+            return summary;
+        }
+    };
+
+    class LogFilterPimpl
+    {
+    public:
+        // The slot for src, claiming an empty one the first time src is seen
+        size_t findSource(const std::string& src, Ticks now, size_t burst)
+        {
+            boost::uint32_t hash = hash_string(src) | 1;
+            for (size_t i = 0; i < source_probes; ++i) {
+                size_t index = (hash + i) % source_slots;
+                SlotLock lock(&sources[index]);
+                if (sources[index].hash == hash && sources[index].src == src)
+                    return index;
+                if (!sources[index].hash)
+                    break;
+            }
+
+            FB_RACE_POINT("LogFilter::findSource");
+            // Only claimed with claimMutex held, so two new sources can't both see a slot empty and
+            // take it; a slot is never given up, so what was found above stays valid without it
+            boost::mutex::scoped_lock claim(claimMutex);
+            for (size_t i = 0; i < source_probes; ++i) {
+                size_t index = (hash + i) % source_slots;
+                SourceSlot& source(sources[index]);
+                SlotLock lock(&source);
+                if (source.hash == hash && source.src == src)
+                    return index;
+                if (!source.hash) {
+                    source.hash = hash;
+                    source.src = src;
+                    source.tokens = static_cast<double>(burst);
+                    source.last = now;
+                    return index;
+                }
+            }
+            // Every slot it could use belongs to someone else; share the first
+            return hash % source_slots;
+        }
+
+        SiteSlot sites[site_slots];
+        SourceSlot sources[source_slots];
+        boost::mutex claimMutex;
+    };
+}; };
+
+LogFilter::LogFilter(const Sink& sink, const Options& options)
+    : m_options(options), m_sink(sink), m_suppressed(0), pimpl(new LogFilterPimpl)
+{
+}
+
+LogFilter::~LogFilter()
+{
+}
+
+// A message that goes through takes one spinlock for its call site and one for its source, and
+// copies nothing. Text is only compared and copied at a site once it has logged maxRepeats
+// times in the window, which is when repeats start being held back.
+void LogFilter::log(LogLevel level, const std::string& src, const std::string& msg, const char* file, int line,
+    const char* fn)
+{
+    boost::optional<Summary> siteSummary, sourceSummary;
+    bool pass = true;
+    const Ticks now = now_ms();
+    size_t siteIndex = 0;
+    size_t sourceHint = 0;
+
+    if (m_options.repeatWindowMs > 0) {
+        siteIndex = ((reinterpret_cast<size_t>(file) >> 3) ^ (static_cast<size_t>(line) * 2654435761u)) % site_slots;
+        SiteSlot& site(pimpl->sites[siteIndex]);
+        SlotLock lock(&site);
+        bool sameSite = site.file == file && site.line == line;
+        if (!sameSite || ms_between(site.windowStart, now) >= m_options.repeatWindowMs) {
+            // A new call site or a new window; account for what was held back of the old one
+            if (site.suppressed)
+                siteSummary = site.summarize();
+            if (!sameSite) {
+                site.file = file;
+                site.line = line;
+                site.source = 0;
+            }
+            site.windowStart = now;
+            site.count = 0;
+            site.hasText = false;
+        }
+        if (++site.count >= std::max<size_t>(m_options.maxRepeats, 1)) {
+            if (site.hasText && site.msg == msg && site.src == src) {
+                ++site.suppressed;
+                pass = false;
+            } else {
+                // The first message at the limit, or a different one from the same place
+                if (site.suppressed)
+                    siteSummary = site.summarize();
+                site.hasText = true;
+                site.level = level;
+                site.src = src;
+                site.msg = msg;
+                site.fn = fn;
+            }
+        }
+        sourceHint = site.source;
+    }
+
+    if (pass && m_options.sourceRate > 0) {
+        // A call site almost always logs for the same source, so it remembers the slot and the
+        // source name doesn't have to be hashed again
+        bool counted = false;
+        if (sourceHint) {
+            SourceSlot& source(pimpl->sources[sourceHint - 1]);
+            SlotLock lock(&source);
+            if (source.src == src) {
+                pass = source.take(now, m_options, level, file, line, fn, sourceSummary);
+                counted = true;
+            }
+        }
+        if (!counted) {
+            size_t index = pimpl->findSource(src, now, m_options.sourceBurst);
+            {
+                SourceSlot& source(pimpl->sources[index]);
+                SlotLock lock(&source);
+                pass = source.take(now, m_options, level, file, line, fn, sourceSummary);
+            }
+            if (m_options.repeatWindowMs > 0) {
+                SiteSlot& site(pimpl->sites[siteIndex]);
+                SlotLock lock(&site);
+                if (site.file == file && site.line == line)
+                    site.source = index + 1;
+            }
+        }
+    }
+
+    if (siteSummary)
+        m_sink(siteSummary->level, siteSummary->src, siteSummary->msg, siteSummary->file, siteSummary->line, siteSummary->fn);
+    if (sourceSummary)
+        m_sink(sourceSummary->level, sourceSummary->src, sourceSummary->msg, sourceSummary->file, sourceSummary->line, sourceSummary->fn);
+    if (pass)
+        m_sink(level, src, msg, file, line, fn);
+    else
+        ++m_suppressed;
+}
+
+void LogFilter::flush()
+{
+    for (size_t i = 0; i < site_slots; ++i) {
+        boost::optional<Summary> summary;
+        {
+            SiteSlot& site(pimpl->sites[i]);
+            SlotLock lock(&site);
+            if (site.suppressed)
+                summary = site.summarize();
+        }
+        if (summary)
+            m_sink(summary->level, summary->src, summary->msg, summary->file, summary->line, summary->fn);
+    }
+    for (size_t i = 0; i < source_slots; ++i) {
+        boost::optional<Summary> summary;
+        {
+            SourceSlot& source(pimpl->sources[i]);
+            SlotLock lock(&source);
+            if (source.dropped)
+                summary = source.summarize(__FILE__, __LINE__, "FB::Log::LogFilter::flush");
+        }
+        if (summary)
+            m_sink(summary->level, summary->src, summary->msg, summary->file, summary->line, summary->fn);
+    }
+}
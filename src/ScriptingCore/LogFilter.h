@@ -0,0 +1,97 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_LOGFILTER
+#define H_FB_LOGFILTER
+
+#include <string>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/detail/atomic_count.hpp>
+#include "logging.h"
+
+namespace FB { namespace Log {
+
+    class LogFilterPimpl;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  LogFilter
+    ///
+    /// @brief  Sits in front of the log appenders and keeps a misbehaving loop from flooding them.
+    ///
+    /// Two things are limited:
+    ///  - the same message from the same call site: once the site has logged maxRepeats times in
+    ///    repeatWindowMs, further repeats of its latest message are held back, and replaced by one
+    ///    "repeated N times" line when the window ends or the message changes
+    ///  - each source (the first argument to FBLOG_*): a token bucket lets through sourceBurst
+    ///    messages at once and sourceRate a second after that; what's dropped is counted in a line
+    ///    written when the source is next let through
+    ///
+    /// A summary for a call site that has gone quiet is only written by the next flush() (which
+    /// stopLogging does), so nothing is lost but it may arrive late.
+    ///
+    /// Call sites (by file and line) and sources live in fixed-size tables behind a pool of
+    /// spinlocks, so a message that goes through costs a coarse clock read and two short
+    /// uncontended locks; its text is neither hashed nor copied until its site is busy enough for
+    /// repeats to be held back. Sites that land on the same slot, or sources that run out of slots,
+    /// share one, which at worst lets through a message that could have been held back.
+    ///
+    /// The filter is configured from FactoryBase::getLogFilterOptions.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class LogFilter : boost::noncopyable
+    {
+    public:
+        struct Options
+        {
+            Options() : repeatWindowMs(1000), maxRepeats(5), sourceRate(200), sourceBurst(1000) { }
+
+            // 0 turns off collapsing repeats
+            long repeatWindowMs;
+            size_t maxRepeats;
+            // Messages per second for each source; 0 turns off rate limiting
+            double sourceRate;
+            size_t sourceBurst;
+        };
+        // Where messages that get through, and summaries, are written
+        typedef boost::function<void (LogLevel, const std::string& src, const std::string& msg,
+            const char* file, int line, const char* fn)> Sink;
+
+        LogFilter(const Sink& sink, const Options& options = Options());
+        ~LogFilter();
+
+        void log(LogLevel level, const std::string& src, const std::string& msg, const char* file, int line,
+            const char* fn);
+        // Writes summaries for everything held back so far
+        void flush();
+
+        const Options& getOptions() const { return m_options; }
+        // Messages held back since the filter was created
+        long getSuppressed() const { return m_suppressed; }
+
+    protected:
+        const Options m_options;
+        Sink m_sink;
+        boost::detail::atomic_count m_suppressed;
+
+    private:
+        boost::scoped_ptr<LogFilterPimpl> pimpl;
+    };
+
+}; };
+
+#endif // H_FB_LOGFILTER
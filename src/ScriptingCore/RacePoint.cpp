@@ -0,0 +1,33 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+#include <cstddef>
+#include "RacePoint.h"
+
+namespace {
+    FB::RaceTesting::Hook race_hook = NULL;
+}
+
+void FB::RaceTesting::setHook(Hook hook)
+{
+    race_hook = hook;
+}
+
+void FB::RaceTesting::point(const char* name)
+{
+    Hook hook = race_hook;
+    if (hook)
+        hook(name);
+}
@@ -0,0 +1,45 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_RACEPOINT
+#define H_FB_RACEPOINT
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @def    FB_RACE_POINT(name)
+///
+/// @brief  Marks a place where another thread can get in between, e.g. between scheduling a call
+///         on the main thread and waiting for it.
+///
+/// With FB_RACE_TESTING defined (the WITH_RACE_TESTING cmake option) each point calls the hook set
+/// with FB::RaceTesting::setHook, which the stress tests use to yield or sleep at random so that
+/// unlikely interleavings come up. Otherwise it compiles to nothing.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef FB_RACE_TESTING
+#  define FB_RACE_POINT(name) FB::RaceTesting::point(name)
+#else
+#  define FB_RACE_POINT(name) do { } while (0)
+#endif
+
+namespace FB { namespace RaceTesting {
+
+    typedef void (*Hook)(const char* name);
+
+    // Set before starting the threads under test, and cleared after they have all finished
+    void setHook(Hook hook);
+    void point(const char* name);
+
+}; };
+
+#endif // H_FB_RACEPOINT
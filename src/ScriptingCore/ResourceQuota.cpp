@@ -0,0 +1,235 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include "JSExceptions.h"
+#include "logging.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+
+#include "ResourceQuota.h"
+
+namespace {
+    boost::mutex instanceMutex;
+    FB::ResourceQuotaPtr sharedInstance;
+
+    const char* const resourceNames[FB::ResourceQuota::ResourceCount] = {
+        "timers", "streams", "pending async calls", "buffered bytes", "HTTP connections"
+    };
+}
+
+FB::ResourceQuota::Account::Account()
+{
+    std::fill(used, used + ResourceCount, 0);
+    std::fill(rejected, rejected + ResourceCount, 0);
+    std::fill(limit, limit + ResourceCount, 0);
+    std::fill(hasLimit, hasLimit + ResourceCount, false);
+}
+
+FB::ResourceQuota::ResourceQuota()
+{
+    m_defaults[Timers] = 256;
+    m_defaults[Streams] = 64;
+    m_defaults[AsyncCalls] = 10000;
+    m_defaults[BufferBytes] = 64 * 1024 * 1024;
+    m_defaults[Connections] = 32;
+}
+
+FB::ResourceQuotaPtr FB::ResourceQuota::instance()
+{
+    boost::mutex::scoped_lock _l(instanceMutex);
+    if (!sharedInstance)
+        sharedInstance = boost::make_shared<ResourceQuota>();
+    return sharedInstance;
+}
+
+const char* FB::ResourceQuota::getResourceName(Resource res)
+{
+    return res < ResourceCount ? resourceNames[res] : "unknown resources";
+}
+
+void FB::ResourceQuota::setDefaultLimit(Resource res, size_t limit)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_defaults[res] = limit;
+}
+
+size_t FB::ResourceQuota::getDefaultLimit(Resource res) const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_defaults[res];
+}
+
+void FB::ResourceQuota::setLimit(const std::string& origin, Resource res, size_t limit)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    Account& account(m_accounts[origin]);
+    account.limit[res] = limit;
+    account.hasLimit[res] = true;
+}
+
+void FB::ResourceQuota::clearLimits(const std::string& origin)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    AccountMap::iterator it(m_accounts.find(origin));
+    if (it == m_accounts.end())
+        return;
+    std::fill(it->second.hasLimit, it->second.hasLimit + ResourceCount, false);
+    dropIfUnused(it);
+}
+
+size_t FB::ResourceQuota::getLimit(const std::string& origin, Resource res) const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    AccountMap::const_iterator it(m_accounts.find(origin));
+    return it == m_accounts.end() ? m_defaults[res] : limitFor(it->second, res);
+}
+
+size_t FB::ResourceQuota::getUsage(const std::string& origin, Resource res) const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    AccountMap::const_iterator it(m_accounts.find(origin));
+    return it == m_accounts.end() ? 0 : it->second.used[res];
+}
+
+size_t FB::ResourceQuota::getRejectedCount(const std::string& origin, Resource res) const
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    AccountMap::const_iterator it(m_accounts.find(origin));
+    return it == m_accounts.end() ? 0 : it->second.rejected[res];
+}
+
+FB::ResourceLeasePtr FB::ResourceQuota::acquire(const std::string& origin, Resource res, size_t amount)
+{
+    std::string error;
+    if (!take(origin, res, amount, false, &error))
+        throw FB::quota_exceeded(error, origin);
+    return ResourceLeasePtr(new ResourceLease(shared_from_this(), origin, res, amount));
+}
+
+FB::ResourceLeasePtr FB::ResourceQuota::tryAcquire(const std::string& origin, Resource res, size_t amount)
+{
+    if (!take(origin, res, amount, false, NULL))
+        return ResourceLeasePtr();
+    return ResourceLeasePtr(new ResourceLease(shared_from_this(), origin, res, amount));
+}
+
+FB::ResourceLeasePtr FB::ResourceQuota::charge(const std::string& origin, Resource res, size_t amount)
+{
+    take(origin, res, amount, true, NULL);
+    return ResourceLeasePtr(new ResourceLease(shared_from_this(), origin, res, amount));
+}
+
+size_t FB::ResourceQuota::limitFor(const Account& account, Resource res) const
+{
+    return account.hasLimit[res] ? account.limit[res] : m_defaults[res];
+}
+
+void FB::ResourceQuota::dropIfUnused(AccountMap::iterator it)
+{
+    // Origins come from whatever pages get loaded; don't keep one around once it holds nothing
+    // and has nothing set for it
+    const Account& account(it->second);
+    for (int i = 0; i < ResourceCount; ++i) {
+        if (account.used[i] || account.hasLimit[i])
+            return;
+    }
+    m_accounts.erase(it);
+}
+
+std::string FB::ResourceQuota::describe(const std::string& origin, Resource res, size_t used, size_t limit) const
+{
+    if (origin.empty())
+        return std::string("No ") + getResourceName(res) + " for a page of unknown origin";
+    return "Quota exceeded for " + origin + ": "
+        + boost::lexical_cast<std::string>(used) + " " + getResourceName(res) + " in use, limit is "
+        + boost::lexical_cast<std::string>(limit);
+}
+
+bool FB::ResourceQuota::take(const std::string& origin, Resource res, size_t amount, bool force, std::string* error)
+{
+    if (!amount)
+        return true;
+    std::string message;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        Account& account(m_accounts[origin]);
+        const size_t limit(limitFor(account, res));
+        const size_t used(account.used[res]);
+        // Pages whose origin isn't known would otherwise all share one budget
+        if (force || (!origin.empty() && (!limit || (amount <= limit && used <= limit - amount)))) {
+            account.used[res] += amount;
+            return true;
+        }
+        ++account.rejected[res];
+        message = describe(origin, res, used, limit);
+    }
+    FBLOG_WARN("ResourceQuota", message);
+    if (error)
+        *error = message;
+    return false;
+}
+
+void FB::ResourceQuota::give(const std::string& origin, Resource res, size_t amount)
+{
+    boost::mutex::scoped_lock _l(m_mutex);
+    AccountMap::iterator it(m_accounts.find(origin));
+    if (it == m_accounts.end())
+        return;
+    size_t& used(it->second.used[res]);
+    used -= std::min(used, amount);
+    if (!used)
+        dropIfUnused(it);
+}
+
+FB::ResourceLease::ResourceLease(const ResourceQuotaPtr& quota, const std::string& origin,
+    ResourceQuota::Resource res, size_t amount)
+    : m_quota(quota), m_origin(origin), m_res(res), m_amount(amount)
+{
+}
+
+FB::ResourceLease::~ResourceLease()
+{
+    release();
+}
+
+void FB::ResourceLease::grow(size_t amount)
+{
+    std::string error;
+    if (!m_quota->take(m_origin, m_res, amount, false, &error))
+        throw FB::quota_exceeded(error, m_origin);
+    m_amount += amount;
+}
+
+bool FB::ResourceLease::tryGrow(size_t amount)
+{
+    if (!m_quota->take(m_origin, m_res, amount, false, NULL))
+        return false;
+    m_amount += amount;
+    return true;
+}
+
+void FB::ResourceLease::shrink(size_t amount)
+{
+    amount = std::min(amount, m_amount);
+    m_amount -= amount;
+    m_quota->give(m_origin, m_res, amount);
+}
+
+void FB::ResourceLease::release()
+{
+    if (m_amount)
+        shrink(m_amount);
+}
@@ -0,0 +1,168 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_RESOURCEQUOTA
+#define H_FB_RESOURCEQUOTA
+
+#include <map>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include "FBPointers.h"
+
+namespace FB {
+
+    FB_FORWARD_PTR(ResourceQuota);
+    FB_FORWARD_PTR(ResourceLease);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  ResourceQuota
+    ///
+    /// @brief  Counts what each page origin holds of the resources plugin instances share, and turns
+    ///         down requests past its limits.
+    ///
+    /// Every instance of the plugin in the process uses the same timer thread, HTTP service and so
+    /// on, so one page that starts thousands of timers or streams would starve the others. Usage is
+    /// kept per origin ("scheme://host[:port]", see BrowserHost::getPageOrigin), so several
+    /// instances on pages from one site share a budget and can't get around it by opening more.
+    ///
+    /// Taking a resource returns a ResourceLease, which gives it back when it is destroyed:
+    /// @code
+    ///      FB::ResourceLeasePtr lease(FB::ResourceQuota::instance()->acquire(
+    ///          m_host->getPageOrigin(), FB::ResourceQuota::Streams));
+    ///      // throws FB::quota_exceeded if the page already has as many as it may
+    /// @endcode
+    ///
+    /// BrowserHost counts async calls and streams, Timer::getTimer(host, ...) counts timers, and
+    /// BasicService counts HTTP connections by the request's Origin header.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ResourceQuota : public boost::enable_shared_from_this<ResourceQuota>, boost::noncopyable
+    {
+    public:
+        enum Resource {
+            Timers,
+            Streams,
+            // Calls waiting to run on the main thread
+            AsyncCalls,
+            // Bytes of stream and request buffers
+            BufferBytes,
+            Connections,
+            ResourceCount
+        };
+
+        ResourceQuota();
+
+        // The one shared by every plugin instance in the process
+        static ResourceQuotaPtr instance();
+        static const char* getResourceName(Resource res);
+
+        // A limit of 0 means none. The default limits apply to each origin that has none of its own
+        void setDefaultLimit(Resource res, size_t limit);
+        size_t getDefaultLimit(Resource res) const;
+        void setLimit(const std::string& origin, Resource res, size_t limit);
+        // Puts origin back on the default limits
+        void clearLimits(const std::string& origin);
+        size_t getLimit(const std::string& origin, Resource res) const;
+
+        size_t getUsage(const std::string& origin, Resource res) const;
+        // How many requests from origin have been turned down since it last held nothing
+        size_t getRejectedCount(const std::string& origin, Resource res) const;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn ResourceLeasePtr ResourceQuota::acquire(const std::string& origin, Resource res, size_t amount = 1)
+        ///
+        /// @brief  Takes amount of res for origin
+        ///
+        /// An empty origin, i.e. a page whose origin isn't known, is always turned down.
+        ///
+        /// @exception FB::quota_exceeded if that would put origin over its limit; nothing is taken then
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        ResourceLeasePtr acquire(const std::string& origin, Resource res, size_t amount = 1);
+        // Like acquire, but returns an empty pointer instead of throwing
+        ResourceLeasePtr tryAcquire(const std::string& origin, Resource res, size_t amount = 1);
+        // Counts amount against origin even if that puts it over its limit, for what can't be turned
+        // down (and should still make the next request fail)
+        ResourceLeasePtr charge(const std::string& origin, Resource res, size_t amount = 1);
+
+    private:
+        friend class ResourceLease;
+        struct Account
+        {
+            Account();
+            size_t used[ResourceCount];
+            size_t rejected[ResourceCount];
+            // Only where hasLimit is set; the defaults apply otherwise
+            size_t limit[ResourceCount];
+            bool hasLimit[ResourceCount];
+        };
+        typedef std::map<std::string, Account> AccountMap;
+
+        // With m_mutex held
+        size_t limitFor(const Account& account, Resource res) const;
+        void dropIfUnused(AccountMap::iterator it);
+        std::string describe(const std::string& origin, Resource res, size_t used, size_t limit) const;
+
+        // Returns false (and counts the rejection) if amount doesn't fit and force isn't set
+        bool take(const std::string& origin, Resource res, size_t amount, bool force, std::string* error);
+        void give(const std::string& origin, Resource res, size_t amount);
+
+        mutable boost::mutex m_mutex;
+        size_t m_defaults[ResourceCount];
+        AccountMap m_accounts;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  ResourceLease
+    ///
+    /// @brief  Some amount of one resource held by an origin; it is given back when the lease is
+    ///         destroyed or release() is called.
+    ///
+    /// A lease belongs to whatever holds the resource and isn't meant to be used from several
+    /// threads at once.
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ResourceLease : boost::noncopyable
+    {
+    public:
+        ~ResourceLease();
+
+        const std::string& getOrigin() const { return m_origin; }
+        ResourceQuota::Resource getResource() const { return m_res; }
+        size_t getAmount() const { return m_amount; }
+
+        // For a buffer that grows; throws FB::quota_exceeded, leaving the lease as it was, if the
+        // origin can't have amount more
+        void grow(size_t amount);
+        bool tryGrow(size_t amount);
+        // Gives back part of the lease now
+        void shrink(size_t amount);
+        // Gives back all of it now
+        void release();
+
+    private:
+        friend class ResourceQuota;
+        ResourceLease(const ResourceQuotaPtr& quota, const std::string& origin, ResourceQuota::Resource res,
+            size_t amount);
+
+        ResourceQuotaPtr m_quota;
+        std::string m_origin;
+        ResourceQuota::Resource m_res;
+        size_t m_amount;
+    };
+};
+
+#endif // H_FB_RESOURCEQUOTA
@@ -0,0 +1,126 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <algorithm>
+#include <new>
+#include <ostream>
+#include "SharedString.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+
+namespace {
+    // FNV-1a; the same string always hashes the same, in every process
+    size_t hashChars(const char* str, size_t length)
+    {
+        size_t hash = sizeof(size_t) > 4 ? static_cast<size_t>(14695981039346656037ULL) : 2166136261U;
+        const size_t prime = sizeof(size_t) > 4 ? static_cast<size_t>(1099511628211ULL) : 16777619U;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(str[i]);
+            hash *= prime;
+        }
+        return hash;
+    }
+}
+
+const size_t FB::SharedString::InlineCapacity;
+
+FB::SharedString::SharedString()
+{
+    init("", 0);
+}
+
+FB::SharedString::SharedString(const char* str)
+{
+    init(str, str ? std::strlen(str) : 0);
+}
+
+FB::SharedString::SharedString(const char* str, size_t length)
+{
+    init(str, length);
+}
+
+FB::SharedString::SharedString(const std::string& str)
+{
+    init(str.data(), str.size());
+}
+
+FB::SharedString::SharedString(const SharedString& rh)
+    : m_length(rh.m_length), m_hash(rh.m_hash)
+{
+    if (isInline()) {
+        std::memcpy(m_inline, rh.m_inline, m_length + 1);
+    } else {
+        m_rep = rh.m_rep;
+        ++m_rep->refs;
+    }
+}
+
+FB::SharedString::~SharedString()
+{
+    if (!isInline() && --m_rep->refs == 0) {
+        m_rep->~Rep();
+        ::operator delete(m_rep);
+    }
+}
+
+void FB::SharedString::init(const char* str, size_t length)
+{
+    m_length = length;
+    m_hash = hashChars(str, length);
+    char* dest;
+    if (isInline()) {
+        dest = m_inline;
+    } else {
+        m_rep = new (::operator new(sizeof(Rep) + length)) Rep();
+        dest = m_rep->chars;
+    }
+    if (length)
+        std::memcpy(dest, str, length);
+    dest[length] = '\0';
+}
+
+FB::SharedString& FB::SharedString::operator=(const SharedString& rh)
+{
+    SharedString tmp(rh);
+    swap(tmp);
+    return *this;
+}
+
+void FB::SharedString::swap(SharedString& rh)
+{
+    // Bytes rather than members, since which member of the union is in use depends on the length
+    char tmp[sizeof(SharedString)];
+    std::memcpy(tmp, this, sizeof(SharedString));
+    std::memcpy(static_cast<void*>(this), &rh, sizeof(SharedString));
+    std::memcpy(static_cast<void*>(&rh), tmp, sizeof(SharedString));
+}
+
+int FB::SharedString::compare(const SharedString& rh) const
+{
+    if (!isInline() && m_length == rh.m_length && m_rep == rh.m_rep)
+        return 0;
+    return compare(rh.c_str(), rh.m_length);
+}
+
+int FB::SharedString::compare(const char* rh, size_t length) const
+{
+    int res = std::memcmp(c_str(), rh, std::min(m_length, length));
+    if (res != 0)
+        return res;
+    return m_length < length ? -1 : (m_length > length ? 1 : 0);
+}
+
+std::ostream& FB::operator<<(std::ostream& os, const SharedString& str)
+{
+    return os.write(str.c_str(), str.length());
+}
@@ -0,0 +1,126 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_SHAREDSTRING
+#define H_FB_SHAREDSTRING
+
+#include <cstddef>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <boost/detail/atomic_count.hpp>
+
+namespace FB {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  SharedString
+    ///
+    /// @brief  An immutable UTF8 string that is cheap to copy: short strings are kept inline, and
+    ///         longer ones are shared between copies with an atomic reference count.
+    ///
+    /// The hash is worked out once, when the string is made, so SharedStrings make good keys for
+    /// hashed containers (see hash_value). FB::variant stores them as they are, so passing one
+    /// through a VariantList, a cross thread call or an event never copies the characters, and
+    /// convert_cast<std::string>() still works on it:
+    /// @code
+    ///      static const FB::SharedString status("downloading");
+    ///      FireEvent("onstatus", FB::variant_list_of(status)(percent));
+    /// @endcode
+    ///
+    /// A SharedString can be read from any thread; it can't be changed once made, only replaced.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class SharedString
+    {
+    public:
+        typedef char value_type;
+
+        SharedString();
+        SharedString(const char* str);
+        SharedString(const char* str, size_t length);
+        SharedString(const std::string& str);
+        SharedString(const SharedString& rh);
+        ~SharedString();
+
+        SharedString& operator=(const SharedString& rh);
+        void swap(SharedString& rh);
+
+        // Always null-terminated
+        const char* c_str() const { return isInline() ? m_inline : m_rep->chars; }
+        const char* data() const { return c_str(); }
+        size_t length() const { return m_length; }
+        size_t size() const { return m_length; }
+        bool empty() const { return m_length == 0; }
+        size_t hash() const { return m_hash; }
+
+        std::string str() const { return std::string(c_str(), m_length); }
+
+        int compare(const SharedString& rh) const;
+        int compare(const char* rh, size_t length) const;
+
+        // Whether the characters are shared with other copies rather than held inline; mostly
+        // for tests
+        bool isShared() const { return !isInline(); }
+
+    public:
+        // Strings up to this long are kept inline and never allocate
+        static const size_t InlineCapacity = 15;
+
+    private:
+        struct Rep
+        {
+            boost::detail::atomic_count refs;
+            char chars[1];
+
+            Rep() : refs(1) { }
+        };
+
+        void init(const char* str, size_t length);
+        bool isInline() const { return m_length <= InlineCapacity; }
+
+        union {
+            char m_inline[InlineCapacity + 1];
+            Rep* m_rep;
+        };
+        size_t m_length;
+        size_t m_hash;
+    };
+
+    inline bool operator==(const SharedString& lh, const SharedString& rh) {
+        return lh.hash() == rh.hash() && lh.compare(rh) == 0;
+    }
+    inline bool operator!=(const SharedString& lh, const SharedString& rh) { return !(lh == rh); }
+    inline bool operator<(const SharedString& lh, const SharedString& rh) { return lh.compare(rh) < 0; }
+
+    inline bool operator==(const SharedString& lh, const std::string& rh) {
+        return lh.compare(rh.data(), rh.size()) == 0;
+    }
+    inline bool operator==(const std::string& lh, const SharedString& rh) { return rh == lh; }
+    inline bool operator!=(const SharedString& lh, const std::string& rh) { return !(lh == rh); }
+    inline bool operator!=(const std::string& lh, const SharedString& rh) { return !(rh == lh); }
+
+    inline bool operator==(const SharedString& lh, const char* rh) {
+        return lh.compare(rh, std::strlen(rh)) == 0;
+    }
+    inline bool operator!=(const SharedString& lh, const char* rh) { return !(lh == rh); }
+
+    // For boost::hash, and so boost::unordered_map
+    inline size_t hash_value(const SharedString& str) { return str.hash(); }
+
+    std::ostream& operator<<(std::ostream& os, const SharedString& str);
+};
+
+#endif // H_FB_SHAREDSTRING
@@ -40,6 +40,13 @@ const FB::variant& FB::variant_detail::conversion::convert_variant(const FB::var
     return var;
 }
 
+const FB::SharedString FB::variant_detail::conversion::convert_variant(const FB::variant& var, const type_spec<FB::SharedString>)
+{
+    if (var.is_of_type<FB::SharedString>())
+        return var.cast<FB::SharedString>();
+    return FB::SharedString(var.convert_cast<std::string>());
+}
+
 const FB::FBNull FB::variant_detail::conversion::convert_variant( const FB::variant&, const type_spec<FB::FBNull> )
 {
     return FB::FBNull();
@@ -43,6 +43,8 @@ Copyright 2008-2012 Richard Bateman, Firebreath development team
 #include <boost/logic/tribool.hpp>
 
 #include "APITypes.h"
+#include "Blob.h"
+#include "SharedString.h"
 #include "Util/meta_util.h"
 #include "utf8_tools.h"
 #include "variant_conversions.h"
@@ -97,7 +99,7 @@ Copyright 2008-2012 Richard Bateman, Firebreath development team
 #define FB_CONVERT_ENTRY_FROM_STRING(_type_, _srctype_) \
     if (*type == typeid(_srctype_)) { \
         typedef _srctype_::value_type char_type; \
-        std::basic_istringstream<char_type> iss(var.cast<_srctype_>()); \
+        std::basic_istringstream<char_type> iss(FB::variant_detail::stream_string(var.cast<_srctype_>())); \
         _type_ to; \
         if (iss >> to) { \
             return to; \
@@ -117,6 +119,8 @@ Copyright 2008-2012 Richard Bateman, Firebreath development team
         } \
     } else
 
+#define FB_CONVERT_ENTRY_FROM_SHARED_STRING(_type_) FB_CONVERT_ENTRY_FROM_STRING(_type_, FB::SharedString)
+
 #define FB_CONVERT_ENTRY_TO_STRING(_srctype_)  FB_CONVERT_ENTRY_FROM_STRING_TYPE(std::string , _srctype_)
 #define FB_CONVERT_ENTRY_TO_WSTRING(_srctype_) FB_CONVERT_ENTRY_FROM_STRING_TYPE(std::wstring, _srctype_)
 
@@ -154,6 +158,11 @@ namespace FB
             }
         };
 
+        // What FB_CONVERT_ENTRY_FROM_STRING reads a value from
+        template<typename S>
+        const S& stream_string(const S& str) { return str; }
+        inline std::string stream_string(const FB::SharedString& str) { return str.str(); }
+
         template<typename T>
         struct lessthan {
             static bool impl(const boost::any& l, const boost::any& r) {
@@ -194,6 +203,9 @@ namespace FB
     ///       the assignment.
     /// @note If you assign a wchar_t* to variant it will be automatically converted to a std::wstring
     ///       before the assignment
+    /// @note A FB::SharedString is kept as it is, so copying the variant doesn't copy the string;
+    ///       convert_cast<std::string>() and the other string conversions accept it too.
+    /// @note A FB::Blob is kept as it is too; it holds binary data and isn't converted to anything.
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     class variant
     {
@@ -434,8 +446,11 @@ namespace FB
 
     template <>
     inline const std::string variant::convert_cast<std::string>() const {
-        variant var = *this;
+        const variant& var = *this;
         FB_BEGIN_CONVERT_MAP(std::string);
+        FB_CONVERT_ENTRY_COMPLEX_BEGIN(FB::SharedString, str);
+        return str.str();
+        FB_CONVERT_ENTRY_COMPLEX_END();
         FB_CONVERT_ENTRY_TO_STRING(double);
         FB_CONVERT_ENTRY_TO_STRING(float);
         FB_CONVERT_ENTRY_TO_STRING(int);
@@ -459,7 +474,7 @@ namespace FB
 
     template<>
     inline const std::wstring variant::convert_cast<std::wstring>() const {
-        variant var = *this;
+        const variant& var = *this;
         FB_BEGIN_CONVERT_MAP(std::wstring);
         FB_CONVERT_ENTRY_TO_WSTRING(double);
         FB_CONVERT_ENTRY_TO_WSTRING(float);
@@ -471,6 +486,9 @@ namespace FB
         FB_CONVERT_ENTRY_COMPLEX_BEGIN(std::string, str);
         return utf8_to_wstring(str);
         FB_CONVERT_ENTRY_COMPLEX_END();
+        FB_CONVERT_ENTRY_COMPLEX_BEGIN(FB::SharedString, str);
+        return utf8_to_wstring(str.str());
+        FB_CONVERT_ENTRY_COMPLEX_END();
         FB_CONVERT_ENTRY_TO_WSTRING(long);
         FB_CONVERT_ENTRY_TO_WSTRING(unsigned long);
         FB_CONVERT_ENTRY_TO_WSTRING(short);
@@ -482,12 +500,15 @@ namespace FB
     
     template<>
     inline const bool variant::convert_cast<bool>() const {
-        variant var = *this;
+        const variant& var = *this;
         FB_BEGIN_CONVERT_MAP(bool);
         FB_CONVERT_ENTRY_COMPLEX_BEGIN(std::string, str);
         std::transform(str.begin(), str.end(), str.begin(), ::tolower); 
         return (str == "y" || str == "1" || str == "yes" || str == "true" || str == "t");
         FB_CONVERT_ENTRY_COMPLEX_END();
+        FB_CONVERT_ENTRY_COMPLEX_BEGIN(FB::SharedString, sstr);
+        return variant(sstr.str(), true).convert_cast<bool>();
+        FB_CONVERT_ENTRY_COMPLEX_END();
         FB_CONVERT_ENTRY_COMPLEX_BEGIN(std::wstring, str);
         std::transform(str.begin(), str.end(), str.begin(), ::tolower); 
         return (str == L"y" || str == L"1" || str == L"yes" || str == L"true" || str == L"t");
@@ -540,6 +561,14 @@ namespace FB
             inline variant make_variant(const FB::JSAPIWeakPtr& ptr) {
                 return variant(ptr, true);
             }
+
+            inline variant make_variant(const FB::SharedString& str) {
+                return variant(str, true);
+            }
+
+            inline variant make_variant(const FB::Blob& blob) {
+                return variant(blob, true);
+            }
             
             variant make_variant(const boost::tribool& val);
             boost::tribool convert_variant( const FB::variant& var, const type_spec<boost::tribool>& );
@@ -628,6 +657,7 @@ namespace FB
             const FB::FBNull convert_variant(const variant&, const type_spec<FBNull>);
             const FB::FBVoid convert_variant(const variant&, const type_spec<FBVoid>);
             const variant& convert_variant(const variant& var, const type_spec<variant>);
+            const FB::SharedString convert_variant(const variant& var, const type_spec<FB::SharedString>);
             
             template<typename T>
             boost::optional<T> convert_variant(const variant& var, const type_spec<boost::optional<T> >) {
@@ -659,6 +689,7 @@ namespace FB
                 FB_CONVERT_ENTRY_COMPLEX_END();
                 FB_CONVERT_ENTRY_FROM_STRING(T, std::string)
                 FB_CONVERT_ENTRY_FROM_WSTRING(T, std::wstring)
+                FB_CONVERT_ENTRY_FROM_SHARED_STRING(T)
                 FB_END_CONVERT_MAP(T)
             }
         }
@@ -690,6 +721,7 @@ namespace FB
 #undef FB_CONVERT_ENTRY_TO_STRING
 #undef FB_CONVERT_ENTRY_TO_WSTRING
 #undef FB_CONVERT_ENTRY_FROM_STRING
+#undef FB_CONVERT_ENTRY_FROM_SHARED_STRING
 #undef FB_CONVERT_ENTRY_FROM_STRING_TYPE
 #undef FB_CONVERT_ENTRY_COMPLEX_BEGIN
 #undef FB_CONVERT_ENTRY_COMPLEX_END
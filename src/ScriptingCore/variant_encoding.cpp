@@ -0,0 +1,970 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include "variant_encoding.h"
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+
+namespace {
+    const char encodingMagic[] = { 'F', 'B', 'V' };
+    const size_t headerSize = sizeof(encodingMagic) + 1;
+
+    enum Tag {
+        Tag_Undefined = 0,
+        Tag_Null,
+        Tag_False,
+        Tag_True,
+        Tag_Int32,
+        Tag_Int64,
+        Tag_UInt32,
+        Tag_UInt64,
+        Tag_Double,
+        Tag_String,
+        Tag_Blob,
+        Tag_List,
+        Tag_Map,
+        // 0x80 | n for an Int32 from 0 to 127
+        Tag_SmallInt = 0x80
+    };
+
+    // Keys past this many are written out in full each time, so a map with made up keys can't
+    // grow the table without bound
+    const size_t MaxKeys = 4096;
+
+    boost::uint64_t zigzag(boost::int64_t value)
+    {
+        return (static_cast<boost::uint64_t>(value) << 1) ^ static_cast<boost::uint64_t>(value >> 63);
+    }
+
+    boost::int64_t unzigzag(boost::uint64_t value)
+    {
+        return static_cast<boost::int64_t>(value >> 1) ^ -static_cast<boost::int64_t>(value & 1);
+    }
+
+    void malformed(const char* why)
+    {
+        throw FB::variant_encoding_error(std::string("Malformed encoded variant: ") + why);
+    }
+}
+
+const int FB::VariantWriter::Version;
+const size_t FB::VariantReader::MaxDepth;
+
+FB::VariantWriter::VariantWriter(std::string& out)
+    : m_out(out)
+{
+    m_out.append(encodingMagic, sizeof(encodingMagic));
+    m_out += static_cast<char>(Version);
+}
+
+void FB::VariantWriter::write(const variant& value)
+{
+    // Most common first.  Containers and strings are looked at where they are, not copied out
+    const std::type_info& type(value.get_type());
+    if (type == typeid(std::string)) {
+        writeString(value.cast<const std::string&>());
+    } else if (type == typeid(int)) {
+        writeInt32(value.cast<int>());
+    } else if (type == typeid(double)) {
+        writeDouble(value.cast<double>());
+    } else if (type == typeid(bool)) {
+        writeBool(value.cast<bool>());
+    } else if (type == typeid(FB::VariantMap)) {
+        const FB::VariantMap& map(value.cast<const FB::VariantMap&>());
+        beginMap(map.size());
+        for (FB::VariantMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+            writeKey(it->first);
+            write(it->second);
+        }
+    } else if (type == typeid(FB::VariantList)) {
+        const FB::VariantList& list(value.cast<const FB::VariantList&>());
+        beginList(list.size());
+        for (FB::VariantList::const_iterator it = list.begin(); it != list.end(); ++it)
+            write(*it);
+    } else if (type == typeid(FB::SharedString)) {
+        const FB::SharedString& str(value.cast<const FB::SharedString&>());
+        writeString(str.data(), str.size());
+    } else if (type == typeid(FB::Blob)) {
+        const FB::Blob& blob(value.cast<const FB::Blob&>());
+        writeBlob(blob.data(), blob.size());
+    } else if (value.is_null()) {
+        writeNull();
+    } else if (value.empty()) {
+        writeUndefined();
+    } else if (type == typeid(std::wstring)) {
+        writeString(FB::wstring_to_utf8(value.cast<const std::wstring&>()));
+    } else if (type == typeid(long)) {
+        if (sizeof(long) > 4)
+            writeInt64(value.cast<long>());
+        else
+            writeInt32(static_cast<boost::int32_t>(value.cast<long>()));
+    } else if (type == typeid(unsigned long)) {
+        if (sizeof(unsigned long) > 4)
+            writeUInt64(value.cast<unsigned long>());
+        else
+            writeUInt32(static_cast<boost::uint32_t>(value.cast<unsigned long>()));
+    } else if (type == typeid(long long)) {
+        writeInt64(value.cast<long long>());
+    } else if (type == typeid(unsigned long long)) {
+        writeUInt64(value.cast<unsigned long long>());
+    } else if (type == typeid(unsigned int)) {
+        writeUInt32(value.cast<unsigned int>());
+    } else if (type == typeid(short) || type == typeid(char) || type == typeid(signed char)) {
+        writeInt32(value.convert_cast<int>());
+    } else if (type == typeid(unsigned short) || type == typeid(unsigned char)) {
+        writeUInt32(value.convert_cast<unsigned int>());
+    } else if (type == typeid(float)) {
+        writeDouble(value.cast<float>());
+    } else {
+        throw variant_encoding_error(std::string("Can't encode a variant holding ") + type.name());
+    }
+}
+
+void FB::VariantWriter::writeUndefined()
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_Undefined);
+    endValue();
+}
+
+void FB::VariantWriter::writeNull()
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_Null);
+    endValue();
+}
+
+void FB::VariantWriter::writeBool(bool value)
+{
+    beginValue();
+    m_out += static_cast<char>(value ? Tag_True : Tag_False);
+    endValue();
+}
+
+void FB::VariantWriter::writeInt32(boost::int32_t value)
+{
+    beginValue();
+    if (value >= 0 && value < 0x80) {
+        m_out += static_cast<char>(Tag_SmallInt | value);
+    } else {
+        m_out += static_cast<char>(Tag_Int32);
+        putVarint(zigzag(value));
+    }
+    endValue();
+}
+
+void FB::VariantWriter::writeInt64(boost::int64_t value)
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_Int64);
+    putVarint(zigzag(value));
+    endValue();
+}
+
+void FB::VariantWriter::writeUInt32(boost::uint32_t value)
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_UInt32);
+    putVarint(value);
+    endValue();
+}
+
+void FB::VariantWriter::writeUInt64(boost::uint64_t value)
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_UInt64);
+    putVarint(value);
+    endValue();
+}
+
+void FB::VariantWriter::writeDouble(double value)
+{
+    beginValue();
+    boost::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    char buf[9];
+    buf[0] = static_cast<char>(Tag_Double);
+    for (int i = 0; i < 8; ++i)
+        buf[i + 1] = static_cast<char>((bits >> (i * 8)) & 0xff);
+    m_out.append(buf, sizeof(buf));
+    endValue();
+}
+
+void FB::VariantWriter::writeString(const char* str, size_t length)
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_String);
+    putVarint(length);
+    m_out.append(str, length);
+    endValue();
+}
+
+void FB::VariantWriter::writeBlob(const void* data, size_t size)
+{
+    beginValue();
+    m_out += static_cast<char>(Tag_Blob);
+    putVarint(size);
+    m_out.append(static_cast<const char*>(data), size);
+    endValue();
+}
+
+void FB::VariantWriter::beginList(size_t count)
+{
+    beginContainer(false, count);
+}
+
+void FB::VariantWriter::beginMap(size_t count)
+{
+    beginContainer(true, count);
+}
+
+void FB::VariantWriter::writeKey(const char* key, size_t length)
+{
+    if (m_open.empty() || !m_open.back().isMap || m_open.back().haveKey)
+        throw variant_encoding_error("A key can only be written where a map expects one");
+    m_open.back().haveKey = true;
+
+    m_key.assign(key, length);
+    boost::unordered_map<std::string, boost::uint32_t>::const_iterator it = m_keys.find(m_key);
+    if (it != m_keys.end()) {
+        putVarint((static_cast<boost::uint64_t>(it->second) << 1) | 1);
+        return;
+    }
+    putVarint(static_cast<boost::uint64_t>(length) << 1);
+    m_out.append(key, length);
+    if (m_keys.size() < MaxKeys) {
+        const boost::uint32_t index = static_cast<boost::uint32_t>(m_keys.size());
+        m_keys[m_key] = index;
+    }
+}
+
+void FB::VariantWriter::beginValue()
+{
+    if (m_open.empty())
+        return;
+    Container& top(m_open.back());
+    if (top.isMap && !top.haveKey)
+        throw variant_encoding_error("A map entry needs its key written first");
+    top.haveKey = false;
+    --top.remaining;
+}
+
+void FB::VariantWriter::endValue()
+{
+    // Closes every container this value was the last thing in
+    while (!m_open.empty() && m_open.back().remaining == 0)
+        m_open.pop_back();
+}
+
+void FB::VariantWriter::beginContainer(bool isMap, size_t count)
+{
+    if (m_open.size() >= VariantReader::MaxDepth)
+        throw variant_encoding_error("Lists and maps are nested too deeply to encode");
+    beginValue();
+    m_out += static_cast<char>(isMap ? Tag_Map : Tag_List);
+    putVarint(count);
+    Container container = { isMap, false, count };
+    m_open.push_back(container);
+    endValue();
+}
+
+void FB::VariantWriter::putVarint(boost::uint64_t value)
+{
+    char buf[10];
+    size_t len = 0;
+    do {
+        char byte = static_cast<char>(value & 0x7f);
+        value >>= 7;
+        buf[len++] = value ? static_cast<char>(byte | 0x80) : byte;
+    } while (value);
+    m_out.append(buf, len);
+}
+
+FB::VariantReader::VariantReader(const char* data, size_t size)
+    : m_pos(data), m_end(data + size), m_token(Token_End), m_int(0), m_double(0), m_data(NULL), m_size(0)
+{
+    readHeader();
+}
+
+FB::VariantReader::VariantReader(const std::string& data)
+    : m_pos(data.data()), m_end(data.data() + data.size()), m_token(Token_End), m_int(0), m_double(0),
+    m_data(NULL), m_size(0)
+{
+    readHeader();
+}
+
+FB::VariantReader::VariantReader(const boost::shared_ptr<const std::string>& data)
+    : m_pos(data->data()), m_end(data->data() + data->size()), m_owner(data), m_token(Token_End), m_int(0),
+    m_double(0), m_data(NULL), m_size(0)
+{
+    readHeader();
+}
+
+FB::VariantReader::VariantReader(const char* data, size_t size, const boost::shared_ptr<const void>& owner)
+    : m_pos(data), m_end(data + size), m_owner(owner), m_token(Token_End), m_int(0), m_double(0), m_data(NULL),
+    m_size(0)
+{
+    readHeader();
+}
+
+FB::variant FB::VariantReader::read()
+{
+    Token token = next();
+    if (token == Token_End || token == Token_EndList || token == Token_EndMap || token == Token_Key)
+        throw variant_encoding_error("There is no value to read here");
+    variant value;
+    readValue(value);
+    return value;
+}
+
+void FB::VariantReader::skip()
+{
+    Token token = next();
+    if (token == Token_End || token == Token_EndList || token == Token_EndMap || token == Token_Key)
+        throw variant_encoding_error("There is no value to skip here");
+    const size_t depth = m_open.size();
+    if (token == Token_BeginList || token == Token_BeginMap) {
+        while (m_open.size() >= depth)
+            next();
+    }
+}
+
+FB::VariantReader::Token FB::VariantReader::next()
+{
+    if (!m_open.empty()) {
+        Container& top(m_open.back());
+        if (top.remaining == 0) {
+            m_token = top.isMap ? Token_EndMap : Token_EndList;
+            m_open.pop_back();
+            return m_token;
+        }
+        if (top.isMap && !top.haveKey) {
+            readKey();
+            top.haveKey = true;
+            return m_token = Token_Key;
+        }
+        top.haveKey = false;
+        --top.remaining;
+    } else if (m_pos == m_end) {
+        return m_token = Token_End;
+    }
+
+    const unsigned char tag = readByte();
+    if (tag & Tag_SmallInt) {
+        m_int = tag & 0x7f;
+        return m_token = Token_Int32;
+    }
+    switch (tag) {
+    case Tag_Undefined:
+        m_token = Token_Undefined;
+        break;
+    case Tag_Null:
+        m_token = Token_Null;
+        break;
+    case Tag_False:
+    case Tag_True:
+        m_int = tag == Tag_True ? 1 : 0;
+        m_token = Token_Bool;
+        break;
+    case Tag_Int32:
+        m_int = unzigzag(readVarint());
+        if (m_int < (std::numeric_limits<boost::int32_t>::min)() || m_int > (std::numeric_limits<boost::int32_t>::max)())
+            malformed("32 bit integer out of range");
+        m_token = Token_Int32;
+        break;
+    case Tag_Int64:
+        m_int = unzigzag(readVarint());
+        m_token = Token_Int64;
+        break;
+    case Tag_UInt32: {
+        boost::uint64_t value = readVarint();
+        if (value > (std::numeric_limits<boost::uint32_t>::max)())
+            malformed("32 bit integer out of range");
+        m_int = static_cast<boost::int64_t>(value);
+        m_token = Token_UInt32;
+        break; }
+    case Tag_UInt64:
+        m_int = static_cast<boost::int64_t>(readVarint());
+        m_token = Token_UInt64;
+        break;
+    case Tag_Double: {
+        const char* bytes = readBytes(8);
+        boost::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+            bits |= static_cast<boost::uint64_t>(static_cast<unsigned char>(bytes[i])) << (i * 8);
+        std::memcpy(&m_double, &bits, sizeof(bits));
+        m_token = Token_Double;
+        break; }
+    case Tag_String:
+    case Tag_Blob: {
+        boost::uint64_t length = readVarint();
+        if (length > static_cast<boost::uint64_t>(m_end - m_pos))
+            malformed("truncated");
+        m_size = static_cast<size_t>(length);
+        m_data = readBytes(m_size);
+        m_token = tag == Tag_String ? Token_String : Token_Blob;
+        break; }
+    case Tag_List:
+    case Tag_Map:
+        beginContainer(tag == Tag_Map);
+        break;
+    default:
+        malformed("unknown tag");
+    }
+    return m_token;
+}
+
+void FB::VariantReader::readHeader()
+{
+    if (static_cast<size_t>(m_end - m_pos) < headerSize || std::memcmp(m_pos, encodingMagic, sizeof(encodingMagic)) != 0)
+        throw variant_encoding_error("Not an encoded variant");
+    const int version = static_cast<unsigned char>(m_pos[sizeof(encodingMagic)]);
+    if (version > VariantWriter::Version)
+        throw variant_encoding_error("Encoded variant is from a newer version");
+    if (version < 1)
+        malformed("bad version");
+    m_pos += headerSize;
+}
+
+void FB::VariantReader::readValue(variant& value)
+{
+    switch (m_token) {
+    case Token_Null:
+        value.assign(FB::FBNull(), true);
+        break;
+    case Token_Bool:
+        value.assign(m_int != 0, true);
+        break;
+    case Token_Int32:
+        value.assign(static_cast<int>(m_int), true);
+        break;
+    case Token_Int64:
+        value.assign(static_cast<boost::int64_t>(m_int), true);
+        break;
+    case Token_UInt32:
+        value.assign(static_cast<unsigned int>(m_int), true);
+        break;
+    case Token_UInt64:
+        value.assign(static_cast<boost::uint64_t>(m_int), true);
+        break;
+    case Token_Double:
+        value.assign(m_double, true);
+        break;
+    case Token_String:
+        value.assign(std::string(m_data, m_size), true);
+        break;
+    case Token_Blob:
+        if (m_owner)
+            value.assign(FB::Blob(m_data, m_size, m_owner), true);
+        else
+            value.assign(FB::Blob(m_data, m_size), true);
+        break;
+    case Token_BeginList: {
+        // Filled in where it is, so nested containers aren't copied on the way back up
+        value.assign(FB::VariantList(), true);
+        FB::VariantList& list(const_cast<FB::VariantList&>(value.cast<const FB::VariantList&>()));
+        list.resize(m_size);
+        for (FB::VariantList::iterator it = list.begin(); next() != Token_EndList; ++it)
+            readValue(*it);
+        break; }
+    case Token_BeginMap: {
+        value.assign(FB::VariantMap(), true);
+        FB::VariantMap& map(const_cast<FB::VariantMap&>(value.cast<const FB::VariantMap&>()));
+        while (next() == Token_Key) {
+            // Keys from a VariantMap arrive in order, so each goes in at the end
+            FB::VariantMap::iterator it = map.insert(map.end(), std::make_pair(std::string(m_data, m_size), variant()));
+            next();
+            readValue(it->second);
+        }
+        break; }
+    default:
+        value.reset();
+        break;
+    }
+}
+
+unsigned char FB::VariantReader::readByte()
+{
+    if (m_pos == m_end)
+        malformed("truncated");
+    return static_cast<unsigned char>(*m_pos++);
+}
+
+boost::uint64_t FB::VariantReader::readVarint()
+{
+    boost::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char byte = readByte();
+        value |= static_cast<boost::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    malformed("integer too long");
+    return 0;
+}
+
+const char* FB::VariantReader::readBytes(size_t length)
+{
+    if (length > static_cast<size_t>(m_end - m_pos))
+        malformed("truncated");
+    const char* bytes = m_pos;
+    m_pos += length;
+    return bytes;
+}
+
+void FB::VariantReader::readKey()
+{
+    boost::uint64_t key = readVarint();
+    if (key & 1) {
+        boost::uint64_t index = key >> 1;
+        if (index >= m_keys.size())
+            malformed("unknown key");
+        m_data = m_keys[static_cast<size_t>(index)].first;
+        m_size = m_keys[static_cast<size_t>(index)].second;
+        return;
+    }
+    boost::uint64_t length = key >> 1;
+    if (length > static_cast<boost::uint64_t>(m_end - m_pos))
+        malformed("truncated");
+    m_size = static_cast<size_t>(length);
+    m_data = readBytes(m_size);
+    if (m_keys.size() < MaxKeys)
+        m_keys.push_back(std::make_pair(m_data, m_size));
+}
+
+void FB::VariantReader::beginContainer(bool isMap)
+{
+    if (m_open.size() >= MaxDepth)
+        malformed("nested too deeply");
+    boost::uint64_t count = readVarint();
+    // Every value takes at least a byte, and every map entry two, so the count can be checked
+    // before anything is allocated for it
+    if (count > static_cast<boost::uint64_t>(m_end - m_pos) / (isMap ? 2 : 1))
+        malformed("truncated");
+    Container container = { isMap, false, static_cast<size_t>(count) };
+    m_open.push_back(container);
+    m_size = container.remaining;
+    m_token = isMap ? Token_BeginMap : Token_BeginList;
+}
+
+std::string FB::encodeVariant(const variant& value)
+{
+    std::string out;
+    VariantWriter writer(out);
+    writer.write(value);
+    return out;
+}
+
+FB::variant FB::decodeVariant(const std::string& data)
+{
+    return decodeVariant(data.data(), data.size());
+}
+
+FB::variant FB::decodeVariant(const char* data, size_t size)
+{
+    VariantReader reader(data, size);
+    variant value(reader.read());
+    if (!reader.atEnd())
+        throw variant_encoding_error("Encoded variant has more than one value");
+    return value;
+}
+
+namespace {
+    void appendJSONString(std::string& out, const char* str, size_t length)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out += '"';
+        for (size_t i = 0; i < length; ++i) {
+            unsigned char c = static_cast<unsigned char>(str[i]);
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xf];
+                } else {
+                    out += static_cast<char>(c);
+                }
+            }
+        }
+        out += '"';
+    }
+
+    // Written out by hand; a stream for each number costs more than the rest of the encoding
+    template <typename T>
+    void appendJSONInteger(std::string& out, T value)
+    {
+        char buf[24];
+        char* end = buf + sizeof(buf);
+        char* pos = end;
+        bool negative = value < static_cast<T>(0);
+        do {
+            int digit = static_cast<int>(value % 10);
+            *--pos = static_cast<char>('0' + (negative ? -digit : digit));
+            value /= 10;
+        } while (value != 0);
+        if (negative)
+            *--pos = '-';
+        out.append(pos, end);
+    }
+
+    void appendJSONDouble(std::string& out, double value)
+    {
+        if (value != value || value == std::numeric_limits<double>::infinity()
+                || value == -std::numeric_limits<double>::infinity()) {
+            out += "null";
+            return;
+        }
+        char buf[32];
+#ifdef _WIN32
+        _snprintf(buf, sizeof(buf), "%.17g", value);
+#else
+        snprintf(buf, sizeof(buf), "%.17g", value);
+#endif
+        buf[sizeof(buf) - 1] = 0;
+        // A decimal comma from the C locale would break the syntax
+        for (char* p = buf; *p; ++p) {
+            if (*p == ',')
+                *p = '.';
+        }
+        out += buf;
+    }
+
+    void appendJSON(std::string& out, const FB::variant& value, FB::UnencodableJSON unencodable, size_t depth)
+    {
+        if (depth > FB::VariantReader::MaxDepth)
+            throw FB::variant_encoding_error("Can't encode a variant nested that deeply as JSON");
+        const std::type_info& type(value.get_type());
+        if (type == typeid(std::string)) {
+            const std::string& str(value.cast<const std::string&>());
+            appendJSONString(out, str.data(), str.size());
+        } else if (type == typeid(int)) {
+            appendJSONInteger(out, value.cast<int>());
+        } else if (type == typeid(double)) {
+            appendJSONDouble(out, value.cast<double>());
+        } else if (type == typeid(bool)) {
+            out += value.cast<bool>() ? "true" : "false";
+        } else if (type == typeid(FB::VariantMap)) {
+            const FB::VariantMap& map(value.cast<const FB::VariantMap&>());
+            out += '{';
+            for (FB::VariantMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+                if (it != map.begin())
+                    out += ',';
+                appendJSONString(out, it->first.data(), it->first.size());
+                out += ':';
+                appendJSON(out, it->second, unencodable, depth + 1);
+            }
+            out += '}';
+        } else if (type == typeid(FB::VariantList)) {
+            const FB::VariantList& list(value.cast<const FB::VariantList&>());
+            out += '[';
+            for (FB::VariantList::const_iterator it = list.begin(); it != list.end(); ++it) {
+                if (it != list.begin())
+                    out += ',';
+                appendJSON(out, *it, unencodable, depth + 1);
+            }
+            out += ']';
+        } else if (type == typeid(FB::SharedString)) {
+            const FB::SharedString& str(value.cast<const FB::SharedString&>());
+            appendJSONString(out, str.data(), str.size());
+        } else if (value.is_null() || value.empty()) {
+            out += "null";
+        } else if (type == typeid(std::wstring)) {
+            const std::string str(FB::wstring_to_utf8(value.cast<const std::wstring&>()));
+            appendJSONString(out, str.data(), str.size());
+        } else if (type == typeid(long)) {
+            appendJSONInteger(out, value.cast<long>());
+        } else if (type == typeid(unsigned long)) {
+            appendJSONInteger(out, value.cast<unsigned long>());
+        } else if (type == typeid(long long)) {
+            appendJSONInteger(out, value.cast<long long>());
+        } else if (type == typeid(unsigned long long)) {
+            appendJSONInteger(out, value.cast<unsigned long long>());
+        } else if (type == typeid(unsigned int)) {
+            appendJSONInteger(out, value.cast<unsigned int>());
+        } else if (type == typeid(short) || type == typeid(char) || type == typeid(signed char)) {
+            appendJSONInteger(out, value.convert_cast<int>());
+        } else if (type == typeid(unsigned short) || type == typeid(unsigned char)) {
+            appendJSONInteger(out, value.convert_cast<unsigned int>());
+        } else if (type == typeid(float)) {
+            appendJSONDouble(out, value.cast<float>());
+        } else if (unencodable == FB::UnencodableJSONAsNull) {
+            out += "null";
+        } else {
+            throw FB::variant_encoding_error(std::string("Can't encode a variant holding ") + type.name() + " as JSON");
+        }
+    }
+
+    void malformedJSON(const char* why)
+    {
+        throw FB::variant_encoding_error(std::string("Malformed JSON: ") + why);
+    }
+
+    class JSONParser
+    {
+    public:
+        JSONParser(const char* begin, const char* end) : m_pos(begin), m_end(end) { }
+
+        FB::variant parse()
+        {
+            FB::variant value(parseValue(0));
+            skipSpace();
+            if (m_pos != m_end)
+                malformedJSON("more than one value");
+            return value;
+        }
+
+    private:
+        void skipSpace()
+        {
+            while (m_pos != m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r'))
+                ++m_pos;
+        }
+
+        bool consume(const char* word)
+        {
+            size_t len = std::strlen(word);
+            if (static_cast<size_t>(m_end - m_pos) < len || std::memcmp(m_pos, word, len) != 0)
+                return false;
+            m_pos += len;
+            return true;
+        }
+
+        char peek()
+        {
+            skipSpace();
+            if (m_pos == m_end)
+                malformedJSON("truncated");
+            return *m_pos;
+        }
+
+        FB::variant parseValue(size_t depth)
+        {
+            switch (peek()) {
+            case '{': return parseObject(depth);
+            case '[': return parseArray(depth);
+            case '"': return parseString();
+            case 't': if (consume("true")) return true; break;
+            case 'f': if (consume("false")) return false; break;
+            case 'n': if (consume("null")) return FB::FBNull(); break;
+            default: return parseNumber();
+            }
+            malformedJSON("unknown literal");
+            return FB::variant();
+        }
+
+        FB::variant parseObject(size_t depth)
+        {
+            if (depth >= FB::VariantReader::MaxDepth)
+                malformedJSON("nested too deeply");
+            ++m_pos;
+            FB::VariantMap map;
+            if (peek() == '}') {
+                ++m_pos;
+                return map;
+            }
+            for (;;) {
+                if (peek() != '"')
+                    malformedJSON("expected a key");
+                std::string key(parseString());
+                if (peek() != ':')
+                    malformedJSON("expected ':'");
+                ++m_pos;
+                map[key] = parseValue(depth + 1);
+                char c = peek();
+                ++m_pos;
+                if (c == '}')
+                    return map;
+                if (c != ',')
+                    malformedJSON("expected ',' or '}'");
+            }
+        }
+
+        FB::variant parseArray(size_t depth)
+        {
+            if (depth >= FB::VariantReader::MaxDepth)
+                malformedJSON("nested too deeply");
+            ++m_pos;
+            FB::VariantList list;
+            if (peek() == ']') {
+                ++m_pos;
+                return list;
+            }
+            for (;;) {
+                list.push_back(parseValue(depth + 1));
+                char c = peek();
+                ++m_pos;
+                if (c == ']')
+                    return list;
+                if (c != ',')
+                    malformedJSON("expected ',' or ']'");
+            }
+        }
+
+        unsigned int parseHex4()
+        {
+            if (m_end - m_pos < 4)
+                malformedJSON("truncated");
+            unsigned int value = 0;
+            for (int i = 0; i < 4; ++i) {
+                char c = *m_pos++;
+                value <<= 4;
+                if (c >= '0' && c <= '9') value |= c - '0';
+                else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+                else malformedJSON("bad \\u escape");
+            }
+            return value;
+        }
+
+        static void appendUTF8(std::string& out, boost::uint32_t cp)
+        {
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            } else if (cp < 0x800) {
+                out += static_cast<char>(0xc0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            } else if (cp < 0x10000) {
+                out += static_cast<char>(0xe0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            } else {
+                out += static_cast<char>(0xf0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+        }
+
+        std::string parseString()
+        {
+            ++m_pos;
+            std::string str;
+            for (;;) {
+                // Copy runs of plain characters in one go
+                const char* run = m_pos;
+                while (m_pos != m_end && *m_pos != '"' && *m_pos != '\\' && static_cast<unsigned char>(*m_pos) >= 0x20)
+                    ++m_pos;
+                str.append(run, m_pos);
+                if (m_pos == m_end)
+                    malformedJSON("truncated");
+                char c = *m_pos++;
+                if (c == '"')
+                    return str;
+                if (c != '\\')
+                    malformedJSON("control character in a string");
+                if (m_pos == m_end)
+                    malformedJSON("truncated");
+                switch (*m_pos++) {
+                case '"': str += '"'; break;
+                case '\\': str += '\\'; break;
+                case '/': str += '/'; break;
+                case 'b': str += '\b'; break;
+                case 'f': str += '\f'; break;
+                case 'n': str += '\n'; break;
+                case 'r': str += '\r'; break;
+                case 't': str += '\t'; break;
+                case 'u': {
+                    boost::uint32_t cp = parseHex4();
+                    if (cp >= 0xd800 && cp < 0xdc00 && m_end - m_pos >= 6 && m_pos[0] == '\\' && m_pos[1] == 'u') {
+                        const char* save = m_pos;
+                        m_pos += 2;
+                        boost::uint32_t low = parseHex4();
+                        if (low >= 0xdc00 && low < 0xe000)
+                            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                        else
+                            m_pos = save;
+                    }
+                    // A lone surrogate can't be written as UTF8
+                    appendUTF8(str, cp >= 0xd800 && cp < 0xe000 ? 0xfffd : cp);
+                    break;
+                }
+                default:
+                    malformedJSON("bad escape");
+                }
+            }
+        }
+
+        FB::variant parseNumber()
+        {
+            const char* start = m_pos;
+            bool integer = true;
+            if (m_pos != m_end && *m_pos == '-')
+                ++m_pos;
+            const char* digits = m_pos;
+            while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+                ++m_pos;
+            if (m_pos == digits)
+                malformedJSON("unknown literal");
+            if (m_pos != m_end && *m_pos == '.') {
+                integer = false;
+                ++m_pos;
+                while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+                    ++m_pos;
+            }
+            if (m_pos != m_end && (*m_pos == 'e' || *m_pos == 'E')) {
+                integer = false;
+                ++m_pos;
+                if (m_pos != m_end && (*m_pos == '+' || *m_pos == '-'))
+                    ++m_pos;
+                while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+                    ++m_pos;
+            }
+            if (integer && m_pos - digits <= 9) {
+                // Nine digits always fit, and batches are mostly small integers, so skip the stream
+                int value = 0;
+                for (const char* d = digits; d != m_pos; ++d)
+                    value = value * 10 + (*d - '0');
+                return digits == start ? value : -value;
+            }
+            std::istringstream str(std::string(start, m_pos));
+            str.imbue(std::locale::classic());
+            double value = 0;
+            str >> value;
+            if (str.fail())
+                malformedJSON("bad number");
+            return value;
+        }
+
+        const char* m_pos;
+        const char* m_end;
+    };
+}
+
+void FB::appendJSON(std::string& out, const variant& value, UnencodableJSON unencodable)
+{
+    ::appendJSON(out, value, unencodable, 0);
+}
+
+std::string FB::encodeJSON(const variant& value)
+{
+    std::string out;
+    ::appendJSON(out, value, UnencodableJSONThrows, 0);
+    return out;
+}
+
+FB::variant FB::decodeJSON(const std::string& text)
+{
+    JSONParser parser(text.data(), text.data() + text.size());
+    return parser.parse();
+}
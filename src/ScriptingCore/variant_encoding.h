@@ -0,0 +1,284 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_VARIANT_ENCODING
+#define H_FB_VARIANT_ENCODING
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include "variant.h"
+
+namespace FB {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @exception variant_encoding_error
+    ///
+    /// @brief  Thrown when a value can't be encoded (a JSAPI or JSObject, say), or when encoded data
+    ///         is malformed, truncated or from a newer version of the encoding
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct variant_encoding_error : std::runtime_error
+    {
+        explicit variant_encoding_error(const std::string& message)
+            : std::runtime_error(message)
+        { }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  VariantWriter
+    ///
+    /// @brief  Encodes variants, and whole graphs of VariantLists and VariantMaps, in a compact
+    ///         binary form that VariantReader reads back without needing to know what to expect.
+    ///
+    /// The encoding starts with a short versioned header, followed by any number of values.  Each
+    /// value is a tag byte and its payload: integers are varints (zigzag for signed ones, and
+    /// 0-127 fit in the tag itself), doubles are 8 bytes little-endian, and strings and blobs are
+    /// a length and the bytes.  Lists and maps give their size up front; map keys are written out
+    /// the first time they are used and referred back to by number after that, so a list of
+    /// records doesn't repeat its field names.
+    ///
+    /// Everything that has a fixed meaning round trips: undefined and null stay distinct, 64 bit
+    /// integers keep all their bits, and Blobs stay Blobs.  What comes back is normalized a
+    /// little -- narrower integers come back as int or unsigned int, 64 bit ones as boost::int64_t
+    /// or boost::uint64_t, float as double, and std::wstring and SharedString as UTF8 std::string.
+    /// JSAPI and JSObject references can't be encoded.
+    ///
+    /// Values can be written a whole variant at a time, or a piece at a time without building
+    /// the containers first:
+    /// @code
+    ///      std::string out;
+    ///      FB::VariantWriter writer(out);
+    ///      writer.beginList(files.size());
+    ///      for (size_t i = 0; i < files.size(); ++i) {
+    ///          writer.beginMap(2);
+    ///          writer.writeKey("name");
+    ///          writer.writeString(files[i].name);
+    ///          writer.writeKey("data");
+    ///          writer.writeBlob(files[i].data.data(), files[i].data.size());
+    ///      }
+    /// @endcode
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class VariantWriter : boost::noncopyable
+    {
+    public:
+        static const int Version = 1;
+
+        // Appends the header, and then each value, to out
+        explicit VariantWriter(std::string& out);
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void VariantWriter::write(const variant& value)
+        ///
+        /// @brief  Writes value, and everything in it if it is a VariantList or VariantMap.
+        ///
+        /// @exception variant_encoding_error if something in it can't be encoded; anything already
+        ///            written is left in the output
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void write(const variant& value);
+
+        void writeUndefined();
+        void writeNull();
+        void writeBool(bool value);
+        void writeInt32(boost::int32_t value);
+        void writeInt64(boost::int64_t value);
+        void writeUInt32(boost::uint32_t value);
+        void writeUInt64(boost::uint64_t value);
+        void writeDouble(double value);
+        void writeString(const char* str, size_t length);
+        void writeString(const std::string& str) { writeString(str.data(), str.size()); }
+        void writeBlob(const void* data, size_t size);
+
+        // The next count values written are the list's; the next count keys, each followed by
+        // its value, are the map's
+        void beginList(size_t count);
+        void beginMap(size_t count);
+        void writeKey(const char* key, size_t length);
+        void writeKey(const std::string& key) { writeKey(key.data(), key.size()); }
+
+        // Whether every list and map that was begun has been filled
+        bool isComplete() const { return m_open.empty(); }
+
+    private:
+        struct Container
+        {
+            bool isMap;
+            bool haveKey;
+            size_t remaining;
+        };
+
+        void beginValue();
+        void endValue();
+        void beginContainer(bool isMap, size_t count);
+        void putVarint(boost::uint64_t value);
+
+        std::string& m_out;
+        std::vector<Container> m_open;
+        boost::unordered_map<std::string, boost::uint32_t> m_keys;
+        // Reused to look keys up without allocating
+        std::string m_key;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  VariantReader
+    ///
+    /// @brief  Reads back what VariantWriter wrote, either as whole variants or a token at a time.
+    ///
+    /// The reader doesn't copy its input, which has to stay put for as long as the reader is used.
+    /// Token by token, strings, blobs and keys are handed out as pointers into the input, so a
+    /// large document can be searched or copied somewhere else without building variants:
+    /// @code
+    ///      FB::VariantReader reader(seg->data(), seg->size(), seg);
+    ///      while (reader.next() != FB::VariantReader::Token_End) {
+    ///          if (reader.getToken() == FB::VariantReader::Token_Key && reader.getString() == "thumb")
+    ///              thumbs.push_back(reader.read().cast<FB::Blob>());
+    ///      }
+    /// @endcode
+    ///
+    /// Blobs read into variants point into the input too if the reader was given something that
+    /// keeps it alive; otherwise they get a copy of their bytes.
+    ///
+    /// @since 1.7
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class VariantReader : boost::noncopyable
+    {
+    public:
+        enum Token {
+            Token_End,          // no more values
+            Token_Undefined,
+            Token_Null,
+            Token_Bool,
+            Token_Int32,
+            Token_Int64,
+            Token_UInt32,
+            Token_UInt64,
+            Token_Double,
+            Token_String,
+            Token_Blob,
+            Token_BeginList,    // getCount() values follow, then Token_EndList
+            Token_EndList,
+            Token_BeginMap,     // getCount() keys, each followed by its value, then Token_EndMap
+            Token_Key,
+            Token_EndMap
+        };
+
+        // Deeper than this is taken to be malformed, rather than run out of stack
+        static const size_t MaxDepth = 64;
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn VariantReader::VariantReader(const char* data, size_t size)
+        ///
+        /// @brief  Reads the encoded values in data, which must outlive the reader.
+        ///
+        /// @exception variant_encoding_error if data doesn't start with a header this version
+        ///            understands
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        VariantReader(const char* data, size_t size);
+        explicit VariantReader(const std::string& data);
+        // Blobs share the buffer rather than copying out of it
+        explicit VariantReader(const boost::shared_ptr<const std::string>& data);
+        VariantReader(const char* data, size_t size, const boost::shared_ptr<const void>& owner);
+
+        // Whether all the values have been read
+        bool atEnd() const { return m_open.empty() && m_pos == m_end; }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn variant VariantReader::read()
+        ///
+        /// @brief  Reads the next value, with everything in it.  Inside a map, call it after
+        ///         Token_Key to read that key's value.
+        ///
+        /// @exception variant_encoding_error if there are no more values where the reader is, or the
+        ///            data is malformed
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        variant read();
+        // Moves past the next value without building it
+        void skip();
+
+        // Moves to the next token, and returns it
+        Token next();
+        Token getToken() const { return m_token; }
+        // How many lists and maps the reader is inside of
+        size_t getDepth() const { return m_open.size(); }
+
+        bool getBool() const { return m_int != 0; }
+        // For Token_Int32 and Token_Int64
+        boost::int64_t getInt() const { return m_int; }
+        // For Token_UInt32 and Token_UInt64
+        boost::uint64_t getUInt() const { return static_cast<boost::uint64_t>(m_int); }
+        double getDouble() const { return m_double; }
+        // The bytes of a Token_String, Token_Blob or Token_Key, in the input
+        const char* getData() const { return m_data; }
+        size_t getSize() const { return m_size; }
+        std::string getString() const { return std::string(m_data, m_size); }
+        // The size of a Token_BeginList or Token_BeginMap
+        size_t getCount() const { return m_size; }
+
+    private:
+        struct Container
+        {
+            bool isMap;
+            bool haveKey;
+            size_t remaining;
+        };
+
+        void readHeader();
+        void readValue(variant& value);
+        unsigned char readByte();
+        boost::uint64_t readVarint();
+        const char* readBytes(size_t length);
+        void readKey();
+        void beginContainer(bool isMap);
+
+        const char* m_pos;
+        const char* m_end;
+        boost::shared_ptr<const void> m_owner;
+        std::vector<Container> m_open;
+        std::vector<std::pair<const char*, size_t> > m_keys;
+
+        Token m_token;
+        boost::int64_t m_int;
+        double m_double;
+        const char* m_data;
+        size_t m_size;
+    };
+
+    // The encoding of a single value
+    std::string encodeVariant(const variant& value);
+    // Reads a single value; throws variant_encoding_error unless data holds exactly one
+    variant decodeVariant(const std::string& data);
+    variant decodeVariant(const char* data, size_t size);
+
+    // What appendJSON does with a value JSON has no form for: a Blob, a JSAPI, a JSObject, ...
+    enum UnencodableJSON { UnencodableJSONThrows, UnencodableJSONAsNull };
+
+    // Appends value to out as JSON text.  This is the one variant to JSON writer; fbjson's
+    // appendVariantAsJson calls it too, asking for null where a value can't be written.
+    void appendJSON(std::string& out, const variant& value, UnencodableJSON unencodable = UnencodableJSONThrows);
+
+    // The same values as JSON text, for a page to build or read with JSON.stringify and JSON.parse
+    // in a single call across to the plugin.  Undefined and null both become null, as do doubles
+    // that aren't finite; Blobs, JSAPIs and JSObjects can't be written.  Reading gives back ints
+    // for integers that fit one and doubles for other numbers.
+    std::string encodeJSON(const variant& value);
+    variant decodeJSON(const std::string& text);
+};
+
+#endif // H_FB_VARIANT_ENCODING
@@ -82,6 +82,9 @@ namespace
 WebKitBrowserHost::WebKitBrowserHost(JSContextRef jsContext, JSObjectRef window, const FB::BrowserHostPtr& parentHost)
     : m_jsContext(jsContext), m_jsWindow(window), m_parentHost(parentHost)
 {
+    // Same page, same budget
+    if (parentHost && !parentHost->getPageOrigin().empty())
+        setPageOrigin(parentHost->getPageOrigin());
 }
 
 WebKitBrowserHost::~WebKitBrowserHost()
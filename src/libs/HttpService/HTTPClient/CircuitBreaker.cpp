@@ -0,0 +1,105 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+
+#include "CircuitBreaker.h"
+
+using namespace HTTP;
+using boost::posix_time::microsec_clock;
+
+boost::mutex CircuitBreaker::registry_mutex;
+std::map<std::string, CircuitBreakerPtr> CircuitBreaker::registry;
+unsigned int CircuitBreaker::default_failure_threshold = 5;
+double CircuitBreaker::default_open_duration = 30;
+
+CircuitBreaker::CircuitBreaker()
+    : failure_threshold(default_failure_threshold), open_duration(default_open_duration),
+      m_state(CLOSED), m_failures(0), m_trialInFlight(false) { }
+
+CircuitBreakerPtr CircuitBreaker::forHost(const FB::URI& uri) {
+    std::string key = uri.protocol + "://" + uri.domain;
+    if (uri.port) key += ":" + boost::lexical_cast<std::string>(uri.port);
+
+    boost::mutex::scoped_lock _l(registry_mutex);
+    CircuitBreakerPtr& res = registry[key];
+    if (!res) res = boost::make_shared<CircuitBreaker>();
+    return res;
+}
+
+void CircuitBreaker::setDefaults(unsigned int failure_threshold, double open_duration) {
+    boost::mutex::scoped_lock _l(registry_mutex);
+    default_failure_threshold = failure_threshold;
+    default_open_duration = open_duration;
+}
+
+void CircuitBreaker::resetAll() {
+    boost::mutex::scoped_lock _l(registry_mutex);
+    registry.clear();
+}
+
+bool CircuitBreaker::allowRequest() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    switch (m_state) {
+    case CLOSED:
+        return true;
+    case OPEN:
+        if ((microsec_clock::universal_time() - m_openedAt).total_milliseconds() < open_duration * 1000) {
+            return false;
+        }
+        m_state = HALF_OPEN;
+        m_trialInFlight = true;
+        return true;
+    case HALF_OPEN:
+    default:
+        // Only one trial request at a time
+        if (m_trialInFlight) return false;
+        m_trialInFlight = true;
+        return true;
+    }
+}
+
+void CircuitBreaker::onSuccess() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_state = CLOSED;
+    m_failures = 0;
+    m_trialInFlight = false;
+}
+
+void CircuitBreaker::onFailure() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    ++m_failures;
+    m_trialInFlight = false;
+    if (m_state == HALF_OPEN || (failure_threshold && m_failures >= failure_threshold)) {
+        m_state = OPEN;
+        m_openedAt = microsec_clock::universal_time();
+    }
+}
+
+void CircuitBreaker::onAbandoned() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_trialInFlight = false;
+}
+
+CircuitBreaker::State CircuitBreaker::getState() const {
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_state;
+}
+
+unsigned int CircuitBreaker::getConsecutiveFailures() const {
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_failures;
+}
+
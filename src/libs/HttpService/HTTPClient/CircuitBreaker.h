@@ -0,0 +1,75 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTP_CIRCUITBREAKER
+#define H_HTTP_CIRCUITBREAKER
+
+#include <string>
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "URI.h"
+
+namespace HTTP {
+    class CircuitBreaker;
+    typedef boost::shared_ptr<CircuitBreaker> CircuitBreakerPtr;
+
+    // Tracks the health of one host. After failure_threshold failures in a row the circuit opens and
+    // requests to the host fail immediately; once open_duration has passed a single trial request
+    // is let through (half open), and its outcome closes the circuit or opens it again.
+    class CircuitBreaker : boost::noncopyable {
+    public:
+        enum State { CLOSED, OPEN, HALF_OPEN };
+
+        CircuitBreaker();
+
+        // Shared breaker for the scheme, host and port of uri
+        static CircuitBreakerPtr forHost(const FB::URI& uri);
+        // Thresholds used by breakers created after this call
+        static void setDefaults(unsigned int failure_threshold, double open_duration);
+        // Forgets every host; mostly for tests
+        static void resetAll();
+
+        // false if the request should fail fast without being sent
+        bool allowRequest();
+        void onSuccess();
+        void onFailure();
+        // The request was cancelled, so it says nothing about the host
+        void onAbandoned();
+
+        State getState() const;
+        unsigned int getConsecutiveFailures() const;
+
+        unsigned int failure_threshold;
+        double open_duration; // seconds
+
+    protected:
+        mutable boost::mutex m_mutex;
+        State m_state;
+        unsigned int m_failures;
+        bool m_trialInFlight;
+        boost::posix_time::ptime m_openedAt;
+
+        static boost::mutex registry_mutex;
+        static std::map<std::string, CircuitBreakerPtr> registry;
+        static unsigned int default_failure_threshold;
+        static double default_open_duration;
+    };
+};
+
+#endif // H_HTTP_CIRCUITBREAKER
+
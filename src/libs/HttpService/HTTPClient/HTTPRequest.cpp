@@ -19,7 +19,12 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #endif
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <ctime>
 #include <boost/lexical_cast.hpp>
 #include <cassert>
 #include <openssl/ssl.h>
@@ -27,6 +32,9 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include <curl/curl.h>
 #include "../HTTPService/BasicService.h"
 #include "../HTTPCommon/Utils.h"
+#include "CircuitBreaker.h"
+#include "BrowserHost.h"
+#include "logging.h"
 
 #include "HTTPRequest.h"
 using namespace boost::algorithm;
@@ -47,6 +55,7 @@ static const char* user_agent = "FBPlugin";
 using namespace HTTP;
 
 HTTPProxyConfig HTTPRequest::static_proxy_config;
+RetryPolicy HTTPRequest::static_retry_policy;
 
 boost::shared_ptr<HTTPResponseData> parse_http_response(boost::asio::streambuf& response_stream);
 
@@ -54,6 +63,10 @@ boost::shared_ptr<HTTPResponseData> parse_http_response(boost::asio::streambuf&
   static_proxy_config = _cfg;
 }
 
+/*static*/ void HTTPRequest::setDefaultRetryPolicy(const RetryPolicy& policy) {
+  static_retry_policy = policy;
+}
+
 void onStatusChanged_do_nothing(HTTP::Status state) {
 }
 
@@ -194,15 +207,21 @@ void HTTPRequest::_internal_threadSafeDestroy() {
 }
 
 void HTTPRequest::threadSafeDestroy() {
-  boost::thread t(boost::bind(&HTTPRequest::_internal_threadSafeDestroy, this));
+  // Once the reactor has shut down nothing posted to it runs, so fall back to a thread of our own
+  if (!reactor || !reactor->postBlocking(boost::bind(&HTTPRequest::_internal_threadSafeDestroy, this))) {
+    boost::thread t(boost::bind(&HTTPRequest::_internal_threadSafeDestroy, this));
+  }
 }
 
-HTTPRequest::HTTPRequest() : req(NULL), cancellation_requested(false), status_callback(onStatusChanged_do_nothing) {
+HTTPRequest::HTTPRequest() : req(NULL), cancellation_requested(false), cancel_token_id(0), status_callback(onStatusChanged_do_nothing),
+  shutdown_hook(0), started(false), stopped(false), finished(false), retry_policy(static_retry_policy), session_wait_ms(0) {
 
 }
 
 HTTPRequest::~HTTPRequest() {
-  if (worker_thread) {
+  if (cancel_token)
+    cancel_token->unregister(cancel_token_id);
+  if (started) {
     if (! cancellation_requested) {
       if (!(last_status.state == Status::IDLE || last_status.state == Status::COMPLETE || last_status.state == Status::HTTP_ERROR)) {
 #ifndef NDEBUG
@@ -215,12 +234,39 @@ HTTPRequest::~HTTPRequest() {
   }
 }
 
+static void cancel_retry_timer(const boost::shared_ptr<deadline_timer>& timer) {
+  timer->cancel();
+}
+
 void HTTPRequest::cancel() {
-  cancellation_requested = true;
+  boost::shared_ptr<deadline_timer> timer;
+  {
+    boost::mutex::scoped_lock _l(state_mutex);
+    cancellation_requested = true;
+    timer = retry_timer;
+  }
+  // The timer is only touched on the strand; binding it rather than this keeps it valid even if
+  // the request finishes and is deleted first
+  if (timer) strand->post(boost::bind(&cancel_retry_timer, timer));
+}
+
+void HTTPRequest::setCancellationToken(const FB::CancellationTokenPtr& token) {
+  if (cancel_token)
+    cancel_token->unregister(cancel_token_id);
+  cancel_token = token;
+  cancel_token_id = 0;
+  if (cancel_token)
+    cancel_token_id = cancel_token->onCancel(boost::bind(&HTTPRequest::cancel, this));
+}
+
+void HTTPRequest::setBrowserSession(const FB::BrowserSessionPtr& session, long wait_ms) {
+  browser_session = session;
+  session_wait_ms = wait_ms;
 }
 
 void HTTPRequest::awaitCompletion() {
-  worker_thread->join();
+  boost::mutex::scoped_lock _l(state_mutex);
+  while (started && !finished) state_changed.wait(_l);
 }
 
 HTTP::Status HTTPRequest::getStatus() const {
@@ -231,6 +277,10 @@ void HTTPRequest::onStatusChanged(const callback_fn_t& _callback) {
     status_callback = _callback;
 }
 
+void HTTPRequest::setRetryPolicy(const RetryPolicy& policy) {
+  retry_policy = policy;
+}
+
 boost::shared_ptr<HTTPRequestData> HTTPRequest::getRequest() {
   return request_data;
 }
@@ -242,9 +292,19 @@ boost::shared_ptr<HTTPResponseData> HTTPRequest::getResponse() {
 void HTTPRequest::startRequest(boost::shared_ptr<HTTPRequestData> _request_data) {
     request_data = _request_data;
   proxy_config = static_proxy_config;
-  
-  // We build the HTTP request in another thread to avoid blocking the caller if the request is large or resolving the size of the attached content takes a while.
-    worker_thread = boost::shared_ptr<thread>(new thread(boost::bind(&HTTPRequest::startRequest_thread, this)));
+  reactor = FB::Reactor::instance();
+  strand = reactor->getStrand("http-client");
+  shutdown_hook = reactor->addShutdownHook("http-client", boost::bind(&HTTPRequest::handleReactorShutdown, this, _1));
+  {
+    boost::mutex::scoped_lock _l(state_mutex);
+    started = true;
+  }
+
+  // We build the HTTP request on the reactor's blocking pool to avoid blocking the caller if the request is large or resolving the size of the attached content takes a while.
+  if (!reactor->postBlocking(boost::bind(&HTTPRequest::runAttempt, this))) {
+    last_status.last_error = "The reactor has shut down";
+    finish(Status::HTTP_ERROR);
+  }
 }
 
 static size_t httprequest_writefn(void* ptr, size_t size, size_t nmemb, HTTPResponseData* resp) {
@@ -264,12 +324,243 @@ static size_t httprequest_header(void *ptr, size_t size, size_t nmemb, void *cli
   return size * nmemb;
 }
 
-void HTTPRequest::startRequest_thread() {
+static RetryPolicy::FailureKind classify_curl_error(CURLcode err) {
+  switch (err) {
+    case CURLE_COULDNT_RESOLVE_PROXY:
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+      return RetryPolicy::NOT_SENT;
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+      return RetryPolicy::TRANSIENT;
+    default:
+      return RetryPolicy::PERMANENT;
+  }
+}
+
+// Retry-After is either a number of seconds or an HTTP date
+static double parse_retry_after(const std::multimap<std::string, std::string>& headers) {
+  for (std::multimap<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+    if (!iequals(it->first, "Retry-After")) continue;
+    try {
+      return lexical_cast<unsigned long>(it->second);
+    } catch (const boost::bad_lexical_cast&) {
+      time_t when = curl_getdate(it->second.c_str(), NULL);
+      if (when == -1) return -1;
+      double res = difftime(when, time(NULL));
+      return res > 0 ? res : 0;
+    }
+  }
+  return -1;
+}
+
+// WWW-Authenticate: Basic realm="Secure Area"
+static void parse_auth_challenge(const std::multimap<std::string, std::string>& headers, std::string& scheme, std::string& realm) {
+  for (std::multimap<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+    if (!iequals(it->first, "WWW-Authenticate")) continue;
+    const std::string& value = it->second;
+    scheme = to_lower_copy(value.substr(0, value.find(' ')));
+    size_t pos = to_lower_copy(value).find("realm=");
+    if (pos != std::string::npos) {
+      pos += 6;
+      if (pos < value.size() && value[pos] == '"') {
+        size_t end = value.find('"', ++pos);
+        realm = value.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+      } else {
+        size_t end = value.find_first_of(", ", pos);
+        realm = value.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+      }
+    }
+    return;
+  }
+}
+
+// The browser's cookies, less any the request sets itself, then the request's own
+static std::string merge_session_cookies(const std::string& session_cookies, const std::map<std::string, std::string>& own) {
+  std::vector<std::string> crumbs;
+  std::string res;
+  split(crumbs, session_cookies, is_any_of(";"));
+  for (std::vector<std::string>::iterator it = crumbs.begin(); it != crumbs.end(); ++it) {
+    trim(*it);
+    if (it->empty() || own.count(it->substr(0, it->find('=')))) continue;
+    if (!res.empty()) res += "; ";
+    res += *it;
+  }
+  std::string own_header = build_cookie_header(own);
+  if (!own_header.empty()) {
+    if (!res.empty()) res += "; ";
+    res += own_header;
+  }
+  return res;
+}
+
+// Settings from FB::BrowserHost::DetectProxySettings
+static HTTPProxyConfig proxy_from_settings(const std::map<std::string, std::string>& settings) {
+  HTTPProxyConfig cfg;
+  std::map<std::string, std::string>::const_iterator type = settings.find("type");
+  std::map<std::string, std::string>::const_iterator hostname = settings.find("hostname");
+  std::map<std::string, std::string>::const_iterator port = settings.find("port");
+  if (type == settings.end() || hostname == settings.end() || port == settings.end()) return cfg;
+  try {
+    cfg.port = lexical_cast<unsigned short>(port->second);
+  } catch (const boost::bad_lexical_cast&) {
+    return cfg;
+  }
+  cfg.hostname = hostname->second;
+  cfg.type = iequals(type->second, "socks") ? HTTPProxyConfig::kSOCKS4Proxy : HTTPProxyConfig::kHTTPProxy;
+  return cfg;
+}
+
+static long curl_auth_for_scheme(const std::string& scheme) {
+  if (scheme == "basic") return CURLAUTH_BASIC;
+  if (scheme == "digest") return CURLAUTH_DIGEST;
+  if (scheme == "ntlm") return CURLAUTH_NTLM;
+  return CURLAUTH_ANY;
+}
+
+bool HTTPRequest::getSessionCredentials(const AttemptResult& res) {
+  if (!browser_session || res.auth_scheme.empty() || !auth_username.empty()) return false;
+  if (!browser_session->getCredentials(request_data->uri, res.auth_scheme, res.auth_realm,
+      auth_username, auth_password, session_wait_ms)) {
+    return false;
+  }
+  auth_scheme = res.auth_scheme;
+  return true;
+}
+
+void HTTPRequest::runAttempt() {
+  CircuitBreakerPtr breaker(CircuitBreaker::forHost(request_data->uri));
+  const unsigned int attempt = last_status.attempt + 1;
+
+  last_status.max_attempts = retry_policy.max_attempts ? retry_policy.max_attempts : 1;
+  last_status.attempt = attempt;
+  last_status.retry_delay = 0;
+
+  if (browser_session) {
+    // Only the first attempt waits; later ones take whatever the main thread has got to since
+    FB::SessionSnapshotPtr snap(attempt == 1
+      ? browser_session->waitForSnapshot(request_data->uri, session_wait_ms)
+      : browser_session->getSnapshot(request_data->uri));
+    if (snap) session_snapshot = snap;
+  }
+
+  AttemptResult res;
+  if (!breaker->allowRequest()) {
+    // Fail fast; the host has been failing and sending more requests won't help it recover
+    res.error = "Too many recent failures from " + request_data->uri.domain + "; not sending the request";
+    res.kind = RetryPolicy::TRANSIENT;
+    last_status.last_error = res.error;
+    last_status.retryable = true;
+    finish(Status::HTTP_ERROR);
+    return;
+  }
+
+  res = performAttempt();
+  if (res.outcome == AttemptResult::FAILED && getSessionCredentials(res)) {
+    // Asked for credentials the browser has saved; that says nothing about the host
+    res = performAttempt();
+  }
+  if (res.outcome == AttemptResult::SUCCEEDED) {
+    breaker->onSuccess();
+    finish(Status::COMPLETE);
+    return;
+  } else if (res.outcome == AttemptResult::CANCELLED) {
+    breaker->onAbandoned();
+    finish(Status::CANCELLED);
+    return;
+  }
+
+  if (res.kind == RetryPolicy::PERMANENT) {
+    // The host answered, so as far as the breaker is concerned it's healthy
+    breaker->onSuccess();
+  } else {
+    // Including CLIENT_ERROR: nothing was heard from the host, so it can't count as healthy
+    breaker->onFailure();
+  }
+
+  if (attempt < last_status.max_attempts && retry_policy.shouldRetry(res.kind, request_data->method)) {
+    boost::mt19937 rng(static_cast<boost::uint32_t>(time(NULL) ^ reinterpret_cast<size_t>(this) ^ attempt));
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > random01(rng, boost::uniform_real<>(0, 1));
+    last_status.state = Status::WAITING_TO_RETRY;
+    last_status.last_error = res.error;
+    last_status.retry_delay = retry_policy.delayFor(attempt, random01(), res.retry_after);
+    status_callback(last_status);
+    scheduleRetry(last_status.retry_delay);
+    return;
+  }
+
+  last_status.last_error = res.error;
+  last_status.retryable = (res.kind == RetryPolicy::NOT_SENT || res.kind == RetryPolicy::TRANSIENT);
+  finish(Status::HTTP_ERROR);
+}
+
+void HTTPRequest::scheduleRetry(double seconds) {
+  boost::mutex::scoped_lock _l(state_mutex);
+  if (cancellation_requested) {
+    _l.unlock();
+    finish(Status::CANCELLED);
+    return;
+  }
+  retry_timer.reset(new deadline_timer(reactor->getIOService()));
+  // Posted while the lock is held, so a cancel() that sees the timer is queued behind it
+  strand->post(boost::bind(&HTTPRequest::startRetryTimer, this, retry_timer, seconds));
+}
+
+void HTTPRequest::startRetryTimer(const boost::shared_ptr<deadline_timer>& timer, double seconds) {
+  timer->expires_from_now(boost::posix_time::microseconds(static_cast<boost::int64_t>(seconds * 1000000)));
+  timer->async_wait(strand->wrap(boost::bind(&HTTPRequest::handleRetryTimer, this, boost::asio::placeholders::error)));
+}
+
+void HTTPRequest::handleRetryTimer(const boost::system::error_code& ec) {
+  bool cancelled;
+  {
+    boost::mutex::scoped_lock _l(state_mutex);
+    retry_timer.reset();
+    cancelled = cancellation_requested || ec;
+  }
+  if (cancelled || !reactor->postBlocking(boost::bind(&HTTPRequest::runAttempt, this))) {
+    finish(Status::CANCELLED);
+  }
+}
+
+void HTTPRequest::handleReactorShutdown(const boost::posix_time::ptime& deadline) {
+  cancel();
+  // Cancelling takes a handler on the strand, or curl noticing in its progress callback; both need
+  // the reactor, so it mustn't stop before they've run
+  boost::mutex::scoped_lock _l(state_mutex);
+  while (!stopped) {
+    if (!state_changed.timed_wait(_l, deadline)) {
+      FBLOG_WARN("HTTPRequest", "Request to " << request_data->uri.domain << " did not stop before the reactor did");
+      return;
+    }
+  }
+}
+
+void HTTPRequest::finish(Status::State state) {
+  last_status.state = state;
+  status_callback(last_status);
+  {
+    boost::mutex::scoped_lock _l(state_mutex);
+    stopped = true;
+    state_changed.notify_all();
+  }
+  // Waits for handleReactorShutdown if it's running, which is why that only waits for stopped
+  if (shutdown_hook) reactor->removeShutdownHook(shutdown_hook);
+  boost::mutex::scoped_lock _l(state_mutex);
+  finished = true;
+  state_changed.notify_all();
+}
+
+HTTPRequest::AttemptResult HTTPRequest::performAttempt() {
   struct curl_httppost* formpost = NULL;
   struct curl_httppost* lastptr = NULL;
   struct curl_slist* headerlist = NULL;
   
   char errorbuffer[CURL_ERROR_SIZE];
+  AttemptResult result;
 
   try {
     response_data = boost::shared_ptr<HTTPResponseData>(new HTTPResponseData);
@@ -278,7 +569,8 @@ void HTTPRequest::startRequest_thread() {
     
     curl_easy_setopt(req, CURLOPT_NOSIGNAL, 1); // disable signals for multithreaded use
     curl_easy_setopt(req, CURLOPT_ERRORBUFFER, errorbuffer);
-    curl_easy_setopt(req, CURLOPT_FAILONERROR, 1);
+    // Error statuses are checked below rather than with CURLOPT_FAILONERROR so that the response
+    // headers (Retry-After in particular) are still read
 
     curl_easy_setopt(req, CURLOPT_SSL_CTX_FUNCTION, sslctx_function);
 
@@ -329,7 +621,9 @@ void HTTPRequest::startRequest_thread() {
       curl_easy_setopt(req, CURLOPT_HTTPPOST, formpost);
     }
     
-    std::string cookie_string = build_cookie_header(request_data->cookies);
+    std::string cookie_string = session_snapshot
+      ? merge_session_cookies(session_snapshot->cookies, request_data->cookies)
+      : build_cookie_header(request_data->cookies);
     curl_easy_setopt(req, CURLOPT_COOKIE, cookie_string.c_str());
     
     for (std::multimap<std::string, std::string>::iterator it = request_data->headers.begin(); it != request_data->headers.end(); ++it) {
@@ -344,8 +638,18 @@ void HTTPRequest::startRequest_thread() {
     curl_easy_setopt(req, CURLOPT_HTTPHEADER, headerlist);
     curl_easy_setopt(req, CURLOPT_FOLLOWLOCATION, 0); // no redirects for security reasons
 
-    // proxy setup
-    switch (proxy_config.type) {
+    if (!auth_username.empty()) {
+      curl_easy_setopt(req, CURLOPT_HTTPAUTH, curl_auth_for_scheme(auth_scheme));
+      curl_easy_setopt(req, CURLOPT_USERNAME, auth_username.c_str());
+      curl_easy_setopt(req, CURLOPT_PASSWORD, auth_password.c_str());
+    }
+
+    // proxy setup; one set with setProxyConfig wins over the browser's
+    HTTPProxyConfig proxy = proxy_config;
+    if (proxy.type == HTTPProxyConfig::kNoProxy && session_snapshot && session_snapshot->hasProxy()) {
+      proxy = proxy_from_settings(session_snapshot->proxy);
+    }
+    switch (proxy.type) {
       default:
       case HTTPProxyConfig::kNoProxy:
         break;
@@ -356,9 +660,9 @@ void HTTPRequest::startRequest_thread() {
         curl_easy_setopt(req, CURLOPT_PROXYTYPE, CURLPROXY_HTTP);
         break;
     };
-    if (proxy_config.type != HTTPProxyConfig::kNoProxy) {
-      curl_easy_setopt(req, CURLOPT_PROXY, proxy_config.hostname.c_str());
-      curl_easy_setopt(req, CURLOPT_PROXYPORT, proxy_config.port);
+    if (proxy.type != HTTPProxyConfig::kNoProxy) {
+      curl_easy_setopt(req, CURLOPT_PROXY, proxy.hostname.c_str());
+      curl_easy_setopt(req, CURLOPT_PROXYPORT, proxy.port);
     }
 
     curl_easy_setopt(req, CURLOPT_NOPROGRESS, 0);
@@ -370,31 +674,37 @@ void HTTPRequest::startRequest_thread() {
     last_status.state = Status::CONNECTING;
     status_callback(last_status);
 
-    if (curl_easy_perform(req) != 0) {
+    CURLcode err = curl_easy_perform(req);
+    long code = 0;
+    curl_easy_getinfo(req, CURLINFO_RESPONSE_CODE, &code);
+    response_data->code = code;
+
+    if (err != CURLE_OK) {
       if (cancellation_requested) {
-        last_status.state = Status::CANCELLED;
-        status_callback(last_status);
+        result.outcome = AttemptResult::CANCELLED;
       } else {
-        throw std::runtime_error(errorbuffer);
+        result.kind = classify_curl_error(err);
+        result.error = errorbuffer;
       }
+    } else if (code >= 400) {
+      result.kind = retry_policy.classifyStatus(code);
+      result.error = "The requested URL returned error: " + lexical_cast<string>(code);
+      result.retry_after = parse_retry_after(response_data->headers);
+      if (code == 401) parse_auth_challenge(response_data->headers, result.auth_scheme, result.auth_realm);
     } else {
-      last_status.state = Status::COMPLETE;
-      status_callback(last_status);
+      result.outcome = AttemptResult::SUCCEEDED;
     }
   } catch (const std::exception& e) {
-    last_status.state = Status::HTTP_ERROR;
-    last_status.last_error = e.what();
-    status_callback(last_status);
+    result.outcome = AttemptResult::FAILED;
+    result.kind = RetryPolicy::CLIENT_ERROR;
+    result.error = e.what();
   }
   
-  long code;
-  curl_easy_getinfo(req, CURLINFO_RESPONSE_CODE, &code);
-  response_data->code = code;
-  
   curl_slist_free_all(headerlist);
   curl_formfree(formpost);
   curl_easy_cleanup(req);
   req = NULL;
+  return result;
 }
 
 void HTTPRequest::curl_header(const char* data, size_t size) {
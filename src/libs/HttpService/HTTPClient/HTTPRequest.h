@@ -20,6 +20,10 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include "../HTTPCommon/HTTPResponseData.h"
 #include "../HTTPCommon/HTTPProxyConfig.h"
 #include "../HTTPCommon/Status.h"
+#include "RetryPolicy.h"
+#include "CancellationToken.h"
+#include "BrowserSession.h"
+#include "Reactor.h"
 #include <boost/thread.hpp>
 
 #undef ERROR // windows...
@@ -33,22 +37,37 @@ namespace HTTP {
             static HTTPRequest* create();
             static void setProxyConfig(const HTTPProxyConfig& cfg);
             static void registerCACert(const std::string& cert);
+            // Policy given to requests created after this call
+            static void setDefaultRetryPolicy(const RetryPolicy& policy);
 
-            // Fire off a request in a new thread and ignore the results with this.
+            // Fire off a request and ignore the results with this.
             static void asyncStartRequest(boost::shared_ptr<HTTPRequestData> data);
 
             // If you need to kill an HTTP request from a thread whose callstack might go through that
-            // request's IO service, then call this; it'll transfer ownership to a new thread which will
-            // stop the service and join the worker thread before deleting the object.
+            // request (e.g. its status callback), then call this; it'll transfer ownership to the
+            // reactor, which waits for the request to finish before deleting the object.
             void threadSafeDestroy();
 
             ~HTTPRequest();
 
+            // Must be called before startRequest
+            void setRetryPolicy(const RetryPolicy& policy);
+            const RetryPolicy& getRetryPolicy() const { return retry_policy; }
+
             void startRequest(boost::shared_ptr<HTTPRequestData> data);
             boost::shared_ptr<HTTPRequestData> getRequest();
             boost::shared_ptr<HTTPResponseData> getResponse();
             void cancel();
             void awaitCompletion();
+            // Cancels the request when token is (e.g. the plugin's, from
+            // FB::BrowserHost::getCancellationToken)
+            void setCancellationToken(const FB::CancellationTokenPtr& token);
+            // Must be called before startRequest. Sends the browser's cookies for the request's
+            // origin along with the request's own, uses the browser's proxy unless setProxyConfig
+            // gave one, and answers a 401 with credentials the browser has saved (e.g. the
+            // session from FB::BrowserHost::getBrowserSession). The first request to an origin waits
+            // up to wait_ms for the main thread to read them.
+            void setBrowserSession(const FB::BrowserSessionPtr& session, long wait_ms = 2000);
 
             Status getStatus() const;
             typedef boost::function<void(Status)> callback_fn_t;
@@ -60,23 +79,70 @@ namespace HTTP {
 
         protected:
 
+            struct AttemptResult {
+                enum Outcome { SUCCEEDED, CANCELLED, FAILED } outcome;
+                RetryPolicy::FailureKind kind;
+                std::string error;
+                double retry_after; // seconds, < 0 if the server didn't say
+                // From the WWW-Authenticate header of a 401
+                std::string auth_scheme;
+                std::string auth_realm;
+                AttemptResult() : outcome(FAILED), kind(RetryPolicy::PERMANENT), retry_after(-1) {}
+            };
+
             HTTPRequest();
-            void startRequest_thread();
-            void killThread();
+            // Runs on the reactor's blocking pool, one attempt at a time; between attempts the
+            // request is only a timer on the "http-client" strand, so it holds no thread
+            void runAttempt();
+            AttemptResult performAttempt();
+            // Looks up the browser's credentials for the realm a 401 asked for; false if there's no
+            // session, it has none, or they were already tried
+            bool getSessionCredentials(const AttemptResult& res);
+            // Starts the next attempt after the retry delay, unless the request is cancelled meanwhile
+            void scheduleRetry(double seconds);
+            void startRetryTimer(const boost::shared_ptr<boost::asio::deadline_timer>& timer, double seconds);
+            void handleRetryTimer(const boost::system::error_code& ec);
+            // Cancels the request and waits, until the reactor's shutdown deadline, for it to stop
+            void handleReactorShutdown(const boost::posix_time::ptime& deadline);
+            // Reports the final state and wakes awaitCompletion; this may be deleted once it returns
+            void finish(Status::State state);
             void _internal_threadSafeDestroy();
 
             CURL* req;
             bool cancellation_requested;
+            FB::CancellationTokenPtr cancel_token;
+            int cancel_token_id;
 
             Status last_status;
             callback_fn_t status_callback;
 
-            boost::shared_ptr<boost::thread> worker_thread;
+            FB::ReactorPtr reactor;
+            FB::Reactor::StrandPtr strand;
+            int shutdown_hook;
+            // Guards the flags and retry_timer, which cancel() and awaitCompletion() use from other
+            // threads
+            mutable boost::mutex state_mutex;
+            boost::condition_variable state_changed;
+            bool started;
+            // The final status has been reported; nothing else will run on the reactor
+            bool stopped;
+            // ...and the request no longer uses the reactor, so it can be deleted
+            bool finished;
+            // Only started or cancelled on strand
+            boost::shared_ptr<boost::asio::deadline_timer> retry_timer;
             boost::shared_ptr<HTTPRequestData> request_data;
             boost::shared_ptr<HTTPResponseData> response_data;
             HTTPProxyConfig proxy_config;
+            RetryPolicy retry_policy;
+            FB::BrowserSessionPtr browser_session;
+            long session_wait_ms;
+            FB::SessionSnapshotPtr session_snapshot;
+            std::string auth_scheme;
+            std::string auth_username;
+            std::string auth_password;
 
             static HTTPProxyConfig static_proxy_config;
+            static RetryPolicy static_retry_policy;
     };
 }; 
 
@@ -0,0 +1,59 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <boost/algorithm/string/case_conv.hpp>
+
+#include "RetryPolicy.h"
+
+using namespace HTTP;
+
+RetryPolicy::RetryPolicy()
+    : max_attempts(1), initial_backoff(0.5), max_backoff(30), backoff_multiplier(2), jitter(0.5),
+      retry_non_idempotent(false), honor_retry_after(true) {
+    static const long codes[] = { 408, 429, 500, 502, 503, 504 };
+    retryable_codes.insert(codes, codes + sizeof(codes) / sizeof(codes[0]));
+}
+
+bool RetryPolicy::isIdempotent(const std::string& method) {
+    std::string m = boost::algorithm::to_upper_copy(method);
+    return m.empty() || m == "GET" || m == "HEAD" || m == "PUT" || m == "DELETE" || m == "OPTIONS" || m == "TRACE";
+}
+
+RetryPolicy::FailureKind RetryPolicy::classifyStatus(long code) const {
+    return retryable_codes.count(code) ? TRANSIENT : PERMANENT;
+}
+
+bool RetryPolicy::shouldRetry(FailureKind kind, const std::string& method) const {
+    switch (kind) {
+    case NOT_SENT:
+        return true;
+    case TRANSIENT:
+        return retry_non_idempotent || isIdempotent(method);
+    default:
+        return false;
+    }
+}
+
+double RetryPolicy::delayFor(unsigned int attempt, double random01, double retry_after) const {
+    if (honor_retry_after && retry_after >= 0) {
+        return std::min(retry_after, max_backoff);
+    }
+    double delay = initial_backoff * std::pow(backoff_multiplier, static_cast<double>(attempt > 0 ? attempt - 1 : 0));
+    delay = std::min(delay, max_backoff);
+    // Spread retries from many clients out so they don't all come back at once
+    return delay * (1.0 - jitter) + delay * jitter * random01;
+}
+
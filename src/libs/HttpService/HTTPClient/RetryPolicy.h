@@ -0,0 +1,59 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTP_RETRYPOLICY
+#define H_HTTP_RETRYPOLICY
+
+#include <set>
+#include <string>
+
+namespace HTTP {
+    // Controls how HTTPRequest retries an attempt that failed in a way that might succeed later.
+    // The default makes a single attempt, which is how HTTPRequest has always behaved.
+    struct RetryPolicy {
+        RetryPolicy();
+
+        // What went wrong with an attempt, as far as retrying is concerned
+        enum FailureKind {
+            NOT_SENT,   // couldn't resolve or connect; the server never saw the request
+            TRANSIENT,  // the request may have been processed (timeout, dropped connection, 503...)
+            PERMANENT,  // retrying won't help (404, bad URL, SSL failure...)
+            CLIENT_ERROR // the attempt threw before it finished; not retried, and a failure as far as
+                         // the host's CircuitBreaker is concerned, since the host never answered
+        };
+
+        unsigned int max_attempts;     // including the first one
+        double initial_backoff;        // seconds before the first retry
+        double max_backoff;            // cap on any single delay, including Retry-After
+        double backoff_multiplier;
+        double jitter;                 // 0..1; that fraction of each delay is randomized
+        bool retry_non_idempotent;     // retry POSTs etc. after TRANSIENT failures too
+        bool honor_retry_after;
+        std::set<long> retryable_codes; // HTTP status codes treated as TRANSIENT
+
+        // GET, HEAD, PUT, DELETE, OPTIONS and TRACE
+        static bool isIdempotent(const std::string& method);
+        // Classifies an HTTP status code (>= 400)
+        FailureKind classifyStatus(long code) const;
+        // Whether an attempt that failed this way should be retried, ignoring the attempt count
+        bool shouldRetry(FailureKind kind, const std::string& method) const;
+        // Seconds to wait before attempt number attempt+1 (attempt counts from 1). random01 is a
+        // uniform random number in [0, 1); retry_after is the server's Retry-After in seconds, or < 0.
+        double delayFor(unsigned int attempt, double random01, double retry_after = -1) const;
+    };
+};
+
+#endif // H_HTTP_RETRYPOLICY
+
@@ -0,0 +1,399 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/filesystem/operations.hpp>
+#include "utf8_tools.h"
+#include "SystemHelpers.h"
+#include "logging.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "UploadJournal.h"
+
+using namespace HTTP;
+using boost::lexical_cast;
+
+namespace {
+    void sync_file(FILE* f) {
+        fflush(f);
+#ifdef _WIN32
+        _commit(_fileno(f));
+#else
+        fsync(fileno(f));
+#endif
+    }
+
+    uint32_t crc32(const std::string& str) {
+        boost::crc_32_type crc;
+        crc.process_bytes(str.data(), str.size());
+        return crc.checksum();
+    }
+
+    std::string escape(const std::string& in) {
+        std::string res;
+        res.reserve(in.size());
+        for (size_t i = 0; i < in.size(); ++i) {
+            switch (in[i]) {
+            case '\\': res += "\\\\"; break;
+            case '\t': res += "\\t"; break;
+            case '\n': res += "\\n"; break;
+            case '\r': res += "\\r"; break;
+            default: res += in[i];
+            }
+        }
+        return res;
+    }
+
+    std::string unescape(const std::string& in) {
+        std::string res;
+        res.reserve(in.size());
+        for (size_t i = 0; i < in.size(); ++i) {
+            if (in[i] != '\\' || i + 1 == in.size()) {
+                res += in[i];
+                continue;
+            }
+            switch (in[++i]) {
+            case 't': res += '\t'; break;
+            case 'n': res += '\n'; break;
+            case 'r': res += '\r'; break;
+            default: res += in[i];
+            }
+        }
+        return res;
+    }
+
+    UploadJournal::Record make_record(const std::string& type) {
+        return UploadJournal::Record(1, type);
+    }
+
+    UploadJournal::Record map_record(const std::string& type, const std::map<std::string, std::string>& vals) {
+        UploadJournal::Record rec(make_record(type));
+        for (std::map<std::string, std::string>::const_iterator it = vals.begin(); it != vals.end(); ++it) {
+            rec.push_back(it->first);
+            rec.push_back(it->second);
+        }
+        return rec;
+    }
+}
+
+UploadJournal::UploadJournal(const std::string& path, const QueueState& state)
+    : compactThreshold(512), m_path(path), m_state(state), m_recordsSinceCompact(0),
+      m_appended(1), m_written(0), m_stop(false) {
+    // The writer starts by writing state out as a fresh snapshot; that counts as the first append
+    m_thread = boost::thread(boost::bind(&UploadJournal::writerThread, this));
+}
+
+UploadJournal::~UploadJournal() {
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_stop = true;
+        m_cond.notify_all();
+    }
+    m_thread.join();
+}
+
+std::string UploadJournal::defaultPath(const std::string& appName, const std::string& queueName) {
+    std::string safeName(queueName);
+    for (size_t i = 0; i < safeName.size(); ++i) {
+        if (!isalnum(static_cast<unsigned char>(safeName[i])) && safeName[i] != '-' && safeName[i] != '_') safeName[i] = '_';
+    }
+    std::string dir(FB::System::getLocalAppDataPath(appName));
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(dir, ec);
+    return dir + "/upload-" + safeName + ".journal";
+}
+
+std::string UploadJournal::encode(const Record& rec) {
+    std::string payload;
+    for (Record::const_iterator it = rec.begin(); it != rec.end(); ++it) {
+        if (it != rec.begin()) payload += '\t';
+        payload += escape(*it);
+    }
+    return (boost::format("%08x") % crc32(payload)).str() + "\t" + payload + "\n";
+}
+
+bool UploadJournal::decode(const std::string& line, Record& rec) {
+    if (line.size() < 10 || line[8] != '\t') return false;
+    std::string payload(line.substr(9));
+    uint32_t expected;
+    if (sscanf(line.substr(0, 8).c_str(), "%8x", &expected) != 1 || crc32(payload) != expected) return false;
+
+    rec.clear();
+    size_t start = 0;
+    while (true) {
+        size_t end = payload.find('\t', start);
+        rec.push_back(unescape(payload.substr(start, end == std::string::npos ? std::string::npos : end - start)));
+        if (end == std::string::npos) break;
+        start = end + 1;
+    }
+    return true;
+}
+
+bool UploadJournal::apply(const Record& rec, QueueState& state) {
+    try {
+        const std::string& type = rec.at(0);
+        if (type == "Q" && rec.size() == 4) {
+            state.name = rec[1];
+            state.batch_size = lexical_cast<unsigned int>(rec[2]);
+            state.max_retries = lexical_cast<unsigned int>(rec[3]);
+        } else if ((type == "V" || type == "C") && rec.size() % 2 == 1) {
+            std::map<std::string, std::string>& vals = (type == "V") ? state.post_vars : state.cookies;
+            vals.clear();
+            for (size_t i = 1; i < rec.size(); i += 2) vals[rec[i]] = rec[i + 1];
+        } else if (type == "H" && rec.size() == 2) {
+            state.completion_handlers.push_back(FB::URI::fromString(rec[1]));
+        } else if (type == "A" && rec.size() == 6) {
+            EntryState& es = state.entries[lexical_cast<uint32_t>(rec[1])];
+            es = EntryState();
+            es.source_path = FB::utf8_to_wstring(rec[2]);
+            es.filename = FB::utf8_to_wstring(rec[3]);
+            es.target = FB::URI::fromString(rec[4]);
+            es.filesize = lexical_cast<uint32_t>(rec[5]);
+        } else if (type == "B" && rec.size() >= 2) {
+            uint32_t batch = lexical_cast<uint32_t>(rec[1]);
+            state.last_batch = std::max(state.last_batch, batch);
+            for (size_t i = 2; i < rec.size(); ++i) {
+                EntryState& es = state.entries.at(lexical_cast<uint32_t>(rec[i]));
+                es.status = UploadQueueEntry::ENTRY_IN_PROGRESS;
+                es.batch = batch;
+            }
+        } else if (type == "D" && rec.size() == 2) {
+            state.entries.at(lexical_cast<uint32_t>(rec[1])).status = UploadQueueEntry::ENTRY_COMPLETE;
+        } else if (type == "F" && rec.size() == 3) {
+            EntryState& es = state.entries.at(lexical_cast<uint32_t>(rec[1]));
+            es.status = UploadQueueEntry::ENTRY_ERROR;
+            es.result = rec[2];
+        } else if (type == "E" && rec.size() == 1) {
+            state.finished = true;
+        } else {
+            return false;
+        }
+    } catch (const std::exception&) {
+        // bad number, unknown entry id
+        return false;
+    }
+    return true;
+}
+
+void UploadJournal::snapshot(const QueueState& state, std::vector<Record>& out) {
+    Record q(make_record("Q"));
+    q.push_back(state.name);
+    q.push_back(lexical_cast<std::string>(state.batch_size));
+    q.push_back(lexical_cast<std::string>(state.max_retries));
+    out.push_back(q);
+    if (!state.post_vars.empty()) out.push_back(map_record("V", state.post_vars));
+    if (!state.cookies.empty()) out.push_back(map_record("C", state.cookies));
+    for (std::list<FB::URI>::const_iterator it = state.completion_handlers.begin(); it != state.completion_handlers.end(); ++it) {
+        Record h(make_record("H"));
+        h.push_back(it->toString());
+        out.push_back(h);
+    }
+
+    std::map<uint32_t, std::vector<uint32_t> > batches;
+    for (std::map<uint32_t, EntryState>::const_iterator it = state.entries.begin(); it != state.entries.end(); ++it) {
+        std::string id(lexical_cast<std::string>(it->first));
+        Record a(make_record("A"));
+        a.push_back(id);
+        a.push_back(FB::wstring_to_utf8(it->second.source_path));
+        a.push_back(FB::wstring_to_utf8(it->second.filename));
+        a.push_back(it->second.target.toString());
+        a.push_back(lexical_cast<std::string>(it->second.filesize));
+        out.push_back(a);
+
+        if (it->second.status == UploadQueueEntry::ENTRY_IN_PROGRESS) {
+            batches[it->second.batch].push_back(it->first);
+        } else if (it->second.status == UploadQueueEntry::ENTRY_COMPLETE) {
+            Record d(make_record("D"));
+            d.push_back(id);
+            out.push_back(d);
+        } else if (it->second.status == UploadQueueEntry::ENTRY_ERROR) {
+            Record f(make_record("F"));
+            f.push_back(id);
+            f.push_back(it->second.result);
+            out.push_back(f);
+        }
+    }
+    if (state.last_batch && batches.find(state.last_batch) == batches.end()) {
+        // Keeps batch numbers increasing across compactions
+        batches[state.last_batch];
+    }
+    for (std::map<uint32_t, std::vector<uint32_t> >::const_iterator it = batches.begin(); it != batches.end(); ++it) {
+        Record b(make_record("B"));
+        b.push_back(lexical_cast<std::string>(it->first));
+        for (size_t i = 0; i < it->second.size(); ++i) b.push_back(lexical_cast<std::string>(it->second[i]));
+        out.push_back(b);
+    }
+    if (state.finished) out.push_back(make_record("E"));
+}
+
+bool UploadJournal::recover(const std::string& path, QueueState& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::string contents;
+    char buf[16384];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) contents.append(buf, n);
+    fclose(f);
+
+    QueueState state;
+    bool have_queue = false;
+    size_t good_end = 0;
+    while (good_end < contents.size()) {
+        size_t eol = contents.find('\n', good_end);
+        if (eol == std::string::npos) break; // torn final write
+        Record rec;
+        if (!decode(contents.substr(good_end, eol - good_end), rec) || !apply(rec, state)) break;
+        have_queue = have_queue || rec[0] == "Q";
+        good_end = eol + 1;
+    }
+    if (good_end < contents.size()) {
+        FBLOG_WARN("UploadJournal", "Dropping " << (contents.size() - good_end) << " damaged bytes from the end of " << path);
+        try {
+            boost::filesystem::resize_file(path, good_end);
+        } catch (const std::exception& e) {
+            FBLOG_WARN("UploadJournal", "Could not truncate " << path << ": " << e.what());
+        }
+    }
+    if (!have_queue || state.finished) return false;
+    out = state;
+    return true;
+}
+
+void UploadJournal::batchStarted(uint32_t batch, const std::vector<uint32_t>& ids) {
+    Record rec(make_record("B"));
+    rec.push_back(lexical_cast<std::string>(batch));
+    for (size_t i = 0; i < ids.size(); ++i) rec.push_back(lexical_cast<std::string>(ids[i]));
+    append(rec);
+}
+
+void UploadJournal::entryCompleted(uint32_t id) {
+    Record rec(make_record("D"));
+    rec.push_back(lexical_cast<std::string>(id));
+    append(rec);
+}
+
+void UploadJournal::entryFailed(uint32_t id, const std::string& message) {
+    Record rec(make_record("F"));
+    rec.push_back(lexical_cast<std::string>(id));
+    rec.push_back(message);
+    append(rec);
+}
+
+void UploadJournal::cookiesChanged(const std::map<std::string, std::string>& cookies) {
+    append(map_record("C", cookies));
+}
+
+void UploadJournal::finished() {
+    append(make_record("E"));
+}
+
+void UploadJournal::append(const Record& rec) {
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_pending.push_back(rec);
+    ++m_appended;
+    m_cond.notify_all();
+}
+
+void UploadJournal::flush() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    size_t target = m_appended;
+    while (m_written < target) m_cond.wait(_l);
+}
+
+void UploadJournal::writeRecords(FILE* f, const std::vector<Record>& recs) {
+    std::string out;
+    for (std::vector<Record>::const_iterator it = recs.begin(); it != recs.end(); ++it) {
+        out += encode(*it);
+    }
+    if (f && fwrite(out.data(), 1, out.size(), f) != out.size()) {
+        FBLOG_WARN("UploadJournal", "Short write to " << m_path);
+    }
+}
+
+FILE* UploadJournal::compact() {
+    std::vector<Record> recs;
+    snapshot(m_state, recs);
+    std::string tmp_path(m_path + ".tmp");
+    FILE* tmp = fopen(tmp_path.c_str(), "wb");
+    if (!tmp) {
+        FBLOG_WARN("UploadJournal", "Could not write " << tmp_path << "; uploads won't be resumable");
+        return NULL;
+    }
+    writeRecords(tmp, recs);
+    sync_file(tmp);
+    fclose(tmp);
+    try {
+        // Atomic on POSIX, so a crash leaves either the old journal or the new one
+        boost::filesystem::rename(tmp_path, m_path);
+    } catch (const std::exception& e) {
+        FBLOG_WARN("UploadJournal", "Could not replace " << m_path << ": " << e.what());
+        return NULL;
+    }
+    m_recordsSinceCompact = 0;
+    return fopen(m_path.c_str(), "ab");
+}
+
+void UploadJournal::writerThread() {
+    FILE* f = compact();
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_written = 1;
+        m_cond.notify_all();
+    }
+
+    std::vector<Record> recs;
+    while (true) {
+        {
+            boost::mutex::scoped_lock _l(m_mutex);
+            while (m_pending.empty() && !m_stop) m_cond.wait(_l);
+            if (m_pending.empty()) break;
+            // Group commit: everything queued while the last sync was running goes out together
+            recs.assign(m_pending.begin(), m_pending.end());
+            m_pending.clear();
+        }
+
+        for (std::vector<Record>::const_iterator it = recs.begin(); it != recs.end(); ++it) {
+            apply(*it, m_state);
+        }
+        if (f) {
+            writeRecords(f, recs);
+            sync_file(f);
+        }
+        m_recordsSinceCompact += recs.size();
+
+        if (m_state.finished) {
+            if (f) fclose(f);
+            f = NULL;
+            boost::system::error_code ec;
+            boost::filesystem::remove(m_path, ec);
+        } else if (f && m_recordsSinceCompact > compactThreshold) {
+            fclose(f);
+            f = compact();
+        }
+
+        boost::mutex::scoped_lock _l(m_mutex);
+        m_written += recs.size();
+        m_cond.notify_all();
+    }
+    if (f) fclose(f);
+}
+
@@ -0,0 +1,126 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTP_UPLOADJOURNAL
+#define H_HTTP_UPLOADJOURNAL
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <list>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include "APITypes.h"
+#include "URI.h"
+#include "UploadQueueEntry.h"
+
+namespace HTTP {
+    class UploadJournal;
+    typedef boost::shared_ptr<UploadJournal> UploadJournalPtr;
+
+    // Append-only record of an UploadQueue's state, so that a queue interrupted by a crash or by
+    // the browser closing can be picked up again with UploadQueue::recover.
+    //
+    // Each record is one line: a CRC-32 of the rest of the line in hex, then tab separated fields.
+    // Recovery replays records up to the first one that is incomplete or fails its checksum (a
+    // torn write from the crash) and cuts the file off there. Records are written and synced by a
+    // background thread, so logging never blocks the upload's status callbacks; once more than
+    // compactThreshold records have piled up the thread replaces the file with a snapshot.
+    class UploadJournal : boost::noncopyable {
+    public:
+        struct EntryState {
+            EntryState() : filesize(0), status(UploadQueueEntry::ENTRY_WAITING), batch(0) {}
+
+            std::wstring source_path;
+            std::wstring filename;
+            FB::URI target;
+            uint32_t filesize;
+            UploadQueueEntry::Status status;
+            std::string result;
+            uint32_t batch; // batch the entry was last sent in, 0 if never
+        };
+
+        struct QueueState {
+            QueueState() : batch_size(0), max_retries(0), last_batch(0), finished(false) {}
+
+            std::string name;
+            unsigned int batch_size;
+            unsigned int max_retries;
+            std::map<std::string, std::string> post_vars;
+            std::map<std::string, std::string> cookies;
+            std::list<FB::URI> completion_handlers;
+            std::map<uint32_t, EntryState> entries;
+            uint32_t last_batch;
+            bool finished; // the queue ran to completion or was cancelled; nothing to resume
+        };
+
+        // Starts a new journal at path, replacing any existing file, beginning with state
+        UploadJournal(const std::string& path, const QueueState& state);
+        // Flushes outstanding records and stops the writer thread
+        ~UploadJournal();
+
+        // Reads the journal at path. Returns false if there is none or it holds nothing usable.
+        // A damaged tail is dropped, and the file truncated to the last good record.
+        static bool recover(const std::string& path, QueueState& out);
+
+        // <local app data>/<appName>/upload-<queueName>.journal; creates the directory if needed
+        static std::string defaultPath(const std::string& appName, const std::string& queueName);
+
+        void batchStarted(uint32_t batch, const std::vector<uint32_t>& ids);
+        void entryCompleted(uint32_t id);
+        void entryFailed(uint32_t id, const std::string& message);
+        void cookiesChanged(const std::map<std::string, std::string>& cookies);
+        // The queue is done; the journal file is removed once everything before it is written
+        void finished();
+
+        // Blocks until every record appended so far is on disk
+        void flush();
+
+        const std::string& getPath() const { return m_path; }
+        unsigned int compactThreshold;
+
+        typedef std::vector<std::string> Record;
+
+    protected:
+        static std::string encode(const Record& rec);
+        static bool decode(const std::string& line, Record& rec);
+        // false if the record is malformed or refers to an entry that doesn't exist
+        static bool apply(const Record& rec, QueueState& state);
+        static void snapshot(const QueueState& state, std::vector<Record>& out);
+
+        void append(const Record& rec);
+        void writerThread();
+        void writeRecords(FILE* f, const std::vector<Record>& recs);
+        FILE* compact();
+
+        std::string m_path;
+        QueueState m_state; // owned by the writer thread
+        unsigned int m_recordsSinceCompact;
+
+        boost::mutex m_mutex;
+        boost::condition_variable m_cond;
+        std::deque<Record> m_pending;
+        size_t m_appended;
+        size_t m_written;
+        bool m_stop;
+        boost::thread m_thread;
+    };
+};
+
+#endif // H_HTTP_UPLOADJOURNAL
+
@@ -16,7 +16,10 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include "HTTPRequest.h"
 #include "JSAPI.h"
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 #include "../HTTPCommon/Status.h"
+#include "../HTTPService/HTTPFileDatablock.h"
 #include "../HTTPCommon/Utils.h"
 #include "logging.h"
 
@@ -26,7 +29,7 @@ using namespace boost::algorithm;
 UploadQueue::UploadQueue( const std::string& _name )
     : name(_name), status(UPLOAD_IDLE), current_queue_bytes(0), current_batch_bytes(0), total_queue_bytes(0),
     total_queue_files(0), files_waiting(0), current_upload_request(NULL), current_batch_retry(0),
-    batch_size(8), max_retries(3)
+    batch_size(8), max_retries(3), last_entry_id(0), last_batch(0)
 {
 
 }
@@ -95,6 +98,7 @@ FB::VariantMap UploadQueue::getStatusDict(bool include_filenames) {
 
 void UploadQueue::dispatch() {
     status = UploadQueue::UPLOAD_IN_PROGRESS;
+    if (!journal_path.empty()) journal = boost::make_shared<UploadJournal>(journal_path, getJournalState());
     start_next_upload();
 
     // Deliver the first status dict to HTTP server. We need it to be there before this
@@ -111,6 +115,7 @@ void UploadQueue::dispatch() {
 
 void UploadQueue::start_next_upload() {
     unsigned int files_started = 0;
+    std::vector<uint32_t> batch_ids;
 
     boost::shared_ptr<HTTPRequestData> data(new HTTPRequestData);
     data->method = "POST";
@@ -156,18 +161,23 @@ void UploadQueue::start_next_upload() {
 
             current_upload_files.insert(qe.source_path);
             current_batch_bytes += qe.filesize;
+            batch_ids.push_back(qe.id);
             ++files_started;
             if (files_started >= batch_size) break;
 
         } catch (const std::exception& e) {
             it->result = e.what();
             it->setStatus(UploadQueueEntry::ENTRY_ERROR);
+            if (journal) journal->entryFailed(it->id, it->result);
         }
     }
 
     if (files_started) {
+        if (journal) journal->batchStarted(++last_batch, batch_ids);
+
         // We had enough images left in the queue for another request, so kick that off now.
         current_upload_request = HTTPRequest::create();
+        current_upload_request->setRetryPolicy(getRetryPolicy());
         current_upload_request->onStatusChanged(
             bind(&UploadQueue::upload_request_status_changed, this, _1)
             );
@@ -205,6 +215,7 @@ void UploadQueue::start_next_upload() {
 
         d["status"] = "Complete";
         status = UploadQueue::UPLOAD_COMPLETE;
+        finishJournal();
         // fire completion handlers, if available
         for (std::list<FB::URI>::iterator it = completion_handlers.begin();
             it != completion_handlers.end(); ++it) {
@@ -213,8 +224,10 @@ void UploadQueue::start_next_upload() {
             HTTPRequest::asyncStartRequest(reqdata);
         }
 
+        // The callback may drop the last reference the owner holds, and we still have an event to send
+        UploadQueuePtr self(shared_from_this());
         if (queue_finished_callback)
-            queue_finished_callback(shared_from_this());
+            queue_finished_callback(self);
         
         StatusUpdateEvent evt(d);
         SendEvent(&evt);
@@ -226,41 +239,30 @@ void UploadQueue::upload_request_status_changed(const HTTP::Status &status) {
     sendUpdateEvent();
 
     uint32_t this_batch_size = 0;
-    if (status.state == HTTP::Status::HTTP_ERROR) {
-        if ((++current_batch_retry) < max_retries) {
-            // Retry on networking error.
+    if (status.state == HTTP::Status::WAITING_TO_RETRY) {
+        // The request retries the batch itself (see getRetryPolicy); just let the plugin know
+        current_batch_retry = status.attempt;
 #ifndef NDEBUG
-            FBLOG_WARN("UploadQueue", "Retrying current batch on networking error ("
-                << status.last_error.c_str() << ")" << std::endl);
+        FBLOG_WARN("UploadQueue", "Retrying current batch on networking error ("
+            << status.last_error.c_str() << ")" << std::endl);
 #endif
-            // Retake ownership of the request data, dispose this request, and start a new one.
-            // The request data doesn't get mangled by the HTTPRequest object, it should be safe
-            // to reuse.
-            boost::shared_ptr<HTTPRequestData> req_data = current_upload_request->getRequest();
-            current_upload_request->threadSafeDestroy();
-            {
-                FB::VariantMap err;
-                // Notify the plugin that there was an error
-                err["status"] = "Error";
-                err["retries_remaining"] = max_retries - current_batch_retry;
-                err["message"] = status.last_error;
-                err["queueStatus"] = getStatusDict();
-                UploadErrorEvent evt(err);
-                SendEvent(&evt);
-            }
-
-            current_upload_request = HTTPRequest::create();
-            current_upload_request->onStatusChanged(
-                bind(&UploadQueue::upload_request_status_changed, this, _1)
-                );
-            current_upload_request->startRequest(req_data);
-            return;
-        }
+        FB::VariantMap err;
+        err["status"] = "Error";
+        err["retries_remaining"] = status.max_attempts - status.attempt;
+        err["retry_delay"] = status.retry_delay;
+        err["message"] = status.last_error;
+        err["queueStatus"] = getStatusDict();
+        UploadErrorEvent evt(err);
+        SendEvent(&evt);
+        return;
+    } else if (status.state == HTTP::Status::HTTP_ERROR) {
         {
-            // Notify the plugin that there was an error
+            // Notify the plugin that there was an error. Permanent errors (a 4xx from the
+            // endpoint, say) fail straight away instead of using up the retries.
             FB::VariantMap err;
             err["status"] = "Failed";
             err["retries_remaining"] = 0;
+            err["retryable"] = status.retryable;
             err["message"] = status.last_error;
             UploadErrorEvent evt(err);
             SendEvent(&evt);
@@ -269,6 +271,7 @@ void UploadQueue::upload_request_status_changed(const HTTP::Status &status) {
             if (it->status == UploadQueueEntry::ENTRY_IN_PROGRESS) {
                 this_batch_size += it->filesize;
                 it->onFailure(status.last_error);
+                if (journal) journal->entryFailed(it->id, it->result);
             }
         }
     } else if (status.state == HTTP::Status::COMPLETE) {
@@ -313,6 +316,7 @@ void UploadQueue::upload_request_status_changed(const HTTP::Status &status) {
                             << it->post_field.c_str() << ":" << stat_it->second.c_str() << std::endl);
 #endif
                         it->onFailure(stat_it->second);
+                        if (journal) journal->entryFailed(it->id, it->result);
                         had_error = true;
                     }
                 } else {
@@ -322,7 +326,10 @@ void UploadQueue::upload_request_status_changed(const HTTP::Status &status) {
 #endif
                 }
 
-                if (!had_error) it->setStatus(UploadQueueEntry::ENTRY_COMPLETE);
+                if (!had_error) {
+                    it->setStatus(UploadQueueEntry::ENTRY_COMPLETE);
+                    if (journal) journal->entryCompleted(it->id);
+                }
             }
         }
     } else return;
@@ -333,6 +340,7 @@ void UploadQueue::upload_request_status_changed(const HTTP::Status &status) {
             it != response->cookies.end(); ++it) {
             cookies[it->first] = it->second;
         }
+        if (journal && !response->cookies.empty()) journal->cookiesChanged(cookies);
     }
 
 
@@ -344,6 +352,15 @@ void UploadQueue::upload_request_status_changed(const HTTP::Status &status) {
     start_next_upload();
 }
 
+HTTP::RetryPolicy UploadQueue::getRetryPolicy() const {
+    RetryPolicy policy;
+    policy.max_attempts = max_retries;
+    // Uploads are POSTs, but the endpoint reports a status per file, so resending a batch whose
+    // response was lost is safe
+    policy.retry_non_idempotent = true;
+    return policy;
+}
+
 void UploadQueue::cancel() {
     if (current_upload_request) {
         HTTPRequest* r = current_upload_request;
@@ -355,6 +372,7 @@ void UploadQueue::cancel() {
 
     queue.clear();
     status = UploadQueue::UPLOAD_COMPLETE;
+    finishJournal();
     if (queue_finished_callback) queue_finished_callback(shared_from_this());
 }
 
@@ -379,6 +397,7 @@ void HTTP::UploadQueue::addFile( const UploadQueueEntry& qe )
     ++total_queue_files;
     ++files_waiting;
     queue.push_back(qe);
+    queue.back().id = ++last_entry_id;
 }
 
 bool HTTP::UploadQueue::removeFile( const std::wstring& source_path )
@@ -409,5 +428,97 @@ bool HTTP::UploadQueue::hasFile( const std::wstring& filename )
     return false;
 }
 
-void sendUpdateEvent();
+void HTTP::UploadQueue::enableJournal( const std::string& path )
+{
+    journal_path = path;
+    if (status == UPLOAD_IN_PROGRESS && !journal) journal = boost::make_shared<UploadJournal>(path, getJournalState());
+}
+
+void HTTP::UploadQueue::flushJournal()
+{
+    if (journal) journal->flush();
+}
+
+void HTTP::UploadQueue::finishJournal()
+{
+    if (!journal) return;
+    journal->finished();
+    journal.reset(); // waits for the writer to remove the file
+    journal_path.clear();
+}
+
+HTTP::UploadJournal::QueueState HTTP::UploadQueue::getJournalState() const
+{
+    UploadJournal::QueueState st;
+    st.name = name;
+    st.batch_size = batch_size;
+    st.max_retries = max_retries;
+    st.post_vars = post_vars;
+    st.cookies = cookies;
+    st.completion_handlers = completion_handlers;
+    st.last_batch = last_batch;
+    for (std::list<UploadQueueEntry>::const_iterator it = queue.begin(); it != queue.end(); ++it) {
+        UploadJournal::EntryState& es = st.entries[it->id];
+        es.source_path = it->source_path;
+        es.filename = it->filename;
+        es.target = it->target;
+        es.filesize = it->filesize;
+        es.status = it->status;
+        es.result = it->result;
+        if (it->status == UploadQueueEntry::ENTRY_IN_PROGRESS) es.batch = last_batch;
+    }
+    return st;
+}
+
+namespace {
+    HTTP::HTTPDatablock* open_source_file(const HTTP::UploadJournal::EntryState& es) {
+        return new HTTP::HTTPFileDatablock(FB::wstring_to_utf8(es.source_path));
+    }
+}
+
+HTTP::UploadQueuePtr HTTP::UploadQueue::recover( const std::string& path, const DatablockFactory& factory )
+{
+    UploadJournal::QueueState st;
+    if (!UploadJournal::recover(path, st)) return UploadQueuePtr();
+
+    UploadQueuePtr q(boost::make_shared<UploadQueue>(st.name));
+    q->batch_size = st.batch_size;
+    q->max_retries = st.max_retries;
+    q->post_vars = st.post_vars;
+    q->cookies = st.cookies;
+    q->completion_handlers = st.completion_handlers;
+    q->last_batch = st.last_batch;
+
+    for (std::map<uint32_t, UploadJournal::EntryState>::const_iterator it = st.entries.begin(); it != st.entries.end(); ++it) {
+        const UploadJournal::EntryState& es = it->second;
+        if (es.status == UploadQueueEntry::ENTRY_COMPLETE) continue;
+
+        UploadQueueEntry qe;
+        qe.source_path = es.source_path;
+        qe.filename = es.filename;
+        qe.target = es.target;
+        qe.filesize = es.filesize;
+        qe.result = es.result;
+        if (es.status != UploadQueueEntry::ENTRY_ERROR) {
+            try {
+                qe.datablock = factory ? factory(es) : open_source_file(es);
+            } catch (const std::exception& e) {
+                qe.onFailure(e.what());
+            }
+        } else {
+            qe.onFailure(es.result);
+        }
+
+        if (qe.status == UploadQueueEntry::ENTRY_ERROR) {
+            // Still reported in failed_files when the queue finishes
+            q->queue.push_back(qe);
+        } else {
+            q->addFile(qe);
+        }
+        q->queue.back().id = it->first;
+        q->last_entry_id = std::max(q->last_entry_id, it->first);
+    }
+    q->enableJournal(path);
+    return q;
+}
 
@@ -19,6 +19,8 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include <list>
 #include "URI.h"
 #include "UploadQueueEntry.h"
+#include "RetryPolicy.h"
+#include "UploadJournal.h"
 #include "PluginEventSource.h"
 #include "PluginEvent.h"
 
@@ -60,6 +62,21 @@ namespace HTTP {
         void cancel();
     
         void addCompletionHandler(const FB::URI& uri);
+
+        // Keep a journal at path (see UploadJournal::defaultPath) from dispatch() until the queue
+        // finishes, so the uploads can be resumed with recover() if the process dies part way.
+        // Entries are written as done a little after the endpoint acknowledges them, so a resumed
+        // queue may send a file the endpoint already has.
+        void enableJournal(const std::string& path);
+        void flushJournal();
+
+        // Makes the datablock to upload a recovered entry from; may throw if the file is gone
+        typedef boost::function<HTTPDatablock* (const UploadJournal::EntryState&)> DatablockFactory;
+        // Rebuilds the queue journaled at path, or returns an empty pointer if there is nothing
+        // to resume. Files that were in flight go back to waiting and files already uploaded are
+        // left out; the queue keeps journaling to path once dispatched. By default the datablocks
+        // are HTTPFileDatablocks reading source_path.
+        static UploadQueuePtr recover(const std::string& path, const DatablockFactory& factory = DatablockFactory());
     
         // ---
         std::string name;
@@ -88,16 +105,26 @@ namespace HTTP {
     
         std::set<std::wstring> current_upload_files;
         HTTPRequest* current_upload_request;
-        unsigned int current_batch_retry; // incremented every time we retry a batch due to networking failure, zeroed on a new batch.
+        unsigned int current_batch_retry; // attempt number of the current batch's request, zeroed on a new batch.
     
         boost::function<void(UploadQueuePtr)> queue_finished_callback;
         std::list<FB::URI> completion_handlers;
         unsigned int batch_size;
-        unsigned int max_retries;
+        unsigned int max_retries; // attempts per batch, including the first
+
+        // Policy for batch requests; override to change backoff or which failures are retried
+        virtual RetryPolicy getRetryPolicy() const;
     protected:
+        UploadJournal::QueueState getJournalState() const;
+        void finishJournal();
         void sendUpdateEvent();
         void start_next_upload();
         void upload_request_status_changed(const HTTP::Status& status);
+
+        std::string journal_path;
+        UploadJournalPtr journal;
+        uint32_t last_entry_id;
+        uint32_t last_batch;
     };
 };
 #endif // UploadQueue_h__
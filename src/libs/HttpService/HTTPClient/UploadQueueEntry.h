@@ -26,6 +26,7 @@ namespace HTTP {
         FB::URI target;
     
         HTTPDatablock* datablock; // source datablock for upload
+        uint32_t id; // assigned by the queue; names the entry in the queue's journal
     
         uint32_t filesize; // given that the datablock can be an ImageDatablock which is lazy-evaluated, this might
         // not be an accurate size. It's just for guessing when the queue will be finished, anyway...
@@ -44,7 +45,7 @@ namespace HTTP {
         void setStatus(Status _st) { status = _st; }
         void onFailure(const std::string& errmsg) { status = ENTRY_ERROR; result = errmsg; }
     
-        UploadQueueEntry() : status(ENTRY_WAITING) {}
+        UploadQueueEntry() : datablock(NULL), id(0), status(ENTRY_WAITING) {}
     };
 };
 
@@ -27,7 +27,9 @@ std::string HTTPException::getResponseHeader() const {
       RC(403, "Forbidden")
       RC(404, "Not Found")
       RC(405, "Method Not Allowed")
+      RC(413, "Request Entity Too Large")
       RC(415, "Unsupported Media Type")
+      RC(429, "Too Many Requests")
         default:
       RC(500, "Internal Server Error")
       RC(501, "Not Implemented")
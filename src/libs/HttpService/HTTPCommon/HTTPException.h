@@ -28,6 +28,7 @@ namespace HTTP {
         virtual ~HTTPException() throw() { free(msg); }
         virtual const char* what() const throw() { return msg; }
         std::string getResponseHeader() const;
+        short getResponseCode() const { return response_code; }
     protected:
         short response_code;
         char* msg;
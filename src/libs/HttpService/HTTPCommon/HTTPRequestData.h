@@ -25,6 +25,17 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 
 namespace HTTP {
 
+    // Identity of the process on the other end of a connection to the service. Only Unix domain
+    // socket connections carry this; for TCP connections valid is false.
+    struct PeerCredentials {
+        PeerCredentials() : valid(false), pid(0), uid(0), gid(0) {}
+
+        bool valid;
+        long pid; // 0 where the platform doesn't report it (Mac)
+        unsigned long uid;
+        unsigned long gid;
+    };
+
     class HTTPRequestData {
     public:
         friend class HTTPRequest;
@@ -37,6 +48,11 @@ namespace HTTP {
         std::multimap<std::string, std::string> headers;
         std::map<std::string, std::string> cookies;
         std::map<std::string, HTTPFileEntry> files;
+        // Filled in by BasicService for requests received on a Unix domain socket
+        PeerCredentials peer;
+        // The request body, as sent with Content-Length; BasicService reads up to
+        // BasicService::max_request_body bytes of it
+        std::string body;
 
         void addFile(const std::string& fieldname, const std::string& filename, const std::string& content_type, HTTPDatablock* contents);
     };
@@ -24,7 +24,11 @@ FB::VariantMap HTTP::Status::asDict() const {
     d["receive_total"] = receive_total;
     d["bytes_per_second_send"] = bytes_per_second_send;
     d["bytes_per_second_receive"] = bytes_per_second_receive;
+    d["attempt"] = attempt;
+    d["max_attempts"] = max_attempts;
+    if (state == WAITING_TO_RETRY) d["retry_delay"] = retry_delay;
     if (!last_error.empty()) d["error"] = last_error;
+    if (state == HTTP_ERROR) d["retryable"] = retryable;
     return d;
 }
 
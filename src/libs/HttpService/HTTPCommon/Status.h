@@ -29,6 +29,7 @@ namespace HTTP {
             SEND_REQUEST = 3,
             READ_RESPONSE = 4,
             COMPLETE = 5,
+            WAITING_TO_RETRY = 6, // an attempt failed; the next one starts after retry_delay
         };
         State state;
         size_t bytes_sent;
@@ -38,9 +39,14 @@ namespace HTTP {
         double bytes_per_second_send;
         double bytes_per_second_receive;
         std::string last_error;
+        unsigned int attempt; // counts from 1
+        unsigned int max_attempts;
+        double retry_delay; // seconds, while WAITING_TO_RETRY
+        bool retryable; // with HTTP_ERROR: the failure was transient, but retries ran out or weren't allowed
 
         Status() : state(IDLE), bytes_sent(0), send_total(0), bytes_received(0), receive_total(0),
-            bytes_per_second_send(0), bytes_per_second_receive(0) {}
+            bytes_per_second_send(0), bytes_per_second_receive(0), attempt(0), max_attempts(1), retry_delay(0),
+            retryable(false) {}
     };
 };
 
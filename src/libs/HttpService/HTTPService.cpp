@@ -32,6 +32,16 @@ boost::shared_ptr<HTTPService> HTTPService::create(const std::string ipaddr, con
     return svc;
 }
 
+boost::shared_ptr<HTTPService> HTTPService::createLocal(const std::string socketPath, const std::string hostname) {
+    boost::shared_ptr<BasicService> svc(new BasicService(socketPath, hostname));
+    svc->init();
+    {
+        boost::recursive_mutex::scoped_lock _l(instance_set_lock);
+        instances.push_back(svc);
+    }
+    return svc;
+}
+
 void HTTPService::terminateAllInstances() {
     boost::recursive_mutex::scoped_lock _l(instance_set_lock);
     while (!instances.empty()) {
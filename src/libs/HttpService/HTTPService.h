@@ -22,15 +22,25 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include <boost/thread/recursive_mutex.hpp>
 #include <string>
 #include <vector>
+#include <list>
 #include <map>
 #include "URI.h"
 #include "HTTPService/HTTPHandler.h"
 
 namespace HTTP {
+    class MetricsRegistry;
+
     class HTTPService : public boost::enable_shared_from_this<HTTPService>
     {
     public:
+        typedef std::list<boost::shared_ptr<HTTPHandler> > HandlerList;
+
         static boost::shared_ptr<HTTPService> create(const std::string ipaddr = "127.0.0.1", const int port = 0, const std::string hostname = "localhost");
+        // Creates a service that listens only on a Unix domain socket. A path starting with '@' names
+        // a socket in the Linux abstract namespace; anything else is a filesystem path. A socket file
+        // nobody listens on any more is replaced; anything else already at the path makes this throw
+        // std::runtime_error. terminate() removes the file again, unless it has been replaced since.
+        static boost::shared_ptr<HTTPService> createLocal(const std::string socketPath, const std::string hostname = "localhost");
         HTTPService() { };
         virtual ~HTTPService() { };
 
@@ -43,11 +53,50 @@ namespace HTTP {
 
         virtual void registerHandler(boost::shared_ptr<HTTPHandler> hnd) = 0;
         virtual void deregisterHandler(boost::shared_ptr<HTTPHandler> hnd) = 0;
+        // Replaces every registered handler at once. Each request sees either the old set or the new
+        // one, never a mix; requests already being handled finish with the set they started with.
+        virtual void setHandlers(const HandlerList& hnds) = 0;
+        virtual HandlerList getHandlers() const = 0;
 
         // While this is enabled, the service will hold a reference to itself that it will release when
         // the builtin URI "/shutdown" is accessed.
         virtual void setDeferShutdown(bool val) = 0;
 
+        // Also accept connections on a Unix domain socket (see createLocal). Requests arriving there
+        // are handled exactly like TCP requests, but carry the peer's credentials in
+        // HTTPRequestData::peer. Throws std::runtime_error where local sockets aren't supported.
+        virtual void listenLocal(const std::string& socketPath) = 0;
+        // Path of the Unix domain socket being listened on, or empty if there is none
+        virtual std::string getLocalPath() const = 0;
+
+        // Request, session and per-handler metrics for this service
+        virtual MetricsRegistry& getMetrics() = 0;
+        // Serve getMetrics() in Prometheus text format at this path (e.g. "/metrics"); empty, the
+        // default, turns the endpoint off. The path needs no signature.
+        virtual void setMetricsPath(const std::string& path) = 0;
+
+        // Starts accepting TCP connections on another address while the service is running, and
+        // returns the port it got (useful when port is 0). Throws boost::system::system_error if the
+        // address can't be bound.
+        virtual int addListener(const std::string& ipaddr, const int port) = 0;
+        // Retires the listener on port without affecting the others. It stops accepting at once, and
+        // getBaseUri() moves on to the next listener; connections already open have drainTimeoutMs
+        // to finish, and are closed if they haven't by then.
+        virtual void removeListener(const int port, const long drainTimeoutMs = 5000) = 0;
+        // Connections accepted on port (or on every listener, if port is 0) that haven't closed yet
+        virtual size_t getOpenConnections(const int port = 0) const = 0;
+
+        // Grows or shrinks the pool of threads handling requests, without stopping the service. A
+        // thread being retired finishes what it's doing first. The pool is FB::Reactor's, which
+        // every service, timer and HTTPRequest in the plugin shares.
+        virtual void setThreadCount(const size_t count) = 0;
+        virtual size_t getThreadCount() const = 0;
+        // Requests with a longer body are refused with 413; applies to requests read from now on
+        virtual void setMaxRequestBody(const size_t bytes) = 0;
+
+        // Where the oldest TCP listener still accepting can be reached. If there is none, e.g. once
+        // the last one is removed or for a service only on a local socket, the URI is empty: no
+        // domain and port 0.
         virtual FB::URI getBaseUri() const = 0;
         // Add a signature to a URI (via a GET param). Only the path is signed, so you can still
         // change GET params however you like without causing the verification to fail.
@@ -24,6 +24,8 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <stdexcept>
+#include <typeinfo>
 #include "Platform/Platform.h"
 #include "logging.h"
 #include "../HTTPCommon/HTTPRequestData.h"
@@ -34,6 +36,10 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 #include "HTTPService.h"
 
 #include "BasicService.h"
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 using namespace boost::algorithm;
 using namespace boost::asio;
@@ -49,51 +55,158 @@ using std::vector;
 
 using namespace HTTP;
 
+namespace {
+    std::string label_value(const std::string& val) {
+        std::string res;
+        for (size_t i = 0; i < val.size(); ++i) {
+            if (val[i] == '\\' || val[i] == '"') res += '\\';
+            if (val[i] == '\n') res += "\\n";
+            else res += val[i];
+        }
+        return res;
+    }
+}
+
 void BasicService::registerHandler(boost::shared_ptr<HTTPHandler> hnd) {
-    handlers.push_back(hnd);
+    HandlerMetrics hm(make_handler_metrics(hnd));
+    boost::mutex::scoped_lock _l(config_mutex);
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>(*config));
+    cfg->handlers.push_back(hnd);
+    cfg->handler_metrics[hnd.get()] = hm;
+    config = cfg;
 }
 
 void BasicService::deregisterHandler(boost::shared_ptr<HTTPHandler> hnd) {
-    handlers.remove(hnd);
+    boost::mutex::scoped_lock _l(config_mutex);
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>(*config));
+    cfg->handlers.remove(hnd);
+    cfg->handler_metrics.erase(hnd.get());
+    config = cfg;
+}
+
+void BasicService::setHandlers(const HandlerList& hnds) {
+    std::map<HTTPHandler*, HandlerMetrics> hms;
+    for (HandlerList::const_iterator it = hnds.begin(); it != hnds.end(); ++it) {
+        hms[it->get()] = make_handler_metrics(*it);
+    }
+    boost::mutex::scoped_lock _l(config_mutex);
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>(*config));
+    cfg->handlers = hnds;
+    cfg->handler_metrics.swap(hms);
+    config = cfg;
+}
+
+HTTPService::HandlerList BasicService::getHandlers() const {
+    return get_config()->handlers;
+}
+
+BasicService::ConfigPtr BasicService::get_config() const {
+    boost::mutex::scoped_lock _l(config_mutex);
+    return config;
 }
 
 BasicService::BasicService(const std::string &ipaddr, const int port, const std::string &hostname)
     : signing_key(NULL),
       signing_key_length(0),
-      srv_acceptor(service),
+      reactor(FB::Reactor::instance()),
+      service(reactor->getIOService()),
+      shutdown_hook(0),
+      use_tcp(true),
       srv_endpoint(ip::tcp::endpoint(ip::address_v4::from_string(ipaddr.c_str()), port)),
-      m_hostname(hostname) { }
+      terminated(false),
+      m_hostname(hostname)
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+      , local_acceptor(service), m_localDev(0), m_localIno(0)
+#endif
+{
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>());
+    cfg->max_request_body = default_max_request_body;
+    config = cfg;
+}
+
+BasicService::BasicService(const std::string &socketPath, const std::string &hostname)
+    : signing_key(NULL),
+      signing_key_length(0),
+      reactor(FB::Reactor::instance()),
+      service(reactor->getIOService()),
+      shutdown_hook(0),
+      use_tcp(false),
+      terminated(false),
+      m_hostname(hostname),
+      m_localPath(socketPath)
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+      , local_acceptor(service), m_localDev(0), m_localIno(0)
+#endif
+{
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>());
+    cfg->max_request_body = default_max_request_body;
+    config = cfg;
+}
 
 // Init() needs to be separate so that shared_from_this can give the shared_ptr to the workers in do_async_accept() without exploding everything
 // It's weird, but it works. Read the docs on boost::weak_ptr and enable_shared_from_this for more information.
 void BasicService::init() {
+    init_metrics();
+    _weak_ref = self();
+    shutdown_hook = reactor->addShutdownHook("http-service", boost::bind(&BasicService::handle_reactor_shutdown, _weak_ref));
+
     // Initialize presalted hash state
     signing_key_length = 2048;
     signing_key = Platform::getRandomBytes(signing_key_length);
 
     // Bind and open acceptor socket
-    srv_acceptor.open(srv_endpoint.protocol());
-    srv_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
-    srv_acceptor.bind(srv_endpoint);
-    srv_acceptor.listen();
-    srv_endpoint = srv_acceptor.local_endpoint();
-    FBLOG_INFO("HTTP:Service", "Started server on " << srv_endpoint.port());
-    do_async_accept();
-
-    // Start worker threadpool.
-    for (std::size_t i = 0; i < threadpool_size; ++i) {
-        shared_ptr<boost::thread> thread(new boost::thread(boost::bind(&BasicService::_worker_thread_entry, this)));
-        threadpool.push_back(thread);
+    if (use_tcp) {
+        ListenerPtr listener(open_listener(srv_endpoint));
+        srv_endpoint = listener->endpoint;
+        FBLOG_INFO("HTTP:Service", "Started server on " << srv_endpoint.port());
+    }
+    if (!use_tcp) {
+        listenLocal(m_localPath);
     }
 }
 
+boost::shared_ptr<BasicService> BasicService::self() {
+    return boost::dynamic_pointer_cast<BasicService>(shared_from_this());
+}
+
+void BasicService::handle_reactor_shutdown(const boost::weak_ptr<BasicService>& weak) {
+    boost::shared_ptr<BasicService> svc(weak.lock());
+    if (svc) svc->terminate();
+}
+
 void BasicService::terminate() {
-    service.stop();
-    srv_acceptor.close();
-    for (size_t i = 0; i < threadpool.size(); ++i) {
-        threadpool[i]->interrupt();
+    // The reactor is shared, so rather than stopping it, close everything the service has on it;
+    // the handlers still queued then fail and let go of their sessions
+    std::list<ListenerPtr> closing;
+    int hook = 0;
+    {
+        boost::mutex::scoped_lock _l(listeners_mutex);
+        terminated = true;
+        closing.swap(listeners);
+        if (local_listener) closing.push_back(local_listener);
+        std::swap(hook, shutdown_hook);
+    }
+    if (hook) reactor->removeShutdownHook(hook);
+    for (std::list<ListenerPtr>::iterator it = closing.begin(); it != closing.end(); ++it) {
+        boost::system::error_code ec;
+        (*it)->acceptor.close(ec);
+        boost::mutex::scoped_lock _l((*it)->mutex);
+        for (std::set<Session*>::const_iterator sess = (*it)->sessions.begin(); sess != (*it)->sessions.end(); ++sess) {
+            (*sess)->abort();
+        }
     }
-    threadpool.clear();
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (local_acceptor.is_open()) {
+        boost::system::error_code ec;
+        local_acceptor.close(ec);
+        // Only if the file is still the socket we bound, not something that has replaced it since
+        struct stat st;
+        if (m_localPath[0] != '@' && ::lstat(m_localPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)
+            && st.st_dev == m_localDev && st.st_ino == m_localIno) {
+            ::unlink(m_localPath.c_str());
+        }
+    }
+#endif
     deferred_shutdown_ref.reset();
 }
 
@@ -102,13 +215,20 @@ BasicService::~BasicService() {
     delete[] signing_key;
 }
 
-void BasicService::_worker_thread_entry() {
-    try {
-        service.run();
-    } catch (...) {
-        // Don't let exceptions escape from the io_service, that'd result
-        // in terminate() getting called. All bad.
-    }
+void BasicService::setThreadCount(const size_t count) {
+    if (count == 0) throw std::invalid_argument("The service needs at least one thread");
+    reactor->setThreadCount(count);
+}
+
+size_t BasicService::getThreadCount() const {
+    return reactor->getThreadCount();
+}
+
+void BasicService::setMaxRequestBody(const size_t bytes) {
+    boost::mutex::scoped_lock _l(config_mutex);
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>(*config));
+    cfg->max_request_body = bytes;
+    config = cfg;
 }
 
 void BasicService::setDeferShutdown(bool val) {
@@ -116,14 +236,89 @@ void BasicService::setDeferShutdown(bool val) {
     else deferred_shutdown_ref.reset();
 }
 
+void BasicService::listenLocal(const std::string& socketPath) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (socketPath.empty() || local_acceptor.is_open()) {
+        throw std::runtime_error("Invalid or duplicate Unix domain socket path");
+    }
+    m_localPath = socketPath;
+    open_local_acceptor();
+    local_listener.reset(new Listener(service));
+    FBLOG_INFO("HTTP:Service", "Started server on " << m_localPath);
+    do_async_local_accept();
+#else
+    throw std::runtime_error("Unix domain sockets are not supported on this platform");
+#endif
+}
+
+std::string BasicService::getLocalPath() const {
+    return m_localPath;
+}
+
+void BasicService::setMetricsPath(const std::string& path) {
+    boost::mutex::scoped_lock _l(config_mutex);
+    boost::shared_ptr<Config> cfg(boost::make_shared<Config>(*config));
+    cfg->metrics_path = path;
+    config = cfg;
+}
+
+void BasicService::init_metrics() {
+    static const char* state_names[SESSION_STATE_COUNT] = { "idle", "reading", "handling", "writing" };
+    for (int i = SESSION_READING; i < SESSION_STATE_COUNT; ++i) {
+        session_states[i] = metrics.gauge("http_sessions", "Open sessions by state",
+            std::string("state=\"") + state_names[i] + "\"");
+    }
+    sessions_total = metrics.counter("http_sessions_total", "Connections accepted");
+    response_bytes = metrics.counter("http_response_bytes_total", "Bytes of response headers and bodies sent");
+    read_errors = metrics.counter("http_errors_total", "Connections that failed", "stage=\"read\"");
+    write_errors = metrics.counter("http_errors_total", "Connections that failed", "stage=\"write\"");
+    static const unsigned int common_codes[] = { 200, 204, 206, 301, 302, 304, 400, 401, 403, 404, 405, 413, 416, 429, 500, 503 };
+    for (size_t i = 0; i < sizeof(common_codes) / sizeof(common_codes[0]); ++i) {
+        response_counters[common_codes[i]] = make_response_counter(common_codes[i]);
+    }
+}
+
+CounterPtr BasicService::make_response_counter(unsigned int code) {
+    return metrics.counter("http_responses_total", "Responses sent, by status code",
+        "code=\"" + lexical_cast<string>(code) + "\"");
+}
+
+// The registry hands back the same metrics for handlers with the same name, so a handler that is
+// registered again keeps counting where it left off
+BasicService::HandlerMetrics BasicService::make_handler_metrics(const boost::shared_ptr<HTTPHandler>& hnd) {
+    std::string name = hnd->getMetricsName();
+    if (name.empty()) name = typeid(*hnd).name();
+    std::string labels = "handler=\"" + label_value(name) + "\"";
+    HandlerMetrics res;
+    res.requests = metrics.counter("http_handler_requests_total", "Requests offered to the handler", labels);
+    res.responses = metrics.counter("http_handler_responses_total", "Requests the handler answered", labels);
+    res.errors = metrics.counter("http_handler_errors_total", "Requests for which the handler threw", labels);
+    res.latency = metrics.histogram("http_handler_duration_seconds", "Time spent in handleRequest", labels);
+    return res;
+}
+
 FB::URI BasicService::getBaseUri() const {
+    ListenerPtr listener;
+    {
+        // The oldest listener that is still accepting
+        boost::mutex::scoped_lock _l(listeners_mutex);
+        for (std::list<ListenerPtr>::const_iterator it = listeners.begin(); it != listeners.end(); ++it) {
+            if (!(*it)->retired) {
+                listener = *it;
+                break;
+            }
+        }
+    }
     FB::URI res;
+    // A port that has been retired would only be turned away
+    if (!listener) return res;
+    const ip::tcp::endpoint& endpoint(listener->endpoint);
     res.protocol = "http";
-    res.port = srv_endpoint.port();
+    res.port = endpoint.port();
     if (!m_hostname.empty()) {
         res.domain = m_hostname;
     } else {
-        res.domain = srv_endpoint.address().to_string();
+        res.domain = endpoint.address().to_string();
     }
     res.path = "/";
     return res;
@@ -161,18 +356,178 @@ bool BasicService::check_uri_signature(const FB::URI& in_uri) {
     return (base64_decode(it->second) == tiger_hmac(in_uri.path));
 }
 
-void BasicService::do_async_accept() {
-    Session::ptr sp = new Session(service);
-    srv_acceptor.async_accept(sp->socket(), boost::bind(&BasicService::handle_accept, this, _1, sp));
+int BasicService::addListener(const std::string& ipaddr, const int port) {
+    ListenerPtr listener(open_listener(ip::tcp::endpoint(ip::address_v4::from_string(ipaddr.c_str()), port)));
+    FBLOG_INFO("HTTP:Service", "Also listening on " << listener->endpoint.port());
+    return listener->endpoint.port();
+}
+
+BasicService::ListenerPtr BasicService::open_listener(const ip::tcp::endpoint& endpoint) {
+    ListenerPtr listener(new Listener(service));
+    listener->acceptor.open(endpoint.protocol());
+    listener->acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    listener->acceptor.bind(endpoint);
+    listener->acceptor.listen();
+    listener->endpoint = listener->acceptor.local_endpoint();
+    {
+        boost::mutex::scoped_lock _l(listeners_mutex);
+        listeners.push_back(listener);
+    }
+    listener->strand.dispatch(boost::bind(&BasicService::do_async_accept, self(), listener));
+    return listener;
+}
+
+void BasicService::removeListener(const int port, const long drainTimeoutMs) {
+    ListenerPtr listener;
+    {
+        boost::mutex::scoped_lock _l(listeners_mutex);
+        for (std::list<ListenerPtr>::iterator it = listeners.begin(); it != listeners.end(); ++it) {
+            if (!(*it)->retired && (*it)->endpoint.port() == port) {
+                listener = *it;
+                break;
+            }
+        }
+        if (!listener) throw std::runtime_error("Not listening on port " + lexical_cast<string>(port));
+        // Marked here so getBaseUri moves on at once
+        listener->retired = true;
+    }
+    // Nothing new is accepted; the connections already open have the window to finish
+    listener->strand.dispatch(boost::bind(&BasicService::close_listener, self(), listener));
+    FBLOG_INFO("HTTP:Service", "Retiring listener on " << port << "; " << getOpenConnections(port)
+        << " connections have " << drainTimeoutMs << "ms to finish");
+
+    boost::shared_ptr<deadline_timer> timer(new deadline_timer(service));
+    timer->expires_from_now(boost::posix_time::milliseconds(drainTimeoutMs));
+    timer->async_wait(boost::bind(&BasicService::handle_drain_deadline_weak, _weak_ref, listener, timer));
+}
+
+void BasicService::handle_drain_deadline_weak(const boost::weak_ptr<BasicService>& weak, const ListenerPtr& listener,
+    boost::shared_ptr<deadline_timer> timer) {
+    // A service that has gone away already closed everything in terminate
+    boost::shared_ptr<BasicService> svc(weak.lock());
+    if (svc) svc->handle_drain_deadline(listener);
 }
 
-void BasicService::handle_accept(const boost::system::error_code& ec, BasicService::Session::ptr acc_sess) {
+void BasicService::close_listener(const ListenerPtr& listener) {
+    listener->closed = true;
+    boost::system::error_code ec;
+    listener->acceptor.cancel(ec);
+    // Closing resets connections the kernel has already completed but we haven't accepted; those
+    // clients are already connected, so take them first and let them drain with the rest
+    listener->acceptor.non_blocking(true, ec);
+    while (!ec) {
+        Session::ptr sp(new TcpSession(service));
+        listener->acceptor.accept(static_cast<TcpSession*>(sp.get())->socket(), ec);
+        if (!ec) start_session(sp, listener);
+    }
+    listener->acceptor.close(ec);
+}
+
+void BasicService::handle_drain_deadline(const ListenerPtr& listener) {
+    {
+        boost::mutex::scoped_lock _l(listener->mutex);
+        if (!listener->sessions.empty()) {
+            FBLOG_WARN("HTTP:Service", "Closing " << listener->sessions.size() << " connections on retired port "
+                << listener->endpoint.port() << " that didn't finish in time");
+        }
+        for (std::set<Session*>::const_iterator it = listener->sessions.begin(); it != listener->sessions.end(); ++it) {
+            (*it)->abort();
+        }
+    }
+    boost::mutex::scoped_lock _l(listeners_mutex);
+    listeners.remove(listener);
+}
+
+size_t BasicService::getOpenConnections(const int port) const {
+    size_t count = 0;
+    boost::mutex::scoped_lock _l(listeners_mutex);
+    for (std::list<ListenerPtr>::const_iterator it = listeners.begin(); it != listeners.end(); ++it) {
+        if (port && (*it)->endpoint.port() != port) continue;
+        boost::mutex::scoped_lock _sl((*it)->mutex);
+        count += (*it)->sessions.size();
+    }
+    return count;
+}
+
+void BasicService::do_async_accept(const ListenerPtr& listener) {
+    if (listener->closed) return;
+    TcpSession* sess = new TcpSession(service);
+    Session::ptr sp(sess);
+    listener->acceptor.async_accept(sess->socket(),
+        listener->strand.wrap(boost::bind(&BasicService::handle_accept_weak, _weak_ref, _1, sp, listener)));
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+void BasicService::open_local_acceptor() {
+    std::string path(m_localPath);
+    if (path[0] == '@') {
+        // Abstract namespace: the name starts with a NUL and never appears in the filesystem
+        path[0] = '\0';
+    } else {
+        // A socket file left behind by a previous instance would make bind fail.  Only remove it if
+        // it really is a socket, and nobody answers on it; anything else at the path is left alone
+        struct stat st;
+        if (::lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode))
+                throw std::runtime_error("Can't listen on " + path + ": it exists and is not a socket");
+            local::stream_protocol::socket probe(service);
+            boost::system::error_code ec;
+            probe.connect(local::stream_protocol::endpoint(path), ec);
+            if (!ec)
+                throw std::runtime_error("Can't listen on " + path + ": another server is listening on it");
+            if (ec != boost::asio::error::connection_refused)
+                throw std::runtime_error("Can't listen on " + path + ": " + ec.message());
+            ::unlink(path.c_str());
+        }
+    }
+    local::stream_protocol::endpoint ep(path);
+    local_acceptor.open(ep.protocol());
+    local_acceptor.bind(ep);
+    local_acceptor.listen();
+    struct stat st;
+    if (m_localPath[0] != '@' && ::lstat(path.c_str(), &st) == 0) {
+        m_localDev = st.st_dev;
+        m_localIno = st.st_ino;
+    }
+}
+
+void BasicService::do_async_local_accept() {
+    LocalSession* sess = new LocalSession(service);
+    Session::ptr sp(sess);
+    local_acceptor.async_accept(sess->socket(), boost::bind(&BasicService::handle_accept_weak, _weak_ref, _1, sp, ListenerPtr()));
+}
+#endif
+
+void BasicService::start_session(const Session::ptr& acc_sess, const ListenerPtr& listener) {
+    boost::shared_ptr<BasicService> service(boost::dynamic_pointer_cast<BasicService>(shared_from_this()));
+    sessions_total->inc();
+    if (listener) acc_sess->attach_listener(listener);
+    acc_sess->start(service);
+}
+
+void BasicService::handle_accept_weak(const boost::weak_ptr<BasicService>& weak, const boost::system::error_code& ec,
+    BasicService::Session::ptr acc_sess, ListenerPtr listener) {
+    boost::shared_ptr<BasicService> svc(weak.lock());
+    if (svc) svc->handle_accept(ec, acc_sess, listener);
+}
+
+void BasicService::handle_accept(const boost::system::error_code& ec, BasicService::Session::ptr acc_sess, ListenerPtr listener) {
+    {
+        // After terminate the acceptor is closed, and accepting again would only fail again
+        boost::mutex::scoped_lock _l(listeners_mutex);
+        if (terminated) return;
+    }
     if (!ec) {
-        boost::shared_ptr<BasicService> service(boost::dynamic_pointer_cast<BasicService>(shared_from_this()));
-        acc_sess->start(service);
+        start_session(acc_sess, listener ? listener : local_listener);
         // TODO should we log accept errors?
     }
 
-    do_async_accept();
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (!listener) {
+        do_async_local_accept();
+        return;
+    }
+#endif
+    do_async_accept(listener);
 }
 
@@ -18,21 +18,30 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 
 #include "win_targetver.h"
 #include <boost/asio.hpp>
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/types.h>
+#endif
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <string>
 #include <vector>
+#include <list>
 #include <map>
+#include <set>
 #include "Countable.h"
 #include "../HTTPCommon/Tiger.h"
 #include "URI.h"
 #include "../HTTPCommon/HTTPDatablock.h"
 #include "../HTTPService.h"
 #include "HTTPHandler.h"
+#include "MetricsRegistry.h"
 #include "../HTTPCommon/HTTPRequestData.h"
 #include "../HTTPCommon/HTTPResponseData.h"
+#include "ResourceQuota.h"
+#include "Reactor.h"
 
 namespace HTTP {
     class BasicService : public HTTPService {
@@ -41,6 +50,8 @@ namespace HTTP {
 
     protected:
         BasicService(const std::string &ipaddr, const int port, const std::string &hostname);
+        // Unix domain socket only; see HTTPService::createLocal
+        BasicService(const std::string &socketPath, const std::string &hostname);
     public:
         virtual ~BasicService();
 
@@ -48,63 +59,213 @@ namespace HTTP {
 
         void registerHandler(boost::shared_ptr<HTTPHandler> hnd);
         void deregisterHandler(boost::shared_ptr<HTTPHandler> hnd);
+        void setHandlers(const HandlerList& hnds);
+        HandlerList getHandlers() const;
 
         // While this is enabled, the service will hold a reference to itself that it will release when
         // the builtin URI "/shutdown" is accessed.
         void setDeferShutdown(bool val);
 
+        void listenLocal(const std::string& socketPath);
+        std::string getLocalPath() const;
+
+        MetricsRegistry& getMetrics() { return metrics; }
+        void setMetricsPath(const std::string& path);
+
+        int addListener(const std::string& ipaddr, const int port);
+        void removeListener(const int port, const long drainTimeoutMs = 5000);
+        size_t getOpenConnections(const int port = 0) const;
+
+        void setThreadCount(const size_t count);
+        size_t getThreadCount() const;
+        void setMaxRequestBody(const size_t bytes);
+
         FB::URI getBaseUri() const;
         // Add a signature to a URI (via a GET param). Only the path is signed, so you can still
         // change GET params however you like without causing the verification to fail.
         void sign_uri(FB::URI& in_uri) const;
 
     protected:
-        static const size_t threadpool_size = 2;
+        // Requests with a longer body are refused with 413, unless setMaxRequestBody says otherwise
+        static const size_t default_max_request_body = 4 * 1024 * 1024;
+
+        struct HandlerMetrics {
+            CounterPtr requests; // handleRequest calls
+            CounterPtr responses; // calls that produced a response
+            CounterPtr errors; // calls that threw
+            HistogramPtr latency;
+        };
+        // What a request needs to know about how the service is set up. A published Config is never
+        // changed; reconfiguring publishes a modified copy, so each request sees one consistent setup.
+        struct Config {
+            HandlerList handlers;
+            // One entry for each of handlers, looked up when it is registered rather than per request
+            std::map<HTTPHandler*, HandlerMetrics> handler_metrics;
+            std::string metrics_path;
+            size_t max_request_body;
+        };
+        typedef boost::shared_ptr<const Config> ConfigPtr;
+        ConfigPtr get_config() const;
 
     protected:
         void init();
+        boost::shared_ptr<BasicService> self();
+        static void handle_reactor_shutdown(const boost::weak_ptr<BasicService>& weak);
 
-        void _worker_thread_entry();
-        void do_async_accept();
         bool check_uri_signature(const FB::URI& in_url);
 
+        enum SessionState { SESSION_IDLE, SESSION_READING, SESSION_HANDLING, SESSION_WRITING, SESSION_STATE_COUNT };
+        void init_metrics();
+        HandlerMetrics make_handler_metrics(const boost::shared_ptr<HTTPHandler>& hnd);
+        CounterPtr make_response_counter(unsigned int code);
+
+        class Session;
+        // A TCP address being listened on, and the connections accepted there that are still open.
+        // Accepting and closing happen on the strand, so removeListener can't race handle_accept.
+        struct Listener : boost::noncopyable {
+            Listener(boost::asio::io_service& svc) : acceptor(svc), strand(svc), retired(false), closed(false) { }
+
+            boost::asio::ip::tcp::acceptor acceptor;
+            boost::asio::io_service::strand strand;
+            boost::asio::ip::tcp::endpoint endpoint;
+            bool retired; // guarded by listeners_mutex
+            bool closed; // only touched on the strand
+            mutable boost::mutex mutex;
+            std::set<Session*> sessions;
+        };
+        typedef boost::shared_ptr<Listener> ListenerPtr;
+
+        // The request handling shared by all transports; SocketSession supplies the socket.
         class Session : public Countable {
         public:
             typedef boost::intrusive_ptr<Session> ptr;
 
-            Session(boost::asio::io_service& svc);
-            ~Session();
+            Session();
+            virtual ~Session();
 
             void start(const boost::shared_ptr<BasicService>& _parent_svc);
+            // Counts the session as open on listener until it is destroyed
+            void attach_listener(const ListenerPtr& _listener);
+            // Closes the connection whatever state it's in; used once a retired listener's drain
+            // deadline has passed. Called with listener->mutex held.
+            virtual void abort() = 0;
 
-            boost::asio::ip::tcp::socket& socket() { return sock; }
         protected:
-            void wait_for_header();
+            // Derived classes must call this before their socket goes away, so abort() is never
+            // called on a destroyed socket
+            void detach_listener();
+
+            virtual void async_read_header() = 0;
+            virtual void async_read_body(size_t length) = 0;
+            virtual void async_write_front(HTTPResponseData* resp) = 0;
+            virtual void close() = 0;
+            // Fills in peer; only local sockets have credentials to read
+            virtual void read_peer_credentials() { }
+
             void handle_request(boost::system::error_code ec);
+            void handle_body(boost::system::error_code ec, size_t length);
+            void dispatch_request();
+            void write_error(const std::exception& e);
             void handle_response_datablock_complete(boost::system::error_code ec, HTTPResponseData* resp);
+            // Moves the session between the per-state gauges
+            void set_state(SessionState new_state);
+            void count_response(unsigned int code);
 
-            boost::asio::ip::tcp::socket sock;
             boost::asio::streambuf data;
+            HTTPRequestData req_data;
             boost::shared_ptr<BasicService> parent_svc;
+            PeerCredentials peer;
+            SessionState state;
+            // What a request from page script holds of its origin's quota, until the session ends
+            FB::ResourceLeasePtr connection_lease;
+            FB::ResourceLeasePtr body_lease;
+            ListenerPtr listener;
+        };
+
+        template <class Protocol>
+        class SocketSession : public Session {
+        public:
+            SocketSession(boost::asio::io_service& svc) : sock(svc) { }
+            ~SocketSession() { this->detach_listener(); }
+
+            typename Protocol::socket& socket() { return sock; }
+            void abort();
+
+        protected:
+            void async_read_header();
+            void async_read_body(size_t length);
+            void async_write_front(HTTPResponseData* resp);
+            void close();
+            void read_peer_credentials();
+
+            typename Protocol::socket sock;
         };
+        typedef SocketSession<boost::asio::ip::tcp> TcpSession;
         friend class HTTP::BasicService::Session;
 
-        void handle_accept(const boost::system::error_code& ec, Session::ptr socket);
+        // A null listener means the local socket. Accepts wait on the shared reactor for as long as
+        // the service listens, so they hold it weakly; see handle_accept_weak.
+        void handle_accept(const boost::system::error_code& ec, Session::ptr socket, ListenerPtr listener);
+        static void handle_accept_weak(const boost::weak_ptr<BasicService>& weak, const boost::system::error_code& ec,
+            Session::ptr socket, ListenerPtr listener);
+        ListenerPtr open_listener(const boost::asio::ip::tcp::endpoint& endpoint);
+        void do_async_accept(const ListenerPtr& listener);
+        void start_session(const Session::ptr& acc_sess, const ListenerPtr& listener);
+        // On listener's strand
+        void close_listener(const ListenerPtr& listener);
+        // The drain deadline holds the service weakly, so a service released while a listener
+        // drains goes away at once; terminate closes what was left
+        static void handle_drain_deadline_weak(const boost::weak_ptr<BasicService>& weak, const ListenerPtr& listener,
+            boost::shared_ptr<boost::asio::deadline_timer> timer);
+        void handle_drain_deadline(const ListenerPtr& listener);
         std::string tiger_hmac(const std::string& sign_str) const;
         // -- data
         char* signing_key;
         size_t signing_key_length;
         boost::weak_ptr<BasicService> _weak_ref;
-        std::list<boost::shared_ptr<HTTPHandler> > handlers;
+
+        mutable boost::mutex config_mutex;
+        ConfigPtr config;
 
         boost::shared_ptr<BasicService> deferred_shutdown_ref;
 
-        std::vector<boost::shared_ptr<boost::thread> > threadpool;
-        boost::asio::io_service service;
+        // Sessions and accepts run on the reactor that timers and HTTP clients share, so the service
+        // has no threads of its own; setThreadCount sizes the reactor's pool
+        FB::ReactorPtr reactor;
+        boost::asio::io_service& service;
+        int shutdown_hook;
 
-        boost::asio::ip::tcp::acceptor srv_acceptor;
+        bool use_tcp;
         boost::asio::ip::tcp::endpoint srv_endpoint;
+        // In the order they were added; retired ones stay until their drain deadline
+        mutable boost::mutex listeners_mutex;
+        std::list<ListenerPtr> listeners;
+        // Only tracks the sessions accepted on the local socket, so terminate can close them
+        ListenerPtr local_listener;
+        bool terminated; // guarded by listeners_mutex
         std::string m_hostname;
+
+        std::string m_localPath;
+
+        MetricsRegistry metrics;
+        // Filled in by init_metrics for the status codes services commonly send, and only read after
+        // that, so counting a response takes no lock but the counter's own
+        std::map<unsigned int, CounterPtr> response_counters;
+        CounterPtr sessions_total;
+        GaugePtr session_states[SESSION_STATE_COUNT];
+        CounterPtr response_bytes;
+        CounterPtr read_errors;
+        CounterPtr write_errors;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        typedef SocketSession<boost::asio::local::stream_protocol> LocalSession;
+        void open_local_acceptor();
+        void do_async_local_accept();
+
+        boost::asio::local::stream_protocol::acceptor local_acceptor;
+        // Identifies the socket file we created, so shutdown only ever removes that
+        dev_t m_localDev;
+        ino_t m_localIno;
+#endif
     };
 };
 
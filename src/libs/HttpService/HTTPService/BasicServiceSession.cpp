@@ -13,10 +13,19 @@ Copyright 2010 Dan Weatherford and Facebook, Inc
 \**********************************************************/
 
 #include "BasicService.h"
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "../HTTPCommon/HTTPException.h"
 #include "../HTTPCommon/Utils.h"
 #include "logging.h"
+#include "JSExceptions.h"
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 using namespace boost::algorithm;
 using namespace boost::asio;
@@ -32,29 +41,154 @@ using std::vector;
 
 using namespace HTTP;
 
-BasicService::Session::Session(boost::asio::io_service& svc) : sock(svc) {
+namespace {
+    double seconds_since(const boost::posix_time::ptime& start) {
+        return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.0;
+    }
+
+    size_t content_length(const std::multimap<std::string, std::string>& headers, size_t max_length) {
+        for (std::multimap<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+            if (!iequals(it->first, "Content-Length")) continue;
+            size_t length;
+            try {
+                length = lexical_cast<size_t>(it->second);
+            } catch (const boost::bad_lexical_cast&) {
+                throw HTTPException(400, "Malformed Content-Length");
+            }
+            if (length > max_length) throw HTTPException(413, "Request body too large");
+            return length;
+        }
+        return 0;
+    }
+
+    std::string header_value(const std::multimap<std::string, std::string>& headers, const char* name) {
+        for (std::multimap<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+            if (iequals(it->first, name)) return it->second;
+        }
+        return std::string();
+    }
+}
+
+BasicService::Session::Session() : state(SESSION_IDLE) {
 
 }
 
 BasicService::Session::~Session() {
+    set_state(SESSION_IDLE);
+    detach_listener();
+}
+
+void BasicService::Session::attach_listener(const ListenerPtr& _listener) {
+    boost::mutex::scoped_lock _l(_listener->mutex);
+    listener = _listener;
+    listener->sessions.insert(this);
+}
 
+void BasicService::Session::detach_listener() {
+    if (!listener) return;
+    // A retired listener may go away with its last session, so let go of it only once its mutex is
+    // unlocked again
+    ListenerPtr last;
+    last.swap(listener);
+    boost::mutex::scoped_lock _l(last->mutex);
+    last->sessions.erase(this);
 }
 
 void BasicService::Session::start(const boost::shared_ptr<BasicService>& _parent_svc) {
     parent_svc = _parent_svc;
-    wait_for_header();
+    set_state(SESSION_READING);
+    read_peer_credentials();
+    async_read_header();
+}
+
+void BasicService::Session::set_state(SessionState new_state) {
+    if (!parent_svc || new_state == state) return;
+    if (state != SESSION_IDLE) parent_svc->session_states[state]->add(-1);
+    if (new_state != SESSION_IDLE) parent_svc->session_states[new_state]->add(1);
+    state = new_state;
+}
+
+void BasicService::Session::count_response(unsigned int code) {
+    std::map<unsigned int, CounterPtr>::const_iterator it = parent_svc->response_counters.find(code);
+    if (it != parent_svc->response_counters.end()) {
+        it->second->inc();
+    } else {
+        parent_svc->make_response_counter(code)->inc();
+    }
+}
+
+template <class Protocol>
+void BasicService::SocketSession<Protocol>::async_read_header() {
+    async_read_until(sock, this->data, "\r\n\r\n", boost::bind(&SocketSession::handle_request, BasicService::Session::ptr(this), _1));  
+}
+
+template <class Protocol>
+void BasicService::SocketSession<Protocol>::async_read_body(size_t length) {
+    async_read(sock, this->data, transfer_exactly(length), boost::bind(&SocketSession::handle_body, BasicService::Session::ptr(this), _1, length));
+}
+
+template <class Protocol>
+void BasicService::SocketSession<Protocol>::async_write_front(HTTPResponseData* resp) {
+    async_write(sock, buffer((*resp->data.begin())->data(), (*resp->data.begin())->size()), boost::bind(&SocketSession::handle_response_datablock_complete, BasicService::Session::ptr(this), _1, resp));
 }
 
-void BasicService::Session::wait_for_header() {
-    async_read_until(sock, data, "\r\n\r\n", boost::bind(&Session::handle_request, BasicService::Session::ptr(this), _1));  
+template <class Protocol>
+void BasicService::SocketSession<Protocol>::close() {
+    sock.close();
+}
+
+template <class Protocol>
+void BasicService::SocketSession<Protocol>::abort() {
+    boost::system::error_code ec;
+    sock.close(ec);
+}
+
+template <class Protocol>
+void BasicService::SocketSession<Protocol>::read_peer_credentials() {
+    // TCP peers can't be identified
+}
+
+namespace HTTP {
+template class BasicService::SocketSession<boost::asio::ip::tcp>;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+template <>
+void BasicService::SocketSession<local::stream_protocol>::read_peer_credentials() {
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(sock.native_handle(), SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0) {
+        this->peer.valid = true;
+        this->peer.pid = cred.pid;
+        this->peer.uid = cred.uid;
+        this->peer.gid = cred.gid;
+    }
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(sock.native_handle(), &uid, &gid) == 0) {
+        this->peer.valid = true;
+        this->peer.uid = uid;
+        this->peer.gid = gid;
+    }
+#endif
+    if (!this->peer.valid) {
+        FBLOG_WARN("Http:BasicService", "Could not read peer credentials for local connection");
+    }
 }
 
+template class BasicService::SocketSession<local::stream_protocol>;
+#endif
+};
+
 
 void BasicService::Session::handle_request(boost::system::error_code ec) {
     if (ec) {
         FBLOG_WARN("Http:BasicService", "handle_request error message: " << ec.message());
+        parent_svc->read_errors->inc();
         return;
     }
+    set_state(SESSION_HANDLING);
 
     std::vector<string> header_lines;
     std::istream data_stream(&data);
@@ -67,14 +201,15 @@ void BasicService::Session::handle_request(boost::system::error_code ec) {
         header_lines.push_back(tmp);
     }
 
-    HTTPRequestData req_data;
-    HTTPResponseData* resp = NULL;
+    req_data.peer = peer;
+    size_t body_length;
 
     // First line is like: GET /honk/test?asdf=1234 HTTP/1.1
     // Following lines are "Property-Name: Property-Value"
     // (your basic http stuff)
     // The path is entity-encoded; "%20" = character 0x20 (which is a space), for example
     try {
+        if (header_lines.empty()) throw HTTPException(400, "Malformed Request-Line");
         std::vector<string> req_parts;
         split(req_parts, header_lines[0], is_any_of(" "));
         if (req_parts.size() != 3) throw HTTPException(400, "Malformed Request-Line");
@@ -83,7 +218,54 @@ void BasicService::Session::handle_request(boost::system::error_code ec) {
 
         // Split the rest of the header lines into the request data
         req_data.headers = parse_http_headers(++header_lines.begin(), header_lines.end());
+        body_length = content_length(req_data.headers, parent_svc->get_config()->max_request_body);
+
+        // Browsers send the page's origin with requests from script; those count against its
+        // quota, and are turned away before the body is read once it has too many open
+        const std::string origin(header_value(req_data.headers, "Origin"));
+        if (!origin.empty()) {
+            FB::ResourceQuotaPtr quota(FB::ResourceQuota::instance());
+            try {
+                connection_lease = quota->acquire(origin, FB::ResourceQuota::Connections);
+                body_lease = quota->acquire(origin, FB::ResourceQuota::BufferBytes, body_length);
+            } catch (const FB::quota_exceeded& e) {
+                throw HTTPException(429, e.what());
+            }
+        }
+    } catch (const std::exception& e) {
+        write_error(e);
+        return;
+    }
+
+    // Whatever was read past the header is the start of the body
+    size_t buffered = std::min(body_length, data.size());
+    req_data.body.assign(buffers_begin(data.data()), buffers_begin(data.data()) + buffered);
+    data.consume(buffered);
+    if (buffered < body_length) {
+        set_state(SESSION_READING);
+        async_read_body(body_length - buffered);
+        return;
+    }
+    dispatch_request();
+}
+
+void BasicService::Session::handle_body(boost::system::error_code ec, size_t length) {
+    if (ec) {
+        FBLOG_WARN("Http:BasicService", "handle_body error message: " << ec.message());
+        parent_svc->read_errors->inc();
+        return;
+    }
+    set_state(SESSION_HANDLING);
+    req_data.body.append(buffers_begin(data.data()), buffers_begin(data.data()) + length);
+    data.consume(length);
+    dispatch_request();
+}
 
+void BasicService::Session::dispatch_request() {
+    HTTPResponseData* resp = NULL;
+    // The handlers and settings this request is served with, even if they're replaced meanwhile
+    const ConfigPtr cfg(parent_svc->get_config());
+    try {
         if (req_data.uri.path == "/shutdown") {
             FBLOG_INFO("Http:BasicServiceSession", "Received shutdown request");
             parent_svc->setDeferShutdown(false);
@@ -91,7 +273,13 @@ void BasicService::Session::handle_request(boost::system::error_code ec) {
             resp->code = 200;
             // No response payload necessary.
 
-        }   else if (parent_svc->handlers.empty()) {
+        } else if (!cfg->metrics_path.empty() && req_data.uri.path == cfg->metrics_path) {
+            resp = new HTTPResponseData;
+            resp->headers.insert(std::make_pair("Content-Type", "text/plain; version=0.0.4"));
+            resp->setNoncacheable();
+            resp->addDatablock(new HTTPStringDatablock(parent_svc->metrics.toPrometheusText()));
+
+        }   else if (cfg->handlers.empty()) {
             resp = new HTTPResponseData;
             resp->headers.insert(std::make_pair("Connection", "Close"));
             resp->headers.insert(std::make_pair("Content-Type", "text/plain"));
@@ -108,9 +296,23 @@ void BasicService::Session::handle_request(boost::system::error_code ec) {
             resp->addDatablock(new HTTPStringDatablock(response_str));
         } else {
             bool verified = parent_svc->check_uri_signature(req_data.uri);
-            for (std::list<boost::shared_ptr<HTTPHandler> >::const_iterator it = parent_svc->handlers.begin(); it != parent_svc->handlers.end(); ++it) {
+            for (HandlerList::const_iterator it = cfg->handlers.begin(); it != cfg->handlers.end(); ++it) {
                 if ((!verified) && ((*it)->requiresVerifiedURI())) continue;
-                if ((resp = (*it)->handleRequest(req_data))) break;
+                const HandlerMetrics& hm = cfg->handler_metrics.find(it->get())->second;
+                hm.requests->inc();
+                boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+                try {
+                    resp = (*it)->handleRequest(req_data);
+                } catch (...) {
+                    hm.latency->observe(seconds_since(start));
+                    hm.errors->inc();
+                    throw;
+                }
+                hm.latency->observe(seconds_since(start));
+                if (resp) {
+                    hm.responses->inc();
+                    break;
+                }
             }
             if ((!resp) && (!verified)) throw HTTPException(500, "No registered handlers responded to this request, possibly because of a missing or invalid signature.");
         }
@@ -141,33 +343,48 @@ void BasicService::Session::handle_request(boost::system::error_code ec) {
             header_os << "\r\n";
             resp->data.push_front(new HTTPStringDatablock(header_os.str()));
         }
+        count_response(resp->code);
 
-    } catch (const HTTPException& e) {
-        if (resp) delete resp;
-        FBLOG_INFO("Http:BasicServiceSession", "HTTP exception: " << e.what());
-        resp = new HTTPResponseData(new HTTPStringDatablock(e.getResponseHeader() + string("\r\nContent-Type: text/plain\r\n\r\n") + e.what()));
     } catch (const std::exception& e) {
         if (resp) delete resp;
+        write_error(e);
+        return;
+    }
+    // And write the response datablock list.
+    set_state(SESSION_WRITING);
+    async_write_front(resp);
+}
+
+void BasicService::Session::write_error(const std::exception& e) {
+    HTTPResponseData* resp;
+    if (const HTTPException* he = dynamic_cast<const HTTPException*>(&e)) {
+        FBLOG_INFO("Http:BasicServiceSession", "HTTP exception: " << e.what());
+        count_response(he->getResponseCode());
+        resp = new HTTPResponseData(new HTTPStringDatablock(he->getResponseHeader() + string("\r\nContent-Type: text/plain\r\n\r\n") + e.what()));
+    } else {
         FBLOG_INFO("Http:BasicServiceSession", "std::exception: " << e.what());
+        count_response(500);
         resp = new HTTPResponseData(new HTTPStringDatablock(string("HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\n\r\n") + e.what()));
     }
-    // And write the response datablock list.
-    async_write(sock, buffer((*resp->data.begin())->data(), (*resp->data.begin())->size()), boost::bind(&Session::handle_response_datablock_complete, BasicService::Session::ptr(this), _1, resp));
+    set_state(SESSION_WRITING);
+    async_write_front(resp);
 }
 
 void BasicService::Session::handle_response_datablock_complete(boost::system::error_code ec, HTTPResponseData* resp) {
     if (ec) {
+        parent_svc->write_errors->inc();
         delete resp;
-        sock.close();
+        close();
         return;
     }
+    parent_svc->response_bytes->inc(resp->data.front()->size());
     delete resp->data.front();
     resp->data.pop_front();
     if (resp->data.empty()) {
         delete resp;
-        sock.close();
+        close();
         return;
     }
-    async_write(sock, buffer((*resp->data.begin())->data(), (*resp->data.begin())->size()), boost::bind(&Session::handle_response_datablock_complete, BasicService::Session::ptr(this), _1, resp));
+    async_write_front(resp);
 }
 
@@ -0,0 +1,224 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_array.hpp>
+#include "Platform/Platform.h"
+#include "../HTTPCommon/HTTPException.h"
+#include "../HTTPService.h"
+#include "HTTPFileDatablock.h"
+
+#include "BlobRegistry.h"
+
+using namespace HTTP;
+using boost::lexical_cast;
+using boost::posix_time::ptime;
+using boost::posix_time::microsec_clock;
+
+namespace {
+    // A window onto a registered blob; holding the shared_ptr keeps the blob alive while the
+    // response is written, even if it is revoked meanwhile
+    class BlobSliceDatablock : public HTTPDatablock {
+    public:
+        BlobSliceDatablock(const boost::shared_ptr<HTTPDatablock>& blob, size_t offset, size_t length)
+            : blob(blob), offset(offset), length(length) { }
+        virtual size_t size() const { return length; }
+        virtual const char* data() const { return blob->data() + offset; }
+    protected:
+        boost::shared_ptr<HTTPDatablock> blob;
+        size_t offset;
+        size_t length;
+    };
+
+    enum RangeResult { RANGE_NONE, RANGE_OK, RANGE_UNSATISFIABLE };
+
+    // Handles "bytes=first-last", "bytes=first-" and "bytes=-suffix". Anything else, including
+    // several ranges, is ignored and the whole blob is sent, which RFC 7233 allows.
+    RangeResult parse_range(const std::string& header, size_t total, size_t& start, size_t& length) {
+        std::string spec = boost::algorithm::trim_copy(header);
+        if (!boost::algorithm::istarts_with(spec, "bytes=") || spec.find(',') != std::string::npos) return RANGE_NONE;
+        spec = spec.substr(6);
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos) return RANGE_NONE;
+        std::string first = boost::algorithm::trim_copy(spec.substr(0, dash));
+        std::string last = boost::algorithm::trim_copy(spec.substr(dash + 1));
+        try {
+            if (first.empty()) {
+                if (last.empty()) return RANGE_NONE;
+                size_t suffix = lexical_cast<size_t>(last);
+                if (suffix == 0 || total == 0) return RANGE_UNSATISFIABLE;
+                length = std::min(suffix, total);
+                start = total - length;
+                return RANGE_OK;
+            }
+            start = lexical_cast<size_t>(first);
+            if (start >= total) return RANGE_UNSATISFIABLE;
+            size_t end = last.empty() ? total - 1 : std::min(lexical_cast<size_t>(last), total - 1);
+            if (end < start) return RANGE_NONE;
+            length = end - start + 1;
+            return RANGE_OK;
+        } catch (const boost::bad_lexical_cast&) {
+            return RANGE_NONE;
+        }
+    }
+
+    std::string find_header(const std::multimap<std::string, std::string>& headers, const std::string& name) {
+        for (std::multimap<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+            if (boost::algorithm::iequals(it->first, name)) return it->second;
+        }
+        return std::string();
+    }
+}
+
+BlobRegistryPtr BlobRegistry::create(const boost::shared_ptr<HTTPService>& svc, const std::string& prefix) {
+    BlobRegistryPtr res(new BlobRegistry(svc->getBaseUri(), prefix));
+    svc->registerHandler(res);
+    return res;
+}
+
+BlobRegistry::BlobRegistry(const FB::URI& base, const std::string& prefix)
+    : m_base(base), m_prefix(prefix) {
+    if (m_prefix.empty() || m_prefix[m_prefix.size() - 1] != '/') m_prefix += '/';
+}
+
+BlobRegistry::~BlobRegistry() { }
+
+FB::URI BlobRegistry::registerBlob(const boost::shared_ptr<HTTPDatablock>& data, const std::string& content_type, double ttl) {
+    Blob blob;
+    blob.data = data;
+    blob.content_type = content_type;
+    return add(blob, ttl);
+}
+
+FB::URI BlobRegistry::registerBlob(const std::string& data, const std::string& content_type, double ttl) {
+    return registerBlob(boost::shared_ptr<HTTPDatablock>(new HTTPStringDatablock(data)), content_type, ttl);
+}
+
+FB::URI BlobRegistry::registerFile(const std::string& path, const std::string& content_type, double ttl,
+    size_t offset, size_t length) {
+    return registerBlob(boost::shared_ptr<HTTPDatablock>(new HTTPFileDatablock(path, offset, length)), content_type, ttl);
+}
+
+FB::URI BlobRegistry::add(const Blob& blob, double ttl) {
+    static const size_t id_bytes = 16;
+    static const char hex[] = "0123456789abcdef";
+    boost::scoped_array<char> rnd(Platform::getRandomBytes(id_bytes));
+    std::string id;
+    for (size_t i = 0; i < id_bytes; ++i) {
+        id += hex[(rnd[i] >> 4) & 0xf];
+        id += hex[rnd[i] & 0xf];
+    }
+
+    ptime now = microsec_clock::universal_time();
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        purge_expired(now);
+        Blob& entry = (m_blobs[id] = blob);
+        if (ttl > 0) entry.expires = now + boost::posix_time::microseconds(static_cast<boost::int64_t>(ttl * 1000000));
+    }
+
+    FB::URI res(m_base);
+    res.path = m_prefix + id;
+    return res;
+}
+
+bool BlobRegistry::revoke(const FB::URI& uri) {
+    if (uri.path.compare(0, m_prefix.size(), m_prefix) != 0) return false;
+    return revoke(uri.path.substr(m_prefix.size()));
+}
+
+bool BlobRegistry::revoke(const std::string& id) {
+    boost::mutex::scoped_lock _l(m_mutex);
+    std::map<std::string, Blob>::iterator it = m_blobs.find(id);
+    if (it == m_blobs.end()) return false;
+    bool live = it->second.expires.is_not_a_date_time() || it->second.expires > microsec_clock::universal_time();
+    m_blobs.erase(it);
+    return live;
+}
+
+void BlobRegistry::revokeAll() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_blobs.clear();
+}
+
+size_t BlobRegistry::purgeExpired() {
+    boost::mutex::scoped_lock _l(m_mutex);
+    return purge_expired(microsec_clock::universal_time());
+}
+
+size_t BlobRegistry::purge_expired(const ptime& now) {
+    size_t count = 0;
+    for (std::map<std::string, Blob>::iterator it = m_blobs.begin(); it != m_blobs.end(); ) {
+        if (!it->second.expires.is_not_a_date_time() && it->second.expires <= now) {
+            m_blobs.erase(it++);
+            ++count;
+        } else {
+            ++it;
+        }
+    }
+    return count;
+}
+
+size_t BlobRegistry::size() const {
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_blobs.size();
+}
+
+HTTPResponseData* BlobRegistry::handleRequest(const HTTPRequestData& req) {
+    if (req.uri.path.compare(0, m_prefix.size(), m_prefix) != 0) return NULL;
+
+    Blob blob;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        std::map<std::string, Blob>::iterator it = m_blobs.find(req.uri.path.substr(m_prefix.size()));
+        if (it == m_blobs.end()) throw HTTPException(404, "No such blob");
+        if (!it->second.expires.is_not_a_date_time() && it->second.expires <= microsec_clock::universal_time()) {
+            m_blobs.erase(it);
+            throw HTTPException(404, "No such blob");
+        }
+        blob = it->second;
+    }
+    if (req.method != "GET") throw HTTPException(405, "Blobs can only be fetched with GET");
+
+    blob.data->resolve();
+    size_t total = blob.data->size();
+    std::string total_str(lexical_cast<std::string>(total));
+
+    HTTPResponseData* resp = new HTTPResponseData;
+    resp->setNoncacheable();
+    resp->headers.insert(std::make_pair("Accept-Ranges", "bytes"));
+    if (!allow_origin.empty()) resp->headers.insert(std::make_pair("Access-Control-Allow-Origin", allow_origin));
+
+    size_t start = 0, length = total;
+    switch (parse_range(find_header(req.headers, "Range"), total, start, length)) {
+    case RANGE_UNSATISFIABLE:
+        resp->code = 416;
+        resp->headers.insert(std::make_pair("Content-Range", "bytes */" + total_str));
+        return resp;
+    case RANGE_OK:
+        resp->code = 206;
+        resp->headers.insert(std::make_pair("Content-Range", "bytes " + lexical_cast<std::string>(start) + "-"
+            + lexical_cast<std::string>(start + length - 1) + "/" + total_str));
+        break;
+    default:
+        break;
+    }
+
+    if (!blob.content_type.empty()) resp->headers.insert(std::make_pair("Content-Type", blob.content_type));
+    if (length) resp->addDatablock(new BlobSliceDatablock(blob.data, start, length));
+    return resp;
+}
+
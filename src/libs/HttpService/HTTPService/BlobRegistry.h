@@ -0,0 +1,90 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTP_BLOBREGISTRY
+#define H_HTTP_BLOBREGISTRY
+
+#include <string>
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "URI.h"
+#include "HTTPHandler.h"
+
+namespace HTTP {
+    class HTTPService;
+    class BlobRegistry;
+    typedef boost::shared_ptr<BlobRegistry> BlobRegistryPtr;
+
+    // Serves buffers and file regions registered from C++ at unguessable URLs on an HTTPService, so
+    // large binary results can be handed to the page as a URL for <img> or fetch() instead of being
+    // marshalled into a JS string. The registered data is written to the socket in place; nothing
+    // is copied per request. Single byte ranges are supported.
+    //
+    // The URLs are not signed: knowing the id (128 random bits) is what grants access, so don't
+    // hand them to content you wouldn't give the data to.
+    class BlobRegistry : public HTTPHandler {
+    public:
+        // Creates a registry serving under prefix on svc and registers it as a handler there
+        static BlobRegistryPtr create(const boost::shared_ptr<HTTPService>& svc, const std::string& prefix = "/blob/");
+        virtual ~BlobRegistry();
+
+        // ttl is in seconds; 0 keeps the blob until it is revoked. Returns the blob's URL.
+        FB::URI registerBlob(const boost::shared_ptr<HTTPDatablock>& data, const std::string& content_type, double ttl = 0);
+        FB::URI registerBlob(const std::string& data, const std::string& content_type, double ttl = 0);
+        // Maps length bytes of the file at path from offset (to the end of the file if length is 0).
+        // Throws if the file can't be mapped.
+        FB::URI registerFile(const std::string& path, const std::string& content_type, double ttl = 0,
+            size_t offset = 0, size_t length = 0);
+
+        // Returns false if the blob was unknown or had already expired. Requests already being
+        // written keep their data alive until they finish.
+        bool revoke(const FB::URI& uri);
+        bool revoke(const std::string& id);
+        void revokeAll();
+        // Drops expired blobs; returns how many were dropped. Registering a blob also does this.
+        size_t purgeExpired();
+        size_t size() const;
+
+        // Sent as Access-Control-Allow-Origin when not empty, so fetch() from that origin can read blobs
+        std::string allow_origin;
+
+        // HTTPHandler
+        bool requiresVerifiedURI() const { return false; }
+        HTTPResponseData* handleRequest(const HTTPRequestData& req);
+        std::string getMetricsName() const { return "blob"; }
+
+    protected:
+        BlobRegistry(const FB::URI& base, const std::string& prefix);
+
+        struct Blob {
+            boost::shared_ptr<HTTPDatablock> data;
+            std::string content_type;
+            boost::posix_time::ptime expires; // not_a_date_time if it never does
+        };
+        FB::URI add(const Blob& blob, double ttl);
+        size_t purge_expired(const boost::posix_time::ptime& now);
+
+        FB::URI m_base;
+        std::string m_prefix;
+        mutable boost::mutex m_mutex;
+        std::map<std::string, Blob> m_blobs;
+    };
+};
+
+#endif // H_HTTP_BLOBREGISTRY
+
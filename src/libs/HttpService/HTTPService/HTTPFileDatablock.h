@@ -19,6 +19,8 @@ namespace HTTP {
     class HTTPFileDatablock : public HTTPDatablock {
     public:
         HTTPFileDatablock(const std::string& fp) : mmfile(fp.c_str(), boost::interprocess::read_only), region(mmfile, boost::interprocess::read_only) {}
+        // Maps length bytes from offset; a length of 0 maps to the end of the file
+        HTTPFileDatablock(const std::string& fp, size_t offset, size_t length) : mmfile(fp.c_str(), boost::interprocess::read_only), region(mmfile, boost::interprocess::read_only, offset, length) {}
         virtual ~HTTPFileDatablock() {}
         
         virtual size_t size() const {
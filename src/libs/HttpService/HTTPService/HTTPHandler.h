@@ -32,6 +32,8 @@ namespace HTTP {
         // If the handler can't respond to this request, it returns NULL; otherwise, a new HTTPResponseData.
         // Actual errors throw HTTPException.
         virtual HTTPResponseData* handleRequest(const HTTPRequestData& req) = 0;
+        // Value of the "handler" label on this handler's metrics; the type name is used if empty.
+        virtual std::string getMetricsName() const { return std::string(); }
     };
 };
 
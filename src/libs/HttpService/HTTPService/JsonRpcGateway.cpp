@@ -0,0 +1,271 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/bind.hpp>
+#include "JSAPI.h"
+#include "BrowserHost.h"
+#include "JSExceptions.h"
+#include "fbjson.h"
+#include "logging.h"
+#include "../HTTPCommon/HTTPException.h"
+#include "../HTTPService.h"
+#include "JsonRpcGateway.h"
+
+using namespace HTTP;
+
+namespace {
+    // Error codes from the JSON-RPC 2.0 specification
+    const int parse_error = -32700;
+    const int invalid_request = -32600;
+    const int method_not_found = -32601;
+    const int invalid_params = -32602;
+    const int internal_error = -32603;
+    // For errors thrown by the called object
+    const int server_error = -32000;
+
+    enum CallKind { CALL_INVOKE, CALL_GET, CALL_SET };
+
+    struct CallResult {
+        CallResult() : code(0) { }
+        int code;
+        std::string message;
+        FB::variant value;
+    };
+
+    // Runs on the main thread of the object's host
+    CallResult call_on_owner(const FB::JSAPIPtr& api, FB::SecurityZone zone, CallKind kind,
+        const std::string& member, const FB::VariantList& args) {
+        CallResult res;
+        try {
+            FB::scoped_zonelock _l(api, zone);
+            switch (kind) {
+            case CALL_INVOKE:
+                if (!api->HasMethod(member)) {
+                    res.code = method_not_found;
+                    res.message = "Method not found";
+                } else {
+                    res.value = api->Invoke(member, args);
+                }
+                break;
+            case CALL_GET:
+            case CALL_SET:
+                if (!api->HasProperty(member)) {
+                    res.code = method_not_found;
+                    res.message = "Property not found";
+                } else if (kind == CALL_GET) {
+                    res.value = api->GetProperty(member);
+                } else {
+                    api->SetProperty(member, args[0]);
+                }
+                break;
+            }
+        } catch (const FB::invalid_arguments& e) {
+            res.code = invalid_params;
+            res.message = e.what();
+        } catch (const FB::invalid_member& e) {
+            res.code = method_not_found;
+            res.message = e.what();
+        } catch (const FB::script_error& e) {
+            res.code = server_error;
+            res.message = e.what();
+        } catch (const std::exception& e) {
+            res.code = internal_error;
+            res.message = e.what();
+        }
+        return res;
+    }
+
+    void append_id(std::string& out, const Json::Value& id) {
+        FB::appendVariantAsJson(out, FB::jsonValueToVariant(id));
+    }
+
+    void append_result(std::string& out, const Json::Value& id, const FB::variant& value) {
+        out += "{\"jsonrpc\":\"2.0\",\"result\":";
+        FB::appendVariantAsJson(out, value);
+        out += ",\"id\":";
+        append_id(out, id);
+        out += '}';
+    }
+
+    void append_error(std::string& out, const Json::Value& id, int code, const std::string& message) {
+        out += "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":";
+        FB::appendVariantAsJson(out, code);
+        out += ",\"message\":";
+        FB::appendVariantAsJson(out, message);
+        out += "},\"id\":";
+        append_id(out, id);
+        out += '}';
+    }
+}
+
+JsonRpcGatewayPtr JsonRpcGateway::create(const boost::shared_ptr<HTTPService>& svc, const std::string& path) {
+    JsonRpcGatewayPtr res(new JsonRpcGateway(path));
+    svc->registerHandler(res);
+    return res;
+}
+
+JsonRpcGateway::JsonRpcGateway(const std::string& path) : require_signature(true), m_path(path) {
+}
+
+JsonRpcGateway::~JsonRpcGateway() {
+}
+
+void JsonRpcGateway::publish(const std::string& name, const FB::JSAPIPtr& api, const FB::BrowserHostPtr& host,
+    FB::SecurityZone zone) {
+    Published pub;
+    pub.api = api;
+    pub.host = host;
+    pub.zone = zone;
+    boost::mutex::scoped_lock _l(m_mutex);
+    m_objects[name] = pub;
+}
+
+bool JsonRpcGateway::unpublish(const std::string& name) {
+    boost::mutex::scoped_lock _l(m_mutex);
+    return m_objects.erase(name) > 0;
+}
+
+std::string JsonRpcGateway::handle(const std::string& request) {
+    Json::Reader rdr;
+    Json::Value root;
+    std::string out;
+    if (!rdr.parse(request, root, false)) {
+        append_error(out, Json::Value(), parse_error, "Parse error");
+        return out;
+    }
+    // This jsoncpp's isArray() and isObject() are also true for null
+    if (root.type() != Json::arrayValue) {
+        handle_call(root, out);
+        return out;
+    }
+    if (root.empty()) {
+        append_error(out, Json::Value(), invalid_request, "Empty batch");
+        return out;
+    }
+    out += '[';
+    bool any = false;
+    for (Json::Value::UInt i = 0; i < root.size(); ++i) {
+        if (any) out += ',';
+        if (handle_call(root[i], out)) {
+            any = true;
+        } else if (any) {
+            out.erase(out.size() - 1);
+        }
+    }
+    // A batch of notifications gets nothing back at all
+    if (!any) return std::string();
+    out += ']';
+    return out;
+}
+
+bool JsonRpcGateway::handle_call(const Json::Value& call, std::string& out) {
+    if (call.type() != Json::objectValue) {
+        append_error(out, Json::Value(), invalid_request, "Invalid Request");
+        return true;
+    }
+    const bool notification = !call.isMember("id");
+    const Json::Value& id(call["id"]);
+    const Json::Value& version(call["jsonrpc"]);
+    const Json::Value& method(call["method"]);
+    const Json::Value& params(call["params"]);
+    // (isNumeric() is also true for booleans)
+    const bool valid_id = id.isNull() || id.isString() || (id.isNumeric() && !id.isBool());
+    if (!valid_id || !version.isString() || version.asString() != "2.0" || !method.isString()
+        || !(params.isArray() || params.isObject())) {
+        append_error(out, valid_id ? id : Json::Value(), invalid_request, "Invalid Request");
+        return true;
+    }
+    if (params.type() == Json::objectValue) {
+        if (!notification) append_error(out, id, invalid_params, "Parameters must be given by position");
+        return !notification;
+    }
+
+    FB::VariantList args;
+    for (Json::Value::UInt i = 0; i < params.size(); ++i) {
+        args.push_back(FB::jsonValueToVariant(params[i]));
+    }
+
+    // "object.method", or one of the property methods with the object and property as params
+    CallKind kind = CALL_INVOKE;
+    std::string object, member;
+    const std::string name(method.asString());
+    if (name == "rpc.get" || name == "rpc.set") {
+        kind = name == "rpc.get" ? CALL_GET : CALL_SET;
+        if (args.size() != (kind == CALL_GET ? 2u : 3u) || !args[0].is_of_type<std::string>()
+            || !args[1].is_of_type<std::string>()) {
+            if (!notification) append_error(out, id, invalid_params, kind == CALL_GET
+                ? "Expected [object, property]" : "Expected [object, property, value]");
+            return !notification;
+        }
+        object = args[0].cast<std::string>();
+        member = args[1].cast<std::string>();
+        args.erase(args.begin(), args.begin() + 2);
+    } else {
+        size_t dot = name.find('.');
+        if (dot != std::string::npos) {
+            object = name.substr(0, dot);
+            member = name.substr(dot + 1);
+        }
+    }
+
+    Published pub;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        std::map<std::string, Published>::const_iterator it = m_objects.find(object);
+        if (it != m_objects.end()) pub = it->second;
+    }
+    FB::JSAPIPtr api(pub.api.lock());
+    FB::BrowserHostPtr host(pub.host.lock());
+    if (!api || !host || member.empty()) {
+        if (!notification) append_error(out, id, method_not_found, "Method not found");
+        return !notification;
+    }
+
+    if (notification) {
+        // Nobody is waiting for it; it still runs before anything sent after it
+        host->ScheduleOnMainThread(api, boost::bind(&call_on_owner, api, pub.zone, kind, member, args));
+        return false;
+    }
+    CallResult res;
+    try {
+        res = host->CallOnMainThread(boost::bind(&call_on_owner, api, pub.zone, kind, member, args));
+    } catch (const FB::script_error& e) {
+        // The host is shutting down
+        res.code = server_error;
+        res.message = e.what();
+    }
+    if (res.code) {
+        append_error(out, id, res.code, res.message);
+    } else {
+        append_result(out, id, res.value);
+    }
+    return true;
+}
+
+HTTPResponseData* JsonRpcGateway::handleRequest(const HTTPRequestData& req) {
+    if (req.uri.path != m_path) return NULL;
+    if (req.method != "POST") throw HTTPException(405, "JSON-RPC requests must be POSTed");
+
+    std::string body(handle(req.body));
+    HTTPResponseData* resp = new HTTPResponseData;
+    resp->setNoncacheable();
+    if (!allow_origin.empty()) resp->headers.insert(std::make_pair("Access-Control-Allow-Origin", allow_origin));
+    if (body.empty()) {
+        resp->code = 204;
+        return resp;
+    }
+    resp->headers.insert(std::make_pair("Content-Type", "application/json"));
+    resp->addDatablock(new HTTPStringDatablock(body));
+    return resp;
+}
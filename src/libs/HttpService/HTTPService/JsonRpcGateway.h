@@ -0,0 +1,96 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTP_JSONRPCGATEWAY
+#define H_HTTP_JSONRPCGATEWAY
+
+#include <string>
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "APITypes.h"
+#include "HTTPHandler.h"
+
+namespace Json {
+    class Value;
+};
+
+namespace HTTP {
+    class HTTPService;
+    class JsonRpcGateway;
+    typedef boost::shared_ptr<JsonRpcGateway> JsonRpcGatewayPtr;
+
+    // Answers JSON-RPC 2.0 requests POSTed to a path on an HTTPService by calling JSAPI objects
+    // published on it, so native tools can use the same API as page script without a second
+    // interface written as HTTPHandlers.
+    //
+    // Methods are named "object.method" and take positional params. The reserved methods
+    // "rpc.get" (params [object, property]) and "rpc.set" ([object, property, value]) read and
+    // write properties. Batches are supported, and notifications (requests without an id) get no
+    // response; a POST holding only notifications is answered with 204.
+    //
+    // Calls are made on the main thread of the object's BrowserHost, in order, with the security
+    // zone the object was published with pushed, so members registered for a higher zone can't be
+    // reached. Results are written straight from the variant; objects and other values with no
+    // JSON form come back as null.
+    //
+    // Anyone who can reach the service can make these calls. Keep require_signature on, or serve
+    // on a Unix domain socket and check HTTPRequestData::peer, and only publish what those callers
+    // may use.
+    class JsonRpcGateway : public HTTPHandler {
+    public:
+        // Creates a gateway answering at path on svc and registers it as a handler there
+        static JsonRpcGatewayPtr create(const boost::shared_ptr<HTTPService>& svc, const std::string& path = "/rpc");
+        virtual ~JsonRpcGateway();
+
+        // The gateway only holds api and host weakly; calls to an object that has gone away fail
+        void publish(const std::string& name, const FB::JSAPIPtr& api, const FB::BrowserHostPtr& host,
+            FB::SecurityZone zone = FB::SecurityScope_Public);
+        bool unpublish(const std::string& name);
+
+        // Answers one request or batch; returns the response text, empty if there is none. Must not
+        // be called on the main thread of a published object's host while that thread is needed to
+        // answer it, other than by the call itself.
+        std::string handle(const std::string& request);
+
+        // Whether request URIs have to be signed (see HTTPService::sign_uri); true by default
+        bool require_signature;
+        // Sent as Access-Control-Allow-Origin when not empty
+        std::string allow_origin;
+
+        // HTTPHandler
+        bool requiresVerifiedURI() const { return require_signature; }
+        HTTPResponseData* handleRequest(const HTTPRequestData& req);
+        std::string getMetricsName() const { return "jsonrpc"; }
+
+    protected:
+        JsonRpcGateway(const std::string& path);
+
+        struct Published {
+            FB::JSAPIWeakPtr api;
+            FB::BrowserHostWeakPtr host;
+            FB::SecurityZone zone;
+        };
+        // Appends the response to call, if it gets one, to out; returns whether it did
+        bool handle_call(const Json::Value& call, std::string& out);
+
+        std::string m_path;
+        mutable boost::mutex m_mutex;
+        std::map<std::string, Published> m_objects;
+    };
+};
+
+#endif // H_HTTP_JSONRPCGATEWAY
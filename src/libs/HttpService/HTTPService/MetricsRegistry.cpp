@@ -0,0 +1,171 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <boost/make_shared.hpp>
+
+#include "MetricsRegistry.h"
+
+using namespace HTTP;
+
+namespace {
+    void write_value(std::ostream& os, double val) {
+        std::ostringstream tmp;
+        tmp.precision(15);
+        tmp << val;
+        os << tmp.str();
+    }
+
+    void write_sample(std::ostream& os, const std::string& name, const std::string& labels, double val) {
+        os << name;
+        if (!labels.empty()) os << "{" << labels << "}";
+        os << " ";
+        write_value(os, val);
+        os << "\n";
+    }
+
+    std::string join_labels(const std::string& labels, const std::string& extra) {
+        return labels.empty() ? extra : labels + "," + extra;
+    }
+}
+
+Histogram::Histogram(const std::vector<double>& bounds)
+    : m_bounds(bounds), m_counts(bounds.size() + 1, 0), m_sum(0), m_count(0) { }
+
+void Histogram::observe(double val) {
+    size_t bucket = std::lower_bound(m_bounds.begin(), m_bounds.end(), val) - m_bounds.begin();
+    boost::mutex::scoped_lock _l(m_mutex);
+    ++m_counts[bucket];
+    m_sum += val;
+    ++m_count;
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot res;
+    res.bounds = m_bounds;
+    {
+        boost::mutex::scoped_lock _l(m_mutex);
+        res.counts = m_counts;
+        res.sum = m_sum;
+        res.count = m_count;
+    }
+    for (size_t i = 1; i < res.counts.size(); ++i) {
+        res.counts[i] += res.counts[i - 1];
+    }
+    return res;
+}
+
+const std::vector<double>& MetricsRegistry::defaultLatencyBounds() {
+    static const double bounds[] = { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+    static const std::vector<double> res(bounds, bounds + sizeof(bounds) / sizeof(bounds[0]));
+    return res;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, MetricType type) {
+    std::map<std::string, Family>::iterator it = m_families.find(name);
+    if (it == m_families.end()) {
+        Family& fam = m_families[name];
+        fam.type = type;
+        fam.help = help;
+        return fam;
+    }
+    if (it->second.type != type) throw std::runtime_error("Metric " + name + " already registered with a different type");
+    return it->second;
+}
+
+CounterPtr MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    boost::mutex::scoped_lock _l(m_mutex);
+    CounterPtr& res = family(name, help, COUNTER).counters[labels];
+    if (!res) res = boost::make_shared<Counter>();
+    return res;
+}
+
+GaugePtr MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    boost::mutex::scoped_lock _l(m_mutex);
+    GaugePtr& res = family(name, help, GAUGE).gauges[labels];
+    if (!res) res = boost::make_shared<Gauge>();
+    return res;
+}
+
+HistogramPtr MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels,
+    const std::vector<double>& bounds) {
+    boost::mutex::scoped_lock _l(m_mutex);
+    HistogramPtr& res = family(name, help, HISTOGRAM).histograms[labels];
+    if (!res) res = boost::make_shared<Histogram>(bounds);
+    return res;
+}
+
+double MetricsRegistry::getValue(const std::string& name, const std::string& labels) const {
+    boost::mutex::scoped_lock _l(m_mutex);
+    std::map<std::string, Family>::const_iterator fam = m_families.find(name);
+    if (fam == m_families.end()) return 0;
+    switch (fam->second.type) {
+    case COUNTER: {
+        std::map<std::string, CounterPtr>::const_iterator it = fam->second.counters.find(labels);
+        return it == fam->second.counters.end() ? 0 : it->second->value();
+    }
+    case GAUGE: {
+        std::map<std::string, GaugePtr>::const_iterator it = fam->second.gauges.find(labels);
+        return it == fam->second.gauges.end() ? 0 : it->second->value();
+    }
+    case HISTOGRAM: {
+        std::map<std::string, HistogramPtr>::const_iterator it = fam->second.histograms.find(labels);
+        return it == fam->second.histograms.end() ? 0 : it->second->snapshot().count;
+    }
+    }
+    return 0;
+}
+
+std::string MetricsRegistry::toPrometheusText() const {
+    std::ostringstream os;
+    boost::mutex::scoped_lock _l(m_mutex);
+    for (std::map<std::string, Family>::const_iterator fam = m_families.begin(); fam != m_families.end(); ++fam) {
+        const std::string& name = fam->first;
+        os << "# HELP " << name << " " << fam->second.help << "\n";
+        switch (fam->second.type) {
+        case COUNTER:
+            os << "# TYPE " << name << " counter\n";
+            for (std::map<std::string, CounterPtr>::const_iterator it = fam->second.counters.begin(); it != fam->second.counters.end(); ++it) {
+                write_sample(os, name, it->first, it->second->value());
+            }
+            break;
+        case GAUGE:
+            os << "# TYPE " << name << " gauge\n";
+            for (std::map<std::string, GaugePtr>::const_iterator it = fam->second.gauges.begin(); it != fam->second.gauges.end(); ++it) {
+                write_sample(os, name, it->first, it->second->value());
+            }
+            break;
+        case HISTOGRAM:
+            os << "# TYPE " << name << " histogram\n";
+            for (std::map<std::string, HistogramPtr>::const_iterator it = fam->second.histograms.begin(); it != fam->second.histograms.end(); ++it) {
+                Histogram::Snapshot snap = it->second->snapshot();
+                for (size_t i = 0; i < snap.bounds.size(); ++i) {
+                    std::ostringstream le;
+                    le << "le=\"";
+                    write_value(le, snap.bounds[i]);
+                    le << "\"";
+                    write_sample(os, name + "_bucket", join_labels(it->first, le.str()), snap.counts[i]);
+                }
+                write_sample(os, name + "_bucket", join_labels(it->first, "le=\"+Inf\""), snap.count);
+                write_sample(os, name + "_sum", it->first, snap.sum);
+                write_sample(os, name + "_count", it->first, snap.count);
+            }
+            break;
+        }
+    }
+    return os.str();
+}
+
@@ -0,0 +1,115 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTP_METRICSREGISTRY
+#define H_HTTP_METRICSREGISTRY
+
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace HTTP {
+    // Recording a value never touches the registry lock: counters and gauges are atomics, and only
+    // a histogram locks, its own buckets. Get the metric once (counter(), gauge(), histogram()) and
+    // keep the pointer around.
+    class Counter : boost::noncopyable {
+    public:
+        Counter() : m_value(0) {}
+        void inc(double amount = 1) { m_value.fetch_add(amount, boost::memory_order_relaxed); }
+        double value() const { return m_value.load(boost::memory_order_relaxed); }
+    private:
+        boost::atomic<double> m_value;
+    };
+
+    class Gauge : boost::noncopyable {
+    public:
+        Gauge() : m_value(0) {}
+        void set(double val) { m_value.store(val, boost::memory_order_relaxed); }
+        void add(double amount) { m_value.fetch_add(amount, boost::memory_order_relaxed); }
+        double value() const { return m_value.load(boost::memory_order_relaxed); }
+    private:
+        boost::atomic<double> m_value;
+    };
+
+    class Histogram : boost::noncopyable {
+    public:
+        // bounds are the upper bounds of the buckets, ascending; +Inf is implied
+        explicit Histogram(const std::vector<double>& bounds);
+        void observe(double val);
+
+        struct Snapshot {
+            std::vector<double> bounds;
+            std::vector<unsigned long> counts; // cumulative, one per bound plus +Inf
+            double sum;
+            unsigned long count;
+        };
+        Snapshot snapshot() const;
+
+    private:
+        mutable boost::mutex m_mutex;
+        const std::vector<double> m_bounds;
+        std::vector<unsigned long> m_counts; // per bucket, not cumulative
+        double m_sum;
+        unsigned long m_count;
+    };
+
+    typedef boost::shared_ptr<Counter> CounterPtr;
+    typedef boost::shared_ptr<Gauge> GaugePtr;
+    typedef boost::shared_ptr<Histogram> HistogramPtr;
+
+    // Named metrics, optionally split by labels. Labels are given in Prometheus form without the
+    // braces, e.g. "handler=\"files\",code=\"200\"".
+    class MetricsRegistry : boost::noncopyable {
+    public:
+        MetricsRegistry() {}
+
+        // These return the existing metric if one with the same name and labels was already made
+        CounterPtr counter(const std::string& name, const std::string& help, const std::string& labels = std::string());
+        GaugePtr gauge(const std::string& name, const std::string& help, const std::string& labels = std::string());
+        HistogramPtr histogram(const std::string& name, const std::string& help, const std::string& labels = std::string(),
+            const std::vector<double>& bounds = defaultLatencyBounds());
+
+        // Current value of a counter or gauge, or the number of observations of a histogram; 0 if
+        // there is no such metric.
+        double getValue(const std::string& name, const std::string& labels = std::string()) const;
+
+        // Everything in the Prometheus text exposition format (version 0.0.4)
+        std::string toPrometheusText() const;
+
+        // Seconds, from half a millisecond to ten seconds
+        static const std::vector<double>& defaultLatencyBounds();
+
+    protected:
+        enum MetricType { COUNTER, GAUGE, HISTOGRAM };
+        struct Family {
+            MetricType type;
+            std::string help;
+            std::map<std::string, CounterPtr> counters;
+            std::map<std::string, GaugePtr> gauges;
+            std::map<std::string, HistogramPtr> histograms;
+        };
+        Family& family(const std::string& name, const std::string& help, MetricType type);
+
+        mutable boost::mutex m_mutex;
+        std::map<std::string, Family> m_families;
+    };
+};
+
+#endif // H_HTTP_METRICSREGISTRY
+
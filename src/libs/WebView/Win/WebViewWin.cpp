@@ -192,6 +192,7 @@ void WebViewWin::initPage()
 {
     fbBrowserHostPtr =
         boost::make_shared<FB::ActiveX::ActiveXBrowserHost>(webBrowser, clientSite.get());
+    this->fbBrowserHostPtr->capturePageOrigin();
     this->fbBrowserHostPtr->initJS(this);
 }
 
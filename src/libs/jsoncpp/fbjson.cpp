@@ -12,6 +12,7 @@ License:    Dual license model; choose one of two:
 Copyright 2011 Facebook, Inc
 \**********************************************************/
 
+#include "variant_encoding.h"
 #include "fbjson.h"
 
 namespace FB { 
@@ -61,7 +62,7 @@ namespace FB {
 
     Json::Value variantToJsonValue(const FB::variant &val)
     {
-        if (val.is_of_type<std::string>()) {
+        if (val.is_of_type<std::string>() || val.is_of_type<FB::SharedString>()) {
             return Json::Value(val.convert_cast<std::string>());
         } else if (val.is_of_type<FB::VariantMap>()) {
             Json::Value retVal(Json::objectValue);
@@ -96,4 +97,9 @@ namespace FB {
         }
     }
 
+    void appendVariantAsJson(std::string& out, const FB::variant& val)
+    {
+        FB::appendJSON(out, val, FB::UnencodableJSONAsNull);
+    }
+
 };
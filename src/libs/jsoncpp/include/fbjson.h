@@ -18,4 +18,9 @@ namespace FB {
     Json::Value variantToJsonValue(const FB::variant &val);
     FB::variant jsonToVariantValue(const std::string& json);
     FB::variant jsonValueToVariant( Json::Value root );
+
+    // Appends val to out as JSON text directly, without building a Json::Value first. Values with
+    // no JSON form (objects, NaN, ...) are written as null. The writing itself is FB::appendJSON's,
+    // so this gives the same text as the JSON that invokeBatch returns.
+    void appendVariantAsJson(std::string& out, const FB::variant& val);
 } 
@@ -0,0 +1,30 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include "UnitTest++.h"
+
+#define PRINT_TESTNAME  printf("Running benchmark %s::%s...\n", UnitTestSuite::GetSuiteName(), m_details.testName); \
+    fflush(stdout)
+
+#include "async_file_benchmark.h"
+#include "key_value_store_benchmark.h"
+#include "cached_property_benchmark.h"
+#include "shared_string_benchmark.h"
+#include "plugin_event_map_benchmark.h"
+#include "variant_encoding_benchmark.h"
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
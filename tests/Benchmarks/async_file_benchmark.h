@@ -0,0 +1,193 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "AsyncFileService.h"
+#include "SystemHelpers.h"
+#include "bench_util.h"
+
+namespace {
+    // Every 8 bytes of the file hold their own offset, so any chunk can be checked on its own
+    void fillPattern(uint8_t* data, boost::uint64_t offset, size_t size)
+    {
+        for (size_t i = 0; i + 8 <= size; i += 8) {
+            boost::uint64_t word = offset + i;
+            for (int b = 0; b < 8; ++b)
+                data[i + b] = static_cast<uint8_t>(word >> (b * 8));
+        }
+    }
+
+    boost::uint64_t wordAt(const uint8_t* data)
+    {
+        boost::uint64_t word = 0;
+        for (int b = 7; b >= 0; --b)
+            word = (word << 8) | data[b];
+        return word;
+    }
+
+    // Checks a word every 64KB, and the last one
+    bool checkPattern(const uint8_t* data, boost::uint64_t offset, size_t size)
+    {
+        if (size < 8)
+            return true;
+        for (size_t i = 0; i + 8 <= size; i += 65536) {
+            if (wordAt(data + i) != offset + i)
+                return false;
+        }
+        size_t last = (size - 8) & ~static_cast<size_t>(7);
+        return wordAt(data + last) == offset + last;
+    }
+
+    class StreamMeter
+    {
+    public:
+        StreamMeter() : pending(0), completed(0), failed(false), finished(false), position(0), peakResident(0) { }
+
+        void onWrite(bool ok, size_t, const std::string&)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            --pending;
+            ++completed;
+            failed = failed || !ok;
+            cond.notify_all();
+        }
+
+        void onChunk(boost::uint64_t offset, const boost::shared_array<uint8_t>& data, size_t size)
+        {
+            bool good = offset == position && checkPattern(data.get(), offset, size);
+            boost::uint64_t resident = bench::residentBytes();
+            boost::mutex::scoped_lock _l(mutex);
+            failed = failed || !good;
+            position = offset + size;
+            ++completed;
+            peakResident = (std::max)(peakResident, resident);
+            cond.notify_all();
+        }
+
+        void onDone(bool ok, const std::string& error)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            if (!ok)
+                printf("    read failed: %s\n", error.c_str());
+            failed = failed || !ok;
+            finished = true;
+            cond.notify_all();
+        }
+
+        // Waits until fewer than limit writes are in flight, and counts one more
+        void beginWrite(size_t limit)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            while (pending >= limit)
+                cond.wait(_l);
+            ++pending;
+        }
+
+        void waitForWrites()
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            while (pending)
+                cond.wait(_l);
+        }
+
+        // Waits until a chunk arrives beyond the first seen ones, or the reader finishes
+        size_t waitForChunk(size_t seen)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            while (completed <= seen && !finished)
+                cond.wait(_l);
+            return completed;
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        size_t pending;
+        size_t completed;
+        bool failed;
+        bool finished;
+        boost::uint64_t position;
+        boost::uint64_t peakResident;
+    };
+}
+
+TEST(AsyncFile_MultiGigabyteStream)
+{
+    PRINT_TESTNAME;
+
+    const boost::uint64_t fileSize(bench::envOr("FB_BENCH_FILE_MB", 2048) * bench::MiB);
+    const boost::uint64_t ceiling(bench::envOr("FB_BENCH_RSS_CEILING_MB", 64) * bench::MiB);
+    const size_t chunkSize = 1024 * 1024;
+    const size_t readAhead = 4;
+    const size_t writesInFlight = 8;
+    const std::string path(FB::System::getTempPath() + "/fbasyncbench-" + boost::lexical_cast<std::string>(rand()));
+
+    FB::AsyncFileServicePtr service(FB::AsyncFileService::create(4));
+    const boost::uint64_t baseline(bench::residentBytes());
+
+    // Written for real rather than sparse, so the reads go to the disk or at least the page cache
+    StreamMeter writes;
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    {
+        FB::AsyncFilePtr file(FB::AsyncFile::open(path, FB::AsyncFile::OPEN_WRITE | FB::AsyncFile::OPEN_CREATE
+            | FB::AsyncFile::OPEN_TRUNCATE, service));
+        for (boost::uint64_t offset = 0; offset < fileSize; offset += chunkSize) {
+            size_t size = static_cast<size_t>((std::min)(static_cast<boost::uint64_t>(chunkSize), fileSize - offset));
+            boost::shared_array<uint8_t> data(new uint8_t[size]);
+            fillPattern(data.get(), offset, size);
+            writes.beginWrite(writesInFlight);
+            file->write(offset, data, size, boost::bind(&StreamMeter::onWrite, &writes, _1, _2, _3));
+        }
+        writes.waitForWrites();
+        CHECK(!writes.failed);
+        CHECK_EQUAL(fileSize, file->size());
+    }
+    const double writeSeconds = bench::secondsSince(start);
+
+    // Then streamed back a credit at a time, the way a page would take it
+    StreamMeter reads;
+    start = boost::posix_time::microsec_clock::universal_time();
+    {
+        FB::AsyncFilePtr file(FB::AsyncFile::open(path, FB::AsyncFile::OPEN_READ, service));
+        FB::AsyncFileReaderPtr reader(FB::AsyncFileReader::create(file, 0, fileSize, chunkSize, readAhead,
+            boost::bind(&StreamMeter::onChunk, &reads, _1, _2, _3), boost::bind(&StreamMeter::onDone, &reads, _1, _2)));
+        reader->grant(readAhead);
+        size_t seen = 0;
+        while (!reader->isFinished()) {
+            size_t now = reads.waitForChunk(seen);
+            if (now > seen)
+                reader->grant(now - seen);
+            seen = now;
+        }
+    }
+    const double readSeconds = bench::secondsSince(start);
+
+    CHECK(reads.finished);
+    CHECK(!reads.failed);
+    CHECK_EQUAL(fileSize, reads.position);
+    CHECK_EQUAL(static_cast<size_t>((fileSize + chunkSize - 1) / chunkSize), reads.completed);
+
+    // Nothing close to the file's size is ever held
+    const boost::uint64_t growth(reads.peakResident > baseline ? reads.peakResident - baseline : 0);
+    CHECK(growth < ceiling);
+    printf("    %u MB: write %.0f MB/s, read %.0f MB/s; resident grew %.1f MB (ceiling %u MB)\n",
+        static_cast<unsigned>(fileSize / bench::MiB), fileSize / bench::MiB / writeSeconds,
+        fileSize / bench::MiB / readSeconds, growth / static_cast<double>(bench::MiB),
+        static_cast<unsigned>(ceiling / bench::MiB));
+
+    remove(path.c_str());
+}
@@ -0,0 +1,76 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#ifndef H_BENCH_UTIL
+#define H_BENCH_UTIL
+
+#include <cstdio>
+#include <cstdlib>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+namespace bench {
+    // Sizes and ceilings can be scaled from the environment, so CI can run bigger than a laptop
+    inline boost::uint64_t envOr(const char* name, boost::uint64_t fallback)
+    {
+        const char* value = getenv(name);
+        return value && *value ? strtoull(value, NULL, 10) : fallback;
+    }
+
+    // What the process has resident now. Where only the peak is available it is returned instead,
+    // which is still an upper bound on now.
+    inline boost::uint64_t residentBytes()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.WorkingSetSize;
+#elif defined(__linux__)
+        unsigned long size = 0, resident = 0;
+        FILE* statm = fopen("/proc/self/statm", "r");
+        if (!statm)
+            return 0;
+        int fields = fscanf(statm, "%lu %lu", &size, &resident);
+        fclose(statm);
+        return fields == 2 ? static_cast<boost::uint64_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        // Bytes on Mac, kilobytes elsewhere
+#if defined(__APPLE__)
+        return usage.ru_maxrss;
+#else
+        return static_cast<boost::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    inline double secondsSince(const boost::posix_time::ptime& start)
+    {
+        return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+    }
+
+    const boost::uint64_t MiB = 1024 * 1024;
+}
+
+#endif // H_BENCH_UTIL
@@ -0,0 +1,136 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include "JSAPIAuto.h"
+#include "variant_list.h"
+#include "variant_encoding.h"
+#include "bench_util.h"
+
+namespace {
+    // A property a page polls every frame, e.g. the state of a device
+    class PolledAPI : public FB::JSAPIAuto
+    {
+    public:
+        PolledAPI()
+        {
+            registerProperty("uncached", make_property(this, &PolledAPI::get_state));
+            registerCachedProperty("cached", make_property(this, &PolledAPI::get_state));
+            registerCachedProperty("slow", make_property(this, &PolledAPI::get_slow));
+        }
+
+        FB::VariantMap get_state()
+        {
+            FB::VariantMap res;
+            res["name"] = "camera";
+            res["connected"] = true;
+            res["width"] = 1920;
+            res["height"] = 1080;
+            res["fps"] = 29.97;
+            res["format"] = "yuv420";
+            res["exposure"] = 0.25;
+            res["modes"] = FB::VariantList(FB::variant_list_of("auto")("manual")("night"));
+            res["serial"] = "0123456789";
+            return res;
+        }
+        // As when a getter has to ask the device
+        int get_slow()
+        {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+            return 1;
+        }
+    };
+
+    // Stands in for a browser host turning the value into a page object
+    FB::variant convertForPage(const FB::variant& value)
+    {
+        return FB::encodeJSON(value);
+    }
+
+    void readSlow(const boost::shared_ptr<PolledAPI>& api)
+    {
+        api->GetProperty("slow");
+    }
+
+    void readCached(const boost::shared_ptr<PolledAPI>& api, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            api->GetProperty("cached");
+    }
+
+    void reportReads(const char* what, size_t count, double seconds)
+    {
+        printf("    %-34s %8u in %7.3f s, %8.3f us/read\n", what, static_cast<unsigned>(count), seconds,
+            seconds * 1e6 / count);
+    }
+}
+
+TEST(JSAPIAuto_CachedPropertyHotRead)
+{
+    PRINT_TESTNAME;
+
+    const size_t reads(static_cast<size_t>(bench::envOr("FB_BENCH_PROPERTY_READS", 200000)));
+    const size_t threads = 4;
+    boost::shared_ptr<PolledAPI> api(boost::make_shared<PolledAPI>());
+    const FB::BrowserHostPtr host;
+    const FB::HostValueConverter convert(&convertForPage);
+
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    for (size_t i = 0; i < reads; ++i)
+        api->GetProperty("uncached");
+    const double uncached(bench::secondsSince(start));
+    reportReads("uncached reads", reads, uncached);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < reads; ++i)
+        api->GetProperty("cached");
+    const double cached(bench::secondsSince(start));
+    reportReads("cached reads", reads, cached);
+    CHECK(cached < uncached);
+
+    // What a host pays: the getter and the conversion on every read, or neither
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < reads; ++i)
+        convertForPage(api->GetProperty("uncached"));
+    const double uncachedHost(bench::secondsSince(start));
+    reportReads("uncached reads, converted", reads, uncachedHost);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < reads; ++i)
+        api->GetPropertyForHost("cached", host, convert);
+    const double cachedHost(bench::secondsSince(start));
+    reportReads("cached reads, conversion cached", reads, cachedHost);
+    CHECK(cachedHost < uncachedHost);
+
+    // Several threads polling at once only share the lock for the lookup
+    start = boost::posix_time::microsec_clock::universal_time();
+    boost::thread_group pollers;
+    for (size_t t = 0; t < threads; ++t)
+        pollers.create_thread(boost::bind(&readCached, api, reads / threads));
+    pollers.join_all();
+    reportReads("cached reads, 4 threads", reads / threads * threads, bench::secondsSince(start));
+
+    // and a getter that takes its time doesn't hold up reads of anything else
+    boost::thread slow(boost::bind(&readSlow, api));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+    start = boost::posix_time::microsec_clock::universal_time();
+    readCached(api, 1000);
+    const double duringSlow(bench::secondsSince(start));
+    slow.join();
+    reportReads("cached reads during a slow getter", 1000, duringSlow);
+    CHECK(duringSlow < 0.1);
+}
@@ -0,0 +1,136 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include "KeyValueStore.h"
+#include "SystemHelpers.h"
+#include "bench_util.h"
+
+namespace {
+    std::string benchKey(size_t i)
+    {
+        return "key/" + boost::lexical_cast<std::string>(i);
+    }
+
+    // 100 bytes that differ from key to key
+    std::string benchValue(size_t i, int generation)
+    {
+        std::string value(boost::lexical_cast<std::string>(i) + ":" + boost::lexical_cast<std::string>(generation) + ":");
+        value.resize(100, static_cast<char>('a' + i % 26));
+        return value;
+    }
+
+    boost::uint64_t fileSize(const std::string& path)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        return in ? static_cast<boost::uint64_t>(in.tellg()) : 0;
+    }
+
+    void removeBenchStore(const std::string& dir)
+    {
+        remove((dir + "/snapshot").c_str());
+        remove((dir + "/snapshot.tmp").c_str());
+        remove((dir + "/log").c_str());
+        remove((dir + "/lock").c_str());
+        remove(dir.c_str());
+    }
+
+    void report(const char* what, size_t count, double seconds)
+    {
+        printf("    %-28s %8u in %7.3f s, %10.0f /s\n", what, static_cast<unsigned>(count), seconds, count / seconds);
+    }
+}
+
+TEST(KeyValueStore_Throughput)
+{
+    PRINT_TESTNAME;
+
+    const size_t keys(static_cast<size_t>(bench::envOr("FB_BENCH_KV_KEYS", 100000)));
+    const size_t syncedPuts(static_cast<size_t>(bench::envOr("FB_BENCH_KV_SYNCED", 500)));
+    const size_t batch = 1000;
+    const std::string dir(FB::System::getTempPath() + "/fbkvbench-" + boost::lexical_cast<std::string>(rand()));
+
+    // Each put its own transaction, flushed to disk before it returns; this is what a settings
+    // write costs
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+        for (size_t i = 0; i < syncedPuts; ++i)
+            store->put(benchKey(i), benchValue(i, 0));
+        report("synced single puts", syncedPuts, bench::secondsSince(start));
+    }
+    removeBenchStore(dir);
+
+    FB::KeyValueStore::Options options;
+    options.syncCommits = false;
+    FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir, options));
+
+    // Without the flush, so the cost is the store's own; the log passes the compaction threshold
+    // many times over along the way
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    for (size_t i = 0; i < keys; ++i)
+        store->put(benchKey(i), benchValue(i, 0));
+    report("unsynced single puts", keys, bench::secondsSince(start));
+
+    // Rewriting every key, batch keys to a transaction
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < keys; i += batch) {
+        FB::KeyValueTransaction txn;
+        for (size_t k = i; k < i + batch && k < keys; ++k)
+            txn.put(benchKey(k), benchValue(k, 1));
+        store->commit(txn);
+    }
+    report("keys in batched commits", keys, bench::secondsSince(start));
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    store->compact();
+    report("keys compacted", keys, bench::secondsSince(start));
+
+    // Once compacted the store takes about what its data does
+    const boost::uint64_t onDisk(fileSize(dir + "/snapshot") + fileSize(dir + "/log"));
+    const boost::uint64_t live(keys * (benchKey(keys).size() + 100));
+    CHECK(onDisk < live * 2);
+    printf("    %.1f MB on disk for %.1f MB of keys and values\n", onDisk / static_cast<double>(bench::MiB),
+        live / static_cast<double>(bench::MiB));
+
+    // Reads from the mapped snapshot, in an order the disk layout doesn't help with
+    std::vector<size_t> order(keys);
+    for (size_t i = 0; i < keys; ++i)
+        order[i] = i;
+    std::random_shuffle(order.begin(), order.end());
+    size_t wrong = 0;
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t i = 0; i < keys; ++i) {
+        boost::optional<std::string> value(store->get(benchKey(order[i])));
+        if (!value || *value != benchValue(order[i], 1))
+            ++wrong;
+    }
+    report("random gets", keys, bench::secondsSince(start));
+    CHECK_EQUAL(0u, wrong);
+
+    // and everything is still there after a reopen
+    store.reset();
+    start = boost::posix_time::microsec_clock::universal_time();
+    store = FB::KeyValueStore::open(dir, options);
+    CHECK_EQUAL(keys, store->size());
+    report("keys reopened", keys, bench::secondsSince(start));
+    CHECK(store->get(benchKey(keys - 1)) == benchValue(keys - 1, 1));
+
+    store.reset();
+    removeBenchStore(dir);
+}
@@ -0,0 +1,143 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "PluginEventSink.h"
+#include "PluginEventSource.h"
+#include "PluginEvents/MouseEvents.h"
+#include "PluginEvents/KeyboardEvents.h"
+#include "bench_util.h"
+
+namespace {
+    class BenchEventSource : public FB::PluginEventSource { };
+
+    // The handlers every sink below shares; what is measured is only how a case is picked
+    class BenchHandlers : public FB::PluginEventSink
+    {
+    public:
+        BenchHandlers() : handled(0) { }
+        bool onMouseDown(FB::MouseDownEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onMouseUp(FB::MouseUpEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onDoubleClick(FB::MouseDoubleClickEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onScroll(FB::MouseScrollEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onKeyDown(FB::KeyDownEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onKeyUp(FB::KeyUpEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onMouseEntered(FB::MouseEnteredEvent*, BenchEventSource*) { ++handled; return true; }
+        bool onMouseMove(FB::MouseMoveEvent*, BenchEventSource*) { ++handled; return true; }
+        volatile int handled;
+    };
+
+    class MappedSink : public BenchHandlers
+    {
+    public:
+        BEGIN_PLUGIN_EVENT_MAP()
+            EVENTTYPE_CASE(FB::MouseDownEvent, onMouseDown, BenchEventSource)
+            EVENTTYPE_CASE(FB::MouseUpEvent, onMouseUp, BenchEventSource)
+            EVENTTYPE_CASE(FB::MouseDoubleClickEvent, onDoubleClick, BenchEventSource)
+            EVENTTYPE_CASE(FB::MouseScrollEvent, onScroll, BenchEventSource)
+            EVENTTYPE_CASE(FB::KeyDownEvent, onKeyDown, BenchEventSource)
+            EVENTTYPE_CASE(FB::KeyUpEvent, onKeyUp, BenchEventSource)
+            EVENTTYPE_CASE(FB::MouseEnteredEvent, onMouseEntered, BenchEventSource)
+            EVENTTYPE_CASE(FB::MouseMoveEvent, onMouseMove, BenchEventSource)
+        END_PLUGIN_EVENT_MAP()
+    };
+
+    // The same map written out the way the macros used to expand it
+    class LadderSink : public BenchHandlers
+    {
+    public:
+        virtual bool HandleEvent(FB::PluginEvent* evt, FB::PluginEventSource* src)
+        {
+#define LADDER_CASE(eventType, methodName) \
+            if (evt->validType<eventType>() && src->validType<BenchEventSource>()) \
+                return methodName(evt->get<eventType>(), src->get_as<BenchEventSource>());
+            LADDER_CASE(FB::MouseDownEvent, onMouseDown)
+            LADDER_CASE(FB::MouseUpEvent, onMouseUp)
+            LADDER_CASE(FB::MouseDoubleClickEvent, onDoubleClick)
+            LADDER_CASE(FB::MouseScrollEvent, onScroll)
+            LADDER_CASE(FB::KeyDownEvent, onKeyDown)
+            LADDER_CASE(FB::KeyUpEvent, onKeyUp)
+            LADDER_CASE(FB::MouseEnteredEvent, onMouseEntered)
+            LADDER_CASE(FB::MouseMoveEvent, onMouseMove)
+#undef LADDER_CASE
+            return false;
+        }
+    };
+
+    // Mostly mouse moves, which sit at the bottom of the map, with the odd click and key
+    struct BenchEvents
+    {
+        BenchEvents()
+            : move(10, 10), down(FB::MouseButtonEvent::MouseButton_Left, 10, 10),
+              up(FB::MouseButtonEvent::MouseButton_Left, 10, 10), key(FB::FBKEY_SPACE, 32)
+        {
+            for (size_t i = 0; i < 16; ++i)
+                mix[i] = &move;
+            mix[3] = &down;
+            mix[7] = &up;
+            mix[11] = &key;
+        }
+        FB::MouseMoveEvent move;
+        FB::MouseDownEvent down;
+        FB::MouseUpEvent up;
+        FB::KeyDownEvent key;
+        FB::PluginEvent* mix[16];
+    };
+
+    void dispatchEvents(FB::PluginEventSink* sink, size_t count)
+    {
+        BenchEvents events;
+        BenchEventSource src;
+        for (size_t i = 0; i < count; ++i)
+            sink->HandleEvent(events.mix[i % 16], &src);
+    }
+
+    void reportDispatches(const char* what, size_t count, double seconds)
+    {
+        printf("    %-34s %8u in %7.3f s, %8.3f ns/event\n", what, static_cast<unsigned>(count), seconds,
+            seconds * 1e9 / count);
+    }
+}
+
+TEST(PluginEventMap_DispatchVersusCastLadder)
+{
+    PRINT_TESTNAME;
+
+    const size_t count(static_cast<size_t>(bench::envOr("FB_BENCH_EVENT_DISPATCHES", 2000000)));
+    const size_t threads = 4;
+    LadderSink ladder;
+    MappedSink mapped;
+
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    dispatchEvents(&ladder, count);
+    const double ladderTime(bench::secondsSince(start));
+    reportDispatches("dynamic_cast ladder", count, ladderTime);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    dispatchEvents(&mapped, count);
+    const double mappedTime(bench::secondsSince(start));
+    reportDispatches("event map", count, mappedTime);
+    CHECK(ladder.handled == mapped.handled);
+    CHECK(mappedTime < ladderTime);
+
+    // Lookups take no lock, so threads dispatching to the same map don't queue up behind each other
+    start = boost::posix_time::microsec_clock::universal_time();
+    boost::thread_group dispatchers;
+    for (size_t t = 0; t < threads; ++t)
+        dispatchers.create_thread(boost::bind(&dispatchEvents, &mapped, count / threads));
+    dispatchers.join_all();
+    reportDispatches("event map, 4 threads", count / threads * threads, bench::secondsSince(start));
+}
@@ -0,0 +1,121 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "SharedString.h"
+#include "variant_list.h"
+#include "bench_util.h"
+
+namespace {
+    // Six string arguments put in a list, then copied as proxyProcessList and a cross thread call do
+    template <class S>
+    size_t passArguments(const S& url, const S& mime)
+    {
+        FB::VariantList args(FB::variant_list_of(url)(mime)(url)(mime)(url)(mime));
+        FB::VariantList proxied(args);
+        FB::VariantList queued(proxied);
+        size_t total = 0;
+        for (size_t i = 0; i < queued.size(); ++i)
+            total += queued[i].cast<S>().size();
+        return total;
+    }
+
+    // An event's arguments, copied for each of eight listeners
+    template <class S>
+    size_t fireEvent(const S& name, const S& status, int progress)
+    {
+        FB::VariantList args(FB::variant_list_of(name)(status)(progress));
+        size_t total = 0;
+        for (int l = 0; l < 8; ++l) {
+            FB::VariantList perListener(args);
+            total += perListener.size();
+        }
+        return total;
+    }
+
+    // A string the page passed in, made into a variant of either kind, carried to a method that
+    // takes a std::string. Hosts make std::strings, which every method and CatchAll already expects;
+    // a SharedString would save nothing here
+    template <class S>
+    size_t receiveString(const char* chars, size_t length)
+    {
+        FB::VariantList args(1, FB::variant(S(chars, length)));
+        FB::VariantList proxied(args);
+        return proxied[0].convert_cast<std::string>().size();
+    }
+
+    template <class S>
+    double timeArguments(size_t count, size_t& sink)
+    {
+        const S url("https://example.com/some/resource/path?query=1"), mime("application/x-some-mime-type");
+        boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+        for (size_t i = 0; i < count; ++i)
+            sink += passArguments(url, mime);
+        return bench::secondsSince(start);
+    }
+
+    template <class S>
+    double timeEvents(size_t count, size_t& sink)
+    {
+        const S name("ondownloadprogressupdated"), status("a status string that is over the inline size");
+        boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+        for (size_t i = 0; i < count; ++i)
+            sink += fireEvent(name, status, static_cast<int>(i));
+        return bench::secondsSince(start);
+    }
+
+    template <class S>
+    double timeReceive(size_t count, size_t& sink)
+    {
+        const char* page = "{\"id\":42,\"name\":\"a value the page sent as JSON\",\"tags\":[\"a\",\"b\"]}";
+        const size_t length = strlen(page);
+        boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+        for (size_t i = 0; i < count; ++i)
+            sink += receiveString<S>(page, length);
+        return bench::secondsSince(start);
+    }
+
+    void reportStrings(const char* what, size_t count, double plain, double shared)
+    {
+        printf("    %-26s std::string %7.3f us, SharedString %7.3f us\n", what, plain * 1e6 / count,
+            shared * 1e6 / count);
+    }
+}
+
+TEST(SharedString_ArgumentsAndEvents)
+{
+    PRINT_TESTNAME;
+
+    const size_t count(static_cast<size_t>(bench::envOr("FB_BENCH_STRING_CALLS", 300000)));
+    size_t sink = 0;
+
+    const double plainArgs(timeArguments<std::string>(count, sink));
+    const double sharedArgs(timeArguments<FB::SharedString>(count, sink));
+    reportStrings("6 string arguments", count, plainArgs, sharedArgs);
+    CHECK(sharedArgs < plainArgs);
+
+    const double plainEvents(timeEvents<std::string>(count, sink));
+    const double sharedEvents(timeEvents<FB::SharedString>(count, sink));
+    reportStrings("event to 8 listeners", count, plainEvents, sharedEvents);
+    CHECK(sharedEvents < plainEvents);
+
+    // Converting at the method costs the one copy either way
+    const double plainReceive(timeReceive<std::string>(count, sink));
+    const double sharedReceive(timeReceive<FB::SharedString>(count, sink));
+    reportStrings("string from the page", count, plainReceive, sharedReceive);
+
+    CHECK(sink > 0);
+}
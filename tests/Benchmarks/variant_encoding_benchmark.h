@@ -0,0 +1,203 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <boost/make_shared.hpp>
+#include "variant_list.h"
+#include "variant_map.h"
+#include "variant_encoding.h"
+#include "Blob.h"
+#include "fbjson.h"
+#include "bench_util.h"
+
+namespace {
+    // What a directory listing sends back: one record per file
+    FB::VariantList fileRecords(size_t count)
+    {
+        FB::VariantList records;
+        for (size_t i = 0; i < count; ++i) {
+            char name[32];
+            sprintf(name, "IMG_%04u.jpg", static_cast<unsigned>(i));
+            FB::VariantMap record;
+            record["name"] = std::string(name);
+            record["path"] = std::string("/home/user/Pictures/2026/") + name;
+            record["size"] = FB::variant(static_cast<boost::int64_t>(3000000 + i * 7919), true);
+            record["modified"] = 1792400000.0 + i * 61.25;
+            record["hidden"] = (i % 10) == 0;
+            record["type"] = "image/jpeg";
+            record["tags"] = FB::VariantList(FB::variant_list_of("camera")(static_cast<int>(i % 5)));
+            records.push_back(record);
+        }
+        return records;
+    }
+
+    // Thumbnails: as Blobs for the binary encoding, as base64 strings for JSON, which has no bytes
+    std::string thumbnailBytes(size_t index, size_t size)
+    {
+        std::string bytes(size, '\0');
+        boost::uint32_t state = static_cast<boost::uint32_t>(index) * 2654435761u + 1;
+        for (size_t i = 0; i < size; ++i) {
+            state = state * 1103515245u + 12345u;
+            bytes[i] = static_cast<char>(state >> 24);
+        }
+        return bytes;
+    }
+
+    const char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string toBase64(const char* data, size_t size)
+    {
+        std::string out;
+        out.reserve((size + 2) / 3 * 4);
+        for (size_t i = 0; i < size; i += 3) {
+            boost::uint32_t n = static_cast<unsigned char>(data[i]) << 16;
+            if (i + 1 < size) n |= static_cast<unsigned char>(data[i + 1]) << 8;
+            if (i + 2 < size) n |= static_cast<unsigned char>(data[i + 2]);
+            out += base64Chars[(n >> 18) & 63];
+            out += base64Chars[(n >> 12) & 63];
+            out += i + 1 < size ? base64Chars[(n >> 6) & 63] : '=';
+            out += i + 2 < size ? base64Chars[n & 63] : '=';
+        }
+        return out;
+    }
+
+    std::string fromBase64(const std::string& text)
+    {
+        std::string out;
+        out.reserve(text.size() / 4 * 3);
+        boost::uint32_t n = 0;
+        int bits = 0;
+        for (std::string::const_iterator it = text.begin(); it != text.end() && *it != '='; ++it) {
+            n = (n << 6) | static_cast<boost::uint32_t>(strchr(base64Chars, *it) - base64Chars);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out += static_cast<char>((n >> bits) & 0xff);
+            }
+        }
+        return out;
+    }
+
+    void reportEncoding(const char* what, size_t bytes, double encodeSeconds, double decodeSeconds, size_t rounds)
+    {
+        printf("    %-34s %8u bytes, encode %8.3f ms, decode %8.3f ms\n", what, static_cast<unsigned>(bytes),
+            encodeSeconds * 1e3 / rounds, decodeSeconds * 1e3 / rounds);
+    }
+}
+
+TEST(VariantEncoding_BinaryVersusJSON)
+{
+    PRINT_TESTNAME;
+
+    const size_t rounds(static_cast<size_t>(bench::envOr("FB_BENCH_ENCODING_ROUNDS", 20)));
+    const size_t thumbnails = 32;
+    const size_t thumbnailSize = 16 * 1024;
+
+    // 1000 file records
+    const FB::variant records(fileRecords(1000));
+    std::string binary, json;
+
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    for (size_t r = 0; r < rounds; ++r)
+        binary = FB::encodeVariant(records);
+    const double binaryEncode(bench::secondsSince(start));
+    start = boost::posix_time::microsec_clock::universal_time();
+    size_t decoded = 0;
+    for (size_t r = 0; r < rounds; ++r)
+        decoded += FB::decodeVariant(binary).cast<FB::VariantList>().size();
+    const double binaryDecode(bench::secondsSince(start));
+    reportEncoding("records, binary", binary.size(), binaryEncode, binaryDecode, rounds);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t r = 0; r < rounds; ++r) {
+        json.clear();
+        FB::appendVariantAsJson(json, records);
+    }
+    const double jsonEncode(bench::secondsSince(start));
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t r = 0; r < rounds; ++r)
+        decoded += FB::jsonToVariantValue(json).cast<FB::VariantList>().size();
+    const double jsonDecode(bench::secondsSince(start));
+    reportEncoding("records, JSON", json.size(), jsonEncode, jsonDecode, rounds);
+
+    CHECK_EQUAL(2 * rounds * 1000, decoded);
+    CHECK(binary.size() < json.size());
+    CHECK(binaryEncode < jsonEncode);
+    CHECK(binaryDecode < jsonDecode);
+
+    // 32 thumbnails of 16 KB
+    FB::VariantList blobs;
+    for (size_t i = 0; i < thumbnails; ++i)
+        blobs.push_back(FB::Blob(thumbnailBytes(i, thumbnailSize)));
+    const FB::variant blobList(blobs);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t r = 0; r < rounds; ++r)
+        binary = FB::encodeVariant(blobList);
+    const double blobEncode(bench::secondsSince(start));
+    start = boost::posix_time::microsec_clock::universal_time();
+    size_t bytesOut = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        FB::VariantList out(FB::decodeVariant(binary).cast<FB::VariantList>());
+        bytesOut += out.back().cast<FB::Blob>().size();
+    }
+    const double blobDecode(bench::secondsSince(start));
+    reportEncoding("thumbnails, binary", binary.size(), blobEncode, blobDecode, rounds);
+
+    // Blobs can point into the buffer they were read from rather than being copied out of it
+    const boost::shared_ptr<const std::string> shared(boost::make_shared<std::string>(binary));
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t r = 0; r < rounds; ++r) {
+        FB::VariantReader reader(shared);
+        FB::VariantList out(reader.read().cast<FB::VariantList>());
+        bytesOut += out.back().cast<FB::Blob>().size();
+    }
+    const double sharedDecode(bench::secondsSince(start));
+    reportEncoding("thumbnails, binary sharing input", binary.size(), blobEncode, sharedDecode, rounds);
+
+    // JSON, with the base64 done both ways as part of the encoding
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t r = 0; r < rounds; ++r) {
+        FB::VariantList strings;
+        for (size_t i = 0; i < thumbnails; ++i) {
+            const FB::Blob& blob(blobs[i].cast<FB::Blob>());
+            strings.push_back(toBase64(blob.data(), blob.size()));
+        }
+        json.clear();
+        FB::appendVariantAsJson(json, strings);
+    }
+    const double blobJsonEncode(bench::secondsSince(start));
+    std::string lastThumbnail;
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (size_t r = 0; r < rounds; ++r) {
+        FB::VariantList strings(FB::jsonToVariantValue(json).cast<FB::VariantList>());
+        FB::VariantList out;
+        for (size_t i = 0; i < strings.size(); ++i)
+            out.push_back(FB::Blob(fromBase64(strings[i].cast<std::string>())));
+        bytesOut += out.back().cast<FB::Blob>().size();
+        lastThumbnail = out.back().cast<FB::Blob>().str();
+    }
+    const double blobJsonDecode(bench::secondsSince(start));
+    reportEncoding("thumbnails, base64 in JSON", json.size(), blobJsonEncode, blobJsonDecode, rounds);
+
+    CHECK_EQUAL(3 * rounds * thumbnailSize, bytesOut);
+    CHECK(FB::decodeVariant(binary).cast<FB::VariantList>()[5].cast<FB::Blob>().str() == thumbnailBytes(5, thumbnailSize));
+    CHECK(lastThumbnail == thumbnailBytes(thumbnails - 1, thumbnailSize));
+    CHECK(binary.size() < json.size());
+    CHECK(blobEncode < blobJsonEncode);
+    CHECK(blobDecode < blobJsonDecode);
+    CHECK(sharedDecode <= blobDecode);
+}
@@ -0,0 +1,43 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstring>
+#include "UnitTest++.h"
+#include "Reactor.h"
+
+#define PRINT_TESTNAME  printf("Running unit test %s::%s...\n", UnitTestSuite::GetSuiteName(), m_details.testName); \
+    fflush(stdout)
+
+// Every test here talks to a real service over loopback sockets
+#include "blob_registry_test.h"
+#include "local_socket_test.h"
+#include "json_rpc_gateway_test.h"
+#include "metrics_test.h"
+#include "reconfigure_test.h"
+#include "retry_test.h"
+#include "shared_reactor_test.h"
+#include "upload_journal_test.h"
+
+int main(int argc, char* argv[])
+{
+#if defined(__linux__)
+    // UploadQueue_ResumesAfterKill runs its uploader in a copy of this process
+    if (argc == 4 && strcmp(argv[1], "--upload-worker") == 0)
+        return runUploadWorker(argv[2], argv[3]);
+#endif
+    int failures = UnitTest::RunAllTests();
+    // As a plugin does when it unloads, so no pool thread outlives main
+    FB::Reactor::shutdownInstance();
+    return failures;
+}
@@ -0,0 +1,180 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <fstream>
+#include <set>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include "HTTPService.h"
+#include "HTTPService/BlobRegistry.h"
+#include "loopback.h"
+
+namespace {
+    // Every byte differs from its neighbours, so a slice from the wrong offset can't pass
+    std::string blobPattern(size_t len) {
+        std::string res(len, '\0');
+        for (size_t i = 0; i < len; ++i)
+            res[i] = static_cast<char>('a' + (i * 7 + i / 26) % 26);
+        return res;
+    }
+
+    loopback::Reply getRange(const FB::URI& uri, const std::string& range) {
+        return loopback::get(uri, uri.path, range.empty() ? std::string() : "Range: " + range + "\r\n");
+    }
+
+    bool isBlobId(const std::string& id) {
+        return id.size() == 32 && id.find_first_not_of("0123456789abcdef") == std::string::npos;
+    }
+}
+
+TEST(BlobRegistry_Ranges)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    HTTP::BlobRegistryPtr blobs(HTTP::BlobRegistry::create(svc));
+    const std::string data(blobPattern(100000));
+    const FB::URI uri(blobs->registerBlob(data, "application/octet-stream"));
+
+    loopback::Reply reply(getRange(uri, ""));
+    CHECK_EQUAL(200, reply.code);
+    CHECK(reply.body == data);
+    CHECK_EQUAL("bytes", reply.header("Accept-Ranges"));
+    CHECK_EQUAL("application/octet-stream", reply.header("Content-Type"));
+
+    // A single range comes back as 206 with just those bytes
+    reply = getRange(uri, "bytes=0-3");
+    CHECK_EQUAL(206, reply.code);
+    CHECK_EQUAL("bytes 0-3/100000", reply.header("Content-Range"));
+    CHECK_EQUAL(data.substr(0, 4), reply.body);
+
+    reply = getRange(uri, "bytes=65530-65545");
+    CHECK_EQUAL(206, reply.code);
+    CHECK_EQUAL("bytes 65530-65545/100000", reply.header("Content-Range"));
+    CHECK_EQUAL(data.substr(65530, 16), reply.body);
+
+    // Open ended, and past the end, run to the last byte
+    reply = getRange(uri, "bytes=99990-");
+    CHECK_EQUAL("bytes 99990-99999/100000", reply.header("Content-Range"));
+    CHECK_EQUAL(data.substr(99990), reply.body);
+    reply = getRange(uri, "bytes=99998-200000");
+    CHECK_EQUAL("bytes 99998-99999/100000", reply.header("Content-Range"));
+    CHECK_EQUAL(data.substr(99998), reply.body);
+
+    // A suffix is the last n bytes, or all of them if there aren't that many
+    reply = getRange(uri, "bytes=-5");
+    CHECK_EQUAL("bytes 99995-99999/100000", reply.header("Content-Range"));
+    CHECK_EQUAL(data.substr(99995), reply.body);
+    reply = getRange(uri, "bytes=-200000");
+    CHECK_EQUAL(206, reply.code);
+    CHECK_EQUAL("bytes 0-99999/100000", reply.header("Content-Range"));
+    CHECK(reply.body == data);
+
+    // Ranges that start past the end can't be satisfied
+    reply = getRange(uri, "bytes=100000-");
+    CHECK_EQUAL(416, reply.code);
+    CHECK_EQUAL("bytes */100000", reply.header("Content-Range"));
+    CHECK(reply.body.empty());
+    CHECK_EQUAL(416, getRange(uri, "bytes=-0").code);
+
+    // Several ranges, backwards ones and nonsense all get the whole blob
+    const char* ignored[] = { "bytes=0-3,10-20", "bytes=20-10", "bytes=x-y", "pages=1-2" };
+    for (int i = 0; i < 4; ++i) {
+        reply = getRange(uri, ignored[i]);
+        CHECK_EQUAL(200, reply.code);
+        CHECK(reply.header("Content-Range").empty());
+        CHECK_EQUAL(data.size(), reply.body.size());
+    }
+
+    // Ranges of a file region count from the start of the region
+    const std::string path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("fbhttptest-%%%%%%%%.blob")).string());
+    {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out << data;
+    }
+    const FB::URI region(blobs->registerFile(path, "text/plain", 0, 1000, 500));
+    reply = getRange(region, "");
+    CHECK_EQUAL(200, reply.code);
+    CHECK_EQUAL(data.substr(1000, 500), reply.body);
+    reply = getRange(region, "bytes=100-109");
+    CHECK_EQUAL("bytes 100-109/500", reply.header("Content-Range"));
+    CHECK_EQUAL(data.substr(1100, 10), reply.body);
+    reply = getRange(region, "bytes=-10");
+    CHECK_EQUAL(data.substr(1490, 10), reply.body);
+    CHECK_EQUAL(416, getRange(region, "bytes=500-").code);
+    boost::filesystem::remove(path);
+
+    // Blobs are only fetched
+    CHECK_EQUAL(405, loopback::request<boost::asio::ip::tcp>(loopback::endpoint(uri), "POST", uri.path, "x").code);
+
+    svc->terminate();
+}
+
+TEST(BlobRegistry_UnguessableIds)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    HTTP::BlobRegistryPtr blobs(HTTP::BlobRegistry::create(svc));
+
+    // Every id is 128 bits of hex, all of them different, with no position stuck on a few values
+    const size_t count = 256;
+    std::set<std::string> ids;
+    std::vector<std::set<char> > digits(32);
+    FB::URI last;
+    for (size_t i = 0; i < count; ++i) {
+        last = blobs->registerBlob("blob " + boost::lexical_cast<std::string>(i), "text/plain");
+        CHECK_EQUAL(0u, last.path.find("/blob/"));
+        const std::string id(last.path.substr(6));
+        CHECK(isBlobId(id));
+        ids.insert(id);
+        for (size_t d = 0; d < id.size() && d < digits.size(); ++d)
+            digits[d].insert(id[d]);
+    }
+    CHECK_EQUAL(count, ids.size());
+    CHECK_EQUAL(count, blobs->size());
+    for (size_t d = 0; d < digits.size(); ++d)
+        CHECK(digits[d].size() >= 12);
+
+    // Nothing short of the exact id finds a blob, and a miss looks the same as a revoked blob
+    CHECK_EQUAL(std::string("blob 255"), getRange(last, "").body);
+    const std::string id(last.path.substr(6));
+    std::string neighbour(id);
+    neighbour[31] = neighbour[31] == '0' ? '1' : '0';
+    const std::string misses[] = { "/blob/" + neighbour, "/blob/" + id.substr(0, 31), "/blob/" + id + "0",
+        "/blob/" + id.substr(0, 16), "/blob/", "/blob/" + std::string(32, '0') };
+    const loopback::Reply unknown(loopback::get(last, misses[0]));
+    CHECK_EQUAL(404, unknown.code);
+    for (int i = 1; i < 6; ++i) {
+        loopback::Reply reply(loopback::get(last, misses[i]));
+        CHECK_EQUAL(404, reply.code);
+        CHECK_EQUAL(unknown.body, reply.body);
+    }
+    CHECK(blobs->revoke(last));
+    CHECK(!blobs->revoke(last));
+    loopback::Reply revoked(getRange(last, ""));
+    CHECK_EQUAL(404, revoked.code);
+    CHECK_EQUAL(unknown.body, revoked.body);
+
+    // Expired blobs are gone too, whether or not anything has purged them yet
+    const FB::URI brief(blobs->registerBlob("brief", "text/plain", 0.05));
+    CHECK_EQUAL(200, getRange(brief, "").code);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    CHECK_EQUAL(404, getRange(brief, "").code);
+    CHECK(!blobs->revoke(brief));
+
+    blobs->revokeAll();
+    CHECK_EQUAL(0u, blobs->size());
+    svc->terminate();
+}
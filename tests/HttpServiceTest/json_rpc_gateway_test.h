@@ -0,0 +1,214 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/future.hpp>
+#include "BrowserHost.h"
+#include "JSAPIAuto.h"
+#include "JSExceptions.h"
+#include "HTTPService.h"
+#include "HTTPService/JsonRpcGateway.h"
+#include "loopback.h"
+
+namespace {
+    // A host whose main thread is a thread of its own running an io_service; that is all of a
+    // browser the gateway needs
+    class GatewayTestHost : public FB::BrowserHost
+    {
+    public:
+        explicit GatewayTestHost(boost::asio::io_service& io) : m_io(io)
+        {
+            // There's no page to take it from, and calls are only scheduled for a known origin
+            setPageOrigin("http://localhost");
+        }
+
+        void* getContextID() const { return const_cast<GatewayTestHost*>(this); }
+        FB::DOM::DocumentPtr getDOMDocument() { return FB::DOM::DocumentPtr(); }
+        FB::DOM::WindowPtr getDOMWindow() { return FB::DOM::WindowPtr(); }
+        FB::DOM::ElementPtr getDOMElement() { return FB::DOM::ElementPtr(); }
+        void evaluateJavaScript(const std::string&) { }
+        void DoDeferredRelease() const { }
+
+    protected:
+        bool _scheduleAsyncCall(void (*func)(void *), void *userData) const
+        {
+            m_io.post(boost::bind(func, userData));
+            return true;
+        }
+        FB::BrowserStreamPtr _createStream(const FB::BrowserStreamRequest&) const { return FB::BrowserStreamPtr(); }
+        FB::BrowserStreamPtr _createUnsolicitedStream(const FB::BrowserStreamRequest&) const { return FB::BrowserStreamPtr(); }
+
+    private:
+        boost::asio::io_service& m_io;
+    };
+
+    // The host has to be made on the thread that is to be its main thread
+    void runGatewayHost(boost::asio::io_service* io, boost::promise<FB::BrowserHostPtr>* made)
+    {
+        made->set_value(boost::make_shared<GatewayTestHost>(boost::ref(*io)));
+        io->run();
+    }
+
+    // Members in the style of FBTestPluginAPI, plus one only a trusted caller may use
+    class GatewayTestAPI : public FB::JSAPIAuto
+    {
+    public:
+        GatewayTestAPI(const FB::BrowserHostPtr& host) : m_host(host), m_count(0), offMainThread(0)
+        {
+            registerMethod("add", make_method(this, &GatewayTestAPI::add));
+            registerMethod("echo", make_method(this, &GatewayTestAPI::echo));
+            registerMethod("fail", make_method(this, &GatewayTestAPI::fail));
+            registerProperty("count", make_property(this, &GatewayTestAPI::get_count, &GatewayTestAPI::set_count));
+            {
+                FB::scoped_zonelock _l(this, FB::SecurityScope_Local);
+                registerMethod("secret", make_method(this, &GatewayTestAPI::secret));
+            }
+        }
+
+        int add(int a, int b) { check(); return m_count += a + b; }
+        FB::variant echo(const FB::variant& value) { check(); return value; }
+        void fail() { check(); throw FB::script_error("it failed"); }
+        std::string secret() { check(); return "hidden"; }
+        int get_count() { check(); return m_count; }
+        void set_count(int count) { check(); m_count = count; }
+        // For the test itself, off the main thread, once the calls it made have been answered
+        int count() const { return m_count; }
+
+    private:
+        void check()
+        {
+            if (!m_host->isMainThread())
+                ++offMainThread;
+        }
+        FB::BrowserHostPtr m_host;
+        int m_count;
+
+    public:
+        int offMainThread;
+    };
+
+    // A gateway's path, signed by the service it is on
+    std::string signedPath(const boost::shared_ptr<HTTP::HTTPService>& svc, const std::string& path)
+    {
+        FB::URI uri(svc->getBaseUri());
+        uri.path = path;
+        svc->sign_uri(uri);
+        return uri.toString(false);
+    }
+
+    loopback::Reply post(const boost::shared_ptr<HTTP::HTTPService>& svc, const std::string& target,
+        const std::string& body)
+    {
+        return loopback::request<boost::asio::ip::tcp>(loopback::endpoint(svc->getBaseUri()), "POST", target, body);
+    }
+}
+
+TEST(JsonRpcGateway_Loopback)
+{
+    PRINT_TESTNAME;
+
+    boost::asio::io_service io;
+    boost::scoped_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(io));
+    boost::promise<FB::BrowserHostPtr> made;
+    boost::thread mainThread(boost::bind(&runGatewayHost, &io, &made));
+    FB::BrowserHostPtr host(made.get_future().get());
+
+    boost::shared_ptr<GatewayTestAPI> api(boost::make_shared<GatewayTestAPI>(host));
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    HTTP::JsonRpcGatewayPtr gateway(HTTP::JsonRpcGateway::create(svc));
+    gateway->publish("test", api, host);
+    gateway->publish("trusted", api, host, FB::SecurityScope_Local);
+    const std::string rpc(signedPath(svc, "/rpc"));
+
+    // A single call
+    loopback::Reply reply(post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[2,3],\"id\":1}"));
+    CHECK_EQUAL(200, reply.code);
+    CHECK_EQUAL("application/json", reply.header("Content-Type"));
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"result\":5,\"id\":1}", reply.body);
+
+    // Values come back as they went in, without a Json::Value in between
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"test.echo\","
+        "\"params\":[{\"a\":[1,2.5,\"x\\\"y\",true,null]}],\"id\":\"e\"}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"result\":{\"a\":[1,2.5,\"x\\\"y\",true,null]},\"id\":\"e\"}", reply.body);
+
+    // A batch answers its calls in order, skips its notification and reports errors in place
+    reply = post(svc, rpc, "["
+        "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[1,1],\"id\":1},"
+        "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[10,0]},"
+        "{\"jsonrpc\":\"2.0\",\"method\":\"test.fail\",\"params\":[],\"id\":2},"
+        "{\"jsonrpc\":\"2.0\",\"method\":\"test.nothing\",\"params\":[],\"id\":3},"
+        "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.get\",\"params\":[\"test\",\"count\"],\"id\":4}]");
+    CHECK_EQUAL(200, reply.code);
+    CHECK_EQUAL("[{\"jsonrpc\":\"2.0\",\"result\":7,\"id\":1},"
+        "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32000,\"message\":\"it failed\"},\"id\":2},"
+        "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32601,\"message\":\"Method not found\"},\"id\":3},"
+        "{\"jsonrpc\":\"2.0\",\"result\":17,\"id\":4}]", reply.body);
+
+    // Notifications alone get no content, but still run before anything sent after them
+    reply = post(svc, rpc, "[{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[3,0]},"
+        "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.set\",\"params\":[\"test\",\"count\",100]}]");
+    CHECK_EQUAL(204, reply.code);
+    CHECK_EQUAL("", reply.body);
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[0,1]}");
+    CHECK_EQUAL(204, reply.code);
+
+    // Properties
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.get\",\"params\":[\"test\",\"count\"],\"id\":5}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"result\":101,\"id\":5}", reply.body);
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.set\",\"params\":[\"test\",\"count\",42],\"id\":6}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"result\":null,\"id\":6}", reply.body);
+    CHECK_EQUAL(42, api->count());
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"rpc.get\",\"params\":[\"test\"],\"id\":7}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32602,\"message\":\"Expected [object, property]\"},\"id\":7}",
+        reply.body);
+
+    // A member registered for a higher zone than the object was published with can't be reached
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"test.secret\",\"params\":[],\"id\":8}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32601,\"message\":\"Method not found\"},\"id\":8}", reply.body);
+    reply = post(svc, rpc, "{\"jsonrpc\":\"2.0\",\"method\":\"trusted.secret\",\"params\":[],\"id\":9}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"result\":\"hidden\",\"id\":9}", reply.body);
+
+    // Malformed requests
+    reply = post(svc, rpc, "{\"jsonrpc\":");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32700,\"message\":\"Parse error\"},\"id\":null}", reply.body);
+    reply = post(svc, rpc, "[]");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32600,\"message\":\"Empty batch\"},\"id\":null}", reply.body);
+    reply = loopback::request<boost::asio::ip::tcp>(loopback::endpoint(svc->getBaseUri()), "GET", rpc);
+    CHECK_EQUAL(405, reply.code);
+
+    // Without the service's signature nothing is answered, and nothing is called
+    reply = post(svc, "/rpc", "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[1,0],\"id\":10}");
+    CHECK_EQUAL(500, reply.code);
+    reply = post(svc, "/rpc?_s=AAAA", "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[1,0],\"id\":11}");
+    CHECK_EQUAL(500, reply.code);
+    CHECK_EQUAL(42, api->count());
+    // unless the gateway is told not to ask for one
+    gateway->require_signature = false;
+    reply = post(svc, "/rpc", "{\"jsonrpc\":\"2.0\",\"method\":\"test.add\",\"params\":[1,0],\"id\":12}");
+    CHECK_EQUAL("{\"jsonrpc\":\"2.0\",\"result\":43,\"id\":12}", reply.body);
+
+    // Every call was made on the host's main thread
+    CHECK_EQUAL(0, api->offMainThread);
+
+    svc->terminate();
+    gateway.reset();
+    api.reset();
+    work.reset();
+    mainThread.join();
+}
@@ -0,0 +1,154 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/asio.hpp>
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/make_shared.hpp>
+#include "HTTPService.h"
+#include "loopback.h"
+
+namespace {
+    typedef boost::asio::local::stream_protocol local_protocol;
+
+    std::string localSocketPath(const char* name) {
+        return "/tmp/fbhttptest-" + boost::lexical_cast<std::string>(::getpid()) + "-" + name;
+    }
+
+    bool isSocket(const std::string& path) {
+        struct stat st;
+        return ::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode);
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream in(path.c_str());
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    bool createLocalFails(const std::string& path) {
+        try {
+            HTTP::HTTPService::createLocal(path);
+        } catch (const std::exception&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+TEST(BasicService_LocalSocket)
+{
+    PRINT_TESTNAME;
+
+    const std::string path(localSocketPath("local"));
+    boost::shared_ptr<loopback::FixedHandler> handler(boost::make_shared<loopback::FixedHandler>());
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::createLocal(path));
+    svc->registerHandler(handler);
+    CHECK_EQUAL(path, svc->getLocalPath());
+    CHECK(isSocket(path));
+
+    // Same handlers as TCP, plus who is on the other end
+    loopback::Reply reply(loopback::request<local_protocol>(local_protocol::endpoint(path), "GET", "/"));
+    CHECK_EQUAL(200, reply.code);
+    CHECK_EQUAL(std::string("hello"), reply.body);
+    CHECK(handler->peer.valid);
+    CHECK_EQUAL(static_cast<long>(::getpid()), handler->peer.pid);
+    CHECK_EQUAL(static_cast<unsigned long>(::getuid()), handler->peer.uid);
+
+    svc->terminate();
+    CHECK(!isSocket(path));
+
+    // Abstract names never touch the filesystem
+    svc = HTTP::HTTPService::createLocal("@" + path);
+    svc->registerHandler(handler);
+    CHECK(!isSocket(path));
+    std::string abstractName(path);
+    abstractName.insert(abstractName.begin(), '\0');
+    CHECK_EQUAL(200, loopback::request<local_protocol>(local_protocol::endpoint(abstractName), "GET", "/").code);
+    svc->terminate();
+}
+
+TEST(BasicService_LocalSocketReplacesOnlyStaleSockets)
+{
+    PRINT_TESTNAME;
+
+    const std::string path(localSocketPath("stale"));
+    boost::shared_ptr<loopback::FixedHandler> handler(boost::make_shared<loopback::FixedHandler>());
+
+    // A socket file left behind by a process that went away is replaced
+    {
+        boost::asio::io_service io;
+        local_protocol::acceptor abandoned(io, local_protocol::endpoint(path));
+    }
+    CHECK(isSocket(path));
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::createLocal(path));
+    svc->registerHandler(handler);
+    CHECK_EQUAL(200, loopback::request<local_protocol>(local_protocol::endpoint(path), "GET", "/").code);
+
+    // but not one somebody is still listening on
+    CHECK(createLocalFails(path));
+    CHECK_EQUAL(200, loopback::request<local_protocol>(local_protocol::endpoint(path), "GET", "/").code);
+
+    // If the socket file has been replaced by something else since, terminate leaves that alone
+    ::unlink(path.c_str());
+    std::ofstream(path.c_str()) << "not ours";
+    svc->terminate();
+    CHECK_EQUAL(std::string("not ours"), readFile(path));
+
+    // and so does creating a service on it
+    CHECK(createLocalFails(path));
+    CHECK_EQUAL(std::string("not ours"), readFile(path));
+    ::unlink(path.c_str());
+}
+
+TEST(BasicService_LocalSocketLatency)
+{
+    PRINT_TESTNAME;
+
+    // Not a pass/fail comparison, since loopback timings vary too much between machines; it prints
+    // the per-request cost of each transport, connection setup included
+    const int requests = 500;
+    boost::shared_ptr<loopback::FixedHandler> handler(boost::make_shared<loopback::FixedHandler>());
+    boost::shared_ptr<HTTP::HTTPService> tcpSvc(HTTP::HTTPService::create("127.0.0.1", 0));
+    tcpSvc->registerHandler(handler);
+    const std::string path(localSocketPath("latency"));
+    boost::shared_ptr<HTTP::HTTPService> localSvc(HTTP::HTTPService::createLocal(path));
+    localSvc->registerHandler(handler);
+
+    boost::asio::ip::tcp::endpoint tcpEndpoint(loopback::endpoint(tcpSvc->getBaseUri()));
+    local_protocol::endpoint localEndpoint(path);
+    std::vector<double> tcpTimes, localTimes;
+    int failures = 0;
+    for (int i = 0; i < requests; ++i) {
+        boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+        if (loopback::request<boost::asio::ip::tcp>(tcpEndpoint, "GET", "/").code != 200) ++failures;
+        tcpTimes.push_back(loopback::millisSince(start));
+
+        start = boost::posix_time::microsec_clock::universal_time();
+        if (loopback::request<local_protocol>(localEndpoint, "GET", "/").code != 200) ++failures;
+        localTimes.push_back(loopback::millisSince(start));
+    }
+    CHECK_EQUAL(0, failures);
+    CHECK_EQUAL(2 * requests, handler->requests);
+    printf("    %d requests each: TCP median %.3f ms, p99 %.3f ms; UDS median %.3f ms, p99 %.3f ms\n",
+        requests, loopback::percentile(tcpTimes, 0.5), loopback::percentile(tcpTimes, 0.99),
+        loopback::percentile(localTimes, 0.5), loopback::percentile(localTimes, 0.99));
+
+    tcpSvc->terminate();
+    localSvc->terminate();
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
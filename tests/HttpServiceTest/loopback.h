@@ -0,0 +1,127 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_HTTPSERVICETEST_LOOPBACK
+#define H_HTTPSERVICETEST_LOOPBACK
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "URI.h"
+#include "HTTPService/HTTPHandler.h"
+
+// Plain socket clients for talking to a service on this machine, so the tests don't depend on
+// HTTPRequest (and curl) unless that's what they are testing
+namespace loopback {
+
+    struct Reply {
+        Reply() : code(0) { }
+        int code; // 0 if the connection closed before a status line arrived
+        std::string headers;
+        std::string body;
+
+        std::string header(const std::string& name) const {
+            std::string::size_type pos = headers.find("\r\n" + name + ": ");
+            if (pos == std::string::npos) return std::string();
+            pos += name.size() + 4;
+            return headers.substr(pos, headers.find("\r\n", pos) - pos);
+        }
+    };
+
+    inline Reply parse(const std::string& raw) {
+        Reply reply;
+        std::string::size_type end = raw.find("\r\n\r\n");
+        if (raw.compare(0, 9, "HTTP/1.1 ") != 0 || end == std::string::npos)
+            return reply;
+        reply.code = atoi(raw.c_str() + 9);
+        reply.headers = raw.substr(0, end + 2);
+        reply.body = raw.substr(end + 4);
+        return reply;
+    }
+
+    // Sends one request on a new connection and reads the reply until the service closes it, which
+    // BasicService does after every response
+    template <class Protocol>
+    Reply request(const typename Protocol::endpoint& ep, const std::string& method, const std::string& target,
+        const std::string& body = std::string(), const std::string& headers = std::string())
+    {
+        boost::asio::io_service io;
+        typename Protocol::socket sock(io);
+        sock.connect(ep);
+
+        std::string req = method + " " + target + " HTTP/1.1\r\nHost: localhost\r\n" + headers;
+        if (!body.empty() || method == "POST")
+            req += "Content-Length: " + boost::lexical_cast<std::string>(body.size()) + "\r\n";
+        req += "\r\n" + body;
+        boost::asio::write(sock, boost::asio::buffer(req));
+
+        std::string raw;
+        char buf[4096];
+        boost::system::error_code ec;
+        while (!ec) {
+            size_t len = sock.read_some(boost::asio::buffer(buf), ec);
+            raw.append(buf, len);
+        }
+        return parse(raw);
+    }
+
+    inline boost::asio::ip::tcp::endpoint endpoint(const FB::URI& base) {
+        return boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), base.port);
+    }
+
+    inline Reply get(const FB::URI& base, const std::string& target, const std::string& headers = std::string()) {
+        return request<boost::asio::ip::tcp>(endpoint(base), "GET", target, std::string(), headers);
+    }
+
+    // Answers every request with code and body, and remembers the last request's peer
+    class FixedHandler : public HTTP::HTTPHandler {
+    public:
+        FixedHandler(const std::string& body = "hello", int code = 200) : body(body), code(code), requests(0) { }
+
+        bool requiresVerifiedURI() const { return false; }
+        HTTP::HTTPResponseData* handleRequest(const HTTP::HTTPRequestData& req) {
+            boost::mutex::scoped_lock _l(mutex);
+            ++requests;
+            peer = req.peer;
+            HTTP::HTTPResponseData* resp = new HTTP::HTTPResponseData;
+            resp->code = code;
+            resp->addDatablock(new HTTP::HTTPStringDatablock(body));
+            return resp;
+        }
+
+        const std::string body;
+        const int code;
+        boost::mutex mutex;
+        int requests;
+        HTTP::PeerCredentials peer;
+    };
+
+    inline double millisSince(const boost::posix_time::ptime& start) {
+        return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000.0;
+    }
+
+    // The p'th fraction of samples, e.g. 0.5 for the median
+    inline double percentile(std::vector<double> samples, double p) {
+        if (samples.empty()) return 0;
+        std::sort(samples.begin(), samples.end());
+        return samples[(std::min)(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+    }
+}
+
+#endif // H_HTTPSERVICETEST_LOOPBACK
@@ -0,0 +1,164 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include "HTTPService.h"
+#include "HTTPService/MetricsRegistry.h"
+#include "HTTPCommon/HTTPException.h"
+#include "loopback.h"
+
+namespace {
+    // Answers only requests for its own path; throws a 403 for "/forbidden"
+    class PathHandler : public HTTP::HTTPHandler {
+    public:
+        PathHandler(const std::string& name, const std::string& path) : name(name), path(path) { }
+
+        bool requiresVerifiedURI() const { return false; }
+        std::string getMetricsName() const { return name; }
+        HTTP::HTTPResponseData* handleRequest(const HTTP::HTTPRequestData& req) {
+            if (req.uri.path == "/forbidden" && path == req.uri.path)
+                throw HTTP::HTTPException(403, "Forbidden");
+            if (req.uri.path != path)
+                return NULL;
+            HTTP::HTTPResponseData* resp = new HTTP::HTTPResponseData;
+            resp->code = 200;
+            resp->addDatablock(new HTTP::HTTPStringDatablock(name));
+            return resp;
+        }
+
+        const std::string name;
+        const std::string path;
+    };
+
+    double handlerValue(HTTP::HTTPService& svc, const std::string& metric, const std::string& handler) {
+        return svc.getMetrics().getValue(metric, "handler=\"" + handler + "\"");
+    }
+
+    double responses(HTTP::HTTPService& svc, int code) {
+        return svc.getMetrics().getValue("http_responses_total", "code=\"" + boost::lexical_cast<std::string>(code) + "\"");
+    }
+
+    // Sessions are counted out after the client has seen the connection close, so give them a moment
+    bool sessionsSettle(HTTP::HTTPService& svc) {
+        const char* states[] = { "reading", "handling", "writing" };
+        for (int tries = 0; tries < 100; ++tries) {
+            double open = 0;
+            for (int i = 0; i < 3; ++i)
+                open += svc.getMetrics().getValue("http_sessions", std::string("state=\"") + states[i] + "\"");
+            if (open == 0)
+                return true;
+            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        }
+        return false;
+    }
+}
+
+TEST(BasicService_Metrics)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    boost::shared_ptr<PathHandler> a(boost::make_shared<PathHandler>("a", "/a"));
+    boost::shared_ptr<PathHandler> b(boost::make_shared<PathHandler>("b", "/b"));
+    boost::shared_ptr<PathHandler> thrower(boost::make_shared<PathHandler>("thrower", "/forbidden"));
+    svc->registerHandler(a);
+    svc->registerHandler(b);
+    svc->registerHandler(thrower);
+    const FB::URI base(svc->getBaseUri());
+
+    // Handlers are offered a request in turn until one answers it
+    const char* paths[] = { "/a", "/b", "/a", "/forbidden", "/b", "/nothing", "/a" };
+    const int expected[] = { 200, 200, 200, 403, 200, 500, 200 };
+    for (int i = 0; i < 7; ++i)
+        CHECK_EQUAL(expected[i], loopback::get(base, paths[i]).code);
+
+    CHECK_EQUAL(7, handlerValue(*svc, "http_handler_requests_total", "a"));
+    CHECK_EQUAL(3, handlerValue(*svc, "http_handler_responses_total", "a"));
+    CHECK_EQUAL(7, handlerValue(*svc, "http_handler_duration_seconds", "a"));
+    CHECK_EQUAL(4, handlerValue(*svc, "http_handler_requests_total", "b"));
+    CHECK_EQUAL(2, handlerValue(*svc, "http_handler_responses_total", "b"));
+    CHECK_EQUAL(2, handlerValue(*svc, "http_handler_requests_total", "thrower"));
+    CHECK_EQUAL(0, handlerValue(*svc, "http_handler_responses_total", "thrower"));
+    CHECK_EQUAL(1, handlerValue(*svc, "http_handler_errors_total", "thrower"));
+    CHECK_EQUAL(5, responses(*svc, 200));
+    CHECK_EQUAL(1, responses(*svc, 403));
+    CHECK_EQUAL(1, responses(*svc, 500));
+    CHECK_EQUAL(7, svc->getMetrics().getValue("http_sessions_total"));
+    CHECK(svc->getMetrics().getValue("http_response_bytes_total") > 0);
+    CHECK(sessionsSettle(*svc));
+
+    // A handler set again, or replaced by one with the same name, keeps its counters
+    HTTP::HTTPService::HandlerList handlers;
+    handlers.push_back(boost::make_shared<PathHandler>("a", "/a"));
+    handlers.push_back(b);
+    svc->setHandlers(handlers);
+    CHECK_EQUAL(200, loopback::get(base, "/b").code);
+    CHECK_EQUAL(8, handlerValue(*svc, "http_handler_requests_total", "a"));
+    CHECK_EQUAL(3, handlerValue(*svc, "http_handler_responses_total", "b"));
+    svc->deregisterHandler(b);
+    CHECK_EQUAL(500, loopback::get(base, "/b").code);
+    CHECK_EQUAL(5, handlerValue(*svc, "http_handler_requests_total", "b"));
+
+    // The same numbers in Prometheus form; the scrape itself is counted once it has been answered
+    svc->setMetricsPath("/metrics");
+    loopback::Reply reply(loopback::get(base, "/metrics"));
+    CHECK_EQUAL(200, reply.code);
+    CHECK(reply.header("Content-Type").find("text/plain") == 0);
+    CHECK(reply.body.find("# TYPE http_responses_total counter\n") != std::string::npos);
+    CHECK(reply.body.find("http_responses_total{code=\"200\"} 6\n") != std::string::npos);
+    CHECK(reply.body.find("http_handler_requests_total{handler=\"a\"} 9\n") != std::string::npos);
+    CHECK(reply.body.find("http_handler_duration_seconds_count{handler=\"a\"} 9\n") != std::string::npos);
+    CHECK_EQUAL(7, responses(*svc, 200));
+
+    // Codes without a counter of their own yet still get counted
+    boost::shared_ptr<loopback::FixedHandler> teapot(boost::make_shared<loopback::FixedHandler>("teapot", 418));
+    svc->setHandlers(HTTP::HTTPService::HandlerList(1, teapot));
+    CHECK_EQUAL(418, loopback::get(base, "/").code);
+    CHECK_EQUAL(1, responses(*svc, 418));
+
+    svc->terminate();
+}
+
+namespace {
+    void hammerMetrics(HTTP::CounterPtr counter, HTTP::GaugePtr gauge, int times) {
+        for (int i = 0; i < times; ++i) {
+            counter->inc();
+            gauge->add(1);
+            gauge->add(-1);
+        }
+    }
+}
+
+TEST(MetricsRegistry_ConcurrentUpdates)
+{
+    PRINT_TESTNAME;
+    HTTP::MetricsRegistry metrics;
+    HTTP::CounterPtr counter(metrics.counter("updates_total", "Updates"));
+    HTTP::GaugePtr gauge(metrics.gauge("in_flight", "In flight"));
+
+    // Counters and gauges take no lock, but none of the updates racing on them is lost
+    const int threads = 4, times = 100000;
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    boost::thread_group group;
+    for (int t = 0; t < threads; ++t)
+        group.create_thread(boost::bind(&hammerMetrics, counter, gauge, times));
+    group.join_all();
+    printf("    %d updates from %d threads, %.1f ns each\n", 3 * threads * times, threads,
+        loopback::millisSince(start) * 1e6 / (3.0 * threads * times));
+    CHECK_EQUAL(threads * times, counter->value());
+    CHECK_EQUAL(0, gauge->value());
+    CHECK_EQUAL(threads * times, metrics.getValue("updates_total"));
+}
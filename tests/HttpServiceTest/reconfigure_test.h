@@ -0,0 +1,170 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "HTTPService.h"
+#include "loopback.h"
+
+namespace {
+    // Answers with its body, after a pause for requests to /slow
+    class ReconfigureHandler : public HTTP::HTTPHandler {
+    public:
+        ReconfigureHandler(const std::string& body) : body(body) { }
+
+        bool requiresVerifiedURI() const { return false; }
+        HTTP::HTTPResponseData* handleRequest(const HTTP::HTTPRequestData& req) {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(req.uri.path == "/slow" ? 300 : 2));
+            HTTP::HTTPResponseData* resp = new HTTP::HTTPResponseData;
+            resp->code = 200;
+            resp->addDatablock(new HTTP::HTTPStringDatablock(body));
+            return resp;
+        }
+
+        const std::string body;
+    };
+
+    // What the clients saw while the service was being reconfigured under them
+    struct ReconfigureTraffic {
+        ReconfigureTraffic() : stop(false), ok(0), failed(0), sawA(false), sawB(false) { }
+
+        boost::mutex mutex;
+        bool stop;
+        int ok;
+        int failed;
+        bool sawA;
+        bool sawB;
+        std::string firstFailure;
+    };
+
+    // Sends requests to wherever the service says it is, one after another, until told to stop
+    void reconfigureClient(boost::shared_ptr<HTTP::HTTPService> svc, ReconfigureTraffic* traffic) {
+        for (;;) {
+            {
+                boost::mutex::scoped_lock _l(traffic->mutex);
+                if (traffic->stop) return;
+            }
+            const FB::URI base(svc->getBaseUri());
+            loopback::Reply reply;
+            std::string error;
+            try {
+                reply = loopback::get(base, "/x");
+            } catch (const boost::system::system_error& e) {
+                // A port retired since we looked it up takes nothing new; that connection was never
+                // a request, so look again, as a page told the new address would
+                if (e.code() == boost::asio::error::connection_refused && svc->getBaseUri().port != base.port)
+                    continue;
+                error = e.what();
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            boost::mutex::scoped_lock _l(traffic->mutex);
+            if (reply.code == 200 && (reply.body == "A" || reply.body == "B")) {
+                ++traffic->ok;
+                traffic->sawA = traffic->sawA || reply.body == "A";
+                traffic->sawB = traffic->sawB || reply.body == "B";
+            } else {
+                ++traffic->failed;
+                if (traffic->firstFailure.empty()) {
+                    traffic->firstFailure = "port " + boost::lexical_cast<std::string>(base.port) + ": "
+                        + (error.empty() ? "status " + boost::lexical_cast<std::string>(reply.code) : error);
+                }
+            }
+        }
+    }
+
+    void slowRequest(FB::URI base, loopback::Reply* reply) {
+        try {
+            *reply = loopback::get(base, "/slow");
+        } catch (const std::exception&) {
+            // Leaves the code at 0
+        }
+    }
+
+    // Whether port is closed within a second. The listener is closed on its strand as soon as a
+    // pool thread is free, and with one thread that waits for the slow request's handler.
+    bool refusesConnections(int port) {
+        boost::asio::io_service io;
+        for (int i = 0; i < 200; ++i) {
+            boost::asio::ip::tcp::socket sock(io);
+            boost::system::error_code ec;
+            sock.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port), ec);
+            if (ec == boost::asio::error::connection_refused)
+                return true;
+            boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+        }
+        return false;
+    }
+}
+
+TEST(BasicService_ReconfigureUnderLoad)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    svc->registerHandler(boost::shared_ptr<HTTP::HTTPHandler>(new ReconfigureHandler("A")));
+    // The pool is shared with every other test
+    const size_t threads(svc->getThreadCount());
+
+    ReconfigureTraffic traffic;
+    boost::thread_group clients;
+    for (int i = 0; i < 8; ++i)
+        clients.create_thread(boost::bind(&reconfigureClient, svc, &traffic));
+
+    // Everything that can change does, every round, with the clients never pausing
+    for (int round = 0; round < 6; ++round) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        HTTP::HTTPService::HandlerList handlers;
+        handlers.push_back(boost::shared_ptr<HTTP::HTTPHandler>(new ReconfigureHandler(round % 2 ? "A" : "B")));
+        svc->setHandlers(handlers);
+
+        const int oldPort(svc->getBaseUri().port);
+        loopback::Reply slow;
+        boost::thread slowClient(boost::bind(&slowRequest, svc->getBaseUri(), &slow));
+        boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+        const int newPort(svc->addListener("127.0.0.1", 0));
+        CHECK(newPort != oldPort);
+        svc->removeListener(oldPort, 2000);
+        CHECK_EQUAL(newPort, svc->getBaseUri().port);
+
+        // The retired port takes nothing new, but a request it was already serving finishes
+        CHECK(refusesConnections(oldPort));
+        slowClient.join();
+        CHECK_EQUAL(200, slow.code);
+
+        svc->setThreadCount(round % 2 ? 1 : 5);
+        svc->setMaxRequestBody(1024 * (round + 1));
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    {
+        boost::mutex::scoped_lock _l(traffic.mutex);
+        traffic.stop = true;
+    }
+    clients.join_all();
+
+    CHECK_EQUAL(0, traffic.failed);
+    CHECK_EQUAL("", traffic.firstFailure);
+    CHECK(traffic.ok > 0);
+    CHECK(traffic.sawA && traffic.sawB);
+
+    // With the last listener gone there is nowhere to send pages
+    const int lastPort(svc->getBaseUri().port);
+    svc->removeListener(lastPort, 0);
+    CHECK_EQUAL(0, svc->getBaseUri().port);
+    CHECK(svc->getBaseUri().domain.empty());
+
+    svc->setThreadCount(threads);
+    svc->terminate();
+}
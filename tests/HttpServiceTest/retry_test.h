@@ -0,0 +1,242 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <deque>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include "HTTPService.h"
+#include "HTTPClient/HTTPRequest.h"
+#include "HTTPClient/CircuitBreaker.h"
+#include "loopback.h"
+
+namespace {
+    // Answers with the next scripted status code, or 200 once the script runs out. A code given as
+    // "503 7" also sends Retry-After: 7.
+    class ScriptedHandler : public HTTP::HTTPHandler {
+    public:
+        ScriptedHandler() : requests(0) { }
+
+        bool requiresVerifiedURI() const { return false; }
+        HTTP::HTTPResponseData* handleRequest(const HTTP::HTTPRequestData& req) {
+            boost::mutex::scoped_lock _l(mutex);
+            ++requests;
+            std::string step("200");
+            if (!script.empty()) {
+                step = script.front();
+                script.pop_front();
+            }
+            HTTP::HTTPResponseData* resp = new HTTP::HTTPResponseData;
+            resp->code = atoi(step.c_str());
+            if (step.find(' ') != std::string::npos)
+                resp->headers.insert(std::make_pair("Retry-After", step.substr(step.find(' ') + 1)));
+            resp->addDatablock(new HTTP::HTTPStringDatablock(step));
+            return resp;
+        }
+
+        void play(const char* steps) {
+            boost::mutex::scoped_lock _l(mutex);
+            std::string s(steps);
+            for (std::string::size_type pos = 0; pos < s.size(); ) {
+                std::string::size_type end = s.find(',', pos);
+                if (end == std::string::npos) end = s.size();
+                script.push_back(s.substr(pos, end - pos));
+                pos = end + 1;
+            }
+        }
+        int getRequests() {
+            boost::mutex::scoped_lock _l(mutex);
+            return requests;
+        }
+
+    private:
+        boost::mutex mutex;
+        std::deque<std::string> script;
+        int requests;
+    };
+
+    // Fails the attempt from inside HTTPRequest, before anything is sent
+    class ThrowingDatablock : public HTTP::HTTPDatablock {
+    public:
+        size_t size() const { return 1; }
+        const char* data() const { throw std::runtime_error("upload source went away"); }
+    };
+
+    struct StatusLog {
+        boost::mutex mutex;
+        std::vector<HTTP::Status> statuses;
+        void add(HTTP::Status st) {
+            boost::mutex::scoped_lock _l(mutex);
+            statuses.push_back(st);
+        }
+        // Attempt numbers of the WAITING_TO_RETRY reports
+        std::vector<unsigned int> retries() {
+            boost::mutex::scoped_lock _l(mutex);
+            std::vector<unsigned int> res;
+            for (size_t i = 0; i < statuses.size(); ++i)
+                if (statuses[i].state == HTTP::Status::WAITING_TO_RETRY) res.push_back(statuses[i].attempt);
+            return res;
+        }
+    };
+
+    HTTP::RetryPolicy quickRetries(unsigned int attempts) {
+        HTTP::RetryPolicy policy;
+        policy.max_attempts = attempts;
+        policy.initial_backoff = 0.01;
+        policy.jitter = 0;
+        return policy;
+    }
+
+    // Runs one request to completion and returns its final status
+    HTTP::Status fetch(const FB::URI& uri, const HTTP::RetryPolicy& policy, const std::string& method = "GET",
+        StatusLog* log = NULL, HTTP::HTTPDatablock* upload = NULL)
+    {
+        boost::shared_ptr<HTTP::HTTPRequestData> data(boost::make_shared<HTTP::HTTPRequestData>(uri, method));
+        if (upload) data->addFile("file", "file.bin", "application/octet-stream", upload);
+        HTTP::HTTPRequest* req = HTTP::HTTPRequest::create();
+        req->setRetryPolicy(policy);
+        if (log) req->onStatusChanged(boost::bind(&StatusLog::add, log, _1));
+        req->startRequest(data);
+        req->awaitCompletion();
+        HTTP::Status st(req->getStatus());
+        delete req;
+        return st;
+    }
+
+    // Puts the breakers back the way other tests expect them
+    struct BreakerDefaults {
+        BreakerDefaults(unsigned int threshold, double open_duration) {
+            HTTP::CircuitBreaker::resetAll();
+            HTTP::CircuitBreaker::setDefaults(threshold, open_duration);
+        }
+        ~BreakerDefaults() {
+            HTTP::CircuitBreaker::resetAll();
+            HTTP::CircuitBreaker::setDefaults(5, 30);
+        }
+    };
+}
+
+TEST(HTTPRequest_Retries)
+{
+    PRINT_TESTNAME;
+
+    BreakerDefaults breakers(100, 30);
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    boost::shared_ptr<ScriptedHandler> handler(boost::make_shared<ScriptedHandler>());
+    svc->registerHandler(handler);
+    const FB::URI uri(svc->getBaseUri());
+
+    // Transient failures are retried, reporting each attempt
+    handler->play("503,502");
+    StatusLog log;
+    HTTP::Status st(fetch(uri, quickRetries(3), "GET", &log));
+    CHECK_EQUAL(HTTP::Status::COMPLETE, st.state);
+    CHECK_EQUAL(3u, st.attempt);
+    CHECK_EQUAL(3u, st.max_attempts);
+    CHECK_EQUAL(3, handler->getRequests());
+    std::vector<unsigned int> retries(log.retries());
+    CHECK_EQUAL(2u, retries.size());
+    CHECK(retries.size() == 2 && retries[0] == 1 && retries[1] == 2);
+
+    // until the attempts run out
+    handler->play("503,503");
+    st = fetch(uri, quickRetries(2));
+    CHECK_EQUAL(HTTP::Status::HTTP_ERROR, st.state);
+    CHECK_EQUAL(2u, st.attempt);
+    CHECK(st.retryable);
+    CHECK_EQUAL(5, handler->getRequests());
+
+    // Retry-After is honored, up to max_backoff
+    handler->play("429 100");
+    HTTP::RetryPolicy capped(quickRetries(2));
+    capped.max_backoff = 0.05;
+    StatusLog cappedLog;
+    CHECK_EQUAL(HTTP::Status::COMPLETE, fetch(uri, capped, "GET", &cappedLog).state);
+    for (size_t i = 0; i < cappedLog.statuses.size(); ++i)
+        if (cappedLog.statuses[i].state == HTTP::Status::WAITING_TO_RETRY)
+            CHECK_CLOSE(0.05, cappedLog.statuses[i].retry_delay, 0.0001);
+
+    // A POST the server may have processed isn't sent again unless the policy says so
+    const int before = handler->getRequests();
+    handler->play("503");
+    st = fetch(uri, quickRetries(3), "POST");
+    CHECK_EQUAL(HTTP::Status::HTTP_ERROR, st.state);
+    CHECK(st.retryable);
+    CHECK_EQUAL(before + 1, handler->getRequests());
+    HTTP::RetryPolicy anyMethod(quickRetries(3));
+    anyMethod.retry_non_idempotent = true;
+    handler->play("503");
+    CHECK_EQUAL(HTTP::Status::COMPLETE, fetch(uri, anyMethod, "POST").state);
+    CHECK_EQUAL(before + 3, handler->getRequests());
+
+    // and nothing is retried after a permanent failure
+    handler->play("404");
+    st = fetch(uri, quickRetries(3));
+    CHECK_EQUAL(HTTP::Status::HTTP_ERROR, st.state);
+    CHECK_EQUAL(1u, st.attempt);
+    CHECK(!st.retryable);
+    CHECK_EQUAL(before + 4, handler->getRequests());
+
+    svc->terminate();
+}
+
+TEST(HTTPRequest_CircuitBreaker)
+{
+    PRINT_TESTNAME;
+
+    BreakerDefaults breakers(2, 0.2);
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    boost::shared_ptr<ScriptedHandler> handler(boost::make_shared<ScriptedHandler>());
+    svc->registerHandler(handler);
+    const FB::URI uri(svc->getBaseUri());
+    HTTP::CircuitBreakerPtr breaker(HTTP::CircuitBreaker::forHost(uri));
+
+    // A permanent error means the host is up and answering
+    handler->play("404,404,404");
+    for (int i = 0; i < 3; ++i)
+        fetch(uri, quickRetries(1));
+    CHECK_EQUAL(HTTP::CircuitBreaker::CLOSED, breaker->getState());
+
+    // Failures in a row open the circuit, after which requests fail without being sent
+    handler->play("503,503");
+    fetch(uri, quickRetries(1));
+    fetch(uri, quickRetries(1));
+    CHECK_EQUAL(HTTP::CircuitBreaker::OPEN, breaker->getState());
+    HTTP::Status st(fetch(uri, quickRetries(1)));
+    CHECK_EQUAL(HTTP::Status::HTTP_ERROR, st.state);
+    CHECK(st.retryable);
+    CHECK(st.last_error.find("Too many recent failures") == 0);
+    CHECK_EQUAL(5, handler->getRequests());
+
+    // Once the circuit has been open a while, one trial request goes through and closes it
+    boost::this_thread::sleep(boost::posix_time::milliseconds(250));
+    CHECK_EQUAL(HTTP::Status::COMPLETE, fetch(uri, quickRetries(1)).state);
+    CHECK_EQUAL(HTTP::CircuitBreaker::CLOSED, breaker->getState());
+    CHECK_EQUAL(6, handler->getRequests());
+
+    // An attempt that throws inside HTTPRequest never heard from the host, so it can't count as
+    // healthy; nor is it retried
+    for (int i = 0; i < 2; ++i) {
+        st = fetch(uri, quickRetries(3), "POST", NULL, new ThrowingDatablock);
+        CHECK_EQUAL(HTTP::Status::HTTP_ERROR, st.state);
+        CHECK_EQUAL(1u, st.attempt);
+        CHECK(!st.retryable);
+        CHECK_EQUAL(std::string("upload source went away"), st.last_error);
+    }
+    CHECK_EQUAL(HTTP::CircuitBreaker::OPEN, breaker->getState());
+    CHECK_EQUAL(6, handler->getRequests());
+
+    svc->terminate();
+}
@@ -0,0 +1,175 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#if defined(__linux__)
+#include <dirent.h>
+#endif
+#include "Reactor.h"
+#include "Timer.h"
+#include "HTTPService.h"
+#include "HTTPClient/HTTPRequest.h"
+#include "loopback.h"
+
+namespace {
+    // Threads in this process, or 0 where that can't be told
+    int sharedReactorThreads() {
+#if defined(__linux__)
+        int count = 0;
+        DIR* dir = opendir("/proc/self/task");
+        if (!dir) return 0;
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') ++count;
+        }
+        closedir(dir);
+        return count;
+#else
+        return 0;
+#endif
+    }
+
+    // Timers, server sessions and client requests all running at once, and what they saw
+    struct SharedReactorLoad {
+        SharedReactorLoad() : stopping(false), inFlight(0), failures(0), peakThreads(0) { }
+
+        void notePeak() {
+            const int threads(sharedReactorThreads());
+            boost::mutex::scoped_lock _l(mutex);
+            if (threads > peakThreads) peakThreads = threads;
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable idle;
+        FB::URI target;
+        bool stopping;
+        int inFlight;
+        int failures;
+        int peakThreads;
+        std::vector<double> timerLateness;
+        std::vector<double> requestLatency;
+    };
+
+    // A repeating timer noting how late each tick comes
+    struct SharedReactorTick {
+        SharedReactorTick(SharedReactorLoad* load, long period)
+            : load(load), period(period),
+              next(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(period)) { }
+
+        void fire() {
+            const boost::posix_time::ptime now(boost::posix_time::microsec_clock::universal_time());
+            {
+                boost::mutex::scoped_lock _l(load->mutex);
+                load->timerLateness.push_back((now - next).total_microseconds() / 1000.0);
+            }
+            next = now + boost::posix_time::milliseconds(period);
+            load->notePeak();
+        }
+
+        SharedReactorLoad* load;
+        const long period;
+        boost::posix_time::ptime next;
+    };
+
+    void startSharedReactorRequest(SharedReactorLoad* load);
+
+    // Each client sends its next request as soon as the last one is done, from the callback
+    void sharedReactorStatus(SharedReactorLoad* load, HTTP::HTTPRequest* req, boost::posix_time::ptime start,
+        HTTP::Status st) {
+        if (st.state != HTTP::Status::COMPLETE && st.state != HTTP::Status::HTTP_ERROR
+            && st.state != HTTP::Status::CANCELLED) return;
+        const bool ok(st.state == HTTP::Status::COMPLETE && req->getResponse()->code == 200);
+        load->notePeak();
+        req->threadSafeDestroy();
+        bool again = false;
+        {
+            boost::mutex::scoped_lock _l(load->mutex);
+            if (!ok) ++load->failures;
+            load->requestLatency.push_back(loopback::millisSince(start));
+            again = !load->stopping;
+            if (!again && --load->inFlight == 0) load->idle.notify_all();
+        }
+        if (again) startSharedReactorRequest(load);
+    }
+
+    void startSharedReactorRequest(SharedReactorLoad* load) {
+        HTTP::HTTPRequest* req = HTTP::HTTPRequest::create();
+        req->onStatusChanged(boost::bind(&sharedReactorStatus, load, req,
+            boost::posix_time::microsec_clock::universal_time(), _1));
+        req->startRequest(boost::make_shared<HTTP::HTTPRequestData>(load->target, "GET"));
+    }
+}
+
+TEST(Reactor_TimersServerAndClientTogether)
+{
+    PRINT_TESTNAME;
+
+    // The reactor's pools are all the threads the three of them should need
+    FB::ReactorPtr reactor(FB::Reactor::instance());
+    const int before(sharedReactorThreads());
+
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    svc->registerHandler(boost::make_shared<loopback::FixedHandler>());
+    SharedReactorLoad load;
+    load.target = svc->getBaseUri();
+    load.target.path = "/x";
+
+    std::vector<boost::shared_ptr<SharedReactorTick> > ticks;
+    std::vector<FB::TimerPtr> timers;
+    for (int i = 0; i < 50; ++i) {
+        ticks.push_back(boost::make_shared<SharedReactorTick>(&load, 10 + i % 5));
+        timers.push_back(FB::Timer::getTimer(ticks.back()->period, true,
+            boost::bind(&SharedReactorTick::fire, ticks.back().get())));
+        timers.back()->start();
+    }
+    const int clients = 16;
+    {
+        boost::mutex::scoped_lock _l(load.mutex);
+        load.inFlight = clients;
+    }
+    for (int i = 0; i < clients; ++i)
+        startSharedReactorRequest(&load);
+
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1500));
+    {
+        boost::mutex::scoped_lock _l(load.mutex);
+        load.stopping = true;
+        const boost::system_time until(boost::get_system_time() + boost::posix_time::seconds(10));
+        while (load.inFlight > 0 && load.idle.timed_wait(_l, until)) { }
+        CHECK_EQUAL(0, load.inFlight);
+    }
+    for (size_t i = 0; i < timers.size(); ++i)
+        timers[i]->stop();
+    timers.clear();
+    svc->terminate();
+
+    boost::mutex::scoped_lock _l(load.mutex);
+    CHECK_EQUAL(0, load.failures);
+    CHECK(load.requestLatency.size() > static_cast<size_t>(clients));
+    CHECK(load.timerLateness.size() > 500u);
+    const double timerP99(loopback::percentile(load.timerLateness, 0.99));
+    const double requestP99(loopback::percentile(load.requestLatency, 0.99));
+    printf("    %u ticks, p99 %.2f ms late; %u requests, p99 %.2f ms; threads %d before, %d at peak\n",
+        static_cast<unsigned>(load.timerLateness.size()), timerP99,
+        static_cast<unsigned>(load.requestLatency.size()), requestP99, before, load.peakThreads);
+    CHECK(timerP99 < 50);
+    CHECK(requestP99 < 500);
+    // Nothing starts threads of its own: no timer thread, no server pool, no thread per request
+    if (before) {
+        CHECK(load.peakThreads <= before);
+    }
+}
@@ -0,0 +1,223 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+// The uploader runs in a child process so it can be killed for real; the child is this same
+// executable, started again with --upload-worker (see main)
+#if defined(__linux__)
+
+#include <fstream>
+#include <set>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include "utf8_tools.h"
+#include "HTTPService.h"
+#include "HTTPClient/UploadQueue.h"
+#include "HTTPClient/UploadJournal.h"
+#include "loopback.h"
+
+namespace {
+    const int uploadFiles = 6;
+
+    std::string uploadName(int i) {
+        return "f" + boost::lexical_cast<std::string>(i);
+    }
+    // Unique enough to find in a multipart body
+    std::string uploadContent(const std::string& name) {
+        return "content-of-" + name + ";";
+    }
+
+    // Records which files each upload carried. The request with ordinal hold (counting from 1) is
+    // kept waiting until release(), so the uploader can be killed while it's in flight.
+    class BatchHandler : public HTTP::HTTPHandler {
+    public:
+        BatchHandler(int hold) : hold(hold), held(false), released(false) { }
+
+        bool requiresVerifiedURI() const { return false; }
+        HTTP::HTTPResponseData* handleRequest(const HTTP::HTTPRequestData& req) {
+            std::vector<std::string> files;
+            for (int i = 1; i <= uploadFiles; ++i)
+                if (req.body.find(uploadContent(uploadName(i))) != std::string::npos) files.push_back(uploadName(i));
+
+            boost::mutex::scoped_lock _l(mutex);
+            batches.push_back(files);
+            if (static_cast<int>(batches.size()) == hold) {
+                held = true;
+                cond.notify_all();
+                while (!released)
+                    cond.wait(_l);
+            }
+            HTTP::HTTPResponseData* resp = new HTTP::HTTPResponseData;
+            resp->code = 200;
+            std::string status;
+            for (size_t i = 0; i < files.size(); ++i)
+                status += "file" + boost::lexical_cast<std::string>(i) + ": ok\r\n";
+            resp->addDatablock(new HTTP::HTTPStringDatablock(status));
+            return resp;
+        }
+
+        bool waitForHeld(int ms) {
+            boost::mutex::scoped_lock _l(mutex);
+            const boost::system_time until(boost::get_system_time() + boost::posix_time::milliseconds(ms));
+            while (!held)
+                if (!cond.timed_wait(_l, until)) return held;
+            return true;
+        }
+        void release() {
+            boost::mutex::scoped_lock _l(mutex);
+            released = true;
+            cond.notify_all();
+        }
+        std::vector<std::vector<std::string> > getBatches() {
+            boost::mutex::scoped_lock _l(mutex);
+            return batches;
+        }
+
+    private:
+        const int hold;
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        bool held;
+        bool released;
+        std::vector<std::vector<std::string> > batches;
+    };
+
+    struct QueueDone {
+        QueueDone() : done(false) { }
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        bool done;
+
+        void finished(HTTP::UploadQueuePtr) {
+            boost::mutex::scoped_lock _l(mutex);
+            done = true;
+            cond.notify_all();
+        }
+        bool wait(int ms) {
+            boost::mutex::scoped_lock _l(mutex);
+            const boost::system_time until(boost::get_system_time() + boost::posix_time::milliseconds(ms));
+            while (!done)
+                if (!cond.timed_wait(_l, until)) return done;
+            return true;
+        }
+    };
+
+    // The contents were never on disk, so rebuild them from the journaled names
+    HTTP::HTTPDatablock* recreateUpload(const HTTP::UploadJournal::EntryState& es) {
+        return new HTTP::HTTPStringDatablock(uploadContent(FB::wstring_to_utf8(es.filename)));
+    }
+
+    bool fileExists(const std::string& path) {
+        return access(path.c_str(), F_OK) == 0;
+    }
+}
+
+// Queues the files for url, journaled at journalPath, and uploads until killed
+int runUploadWorker(const std::string& journalPath, const std::string& url)
+{
+    HTTP::UploadQueuePtr q(boost::make_shared<HTTP::UploadQueue>("killed-mid-batch"));
+    q->batch_size = 2;
+    q->enableJournal(journalPath);
+    for (int i = 1; i <= uploadFiles; ++i) {
+        HTTP::UploadQueueEntry qe;
+        qe.filename = FB::utf8_to_wstring(uploadName(i));
+        qe.source_path = L"/nonexistent/" + qe.filename;
+        qe.target = FB::URI::fromString(url);
+        qe.datablock = new HTTP::HTTPStringDatablock(uploadContent(uploadName(i)));
+        qe.filesize = static_cast<uint32_t>(qe.datablock->size());
+        q->addFile(qe);
+    }
+    q->dispatch();
+    for (;;)
+        boost::this_thread::sleep(boost::posix_time::seconds(1));
+    return 0;
+}
+
+TEST(UploadQueue_ResumesAfterKill)
+{
+    PRINT_TESTNAME;
+
+    const std::string journalPath("/tmp/fbhttptest-" + boost::lexical_cast<std::string>(getpid()) + ".journal");
+    unlink(journalPath.c_str());
+    boost::shared_ptr<HTTP::HTTPService> svc(HTTP::HTTPService::create("127.0.0.1", 0));
+    boost::shared_ptr<BatchHandler> handler(boost::make_shared<BatchHandler>(2));
+    svc->registerHandler(handler);
+    const std::string url(svc->getBaseUri().toString() + "upload");
+
+    pid_t child = fork();
+    if (child == 0) {
+        execl("/proc/self/exe", "HttpServiceTest", "--upload-worker", journalPath.c_str(), url.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    CHECK(child > 0);
+    if (child <= 0) {
+        svc->terminate();
+        return;
+    }
+
+    // Kill the uploader while its second batch is on the wire, once the journal writer has had
+    // a moment to record that the batch started
+    bool inFlight = handler->waitForHeld(10000);
+    CHECK(inFlight);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(300));
+    kill(child, SIGKILL);
+    int wstatus = 0;
+    waitpid(child, &wstatus, 0);
+    CHECK(WIFSIGNALED(wstatus));
+    handler->release();
+    if (!inFlight) {
+        svc->terminate();
+        return;
+    }
+    CHECK_EQUAL(2u, handler->getBatches().size());
+
+    // and as if the kill had landed in the middle of a record
+    {
+        std::ofstream torn(journalPath.c_str(), std::ios::app | std::ios::binary);
+        torn << "0badc0de\tcomplete\t3";
+    }
+
+    // The first batch was answered, so only the files from the second one on are left
+    HTTP::UploadQueuePtr q(HTTP::UploadQueue::recover(journalPath, &recreateUpload));
+    CHECK(q);
+    if (!q) {
+        svc->terminate();
+        return;
+    }
+    CHECK_EQUAL(4u, q->queue.size());
+    CHECK_EQUAL(4u, q->files_waiting);
+
+    QueueDone done;
+    q->queue_finished_callback = boost::bind(&QueueDone::finished, &done, _1);
+    q->dispatch();
+    CHECK(done.wait(10000));
+
+    // The batch cut off by the kill is sent again, which the journal warns about; nothing
+    // already acknowledged is
+    std::vector<std::vector<std::string> > batches(handler->getBatches());
+    std::multiset<std::string> resent;
+    for (size_t i = 2; i < batches.size(); ++i)
+        resent.insert(batches[i].begin(), batches[i].end());
+    CHECK_EQUAL(4u, resent.size());
+    for (int i = 1; i <= uploadFiles; ++i)
+        CHECK_EQUAL(i <= 2 ? 0u : 1u, resent.count(uploadName(i)));
+    CHECK(!fileExists(journalPath));
+
+    svc->terminate();
+}
+
+#endif
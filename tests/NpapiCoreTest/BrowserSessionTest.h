@@ -0,0 +1,167 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+#include "BrowserSession.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    void fetchSessionSnapshot(const FB::BrowserSessionPtr& session, const FB::URI& uri, FB::SessionSnapshotPtr* res)
+    {
+        *res = session->waitForSnapshot(uri, 5000);
+    }
+
+    void fetchSessionCredentials(const FB::BrowserSessionPtr& session, const FB::URI& uri, const std::string& realm,
+        bool* found, std::string* username, std::string* password)
+    {
+        *found = session->getCredentials(uri, "Basic", realm, *username, *password, 5000);
+    }
+
+    void recordSessionChange(std::vector<FB::SessionSnapshotPtr>* changes, const FB::SessionSnapshotPtr& snap)
+    {
+        changes->push_back(snap);
+    }
+
+    // Plays the browser's main thread until thread is done
+    void runMainThreadUntil(NpapiHost& testHost, boost::thread& thread)
+    {
+        while (!thread.timed_join(boost::posix_time::milliseconds(1)))
+            testHost.runAsyncCalls();
+    }
+}
+
+TEST(BrowserSession_Snapshots)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost moduleHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(moduleHost.getBrowserFuncs());
+
+    NpapiHost testHost(NULL, NULL, NULL);
+    testHost.setQueueAsyncCalls(true);
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    host->setPageOrigin("http://a.example.com");
+
+    testHost.setValueForURL(NPNURLVCookie, "http://a.example.com/", "sid=1; theme=dark");
+    testHost.setValueForURL(NPNURLVProxy, "http://a.example.com/", "PROXY proxy.example.com:3128");
+
+    FB::BrowserSessionPtr session(host->getBrowserSession());
+    std::vector<FB::SessionSnapshotPtr> changes;
+    session->setChangeHandler(boost::bind(&recordSessionChange, &changes, _1));
+    const FB::URI uri(FB::URI::fromString("http://a.example.com/app/data.json"));
+
+    // Nothing until the main thread gets round to it, and only one refresh is queued
+    CHECK(!session->getSnapshot(uri));
+    CHECK(!session->getSnapshot(uri));
+    CHECK_EQUAL(1u, testHost.getQueuedAsyncCallCount());
+    testHost.runAsyncCalls();
+
+    FB::SessionSnapshotPtr snap(session->getSnapshot(uri));
+    CHECK(snap);
+    CHECK_EQUAL("http://a.example.com", snap->origin);
+    CHECK_EQUAL("sid=1; theme=dark", snap->cookies);
+    CHECK(snap->hasProxy());
+    CHECK_EQUAL("proxy.example.com", snap->proxy.find("hostname")->second);
+    CHECK_EQUAL("3128", snap->proxy.find("port")->second);
+    CHECK_EQUAL(1u, snap->version);
+    CHECK_EQUAL(1u, changes.size());
+
+    // A fresh snapshot is handed out without asking the browser again
+    const size_t asked = testHost.getValueForURLCount();
+    CHECK(session->getSnapshot(FB::URI::fromString("http://a.example.com/other")) == snap);
+    CHECK_EQUAL(0u, testHost.getQueuedAsyncCallCount());
+    CHECK_EQUAL(asked, testHost.getValueForURLCount());
+
+    // Asking again when nothing has changed keeps the version
+    session->setMaxAge(0);
+    CHECK(session->getSnapshot(uri) == snap);
+    testHost.runAsyncCalls();
+    CHECK_EQUAL(1u, session->getSnapshot(uri)->version);
+    CHECK_EQUAL(1u, changes.size());
+
+    // ...and a new cookie is noticed
+    testHost.setValueForURL(NPNURLVCookie, "http://a.example.com/", "sid=2; theme=dark");
+    session->refresh(uri);
+    testHost.runAsyncCalls();
+    snap = session->getSnapshot(uri);
+    CHECK_EQUAL("sid=2; theme=dark", snap->cookies);
+    CHECK_EQUAL(2u, snap->version);
+    CHECK_EQUAL(2u, changes.size());
+    testHost.runAsyncCalls();
+
+    // Another origin has its own snapshot; a worker thread waits for it while the main thread runs
+    session->setMaxAge(30000);
+    FB::SessionSnapshotPtr other;
+    boost::thread worker(boost::bind(&fetchSessionSnapshot, session,
+        FB::URI::fromString("https://b.example.com:8443/"), &other));
+    runMainThreadUntil(testHost, worker);
+    CHECK(other);
+    CHECK_EQUAL("https://b.example.com:8443", other->origin);
+    CHECK(other->cookies.empty());
+    CHECK(!other->hasProxy());
+
+    host->shutdown();
+    testHost.runAsyncCalls();
+    CHECK(!session->getSnapshot(uri));
+    CHECK(!host->getBrowserSession());
+}
+
+TEST(BrowserSession_Credentials)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost moduleHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(moduleHost.getBrowserFuncs());
+
+    NpapiHost testHost(NULL, NULL, NULL);
+    testHost.setQueueAsyncCalls(true);
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    host->setPageOrigin("http://a.example.com");
+    testHost.setAuthenticationInfo("http", "intranet.example.com", 80, "basic", "Staff", "alice", "s3cret");
+
+    FB::BrowserSessionPtr session(host->getBrowserSession());
+    const FB::URI uri(FB::URI::fromString("http://intranet.example.com/reports"));
+
+    bool found = false;
+    std::string username, password;
+    boost::thread worker(boost::bind(&fetchSessionCredentials, session, uri, "Staff", &found, &username, &password));
+    runMainThreadUntil(testHost, worker);
+    CHECK(found);
+    CHECK_EQUAL("alice", username);
+    CHECK_EQUAL("s3cret", password);
+
+    // Once asked for, the realm is part of the snapshot
+    CHECK(session->getSnapshot(uri)->getCredentials("BASIC", "Staff", username, password));
+
+    // The browser has nothing for this realm
+    found = true;
+    boost::thread unknown(boost::bind(&fetchSessionCredentials, session, uri, "Admin", &found, &username, &password));
+    runMainThreadUntil(testHost, unknown);
+    CHECK(!found);
+
+    host->shutdown();
+    testHost.runAsyncCalls();
+}
@@ -0,0 +1,175 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <vector>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+#include "BrowserStreamRequest.h"
+#include "BrowserStreamScheduler.h"
+#include "DefaultBrowserStreamHandler.h"
+#include "PluginEvents/StreamEvents.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    FB::ScheduledStreamRequestPtr queueTestStream(const NpapiBrowserHostPtr& host, const std::string& url,
+        FB::StreamPriority priority = FB::STREAM_PRIORITY_NORMAL)
+    {
+        FB::BrowserStreamRequest req(url);
+        req.setEventSink(boost::make_shared<FB::DefaultBrowserStreamHandler>());
+        req.setPriority(priority);
+        return host->scheduleStream(req);
+    }
+
+    NPError NP_LOADDS refuseGetURLNotify(NPP npp, const char* url, const char* target, void* notifyData)
+    {
+        return NPERR_GENERIC_ERROR;
+    }
+
+    // Stands in for the browser finishing the request
+    void finishTestStream(const FB::ScheduledStreamRequestPtr& req)
+    {
+        FB::StreamCompletedEvent ev(req->getStream().get(), true);
+        req->getStream()->SendEvent(&ev);
+    }
+}
+
+TEST(BrowserStreamScheduler_Limits)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    // There's no page to read it from, and streams aren't opened for a page of unknown origin
+    host->setPageOrigin("http://a.example.com");
+    host->getStreamScheduler()->setLimits(3, 2);
+
+    std::vector<FB::ScheduledStreamRequestPtr> a, b;
+    for (int i = 0; i < 4; ++i) {
+        a.push_back(queueTestStream(host, "http://a.example.com/tile" + boost::lexical_cast<std::string>(i)));
+    }
+    for (int i = 0; i < 2; ++i) {
+        b.push_back(queueTestStream(host, "http://b.example.com/tile" + boost::lexical_cast<std::string>(i)));
+    }
+
+    // Two from a (per-origin cap) and one from b (global cap)
+    FB::BrowserStreamSchedulerPtr scheduler(host->getStreamScheduler());
+    CHECK(testHost.getURLRequests().size() == 3);
+    CHECK(scheduler->getActiveCount() == 3);
+    CHECK(scheduler->getActiveCount("http://a.example.com") == 2);
+    CHECK(scheduler->getQueuedCount() == 3);
+    CHECK(a[2]->getState() == FB::ScheduledStreamRequest::QUEUED);
+    CHECK(b[0]->getState() == FB::ScheduledStreamRequest::STARTED);
+
+    // Finishing a stream from a lets the next one from a start, not the remaining b
+    finishTestStream(a[0]);
+    CHECK(a[0]->getState() == FB::ScheduledStreamRequest::COMPLETED);
+    CHECK(testHost.getURLRequests().size() == 4);
+    CHECK(testHost.getURLRequests()[3].url == "http://a.example.com/tile2");
+    CHECK(scheduler->getActiveCount() == 3);
+
+    // A canceled request never reaches the browser
+    CHECK(a[3]->cancel());
+    CHECK(a[3]->getState() == FB::ScheduledStreamRequest::CANCELED);
+    finishTestStream(a[1]);
+    CHECK(testHost.getURLRequests().size() == 5);
+    CHECK(testHost.getURLRequests()[4].url == "http://b.example.com/tile1");
+    CHECK(!a[2]->cancel());
+
+    host->shutdown();
+}
+
+TEST(BrowserStreamScheduler_Priority)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    host->setPageOrigin("http://example.com");
+    host->getStreamScheduler()->setLimits(1, 1);
+
+    FB::ScheduledStreamRequestPtr first(queueTestStream(host, "http://example.com/first"));
+    FB::ScheduledStreamRequestPtr background(queueTestStream(host, "http://example.com/bg", FB::STREAM_PRIORITY_BACKGROUND));
+    FB::ScheduledStreamRequestPtr normal(queueTestStream(host, "http://example.com/normal"));
+    FB::ScheduledStreamRequestPtr interactive(queueTestStream(host, "http://example.com/now", FB::STREAM_PRIORITY_INTERACTIVE));
+    FB::ScheduledStreamRequestPtr late(queueTestStream(host, "http://example.com/late", FB::STREAM_PRIORITY_BACKGROUND));
+    CHECK(testHost.getURLRequests().size() == 1);
+
+    // Bump the last background request ahead of everything else
+    late->setPriority(FB::STREAM_PRIORITY_INTERACTIVE);
+
+    const char* expected[] = {
+        "http://example.com/first", "http://example.com/now", "http://example.com/late",
+        "http://example.com/normal", "http://example.com/bg"
+    };
+    FB::ScheduledStreamRequestPtr order[] = { first, interactive, late, normal, background };
+    for (int i = 0; i < 5; ++i) {
+        CHECK(testHost.getURLRequests().size() == size_t(i + 1));
+        CHECK(testHost.getURLRequests()[i].url == expected[i]);
+        finishTestStream(order[i]);
+    }
+    CHECK(host->getStreamScheduler()->getActiveCount() == 0);
+
+    host->shutdown();
+}
+
+TEST(BrowserStreamScheduler_Teardown)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+
+    {
+        // The stream is destroyed inside createStream when the browser refuses it
+        NPNetscapeFuncs refusing(*testHost.getBrowserFuncs());
+        refusing.geturlnotify = &refuseGetURLNotify;
+        NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+        host->setBrowserFuncs(&refusing);
+        host->setPageOrigin("http://example.com");
+        FB::ScheduledStreamRequestPtr refused(queueTestStream(host, "http://example.com/refused"));
+        CHECK(refused->getState() == FB::ScheduledStreamRequest::FAILED);
+        CHECK(host->getStreamScheduler()->getActiveCount() == 0);
+        CHECK(host->getStreamScheduler()->getActiveCount("http://example.com") == 0);
+        host->shutdown();
+    }
+
+    // Streams that never opened, and are closed at teardown without an event, give their slots back
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    host->setPageOrigin("http://example.com");
+    FB::BrowserStreamSchedulerPtr scheduler(host->getStreamScheduler());
+    scheduler->setLimits(2, 2);
+    FB::ScheduledStreamRequestPtr a(queueTestStream(host, "http://example.com/a"));
+    FB::ScheduledStreamRequestPtr b(queueTestStream(host, "http://example.com/b"));
+    CHECK(scheduler->getActiveCount() == 2);
+    host->shutdown();
+    CHECK(scheduler->getActiveCount() == 0);
+    CHECK(scheduler->getActiveCount("http://example.com") == 0);
+    CHECK(a->getState() == FB::ScheduledStreamRequest::COMPLETED);
+}
@@ -0,0 +1,276 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+
+#include "JSAPIAuto.h"
+#include "variant_list.h"
+#include "NPJavascriptObject.h"
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    // A window whose objects keep their properties and can be frozen as with Object.freeze, unless
+    // freezeAvailable is false, as on pages from before there was one
+    struct FreezableObject : NPObject {
+        FreezableObject() : frozen(false) { }
+        std::map<NPIdentifier, NPVariant> props;
+        bool frozen;
+    };
+
+    NPP freezePage(NULL);
+    NPObject* freezeWindow(NULL);
+    NPObject* freezeObjectClass(NULL);
+    bool freezeAvailable(true);
+
+    NPIdentifier freezeId(const char* name) { return NpapiHost::NH_GetStringIdentifier(name); }
+
+    FreezableObject* freezable(NPObject* obj) { return static_cast<FreezableObject*>(obj); }
+
+    NPVariant copyFreezableVariant(const NPVariant& src)
+    {
+        NPVariant dst(src);
+        if (NPVARIANT_IS_STRING(src)) {
+            uint32_t len = src.value.stringValue.UTF8Length;
+            char* chars = static_cast<char*>(NpapiHost::NH_MemAlloc(len + 1));
+            memcpy(chars, src.value.stringValue.UTF8Characters, len);
+            chars[len] = 0;
+            dst.value.stringValue.UTF8Characters = chars;
+        } else if (NPVARIANT_IS_OBJECT(src)) {
+            NpapiHost::NH_RetainObject(src.value.objectValue);
+        }
+        return dst;
+    }
+
+    void storeFreezable(FreezableObject* obj, NPIdentifier name, const NPVariant& value)
+    {
+        std::map<NPIdentifier, NPVariant>::iterator fnd = obj->props.find(name);
+        if (fnd != obj->props.end())
+            NpapiHost::NH_ReleaseVariantValue(&fnd->second);
+        obj->props[name] = copyFreezableVariant(value);
+    }
+
+    NPObject* NP_LOADDS freezableAllocate(NPP npp, NPClass *aClass) { return new FreezableObject(); }
+    void NP_LOADDS freezableDeallocate(NPObject *obj)
+    {
+        FreezableObject* page = freezable(obj);
+        for (std::map<NPIdentifier, NPVariant>::iterator it = page->props.begin(); it != page->props.end(); ++it)
+            NpapiHost::NH_ReleaseVariantValue(&it->second);
+        delete page;
+    }
+    bool NP_LOADDS freezableHasMethod(NPObject *obj, NPIdentifier name)
+    {
+        if (obj == freezeObjectClass)
+            return freezeAvailable && name == freezeId("freeze");
+        return name == freezeId("push") || name == freezeId("Array") || name == freezeId("Object");
+    }
+    bool NP_LOADDS freezableInvoke(NPObject *obj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result);
+    bool NP_LOADDS freezableHasProperty(NPObject *obj, NPIdentifier name)
+    {
+        return freezable(obj)->props.count(name) || name == freezeId("length")
+            || (obj == freezeWindow && (name == freezeId("document") || name == freezeId("Object")));
+    }
+    bool NP_LOADDS freezableGetProperty(NPObject *obj, NPIdentifier name, NPVariant *result)
+    {
+        FreezableObject* page = freezable(obj);
+        if (obj == freezeWindow && (name == freezeId("document") || name == freezeId("Object"))) {
+            // The document only needs to exist
+            OBJECT_TO_NPVARIANT(NpapiHost::NH_RetainObject(name == freezeId("Object") ? freezeObjectClass : freezeWindow), *result);
+            return true;
+        }
+        if (name == freezeId("length")) {
+            INT32_TO_NPVARIANT(static_cast<int32_t>(page->props.size()), *result);
+            return true;
+        }
+        std::map<NPIdentifier, NPVariant>::const_iterator fnd = page->props.find(name);
+        if (fnd == page->props.end())
+            return false;
+        *result = copyFreezableVariant(fnd->second);
+        return true;
+    }
+    bool NP_LOADDS freezableSetProperty(NPObject *obj, NPIdentifier name, const NPVariant *value)
+    {
+        if (freezable(obj)->frozen)
+            return false;
+        storeFreezable(freezable(obj), name, *value);
+        return true;
+    }
+
+    NPClass freezableClass = {
+        NP_CLASS_STRUCT_VERSION, freezableAllocate, freezableDeallocate, NULL, freezableHasMethod,
+        freezableInvoke, NULL, freezableHasProperty, freezableGetProperty, freezableSetProperty
+    };
+
+    bool NP_LOADDS freezableInvoke(NPObject *obj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result)
+    {
+        if (!freezableHasMethod(obj, name))
+            return false;
+        if (name == freezeId("push")) {
+            FreezableObject* page = freezable(obj);
+            if (page->frozen)
+                return false;
+            for (uint32_t i = 0; i < argCount; ++i) {
+                std::string idx(boost::lexical_cast<std::string>(page->props.size()));
+                storeFreezable(page, freezeId(idx.c_str()), args[i]);
+            }
+            INT32_TO_NPVARIANT(static_cast<int32_t>(page->props.size()), *result);
+            return true;
+        }
+        if (name == freezeId("freeze")) {
+            if (argCount != 1 || !NPVARIANT_IS_OBJECT(args[0]))
+                return false;
+            freezable(NPVARIANT_TO_OBJECT(args[0]))->frozen = true;
+            *result = copyFreezableVariant(args[0]);
+            return true;
+        }
+        OBJECT_TO_NPVARIANT(NpapiHost::NH_CreateObject(freezePage, &freezableClass), *result);
+        return true;
+    }
+
+    struct FreezablePageHost : NpapiHost
+    {
+        FreezablePageHost() : NpapiHost(NULL, NULL, NULL)
+        {
+            freezePage = &m_instance;
+            freezeWindow = NH_CreateObject(&m_instance, &freezableClass);
+            freezeObjectClass = NH_CreateObject(&m_instance, &freezableClass);
+            m_funcs.getvalue = &FreezablePageHost::getValue;
+        }
+        ~FreezablePageHost()
+        {
+            NH_ReleaseObject(freezeObjectClass);
+            NH_ReleaseObject(freezeWindow);
+            freezeObjectClass = freezeWindow = NULL;
+            freezePage = NULL;
+            freezeAvailable = true;
+        }
+
+        static NPError NP_LOADDS getValue(NPP instance, NPNVariable variable, void *value)
+        {
+            if (variable != NPNVWindowNPObject || !freezeWindow)
+                return NH_GetValue(instance, variable, value);
+            *static_cast<NPObject**>(value) = NH_RetainObject(freezeWindow);
+            return NPERR_NO_ERROR;
+        }
+    };
+
+    class CachedSettingsAPI : public FB::JSAPIAuto
+    {
+    public:
+        CachedSettingsAPI() : reads(0)
+        {
+            registerCachedProperty("settings", make_property(this, &CachedSettingsAPI::get_settings));
+        }
+        FB::VariantMap get_settings()
+        {
+            ++reads;
+            FB::VariantMap inner;
+            inner["depth"] = 2;
+            FB::VariantMap res;
+            res["name"] = "settings";
+            res["sizes"] = FB::VariantList(FB::variant_list_of(1)(2)(3));
+            res["nested"] = inner;
+            return res;
+        }
+
+        int reads;
+    };
+
+    // Reads a property as the page would and returns the object it got, retained
+    NPObject* readObject(NPNetscapeFuncs* funcs, NPP npp, NPObject* obj, const char* name)
+    {
+        NPVariant res;
+        VOID_TO_NPVARIANT(res);
+        if (!funcs->getproperty(npp, obj, freezeId(name), &res) || !NPVARIANT_IS_OBJECT(res)) {
+            funcs->releasevariantvalue(&res);
+            return NULL;
+        }
+        return NPVARIANT_TO_OBJECT(res);
+    }
+
+    // The object held in a property of a page object, not retained
+    NPObject* memberObject(NPObject* obj, const char* name)
+    {
+        std::map<NPIdentifier, NPVariant>::const_iterator fnd = freezable(obj)->props.find(freezeId(name));
+        if (fnd == freezable(obj)->props.end() || !NPVARIANT_IS_OBJECT(fnd->second))
+            return NULL;
+        return NPVARIANT_TO_OBJECT(fnd->second);
+    }
+}
+
+TEST(NPJavascriptObject_CachedPropertyObjects)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    FreezablePageHost testHost;
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+
+    boost::shared_ptr<CachedSettingsAPI> api(boost::make_shared<CachedSettingsAPI>());
+    NPJavascriptObject *obj = NPJavascriptObject::NewObject(host, api);
+    NPNetscapeFuncs* funcs = testHost.getBrowserFuncs();
+    NPP npp = testHost.getPluginInstance();
+
+    // Every read shares one object, so it's frozen all the way down
+    NPObject* first = readObject(funcs, npp, obj, "settings");
+    NPObject* second = readObject(funcs, npp, obj, "settings");
+    CHECK(first && second);
+    if (!first || !second) {
+        host->ReleaseObject(obj);
+        return;
+    }
+    CHECK(first == second);
+    CHECK_EQUAL(1, api->reads);
+    CHECK(freezable(first)->frozen);
+    NPObject* sizes = memberObject(first, "sizes");
+    NPObject* nested = memberObject(first, "nested");
+    CHECK(sizes && freezable(sizes)->frozen);
+    CHECK(nested && freezable(nested)->frozen);
+    NPVariant changed;
+    INT32_TO_NPVARIANT(7, changed);
+    CHECK(!funcs->setproperty(npp, first, freezeId("name"), &changed));
+    funcs->releaseobject(first);
+    funcs->releaseobject(second);
+
+    // Where nothing can be frozen, each read gets an object of its own, though the getter still
+    // only runs once
+    freezeAvailable = false;
+    api->invalidateProperty("settings");
+    first = readObject(funcs, npp, obj, "settings");
+    second = readObject(funcs, npp, obj, "settings");
+    CHECK(first && second);
+    if (first && second) {
+        CHECK(first != second);
+        CHECK(!freezable(first)->frozen);
+        CHECK(funcs->setproperty(npp, first, freezeId("name"), &changed));
+        NPVariant name;
+        CHECK(funcs->getproperty(npp, second, freezeId("name"), &name));
+        CHECK(NPVARIANT_IS_STRING(name));
+        funcs->releasevariantvalue(&name);
+    }
+    CHECK_EQUAL(2, api->reads);
+    if (first) funcs->releaseobject(first);
+    if (second) funcs->releaseobject(second);
+
+    host->ReleaseObject(obj);
+}
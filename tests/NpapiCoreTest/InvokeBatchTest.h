@@ -0,0 +1,275 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/make_shared.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "JSAPIAuto.h"
+#include "variant_encoding.h"
+#include "NPJavascriptObject.h"
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    // A window that can make arrays and objects, counting every call the plugin makes into any of
+    // them; those are the browser crossings a batch is meant to save
+    struct PageObject : NPObject {
+        std::vector<NPVariant> elements;
+    };
+
+    NPP batchPage(NULL);
+    NPObject* batchWindow(NULL);
+    size_t pageCalls(0);
+    size_t pageObjects(0);
+
+    NPIdentifier pageId(const char* name) { return NpapiHost::NH_GetStringIdentifier(name); }
+
+    NPVariant copyPageVariant(const NPVariant& src)
+    {
+        NPVariant dst(src);
+        if (NPVARIANT_IS_STRING(src)) {
+            uint32_t len = src.value.stringValue.UTF8Length;
+            char* chars = static_cast<char*>(NpapiHost::NH_MemAlloc(len + 1));
+            memcpy(chars, src.value.stringValue.UTF8Characters, len);
+            chars[len] = 0;
+            dst.value.stringValue.UTF8Characters = chars;
+        } else if (NPVARIANT_IS_OBJECT(src)) {
+            NpapiHost::NH_RetainObject(src.value.objectValue);
+        }
+        return dst;
+    }
+
+    // The element an index identifier names, or -1
+    long pageIndex(NPIdentifier name)
+    {
+        NPUTF8* str = NpapiHost::NH_UTF8FromIdentifier(name);
+        if (!str)
+            return -1;
+        char* end = NULL;
+        long idx = strtol(str, &end, 10);
+        bool numeric = *str && !*end;
+        NpapiHost::NH_MemFree(str);
+        return numeric ? idx : -1;
+    }
+
+    NPObject* NP_LOADDS pageAllocate(NPP npp, NPClass *aClass) { ++pageObjects; return new PageObject(); }
+    void NP_LOADDS pageDeallocate(NPObject *obj)
+    {
+        PageObject* page = static_cast<PageObject*>(obj);
+        for (size_t i = 0; i < page->elements.size(); ++i)
+            NpapiHost::NH_ReleaseVariantValue(&page->elements[i]);
+        delete page;
+    }
+    bool NP_LOADDS pageHasMethod(NPObject *obj, NPIdentifier name)
+    {
+        ++pageCalls;
+        return name == pageId("push") || name == pageId("Array") || name == pageId("Object");
+    }
+    bool NP_LOADDS pageInvoke(NPObject *obj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result);
+    bool NP_LOADDS pageHasProperty(NPObject *obj, NPIdentifier name)
+    {
+        ++pageCalls;
+        long idx = pageIndex(name);
+        return name == pageId("length") || (obj == batchWindow && name == pageId("document"))
+            || (idx >= 0 && idx < static_cast<long>(static_cast<PageObject*>(obj)->elements.size()));
+    }
+    bool NP_LOADDS pageGetProperty(NPObject *obj, NPIdentifier name, NPVariant *result)
+    {
+        ++pageCalls;
+        PageObject* page = static_cast<PageObject*>(obj);
+        if (name == pageId("length")) {
+            INT32_TO_NPVARIANT(static_cast<int32_t>(page->elements.size()), *result);
+            return true;
+        }
+        if (obj == batchWindow && name == pageId("document")) {
+            // Only needs to exist
+            OBJECT_TO_NPVARIANT(NpapiHost::NH_RetainObject(batchWindow), *result);
+            return true;
+        }
+        long idx = pageIndex(name);
+        if (idx < 0 || idx >= static_cast<long>(page->elements.size()))
+            return false;
+        *result = copyPageVariant(page->elements[idx]);
+        return true;
+    }
+
+    NPClass pageClass = {
+        NP_CLASS_STRUCT_VERSION, pageAllocate, pageDeallocate, NULL, pageHasMethod, pageInvoke, NULL,
+        pageHasProperty, pageGetProperty
+    };
+
+    bool NP_LOADDS pageInvoke(NPObject *obj, NPIdentifier name, const NPVariant *args, uint32_t argCount, NPVariant *result)
+    {
+        ++pageCalls;
+        if (name == pageId("push")) {
+            PageObject* page = static_cast<PageObject*>(obj);
+            for (uint32_t i = 0; i < argCount; ++i)
+                page->elements.push_back(copyPageVariant(args[i]));
+            INT32_TO_NPVARIANT(static_cast<int32_t>(page->elements.size()), *result);
+            return true;
+        }
+        if (name == pageId("Array") || name == pageId("Object")) {
+            OBJECT_TO_NPVARIANT(NpapiHost::NH_CreateObject(batchPage, &pageClass), *result);
+            return true;
+        }
+        return false;
+    }
+
+    struct BatchPageHost : NpapiHost
+    {
+        BatchPageHost() : NpapiHost(NULL, NULL, NULL)
+        {
+            batchPage = &m_instance;
+            batchWindow = NH_CreateObject(&m_instance, &pageClass);
+            m_funcs.getvalue = &BatchPageHost::getValue;
+        }
+        ~BatchPageHost()
+        {
+            NH_ReleaseObject(batchWindow);
+            batchWindow = NULL;
+            batchPage = NULL;
+        }
+
+        static NPError NP_LOADDS getValue(NPP instance, NPNVariable variable, void *value)
+        {
+            if (variable != NPNVWindowNPObject || !batchWindow)
+                return NH_GetValue(instance, variable, value);
+            *static_cast<NPObject**>(value) = NH_RetainObject(batchWindow);
+            return NPERR_NO_ERROR;
+        }
+    };
+
+    class BatchCounterAPI : public FB::JSAPIAuto
+    {
+    public:
+        BatchCounterAPI() : total(0)
+        {
+            registerMethod("add", make_method(this, &BatchCounterAPI::add));
+            registerProperty("total", make_property(this, &BatchCounterAPI::get_total));
+        }
+        int add(int n) { return total += n; }
+        int get_total() { return total; }
+
+        int total;
+    };
+
+    double microsSince(const boost::posix_time::ptime& start)
+    {
+        return static_cast<double>((boost::posix_time::microsec_clock::universal_time() - start).total_microseconds());
+    }
+}
+
+TEST(NPJavascriptObject_InvokeBatch)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    BatchPageHost testHost;
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+
+    boost::shared_ptr<BatchCounterAPI> api(boost::make_shared<BatchCounterAPI>());
+    NPJavascriptObject *obj = NPJavascriptObject::NewObject(host, api);
+    NPNetscapeFuncs* funcs = testHost.getBrowserFuncs();
+    NPP npp = testHost.getPluginInstance();
+
+    const int count = 1000;
+    const int rounds = 20;
+    // What one crossing costs a plugin run out of process: a round trip to the browser. The
+    // headless host crosses with a plain function call, so that part of the saving has to be added.
+    const double crossingMicros = 10.0;
+
+    // One call from the page per operation
+    NPVariant arg;
+    NPVariant res;
+    size_t singleCrossings = 0;
+    pageCalls = pageObjects = 0;
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < count; ++i) {
+            INT32_TO_NPVARIANT(1, arg);
+            funcs->invoke(npp, obj, pageId("add"), &arg, 1, &res);
+            ++singleCrossings;
+        }
+    }
+    const double single = microsSince(start) / (rounds * count);
+    CHECK_EQUAL(rounds * count, api->total);
+    CHECK_EQUAL(0u, pageCalls);
+
+    // The same operations as one batch, which the page would have put together with JSON.stringify
+    std::string ops("[");
+    for (int i = 0; i < count; ++i)
+        ops += i ? ",\"add\",1,1" : "\"add\",1,1";
+    ops += ']';
+    NPVariant batchArg;
+    STRINGN_TO_NPVARIANT(ops.data(), static_cast<uint32_t>(ops.size()), batchArg);
+
+    api->total = 0;
+    size_t calls = 0;
+    size_t objects = 0;
+    size_t batchCrossings = 0;
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (int r = 0; r < rounds; ++r) {
+        pageCalls = pageObjects = 0;
+        CHECK(funcs->invoke(npp, obj, pageId("invokeBatch"), &batchArg, 1, &res));
+        ++batchCrossings;
+        calls += pageCalls;
+        objects += pageObjects;
+        if (r == rounds - 1) {
+            // A success flag and the running total for each operation, in one string
+            CHECK(NPVARIANT_IS_STRING(res));
+            if (NPVARIANT_IS_STRING(res)) {
+                const NPString& str(NPVARIANT_TO_STRING(res));
+                FB::VariantList out(FB::decodeJSON(std::string(str.UTF8Characters, str.UTF8Length))
+                    .convert_cast<FB::VariantList>());
+                CHECK_EQUAL(static_cast<size_t>(2 * count), out.size());
+                if (out.size() == static_cast<size_t>(2 * count)) {
+                    CHECK(out[0].convert_cast<bool>());
+                    CHECK_EQUAL((rounds - 1) * count + 1, out[1].convert_cast<int>());
+                    CHECK_EQUAL(rounds * count, out[2 * count - 1].convert_cast<int>());
+                }
+            }
+        }
+        funcs->releasevariantvalue(&res);
+    }
+    const double batched = microsSince(start) / (rounds * count);
+    CHECK_EQUAL(rounds * count, api->total);
+
+    // Nothing on the page is touched: the whole batch crosses once each way
+    CHECK_EQUAL(0u, calls);
+    CHECK_EQUAL(0u, objects);
+    CHECK_EQUAL(static_cast<size_t>(rounds * count), singleCrossings);
+    CHECK_EQUAL(static_cast<size_t>(rounds), batchCrossings);
+    printf("    %d ops x %d: %u crossings, %.3f us/op one call each; %u crossings, %.3f us/op batched\n",
+        count, rounds, static_cast<unsigned>(singleCrossings), single, static_cast<unsigned>(batchCrossings), batched);
+
+    // Here a batch costs more per operation than a direct invoke, for the JSON both ways; it has to
+    // win back more than that in the crossings it saves
+    const double singleInBrowser = single + crossingMicros * singleCrossings / (rounds * count);
+    const double batchedInBrowser = batched + crossingMicros * batchCrossings / (rounds * count);
+    printf("    with %.0f us a crossing: %.3f us/op one call each, %.3f us/op batched\n", crossingMicros,
+        singleInBrowser, batchedInBrowser);
+    CHECK(batched - single < crossingMicros);
+    CHECK(batchedInBrowser < singleInBrowser);
+
+    host->ReleaseObject(obj);
+}
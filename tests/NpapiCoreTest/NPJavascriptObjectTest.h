@@ -182,3 +182,30 @@ TEST(NPJavascriptObject_Properties)
     }
 }
 
+
+TEST(NpapiBrowserHost_SharedStrings)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+
+    // SharedStrings go to the browser as strings
+    const std::string text("a string that is passed to the browser without extra copies");
+    NPVariant npv;
+    host->getNPVariant(&npv, FB::variant(FB::SharedString(text)));
+    CHECK_EQUAL(NPVariantType_String, npv.type);
+    CHECK_EQUAL(text, host->getVariant(&npv).convert_cast<std::string>());
+    host->ReleaseVariantValue(&npv);
+
+    // Identifier names are looked up once and then shared
+    NPIdentifier id = STRID(host, "someLongerMemberName");
+    FB::SharedString name(host->SharedStringFromIdentifier(id));
+    CHECK(name == "someLongerMemberName");
+    CHECK(name.c_str() == host->SharedStringFromIdentifier(id).c_str());
+    CHECK_EQUAL("someLongerMemberName", host->StringFromIdentifier(id));
+}
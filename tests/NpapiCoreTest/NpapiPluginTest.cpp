@@ -19,6 +19,14 @@ Copyright 2009 Richard Bateman, Firebreath development team
 
 #include "TestPlugin.h"
 #include "NPJavascriptObjectTest.h"
+#include "BrowserStreamSchedulerTest.h"
+#include "TeardownTest.h"
+#include "ShutdownStressTest.h"
+#include "ResourceQuotaTest.h"
+#include "BrowserSessionTest.h"
+#include "SessionReplayTest.h"
+#include "InvokeBatchTest.h"
+#include "CachedPropertyTest.h"
 #include "NpapiPlugin.h"
 #include "FactoryBase.h"
 #include <boost/make_shared.hpp>
@@ -56,7 +64,7 @@ public:
         TestPlugin::StaticDeinitialize();
     }
     
-    FB::Npapi::NpapiPluginPtr createNpapiPlugin(const NpapiBrowserHostPtr& host, std::string mimetype)
+    FB::Npapi::NpapiPluginPtr createNpapiPlugin(const NpapiBrowserHostPtr& host, const std::string& mimetype)
     {
         return boost::make_shared<FB::Npapi::NpapiPlugin>(host, mimetype);
     }
@@ -0,0 +1,305 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstring>
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+#include "BrowserStreamRequest.h"
+#include "DefaultBrowserStreamHandler.h"
+#include "PluginEvents/StreamEvents.h"
+#include "ResourceQuota.h"
+#include "Timer.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    // A plugin instance on a page from origin, or one whose origin is unknown if that's empty,
+    // whose main thread calls wait for runAsyncCalls()
+    struct QuotaTestPage
+    {
+        QuotaTestPage(NpapiPluginModule& module, const std::string& origin)
+            : testHost(NULL, NULL, NULL)
+        {
+            testHost.setQueueAsyncCalls(true);
+            host.reset(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+            host->setBrowserFuncs(testHost.getBrowserFuncs());
+            if (!origin.empty())
+                host->setPageOrigin(origin);
+        }
+        ~QuotaTestPage()
+        {
+            host->shutdown();
+            testHost.runAsyncCalls();
+        }
+
+        NpapiHost testHost;
+        NpapiBrowserHostPtr host;
+    };
+
+    // A window whose location is quotaPageHref
+    NPObject* quotaWindow(NULL);
+    NPObject* quotaLocation(NULL);
+    const char* quotaPageHref("http://c.example.com:8080/app/index.html?x=1");
+
+    NPIdentifier quotaId(const char* name) { return NpapiHost::NH_GetStringIdentifier(name); }
+
+    bool NP_LOADDS quotaPageHasProperty(NPObject *obj, NPIdentifier name)
+    {
+        return obj == quotaWindow ? name == quotaId("document") || name == quotaId("location")
+            : name == quotaId("href");
+    }
+    bool NP_LOADDS quotaPageGetProperty(NPObject *obj, NPIdentifier name, NPVariant *result)
+    {
+        if (!quotaPageHasProperty(obj, name))
+            return false;
+        if (name == quotaId("href")) {
+            size_t len = strlen(quotaPageHref);
+            char* chars = static_cast<char*>(NpapiHost::NH_MemAlloc(len + 1));
+            memcpy(chars, quotaPageHref, len + 1);
+            STRINGN_TO_NPVARIANT(chars, static_cast<uint32_t>(len), *result);
+        } else {
+            // The document only needs to exist
+            OBJECT_TO_NPVARIANT(NpapiHost::NH_RetainObject(name == quotaId("location") ? quotaLocation : quotaWindow), *result);
+        }
+        return true;
+    }
+
+    NPClass quotaPageClass = {
+        NP_CLASS_STRUCT_VERSION, NULL, NULL, NULL, NULL, NULL, NULL, quotaPageHasProperty, quotaPageGetProperty
+    };
+
+    struct QuotaLocationHost : NpapiHost
+    {
+        QuotaLocationHost() : NpapiHost(NULL, NULL, NULL)
+        {
+            quotaWindow = NH_CreateObject(&m_instance, &quotaPageClass);
+            quotaLocation = NH_CreateObject(&m_instance, &quotaPageClass);
+            m_funcs.getvalue = &QuotaLocationHost::getValue;
+        }
+        ~QuotaLocationHost()
+        {
+            NH_ReleaseObject(quotaLocation);
+            NH_ReleaseObject(quotaWindow);
+            quotaLocation = quotaWindow = NULL;
+        }
+
+        static NPError NP_LOADDS getValue(NPP instance, NPNVariable variable, void *value)
+        {
+            if (variable != NPNVWindowNPObject || !quotaWindow)
+                return NH_GetValue(instance, variable, value);
+            *static_cast<NPObject**>(value) = NH_RetainObject(quotaWindow);
+            return NPERR_NO_ERROR;
+        }
+    };
+
+    void quotaTestCall() { }
+    void quotaTestAsyncCall(void*) { }
+
+    // Whether the host could queue another call that can be dropped
+    bool queueQuotaTestCall(const NpapiBrowserHostPtr& host)
+    {
+        return host->ScheduleAsyncCall(&quotaTestAsyncCall, NULL, &quotaTestAsyncCall);
+    }
+
+    FB::BrowserStreamPtr openQuotaTestStream(const NpapiBrowserHostPtr& host, const std::string& url)
+    {
+        FB::BrowserStreamRequest req(url);
+        req.setEventSink(boost::make_shared<FB::DefaultBrowserStreamHandler>());
+        req.setBufferSize(1024);
+        return host->createStream(req);
+    }
+}
+
+TEST(ResourceQuota_Leases)
+{
+    PRINT_TESTNAME;
+
+    FB::ResourceQuotaPtr quota(boost::make_shared<FB::ResourceQuota>());
+    quota->setLimit("http://a.example.com", FB::ResourceQuota::Streams, 2);
+
+    FB::ResourceLeasePtr first(quota->acquire("http://a.example.com", FB::ResourceQuota::Streams));
+    FB::ResourceLeasePtr second(quota->tryAcquire("http://a.example.com", FB::ResourceQuota::Streams));
+    CHECK(second);
+    CHECK(!quota->tryAcquire("http://a.example.com", FB::ResourceQuota::Streams));
+    CHECK_EQUAL(2u, quota->getUsage("http://a.example.com", FB::ResourceQuota::Streams));
+
+    bool threw = false;
+    try {
+        quota->acquire("http://a.example.com", FB::ResourceQuota::Streams);
+    } catch (const FB::quota_exceeded& e) {
+        threw = true;
+        CHECK_EQUAL("http://a.example.com", e.origin);
+        CHECK(std::string(e.what()).find("streams") != std::string::npos);
+    }
+    CHECK(threw);
+    CHECK_EQUAL(2u, quota->getRejectedCount("http://a.example.com", FB::ResourceQuota::Streams));
+
+    // Another origin has a budget of its own
+    CHECK(quota->tryAcquire("http://b.example.com", FB::ResourceQuota::Streams));
+
+    // What can't be turned down still counts
+    FB::ResourceLeasePtr forced(quota->charge("http://a.example.com", FB::ResourceQuota::Streams));
+    CHECK_EQUAL(3u, quota->getUsage("http://a.example.com", FB::ResourceQuota::Streams));
+    forced.reset();
+    second.reset();
+    CHECK(quota->tryAcquire("http://a.example.com", FB::ResourceQuota::Streams));
+    first.reset();
+    CHECK_EQUAL(0u, quota->getUsage("http://a.example.com", FB::ResourceQuota::Streams));
+
+    // Buffers grow and shrink under one lease
+    quota->setLimit("http://a.example.com", FB::ResourceQuota::BufferBytes, 1000);
+    FB::ResourceLeasePtr buffer(quota->acquire("http://a.example.com", FB::ResourceQuota::BufferBytes, 600));
+    CHECK(!buffer->tryGrow(500));
+    CHECK_EQUAL(600u, buffer->getAmount());
+    buffer->shrink(200);
+    CHECK(buffer->tryGrow(500));
+    CHECK_EQUAL(900u, quota->getUsage("http://a.example.com", FB::ResourceQuota::BufferBytes));
+    buffer->release();
+    CHECK_EQUAL(0u, quota->getUsage("http://a.example.com", FB::ResourceQuota::BufferBytes));
+
+    quota->clearLimits("http://a.example.com");
+    CHECK_EQUAL(quota->getDefaultLimit(FB::ResourceQuota::Streams),
+        quota->getLimit("http://a.example.com", FB::ResourceQuota::Streams));
+}
+
+TEST(ResourceQuota_PerOriginHosts)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost moduleHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(moduleHost.getBrowserFuncs());
+
+    FB::ResourceQuotaPtr quota(FB::ResourceQuota::instance());
+    const std::string a("http://a.example.com"), b("http://b.example.com:8080");
+    quota->setLimit(a, FB::ResourceQuota::AsyncCalls, 3);
+    quota->setLimit(a, FB::ResourceQuota::Streams, 2);
+    quota->setLimit(a, FB::ResourceQuota::Timers, 1);
+    quota->setLimit(b, FB::ResourceQuota::AsyncCalls, 3);
+    {
+        // Two instances on pages from a share its budget; b has its own
+        QuotaTestPage a1(module, a), a2(module, a), b1(module, b);
+
+        CHECK(queueQuotaTestCall(a1.host));
+        CHECK(queueQuotaTestCall(a1.host));
+        CHECK(queueQuotaTestCall(a2.host));
+        CHECK(!queueQuotaTestCall(a2.host));
+        CHECK(!queueQuotaTestCall(a1.host));
+        CHECK(queueQuotaTestCall(b1.host));
+        CHECK_EQUAL(3u, quota->getUsage(a, FB::ResourceQuota::AsyncCalls));
+
+        // A call that must run is never turned down, but still counts
+        a1.host->ScheduleOnMainThread(a1.host, boost::bind(&quotaTestCall), true);
+        CHECK_EQUAL(4u, quota->getUsage(a, FB::ResourceQuota::AsyncCalls));
+
+        // Once the browser gets round to a1's calls a can make more
+        CHECK_EQUAL(3u, a1.testHost.runAsyncCalls());
+        CHECK_EQUAL(1u, quota->getUsage(a, FB::ResourceQuota::AsyncCalls));
+        CHECK(queueQuotaTestCall(a2.host));
+
+        // Streams are turned down before the browser is asked for them
+        FB::BrowserStreamPtr s1(openQuotaTestStream(a1.host, "http://a.example.com/1"));
+        FB::BrowserStreamPtr s2(openQuotaTestStream(a2.host, "http://a.example.com/2"));
+        CHECK(s1 && s2);
+        bool threw = false;
+        try {
+            openQuotaTestStream(a2.host, "http://a.example.com/3");
+        } catch (const FB::quota_exceeded& e) {
+            threw = true;
+            CHECK_EQUAL(a, e.origin);
+        }
+        CHECK(threw);
+        CHECK_EQUAL(1u, a2.testHost.getURLRequests().size());
+        CHECK(openQuotaTestStream(b1.host, "http://b.example.com:8080/1"));
+        CHECK_EQUAL(2048u, quota->getUsage(a, FB::ResourceQuota::BufferBytes));
+
+        // A finished stream gives its share back
+        FB::StreamCompletedEvent done(s1.get(), true);
+        s1->SendEvent(&done);
+        CHECK_EQUAL(1u, quota->getUsage(a, FB::ResourceQuota::Streams));
+        CHECK(openQuotaTestStream(a1.host, "http://a.example.com/4"));
+
+        // Timers are held until they are released
+        FB::TimerPtr timer(FB::Timer::getTimer(a1.host, 1000, false, boost::bind(&quotaTestCall)));
+        threw = false;
+        try {
+            FB::Timer::getTimer(a2.host, 1000, false, boost::bind(&quotaTestCall));
+        } catch (const FB::quota_exceeded&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(FB::Timer::getTimer(b1.host, 1000, false, boost::bind(&quotaTestCall)));
+        timer.reset();
+        CHECK(FB::Timer::getTimer(a2.host, 1000, false, boost::bind(&quotaTestCall)));
+    }
+    // Everything is given back when the pages go away
+    CHECK_EQUAL(0u, quota->getUsage(a, FB::ResourceQuota::AsyncCalls));
+    CHECK_EQUAL(0u, quota->getUsage(a, FB::ResourceQuota::Streams));
+    CHECK_EQUAL(0u, quota->getUsage(a, FB::ResourceQuota::BufferBytes));
+    CHECK_EQUAL(0u, quota->getUsage(b, FB::ResourceQuota::AsyncCalls));
+    quota->clearLimits(a);
+    quota->clearLimits(b);
+}
+
+TEST(ResourceQuota_UnknownOrigin)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost moduleHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(moduleHost.getBrowserFuncs());
+
+    // The origin is read from the page when the host is set up
+    {
+        QuotaLocationHost testHost;
+        NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+        host->setBrowserFuncs(testHost.getBrowserFuncs());
+        CHECK_EQUAL("http://c.example.com:8080", host->getPageOrigin());
+        host->shutdown();
+    }
+
+    // Pages whose origin couldn't be read don't share one budget; they get none
+    FB::ResourceQuotaPtr quota(FB::ResourceQuota::instance());
+    {
+        QuotaTestPage page(module, "");
+        CHECK(page.host->getPageOrigin().empty());
+        CHECK(!queueQuotaTestCall(page.host));
+        bool threw = false;
+        try {
+            openQuotaTestStream(page.host, "http://a.example.com/1");
+        } catch (const FB::quota_exceeded& e) {
+            threw = true;
+            CHECK(e.origin.empty());
+        }
+        CHECK(threw);
+        CHECK(page.testHost.getURLRequests().empty());
+        threw = false;
+        try {
+            FB::Timer::getTimer(page.host, 1000, false, boost::bind(&quotaTestCall));
+        } catch (const FB::quota_exceeded&) {
+            threw = true;
+        }
+        CHECK(threw);
+
+        // though calls that must run still do
+        page.host->ScheduleOnMainThread(page.host, boost::bind(&quotaTestCall), true);
+        CHECK_EQUAL(1u, page.testHost.runAsyncCalls());
+    }
+    CHECK_EQUAL(0u, quota->getUsage("", FB::ResourceQuota::AsyncCalls));
+}
@@ -0,0 +1,237 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiSessionRecorder.h"
+#include "SessionReplayer.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    NPIdentifier documentId(NULL);
+    NPObject* testDocument(NULL);
+
+    NPObject* NP_LOADDS testPageAllocate(NPP npp, NPClass *aClass) { return new NPObject(); }
+    void NP_LOADDS testPageDeallocate(NPObject *obj) { delete obj; }
+    bool NP_LOADDS testPageHasProperty(NPObject *obj, NPIdentifier name) { return name == documentId; }
+    bool NP_LOADDS testPageGetProperty(NPObject *obj, NPIdentifier name, NPVariant *result)
+    {
+        if (name != documentId || !testDocument)
+            return false;
+        testDocument->referenceCount++;
+        OBJECT_TO_NPVARIANT(testDocument, *result);
+        return true;
+    }
+
+    NPClass testPageClass = {
+        NP_CLASS_STRUCT_VERSION, testPageAllocate, testPageDeallocate, NULL, NULL, NULL, NULL,
+        testPageHasProperty, testPageGetProperty
+    };
+
+    // A browser with a page for the plugin to find its window and document in
+    struct CaptureTestHost : NpapiHost
+    {
+        CaptureTestHost() : NpapiHost(NULL, NULL, NULL)
+        {
+            documentId = NH_GetStringIdentifier("document");
+            window = NH_CreateObject(&m_instance, &testPageClass);
+            testDocument = NH_CreateObject(&m_instance, &testPageClass);
+            m_funcs.getvalue = &CaptureTestHost::getValue;
+            s_window = window;
+        }
+        ~CaptureTestHost()
+        {
+            NH_ReleaseObject(testDocument);
+            NH_ReleaseObject(window);
+            testDocument = s_window = NULL;
+        }
+
+        static NPError NP_LOADDS getValue(NPP instance, NPNVariable variable, void *value)
+        {
+            if (variable != NPNVWindowNPObject || !s_window)
+                return NH_GetValue(instance, variable, value);
+            *static_cast<NPObject**>(value) = NH_RetainObject(s_window);
+            return NPERR_NO_ERROR;
+        }
+
+        NPObject* window;
+        static NPObject* s_window;
+    };
+    NPObject* CaptureTestHost::s_window(NULL);
+
+    NPVariant stringVariant(const char* str)
+    {
+        NPVariant var;
+        var.type = NPVariantType_String;
+        var.value.stringValue.UTF8Characters = str;
+        var.value.stringValue.UTF8Length = static_cast<uint32_t>(strlen(str));
+        return var;
+    }
+
+    // Loads the test plugin into a page, and scripts it a bit
+    SessionCapture recordTestSession()
+    {
+        SessionRecorder::start();
+        CaptureTestHost testHost;
+        NpapiPluginModule* module = NpapiPluginModule::GetModule(0);
+        module->setNetscapeFuncs(testHost.getBrowserFuncs());
+        NPPluginFuncs pluginFuncs;
+        module->getPluginFuncs(&pluginFuncs);
+        NPNetscapeFuncs* funcs = testHost.getBrowserFuncs();
+
+        NPP npp = testHost.getPluginInstance();
+        char mimetype[] = "application/x-fbtestplugin";
+        char name[] = "id";
+        char value[] = "plugin";
+        char* argn[] = { name };
+        char* argv[] = { value };
+        CHECK_EQUAL(NPERR_NO_ERROR, pluginFuncs.newp(mimetype, npp, NP_EMBED, 1, argn, argv, NULL));
+
+        NPObject* obj = NULL;
+        CHECK_EQUAL(NPERR_NO_ERROR, pluginFuncs.getvalue(npp, NPPVpluginScriptableNPObject, &obj));
+        if (obj) {
+            NPVariant args[2];
+            NPVariant res;
+            INT32_TO_NPVARIANT(0, args[0]);
+            args[1] = stringVariant("recorded");
+            CHECK(funcs->invoke(npp, obj, funcs->getstringidentifier("setValue"), args, 2, &res));
+            CHECK(funcs->invoke(npp, obj, funcs->getstringidentifier("getValue"), args, 1, &res));
+            funcs->releasevariantvalue(&res);
+
+            // The plugin hands the browser's own object back
+            OBJECT_TO_NPVARIANT(testHost.window, args[1]);
+            CHECK(funcs->setproperty(npp, obj, funcs->getstringidentifier("value"), &args[1]));
+            CHECK(funcs->getproperty(npp, obj, funcs->getstringidentifier("value"), &res));
+            CHECK(NPVARIANT_IS_OBJECT(res) && NPVARIANT_TO_OBJECT(res) == testHost.window);
+            funcs->releasevariantvalue(&res);
+
+            NPVariant prop(stringVariant("property"));
+            CHECK(funcs->setproperty(npp, obj, funcs->getstringidentifier("value"), &prop));
+            CHECK(funcs->getproperty(npp, obj, funcs->getstringidentifier("value"), &res));
+            funcs->releasevariantvalue(&res);
+            CHECK(!funcs->invoke(npp, obj, funcs->getstringidentifier("noSuchMethod"), NULL, 0, &res));
+            funcs->releaseobject(obj);
+        }
+
+        // A stream the plugin didn't ask for
+        NPStream stream;
+        memset(&stream, 0, sizeof(NPStream));
+        stream.url = "http://a.example.com/data.bin";
+        stream.end = 4;
+        char streamType[] = "application/octet-stream";
+        char data[] = "abcd";
+        uint16_t stype = NP_NORMAL;
+        pluginFuncs.newstream(npp, streamType, &stream, false, &stype);
+        pluginFuncs.writeready(npp, &stream);
+        pluginFuncs.write(npp, &stream, 0, 4, data);
+        pluginFuncs.destroystream(npp, &stream, NPRES_DONE);
+
+        CHECK_EQUAL(NPERR_NO_ERROR, pluginFuncs.destroy(npp, NULL));
+        SessionCapture capture(SessionRecorder::stop());
+        NpapiPluginModule::ReleaseModule(0);
+        return capture;
+    }
+
+    SessionReport replayTestSession(const SessionCapture& capture)
+    {
+        SessionReplayer replayer(capture);
+        NpapiPluginModule* module = NpapiPluginModule::GetModule(0);
+        module->setNetscapeFuncs(replayer.getBrowserFuncs());
+        NPPluginFuncs pluginFuncs;
+        module->getPluginFuncs(&pluginFuncs);
+        SessionReport report(replayer.replay(pluginFuncs));
+        NpapiPluginModule::ReleaseModule(0);
+        return report;
+    }
+
+    size_t countRecords(const SessionCapture& capture, CaptureKind kind)
+    {
+        size_t count = 0;
+        for (std::vector<CaptureRecord>::const_iterator it = capture.records.begin(); it != capture.records.end(); ++it)
+            count += it->kind == kind ? 1 : 0;
+        return count;
+    }
+}
+
+TEST(SessionReplay_RoundTrip)
+{
+    PRINT_TESTNAME;
+
+    SessionCapture capture(recordTestSession());
+    CHECK(!SessionRecorder::isRecording());
+    CHECK_EQUAL(1u, countRecords(capture, Capture_New));
+    CHECK_EQUAL(1u, countRecords(capture, Capture_Destroy));
+    CHECK_EQUAL(3u, countRecords(capture, Capture_Invoke));
+    CHECK_EQUAL(2u, countRecords(capture, Capture_GetProperty));
+    CHECK_EQUAL(1u, countRecords(capture, Capture_NewStream));
+    CHECK(countRecords(capture, Capture_BrowserGetValue) > 0);
+    CHECK(countRecords(capture, Capture_BrowserGetProperty) > 0);
+
+    // The browser's calls were made inside of NPP_New
+    for (std::vector<CaptureRecord>::const_iterator it = capture.records.begin(); it != capture.records.end(); ++it) {
+        if (isBrowserCall(it->kind))
+            CHECK(it->depth > 0);
+    }
+
+    // Survives being written out, and a crash part way through a record
+    std::string data(capture.serialize());
+    SessionCapture parsed(SessionCapture::parse(data));
+    CHECK_EQUAL(capture.records.size(), parsed.records.size());
+    CHECK_EQUAL(capture.serialize(), parsed.serialize());
+    CHECK_EQUAL(capture.records.size() - 1, SessionCapture::parse(data.substr(0, data.size() - 1)).records.size());
+
+    SessionReport report(replayTestSession(parsed));
+    for (std::vector<std::string>::const_iterator it = report.mismatches.begin(); it != report.mismatches.end(); ++it)
+        printf("%s\n", it->c_str());
+    CHECK(report.mismatches.empty());
+    CHECK(!report.sites.empty());
+    for (std::vector<SiteTiming>::const_iterator it = report.sites.begin(); it != report.sites.end(); ++it) {
+        CHECK_EQUAL(it->recordedCalls, it->replayedCalls);
+        if (it->recordedCalls != it->replayedCalls)
+            printf("%s: recorded %u, replayed %u\n", it->site.c_str(), (unsigned)it->recordedCalls, (unsigned)it->replayedCalls);
+    }
+    CHECK(!report.toString().empty());
+}
+
+TEST(SessionReplay_Mismatches)
+{
+    PRINT_TESTNAME;
+
+    SessionCapture capture(recordTestSession());
+
+    // The plugin gets a different answer than it did; and gives one
+    for (std::vector<CaptureRecord>::iterator it = capture.records.begin(); it != capture.records.end(); ++it) {
+        if (it->kind == Capture_Invoke && it->result.type == CapturedValue::String)
+            it->result = CapturedValue(std::string("something else"));
+    }
+    SessionReport report(replayTestSession(capture));
+    CHECK_EQUAL(1u, report.mismatches.size());
+    if (!report.mismatches.empty())
+        CHECK(report.mismatches[0].find("something else") != std::string::npos);
+
+    // A capture without the browser's answers to the plugin's calls
+    std::vector<CaptureRecord> records;
+    for (std::vector<CaptureRecord>::iterator it = capture.records.begin(); it != capture.records.end(); ++it) {
+        if (it->kind != Capture_BrowserGetProperty)
+            records.push_back(*it);
+    }
+    capture.records.swap(records);
+    report = replayTestSession(capture);
+    CHECK(report.mismatches.size() > 1);
+}
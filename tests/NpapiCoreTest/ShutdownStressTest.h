@@ -0,0 +1,342 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+// Several hosts at once, each with workers marshaling calls, starting timers and dropping
+// NPObjects while the main thread pumps the browser's async call queue and tears the host down at
+// a random moment. Checks that no call that has to run is lost, none runs twice or after teardown,
+// that what every call holds is freed, and that nothing deadlocks.
+//
+// Build with WITH_RACE_TESTING for random yields and sleeps at the FB_RACE_POINTs in the library
+// as well, and with FB_SANITIZE=address or thread to have use-after-free and data races reported.
+// Set FB_STRESS_SEED to replay a run; the seed is printed either way.
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include <boost/detail/atomic_count.hpp>
+
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+#include "NPObjectAPI.h"
+#include "Timer.h"
+#include "RacePoint.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    const int stressHosts = 3;
+    const int stressWorkers = 3;
+    const int stressObjects = 8;
+    // Rounds keep starting until this much time has gone by
+    const long stressRunMs = 1500;
+    // A round that takes longer than this has deadlocked
+    const long stressRoundLimitMs = 5000;
+
+    // A small generator for each thread; rand() can't be shared
+    class StressRandom
+    {
+    public:
+        explicit StressRandom(unsigned seed) : m_state(seed * 2654435761u + 1) { }
+        unsigned next(unsigned range)
+        {
+            m_state = m_state * 1103515245u + 12345u;
+            return (m_state >> 16) % range;
+        }
+    private:
+        unsigned m_state;
+    };
+
+    unsigned stressSeed(0);
+    boost::detail::atomic_count stressPoints(0);
+
+    // Yields or sleeps now and then, to shake out unlikely interleavings
+    void stressPause(unsigned roll)
+    {
+        if (roll % 8 < 2)
+            boost::this_thread::yield();
+        else if (roll % 8 == 2)
+            boost::this_thread::sleep(boost::posix_time::microseconds(200));
+    }
+
+    void stressRaceHook(const char*)
+    {
+        stressPause((static_cast<unsigned>(++stressPoints) * 2654435761u ^ stressSeed) >> 8);
+    }
+
+    struct StressCounters : boost::noncopyable
+    {
+        StressCounters() : live(0), syncCalls(0), timersFired(0) { }
+        // What calls hold that hasn't been freed yet
+        boost::detail::atomic_count live;
+        boost::detail::atomic_count syncCalls;
+        boost::detail::atomic_count timersFired;
+    };
+    typedef boost::shared_ptr<StressCounters> StressCountersPtr;
+
+    // Stands in for whatever a marshaled call holds on to
+    struct StressPayload : boost::noncopyable
+    {
+        StressPayload(const StressCountersPtr& counters) : counters(counters) { ++counters->live; }
+        ~StressPayload() { --counters->live; }
+        StressCountersPtr counters;
+    };
+    typedef boost::shared_ptr<StressPayload> StressPayloadPtr;
+
+    struct StressHost;
+
+    // One call scheduled with ScheduleOnMainThread, and what became of it
+    struct StressCall : boost::noncopyable
+    {
+        StressCall(StressHost* owner, bool mustRun) : owner(owner), mustRun(mustRun), accepted(false), runs(0),
+            lateRuns(0) { }
+        void run(const StressPayloadPtr&);
+
+        StressHost* owner;
+        const bool mustRun;
+        // Scheduled before the host started shutting down, so the host had to take it
+        bool accepted;
+        // Only touched on the main thread
+        int runs;
+        int lateRuns;
+    };
+    typedef boost::shared_ptr<StressCall> StressCallPtr;
+
+    struct StressHost : boost::noncopyable
+    {
+        StressHost(const StressCountersPtr& counters, long shutdownAtMs, bool keepHost)
+            : testHost(NULL, NULL, NULL), counters(counters), shutdownAtMs(shutdownAtMs), keepHost(keepHost),
+            shutdownStarted(0), tornDown(false), workersDone(0)
+        {
+            module.setNetscapeFuncs(testHost.getBrowserFuncs());
+            testHost.setQueueAsyncCalls(true);
+            host.reset(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+            host->setBrowserFuncs(testHost.getBrowserFuncs());
+            host->setPageOrigin("http://example.com");
+            weakHost = host;
+            token = host->getCancellationToken();
+        }
+
+        NpapiPluginModule module;
+        NpapiHost testHost;
+        NpapiBrowserHostPtr host;
+        NpapiBrowserHostWeakPtr weakHost;
+        FB::CancellationTokenPtr token;
+        StressCountersPtr counters;
+        const long shutdownAtMs;
+        // Whether the main thread holds on to the host until the workers are done
+        const bool keepHost;
+        boost::detail::atomic_count shutdownStarted;
+        bool tornDown;
+
+        std::vector<NPObject*> objects;
+        boost::mutex callsMutex;
+        std::vector<StressCallPtr> calls;
+        std::vector<boost::shared_ptr<boost::thread> > workers;
+        boost::detail::atomic_count workersDone;
+    };
+
+    void StressCall::run(const StressPayloadPtr&)
+    {
+        ++runs;
+        if (owner->tornDown)
+            ++lateRuns;
+    }
+
+    NPClass stressObjectClass = { NP_CLASS_STRUCT_VERSION };
+
+    int stressSyncCall(const StressPayloadPtr&) { return 42; }
+
+    void stressTimerFired(const StressCountersPtr& counters) { ++counters->timersFired; }
+
+    // Returns false once the host is gone
+    bool stressOperation(StressHost* owner, StressRandom& rng, std::vector<FB::JSObjectPtr>& objects,
+        std::vector<FB::TimerPtr>& timers)
+    {
+        NpapiBrowserHostPtr host(owner->weakHost.lock());
+        if (!host)
+            return false;
+        stressPause(rng.next(1 << 16));
+        try {
+            switch (rng.next(5)) {
+            case 0: {
+                StressPayloadPtr payload(boost::make_shared<StressPayload>(owner->counters));
+                if (host->CallOnMainThread(boost::bind(&stressSyncCall, payload)) == 42)
+                    ++owner->counters->syncCalls;
+                break;
+            }
+            case 1:
+            case 2: {
+                StressCallPtr call(boost::make_shared<StressCall>(owner, rng.next(3) == 0));
+                StressPayloadPtr payload(boost::make_shared<StressPayload>(owner->counters));
+                host->ScheduleOnMainThread(call, boost::bind(&StressCall::run, call.get(), payload), call->mustRun);
+                call->accepted = owner->shutdownStarted == 0;
+                boost::mutex::scoped_lock _l(owner->callsMutex);
+                owner->calls.push_back(call);
+                break;
+            }
+            case 3: {
+                FB::TimerPtr timer(FB::Timer::getTimer(rng.next(3), false,
+                    boost::bind(&stressTimerFired, owner->counters)));
+                timer->setCancellationToken(owner->token);
+                timer->start();
+                // Some are dropped straight away, the rest at random later on
+                if (rng.next(2))
+                    timers.push_back(timer);
+                if (!timers.empty() && rng.next(2))
+                    timers.erase(timers.begin() + rng.next(static_cast<unsigned>(timers.size())));
+                break;
+            }
+            default:
+                if (!objects.empty())
+                    objects.erase(objects.begin() + rng.next(static_cast<unsigned>(objects.size())));
+                break;
+            }
+        } catch (const FB::script_error&) {
+            // Shutting down
+        }
+        return true;
+    }
+
+    typedef boost::shared_ptr<std::vector<FB::JSObjectPtr> > StressObjectListPtr;
+
+    void stressWorker(StressHost* owner, unsigned seed, StressObjectListPtr handed)
+    {
+        // Taken out of the thread's arguments so that dropping them here really releases them
+        std::vector<FB::JSObjectPtr> objects;
+        objects.swap(*handed);
+        StressRandom rng(seed);
+        std::vector<FB::TimerPtr> timers;
+        while (!owner->token->isCanceled()) {
+            if (!stressOperation(owner, rng, objects, timers))
+                break;
+        }
+        // A few more for good measure, as the host goes away
+        for (int i = 0; i < 8; ++i) {
+            if (!stressOperation(owner, rng, objects, timers))
+                break;
+        }
+        stressPause(rng.next(1 << 16));
+        ++owner->workersDone;
+    }
+
+    long stressElapsedMs(const boost::posix_time::ptime& since)
+    {
+        return static_cast<long>((boost::posix_time::microsec_clock::universal_time() - since).total_milliseconds());
+    }
+
+    // Returns false if the round deadlocked, in which case its hosts can't safely be freed
+    bool stressRound(StressRandom& rng, int round)
+    {
+        StressCountersPtr counters(boost::make_shared<StressCounters>());
+        std::vector<StressHost*> hosts;
+        for (int i = 0; i < stressHosts; ++i) {
+            StressHost* owner = new StressHost(counters, rng.next(40), rng.next(2) == 0);
+            for (int j = 0; j < stressObjects; ++j) {
+                NPObject* obj = owner->host->CreateObject(&stressObjectClass);
+                owner->objects.push_back(obj);
+            }
+            for (int j = 0; j < stressWorkers; ++j) {
+                StressObjectListPtr objects(boost::make_shared<std::vector<FB::JSObjectPtr> >());
+                for (int k = j; k < stressObjects; k += stressWorkers)
+                    objects->push_back(boost::make_shared<NPObjectAPI>(owner->objects[k], owner->host));
+                owner->workers.push_back(boost::make_shared<boost::thread>(boost::bind(&stressWorker, owner,
+                    stressSeed + round * 100 + i * 10 + j, objects)));
+            }
+            hosts.push_back(owner);
+        }
+
+        // Play the browser: run what was scheduled, and tear each host down when its time comes
+        const boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+        bool finished = false;
+        while (!finished && stressElapsedMs(start) < stressRoundLimitMs) {
+            finished = true;
+            for (size_t i = 0; i < hosts.size(); ++i) {
+                StressHost* owner = hosts[i];
+                owner->testHost.runAsyncCalls();
+                if (!owner->tornDown && stressElapsedMs(start) >= owner->shutdownAtMs) {
+                    ++owner->shutdownStarted;
+                    owner->host->shutdown();
+                    owner->tornDown = true;
+                    if (!owner->keepHost)
+                        owner->host.reset();
+                }
+                finished = finished && owner->workersDone == static_cast<long>(owner->workers.size());
+            }
+            stressPause(rng.next(1 << 16));
+        }
+        if (!finished) {
+            printf("Stress round %d with seed %u deadlocked\n", round, stressSeed);
+            return false;
+        }
+
+        for (size_t i = 0; i < hosts.size(); ++i) {
+            StressHost* owner = hosts[i];
+            for (size_t j = 0; j < owner->workers.size(); ++j)
+                owner->workers[j]->join();
+            NPNetscapeFuncs* funcs(owner->testHost.getBrowserFuncs());
+            if (owner->host) {
+                owner->host->DoDeferredRelease();
+                // Every NPObjectAPI gave back its reference
+                for (size_t j = 0; j < owner->objects.size(); ++j)
+                    CHECK_EQUAL(1u, owner->objects[j]->referenceCount);
+            }
+            // Those dropped after the host was gone have nobody left to release them
+            for (size_t j = 0; j < owner->objects.size(); ++j) {
+                while (owner->objects[j]->referenceCount > 1)
+                    funcs->releaseobject(owner->objects[j]);
+                funcs->releaseobject(owner->objects[j]);
+            }
+            owner->host.reset();
+            // The browser getting round to calls for a host that's gone
+            owner->testHost.runAsyncCalls();
+
+            for (size_t j = 0; j < owner->calls.size(); ++j) {
+                const StressCall& call(*owner->calls[j]);
+                CHECK(call.runs <= 1);
+                CHECK_EQUAL(0, call.lateRuns);
+                if (call.mustRun && call.accepted)
+                    CHECK_EQUAL(1, call.runs);
+            }
+            delete owner;
+        }
+        // Every call was made or discarded, and freed either way
+        CHECK_EQUAL(0, static_cast<long>(counters->live));
+        return true;
+    }
+}
+
+TEST(ShutdownStress)
+{
+    PRINT_TESTNAME;
+
+    const char* seedVar = getenv("FB_STRESS_SEED");
+    stressSeed = seedVar ? static_cast<unsigned>(strtoul(seedVar, NULL, 10)) : static_cast<unsigned>(time(NULL));
+    printf("Stress seed %u (set FB_STRESS_SEED to repeat it)\n", stressSeed);
+    FB::RaceTesting::setHook(&stressRaceHook);
+
+    StressRandom rng(stressSeed);
+    const boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    int rounds = 0;
+    bool deadlocked = false;
+    while (!deadlocked && (rounds < 5 || stressElapsedMs(start) < stressRunMs))
+        deadlocked = !stressRound(rng, rounds++);
+
+    CHECK(!deadlocked);
+    if (!deadlocked)
+        FB::RaceTesting::setHook(NULL);
+}
@@ -0,0 +1,186 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include "NpapiHost.h"
+#include "NpapiPluginModule.h"
+#include "NpapiBrowserHost.h"
+#include "Timer.h"
+
+using namespace FB::Npapi;
+
+namespace {
+    typedef std::vector<boost::shared_ptr<boost::thread> > WorkerList;
+
+    // A worker that sleeps on the token between bits of work
+    void tokenWorker(FB::CancellationTokenPtr token)
+    {
+        while (!token->isCanceled())
+            token->waitFor(10000);
+    }
+
+    int mainThreadCall() { return 1; }
+
+    // A worker stuck waiting for the main thread, which is busy tearing down
+    void syncCallWorker(NpapiBrowserHostPtr host)
+    {
+        try {
+            host->CallOnMainThread(boost::bind(&mainThreadCall));
+        } catch (const FB::script_error&) {
+            // Shutting down
+        }
+    }
+
+    void joinWorkers(const WorkerList& workers, size_t* joined, const boost::posix_time::ptime& deadline)
+    {
+        for (WorkerList::const_iterator it = workers.begin(); it != workers.end(); ++it) {
+            if ((*it)->timed_join(deadline))
+                ++*joined;
+        }
+    }
+
+    void slowTask(const boost::posix_time::ptime&)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(150));
+    }
+
+    struct TeardownRecorder
+    {
+        TeardownRecorder() : calls(0), fired(0) { }
+        void onCall(int value) { calls += value; }
+        void onTimer() { ++fired; }
+        void onTeardown(const FB::TeardownReport& rep) { reports.push_back(rep); }
+
+        int calls;
+        int fired;
+        std::vector<FB::TeardownReport> reports;
+    };
+}
+
+TEST(Teardown_Bounded)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+    testHost.setQueueAsyncCalls(true);
+
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    // Calls that can be dropped are only queued for a page whose origin is known
+    host->setPageOrigin("http://example.com");
+    FB::BrowserHost::setTeardownBudget(500);
+
+    TeardownRecorder rec;
+    WorkerList workers;
+    for (int i = 0; i < 4; ++i)
+        workers.push_back(boost::make_shared<boost::thread>(boost::bind(&tokenWorker, host->getCancellationToken())));
+    workers.push_back(boost::make_shared<boost::thread>(boost::bind(&syncCallWorker, host)));
+    for (int i = 0; i < 500 && testHost.getQueuedAsyncCallCount() == 0; ++i)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    CHECK_EQUAL(1u, testHost.getQueuedAsyncCallCount());
+
+    size_t joined = 0;
+    host->addTeardownTask("workers", boost::bind(&joinWorkers, boost::cref(workers), &joined, _1));
+    FB::TimerPtr timer(FB::Timer::getTimer(10000, false, boost::bind(&TeardownRecorder::onTimer, &rec)));
+    timer->setCancellationToken(host->getCancellationToken());
+    timer->start();
+
+    boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    host->shutdown();
+    long elapsed = static_cast<long>((boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds());
+
+    // Every worker noticed the token, well within the budget
+    CHECK_EQUAL(workers.size(), joined);
+    CHECK(elapsed < 500);
+    const FB::TeardownReport& report(host->getTeardownReport());
+    CHECK(report.overruns.empty());
+    CHECK_EQUAL(500, report.budgetMs);
+    CHECK(report.components.size() >= 4);
+    CHECK(report.components.front().first == "cancellation token");
+    CHECK(report.components.back().first == "async calls");
+    // The marshaled call the sync worker gave up on
+    CHECK_EQUAL(1u, report.discardedCalls);
+
+    timer.reset();
+    CHECK_EQUAL(0, rec.fired);
+    testHost.runAsyncCalls();
+}
+
+TEST(Teardown_DiscardsPendingCalls)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+    testHost.setQueueAsyncCalls(true);
+
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+    host->setPageOrigin("http://example.com");
+
+    boost::shared_ptr<TeardownRecorder> rec(boost::make_shared<TeardownRecorder>());
+    host->ScheduleOnMainThread(rec, boost::bind(&TeardownRecorder::onCall, rec.get(), 1));
+    host->ScheduleOnMainThread(rec, boost::bind(&TeardownRecorder::onCall, rec.get(), 10), true);
+    host->ScheduleOnMainThread(rec, boost::bind(&TeardownRecorder::onCall, rec.get(), 100));
+    CHECK_EQUAL(3u, testHost.getQueuedAsyncCallCount());
+
+    // Only the must-run call is made
+    host->shutdown();
+    CHECK_EQUAL(10, rec->calls);
+    CHECK_EQUAL(2u, host->getTeardownReport().discardedCalls);
+    CHECK_EQUAL(1u, host->getTeardownReport().mustRunCalls);
+
+    // and the browser getting round to them afterwards changes nothing
+    CHECK_EQUAL(3u, testHost.runAsyncCalls());
+    CHECK_EQUAL(10, rec->calls);
+}
+
+TEST(Teardown_ReportsOverruns)
+{
+    PRINT_TESTNAME;
+
+    NpapiPluginModule module;
+    NpapiHost testHost(NULL, NULL, NULL);
+    module.setNetscapeFuncs(testHost.getBrowserFuncs());
+
+    NpapiBrowserHostPtr host(new NpapiBrowserHost(&module, testHost.getPluginInstance()));
+    host->setBrowserFuncs(testHost.getBrowserFuncs());
+
+    TeardownRecorder rec;
+    FB::BrowserHost::setTeardownBudget(50);
+    FB::BrowserHost::setTeardownObserver(boost::bind(&TeardownRecorder::onTeardown, &rec, _1));
+    host->addTeardownTask("slow task", &slowTask);
+    host->shutdown();
+    FB::BrowserHost::setTeardownObserver(FB::TeardownObserver());
+    FB::BrowserHost::setTeardownBudget(500);
+
+    CHECK_EQUAL(1u, rec.reports.size());
+    if (!rec.reports.empty()) {
+        const FB::TeardownReport& report(rec.reports.front());
+        CHECK_EQUAL(50, report.budgetMs);
+        CHECK(report.elapsedMs >= 150);
+        CHECK(!report.overruns.empty());
+        if (!report.overruns.empty())
+            CHECK(report.overruns.front() == "slow task");
+    }
+}
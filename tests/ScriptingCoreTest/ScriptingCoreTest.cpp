@@ -28,6 +28,17 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "jsarray_test.h"
 #include "TypeIDMap_test.h"
 #include "jscallback_test.h"
+#include "plugin_event_map_test.h"
+#include "file_watcher_test.h"
+#include "async_file_service_test.h"
+#include "cancellation_token_test.h"
+#include "key_value_store_test.h"
+#include "result_stream_test.h"
+#include "log_filter_test.h"
+#include "shared_string_test.h"
+#include "reactor_test.h"
+#include "coordination_bus_test.h"
+#include "variant_encoding_test.h"
 
 int main()
 {
@@ -0,0 +1,203 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "AsyncFileService.h"
+#include "AsyncFileAPI.h"
+#include "SystemHelpers.h"
+
+namespace {
+    class FileOpRecorder
+    {
+    public:
+        FileOpRecorder() : writes(0), done(0), success(false) { }
+
+        void onWrite(bool ok, size_t written, const std::string&)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            if (ok)
+                ++writes;
+            cond.notify_all();
+        }
+
+        void onRead(bool ok, const boost::shared_array<uint8_t>& data, size_t size, const std::string&)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            if (ok)
+                result.assign(reinterpret_cast<const char*>(data.get()), size);
+            ++done;
+            cond.notify_all();
+        }
+
+        void onChunk(boost::uint64_t offset, const boost::shared_array<uint8_t>& data, size_t size)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            offsets.push_back(offset);
+            result.append(reinterpret_cast<const char*>(data.get()), size);
+            cond.notify_all();
+        }
+
+        void onDone(bool ok, const std::string&)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            success = ok;
+            ++done;
+            cond.notify_all();
+        }
+
+        // Waits until the member pointed to reaches count
+        bool waitFor(size_t FileOpRecorder::*counter, size_t count)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            boost::system_time until = boost::get_system_time() + boost::posix_time::seconds(5);
+            while (this->*counter < count) {
+                if (!cond.timed_wait(_l, until))
+                    return false;
+            }
+            return true;
+        }
+
+        bool waitForChunks(size_t count)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            boost::system_time until = boost::get_system_time() + boost::posix_time::seconds(5);
+            while (offsets.size() < count) {
+                if (!cond.timed_wait(_l, until))
+                    return false;
+            }
+            return true;
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        size_t writes;
+        size_t done;
+        bool success;
+        std::string result;
+        std::vector<boost::uint64_t> offsets;
+    };
+
+    boost::shared_array<uint8_t> make_buffer(const std::string& str)
+    {
+        boost::shared_array<uint8_t> buf(new uint8_t[str.size()]);
+        std::copy(str.begin(), str.end(), buf.get());
+        return buf;
+    }
+}
+
+TEST(AsyncFile_ReadWrite)
+{
+    PRINT_TESTNAME;
+
+    std::string path(FB::System::getTempPath() + "/fbasyncfile-" + boost::lexical_cast<std::string>(rand()));
+    FB::AsyncFileServicePtr service(FB::AsyncFileService::create(2));
+    FileOpRecorder rec;
+    {
+        FB::AsyncFilePtr file(FB::AsyncFile::open(path, FB::AsyncFile::OPEN_READ | FB::AsyncFile::OPEN_WRITE
+            | FB::AsyncFile::OPEN_CREATE | FB::AsyncFile::OPEN_TRUNCATE, service));
+
+        // Writes at explicit offsets land in place whatever order they run in
+        for (int i = 9; i >= 0; --i) {
+            std::string block(1000, static_cast<char>('0' + i));
+            file->write(i * 1000, make_buffer(block), block.size(), boost::bind(&FileOpRecorder::onWrite, &rec, _1, _2, _3));
+        }
+        CHECK(rec.waitFor(&FileOpRecorder::writes, 10));
+        CHECK_EQUAL(10000u, file->size());
+
+        file->read(2500, 1000, boost::bind(&FileOpRecorder::onRead, &rec, _1, _2, _3, _4));
+        CHECK(rec.waitFor(&FileOpRecorder::done, 1));
+        CHECK_EQUAL(std::string(500, '2') + std::string(500, '3'), rec.result);
+
+        // Short at the end of the file
+        file->read(9900, 1000, boost::bind(&FileOpRecorder::onRead, &rec, _1, _2, _3, _4));
+        CHECK(rec.waitFor(&FileOpRecorder::done, 2));
+        CHECK_EQUAL(std::string(100, '9'), rec.result);
+
+        // Through the scripting facade, base64 encoded
+        FB::AsyncFileAPIPtr api(boost::make_shared<FB::AsyncFileAPI>(file));
+        api->write(10000, "aGVsbG8gd29ybGQ=", FB::JSObjectPtr());
+        CHECK_THROW(api->write(0, "not base64!", FB::JSObjectPtr()), FB::invalid_arguments);
+    }
+    // The file, and then the service, go away once the last operation is done with them
+    FB::AsyncFileServiceWeakPtr weakService(service);
+    service.reset();
+    for (int i = 0; i < 500 && !weakService.expired(); ++i)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    CHECK(weakService.expired());
+
+    FB::AsyncFilePtr file(FB::AsyncFile::open(path, FB::AsyncFile::OPEN_READ));
+    CHECK_EQUAL(10011u, file->size());
+    rec.done = 0;
+    file->read(10000, 100, boost::bind(&FileOpRecorder::onRead, &rec, _1, _2, _3, _4));
+    CHECK(rec.waitFor(&FileOpRecorder::done, 1));
+    CHECK_EQUAL(std::string("hello world"), rec.result);
+    file.reset();
+
+    CHECK_THROW(FB::AsyncFile::open(path + ".missing", FB::AsyncFile::OPEN_READ), std::runtime_error);
+    remove(path.c_str());
+}
+
+TEST(AsyncFileReader_Credits)
+{
+    PRINT_TESTNAME;
+
+    std::string path(FB::System::getTempPath() + "/fbasyncreader-" + boost::lexical_cast<std::string>(rand()));
+    std::string content;
+    for (int i = 0; i < 100000; ++i)
+        content += static_cast<char>('a' + i % 26);
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(content.data(), 1, content.size(), f);
+    fclose(f);
+
+    FileOpRecorder rec;
+    FB::AsyncFilePtr file(FB::AsyncFile::open(path, FB::AsyncFile::OPEN_READ, FB::AsyncFileService::create(3)));
+    FB::AsyncFileReaderPtr reader(FB::AsyncFileReader::create(file, 10, 1000000, 4096, 3,
+        boost::bind(&FileOpRecorder::onChunk, &rec, _1, _2, _3), boost::bind(&FileOpRecorder::onDone, &rec, _1, _2)));
+
+    // Nothing is handed over without credit
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    CHECK_EQUAL(0u, rec.offsets.size());
+
+    reader->grant(2);
+    CHECK(rec.waitForChunks(2));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    CHECK_EQUAL(2u, rec.offsets.size());
+    CHECK_EQUAL(0u, reader->getCredits());
+    CHECK_EQUAL(10u + 2 * 4096, reader->getPosition());
+
+    reader->grant(1000);
+    CHECK(rec.waitFor(&FileOpRecorder::done, 1));
+    CHECK(rec.success);
+    CHECK(reader->isFinished());
+    CHECK_EQUAL(25u, rec.offsets.size());
+    for (size_t i = 0; i < rec.offsets.size(); ++i)
+        CHECK_EQUAL(10u + i * 4096, rec.offsets[i]);
+    CHECK(content.substr(10) == rec.result);
+
+    // Canceled readers go quiet
+    FileOpRecorder rec2;
+    reader = FB::AsyncFileReader::create(file, 0, 1000000, 4096, 3,
+        boost::bind(&FileOpRecorder::onChunk, &rec2, _1, _2, _3), boost::bind(&FileOpRecorder::onDone, &rec2, _1, _2));
+    reader->cancel();
+    reader->grant(100);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    CHECK_EQUAL(0u, rec2.offsets.size());
+    CHECK_EQUAL(0u, rec2.done);
+
+    remove(path.c_str());
+}
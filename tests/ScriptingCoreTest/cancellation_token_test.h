@@ -0,0 +1,59 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "CancellationToken.h"
+
+namespace {
+    void countCancel(int* count)
+    {
+        ++*count;
+    }
+
+    void cancelLater(FB::CancellationTokenPtr token)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+        token->cancel();
+    }
+}
+
+TEST(CancellationToken_Basic)
+{
+    PRINT_TESTNAME;
+
+    FB::CancellationTokenPtr token(boost::make_shared<FB::CancellationToken>());
+    int first = 0, second = 0, late = 0;
+    token->onCancel(boost::bind(&countCancel, &first));
+    int id = token->onCancel(boost::bind(&countCancel, &second));
+    token->unregister(id);
+    CHECK(!token->isCanceled());
+    CHECK(!token->waitFor(10));
+    token->throwIfCanceled();
+
+    // A waiter wakes up as soon as the token is canceled
+    boost::thread canceler(boost::bind(&cancelLater, token));
+    CHECK(token->waitFor(5000));
+    canceler.join();
+    CHECK(token->isCanceled());
+    CHECK_EQUAL(1, first);
+    CHECK_EQUAL(0, second);
+    CHECK_THROW(token->throwIfCanceled(), FB::script_error);
+
+    // Callbacks registered afterwards run right away, and only the first cancel() counts
+    CHECK_EQUAL(0, token->onCancel(boost::bind(&countCancel, &late)));
+    CHECK_EQUAL(1, late);
+    token->cancel();
+    CHECK_EQUAL(1, first);
+}
@@ -0,0 +1,431 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#ifdef FB_X11
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "CoordinationBus.h"
+
+namespace {
+    std::string makeBusId(const std::string& name)
+    {
+        return "fbtest-" + name + "-" + boost::lexical_cast<std::string>(getpid()) + "-"
+            + boost::lexical_cast<std::string>(rand());
+    }
+
+    class BusRecorder
+    {
+    public:
+        BusRecorder() : blocked(false) { }
+
+        void message(const FB::CoordinationBus::Message& msg)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            messages.push_back(msg);
+            cond.notify_all();
+            while (blocked)
+                cond.wait(_l);
+        }
+
+        void release()
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            blocked = false;
+            cond.notify_all();
+        }
+
+        bool waitForMessages(size_t count)
+        {
+            const boost::system_time until(boost::get_system_time() + boost::posix_time::seconds(10));
+            boost::mutex::scoped_lock _l(mutex);
+            while (messages.size() < count) {
+                if (!cond.timed_wait(_l, until))
+                    return false;
+            }
+            return true;
+        }
+
+        size_t count()
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return messages.size();
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        std::vector<FB::CoordinationBus::Message> messages;
+        bool blocked;
+    };
+
+    // Whether child exited with 0; one that takes more than ten seconds is killed
+    bool reapWorker(pid_t child)
+    {
+        for (int i = 0; i < 1000; ++i) {
+            int status = 0;
+            if (waitpid(child, &status, WNOHANG) == child)
+                return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        }
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        return false;
+    }
+
+    // Announces the election, then exits while still leading, as if the process had crashed
+    void leadThenCrash(FB::CoordinationBusPtr bus)
+    {
+        bus->publish("leader", "elected");
+        boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+        bus->publish("leader", "leaving");
+        _exit(0);
+    }
+
+    void announce(FB::CoordinationBusPtr bus, const std::string& topic, const std::string& data)
+    {
+        bus->publish(topic, data);
+    }
+
+    std::string buildSegment(FB::CoordinationBusPtr bus)
+    {
+        bus->publish("built", "");
+        // Long enough for the other workers to come asking for it meanwhile
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        return std::string(256 * 1024, 'x') + "end";
+    }
+
+    std::string leftBehind()
+    {
+        return "behind";
+    }
+
+    std::string failToBuild()
+    {
+        throw std::runtime_error("can't build that");
+    }
+}
+
+TEST(CoordinationBus_Messages)
+{
+    PRINT_TESTNAME;
+
+    CHECK(FB::CoordinationBus::isSupported());
+    const std::string id(makeBusId("messages"));
+    FB::CoordinationBus::Options options;
+    options.ringSlots = 1024;
+    FB::CoordinationBusPtr bus(FB::CoordinationBus::open(id, options));
+    CHECK(FB::CoordinationBus::open(id) == bus);
+    CHECK(bus->getPeers().empty());
+
+    BusRecorder rec;
+    bus->subscribe("count", boost::bind(&BusRecorder::message, &rec, _1));
+    CHECK_THROW(bus->publish("count", std::string(2000, 'x')), std::invalid_argument);
+    // Not delivered back to this process
+    bus->publish("count", "self");
+
+    pid_t children[3];
+    for (int c = 0; c < 3; ++c) {
+        children[c] = fork();
+        if (!children[c]) {
+            FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id, options));
+            for (int i = 0; i < 100; ++i) {
+                worker->publish("noise", "");
+                worker->publish("count", boost::lexical_cast<std::string>(i));
+            }
+            _exit(0);
+        }
+    }
+    for (int c = 0; c < 3; ++c)
+        CHECK(reapWorker(children[c]));
+
+    // Everything on the topic, in order from each sender
+    CHECK(rec.waitForMessages(300));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    CHECK_EQUAL(300u, rec.count());
+    std::map<int, int> next;
+    for (size_t i = 0; i < rec.messages.size(); ++i) {
+        CHECK_EQUAL(std::string("count"), rec.messages[i].topic);
+        CHECK_EQUAL(boost::lexical_cast<std::string>(next[rec.messages[i].sender]++), rec.messages[i].data);
+    }
+    CHECK_EQUAL(3u, next.size());
+    CHECK_EQUAL(0u, bus->getDroppedCount());
+    bus->close();
+}
+
+TEST(CoordinationBus_Overflow)
+{
+    PRINT_TESTNAME;
+
+    const std::string id(makeBusId("overflow"));
+    FB::CoordinationBus::Options options;
+    options.ringSlots = 16;
+    FB::CoordinationBusPtr bus(FB::CoordinationBus::open(id, options));
+
+    // Stuck in the first callback while the worker publishes the rest
+    BusRecorder rec;
+    rec.blocked = true;
+    bus->subscribe(std::string(), boost::bind(&BusRecorder::message, &rec, _1));
+    pid_t child = fork();
+    if (!child) {
+        FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id));
+        for (int i = 0; i < 100; ++i)
+            worker->publish("n", boost::lexical_cast<std::string>(i));
+        _exit(0);
+    }
+    CHECK(reapWorker(child));
+    CHECK(rec.waitForMessages(1));
+    rec.release();
+
+    // The oldest were lost, and counted
+    for (int i = 0; i < 500 && rec.count() + bus->getDroppedCount() < 100; ++i)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    CHECK_EQUAL(100u, rec.count() + bus->getDroppedCount());
+    CHECK(bus->getDroppedCount() >= 100 - 16 - 1);
+    CHECK(!rec.messages.empty() && rec.messages.back().data == "99");
+    bus->close();
+}
+
+TEST(CoordinationBus_Leadership)
+{
+    PRINT_TESTNAME;
+
+    const std::string id(makeBusId("leader"));
+    FB::CoordinationBus::Options options;
+    options.pollInterval = 20;
+    FB::CoordinationBusPtr bus(FB::CoordinationBus::open(id, options));
+    BusRecorder rec;
+    bus->subscribe("leader", boost::bind(&BusRecorder::message, &rec, _1));
+
+    CHECK(bus->tryLead("handoff"));
+    CHECK(bus->tryLead("handoff"));
+    CHECK(bus->isLeader("handoff"));
+    CHECK_EQUAL(getpid(), bus->getLeader("handoff"));
+    CHECK_EQUAL(0, bus->getLeader("nobody"));
+
+    // Resigning hands over straight away, without waiting for the poll
+    pid_t candidate = fork();
+    if (!candidate) {
+        FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id));
+        worker->campaign("handoff", boost::bind(&announce, worker, "leader", "took over"));
+        boost::this_thread::sleep(boost::posix_time::seconds(10));
+        _exit(1);
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+    CHECK_EQUAL(0u, rec.count());
+    bus->resign("handoff");
+    CHECK(!bus->isLeader("handoff"));
+    CHECK(rec.waitForMessages(1) && rec.messages[0].sender == candidate);
+    CHECK_EQUAL(candidate, bus->getLeader("handoff"));
+    CHECK(!bus->tryLead("handoff"));
+    kill(candidate, SIGKILL);
+    waitpid(candidate, NULL, 0);
+
+    // One leader at a time, each taking over once the last one dies
+    pid_t children[4];
+    for (int c = 0; c < 4; ++c) {
+        children[c] = fork();
+        if (!children[c]) {
+            FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id));
+            worker->campaign("poller", boost::bind(&leadThenCrash, worker));
+            boost::this_thread::sleep(boost::posix_time::seconds(10));
+            _exit(1);
+        }
+    }
+    for (int c = 0; c < 4; ++c)
+        CHECK(reapWorker(children[c]));
+    CHECK(rec.waitForMessages(9));
+    std::set<int> leaders;
+    for (size_t i = 1; i + 1 < rec.messages.size(); i += 2) {
+        CHECK_EQUAL(std::string("elected"), rec.messages[i].data);
+        CHECK_EQUAL(std::string("leaving"), rec.messages[i + 1].data);
+        CHECK_EQUAL(rec.messages[i].sender, rec.messages[i + 1].sender);
+        leaders.insert(rec.messages[i].sender);
+    }
+    CHECK_EQUAL(4u, leaders.size());
+    CHECK_EQUAL(0, bus->getLeader("poller"));
+    bus->close();
+}
+
+TEST(CoordinationBus_Segments)
+{
+    PRINT_TESTNAME;
+
+    const std::string id(makeBusId("segments"));
+    FB::CoordinationBusPtr bus(FB::CoordinationBus::open(id));
+    BusRecorder rec;
+    bus->subscribe("built", boost::bind(&BusRecorder::message, &rec, _1));
+
+    // Only one of the workers builds it; the rest wait for that one
+    pid_t children[4];
+    for (int c = 0; c < 4; ++c) {
+        children[c] = fork();
+        if (!children[c]) {
+            FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id));
+            FB::SharedSegmentConstPtr seg(worker->getOrCreateSegment("cache", boost::bind(&buildSegment, worker)));
+            bool ok = seg->size() == 256 * 1024 + 3 && std::string(seg->data() + seg->size() - 3, 3) == "end";
+            _exit(ok ? 0 : 1);
+        }
+    }
+    for (int c = 0; c < 4; ++c)
+        CHECK(reapWorker(children[c]));
+    CHECK(rec.waitForMessages(1));
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    CHECK_EQUAL(1u, rec.count());
+
+    FB::SharedSegmentConstPtr seg(bus->getOrCreateSegment("cache", &failToBuild));
+    CHECK_EQUAL(256u * 1024 + 3, seg->size());
+    CHECK(bus->getSegment("cache"));
+    CHECK(!bus->getSegment("missing"));
+    CHECK_THROW(bus->getOrCreateSegment("broken", &failToBuild), std::runtime_error);
+    CHECK(!bus->getSegment("broken"));
+    CHECK_THROW(bus->getSegment(std::string(100, 'x')), std::invalid_argument);
+
+    // Still readable here after it's removed
+    CHECK(bus->removeSegment("cache"));
+    CHECK(!bus->removeSegment("cache"));
+    CHECK(!bus->getSegment("cache"));
+    CHECK_EQUAL(std::string("end"), seg->str().substr(seg->size() - 3));
+    bus->close();
+}
+
+TEST(CoordinationBus_DeadPeers)
+{
+    PRINT_TESTNAME;
+
+    const std::string id(makeBusId("dead"));
+    FB::CoordinationBusPtr bus(FB::CoordinationBus::open(id));
+    BusRecorder rec;
+    bus->subscribe("ready", boost::bind(&BusRecorder::message, &rec, _1));
+
+    pid_t child = fork();
+    if (!child) {
+        FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id));
+        worker->tryLead("crashy");
+        worker->getOrCreateSegment("left", &leftBehind);
+        worker->publish("ready", "");
+        boost::this_thread::sleep(boost::posix_time::seconds(10));
+        _exit(1);
+    }
+    CHECK(rec.waitForMessages(1));
+    CHECK_EQUAL(1u, bus->getPeers().size());
+    CHECK_EQUAL(child, bus->getPeers().front());
+    CHECK_EQUAL(child, bus->getLeader("crashy"));
+    CHECK(!bus->tryLead("crashy"));
+
+    // Killed without closing: its membership and roles go with it
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    CHECK(bus->getPeers().empty());
+    CHECK_EQUAL(0, bus->getLeader("crashy"));
+    CHECK(bus->tryLead("crashy"));
+    CHECK_EQUAL(std::string("behind"), bus->getSegment("left")->str());
+
+    // The last process out takes the segments with it
+    bus->close();
+    bus.reset();
+    bus = FB::CoordinationBus::open(id);
+    CHECK(!bus->getSegment("left"));
+    bus->close();
+    bus.reset();
+
+    // As does the next one in, when everyone before it died
+    child = fork();
+    if (!child) {
+        FB::CoordinationBusPtr worker(FB::CoordinationBus::open(id));
+        worker->getOrCreateSegment("left", &leftBehind);
+        kill(getpid(), SIGKILL);
+    }
+    waitpid(child, NULL, 0);
+    bus = FB::CoordinationBus::open(id);
+    CHECK(bus->getPeers().empty());
+    CHECK(!bus->getSegment("left"));
+    bus->close();
+}
+
+TEST(CoordinationBus_ReopenAfterClose)
+{
+    PRINT_TESTNAME;
+
+    const std::string id(makeBusId("reopen"));
+    FB::CoordinationBusPtr first(FB::CoordinationBus::open(id));
+    CHECK(FB::CoordinationBus::open(id) == first);
+
+    // Whoever still holds the closed bus keeps it, but opening the id again joins afresh
+    first->close();
+    FB::CoordinationBusPtr second(FB::CoordinationBus::open(id));
+    CHECK(second != first);
+    CHECK(second->tryLead("again"));
+    second->publish("after", "close");
+    CHECK_THROW(first->publish("after", "close"), std::runtime_error);
+    CHECK(FB::CoordinationBus::open(id) == second);
+    second->close();
+}
+
+TEST(CoordinationBus_ForkedChildOutlivesParent)
+{
+    PRINT_TESTNAME;
+
+    const std::string id(makeBusId("orphan"));
+    FB::CoordinationBusPtr bus(FB::CoordinationBus::open(id));
+    BusRecorder rec;
+    bus->subscribe("ready", boost::bind(&BusRecorder::message, &rec, _1));
+
+    // The worker leads, forks a child that never touches the bus, and dies; the child inherited the
+    // worker's descriptors, but not its place on the bus
+    int pipes[2];
+    CHECK_EQUAL(0, pipe(pipes));
+    pid_t worker = fork();
+    if (!worker) {
+        FB::CoordinationBusPtr mine(FB::CoordinationBus::open(id));
+        bool ok = mine->tryLead("orphaned");
+        pid_t child = fork();
+        if (!child) {
+            boost::this_thread::sleep(boost::posix_time::seconds(10));
+            _exit(0);
+        }
+        ok = ok && write(pipes[1], &child, sizeof(child)) == sizeof(child);
+        mine->publish("ready", "");
+        boost::this_thread::sleep(boost::posix_time::seconds(10));
+        _exit(ok ? 0 : 1);
+    }
+    ::close(pipes[1]);
+    pid_t orphan = 0;
+    CHECK_EQUAL(static_cast<ssize_t>(sizeof(orphan)), read(pipes[0], &orphan, sizeof(orphan)));
+    ::close(pipes[0]);
+    CHECK(rec.waitForMessages(1));
+    CHECK_EQUAL(worker, bus->getLeader("orphaned"));
+
+    kill(worker, SIGKILL);
+    waitpid(worker, NULL, 0);
+    CHECK(bus->getPeers().empty());
+    CHECK_EQUAL(0, bus->getLeader("orphaned"));
+    CHECK(bus->tryLead("orphaned"));
+
+    if (orphan > 0) {
+        kill(orphan, SIGKILL);
+        // Not our child; it's reparented, so just make sure it's gone
+        for (int i = 0; i < 100 && kill(orphan, 0) == 0; ++i)
+            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    bus->close();
+}
+#endif
@@ -0,0 +1,172 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#ifdef FB_X11
+
+#include <cstdio>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "FileWatcher.h"
+#include "SystemHelpers.h"
+
+namespace {
+    class WatchRecorder
+    {
+    public:
+        WatchRecorder() : blocked(false) { }
+
+        void onChanges(const FB::FileWatcher::ChangeSet& changes)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            batches.push_back(changes);
+            cond.notify_all();
+            while (blocked)
+                cond.wait(_l);
+        }
+
+        // Waits until some batch has path with all of kinds; returns the number of batches seen
+        size_t waitFor(const std::string& path, int kinds, long timeoutMs = 3000)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            boost::system_time until = boost::get_system_time() + boost::posix_time::milliseconds(timeoutMs);
+            while (!seen(path, kinds)) {
+                if (!cond.timed_wait(_l, until))
+                    return 0;
+            }
+            return batches.size();
+        }
+
+        void setBlocked(bool val)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            blocked = val;
+            cond.notify_all();
+        }
+
+        void clear()
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            batches.clear();
+        }
+
+        size_t batchCount()
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            return batches.size();
+        }
+
+    private:
+        bool seen(const std::string& path, int kinds) const
+        {
+            int found = 0;
+            for (size_t i = 0; i < batches.size(); ++i) {
+                FB::FileWatcher::ChangeSet::const_iterator it = batches[i].find(path);
+                if (it != batches[i].end())
+                    found |= it->second;
+            }
+            return (found & kinds) == kinds;
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        std::vector<FB::FileWatcher::ChangeSet> batches;
+        bool blocked;
+    };
+
+    void writeFile(const std::string& path, const std::string& data, const char* mode = "a")
+    {
+        FILE* f = fopen(path.c_str(), mode);
+        if (f) {
+            fputs(data.c_str(), f);
+            fclose(f);
+        }
+    }
+}
+
+TEST(FileWatcher_CoalescesChurn)
+{
+    PRINT_TESTNAME;
+
+    CHECK(FB::FileWatcher::isSupported());
+    std::string root(FB::System::getTempPath() + "/fbwatch-" + boost::lexical_cast<std::string>(getpid()));
+    mkdir(root.c_str(), 0700);
+    mkdir((root + "/sub").c_str(), 0700);
+
+    WatchRecorder rec;
+    FB::FileWatcherPtr watcher(FB::FileWatcher::create(boost::bind(&WatchRecorder::onChanges, &rec, _1),
+        FB::BrowserHostPtr(), 50));
+    watcher->watch(root + "/");
+    CHECK_EQUAL(2u, watcher->getWatchCount());
+
+    // A burst of writes to one file is one change
+    for (int i = 0; i < 200; ++i)
+        writeFile(root + "/sub/a.txt", "x");
+    CHECK(rec.waitFor(root + "/sub/a.txt", FB::FileWatcher::CHANGE_CREATED | FB::FileWatcher::CHANGE_MODIFIED));
+    CHECK(rec.batchCount() <= 2);
+
+    // Files created in a new directory before its watch is in place still show up
+    mkdir((root + "/new").c_str(), 0700);
+    writeFile(root + "/new/b.txt", "y");
+    CHECK(rec.waitFor(root + "/new/b.txt", FB::FileWatcher::CHANGE_CREATED));
+    CHECK_EQUAL(3u, watcher->getWatchCount());
+    writeFile(root + "/new/c.txt", "z");
+    CHECK(rec.waitFor(root + "/new/c.txt", FB::FileWatcher::CHANGE_CREATED));
+
+    unlink((root + "/sub/a.txt").c_str());
+    CHECK(rec.waitFor(root + "/sub/a.txt", FB::FileWatcher::CHANGE_REMOVED));
+
+    // Overflowing the kernel queue while the callback is stuck gets the root reported for a rescan
+    long maxQueued = 0;
+    if (FILE* f = fopen("/proc/sys/fs/inotify/max_queued_events", "r")) {
+        if (fscanf(f, "%ld", &maxQueued) != 1)
+            maxQueued = 0;
+        fclose(f);
+    }
+    if (maxQueued > 0 && maxQueued <= 65536) {
+        rec.setBlocked(true);
+        writeFile(root + "/trigger", "t");
+        CHECK(rec.waitFor(root + "/trigger", FB::FileWatcher::CHANGE_CREATED));
+        for (long i = 0; i <= maxQueued; ++i)
+            writeFile(root + "/sub/a.txt", "x");
+        rec.setBlocked(false);
+        CHECK(rec.waitFor(root, FB::FileWatcher::CHANGE_RESCAN, 10000));
+        CHECK_EQUAL(3u, watcher->getWatchCount());
+    }
+
+    // Nothing more after unwatch
+    CHECK(watcher->unwatch(root));
+    CHECK_EQUAL(0u, watcher->getWatchCount());
+    rec.clear();
+    writeFile(root + "/late.txt", "l");
+    boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+    CHECK_EQUAL(0u, rec.batchCount());
+
+    watcher->stop();
+    watcher.reset();
+    unlink((root + "/sub/a.txt").c_str());
+    unlink((root + "/new/b.txt").c_str());
+    unlink((root + "/new/c.txt").c_str());
+    unlink((root + "/trigger").c_str());
+    unlink((root + "/late.txt").c_str());
+    rmdir((root + "/sub").c_str());
+    rmdir((root + "/new").c_str());
+    rmdir(root.c_str());
+}
+
+#endif
+
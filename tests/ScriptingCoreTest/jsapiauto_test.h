@@ -16,11 +16,14 @@ Copyright 2009 Georg Fritzsche, Firebreath development team
 #include <sstream>
 #include <numeric>
 #include <boost/assign.hpp>
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
 #include "TestJSAPIAuto.h"
 #include "fake_jsarray.h"
 #include "variant_list.h"
+#include "variant_encoding.h"
 
 namespace helper
 {
@@ -238,3 +241,235 @@ TEST(JSAPIAuto_Methods)
     }
 }
 
+
+namespace {
+    // Runs a batch written as JSON and reads the results back the way a page would
+    FB::VariantList runBatch(const FB::JSAPIPtr& api, const std::string& ops, bool stopOnError = false)
+    {
+        FB::variant res(api->Invoke("invokeBatch", FB::variant_list_of(ops)(stopOnError)));
+        return FB::decodeJSON(res.convert_cast<std::string>()).convert_cast<FB::VariantList>();
+    }
+}
+
+TEST(JSAPIAuto_InvokeBatch)
+{
+    PRINT_TESTNAME;
+
+    FB::JSAPIPtr test(new TestObjectJSAPIAuto());
+    CHECK(test->HasMethod("invokeBatch"));
+
+    const std::string ops("[\"sumOf\",2,2,3, \"message\",1,\"batched\", \"message\",0,"
+        " \"noSuchMethod\",2,1,2, \"returnString\",1,\"after error\"]");
+
+    {
+        // A success flag and a result for each operation, as one JSON string
+        FB::variant json(test->Invoke("invokeBatch", FB::variant_list_of(ops)));
+        CHECK(json.is_of_type<std::string>());
+        FB::VariantList res = runBatch(test, ops);
+        CHECK_EQUAL(10u, res.size());
+        if (res.size() != 10u)
+            return;
+        CHECK(res[0].convert_cast<bool>());
+        CHECK_EQUAL(5, res[1].convert_cast<int>());
+        CHECK(res[2].convert_cast<bool>());
+        CHECK(res[3].is_null());
+        CHECK_EQUAL("batched", res[5].convert_cast<std::string>());
+        CHECK(!res[6].convert_cast<bool>());
+        CHECK(!res[7].convert_cast<std::string>().empty());
+        CHECK(res[8].convert_cast<bool>());
+        CHECK_EQUAL("after error", res[9].convert_cast<std::string>());
+    }
+
+    {
+        // Stops at the first error
+        FB::VariantList res = runBatch(test, ops, true);
+        CHECK_EQUAL(8u, res.size());
+        if (res.size() == 8u)
+            CHECK(!res[6].convert_cast<bool>());
+    }
+
+    {
+        // Bad arguments are reported per operation
+        FB::VariantList res = runBatch(test,
+            "[\"sumOf\",2,\"x\",3, \"message\",2,\"a\",\"b\", \"readOnlyMessage\",0]");
+        CHECK_EQUAL(6u, res.size());
+        if (res.size() == 6u) {
+            CHECK(!res[0].convert_cast<bool>());
+            CHECK(!res[2].convert_cast<bool>());
+            CHECK(res[4].convert_cast<bool>());
+        }
+    }
+
+    {
+        // but a bad argument count leaves nowhere to go on from
+        const char* counts[] = {
+            "[\"sumOf\",5,1,2,\"readOnlyMessage\",0]",
+            "[\"sumOf\",-1,\"readOnlyMessage\",0]",
+            "[\"sumOf\",\"two\",1,2]",
+            "[\"readOnlyMessage\"]"
+        };
+        for (size_t i = 0; i < 4; ++i) {
+            FB::VariantList res = runBatch(test, counts[i]);
+            CHECK_EQUAL(2u, res.size());
+            if (!res.empty())
+                CHECK(!res[0].convert_cast<bool>());
+        }
+    }
+
+    // and so does anything that isn't a JSON array
+    CHECK_THROW(test->Invoke("invokeBatch", FB::variant_list_of("[\"sumOf\",2,1")), FB::invalid_arguments);
+    CHECK_THROW(test->Invoke("invokeBatch", FB::variant_list_of("{\"sumOf\":2}")), FB::invalid_arguments);
+}
+
+namespace helper
+{
+    class CachedPropertyAPI : public FB::JSAPIAuto
+    {
+    public:
+        CachedPropertyAPI() : reads(0), status("idle"), racyReads(0), gateEntered(false), gateOpen(false)
+        {
+            registerCachedProperty("status", make_property(this, &CachedPropertyAPI::get_status,
+                &CachedPropertyAPI::set_status));
+            registerCachedProperty("ticks", make_property(this, &CachedPropertyAPI::get_ticks), 20);
+            registerCachedProperty("racy", make_property(this, &CachedPropertyAPI::get_racy));
+            registerCachedProperty("gate", make_property(this, &CachedPropertyAPI::get_gate));
+            registerProperty("uncached", make_property(this, &CachedPropertyAPI::get_ticks));
+            {
+                FB::scoped_zonelock _l(this, FB::SecurityScope_Private);
+                registerCachedProperty("secret", make_property(this, &CachedPropertyAPI::get_status));
+            }
+        }
+
+        FB::VariantMap get_status() { ++reads; FB::VariantMap m; m["state"] = status; return m; }
+        void set_status(const std::string& val) { status = val; }
+        int get_ticks() { return ++reads; }
+        // As if the value changed while the first read was still working it out
+        int get_racy()
+        {
+            if (++racyReads == 1)
+                invalidateProperty("racy");
+            return racyReads;
+        }
+        // Waits for openGate, which only another thread can call
+        bool get_gate()
+        {
+            boost::mutex::scoped_lock _l(gateMutex);
+            gateEntered = true;
+            gateCond.notify_all();
+            const boost::system_time until(boost::get_system_time() + boost::posix_time::seconds(5));
+            while (!gateOpen)
+                if (!gateCond.timed_wait(_l, until)) return gateOpen;
+            return true;
+        }
+        bool waitForGate()
+        {
+            boost::mutex::scoped_lock _l(gateMutex);
+            const boost::system_time until(boost::get_system_time() + boost::posix_time::seconds(5));
+            while (!gateEntered)
+                if (!gateCond.timed_wait(_l, until)) return gateEntered;
+            return true;
+        }
+        void openGate()
+        {
+            boost::mutex::scoped_lock _l(gateMutex);
+            gateOpen = true;
+            gateCond.notify_all();
+        }
+
+        int reads;
+        std::string status;
+        int racyReads;
+        boost::mutex gateMutex;
+        boost::condition_variable gateCond;
+        bool gateEntered;
+        bool gateOpen;
+    };
+
+    void readGate(const boost::shared_ptr<CachedPropertyAPI>& api, bool* result)
+    {
+        *result = api->GetProperty("gate").convert_cast<bool>();
+    }
+
+    struct CountingConverter
+    {
+        CountingConverter(int& calls) : calls(calls) {}
+        typedef FB::variant result_type;
+        FB::variant operator()(const FB::variant& val) const
+        {
+            ++calls;
+            return val.cast<FB::VariantMap>()["state"].convert_cast<std::string>();
+        }
+        int& calls;
+    };
+}
+
+TEST(JSAPIAuto_CachedProperty)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<helper::CachedPropertyAPI> test(boost::make_shared<helper::CachedPropertyAPI>());
+    int conversions = 0;
+    helper::CountingConverter convert(conversions);
+    FB::BrowserHostPtr host;
+
+    // Hits skip both the getter and the host's conversion
+    CHECK_EQUAL("idle", test->GetPropertyForHost("status", host, convert).convert_cast<std::string>());
+    CHECK_EQUAL("idle", test->GetPropertyForHost("status", host, convert).convert_cast<std::string>());
+    CHECK_EQUAL("idle", test->GetProperty("status").cast<FB::VariantMap>()["state"].convert_cast<std::string>());
+    CHECK_EQUAL(1, test->reads);
+    CHECK_EQUAL(1, conversions);
+
+    // Explicit invalidation
+    test->status = "busy";
+    CHECK_EQUAL("idle", test->GetPropertyForHost("status", host, convert).convert_cast<std::string>());
+    test->invalidateProperty("status");
+    CHECK_EQUAL("busy", test->GetPropertyForHost("status", host, convert).convert_cast<std::string>());
+    CHECK_EQUAL(2, test->reads);
+    CHECK_EQUAL(2, conversions);
+
+    // Setting the property invalidates it
+    test->SetProperty("status", "done");
+    CHECK_EQUAL("done", test->GetPropertyForHost("status", host, convert).convert_cast<std::string>());
+    CHECK_EQUAL(3, test->reads);
+
+    // Expiry
+    test->reads = 0;
+    CHECK_EQUAL(1, test->GetProperty("ticks").convert_cast<int>());
+    CHECK_EQUAL(1, test->GetProperty("ticks").convert_cast<int>());
+    boost::this_thread::sleep(boost::posix_time::milliseconds(40));
+    CHECK_EQUAL(2, test->GetProperty("ticks").convert_cast<int>());
+
+    // Uncached properties and the default implementation just call the getter
+    CHECK_EQUAL(3, test->GetPropertyForHost("uncached", host, convert).convert_cast<int>());
+    CHECK_EQUAL(4, test->GetProperty("uncached").convert_cast<int>());
+
+    // Zones still apply
+    conversions = 0;
+    CHECK(test->GetPropertyForHost("secret", host, convert).is_of_type<FB::FBVoid>());
+    CHECK_EQUAL(0, conversions);
+    {
+        FB::scoped_zonelock _l(test, FB::SecurityScope_Private);
+        CHECK_EQUAL("done", test->GetPropertyForHost("secret", host, convert).convert_cast<std::string>());
+    }
+
+    // A value that changed while the getter ran isn't kept
+    CHECK_EQUAL(1, test->GetProperty("racy").convert_cast<int>());
+    CHECK_EQUAL(2, test->GetProperty("racy").convert_cast<int>());
+    CHECK_EQUAL(2, test->GetProperty("racy").convert_cast<int>());
+
+    // Getters run without the object locked, so other threads can use it meanwhile
+    bool gateResult = false;
+    boost::thread reader(boost::bind(&helper::readGate, test, &gateResult));
+    CHECK(test->waitForGate());
+    CHECK_EQUAL("done", test->GetPropertyForHost("status", host, convert).convert_cast<std::string>());
+    test->openGate();
+    reader.join();
+    CHECK(gateResult);
+
+    // Registering it again uncached drops the cache
+    test->registerProperty("status", FB::make_property(test.get(), &helper::CachedPropertyAPI::get_status));
+    test->reads = 0;
+    test->GetProperty("status");
+    test->GetProperty("status");
+    CHECK_EQUAL(2, test->reads);
+}
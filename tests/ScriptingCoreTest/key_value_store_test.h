@@ -0,0 +1,260 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include "KeyValueStore.h"
+#include "KeyValueStoreAPI.h"
+#include "SystemHelpers.h"
+#ifndef FB_WIN
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+namespace {
+    std::string makeStoreDir(const std::string& name)
+    {
+        return FB::System::getTempPath() + "/fbkv-" + name + "-" + boost::lexical_cast<std::string>(rand());
+    }
+
+    void removeStoreDir(const std::string& dir)
+    {
+        remove((dir + "/snapshot").c_str());
+        remove((dir + "/snapshot.tmp").c_str());
+        remove((dir + "/log").c_str());
+        remove((dir + "/lock").c_str());
+        remove(dir.c_str());
+    }
+
+    bool incrementCounter(FB::KeyValueTransaction& txn, const std::string& key)
+    {
+        int count = boost::lexical_cast<int>(txn.get(key).get_value_or("0"));
+        txn.put(key, boost::lexical_cast<std::string>(count + 1));
+        return true;
+    }
+
+    bool writeThenRollBack(FB::KeyValueTransaction& txn)
+    {
+        txn.put("a", "changed");
+        txn.erase("b");
+        return false;
+    }
+
+    // Writes a and b together, with padding so that each commit takes a while to write
+    bool writePair(FB::KeyValueTransaction& txn, int i)
+    {
+        std::string value(boost::lexical_cast<std::string>(i));
+        txn.put("a", value);
+        txn.put("padding", std::string(64 * 1024, static_cast<char>('a' + i % 26)));
+        txn.put("b", value);
+        return true;
+    }
+}
+
+TEST(KeyValueStore_Basic)
+{
+    PRINT_TESTNAME;
+
+    std::string dir(makeStoreDir("basic"));
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        CHECK(FB::KeyValueStore::open(dir + "/") == store);
+        CHECK(!store->get("a"));
+
+        store->put("a", "1");
+        store->put("b", std::string("two\0parts", 9));
+        store->put("c:x", "3");
+        store->erase("c:x");
+        CHECK_EQUAL(std::string("1"), store->get("a").get_value_or(""));
+        CHECK(std::string("two\0parts", 9) == store->get("b").get_value_or(""));
+        CHECK(!store->get("c:x"));
+
+        FB::KeyValueTransaction txn;
+        txn.put("c:1", "x");
+        txn.put("c:2", "y");
+        txn.erase("a");
+        CHECK(!txn.get("a"));
+        store->commit(txn);
+        CHECK(!store->get("a"));
+        std::vector<std::string> keys(store->getKeys("c:"));
+        CHECK_EQUAL(2u, keys.size());
+        CHECK_EQUAL(3u, store->size());
+
+        // Rolled back
+        store->put("a", "1");
+        CHECK(!store->transact(&writeThenRollBack));
+        CHECK_EQUAL(std::string("1"), store->get("a").get_value_or(""));
+        CHECK(store->get("b"));
+
+        for (int i = 0; i < 10; ++i)
+            CHECK(store->transact(boost::bind(&incrementCounter, _1, "count")));
+        CHECK_EQUAL(std::string("10"), store->get("count").get_value_or(""));
+    }
+    {
+        // Everything was in the log; compacting folds it into the snapshot
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        CHECK_EQUAL(5u, store->size());
+        store->compact();
+        store->put("d", "4");
+        CHECK_EQUAL(std::string("10"), store->get("count").get_value_or(""));
+    }
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        CHECK_EQUAL(6u, store->size());
+        CHECK(std::string("two\0parts", 9) == store->get("b").get_value_or(""));
+        CHECK_EQUAL(std::string("4"), store->get("d").get_value_or(""));
+        CHECK_EQUAL(std::string("y"), store->get("c:2").get_value_or(""));
+    }
+    removeStoreDir(dir);
+}
+
+TEST(KeyValueStore_TornWrite)
+{
+    PRINT_TESTNAME;
+
+    std::string dir(makeStoreDir("torn"));
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        store->put("a", "1");
+        store->put("b", "2");
+    }
+    {
+        // What a writer killed partway through a commit leaves behind
+        FILE* f = fopen((dir + "/log").c_str(), "ab");
+        const char partial[] = "\x40\x00\x00\x00\x12\x34\x56\x78\x01\x00\x00\x00\x01";
+        fwrite(partial, 1, sizeof(partial) - 1, f);
+        fclose(f);
+    }
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        CHECK_EQUAL(2u, store->size());
+        CHECK_EQUAL(std::string("2"), store->get("b").get_value_or(""));
+        store->put("c", "3");
+    }
+    {
+        // The commit after recovery went where the partial one was
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        CHECK_EQUAL(3u, store->size());
+        CHECK_EQUAL(std::string("3"), store->get("c").get_value_or(""));
+    }
+    removeStoreDir(dir);
+}
+
+TEST(KeyValueStore_API)
+{
+    PRINT_TESTNAME;
+
+    std::string dir(makeStoreDir("api"));
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir));
+        FB::KeyValueStoreAPIPtr siteA(boost::make_shared<FB::KeyValueStoreAPI>(store, "http://a.example.com"));
+        FB::KeyValueStoreAPIPtr siteB(boost::make_shared<FB::KeyValueStoreAPI>(store, "http://b.example.com"));
+
+        siteA->set("theme", "dark");
+        siteB->set("theme", "light");
+        siteB->set("lang", "fr");
+        CHECK_EQUAL(std::string("dark"), siteA->get("theme").convert_cast<std::string>());
+        CHECK(siteA->get("lang").is_null());
+        CHECK_EQUAL(1u, siteA->keys().size());
+        CHECK_EQUAL(2u, siteB->keys().size());
+
+        FB::VariantMap changes;
+        changes["theme"] = FB::FBNull();
+        changes["draft"] = "text";
+        siteB->commit(changes);
+        CHECK(siteB->get("theme").is_null());
+        CHECK_EQUAL(std::string("dark"), siteA->get("theme").convert_cast<std::string>());
+
+        // All or nothing
+        changes.clear();
+        changes["lang"] = FB::FBNull();
+        changes["bad"] = FB::VariantList();
+        CHECK_THROW(siteB->commit(changes), FB::invalid_arguments);
+        CHECK_EQUAL(std::string("fr"), siteB->get("lang").convert_cast<std::string>());
+    }
+    removeStoreDir(dir);
+}
+
+#ifndef FB_WIN
+TEST(KeyValueStore_Processes)
+{
+    PRINT_TESTNAME;
+
+    std::string dir(makeStoreDir("procs"));
+    FB::KeyValueStore::Options options;
+    options.syncCommits = false;
+
+    // Increments from several processes at once don't get lost
+    pid_t children[2];
+    for (int c = 0; c < 2; ++c) {
+        children[c] = fork();
+        if (!children[c]) {
+            FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir, options));
+            for (int i = 0; i < 100; ++i)
+                store->transact(boost::bind(&incrementCounter, _1, "count"));
+            _exit(0);
+        }
+    }
+    {
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir, options));
+        for (int i = 0; i < 100; ++i)
+            store->transact(boost::bind(&incrementCounter, _1, "count"));
+        for (int c = 0; c < 2; ++c) {
+            int status = 0;
+            waitpid(children[c], &status, 0);
+            CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+        CHECK_EQUAL(std::string("300"), store->get("count").get_value_or(""));
+    }
+    removeStoreDir(dir);
+}
+
+TEST(KeyValueStore_KilledWriter)
+{
+    PRINT_TESTNAME;
+
+    std::string dir(makeStoreDir("killed"));
+    FB::KeyValueStore::Options options;
+    options.syncCommits = false;
+    options.compactThreshold = ~size_t(0);
+
+    for (int round = 0; round < 5; ++round) {
+        pid_t child = fork();
+        if (!child) {
+            FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir, options));
+            for (int i = 0; ; ++i) {
+                store->transact(boost::bind(&writePair, _1, i));
+                // Compact now and then, so that some kills land partway through one
+                if (i % 20 == 19)
+                    store->compact();
+            }
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100 + 37 * round));
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+
+        // Each transaction is there completely or not at all
+        FB::KeyValueStorePtr store(FB::KeyValueStore::open(dir, options));
+        boost::optional<std::string> a(store->get("a")), b(store->get("b"));
+        CHECK(a && b);
+        CHECK(a == b);
+        if (a)
+            CHECK_EQUAL(static_cast<char>('a' + boost::lexical_cast<int>(*a) % 26), store->get("padding").get_value_or(" ")[0]);
+    }
+    removeStoreDir(dir);
+}
+#endif
@@ -0,0 +1,182 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include "LogFilter.h"
+#include "RacePoint.h"
+
+namespace {
+    // Stands in for the log4cplus appenders
+    struct CapturingAppender
+    {
+        void append(FB::Log::LogLevel level, const std::string& src, const std::string& msg, const char*, int,
+            const char*)
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            lines.push_back(src + ": " + msg);
+        }
+
+        size_t count(const std::string& text)
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            size_t found = 0;
+            for (std::vector<std::string>::const_iterator it = lines.begin(); it != lines.end(); ++it)
+                found += it->find(text) != std::string::npos;
+            return found;
+        }
+
+        boost::mutex mutex;
+        std::vector<std::string> lines;
+    };
+
+    void hotLoop(FB::Log::LogFilter* filter, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            filter->log(FB::Log::LogLevel_Warn, "Decoder", "Frame dropped", __FILE__, __LINE__, "hotLoop");
+    }
+
+    // Gives the other threads a chance to claim the same slot
+    void yieldingRaceHook(const char*)
+    {
+        boost::this_thread::yield();
+    }
+
+    // Every thread starts on a different source, so new sources are claimed from several at once
+    void manySources(FB::Log::LogFilter* filter, int first, int sources, int rounds)
+    {
+        for (int r = 0; r < rounds; ++r) {
+            for (int i = 0; i < sources; ++i) {
+                std::string src("Source " + boost::lexical_cast<std::string>((first + i) % sources));
+                filter->log(FB::Log::LogLevel_Info, src, "Tick", __FILE__, __LINE__, "manySources");
+            }
+        }
+    }
+}
+
+TEST(LogFilter_Repeats)
+{
+    PRINT_TESTNAME;
+
+    CapturingAppender appender;
+    FB::Log::LogFilter::Options options;
+    options.repeatWindowMs = 60 * 1000;
+    options.maxRepeats = 3;
+    options.sourceRate = 0;
+    FB::Log::LogFilter filter(boost::bind(&CapturingAppender::append, &appender, _1, _2, _3, _4, _5, _6), options);
+
+    // Several threads in the same loop
+    boost::thread_group threads;
+    for (int i = 0; i < 4; ++i)
+        threads.create_thread(boost::bind(&hotLoop, &filter, 25000));
+    threads.join_all();
+    CHECK_EQUAL(3u, appender.lines.size());
+    CHECK_EQUAL(100000 - 3, filter.getSuppressed());
+
+    // The same text from elsewhere isn't a repeat
+    filter.log(FB::Log::LogLevel_Warn, "Decoder", "Frame dropped", __FILE__, __LINE__, "test");
+    CHECK_EQUAL(4u, appender.lines.size());
+
+    filter.flush();
+    CHECK_EQUAL(5u, appender.lines.size());
+    CHECK_EQUAL(1u, appender.count("Frame dropped [repeated 99997 more times]"));
+    filter.flush();
+    CHECK_EQUAL(5u, appender.lines.size());
+}
+
+TEST(LogFilter_Window)
+{
+    PRINT_TESTNAME;
+
+    CapturingAppender appender;
+    FB::Log::LogFilter::Options options;
+    options.repeatWindowMs = 50;
+    options.maxRepeats = 1;
+    options.sourceRate = 0;
+    FB::Log::LogFilter filter(boost::bind(&CapturingAppender::append, &appender, _1, _2, _3, _4, _5, _6), options);
+
+    hotLoop(&filter, 10);
+    CHECK_EQUAL(1u, appender.lines.size());
+    boost::this_thread::sleep(boost::posix_time::milliseconds(80));
+
+    // The next window starts with what the last one held back
+    hotLoop(&filter, 10);
+    CHECK_EQUAL(3u, appender.lines.size());
+    CHECK_EQUAL(1u, appender.count("[repeated 9 more times]"));
+    CHECK_EQUAL(std::string("Decoder: Frame dropped"), appender.lines.back());
+
+    // Different messages from one place all go through
+    for (int i = 0; i < 3; ++i)
+        filter.log(FB::Log::LogLevel_Warn, "Decoder", "Frame " + boost::lexical_cast<std::string>(i), __FILE__, __LINE__, "test");
+    CHECK_EQUAL(6u, appender.lines.size());
+
+    // The loop went quiet with repeats held back; they're accounted for at the flush
+    filter.flush();
+    CHECK_EQUAL(7u, appender.lines.size());
+    CHECK_EQUAL(2u, appender.count("[repeated 9 more times]"));
+}
+
+TEST(LogFilter_SourceRate)
+{
+    PRINT_TESTNAME;
+
+    CapturingAppender appender;
+    FB::Log::LogFilter::Options options;
+    options.sourceRate = 1;
+    options.sourceBurst = 20;
+    FB::Log::LogFilter filter(boost::bind(&CapturingAppender::append, &appender, _1, _2, _3, _4, _5, _6), options);
+
+    // All different, so only the rate limit applies
+    for (int i = 0; i < 1000; ++i)
+        filter.log(FB::Log::LogLevel_Info, "Network", "Packet " + boost::lexical_cast<std::string>(i), __FILE__, __LINE__, "test");
+    size_t passed = appender.lines.size();
+    CHECK(passed >= 20 && passed <= 22);
+
+    // Another source has its own bucket
+    filter.log(FB::Log::LogLevel_Info, "UI", "Clicked", __FILE__, __LINE__, "test");
+    CHECK_EQUAL(passed + 1, appender.lines.size());
+
+    filter.flush();
+    CHECK_EQUAL(passed + 2, appender.lines.size());
+    CHECK_EQUAL(1u, appender.count("Dropped " + boost::lexical_cast<std::string>(1000 - passed)
+        + " messages from Network"));
+    CHECK_EQUAL(static_cast<long>(1000 - passed), filter.getSuppressed());
+}
+
+TEST(LogFilter_SourcesClaimedConcurrently)
+{
+    PRINT_TESTNAME;
+
+    CapturingAppender appender;
+    FB::Log::LogFilter::Options options;
+    options.repeatWindowMs = 0;
+    options.sourceRate = 0.001;
+    options.sourceBurst = 10;
+    FB::Log::LogFilter filter(boost::bind(&CapturingAppender::append, &appender, _1, _2, _3, _4, _5, _6), options);
+
+    // If two sources ever took the same slot they would share a bucket, and between them get
+    // fewer than their burst each
+    const int sources = 64;
+    FB::RaceTesting::setHook(&yieldingRaceHook);
+    boost::thread_group threads;
+    for (int i = 0; i < 8; ++i)
+        threads.create_thread(boost::bind(&manySources, &filter, i * sources / 8, sources, 5));
+    threads.join_all();
+    FB::RaceTesting::setHook(NULL);
+    CHECK_EQUAL(static_cast<size_t>(sources * 10), appender.lines.size());
+    for (int i = 0; i < sources; ++i)
+        CHECK_EQUAL(10u, appender.count("Source " + boost::lexical_cast<std::string>(i) + ": "));
+    CHECK_EQUAL(static_cast<long>(sources * 30), filter.getSuppressed());
+}
@@ -0,0 +1,107 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <boost/make_shared.hpp>
+#include "PluginEvent.h"
+#include "PluginEventSink.h"
+#include "PluginEventSource.h"
+
+namespace {
+    class EventMapTestEvent : public FB::PluginEvent { public: virtual ~EventMapTestEvent() { } };
+    class EventMapOtherEvent : public FB::PluginEvent { };
+    class EventMapUnhandledEvent : public FB::PluginEvent { };
+
+    // Puts the PluginEvent base at a non-zero offset so the cached pointer adjustment is exercised
+    class EventMapPadding { public: virtual ~EventMapPadding() { } int padding[4]; };
+    class EventMapOffsetEvent : public EventMapPadding, public EventMapTestEvent
+    {
+    public:
+        EventMapOffsetEvent() : value(42) { }
+        int value;
+    };
+
+    class EventMapTestSource : public FB::PluginEventSource { };
+    class EventMapOtherSource : public FB::PluginEventSource { };
+
+    class EventMapBaseSink : public FB::PluginEventSink
+    {
+    public:
+        EventMapBaseSink() : baseCalls(0) { }
+        BEGIN_PLUGIN_EVENT_MAP()
+            EVENTTYPE_CASE(EventMapOtherEvent, onOther, FB::PluginEventSource)
+        END_PLUGIN_EVENT_MAP()
+
+        bool onOther(EventMapOtherEvent*, FB::PluginEventSource*) { ++baseCalls; return true; }
+        int baseCalls;
+    };
+
+    class EventMapTestSink : public EventMapBaseSink
+    {
+    public:
+        EventMapTestSink() : testCalls(0), lastValue(0), lastSource(NULL) { }
+        BEGIN_PLUGIN_EVENT_MAP()
+            EVENTTYPE_CASE(EventMapOffsetEvent, onOffset, EventMapTestSource)
+            EVENTTYPE_CASE(EventMapTestEvent, onTest, EventMapTestSource)
+            PLUGIN_EVENT_MAP_CASCADE(EventMapBaseSink)
+        END_PLUGIN_EVENT_MAP()
+
+        bool onOffset(EventMapOffsetEvent* evt, EventMapTestSource* src) {
+            lastValue = evt->value;
+            lastSource = src;
+            return true;
+        }
+        bool onTest(EventMapTestEvent*, EventMapTestSource* src) {
+            ++testCalls;
+            lastSource = src;
+            return true;
+        }
+        int testCalls;
+        int lastValue;
+        EventMapTestSource* lastSource;
+    };
+}
+
+TEST(PluginEventMap_Dispatch)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<EventMapTestSink> sink(boost::make_shared<EventMapTestSink>());
+    EventMapTestSource src;
+    EventMapOtherSource other;
+
+    // Run each combination twice; the second pass is served from the resolved table
+    for (int i = 0; i < 2; ++i) {
+        EventMapTestEvent evt;
+        CHECK(sink->HandleEvent(&evt, &src));
+        CHECK(sink->testCalls == i + 1);
+        CHECK(sink->lastSource == &src);
+
+        EventMapOffsetEvent offsetEvt;
+        sink->lastValue = 0;
+        CHECK(sink->HandleEvent(&offsetEvt, &src));
+        CHECK(sink->lastValue == 42);
+
+        // Wrong source type falls through to the cascade, which doesn't handle it either
+        CHECK(!sink->HandleEvent(&evt, &other));
+        CHECK(sink->testCalls == i + 1);
+
+        EventMapOtherEvent otherEvt;
+        CHECK(sink->HandleEvent(&otherEvt, &other));
+        CHECK(sink->baseCalls == i + 1);
+
+        EventMapUnhandledEvent unhandled;
+        CHECK(!sink->HandleEvent(&unhandled, &src));
+        CHECK(!sink->HandleEvent(&unhandled, NULL));
+    }
+}
@@ -0,0 +1,233 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "BrowserHost.h"
+#include "Reactor.h"
+#include "Timer.h"
+
+namespace {
+    class ReactorRecorder
+    {
+    public:
+        ReactorRecorder() : calls(0), running(0), maxRunning(0), offReactor(0) { }
+
+        // Notes how many of these run at once
+        void serialized(const FB::ReactorPtr& reactor)
+        {
+            {
+                boost::mutex::scoped_lock _l(mutex);
+                if (++running > maxRunning)
+                    maxRunning = running;
+                if (!reactor->isReactorThread())
+                    ++offReactor;
+            }
+            boost::this_thread::sleep(boost::posix_time::microseconds(200));
+            boost::mutex::scoped_lock _l(mutex);
+            --running;
+            ++calls;
+            cond.notify_all();
+        }
+
+        void meet(boost::barrier* barrier)
+        {
+            barrier->wait();
+            boost::mutex::scoped_lock _l(mutex);
+            ++calls;
+            cond.notify_all();
+        }
+
+        void hook(const std::string& name, const boost::posix_time::ptime& deadline)
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            hooks.push_back(name);
+            deadlines.push_back(deadline);
+        }
+
+        // As a subsystem does when what it cancelled doesn't stop
+        void stuckHook(const boost::posix_time::ptime& deadline)
+        {
+            hook("stuck", deadline);
+            boost::this_thread::sleep(deadline);
+        }
+
+        void timeout()
+        {
+            boost::mutex::scoped_lock _l(mutex);
+            ++calls;
+            if (!FB::Reactor::instance()->isReactorThread())
+                ++offReactor;
+            cond.notify_all();
+        }
+
+        bool waitForCalls(int count)
+        {
+            const boost::system_time until(boost::get_system_time() + boost::posix_time::seconds(10));
+            boost::mutex::scoped_lock _l(mutex);
+            while (calls < count) {
+                if (!cond.timed_wait(_l, until))
+                    return false;
+            }
+            return true;
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        int calls;
+        int running;
+        int maxRunning;
+        int offReactor;
+        std::vector<std::string> hooks;
+        std::vector<boost::posix_time::ptime> deadlines;
+    };
+
+    void stuckTask()
+    {
+        boost::this_thread::sleep(boost::posix_time::seconds(2));
+    }
+}
+
+TEST(Reactor_Strands)
+{
+    PRINT_TESTNAME;
+
+    FB::ReactorPtr reactor(FB::Reactor::create(4, 1));
+    CHECK(reactor->getStrand("timers") == reactor->getStrand("timers"));
+    CHECK(reactor->getStrand("timers") != reactor->getStrand("http-client"));
+
+    // Four threads, but one strand: never more than one at a time
+    ReactorRecorder rec;
+    FB::Reactor::StrandPtr strand(reactor->getStrand("test"));
+    for (int i = 0; i < 100; ++i)
+        strand->post(boost::bind(&ReactorRecorder::serialized, &rec, reactor));
+    CHECK(rec.waitForCalls(100));
+    CHECK_EQUAL(1, rec.maxRunning);
+    CHECK_EQUAL(0, rec.offReactor);
+    CHECK(!reactor->isReactorThread());
+}
+
+TEST(Reactor_ThreadCount)
+{
+    PRINT_TESTNAME;
+
+    FB::ReactorPtr reactor(FB::Reactor::create(1, 1));
+    CHECK_EQUAL(1u, reactor->getThreadCount());
+    CHECK_EQUAL(1u, reactor->getBlockingThreadCount());
+
+    // Only meets if all four run at once
+    ReactorRecorder rec;
+    reactor->setThreadCount(4);
+    CHECK_EQUAL(4u, reactor->getThreadCount());
+    boost::barrier grown(4);
+    for (int i = 0; i < 4; ++i)
+        reactor->getIOService().post(boost::bind(&ReactorRecorder::meet, &rec, &grown));
+    CHECK(rec.waitForCalls(4));
+
+    // The same for the blocking pool
+    reactor->setBlockingThreadCount(3);
+    boost::barrier blocking(3);
+    for (int i = 0; i < 3; ++i)
+        CHECK(reactor->postBlocking(boost::bind(&ReactorRecorder::meet, &rec, &blocking)));
+    CHECK(rec.waitForCalls(7));
+
+    // Shrinking leaves a pool that still works
+    reactor->setThreadCount(1);
+    CHECK_EQUAL(1u, reactor->getThreadCount());
+    reactor->getStrand("test")->post(boost::bind(&ReactorRecorder::serialized, &rec, reactor));
+    CHECK(rec.waitForCalls(8));
+    CHECK_EQUAL(0, rec.offReactor);
+
+    CHECK_THROW(reactor->setThreadCount(0), std::invalid_argument);
+}
+
+TEST(Reactor_Shutdown)
+{
+    PRINT_TESTNAME;
+
+    FB::ReactorPtr reactor(FB::Reactor::create(1, 1));
+    ReactorRecorder rec;
+    reactor->addShutdownHook("first", boost::bind(&ReactorRecorder::hook, &rec, std::string("first"), _1));
+    int removed = reactor->addShutdownHook("removed", boost::bind(&ReactorRecorder::hook, &rec, std::string("removed"), _1));
+    reactor->addShutdownHook("last", boost::bind(&ReactorRecorder::hook, &rec, std::string("last"), _1));
+    reactor->removeShutdownHook(removed);
+
+    // Doesn't wait for a timer that is still pending
+    boost::asio::deadline_timer timer(reactor->getIOService());
+    timer.expires_from_now(boost::posix_time::seconds(30));
+    timer.async_wait(boost::bind(&ReactorRecorder::timeout, &rec));
+    const boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    reactor->shutdown();
+    CHECK((boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds() < 5000);
+
+    CHECK(reactor->isShutDown());
+    CHECK_EQUAL(2u, rec.hooks.size());
+    CHECK_EQUAL("last", rec.hooks.front());
+    CHECK_EQUAL("first", rec.hooks.back());
+    CHECK_EQUAL(0, rec.calls);
+    CHECK(!reactor->postBlocking(boost::bind(&ReactorRecorder::timeout, &rec)));
+    CHECK_EQUAL(0, reactor->addShutdownHook("late", boost::bind(&ReactorRecorder::hook, &rec, std::string("late"), _1)));
+    CHECK_EQUAL(0u, reactor->getThreadCount());
+}
+
+TEST(Reactor_ShutdownBudget)
+{
+    PRINT_TESTNAME;
+
+    const long budget(FB::BrowserHost::getTeardownBudget());
+    FB::BrowserHost::setTeardownBudget(300);
+    FB::ReactorPtr reactor(FB::Reactor::create(1, 1));
+    ReactorRecorder rec;
+    for (int i = 0; i < 3; ++i)
+        reactor->addShutdownHook("stuck", boost::bind(&ReactorRecorder::stuckHook, &rec, _1));
+    reactor->postBlocking(&stuckTask);
+    boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+
+    // Three hooks that wait as long as they may, and a thread that won't stop, still only take
+    // the one budget between them
+    const boost::posix_time::ptime start(boost::posix_time::microsec_clock::universal_time());
+    reactor->shutdown();
+    const long elapsed(static_cast<long>((boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds()));
+    CHECK(elapsed >= 250);
+    CHECK(elapsed < 600);
+    CHECK_EQUAL(3u, rec.deadlines.size());
+    if (rec.deadlines.size() == 3u) {
+        CHECK(rec.deadlines[0] == rec.deadlines[1]);
+        CHECK(rec.deadlines[1] == rec.deadlines[2]);
+    }
+    FB::BrowserHost::setTeardownBudget(budget);
+}
+
+TEST(Reactor_SharedByTimers)
+{
+    PRINT_TESTNAME;
+
+    // Timers don't start threads of their own
+    FB::ReactorPtr reactor(FB::Reactor::instance());
+    CHECK(reactor == FB::Reactor::instance());
+    const size_t threads = reactor->getThreadCount();
+
+    ReactorRecorder rec;
+    std::vector<FB::TimerPtr> timers;
+    for (int i = 0; i < 20; ++i) {
+        timers.push_back(FB::Timer::getTimer(5 + i, false, boost::bind(&ReactorRecorder::timeout, &rec)));
+        timers.back()->start();
+    }
+    CHECK(rec.waitForCalls(20));
+    CHECK_EQUAL(0, rec.offReactor);
+    CHECK_EQUAL(threads, reactor->getThreadCount());
+}
@@ -0,0 +1,205 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "ResultStream.h"
+
+namespace {
+    // Stands in for the main thread and the page
+    struct StreamConsumer
+    {
+        StreamConsumer() : stream(NULL), dispatched(0), batches(0), maxBatch(0), done(false), success(false),
+            delayMs(0) { }
+
+        void dispatch(const boost::function<void ()>& func)
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            calls.push_back(func);
+            ++dispatched;
+            cond.notify_all();
+        }
+
+        // Runs calls as they are dispatched until the stream is done or nothing comes for a while
+        void run()
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while (!done) {
+                if (calls.empty()) {
+                    if (!cond.timed_wait(lock, boost::get_system_time() + boost::posix_time::seconds(5)))
+                        return;
+                    continue;
+                }
+                boost::function<void ()> func(calls.front());
+                calls.pop_front();
+                lock.unlock();
+                func();
+                lock.lock();
+            }
+        }
+
+        void onBatch(const FB::VariantList& items)
+        {
+            ++batches;
+            maxBatch = std::max(maxBatch, items.size());
+            for (FB::VariantList::const_iterator it = items.begin(); it != items.end(); ++it)
+                received.push_back(it->convert_cast<int>());
+            if (delayMs)
+                boost::this_thread::sleep(boost::posix_time::milliseconds(delayMs));
+            // Done with these; ask for as many again
+            if (stream)
+                stream->grant(items.size());
+        }
+
+        void onDone(bool ok, const std::string& err)
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            done = true;
+            success = ok;
+            error = err;
+        }
+
+        FB::ResultStream* stream;
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        std::deque<boost::function<void ()> > calls;
+        size_t dispatched;
+        size_t batches;
+        size_t maxBatch;
+        std::vector<int> received;
+        bool done;
+        bool success;
+        std::string error;
+        int delayMs;
+    };
+
+    void produce(FB::ResultStreamPtr stream, int count, int* written)
+    {
+        for (int i = 0; i < count && !stream->isCanceled(); ++i) {
+            if (stream->write(i))
+                ++*written;
+        }
+        stream->close();
+    }
+}
+
+TEST(ResultStream_SlowConsumer)
+{
+    PRINT_TESTNAME;
+
+    StreamConsumer consumer;
+    consumer.delayMs = 1;
+    FB::ResultStreamPtr stream(FB::ResultStream::create(16, FB::ResultStream::OVERFLOW_BLOCK,
+        boost::bind(&StreamConsumer::onBatch, &consumer, _1),
+        boost::bind(&StreamConsumer::onDone, &consumer, _1, _2),
+        boost::bind(&StreamConsumer::dispatch, &consumer, _1)));
+    consumer.stream = stream.get();
+
+    int written = 0;
+    boost::thread producer(boost::bind(&produce, stream, 2000, &written));
+    stream->grant(8);
+    consumer.run();
+    producer.join();
+
+    CHECK(consumer.done);
+    CHECK(consumer.success);
+    CHECK_EQUAL(2000, written);
+    CHECK_EQUAL(2000u, consumer.received.size());
+    bool inOrder = true;
+    for (size_t i = 0; i < consumer.received.size(); ++i)
+        inOrder = inOrder && consumer.received[i] == static_cast<int>(i);
+    CHECK(inOrder);
+
+    // The producer was held back to what the stream can hold...
+    CHECK(stream->getHighWater() <= 16u);
+    CHECK_EQUAL(0u, stream->getDropped());
+    // ...the consumer never got more than it had credit for...
+    CHECK(consumer.maxBatch <= 8u);
+    // ...and it was handed batches, not an item per call
+    CHECK(consumer.dispatched <= consumer.batches + 2);
+    CHECK(consumer.batches < 2000u / 2);
+    CHECK(stream->isFinished());
+}
+
+TEST(ResultStream_Overflow)
+{
+    PRINT_TESTNAME;
+
+    StreamConsumer newest;
+    FB::ResultStreamPtr stream(FB::ResultStream::create(3, FB::ResultStream::OVERFLOW_DROP_NEWEST,
+        boost::bind(&StreamConsumer::onBatch, &newest, _1),
+        boost::bind(&StreamConsumer::onDone, &newest, _1, _2)));
+    for (int i = 0; i < 5; ++i)
+        CHECK_EQUAL(i < 3, stream->write(i));
+    CHECK_EQUAL(3u, stream->getBuffered());
+    CHECK_EQUAL(2u, stream->getDropped());
+    stream->fail("disk full");
+    CHECK(!stream->write(5));
+    CHECK(!newest.done);
+    // The error comes after the items that were written before it
+    stream->grant(10);
+    CHECK_EQUAL(3u, newest.received.size());
+    CHECK_EQUAL(2, newest.received.back());
+    CHECK(newest.done);
+    CHECK(!newest.success);
+    CHECK_EQUAL(std::string("disk full"), newest.error);
+
+    StreamConsumer oldest;
+    stream = FB::ResultStream::create(3, FB::ResultStream::OVERFLOW_DROP_OLDEST,
+        boost::bind(&StreamConsumer::onBatch, &oldest, _1),
+        boost::bind(&StreamConsumer::onDone, &oldest, _1, _2));
+    for (int i = 0; i < 5; ++i)
+        CHECK(stream->write(i));
+    stream->close();
+    stream->grant(1);
+    CHECK_EQUAL(1u, oldest.received.size());
+    CHECK_EQUAL(2, oldest.received.front());
+    CHECK(!oldest.done);
+    stream->grant(5);
+    CHECK_EQUAL(3u, oldest.received.size());
+    CHECK_EQUAL(4, oldest.received.back());
+    CHECK(oldest.done);
+    CHECK(oldest.success);
+}
+
+TEST(ResultStream_Cancel)
+{
+    PRINT_TESTNAME;
+
+    StreamConsumer consumer;
+    FB::ResultStreamPtr stream(FB::ResultStream::create(4, FB::ResultStream::OVERFLOW_BLOCK,
+        boost::bind(&StreamConsumer::onBatch, &consumer, _1),
+        boost::bind(&StreamConsumer::onDone, &consumer, _1, _2)));
+    FB::CancellationTokenPtr token(boost::make_shared<FB::CancellationToken>());
+    stream->setCancellationToken(token);
+
+    // Nobody grants anything, so the producer fills the stream and blocks
+    int written = 0;
+    boost::thread producer(boost::bind(&produce, stream, 1000, &written));
+    for (int i = 0; i < 500 && stream->getBuffered() < 4; ++i)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(2));
+    CHECK_EQUAL(4u, stream->getBuffered());
+
+    // Shutting down lets it go
+    token->cancel();
+    CHECK(producer.timed_join(boost::posix_time::seconds(5)));
+    CHECK_EQUAL(4, written);
+    CHECK(stream->isCanceled());
+    CHECK(stream->isFinished());
+    CHECK_EQUAL(0u, stream->getBuffered());
+    stream->grant(10);
+    CHECK(consumer.received.empty());
+    CHECK(!consumer.done);
+}
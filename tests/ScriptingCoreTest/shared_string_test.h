@@ -0,0 +1,115 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include "SharedString.h"
+#include "variant_list.h"
+
+namespace {
+    void copySharedStrings(const FB::SharedString& str, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            FB::SharedString copy(str);
+            FB::SharedString other;
+            other = copy;
+        }
+    }
+}
+
+TEST(SharedString_Basics)
+{
+    PRINT_TESTNAME;
+
+    FB::SharedString empty;
+    CHECK(empty.empty());
+    CHECK_EQUAL("", empty.c_str());
+    CHECK(FB::SharedString(static_cast<const char*>(NULL)).empty());
+
+    // Short strings are kept inline
+    FB::SharedString shortStr("onload");
+    CHECK(!shortStr.isShared());
+    CHECK_EQUAL(6u, shortStr.length());
+    CHECK_EQUAL("onload", shortStr.str());
+
+    const std::string longText("a string that is much too long to be kept inline");
+    FB::SharedString longStr(longText);
+    CHECK(longStr.isShared());
+    FB::SharedString copy(longStr);
+    CHECK(longStr.c_str() == copy.c_str());
+    CHECK(copy == longStr);
+    CHECK(copy == longText);
+    CHECK_EQUAL(longStr.hash(), FB::SharedString(longText).hash());
+
+    // Embedded nulls are kept
+    FB::SharedString binary("a\0b", 3);
+    CHECK_EQUAL(3u, binary.length());
+    CHECK(binary != FB::SharedString("a"));
+    CHECK_EQUAL(std::string("a\0b", 3), binary.str());
+
+    copy = shortStr;
+    CHECK(copy == "onload");
+    shortStr.swap(longStr);
+    CHECK(shortStr == longText);
+    CHECK(longStr == "onload");
+
+    CHECK(FB::SharedString("abc") < FB::SharedString("abd"));
+    CHECK(FB::SharedString("ab") < FB::SharedString("abc"));
+    CHECK(!(FB::SharedString("abc") < FB::SharedString("abc")));
+
+    boost::unordered_map<FB::SharedString, int> names;
+    names[FB::SharedString("width")] = 1;
+    names[FB::SharedString(longText)] = 2;
+    CHECK_EQUAL(1, names[FB::SharedString(std::string("width"))]);
+    CHECK_EQUAL(2, names[FB::SharedString(longText)]);
+}
+
+TEST(SharedString_Threads)
+{
+    PRINT_TESTNAME;
+
+    FB::SharedString str("shared by several threads that copy and drop it at once");
+    boost::thread_group threads;
+    for (int i = 0; i < 4; ++i)
+        threads.create_thread(boost::bind(&copySharedStrings, str, 20000));
+    threads.join_all();
+    CHECK_EQUAL("shared by several threads that copy and drop it at once", str.str());
+}
+
+TEST(SharedString_Variant)
+{
+    PRINT_TESTNAME;
+
+    const std::string text("a SharedString inside a variant isn't copied");
+    FB::SharedString str(text);
+    FB::variant var(str);
+    CHECK(var.is_of_type<FB::SharedString>());
+    CHECK(str.c_str() == var.cast<FB::SharedString>().c_str());
+
+    FB::VariantList args(FB::variant_list_of(str)(var));
+    CHECK(str.c_str() == args[1].cast<FB::SharedString>().c_str());
+
+    CHECK_EQUAL(text, var.convert_cast<std::string>());
+    CHECK(var.convert_cast<std::wstring>() == FB::utf8_to_wstring(text));
+    CHECK_EQUAL(42, FB::variant(FB::SharedString("42")).convert_cast<int>());
+    CHECK_EQUAL(true, FB::variant(FB::SharedString("yes")).convert_cast<bool>());
+
+    CHECK(FB::variant(std::string("from a string")).convert_cast<FB::SharedString>() == "from a string");
+    CHECK(FB::variant(12).convert_cast<FB::SharedString>() == "12");
+
+    // Variants holding SharedStrings sort like the strings do
+    CHECK(FB::variant(FB::SharedString("a")) < FB::variant(FB::SharedString("b")));
+}
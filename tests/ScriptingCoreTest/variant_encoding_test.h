@@ -0,0 +1,291 @@
+/**********************************************************\
+Original Author: agent (agent@local)
+
+Created:    Oct 19, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 agent, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <limits>
+#include <boost/make_shared.hpp>
+#include "variant_encoding.h"
+#include "variant_list.h"
+#include "variant_map.h"
+
+namespace {
+    FB::variant roundTrip(const FB::variant& value)
+    {
+        return FB::decodeVariant(FB::encodeVariant(value));
+    }
+
+    bool decodeFails(const std::string& data)
+    {
+        try {
+            FB::decodeVariant(data);
+        } catch (const FB::variant_encoding_error&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+TEST(VariantEncoding_Scalars)
+{
+    PRINT_TESTNAME;
+
+    // Undefined and null stay apart
+    FB::variant undef(roundTrip(FB::FBVoid()));
+    CHECK(undef.empty() && !undef.is_null());
+    CHECK(roundTrip(FB::variant()).empty());
+    FB::variant null(roundTrip(FB::FBNull()));
+    CHECK(null.is_null());
+    CHECK(!null.empty());
+
+    CHECK(roundTrip(true).cast<bool>());
+    CHECK(!roundTrip(false).cast<bool>());
+    CHECK_EQUAL(5, roundTrip(5).cast<int>());
+    CHECK_EQUAL(-1, roundTrip(-1).cast<int>());
+    CHECK_EQUAL((std::numeric_limits<int>::min)(), roundTrip((std::numeric_limits<int>::min)()).cast<int>());
+    CHECK_EQUAL(4000000000u, roundTrip(4000000000u).cast<unsigned int>());
+    CHECK_EQUAL(1.5, roundTrip(1.5).cast<double>());
+    CHECK_EQUAL(-0.25, roundTrip(-0.25f).cast<double>());
+    CHECK_EQUAL(std::string("text"), roundTrip("text").cast<std::string>());
+    CHECK_EQUAL(std::string("wide"), roundTrip(std::wstring(L"wide")).cast<std::string>());
+    CHECK_EQUAL(std::string("shared"), roundTrip(FB::SharedString("shared")).cast<std::string>());
+    CHECK_EQUAL(std::string("a\0b", 3), roundTrip(std::string("a\0b", 3)).cast<std::string>());
+
+    // 64 bit integers keep every bit, and their type
+    const boost::int64_t big((std::numeric_limits<boost::int64_t>::min)());
+    FB::variant bigVar(roundTrip(FB::variant(big, true)));
+    CHECK(bigVar.get_type() == typeid(boost::int64_t));
+    CHECK(bigVar.cast<boost::int64_t>() == big);
+    CHECK(roundTrip(FB::variant((std::numeric_limits<boost::int64_t>::max)(), true)).cast<boost::int64_t>()
+        == (std::numeric_limits<boost::int64_t>::max)());
+    const boost::uint64_t ubig((std::numeric_limits<boost::uint64_t>::max)());
+    CHECK(roundTrip(FB::variant(ubig, true)).cast<boost::uint64_t>() == ubig);
+
+    // Small non-negative ints fit in the tag
+    CHECK_EQUAL(5u, FB::encodeVariant(127).size());
+    CHECK_EQUAL(7u, FB::encodeVariant(128).size());
+}
+
+TEST(VariantEncoding_Graphs)
+{
+    PRINT_TESTNAME;
+
+    FB::VariantMap record;
+    record["name"] = "dump.bin";
+    record["size"] = 1234;
+    record["missing"] = FB::FBVoid();
+    record["none"] = FB::FBNull();
+    record["tags"] = FB::VariantList(FB::variant_list_of("a")(2)(3.5)(FB::VariantList(FB::variant_list_of(FB::VariantMap()))));
+    FB::VariantList list(FB::variant_list_of(record)(record)(FB::VariantList()));
+
+    FB::variant out(roundTrip(list));
+    CHECK(out.get_type() == typeid(FB::VariantList));
+    const FB::VariantList& outList(out.cast<const FB::VariantList&>());
+    CHECK_EQUAL(3u, outList.size());
+    CHECK_EQUAL(FB::encodeVariant(outList[0]), FB::encodeVariant(outList[1]));
+    const FB::VariantMap& outRecord(outList[0].cast<const FB::VariantMap&>());
+    CHECK_EQUAL(record.size(), outRecord.size());
+    CHECK_EQUAL(std::string("dump.bin"), outRecord.find("name")->second.cast<std::string>());
+    CHECK_EQUAL(1234, outRecord.find("size")->second.cast<int>());
+    CHECK(outRecord.find("missing")->second.empty());
+    CHECK(outRecord.find("none")->second.is_null());
+    const FB::VariantList& tags(outRecord.find("tags")->second.cast<const FB::VariantList&>());
+    CHECK_EQUAL(4u, tags.size());
+    CHECK_EQUAL(3.5, tags[2].cast<double>());
+    CHECK(tags[3].cast<FB::VariantList>()[0].cast<FB::VariantMap>().empty());
+    CHECK(outList[2].cast<FB::VariantList>().empty());
+
+    // The second record refers back to the first one's keys instead of repeating their 23 bytes
+    const size_t firstSize = FB::encodeVariant(FB::VariantList(FB::variant_list_of(record))).size();
+    const size_t bothSize = FB::encodeVariant(FB::VariantList(FB::variant_list_of(record)(record))).size();
+    CHECK_EQUAL(firstSize - 6 - 23, bothSize - firstSize);
+
+    // Things without a fixed meaning can't be encoded
+    int x = 0;
+    CHECK_THROW(FB::encodeVariant(FB::variant(&x, true)), FB::variant_encoding_error);
+}
+
+TEST(VariantEncoding_Blobs)
+{
+    PRINT_TESTNAME;
+
+    const std::string bytes("\x00\x01\x02\xff binary", 11);
+    FB::Blob blob(bytes.data(), bytes.size());
+    CHECK(!blob.isBorrowed());
+    CHECK(FB::Blob(bytes) == blob);
+    CHECK(FB::Blob().empty());
+
+    // Blobs come back as Blobs, not strings; copied out of a buffer nothing owns
+    std::string encoded(FB::encodeVariant(FB::VariantList(FB::variant_list_of(blob)(bytes))));
+    FB::VariantList list(FB::decodeVariant(encoded).cast<FB::VariantList>());
+    CHECK(list[0].get_type() == typeid(FB::Blob));
+    CHECK(list[0].cast<FB::Blob>() == blob);
+    CHECK(!list[0].cast<FB::Blob>().isBorrowed());
+    CHECK(list[1].get_type() == typeid(std::string));
+
+    // and pointing into it when something keeps the buffer alive
+    boost::shared_ptr<const std::string> buffer(boost::make_shared<std::string>(encoded));
+    FB::Blob shared;
+    {
+        FB::VariantReader reader(buffer);
+        shared = reader.read().cast<FB::VariantList>()[0].cast<FB::Blob>();
+    }
+    CHECK(shared.isBorrowed());
+    CHECK(shared.data() >= buffer->data() && shared.data() < buffer->data() + buffer->size());
+    buffer.reset();
+    CHECK_EQUAL(bytes, shared.str());
+}
+
+TEST(VariantEncoding_Streaming)
+{
+    PRINT_TESTNAME;
+
+    // Written a piece at a time, two values one after the other
+    std::string out;
+    FB::VariantWriter writer(out);
+    CHECK_THROW(writer.writeKey("early"), FB::variant_encoding_error);
+    writer.beginList(2);
+    for (int i = 0; i < 2; ++i) {
+        CHECK(!writer.isComplete());
+        writer.beginMap(2);
+        writer.writeKey("name");
+        writer.writeString(i ? "second" : "first");
+        writer.writeKey("thumb");
+        writer.writeBlob("\x89PNG", 4);
+    }
+    CHECK(writer.isComplete());
+    writer.writeInt64(-5);
+    // A map's value needs its key first
+    writer.beginMap(1);
+    CHECK_THROW(writer.writeNull(), FB::variant_encoding_error);
+
+    // Everything up to the last map reads back token by token, with strings in the input
+    out.resize(out.size() - 2);
+    FB::VariantReader reader(out);
+    CHECK_EQUAL(FB::VariantReader::Token_BeginList, reader.next());
+    CHECK_EQUAL(2u, reader.getCount());
+    CHECK_EQUAL(FB::VariantReader::Token_BeginMap, reader.next());
+    CHECK_EQUAL(2u, reader.getDepth());
+    CHECK_EQUAL(FB::VariantReader::Token_Key, reader.next());
+    CHECK_EQUAL(std::string("name"), reader.getString());
+    CHECK_EQUAL(FB::VariantReader::Token_String, reader.next());
+    CHECK(reader.getData() > out.data() && reader.getData() < out.data() + out.size());
+    CHECK_EQUAL(std::string("first"), reader.getString());
+    CHECK_EQUAL(FB::VariantReader::Token_Key, reader.next());
+    CHECK_EQUAL(FB::VariantReader::Token_Blob, reader.next());
+    CHECK_EQUAL(4u, reader.getSize());
+    CHECK_EQUAL(FB::VariantReader::Token_EndMap, reader.next());
+
+    // The second record's keys come back through the table
+    FB::VariantMap second(reader.read().cast<FB::VariantMap>());
+    CHECK_EQUAL(std::string("second"), second["name"].cast<std::string>());
+    CHECK(second["thumb"].cast<FB::Blob>() == FB::Blob("\x89PNG", 4));
+    CHECK_EQUAL(FB::VariantReader::Token_EndList, reader.next());
+    CHECK(!reader.atEnd());
+    CHECK_EQUAL(FB::VariantReader::Token_Int64, reader.next());
+    CHECK(reader.getInt() == -5);
+    CHECK(reader.atEnd());
+    CHECK_EQUAL(FB::VariantReader::Token_End, reader.next());
+    CHECK_THROW(reader.read(), FB::variant_encoding_error);
+
+    // Skipping a value skips everything in it
+    FB::VariantReader skipper(out);
+    skipper.skip();
+    CHECK_EQUAL(FB::VariantReader::Token_Int64, skipper.next());
+}
+
+TEST(VariantEncoding_Malformed)
+{
+    PRINT_TESTNAME;
+
+    FB::VariantMap map;
+    map["list"] = FB::VariantList(FB::variant_list_of(1)("two")(FB::Blob("three", 5))(4.0)(FB::variant(-5000000000ll, true)));
+    map["key"] = "value";
+    const std::string good(FB::encodeVariant(map));
+    CHECK_EQUAL(good, FB::encodeVariant(FB::decodeVariant(good)));
+
+    // Every truncation fails cleanly
+    for (size_t i = 0; i < good.size(); ++i)
+        CHECK(decodeFails(good.substr(0, i)));
+    // and so does anything with more after it
+    CHECK(decodeFails(good + good.substr(4)));
+
+    // Not ours, or from a newer version
+    CHECK(decodeFails("XBV\x01\x01"));
+    std::string newer(good);
+    newer[3] = FB::VariantWriter::Version + 1;
+    CHECK(decodeFails(newer));
+
+    // Unknown tags, references to keys that haven't been seen, and counts larger than the data
+    const std::string header(good.substr(0, 4));
+    CHECK(decodeFails(header + "\x7f"));
+    CHECK(decodeFails(header + "\x0c\x01\x03\x01"));
+    CHECK(decodeFails(header + "\x0b\xff\xff\xff\xff\x0f\x01"));
+    CHECK(decodeFails(header + "\x04\xff\xff\xff\xff\xff"));
+
+    // Nesting too deep to be real
+    std::string deep(header);
+    for (size_t i = 0; i <= FB::VariantReader::MaxDepth; ++i)
+        deep += "\x0b\x01";
+    deep += '\x80';
+    CHECK(decodeFails(deep));
+}
+
+TEST(VariantEncoding_JSON)
+{
+    PRINT_TESTNAME;
+
+    FB::VariantMap map;
+    map["list"] = FB::VariantList(FB::variant_list_of(1)(-2.5)("two")(true)(FB::FBNull())(FB::FBVoid()));
+    map["quote\"d"] = std::string("tab\tline\nctl\x01 \xc3\xa9");
+    map["wide"] = std::wstring(L"w");
+    map["big"] = FB::variant(-5000000000ll, true);
+    const std::string json(FB::encodeJSON(map));
+    CHECK_EQUAL("{\"big\":-5000000000,\"list\":[1,-2.5,\"two\",true,null,null],"
+        "\"quote\\\"d\":\"tab\\tline\\nctl\\u0001 \xc3\xa9\",\"wide\":\"w\"}", json);
+
+    // Reading it back gives ints where they fit, doubles otherwise, and null for both kinds of nothing
+    FB::VariantMap back(FB::decodeJSON(json).convert_cast<FB::VariantMap>());
+    CHECK_EQUAL(4u, back.size());
+    CHECK(back["big"].get_type() == typeid(double));
+    CHECK_EQUAL(-5000000000.0, back["big"].cast<double>());
+    FB::VariantList list(back["list"].convert_cast<FB::VariantList>());
+    CHECK_EQUAL(6u, list.size());
+    CHECK_EQUAL(1, list[0].cast<int>());
+    CHECK_EQUAL(-2.5, list[1].cast<double>());
+    CHECK(list[4].is_null() && list[5].is_null());
+    CHECK_EQUAL(map["quote\"d"].cast<std::string>(), back["quote\"d"].cast<std::string>());
+    CHECK_EQUAL(json, FB::encodeJSON(back));
+
+    // Whitespace, escapes and surrogate pairs as a browser might write them
+    FB::VariantList parsed(FB::decodeJSON(" [ \"\\u00e9\\/\\ud83d\\ude00\" , 1e3 , {} , [ ] ] ").convert_cast<FB::VariantList>());
+    CHECK_EQUAL(4u, parsed.size());
+    CHECK_EQUAL("\xc3\xa9/\xf0\x9f\x98\x80", parsed[0].cast<std::string>());
+    CHECK_EQUAL(1000.0, parsed[1].cast<double>());
+
+    // Numbers JSON has no way to write become null; Blobs can't be written at all
+    CHECK_EQUAL("[null,null]", FB::encodeJSON(FB::VariantList(FB::variant_list_of
+        (std::numeric_limits<double>::quiet_NaN())(std::numeric_limits<double>::infinity()))));
+    CHECK_THROW(FB::encodeJSON(FB::Blob("b", 1)), FB::variant_encoding_error);
+    // unless the caller would rather have null there, as fbjson's appendVariantAsJson does
+    std::string lenient("x=");
+    FB::appendJSON(lenient, FB::VariantList(FB::variant_list_of(FB::Blob("b", 1))(2)), FB::UnencodableJSONAsNull);
+    CHECK_EQUAL("x=[null,2]", lenient);
+
+    const char* malformed[] = { "", "[1,", "[1 2]", "{\"a\" 1}", "{1:2}", "\"open", "tru", "-", "[1]]",
+        "\"\\x\"", "\"a\nb\"", "1e999" };
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i)
+        CHECK_THROW(FB::decodeJSON(malformed[i]), FB::variant_encoding_error);
+    CHECK_THROW(FB::decodeJSON(std::string(FB::VariantReader::MaxDepth + 1, '[')
+        + std::string(FB::VariantReader::MaxDepth + 1, ']')), FB::variant_encoding_error);
+}